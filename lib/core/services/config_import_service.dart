@@ -1,6 +1,7 @@
 import 'dart:convert';
 import 'package:http/http.dart' as http;
 import '../../data/models/vpn_config.dart';
+import 'subscription_parser_bridge.dart';
 
 class ConfigImportService {
   // Импорт конфигурации из URL-ссылки
@@ -14,6 +15,11 @@ class ConfigImportService {
         return [VpnConfig.fromUrl(url)];
       }
       
+      // Большие подписки разбираются нативно, пока тело еще загружается
+      if (SubscriptionParserBridge().isAvailable) {
+        return await _importNative(url);
+      }
+      
       // Выполняем GET-запрос к URL для получения конфигурации
       final response = await http.get(Uri.parse(url));
       
@@ -27,6 +33,28 @@ class ConfigImportService {
     }
   }
 
+  // Загрузка и разбор подписки нативным парсером
+  static Future<List<VpnConfig>> _importNative(String url) async {
+    final client = http.Client();
+    try {
+      final response = await client.send(http.Request('GET', Uri.parse(url)));
+      if (response.statusCode != 200) {
+        throw Exception('Ошибка получения данных: ${response.statusCode}');
+      }
+      
+      final parsed = await SubscriptionParserBridge().parseStream(response.stream);
+      if (parsed.configs.isEmpty) {
+        throw FormatException('Ответ не содержит валидной VPN конфигурации');
+      }
+      if (parsed.skippedLines > 0) {
+        print('Пропущено строк подписки: ${parsed.skippedLines}');
+      }
+      return parsed.configs;
+    } finally {
+      client.close();
+    }
+  }
+
   // Парсинг содержимого ответа
   static List<VpnConfig> _parseResponseContent(String content) {
     final List<VpnConfig> configs = [];
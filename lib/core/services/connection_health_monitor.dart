@@ -7,6 +7,7 @@ import 'package:connectivity_plus/connectivity_plus.dart';
 import 'package:http/http.dart' as http;
 
 import 'logger_service.dart';
+import 'native_proxy_bridge.dart';
 import 'notification_service.dart';
 import 'vpn_connection_manager.dart';
 
@@ -74,6 +75,9 @@ class ConnectionHealthMonitor {
   // Timer for health checks
   Timer? _healthCheckTimer;
   
+  // Native background latency targets per health check URL (Windows)
+  final Map<String, int> _latencyTargets = {};
+  
   // Latest health status
   HealthStatus? _lastStatus;
   
@@ -91,6 +95,8 @@ class ConnectionHealthMonitor {
     
     LoggerService.info('Starting connection health monitoring');
     
+    _registerLatencyTargets();
+    
     // Run an immediate check
     checkHealth();
     
@@ -107,6 +113,28 @@ class ConnectionHealthMonitor {
     
     _healthCheckTimer?.cancel();
     _healthCheckTimer = null;
+    
+    final bridge = NativeProxyBridge();
+    for (final id in _latencyTargets.values) {
+      bridge.removeLatencyTarget(id);
+    }
+    _latencyTargets.clear();
+  }
+  
+  // The native prober measures TCP connect time to the health check hosts
+  // in the background, so a check reads a cached value instead of waiting
+  // for a request
+  void _registerLatencyTargets() {
+    final bridge = NativeProxyBridge();
+    if (!bridge.isAvailable) return;
+    
+    for (final url in _healthCheckUrls) {
+      final uri = Uri.parse(url);
+      final id = bridge.addLatencyTarget(uri.host, uri.port);
+      if (id != null) {
+        _latencyTargets[url] = id;
+      }
+    }
   }
   
   // Perform a health check
@@ -229,6 +257,14 @@ class ConnectionHealthMonitor {
     final latencies = <int>[];
     
     for (final url in _healthCheckUrls) {
+      // Cached native measurement first; HTTP request until it has one
+      final target = _latencyTargets[url];
+      final stats = target != null ? NativeProxyBridge().latencyStats(target) : null;
+      if (stats != null && stats.reachable) {
+        latencies.add(stats.smoothed!.inMilliseconds);
+        continue;
+      }
+      
       try {
         final stopwatch = Stopwatch()..start();
         
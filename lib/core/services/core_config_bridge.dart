@@ -0,0 +1,75 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+
+import '../../data/models/vpn_config.dart';
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Мост к нативному генератору конфигураций ядер (windivert_helper.dll):
+// JSON для V2Ray, trojan и sslocal пишется потоково в переиспользуемый
+// буфер, байт в байт как карты WindowsVpnService после jsonEncode
+class CoreConfigBridge {
+  // Singleton pattern
+  static final CoreConfigBridge _instance = CoreConfigBridge._internal();
+  factory CoreConfigBridge() => _instance;
+  CoreConfigBridge._internal();
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+
+  late Pointer<Uint8> Function(Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>, Pointer<Int32>)
+      _generate;
+
+  bool get isAvailable => _ensureLoaded();
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _generate = helper.lookupFunction<
+          Pointer<Uint8> Function(Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>, Pointer<Int32>),
+          Pointer<Uint8> Function(Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>,
+              Pointer<Int32>)>('CoreConfigGenerate');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного генератора конфигураций', e);
+      return false;
+    }
+  }
+
+  // Конфигурация ядра для сервера в UTF-8 или null, если генератор
+  // недоступен или не знает протокол
+  Uint8List? generate(VpnConfig config, {required String accessLog, required String errorLog}) {
+    if (!_ensureLoaded()) return null;
+
+    // Генератор знает протоколы по именам ссылок
+    final protocol = config.protocol.toLowerCase();
+    final server = config.toJson()..['protocol'] = protocol == 'shadowsocks' ? 'ss' : protocol;
+
+    final serverPtr = jsonEncode([server]).toNativeUtf8();
+    final accessPtr = accessLog.toNativeUtf8();
+    final errorPtr = errorLog.toNativeUtf8();
+    final length = calloc<Int32>();
+    try {
+      final result = _generate(serverPtr, accessPtr, errorPtr, length);
+      if (result == nullptr) return null;
+      // Буфер генератора переиспользуется - копия
+      return Uint8List.fromList(result.asTypedList(length.value));
+    } finally {
+      malloc.free(serverPtr);
+      malloc.free(accessPtr);
+      malloc.free(errorPtr);
+      calloc.free(length);
+    }
+  }
+}
@@ -1,4 +1,9 @@
+import 'dart:io';
 import 'package:logger/logger.dart';
+import 'package:path/path.dart' as path;
+import 'package:path_provider/path_provider.dart';
+
+import 'native_log_bridge.dart';
 
 class LoggerService {
   static final Logger _logger = Logger(
@@ -12,19 +17,41 @@ class LoggerService {
     ),
   );
 
+  static final NativeLogBridge _native = NativeLogBridge();
+
+  // Открыть файл журнала (logs/app.log в каталоге приложения); до этого
+  // записи только печатаются в консоль
+  static Future<void> initialize() async {
+    if (!_native.isAvailable) return;
+    try {
+      final appDir = await getApplicationSupportDirectory();
+      final logDir = Directory(path.join(appDir.path, 'logs'));
+      await logDir.create(recursive: true);
+      if (!_native.open(logDir.path)) {
+        _logger.w('Не удалось открыть файл журнала в ${logDir.path}');
+      }
+    } catch (e) {
+      _logger.e('Ошибка открытия файла журнала', error: e);
+    }
+  }
+
   static void debug(String message) {
+    _native.write(NativeLogBridge.levelDebug, message);
     _logger.d(message);
   }
 
   static void info(String message) {
+    _native.write(NativeLogBridge.levelInfo, message);
     _logger.i(message);
   }
 
   static void warning(String message) {
+    _native.write(NativeLogBridge.levelWarning, message);
     _logger.w(message);
   }
 
   static void error(String message, [dynamic error, StackTrace? stackTrace]) {
+    _native.write(NativeLogBridge.levelError, error == null ? message : '$message: $error');
     _logger.e(message, error: error, stackTrace: stackTrace);
   }
 }
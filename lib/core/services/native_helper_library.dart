@@ -0,0 +1,36 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'package:path/path.dart' as path;
+
+import 'logger_service.dart';
+
+// Общая загрузка windivert_helper.dll для нативных мостов: библиотека
+// открывается один раз на процесс из каталога исполняемого файла, мосты
+// только ищут в ней свои функции. Вне Windows и без DLL - null; неудачная
+// попытка не повторяется.
+class NativeHelperLibrary {
+  static const String fileName = 'windivert_helper.dll';
+
+  static DynamicLibrary? _library;
+  static bool _loadAttempted = false;
+
+  NativeHelperLibrary._();
+
+  static DynamicLibrary? open() {
+    if (_library != null || _loadAttempted || !Platform.isWindows) return _library;
+    _loadAttempted = true;
+
+    final dllPath = path.join(path.dirname(Platform.resolvedExecutable), fileName);
+    if (!File(dllPath).existsSync()) {
+      LoggerService.warning('Нативный модуль не найден: $dllPath');
+      return null;
+    }
+    try {
+      _library = DynamicLibrary.open(dllPath);
+      LoggerService.info('Нативный модуль загружен: $dllPath');
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного модуля $dllPath', e);
+    }
+    return _library;
+  }
+}
@@ -0,0 +1,226 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Строка журнала: "2025-03-26 10:15:23.123 [INFO] сообщение"
+class LogLine {
+  final int number;
+  final String timestamp;
+  final String level;
+  final String message;
+
+  const LogLine(this.number, this.timestamp, this.level, this.message);
+
+  static LogLine parse(int number, String text) {
+    final open = text.indexOf(' [');
+    final close = open < 0 ? -1 : text.indexOf('] ', open);
+    if (close < 0) return LogLine(number, '', '', text);
+    return LogLine(number, text.substring(0, open), text.substring(open + 2, close),
+        text.substring(close + 2));
+  }
+
+  @override
+  String toString() => '[$timestamp] [$level] $message';
+}
+
+// Результат одного вызова поиска: номера найденных строк и номер, с
+// которого продолжать (равен lineCount, если журнал просмотрен до конца)
+class LogSearchResult {
+  final List<int> lines;
+  final int nextLine;
+
+  const LogSearchResult(this.lines, this.nextLine);
+}
+
+// Мост к нативному журналу (windivert_helper.dll): записи Dart и модулей
+// библиотеки пишутся в один файл app.log, отображенный в память, а
+// страница журнала копируется в переиспользуемый буфер - файл целиком в
+// Dart не читается
+class NativeLogBridge {
+  // Singleton pattern
+  static final NativeLogBridge _instance = NativeLogBridge._internal();
+  factory NativeLogBridge() => _instance;
+  NativeLogBridge._internal();
+
+  // Уровни log_helper.h
+  static const int levelDebug = 0;
+  static const int levelInfo = 1;
+  static const int levelWarning = 2;
+  static const int levelError = 3;
+
+  // Буфер страницы вмещает самую длинную строку журнала (4096 байт)
+  static const int _pageBufferSize = 256 * 1024;
+  static const int maxPageLines = 1024;
+  static const int maxSearchLines = 4096;
+  static const int allLevels = 0xF;
+
+  // Флаги границ времени поиска (LogSearchTimeBound в log_helper.h)
+  static const int _searchFrom = 1;
+  static const int _searchTo = 2;
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+  bool _open = false;
+
+  late int Function(Pointer<Utf8>) _openLog;
+  late void Function(int, Pointer<Uint8>, int) _write;
+  late int Function() _lineCount;
+  late int Function() _firstLine;
+  late int Function(int, int, Pointer<Uint8>, int, Pointer<Int32>, Pointer<Int64>) _read;
+  late int Function() _clear;
+  late int Function(int, int, int, int, Pointer<Utf8>, int, Pointer<Int64>, int, Pointer<Int64>)
+      _search;
+
+  // Буферы переиспользуются: запись и чтение страницы не выделяют память
+  Pointer<Uint8> _message = nullptr;
+  int _messageCapacity = 0;
+  Pointer<Uint8> _page = nullptr;
+  Pointer<Int32> _offsets = nullptr;
+  Pointer<Int64> _actualFirst = nullptr;
+  Pointer<Int64> _found = nullptr;
+  Pointer<Int64> _nextLine = nullptr;
+
+  bool get isAvailable => _ensureLoaded();
+
+  bool get isOpen => _open;
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _openLog = helper.lookupFunction<Int32 Function(Pointer<Utf8>), int Function(Pointer<Utf8>)>(
+          'NativeLogOpen');
+
+      _write = helper.lookupFunction<Void Function(Int32, Pointer<Uint8>, Int32),
+          void Function(int, Pointer<Uint8>, int)>('NativeLogWrite');
+
+      _lineCount = helper.lookupFunction<Int64 Function(), int Function()>('NativeLogLineCount');
+
+      _firstLine = helper.lookupFunction<Int64 Function(), int Function()>('NativeLogFirstLine');
+
+      _read = helper.lookupFunction<
+          Int32 Function(Int64, Int32, Pointer<Uint8>, Int32, Pointer<Int32>, Pointer<Int64>),
+          int Function(int, int, Pointer<Uint8>, int, Pointer<Int32>, Pointer<Int64>)>(
+          'NativeLogRead');
+
+      _clear = helper.lookupFunction<Int32 Function(), int Function()>('NativeLogClear');
+
+      _search = helper.lookupFunction<
+          Int32 Function(Int32, Int32, Int64, Int64, Pointer<Utf8>, Int64, Pointer<Int64>, Int32,
+              Pointer<Int64>),
+          int Function(int, int, int, int, Pointer<Utf8>, int, Pointer<Int64>, int,
+              Pointer<Int64>)>('NativeLogSearch');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного журнала', e);
+      return false;
+    }
+  }
+
+  // Открыть журнал в каталоге; файл прошлого запуска становится app.log.1
+  bool open(String directory) {
+    if (!_ensureLoaded()) return false;
+    if (_open) return true;
+
+    final directoryPtr = directory.toNativeUtf8();
+    try {
+      _open = _openLog(directoryPtr) == 1;
+      return _open;
+    } finally {
+      malloc.free(directoryPtr);
+    }
+  }
+
+  void write(int level, String message) {
+    if (!_open) return;
+    final bytes = utf8.encode(message);
+    if (bytes.length > _messageCapacity) {
+      if (_message != nullptr) malloc.free(_message);
+      _messageCapacity = bytes.length < 1024 ? 1024 : bytes.length;
+      _message = malloc<Uint8>(_messageCapacity);
+    }
+    _message.asTypedList(bytes.length).setAll(0, bytes);
+    _write(level, _message, bytes.length);
+  }
+
+  // Номер следующей строки сессии
+  int get lineCount => _open ? _lineCount() : 0;
+
+  // Первая строка, доступная для чтения (более ранние ушли при ротации)
+  int get firstLine => _open ? _firstLine() : 0;
+
+  // Строки с номера first, не больше count
+  List<LogLine> read(int first, int count) {
+    if (!_open || count <= 0) return const [];
+    if (count > maxPageLines) count = maxPageLines;
+    if (_page == nullptr) {
+      _page = malloc<Uint8>(_pageBufferSize);
+      _offsets = malloc<Int32>(maxPageLines + 1);
+      _actualFirst = malloc<Int64>();
+    }
+
+    final lines = _read(first, count, _page, _pageBufferSize, _offsets, _actualFirst);
+    if (lines <= 0) return const [];
+    final number = _actualFirst.value;
+    final offsets = _offsets.asTypedList(lines + 1);
+    final Uint8List bytes = _page.asTypedList(offsets[lines]);
+    final decoder = utf8.decoder;
+    return List<LogLine>.generate(lines, (i) {
+      // Без завершающего '\n'
+      final text = decoder.convert(bytes, offsets[i], offsets[i + 1] - 1);
+      return LogLine.parse(number + i, text);
+    });
+  }
+
+  // Поиск по индексу журнала с номера startLine: levels - маска уровней
+  // (1 << level), время записи в [from, to], text - подстрока сообщения без
+  // учета регистра. Один вызов ограничен по времени и может вернуть меньше
+  // count строк, не дойдя до конца журнала: продолжать с nextLine.
+  LogSearchResult search({
+    int levels = allLevels,
+    DateTime? from,
+    DateTime? to,
+    String text = '',
+    int startLine = 0,
+    int count = maxSearchLines,
+  }) {
+    if (!_open) return const LogSearchResult([], 0);
+    if (count > maxSearchLines) count = maxSearchLines;
+    if (_found == nullptr) {
+      _found = malloc<Int64>(maxSearchLines);
+      _nextLine = malloc<Int64>();
+    }
+
+    // Граница без значения не передается: ее флаг не ставится
+    final timeBounds = (from != null ? _searchFrom : 0) | (to != null ? _searchTo : 0);
+    final fromMs = from?.millisecondsSinceEpoch ?? 0;
+    final toMs = to?.millisecondsSinceEpoch ?? 0;
+    final textPtr = text.toNativeUtf8();
+    try {
+      final found = _search(
+          levels, timeBounds, fromMs, toMs, textPtr, startLine, _found, count, _nextLine);
+      final lines = found > 0 ? List<int>.of(_found.asTypedList(found)) : <int>[];
+      return LogSearchResult(lines, _nextLine.value);
+    } finally {
+      malloc.free(textPtr);
+    }
+  }
+
+  // Начать новый файл журнала
+  bool clear() {
+    if (!_open) return false;
+    return _clear() == 1;
+  }
+}
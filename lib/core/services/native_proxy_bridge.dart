@@ -0,0 +1,219 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Сглаженный пинг цели фонового замера (latency_prober.h)
+class NativeLatencyStats {
+  final Duration? smoothed; // null - удачных замеров еще не было
+  final Duration? jitter;
+  final Duration? last;
+  final int failures; // неудачных замеров подряд
+
+  NativeLatencyStats({
+    required this.smoothed,
+    required this.jitter,
+    required this.last,
+    required this.failures,
+  });
+
+  bool get reachable => smoothed != null && failures == 0;
+}
+
+// Мост к встроенному сетевому стеку (windivert_helper.dll): SOCKS5/HTTP
+// CONNECT прокси в процессе, который соединяется с назначением напрямую
+// или стоит перед ядром VPN и выбирает маршрут по профилю, считая
+// реальные байты для GetTrafficStats, fake-IP DNS для имен,
+// уходящих в прокси, и фоновый замер пинга
+class NativeProxyBridge {
+  // Singleton pattern
+  static final NativeProxyBridge _instance = NativeProxyBridge._internal();
+  factory NativeProxyBridge() => _instance;
+  NativeProxyBridge._internal();
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+  bool _proxyRunning = false;
+  bool _fakeDnsRunning = false;
+
+  late int Function(int, int) _startLocalProxy;
+  late int Function(int, int, int) _startRoutingProxy;
+  late int Function() _stopLocalProxy;
+  late int Function(int, Pointer<Utf8>) _startFakeDns;
+  late int Function() _stopFakeDns;
+  late int Function(Pointer<Utf8>, Pointer<Utf8>, int) _fakeIpToDomain;
+  late int Function(Pointer<Utf8>, int) _addLatencyTarget;
+  late int Function(int) _removeLatencyTarget;
+  late int Function(int, Pointer<Int32>, Pointer<Int32>, Pointer<Int32>, Pointer<Int32>)
+      _getLatencyStats;
+
+  bool get isAvailable => _ensureLoaded();
+  bool get isProxyRunning => _proxyRunning;
+  bool get isFakeDnsRunning => _fakeDnsRunning;
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _startLocalProxy = helper.lookupFunction<Int32 Function(Int32, Int32), int Function(int, int)>(
+          'StartLocalProxy');
+      _startRoutingProxy = helper.lookupFunction<Int32 Function(Int32, Int32, Int32),
+          int Function(int, int, int)>('StartRoutingProxy');
+      _stopLocalProxy = helper.lookupFunction<Int32 Function(), int Function()>('StopLocalProxy');
+      _startFakeDns = helper.lookupFunction<Int32 Function(Int32, Pointer<Utf8>),
+          int Function(int, Pointer<Utf8>)>('StartFakeDns');
+      _stopFakeDns = helper.lookupFunction<Int32 Function(), int Function()>('StopFakeDns');
+      _fakeIpToDomain = helper.lookupFunction<Int32 Function(Pointer<Utf8>, Pointer<Utf8>, Int32),
+          int Function(Pointer<Utf8>, Pointer<Utf8>, int)>('FakeIpToDomain');
+      _addLatencyTarget = helper.lookupFunction<Int32 Function(Pointer<Utf8>, Int32),
+          int Function(Pointer<Utf8>, int)>('AddLatencyTarget');
+      _removeLatencyTarget =
+          helper.lookupFunction<Int32 Function(Int32), int Function(int)>('RemoveLatencyTarget');
+      _getLatencyStats = helper.lookupFunction<
+          Int32 Function(Int32, Pointer<Int32>, Pointer<Int32>, Pointer<Int32>, Pointer<Int32>),
+          int Function(int, Pointer<Int32>, Pointer<Int32>, Pointer<Int32>,
+              Pointer<Int32>)>('GetLatencyStats');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки встроенного прокси', e);
+      return false;
+    }
+  }
+
+  // Запустить прокси на 127.0.0.1:port. workers = 0 - по потоку на ядро.
+  // Повторный запуск при работающем прокси ничего не меняет. Прокси без
+  // аутентификации соединяется напрямую, мимо VPN, поэтому при подключении
+  // запускается не он, а startRoutingProxy.
+  bool startLocalProxy(int port, {int workers = 0}) {
+    if (!_ensureLoaded()) return false;
+
+    if (_startLocalProxy(port, workers) != 1) {
+      LoggerService.error('Не удалось запустить встроенный прокси на порту $port');
+      return false;
+    }
+    _proxyRunning = true;
+    LoggerService.info('Встроенный прокси запущен на 127.0.0.1:$port');
+    return true;
+  }
+
+  // Запустить прокси перед ядром VPN на 127.0.0.1:port: каждое соединение
+  // получает действие текущего профиля нативного движка правил, block
+  // отклоняется, direct идет напрямую, остальное - в SOCKS5 ядра на
+  // upstreamPort. Новый профиль действует на новые соединения сразу.
+  bool startRoutingProxy(int port, {required int upstreamPort, int workers = 0}) {
+    if (!_ensureLoaded()) return false;
+
+    if (_startRoutingProxy(port, upstreamPort, workers) != 1) {
+      LoggerService.error('Не удалось запустить прокси маршрутизации на порту $port');
+      return false;
+    }
+    _proxyRunning = true;
+    LoggerService.info('Прокси маршрутизации запущен на 127.0.0.1:$port -> $upstreamPort');
+    return true;
+  }
+
+  void stopLocalProxy() {
+    if (!_proxyRunning || !_ensureLoaded()) return;
+
+    _stopLocalProxy();
+    _proxyRunning = false;
+    LoggerService.info('Встроенный прокси остановлен');
+  }
+
+  // Запустить fake-IP DNS на 127.0.0.1:port: имена, уходящие в прокси,
+  // получают адрес из 198.18.0.0/15 без обращения к DNS, остальные
+  // запросы пересылаются upstream (null - 8.8.8.8). Запросы на этот порт
+  // должен направить вызывающий: при подключении VPN сервер не запускается,
+  // системный DNS на него не указывает.
+  bool startFakeDns(int port, {String? upstream}) {
+    if (!_ensureLoaded()) return false;
+
+    final upstreamPtr = upstream != null ? upstream.toNativeUtf8() : nullptr;
+    try {
+      if (_startFakeDns(port, upstreamPtr) != 1) {
+        LoggerService.error('Не удалось запустить fake-IP DNS на порту $port');
+        return false;
+      }
+    } finally {
+      if (upstreamPtr != nullptr) malloc.free(upstreamPtr);
+    }
+    _fakeDnsRunning = true;
+    LoggerService.info('Fake-IP DNS запущен на 127.0.0.1:$port');
+    return true;
+  }
+
+  void stopFakeDns() {
+    if (!_fakeDnsRunning || !_ensureLoaded()) return;
+
+    _stopFakeDns();
+    _fakeDnsRunning = false;
+    LoggerService.info('Fake-IP DNS остановлен');
+  }
+
+  // Имя, которому fake-IP DNS выдал адрес; null - адрес не фиктивный или
+  // уже вытеснен из таблицы
+  String? fakeIpToDomain(String address) {
+    if (!_ensureLoaded()) return null;
+
+    const capacity = 256;
+    final addressPtr = address.toNativeUtf8();
+    final domainPtr = calloc<Uint8>(capacity).cast<Utf8>();
+    try {
+      final length = _fakeIpToDomain(addressPtr, domainPtr, capacity);
+      return length > 0 ? domainPtr.toDartString(length: length) : null;
+    } finally {
+      malloc.free(addressPtr);
+      calloc.free(domainPtr);
+    }
+  }
+
+  // Добавить сервер (IP или имя) в фоновый замер пинга. Первый замер идет
+  // сразу, дальше - раз в 10 секунд. Возвращает номер цели или null.
+  int? addLatencyTarget(String host, int port) {
+    if (!_ensureLoaded()) return null;
+
+    final hostPtr = host.toNativeUtf8();
+    try {
+      final id = _addLatencyTarget(hostPtr, port);
+      return id >= 0 ? id : null;
+    } finally {
+      malloc.free(hostPtr);
+    }
+  }
+
+  void removeLatencyTarget(int id) {
+    if (!_ensureLoaded()) return;
+    _removeLatencyTarget(id);
+  }
+
+  // Последние сглаженные значения без ожидания замера; null - замеров
+  // еще не было
+  NativeLatencyStats? latencyStats(int id) {
+    if (!_ensureLoaded()) return null;
+
+    final values = calloc<Int32>(4);
+    try {
+      if (_getLatencyStats(id, values, values + 1, values + 2, values + 3) != 1) {
+        return null;
+      }
+      Duration? milliseconds(int value) => value >= 0 ? Duration(milliseconds: value) : null;
+      return NativeLatencyStats(
+        smoothed: milliseconds(values[0]),
+        jitter: milliseconds(values[1]),
+        last: milliseconds(values[2]),
+        failures: values[3],
+      );
+    } finally {
+      calloc.free(values);
+    }
+  }
+}
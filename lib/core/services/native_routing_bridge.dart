@@ -0,0 +1,156 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Мост к нативному движку маршрутизации (windivert_helper.dll)
+class NativeRoutingBridge {
+  // Singleton pattern
+  static final NativeRoutingBridge _instance = NativeRoutingBridge._internal();
+  factory NativeRoutingBridge() => _instance;
+  NativeRoutingBridge._internal();
+
+  // Коды действий, возвращаемые нативной стороной
+  static const List<String?> _actions = [null, 'proxy', 'direct', 'block'];
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+
+  late int Function(Pointer<Utf8>, Pointer<Utf8>) _loadGeosite;
+  late int Function(Pointer<Utf8>, Pointer<Utf8>) _loadGeoip;
+  late int Function(Pointer<Utf8>) _compileProfile;
+  late int Function(Pointer<Utf8>) _matchDomain;
+  late int Function(Pointer<Utf8>, int, int, Pointer<Utf8>, Pointer<Utf8>) _evaluate;
+
+  // Маска протоколов для evaluate()
+  static const Map<String, int> protocolBits = {
+    'tcp': 1,
+    'udp': 2,
+    'http': 4,
+    'tls': 8,
+    'quic': 16,
+    'bittorrent': 32,
+  };
+
+  bool get isAvailable => _ensureLoaded();
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _loadGeosite = helper
+          .lookupFunction<Int32 Function(Pointer<Utf8>, Pointer<Utf8>),
+              int Function(Pointer<Utf8>, Pointer<Utf8>)>('RoutingLoadGeosite');
+
+      _loadGeoip = helper
+          .lookupFunction<Int32 Function(Pointer<Utf8>, Pointer<Utf8>),
+              int Function(Pointer<Utf8>, Pointer<Utf8>)>('RoutingLoadGeoip');
+
+      _compileProfile = helper
+          .lookupFunction<Int32 Function(Pointer<Utf8>),
+              int Function(Pointer<Utf8>)>('RoutingCompileProfile');
+
+      _matchDomain = helper
+          .lookupFunction<Int32 Function(Pointer<Utf8>),
+              int Function(Pointer<Utf8>)>('RoutingMatchDomain');
+
+      _evaluate = helper
+          .lookupFunction<
+              Int32 Function(Pointer<Utf8>, Int32, Int32, Pointer<Utf8>, Pointer<Utf8>),
+              int Function(Pointer<Utf8>, int, int, Pointer<Utf8>,
+                  Pointer<Utf8>)>('RoutingEvaluate');
+
+      _helper = helper;
+      LoggerService.info('Нативный движок маршрутизации загружен');
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного движка маршрутизации', e);
+      return false;
+    }
+  }
+
+  // Зарегистрировать файл категории geosite (формат domain-list-community)
+  bool loadGeosite(String category, String filePath) {
+    if (!_ensureLoaded()) return false;
+
+    final categoryPtr = category.toNativeUtf8();
+    final pathPtr = filePath.toNativeUtf8();
+    try {
+      return _loadGeosite(categoryPtr, pathPtr) == 1;
+    } finally {
+      malloc.free(categoryPtr);
+      malloc.free(pathPtr);
+    }
+  }
+
+  // Зарегистрировать файл категории geoip (CIDR по одному в строке)
+  bool loadGeoip(String category, String filePath) {
+    if (!_ensureLoaded()) return false;
+
+    final categoryPtr = category.toNativeUtf8();
+    final pathPtr = filePath.toNativeUtf8();
+    try {
+      return _loadGeoip(categoryPtr, pathPtr) == 1;
+    } finally {
+      malloc.free(categoryPtr);
+      malloc.free(pathPtr);
+    }
+  }
+
+  // Скомпилировать профиль (JSON RoutingProfile.toJson()). Порядок правил задает приоритет.
+  bool compileProfile(String profileJson) {
+    if (!_ensureLoaded()) return false;
+
+    final jsonPtr = profileJson.toNativeUtf8();
+    try {
+      return _compileProfile(jsonPtr) == 1;
+    } finally {
+      malloc.free(jsonPtr);
+    }
+  }
+
+  // Действие первого совпавшего доменного правила или null
+  String? matchDomain(String domain) {
+    if (!_ensureLoaded()) return null;
+
+    final domainPtr = domain.toNativeUtf8();
+    try {
+      final code = _matchDomain(domainPtr);
+      return (code >= 0 && code < _actions.length) ? _actions[code] : null;
+    } finally {
+      malloc.free(domainPtr);
+    }
+  }
+
+  // Действие профиля для соединения или null, если ни одно правило не сработало
+  String? evaluate({
+    String? address,
+    int port = 0,
+    List<String> protocols = const [],
+    String? domain,
+    String? process,
+  }) {
+    if (!_ensureLoaded()) return null;
+
+    final protocolMask = protocols.fold<int>(
+        0, (mask, protocol) => mask | (protocolBits[protocol] ?? 0));
+    final addressPtr = address != null ? address.toNativeUtf8() : nullptr;
+    final domainPtr = domain != null ? domain.toNativeUtf8() : nullptr;
+    final processPtr = process != null ? process.toNativeUtf8() : nullptr;
+    try {
+      final code = _evaluate(addressPtr, port, protocolMask, domainPtr, processPtr);
+      return (code >= 0 && code < _actions.length) ? _actions[code] : null;
+    } finally {
+      if (addressPtr != nullptr) malloc.free(addressPtr);
+      if (domainPtr != nullptr) malloc.free(domainPtr);
+      if (processPtr != nullptr) malloc.free(processPtr);
+    }
+  }
+}
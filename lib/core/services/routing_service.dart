@@ -7,6 +7,7 @@ import 'package:path_provider/path_provider.dart';
 
 import '../constants/app_constants.dart';
 import 'logger_service.dart';
+import 'native_routing_bridge.dart';
 
 class RouteRule {
   final String type; // 'domain', 'ip', 'port', 'process', 'protocol'
@@ -243,9 +244,16 @@ class RoutingService {
   final _routingChangedController = StreamController<RoutingProfile>.broadcast();
   Stream<RoutingProfile> get onRoutingChanged => _routingChangedController.stream;
   
+  // Текущий профиль скомпилирован и опубликован в нативном движке правил
+  bool _isNativeRoutingActive = false;
+  
+  // Категории geosite:/geoip:, уже переданные нативному движку
+  final Set<String> _loadedGeoCategories = {};
+  
   // Getters
   RoutingProfile get currentProfile => _currentProfile;
   List<RoutingProfile> get savedProfiles => _savedProfiles;
+  bool get isNativeRoutingActive => _isNativeRoutingActive;
   
   // Initialize the routing service
   Future<void> initialize() async {
@@ -258,6 +266,9 @@ class RoutingService {
       // Load last used profile
       await _loadCurrentProfile();
       
+      // Compile the profile in the native rule engine
+      _syncNativeRules();
+      
       LoggerService.info('Сервис маршрутизации инициализирован с профилем: ${_currentProfile.name}');
     } catch (e) {
       LoggerService.error('Ошибка инициализации сервиса маршрутизации', e);
@@ -375,6 +386,7 @@ class RoutingService {
   // Set current routing profile
   Future<void> setCurrentProfile(RoutingProfile profile) async {
     _currentProfile = profile;
+    _syncNativeRules();
     await _saveCurrentProfile();
     _routingChangedController.add(profile);
     LoggerService.info('Установлен текущий профиль маршрутизации: ${profile.name}');
@@ -539,6 +551,72 @@ class RoutingService {
     }
   }
 
+  // Скомпилировать текущий профиль в нативном движке правил
+  void _syncNativeRules() {
+    final bridge = NativeRoutingBridge();
+    if (!bridge.isAvailable) {
+      _isNativeRoutingActive = false;
+      return;
+    }
+    
+    _loadGeoCategories(bridge);
+    _isNativeRoutingActive = bridge.compileProfile(jsonEncode(_currentProfile.toJson()));
+    if (!_isNativeRoutingActive) {
+      LoggerService.warning('Не удалось скомпилировать профиль маршрутизации');
+    }
+  }
+
+  // Загрузить категории geosite:/geoip: профиля из geosite.dat и geoip.dat
+  // V2Ray; без них такие правила компилируются пустыми
+  void _loadGeoCategories(NativeRoutingBridge bridge) {
+    final assetDir = path.join(path.dirname(Platform.resolvedExecutable), 'bin', 'v2ray');
+    
+    for (final rule in _currentProfile.rules) {
+      final separator = rule.value.indexOf(':');
+      if (separator <= 0) continue;
+      final kind = rule.value.substring(0, separator);
+      if (kind != 'geosite' && kind != 'geoip') continue;
+      // Каждая категория читается один раз, даже если ее нет в файле
+      if (!_loadedGeoCategories.add(rule.value)) continue;
+      
+      final category = rule.value.substring(separator + 1);
+      final file = path.join(assetDir, '$kind.dat');
+      if (!File(file).existsSync()) {
+        LoggerService.warning('Файл $file не найден, правило ${rule.value} не сработает');
+        continue;
+      }
+      
+      final loaded = kind == 'geosite'
+          ? bridge.loadGeosite(category, file)
+          : bridge.loadGeoip(category, file);
+      if (!loaded) {
+        LoggerService.warning('Категория ${rule.value} не загружена из $file');
+      }
+    }
+  }
+
+  // Действие, которое применится к домену (null - ни одно доменное правило не совпало)
+  String? previewDomainAction(String domain) {
+    return NativeRoutingBridge().matchDomain(domain);
+  }
+
+  // Действие, которое профиль применит к соединению (null - нативный движок недоступен)
+  String? previewAction({
+    String? address,
+    int port = 0,
+    List<String> protocols = const [],
+    String? domain,
+    String? process,
+  }) {
+    return NativeRoutingBridge().evaluate(
+      address: address,
+      port: port,
+      protocols: protocols,
+      domain: domain,
+      process: process,
+    );
+  }
+
   // Generate V2Ray routing configuration
   Map<String, dynamic> generateV2RayRouting() {
     final rules = <Map<String, dynamic>>[];
@@ -0,0 +1,198 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+import '../../data/models/vpn_config.dart';
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Результат оценки сервера нативной стороной
+class RankedServer {
+  final VpnConfig config;
+  final bool reachable;
+  final int score; // меньше - лучше
+  final Duration connectTime;
+  final Duration jitter;
+  final Duration? tlsTime;
+  final int successes;
+  final int attempts;
+
+  RankedServer({
+    required this.config,
+    required this.reachable,
+    required this.score,
+    required this.connectTime,
+    required this.jitter,
+    required this.tlsTime,
+    required this.successes,
+    required this.attempts,
+  });
+}
+
+// Мост к нативной оценке серверов (windivert_helper.dll): все серверы
+// подписки проверяются параллельно в одном нативном потоке
+class ServerRankingBridge {
+  // Singleton pattern
+  static final ServerRankingBridge _instance = ServerRankingBridge._internal();
+  factory ServerRankingBridge() => _instance;
+  ServerRankingBridge._internal();
+
+  // Раскладка записи результата (ranking_helper.h)
+  static const int _recordFields = 7;
+  static const int _index = 0;
+  static const int _score = 1;
+  static const int _connect = 2;
+  static const int _jitter = 3;
+  static const int _tls = 4;
+  static const int _successes = 5;
+  static const int _attempts = 6;
+
+  static const Duration _pollInterval = Duration(milliseconds: 100);
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+
+  late int Function(Pointer<Utf8>, int, int, int, Pointer<Void>) _start;
+  late int Function() _cancel;
+  late int Function(Pointer<Int32>, Pointer<Int32>) _progress;
+  late int Function(Pointer<Int32>, int) _results;
+
+  bool get isAvailable => _ensureLoaded();
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _start = helper.lookupFunction<
+          Int32 Function(Pointer<Utf8>, Int32, Int32, Int32, Pointer<Void>),
+          int Function(Pointer<Utf8>, int, int, int, Pointer<Void>)>('RankServersStart');
+
+      _cancel = helper.lookupFunction<Int32 Function(), int Function()>('RankServersCancel');
+
+      _progress = helper.lookupFunction<Int32 Function(Pointer<Int32>, Pointer<Int32>),
+          int Function(Pointer<Int32>, Pointer<Int32>)>('RankServersProgress');
+
+      _results = helper.lookupFunction<Int32 Function(Pointer<Int32>, Int32),
+          int Function(Pointer<Int32>, int)>('RankServersResults');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативной оценки серверов', e);
+      return false;
+    }
+  }
+
+  // Оценить серверы. Поток выдает отсортированный (лучшие первыми) список
+  // готовых результатов по мере их появления и закрывается по завершении.
+  // Отмена подписки прерывает оценку.
+  Stream<List<RankedServer>> rank(
+    List<VpnConfig> configs, {
+    int maxInFlight = 64,
+    int attempts = 3,
+    Duration timeout = const Duration(milliseconds: 1500),
+  }) {
+    late StreamController<List<RankedServer>> controller;
+    Timer? timer;
+
+    void stop() {
+      timer?.cancel();
+      timer = null;
+    }
+
+    controller = StreamController<List<RankedServer>>(
+      onListen: () {
+        if (configs.isEmpty) {
+          controller.add(const []);
+          controller.close();
+          return;
+        }
+        if (!_ensureLoaded() || !_startRanking(configs, maxInFlight, attempts, timeout)) {
+          controller.addError(StateError('Оценка серверов недоступна'));
+          controller.close();
+          return;
+        }
+
+        var reported = 0;
+        timer = Timer.periodic(_pollInterval, (_) {
+          final progress = calloc<Int32>(2);
+          try {
+            final running = _progress(progress, progress + 1) == 1;
+            final completed = progress[0];
+            if (completed != reported || !running) {
+              reported = completed;
+              controller.add(_readResults(configs));
+            }
+            if (!running) {
+              stop();
+              controller.close();
+            }
+          } finally {
+            calloc.free(progress);
+          }
+        });
+      },
+      onCancel: () {
+        if (timer != null) {
+          stop();
+          _cancel();
+        }
+      },
+    );
+    return controller.stream;
+  }
+
+  bool _startRanking(
+      List<VpnConfig> configs, int maxInFlight, int attempts, Duration timeout) {
+    final targets = configs.map((config) {
+      final security = config.params['security'];
+      return {
+        'address': config.address,
+        'port': config.port,
+        'tls': security == 'tls' || security == 'reality',
+        'sni': config.params['sni'] ?? '',
+      };
+    }).toList();
+
+    final jsonPtr = jsonEncode(targets).toNativeUtf8();
+    try {
+      return _start(jsonPtr, maxInFlight, attempts, timeout.inMilliseconds, nullptr) == 1;
+    } finally {
+      malloc.free(jsonPtr);
+    }
+  }
+
+  List<RankedServer> _readResults(List<VpnConfig> configs) {
+    final records = calloc<Int32>(configs.length * _recordFields);
+    try {
+      final count = _results(records, configs.length);
+      final ranked = <RankedServer>[];
+      for (var i = 0; i < count; i++) {
+        final record = records + i * _recordFields;
+        final index = record[_index];
+        if (index < 0 || index >= configs.length) continue;
+        final tls = record[_tls];
+        ranked.add(RankedServer(
+          config: configs[index],
+          reachable: record[_score] >= 0,
+          score: record[_score],
+          connectTime: Duration(microseconds: record[_connect]),
+          jitter: Duration(microseconds: record[_jitter]),
+          tlsTime: tls > 0 ? Duration(microseconds: tls) : null,
+          successes: record[_successes],
+          attempts: record[_attempts],
+        ));
+      }
+      return ranked;
+    } finally {
+      calloc.free(records);
+    }
+  }
+}
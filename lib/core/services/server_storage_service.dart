@@ -3,20 +3,46 @@ import 'dart:io';
 import 'package:path_provider/path_provider.dart';
 import '../../data/models/vpn_config.dart';
 import 'logger_service.dart';
+import 'server_store_bridge.dart';
 
+// Список серверов хранится в нативном хранилище (servers.db и журнал
+// servers.log, Windows), а если оно недоступно или в списке есть протокол,
+// который оно не сохраняет, - в servers.json. При переходе на хранилище
+// servers.json переименовывается в servers.json.bak.
 class ServerStorageService {
   static const String _fileName = 'servers.json';
+  static const String _migratedFileName = 'servers.json.bak';
+
+  // Список сейчас в хранилище: вставку и удаление можно писать в журнал
+  static bool _storeActive = false;
   
   // Сохранение списка серверов
   static Future<void> saveServers(List<VpnConfig> servers) async {
     try {
       final directory = await _getStorageDirectory();
+      final store = _openStore(directory);
+
+      if (store != null && ServerStoreBridge.canStore(servers)) {
+        if (store.replace(servers)) {
+          _storeActive = true;
+          await _retireJson(directory);
+          LoggerService.info('Серверы сохранены в хранилище (${servers.length} шт.)');
+          return;
+        }
+        LoggerService.warning('Не удалось сохранить серверы в хранилище, используем $_fileName');
+      }
+
       final file = File('${directory.path}/$_fileName');
       
       final jsonData = servers.map((server) => server.toJson()).toList();
       final jsonString = jsonEncode(jsonData);
       
       await file.writeAsString(jsonString);
+      // Пустое хранилище - при загрузке список берется из servers.json
+      if (store != null && _storeActive) {
+        store.replace(const []);
+      }
+      _storeActive = false;
       LoggerService.info('Серверы успешно сохранены в $_fileName (${servers.length} шт.)');
     } catch (e) {
       LoggerService.error('Ошибка при сохранении серверов', e);
@@ -28,9 +54,20 @@ class ServerStorageService {
   static Future<List<VpnConfig>> loadServers() async {
     try {
       final directory = await _getStorageDirectory();
+      final store = _openStore(directory);
+      if (store != null) {
+        final stored = store.load();
+        if (stored.isNotEmpty) {
+          _storeActive = true;
+          LoggerService.info('Загружено ${stored.length} серверов из хранилища');
+          return stored;
+        }
+      }
+
       final file = File('${directory.path}/$_fileName');
       
       if (!await file.exists()) {
+        _storeActive = store != null;
         LoggerService.info('Файл $_fileName не найден. Возвращаем пустой список.');
         return [];
       }
@@ -43,6 +80,14 @@ class ServerStorageService {
           .toList();
       
       LoggerService.info('Загружено ${servers.length} серверов из $_fileName');
+
+      // Перенос в хранилище
+      _storeActive = false;
+      if (store != null && ServerStoreBridge.canStore(servers) && store.replace(servers)) {
+        _storeActive = true;
+        await _retireJson(directory);
+        LoggerService.info('Серверы перенесены из $_fileName в хранилище');
+      }
       return servers;
     } catch (e) {
       LoggerService.error('Ошибка при загрузке серверов', e);
@@ -60,9 +105,48 @@ class ServerStorageService {
     
     final server = servers[index];
     servers.removeAt(index);
-    await saveServers(servers);
+    if (!_storeActive || !ServerStoreBridge().remove(index, 1)) {
+      await saveServers(servers);
+    }
     LoggerService.info('Удален сервер: ${server.displayName}');
   }
+
+  // Вставка серверов configs в список перед позицией index
+  static Future<void> insertServers(
+      List<VpnConfig> servers, int index, List<VpnConfig> configs) async {
+    if (index < 0 || index > servers.length) {
+      LoggerService.warning('Попытка вставить серверы с недопустимым индексом: $index');
+      return;
+    }
+
+    servers.insertAll(index, configs);
+    if (!_storeActive ||
+        !ServerStoreBridge.canStore(configs) ||
+        !ServerStoreBridge().insert(index, configs)) {
+      await saveServers(servers);
+    }
+    LoggerService.info('Добавлено серверов: ${configs.length}');
+  }
+
+  // Хранилище серверов в каталоге данных или null, если оно недоступно
+  static ServerStoreBridge? _openStore(Directory directory) {
+    final store = ServerStoreBridge();
+    if (!store.isAvailable) return null;
+    if (!store.open(directory.path)) {
+      LoggerService.warning('Хранилище серверов не открылось, используем $_fileName');
+      return null;
+    }
+    return store;
+  }
+
+  // Убрать servers.json после переноса списка в хранилище, чтобы он не
+  // подменил список, когда хранилище опустеет
+  static Future<void> _retireJson(Directory directory) async {
+    final file = File('${directory.path}/$_fileName');
+    if (await file.exists()) {
+      await file.rename('${directory.path}/$_migratedFileName');
+    }
+  }
   
   // Получение директории для хранения данных
   static Future<Directory> _getStorageDirectory() async {
@@ -0,0 +1,122 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+import '../../data/models/vpn_config.dart';
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+import 'subscription_parser_bridge.dart';
+
+// Мост к нативному хранилищу серверов (windivert_helper.dll): снимок
+// servers.db отображается в память и читается без разбора JSON, а
+// вставка и удаление дописываются в журнал, не переписывая весь список
+class ServerStoreBridge {
+  // Singleton pattern
+  static final ServerStoreBridge _instance = ServerStoreBridge._internal();
+  factory ServerStoreBridge() => _instance;
+  ServerStoreBridge._internal();
+
+  // Протоколы, которые хранилище сохраняет номером (server_store_helper.h)
+  static const Set<String> _protocols = {'vless', 'vmess', 'trojan', 'ss'};
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+  String? _directory;
+
+  late int Function(Pointer<Utf8>) _open;
+  late Pointer<Int32> Function() _view;
+  late int Function(int, Pointer<Utf8>) _insert;
+  late int Function(int, int) _remove;
+  late int Function(Pointer<Utf8>) _replace;
+
+  bool get isAvailable => _ensureLoaded();
+
+  // Можно ли сохранить серверы в хранилище без потерь
+  static bool canStore(Iterable<VpnConfig> servers) =>
+      servers.every((server) => _protocols.contains(server.protocol));
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _open = helper.lookupFunction<Int32 Function(Pointer<Utf8>), int Function(Pointer<Utf8>)>(
+          'ServerStoreOpen');
+
+      _view = helper.lookupFunction<Pointer<Int32> Function(), Pointer<Int32> Function()>(
+          'ServerStoreView');
+
+      _insert = helper.lookupFunction<Int32 Function(Int32, Pointer<Utf8>),
+          int Function(int, Pointer<Utf8>)>('ServerStoreInsert');
+
+      _remove = helper.lookupFunction<Int32 Function(Int32, Int32), int Function(int, int)>(
+          'ServerStoreRemove');
+
+      _replace = helper.lookupFunction<Int32 Function(Pointer<Utf8>),
+          int Function(Pointer<Utf8>)>('ServerStoreReplace');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного хранилища серверов', e);
+      return false;
+    }
+  }
+
+  // Открыть хранилище в каталоге (повторный вызов с тем же каталогом - no-op)
+  bool open(String directory) {
+    if (!_ensureLoaded()) return false;
+    if (_directory == directory) return true;
+
+    final directoryPtr = directory.toNativeUtf8();
+    try {
+      if (_open(directoryPtr) != 1) {
+        _directory = null;
+        return false;
+      }
+      _directory = directory;
+      return true;
+    } finally {
+      malloc.free(directoryPtr);
+    }
+  }
+
+  bool get isOpen => _directory != null;
+
+  // Текущий список серверов
+  List<VpnConfig> load() {
+    if (!isOpen) return const [];
+    return SubscriptionParserBridge.readBlock(_view()).configs;
+  }
+
+  // Вставить серверы перед позицией position
+  bool insert(int position, List<VpnConfig> servers) {
+    if (!isOpen) return false;
+    return _withJson(servers, (json) => _insert(position, json) == 1);
+  }
+
+  bool remove(int position, int count) {
+    if (!isOpen) return false;
+    return _remove(position, count) == 1;
+  }
+
+  // Заменить список целиком
+  bool replace(List<VpnConfig> servers) {
+    if (!isOpen) return false;
+    return _withJson(servers, (json) => _replace(json) == 1);
+  }
+
+  bool _withJson(List<VpnConfig> servers, bool Function(Pointer<Utf8>) call) {
+    final jsonPtr = jsonEncode(servers.map((server) => server.toJson()).toList()).toNativeUtf8();
+    try {
+      return call(jsonPtr);
+    } finally {
+      malloc.free(jsonPtr);
+    }
+  }
+}
@@ -0,0 +1,162 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+
+import '../../data/models/vpn_config.dart';
+import 'logger_service.dart';
+import 'native_helper_library.dart';
+
+// Результат нативного разбора подписки
+class ParsedSubscription {
+  final List<VpnConfig> configs;
+  final int skippedLines; // непустые строки, из которых не вышло сервера
+
+  ParsedSubscription(this.configs, this.skippedLines);
+}
+
+// Мост к нативному разбору подписок (windivert_helper.dll): тело ответа
+// передается фрагментами по мере загрузки, декодирование base64 и разбор
+// ссылок идут в нативном коде, результат забирается одним блоком
+class SubscriptionParserBridge {
+  // Singleton pattern
+  static final SubscriptionParserBridge _instance = SubscriptionParserBridge._internal();
+  factory SubscriptionParserBridge() => _instance;
+  SubscriptionParserBridge._internal();
+
+  // Раскладка блока результата (subscription_helper.h)
+  static const int _headerFields = 4;
+  static const int _entries = 0;
+  static const int _params = 1;
+  static const int _text = 2;
+  static const int _skipped = 3;
+
+  static const int _recordFields = 10;
+  static const int _protocol = 0;
+  static const int _port = 1;
+  static const int _idOffset = 2;
+  static const int _idLength = 3;
+  static const int _addressOffset = 4;
+  static const int _addressLength = 5;
+  static const int _tagOffset = 6;
+  static const int _tagLength = 7;
+  static const int _firstParam = 8;
+  static const int _paramCount = 9;
+
+  static const List<String> _protocols = ['vless', 'vmess', 'trojan', 'ss'];
+
+  DynamicLibrary? _helper;
+  bool _loadAttempted = false;
+
+  late Pointer<Void> Function() _create;
+  late int Function(Pointer<Void>, Pointer<Uint8>, int) _feed;
+  late Pointer<Int32> Function(Pointer<Void>) _finish;
+  late void Function(Pointer<Void>) _destroy;
+
+  bool get isAvailable => _ensureLoaded();
+
+  // Функции helper DLL (однократно, при первом обращении)
+  bool _ensureLoaded() {
+    if (_helper != null) return true;
+    if (_loadAttempted) return false;
+    _loadAttempted = true;
+
+    final helper = NativeHelperLibrary.open();
+    if (helper == null) return false;
+
+    try {
+      _create = helper.lookupFunction<Pointer<Void> Function(), Pointer<Void> Function()>(
+          'SubscriptionParserCreate');
+
+      _feed = helper.lookupFunction<Int32 Function(Pointer<Void>, Pointer<Uint8>, Int32),
+          int Function(Pointer<Void>, Pointer<Uint8>, int)>('SubscriptionParserFeed');
+
+      _finish = helper.lookupFunction<Pointer<Int32> Function(Pointer<Void>),
+          Pointer<Int32> Function(Pointer<Void>)>('SubscriptionParserFinish');
+
+      _destroy = helper.lookupFunction<Void Function(Pointer<Void>),
+          void Function(Pointer<Void>)>('SubscriptionParserDestroy');
+
+      _helper = helper;
+      return true;
+    } catch (e) {
+      LoggerService.error('Ошибка загрузки нативного разбора подписок', e);
+      return false;
+    }
+  }
+
+  // Разобрать тело ответа по мере получения
+  Future<ParsedSubscription> parseStream(Stream<List<int>> body) async {
+    if (!_ensureLoaded()) {
+      throw StateError('Нативный разбор подписок недоступен');
+    }
+    final parser = _create();
+    if (parser == nullptr) {
+      throw StateError('Не удалось начать разбор подписки');
+    }
+
+    Pointer<Uint8> buffer = nullptr;
+    var capacity = 0;
+    try {
+      await for (final chunk in body) {
+        if (chunk.isEmpty) continue;
+        if (chunk.length > capacity) {
+          if (buffer != nullptr) malloc.free(buffer);
+          capacity = chunk.length;
+          buffer = malloc<Uint8>(capacity);
+        }
+        buffer.asTypedList(chunk.length).setAll(0, chunk);
+        _feed(parser, buffer, chunk.length);
+      }
+      return readBlock(_finish(parser));
+    } finally {
+      if (buffer != nullptr) malloc.free(buffer);
+      _destroy(parser);
+    }
+  }
+
+  // Прочитать блок серверов; той же раскладкой отдает список и хранилище
+  // серверов (server_store_helper.h)
+  static ParsedSubscription readBlock(Pointer<Int32> result) {
+    if (result == nullptr) {
+      return ParsedSubscription(const [], 0);
+    }
+    final header = result.asTypedList(_headerFields);
+    final count = header[_entries];
+    final paramPairs = header[_params];
+
+    final records = (result + _headerFields).asTypedList(count * _recordFields);
+    final spans = (result + _headerFields + count * _recordFields).asTypedList(paramPairs * 4);
+    final text = (result + _headerFields + count * _recordFields + paramPairs * 4)
+        .cast<Uint8>()
+        .asTypedList(header[_text]);
+
+    String readText(int offset, int length) => length == 0
+        ? ''
+        : utf8.decode(Uint8List.sublistView(text, offset, offset + length), allowMalformed: true);
+
+    final configs = <VpnConfig>[];
+    for (var i = 0; i < count; i++) {
+      final record = i * _recordFields;
+      final protocol = records[record + _protocol];
+      if (protocol < 0 || protocol >= _protocols.length) continue;
+
+      final params = <String, String>{};
+      final firstParam = records[record + _firstParam];
+      for (var p = 0; p < records[record + _paramCount]; p++) {
+        final span = (firstParam + p) * 4;
+        params[readText(spans[span], spans[span + 1])] = readText(spans[span + 2], spans[span + 3]);
+      }
+
+      configs.add(VpnConfig(
+        protocol: _protocols[protocol],
+        id: readText(records[record + _idOffset], records[record + _idLength]),
+        address: readText(records[record + _addressOffset], records[record + _addressLength]),
+        port: records[record + _port],
+        params: params,
+        tag: readText(records[record + _tagOffset], records[record + _tagLength]),
+      ));
+    }
+    return ParsedSubscription(configs, header[_skipped]);
+  }
+}
@@ -768,7 +768,14 @@ class VPNConnectionManager {
     try {
       final result = await _routingService.setCurrentProfileByName(profileName);
       
-      if (result && isConnected) {
+      // На Windows профиль применяет прокси маршрутизации перед ядром: новый
+      // профиль уже опубликован, новые соединения пойдут по нему, открытые
+      // доживут по старому. Остальные платформы получают правила в конфиге
+      // ядра при подключении, поэтому там нужно переподключиться.
+      final appliedLive = Platform.isWindows &&
+          _windowsVpnService.isRoutingLive &&
+          _routingService.isNativeRoutingActive;
+      if (result && isConnected && !appliedLive) {
         // If connected, reconnect to apply new routing
         final currentConfig = _currentConfig;
         if (currentConfig != null) {
@@ -2,13 +2,17 @@ import 'dart:async';
 import 'dart:io';
 import 'dart:ffi';
 import 'dart:convert';
+import 'dart:typed_data';
 import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show visibleForTesting;
 import 'package:path/path.dart' as path;
 import 'package:path_provider/path_provider.dart';
 
 import '../../data/models/vpn_config.dart';
 import '../constants/app_constants.dart';
+import 'core_config_bridge.dart';
 import 'logger_service.dart';
+import 'native_proxy_bridge.dart';
 
 // Коды состояния VPN
 class VPNStatus {
@@ -36,6 +40,14 @@ class WindowsVpnService {
 
   bool _isInitialized = false;
   bool _isConnected = false;
+  bool _isRoutingLive = false;
+  
+  // Порт SOCKS5, который слушает ядро (inbound конфигурации)
+  static const int _coreSocksPort = 10808;
+
+  // Передавать конфигурацию V2Ray через stdin ('-config stdin:') вместо
+  // current_config.json; trojan и sslocal читают только файл
+  bool passConfigViaPipe = true;
   
   // List of VPN process IDs
   final List<int> _vpnProcessIds = [];
@@ -124,8 +136,8 @@ class WindowsVpnService {
     try {
       LoggerService.info('Подключение к VPN серверу: ${config.displayName}');
       
-      // Generate configuration file for the proxy protocol
-      final configFile = await _generateConfigFile(config);
+      // Generate configuration for the proxy protocol
+      final configData = _generateConfig(config);
       
       // Start the appropriate client based on protocol
       bool clientStarted = false;
@@ -133,14 +145,14 @@ class WindowsVpnService {
       switch (config.protocol.toLowerCase()) {
         case 'vless':
         case 'vmess':
-          clientStarted = await _startV2Ray(configFile);
+          clientStarted = await _startV2Ray(configData);
           break;
         case 'trojan':
-          clientStarted = await _startTrojan(configFile);
+          clientStarted = await _startTrojan(await _writeConfigFile(configData));
           break;
         case 'shadowsocks':
         case 'ss':
-          clientStarted = await _startShadowsocks(configFile);
+          clientStarted = await _startShadowsocks(await _writeConfigFile(configData));
           break;
         default:
           throw Exception('Неподдерживаемый протокол: ${config.protocol}');
@@ -153,8 +165,19 @@ class WindowsVpnService {
       // Wait for the proxy service to start
       await Future.delayed(const Duration(seconds: 1));
       
+      // Прокси маршрутизации перед ядром применяет профиль к каждому
+      // соединению, поэтому профиль меняется без переподключения. Без него
+      // система смотрит прямо в SOCKS ядра
+      _isRoutingLive = NativeProxyBridge().startRoutingProxy(
+          AppConstants.defaultSocksPort,
+          upstreamPort: _coreSocksPort);
+      if (!_isRoutingLive) {
+        LoggerService.warning('Прокси маршрутизации недоступен, профиль применяется при подключении');
+      }
+      final systemPort = _isRoutingLive ? AppConstants.defaultSocksPort : _coreSocksPort;
+      
       // Setup system proxy to use our local SOCKS proxy
-      final socksPortPtr = '10808'.toNativeUtf8(); // Standard Socks port used by proxies
+      final socksPortPtr = '$systemPort'.toNativeUtf8();
       
       final proxyResult = _setupProxy(socksPortPtr);
       
@@ -178,8 +201,53 @@ class WindowsVpnService {
     }
   }
   
-  // Generate configuration file for the proxy protocol
-  Future<String> _generateConfigFile(VpnConfig config) async {
+  // Generate configuration for the proxy protocol (UTF-8 JSON)
+  Uint8List _generateConfig(VpnConfig config) {
+    final accessLog = path.join(Directory.systemTemp.path, "v2ray_access.log");
+    final errorLog = path.join(Directory.systemTemp.path, "v2ray_error.log");
+
+    // Native generator writes the same JSON without building maps
+    final nativeConfig = CoreConfigBridge().generate(
+      config,
+      accessLog: accessLog,
+      errorLog: errorLog,
+    );
+    if (nativeConfig != null) {
+      return nativeConfig;
+    }
+
+    final jsonConfig = generateDartConfig(config, accessLog: accessLog, errorLog: errorLog);
+    return Uint8List.fromList(utf8.encode(jsonConfig));
+  }
+
+  // Конфигурация ядра картами Dart - запасной путь без helper DLL и эталон
+  // нативного генератора (test/core/core_config_golden_test.dart)
+  @visibleForTesting
+  String generateDartConfig(VpnConfig config,
+      {required String accessLog, required String errorLog}) {
+    // Generate the appropriate config based on protocol
+    String jsonConfig;
+    
+    switch (config.protocol.toLowerCase()) {
+      case 'vless':
+      case 'vmess':
+        jsonConfig = _generateV2RayConfig(config, accessLog, errorLog);
+        break;
+      case 'trojan':
+        jsonConfig = _generateTrojanConfig(config);
+        break;
+      case 'shadowsocks':
+      case 'ss':
+        jsonConfig = _generateShadowsocksConfig(config);
+        break;
+      default:
+        throw Exception('Неподдерживаемый протокол: ${config.protocol}');
+    }
+    return jsonConfig;
+  }
+
+  // Write the configuration to current_config.json
+  Future<String> _writeConfigFile(Uint8List configData) async {
     try {
       final appDir = await getApplicationSupportDirectory();
       final configDir = path.join(appDir.path, AppConstants.configDir);
@@ -189,27 +257,8 @@ class WindowsVpnService {
       
       final configFile = path.join(configDir, 'current_config.json');
       
-      // Generate the appropriate config based on protocol
-      String jsonConfig;
-      
-      switch (config.protocol.toLowerCase()) {
-        case 'vless':
-        case 'vmess':
-          jsonConfig = _generateV2RayConfig(config);
-          break;
-        case 'trojan':
-          jsonConfig = _generateTrojanConfig(config);
-          break;
-        case 'shadowsocks':
-        case 'ss':
-          jsonConfig = _generateShadowsocksConfig(config);
-          break;
-        default:
-          throw Exception('Неподдерживаемый протокол: ${config.protocol}');
-      }
-      
       // Write the configuration to file
-      await File(configFile).writeAsString(jsonConfig);
+      await File(configFile).writeAsBytes(configData);
       
       LoggerService.info('Конфигурационный файл создан: $configFile');
       return configFile;
@@ -220,13 +269,13 @@ class WindowsVpnService {
   }
   
   // Generate V2Ray configuration
-  String _generateV2RayConfig(VpnConfig config) {
+  String _generateV2RayConfig(VpnConfig config, String accessLog, String errorLog) {
     // Create optimized V2Ray config with improved privacy and performance
     final Map<String, dynamic> v2rayConfig = {
       "log": {
         "loglevel": "warning",
-        "access": path.join(Directory.systemTemp.path, "v2ray_access.log"),
-        "error": path.join(Directory.systemTemp.path, "v2ray_error.log")
+        "access": accessLog,
+        "error": errorLog
       },
       "inbounds": [
         {
@@ -416,7 +465,7 @@ class WindowsVpnService {
   }
   
   // Start V2Ray process
-  Future<bool> _startV2Ray(String configFile) async {
+  Future<bool> _startV2Ray(Uint8List configData) async {
     try {
       // Path to V2Ray executable
       final exePath = Platform.resolvedExecutable;
@@ -428,12 +477,26 @@ class WindowsVpnService {
         throw Exception('V2Ray исполняемый файл не найден: $v2rayPath');
       }
       
-      // Start the process
-      final process = await Process.start(
-        v2rayPath,
-        ['-config', configFile],
-        mode: ProcessStartMode.detached
-      );
+      final Process process;
+      if (passConfigViaPipe) {
+        // Configuration goes through stdin, without the filesystem
+        process = await Process.start(
+          v2rayPath,
+          ['-config', 'stdin:'],
+          mode: ProcessStartMode.detachedWithStdio
+        );
+        process.stdout.drain<void>();
+        process.stderr.drain<void>();
+        process.stdin.add(configData);
+        await process.stdin.close();
+      } else {
+        final configFile = await _writeConfigFile(configData);
+        process = await Process.start(
+          v2rayPath,
+          ['-config', configFile],
+          mode: ProcessStartMode.detached
+        );
+      }
       
       // Save the PID for later termination
       _vpnProcessIds.add(process.pid);
@@ -563,6 +626,10 @@ class WindowsVpnService {
       // Stop statistics collection
       _stopStatsCollection();
       
+      // Stop the routing proxy in front of the core
+      NativeProxyBridge().stopLocalProxy();
+      _isRoutingLive = false;
+      
       // Disable system proxy
       final disableResult = _disableProxy();
       if (disableResult != 1) {
@@ -608,6 +675,8 @@ class WindowsVpnService {
       
       // Try to disable proxy
       try {
+        NativeProxyBridge().stopLocalProxy();
+        _isRoutingLive = false;
         _disableProxy();
       } catch (e) {
         // Ignore errors during cleanup
@@ -625,6 +694,9 @@ class WindowsVpnService {
     return _isConnected;
   }
   
+  // Профиль маршрутизации применяется к новым соединениям без переподключения
+  bool get isRoutingLive => _isConnected && _isRoutingLive;
+  
   // Get traffic statistics
   Map<String, dynamic> getTrafficStats() {
     return {
@@ -300,6 +300,7 @@ void main() async {
   await windowManager.ensureInitialized();
   
   // Сначала инициализируем логгер для сбора информации
+  await LoggerService.initialize();
   LoggerService.info('======== Запуск приложения ========');
   
   // Скрываем окно во время запуска
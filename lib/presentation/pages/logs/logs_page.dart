@@ -1,6 +1,10 @@
+import 'dart:async';
+import 'dart:math' show min;
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
 
+import '../../../core/services/native_log_bridge.dart';
+
 class LogsPage extends StatefulWidget {
   const LogsPage({Key? key}) : super(key: key);
 
@@ -9,66 +13,177 @@ class LogsPage extends StatefulWidget {
 }
 
 class _LogsPageState extends State<LogsPage> {
-  // Моковые данные для логов
-  final List<Map<String, dynamic>> _logs = [
-    {
-      'timestamp': '2025-03-26 10:15:23',
-      'level': 'INFO',
-      'message': 'Приложение запущено',
-    },
-    {
-      'timestamp': '2025-03-26 10:15:24',
-      'level': 'INFO',
-      'message': 'Инициализация конфигурации...',
-    },
-    {
-      'timestamp': '2025-03-26 10:15:25',
-      'level': 'INFO',
-      'message': 'Загружены настройки пользователя',
-    },
-    {
-      'timestamp': '2025-03-26 10:16:01',
-      'level': 'INFO',
-      'message': 'Подключение к серверу "Сервер 1 (Германия)"',
-    },
-    {
-      'timestamp': '2025-03-26 10:16:02',
-      'level': 'INFO',
-      'message': 'Открытие TCP соединения с 65.21.108.12:443',
-    },
-    {
-      'timestamp': '2025-03-26 10:16:05',
-      'level': 'INFO',
-      'message': 'Соединение установлено успешно',
-    },
-    {
-      'timestamp': '2025-03-26 10:20:45',
-      'level': 'WARNING',
-      'message': 'Высокая загрузка канала: 5MB/s',
-    },
-    {
-      'timestamp': '2025-03-26 10:45:12',
-      'level': 'ERROR',
-      'message': 'Потеря соединения с сервером',
-    },
-  ];
+  // Журнал читается страницами из нативного файла (native_log_bridge.dart)
+  static const int _pageLines = 256;
+  static const int _maxCachedPages = 32;
+  static const Duration _refreshInterval = Duration(seconds: 1);
+  // Вызовов поиска за кадр: каждый ограничен по времени в нативном индексе
+  static const int _searchCallsPerFrame = 4;
+
+  final NativeLogBridge _bridge = NativeLogBridge();
+  final Map<int, List<LogLine>> _pages = {};
+  Timer? _refreshTimer;
+
+  int _firstLine = 0;
+  int _lineCount = 0;
+
+  // Номера строк, подходящих под фильтр, и до какой строки журнал просмотрен
+  final List<int> _matches = [];
+  int _scannedUpTo = 0;
+  bool _scanScheduled = false;
 
   String _searchQuery = '';
   String _logLevel = 'Все';
+  bool _copying = false;
   
   // Возможные уровни логов для фильтрации
-  final List<String> _logLevels = ['Все', 'INFO', 'WARNING', 'ERROR'];
+  final List<String> _logLevels = ['Все', 'DEBUG', 'INFO', 'WARNING', 'ERROR'];
+
+  bool get _isFiltered => _searchQuery.isNotEmpty || _logLevel != 'Все';
 
   @override
-  Widget build(BuildContext context) {
-    // Фильтрация логов
-    List<Map<String, dynamic>> filteredLogs = _logs.where((log) {
-      bool matchesSearch = log['message'].toString().toLowerCase().contains(_searchQuery.toLowerCase());
-      bool matchesLevel = _logLevel == 'Все' || log['level'] == _logLevel;
-      
-      return matchesSearch && matchesLevel;
-    }).toList();
+  void initState() {
+    super.initState();
+    _refresh();
+    _refreshTimer = Timer.periodic(_refreshInterval, (_) {
+      if (_refresh()) setState(() {});
+    });
+  }
+
+  @override
+  void dispose() {
+    _refreshTimer?.cancel();
+    super.dispose();
+  }
 
+  // Подхватить новые строки; true, если журнал изменился
+  bool _refresh() {
+    final firstLine = _bridge.firstLine;
+    final lineCount = _bridge.lineCount;
+    if (firstLine == _firstLine && lineCount == _lineCount) return false;
+    if (firstLine != _firstLine) {
+      // Ротация или очистка: ранние строки больше не читаются
+      _pages.clear();
+      _matches.removeWhere((number) => number < firstLine);
+    }
+    // Последняя страница могла быть прочитана неполной
+    _pages.remove(_lineCount ~/ _pageLines);
+    _firstLine = firstLine;
+    _lineCount = lineCount;
+    if (_isFiltered) _scan();
+    return true;
+  }
+
+  // Строка по номеру через кэш страниц
+  LogLine? _lineAt(int number) {
+    final page = number ~/ _pageLines;
+    var lines = _pages[page];
+    if (lines == null) {
+      if (_pages.length >= _maxCachedPages) _pages.remove(_pages.keys.first);
+      lines = _bridge.read(page * _pageLines, _pageLines);
+      _pages[page] = lines;
+    }
+    if (lines.isEmpty) return null;
+    final index = number - lines.first.number;
+    return index >= 0 && index < lines.length ? lines[index] : null;
+  }
+
+  // Маска уровней для поиска: бит 1 << уровень log_helper.h
+  int get _levelMask {
+    if (_logLevel == 'Все') return NativeLogBridge.allLevels;
+    return 1 << (_logLevels.indexOf(_logLevel) - 1);
+  }
+
+  // Дописать в _matches подходящие строки, которые еще не просмотрены.
+  // Поиск идет по нативному индексу журнала; если за кадр журнал не
+  // просмотрен до конца, продолжение откладывается на следующий кадр.
+  void _scan() {
+    final start = _scannedUpTo < _firstLine ? _firstLine : _scannedUpTo;
+    var next = start;
+    for (var call = 0; call < _searchCallsPerFrame && next < _lineCount; call++) {
+      final result = _bridge.search(
+        levels: _levelMask,
+        text: _searchQuery,
+        startLine: next,
+      );
+      _matches.addAll(result.lines);
+      if (result.nextLine <= next) break;
+      next = result.nextLine;
+    }
+    _scannedUpTo = next;
+    if (next > start && next < _lineCount && !_scanScheduled) {
+      _scanScheduled = true;
+      Timer.run(() {
+        _scanScheduled = false;
+        if (!mounted || !_isFiltered) return;
+        setState(_scan);
+      });
+    }
+  }
+
+  void _setFilter({String? query, String? level}) {
+    setState(() {
+      _searchQuery = query ?? _searchQuery;
+      _logLevel = level ?? _logLevel;
+      _matches.clear();
+      _scannedUpTo = _firstLine;
+      if (_isFiltered) _scan();
+    });
+  }
+
+  int get _visibleCount => _isFiltered ? _matches.length : _lineCount - _firstLine;
+
+  LogLine? _visibleAt(int index) => _lineAt(_isFiltered ? _matches[index] : _firstLine + index);
+
+  // Текст видимых строк для буфера обмена. Журнал читается страницами по
+  // maxPageLines мимо кэша страниц, с возвратом в цикл событий после каждой,
+  // так что копирование большого журнала не останавливает кадры.
+  Future<String> _visibleText() async {
+    final buffer = StringBuffer();
+    if (_isFiltered) {
+      // Найденные строки - в порядке номеров: одна страница на соседние
+      final matches = List<int>.of(_matches);
+      var index = 0;
+      while (index < matches.length) {
+        final lines = _bridge.read(matches[index], NativeLogBridge.maxPageLines);
+        if (lines.isEmpty) break;
+        final first = lines.first.number;
+        final end = first + lines.length;
+        for (; index < matches.length && matches[index] < end; index++) {
+          if (matches[index] >= first) buffer.writeln(lines[matches[index] - first]);
+        }
+        await Future<void>.delayed(Duration.zero);
+      }
+    } else {
+      final end = _lineCount;
+      var next = _firstLine;
+      while (next < end) {
+        final lines = _bridge.read(next, min(NativeLogBridge.maxPageLines, end - next));
+        if (lines.isEmpty) break;
+        for (final line in lines) {
+          buffer.writeln(line);
+        }
+        next = lines.last.number + 1;
+        await Future<void>.delayed(Duration.zero);
+      }
+    }
+    return buffer.toString();
+  }
+
+  Future<void> _copyLogs() async {
+    if (_copying) return;
+    setState(() => _copying = true);
+    final String logsText = await _visibleText();
+    await Clipboard.setData(ClipboardData(text: logsText));
+    if (!mounted) return;
+    setState(() => _copying = false);
+    ScaffoldMessenger.of(context).showSnackBar(
+      const SnackBar(content: Text('Логи скопированы в буфер обмена')),
+    );
+  }
+
+  @override
+  Widget build(BuildContext context) {
     return Scaffold(
       appBar: AppBar(
         title: const Text(
@@ -78,17 +193,8 @@ class _LogsPageState extends State<LogsPage> {
         actions: [
           IconButton(
             icon: const Icon(Icons.copy),
-            onPressed: () {
-              // Копируем логи в буфер обмена
-              final String logsText = filteredLogs
-                  .map((log) => '[${log['timestamp']}] [${log['level']}] ${log['message']}')
-                  .join('\n');
-              Clipboard.setData(ClipboardData(text: logsText));
-              
-              ScaffoldMessenger.of(context).showSnackBar(
-                const SnackBar(content: Text('Логи скопированы в буфер обмена')),
-              );
-            },
+            // Копируем логи в буфер обмена
+            onPressed: _copying ? null : _copyLogs,
             tooltip: 'Копировать логи',
           ),
           IconButton(
@@ -107,7 +213,13 @@ class _LogsPageState extends State<LogsPage> {
                     ),
                     ElevatedButton(
                       onPressed: () {
-                        // Очищаем логи
+                        // Очищаем логи: журнал начинается с нового файла
+                        _bridge.clear();
+                        setState(() {
+                          _refresh();
+                          _matches.clear();
+                          _scannedUpTo = _firstLine;
+                        });
                         Navigator.pop(context);
                         ScaffoldMessenger.of(context).showSnackBar(
                           const SnackBar(content: Text('Логи очищены')),
@@ -144,9 +256,7 @@ class _LogsPageState extends State<LogsPage> {
                       ),
                     ),
                     onChanged: (value) {
-                      setState(() {
-                        _searchQuery = value;
-                      });
+                      _setFilter(query: value);
                     },
                   ),
                 ),
@@ -162,9 +272,7 @@ class _LogsPageState extends State<LogsPage> {
                     color: Theme.of(context).colorScheme.primary,
                   ),
                   onChanged: (String? newValue) {
-                    setState(() {
-                      _logLevel = newValue!;
-                    });
+                    _setFilter(level: newValue!);
                   },
                   items: _logLevels.map<DropdownMenuItem<String>>((String value) {
                     return DropdownMenuItem<String>(
@@ -179,7 +287,7 @@ class _LogsPageState extends State<LogsPage> {
           
           // Список логов
           Expanded(
-            child: filteredLogs.isEmpty
+            child: _visibleCount == 0
                 ? Center(
                     child: Column(
                       mainAxisAlignment: MainAxisAlignment.center,
@@ -211,9 +319,10 @@ class _LogsPageState extends State<LogsPage> {
                       ),
                     ),
                     child: ListView.builder(
-                      itemCount: filteredLogs.length,
+                      itemCount: _visibleCount,
                       itemBuilder: (context, index) {
-                        final log = filteredLogs[index];
+                        final log = _visibleAt(index);
+                        if (log == null) return const SizedBox.shrink();
                         return Padding(
                           padding: const EdgeInsets.symmetric(vertical: 4, horizontal: 16),
                           child: Row(
@@ -221,9 +330,9 @@ class _LogsPageState extends State<LogsPage> {
                             children: [
                               // Timestamp
                               SizedBox(
-                                width: 160,
+                                width: 180,
                                 child: Text(
-                                  log['timestamp'],
+                                  log.timestamp,
                                   style: TextStyle(
                                     fontFamily: 'monospace',
                                     fontSize: 12,
@@ -236,12 +345,12 @@ class _LogsPageState extends State<LogsPage> {
                               SizedBox(
                                 width: 70,
                                 child: Text(
-                                  '[${log['level']}]',
+                                  '[${log.level}]',
                                   style: TextStyle(
                                     fontFamily: 'monospace',
                                     fontSize: 12,
                                     fontWeight: FontWeight.bold,
-                                    color: _getLogLevelColor(log['level']),
+                                    color: _getLogLevelColor(log.level),
                                   ),
                                 ),
                               ),
@@ -249,7 +358,7 @@ class _LogsPageState extends State<LogsPage> {
                               // Log message
                               Expanded(
                                 child: Text(
-                                  log['message'],
+                                  log.message,
                                   style: const TextStyle(
                                     fontFamily: 'monospace',
                                     fontSize: 12,
@@ -1,5 +1,8 @@
+import 'dart:async';
+
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
+import '../../../core/services/server_ranking_bridge.dart';
 import '../../../core/services/server_storage_service.dart';
 import '../../../data/models/vpn_config.dart';
 import '../../widgets/import_config_dialog.dart';
@@ -27,6 +30,15 @@ class _ServersPageState extends State<ServersPage> {
   // Возможные протоколы для фильтрации
   final List<String> _availableProtocols = ['Все', 'VLESS', 'VMess', 'Trojan', 'Shadowsocks'];
 
+  // Проверка серверов нативной оценкой: результаты лучшими первыми и по
+  // серверу (ключ - сам объект из _servers)
+  final ServerRankingBridge _rankingBridge = ServerRankingBridge();
+  StreamSubscription<List<RankedServer>>? _rankingSubscription;
+  List<RankedServer> _rankedServers = [];
+  final Map<VpnConfig, RankedServer> _rankingByServer = Map.identity();
+
+  bool get _isRanking => _rankingSubscription != null;
+
   // Метод для обновления UI при изменении глобального состояния
   void _updateFromGlobalState() {
     if (mounted) {
@@ -51,9 +63,59 @@ class _ServersPageState extends State<ServersPage> {
   void dispose() {
     // Удаляем слушатель при уничтожении
     AppGlobals.removeListener(_updateFromGlobalState);
+    _rankingSubscription?.cancel();
     super.dispose();
   }
 
+  // Проверка всех серверов; повторное нажатие во время проверки прерывает ее
+  void _rankServers() {
+    if (_isRanking) {
+      _rankingSubscription!.cancel();
+      setState(() {
+        _rankingSubscription = null;
+      });
+      return;
+    }
+    final servers = List<VpnConfig>.of(_servers);
+    setState(() {
+      _rankedServers = [];
+      _rankingByServer.clear();
+      _rankingSubscription = _rankingBridge.rank(servers).listen(
+        (ranked) {
+          if (!mounted) return;
+          setState(() {
+            _rankedServers = ranked;
+            _rankingByServer
+              ..clear()
+              ..addEntries(ranked.map((result) => MapEntry(result.config, result)));
+          });
+        },
+        onError: (Object e) {
+          if (mounted) _showErrorSnackBar('Ошибка проверки серверов: ${e.toString()}');
+        },
+        onDone: () {
+          if (mounted) {
+            setState(() {
+              _rankingSubscription = null;
+            });
+          }
+        },
+      );
+    });
+  }
+
+  // Проверенные серверы - в порядке оценки, остальные - в исходном порядке
+  List<VpnConfig> _orderByRanking(List<VpnConfig> servers) {
+    if (_rankedServers.isEmpty) return servers;
+    final visible = Set<VpnConfig>.identity()..addAll(servers);
+    return [
+      for (final result in _rankedServers)
+        if (visible.contains(result.config)) result.config,
+      for (final server in servers)
+        if (!_rankingByServer.containsKey(server)) server,
+    ];
+  }
+
   // Загрузка серверов при инициализации - используем кеш
   Future<void> _loadServers() async {
     setState(() {
@@ -96,10 +158,11 @@ class _ServersPageState extends State<ServersPage> {
     }
   }
 
-  // Сохранение серверов
-  Future<void> _saveServers() async {
+  // Сохранение изменения списка: вставка и удаление пишутся в хранилище
+  // отдельными записями, без перезаписи всего списка
+  Future<void> _persist(Future<void> change) async {
     try {
-      await ServerStorageService.saveServers(_servers);
+      await change;
       // Обновляем кеш после сохранения
       await ServerCache.refreshServers();
     } catch (e) {
@@ -110,8 +173,7 @@ class _ServersPageState extends State<ServersPage> {
   // Обработка успешного импорта
   void _handleImportSuccess(List<VpnConfig> configs) {
     setState(() {
-      _servers.addAll(configs);
-      _saveServers();
+      _persist(ServerStorageService.insertServers(_servers, _servers.length, configs));
       ScaffoldMessenger.of(context).showSnackBar(
         SnackBar(
           content: Text(
@@ -129,10 +191,11 @@ class _ServersPageState extends State<ServersPage> {
     final serverName = server.displayName;
 
     try {
+      late Future<void> removal;
       setState(() {
-        _servers.removeAt(index);
+        removal = ServerStorageService.deleteServer(_servers, index);
       });
-      await _saveServers();
+      await _persist(removal);
       
       ScaffoldMessenger.of(context).showSnackBar(
         SnackBar(
@@ -142,8 +205,7 @@ class _ServersPageState extends State<ServersPage> {
             label: 'Отменить',
             onPressed: () {
               setState(() {
-                _servers.insert(index, server);
-                _saveServers();
+                _persist(ServerStorageService.insertServers(_servers, index, [server]));
               });
             },
           ),
@@ -258,6 +320,7 @@ class _ServersPageState extends State<ServersPage> {
       
       return matchesSearch && matchesProtocol;
     }).toList();
+    filteredServers = _orderByRanking(filteredServers);
 
     return Scaffold(
       appBar: AppBar(
@@ -266,6 +329,19 @@ class _ServersPageState extends State<ServersPage> {
           style: TextStyle(fontWeight: FontWeight.bold),
         ),
         actions: [
+          // Кнопка проверки серверов (только с нативной оценкой)
+          if (_rankingBridge.isAvailable)
+            IconButton(
+              icon: _isRanking
+                  ? const SizedBox(
+                      width: 20,
+                      height: 20,
+                      child: CircularProgressIndicator(strokeWidth: 2),
+                    )
+                  : const Icon(Icons.speed),
+              tooltip: _isRanking ? 'Остановить проверку' : 'Проверить серверы',
+              onPressed: _servers.isEmpty ? null : _rankServers,
+            ),
           // Кнопка импорта
           IconButton(
             icon: const Icon(Icons.cloud_download_outlined),
@@ -438,6 +514,10 @@ class _ServersPageState extends State<ServersPage> {
                                           server.params['security'] ?? 'Standard',
                                           Colors.green.withOpacity(0.2),
                                         ),
+                                        if (_rankingByServer[server] != null) ...[
+                                          const SizedBox(width: 8),
+                                          _buildRankingChip(_rankingByServer[server]!),
+                                        ],
                                       ],
                                     ),
                                     const SizedBox(height: 4),
@@ -507,6 +587,18 @@ class _ServersPageState extends State<ServersPage> {
     }
   }
 
+  // Время соединения и TLS-рукопожатия по итогам проверки
+  Widget _buildRankingChip(RankedServer result) {
+    if (!result.reachable) {
+      return _buildInfoChip('Недоступен', Colors.red.withOpacity(0.2));
+    }
+    final latency = result.connectTime + (result.tlsTime ?? Duration.zero);
+    return _buildInfoChip(
+      '${latency.inMilliseconds} мс',
+      Colors.orange.withOpacity(0.2),
+    );
+  }
+
   Widget _buildInfoChip(String label, Color color) {
     return Container(
       padding: const EdgeInsets.symmetric(horizontal: 8, vertical: 4),
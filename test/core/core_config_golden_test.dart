@@ -0,0 +1,53 @@
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:fluttervpn/core/services/windows_vpn_service.dart';
+import 'package:fluttervpn/data/models/vpn_config.dart';
+import 'package:path/path.dart' as path;
+
+// Эталоны windows/runner/test/golden/core_config: <имя>.server.json -
+// VpnConfig.toJson(), <имя>.json - конфигурация ядра. С теми же файлами
+// нативный генератор сверяет core_config_test (windows/runner/test), так
+// что оба генератора пишут конфигурации байт в байт одинаково.
+//
+// Эталоны конфигураций пишет этот генератор:
+//
+//   flutter test --update-goldens test/core/core_config_golden_test.dart
+//
+// перезаписывает <имя>.json по <имя>.server.json; после этого нативный
+// генератор проверяется прогоном ctest -R core_config_test.
+const _goldenDir = 'windows/runner/test/golden/core_config';
+const _accessLog = r'C:\Users\tester\AppData\Local\Temp\v2ray_access.log';
+const _errorLog = r'C:\Users\tester\AppData\Local\Temp\v2ray_error.log';
+const _serverSuffix = '.server.json';
+
+void main() {
+  final names = Directory(_goldenDir)
+      .listSync()
+      .map((entry) => path.basename(entry.path))
+      .where((file) => file.endsWith(_serverSuffix))
+      .map((file) => file.substring(0, file.length - _serverSuffix.length))
+      .toList()
+    ..sort();
+
+  test('golden fixtures are present', () {
+    expect(names, isNotEmpty);
+  });
+
+  for (final name in names) {
+    test('Dart generator matches golden $name', () {
+      final server = VpnConfig.fromJson(
+          jsonDecode(File(path.join(_goldenDir, '$name$_serverSuffix')).readAsStringSync())
+              as Map<String, dynamic>);
+      final golden = File(path.join(_goldenDir, '$name.json'));
+      final actual = utf8.encode(WindowsVpnService()
+          .generateDartConfig(server, accessLog: _accessLog, errorLog: _errorLog));
+      if (autoUpdateGoldenFiles) {
+        golden.writeAsBytesSync(actual);
+        return;
+      }
+      expect(actual, golden.readAsBytesSync());
+    });
+  }
+}
@@ -11,6 +11,104 @@ extern "C" {
 // Определения WinDivert
 #define WINDIVERT_LAYER_NETWORK            0
 #define WINDIVERT_LAYER_NETWORK_FORWARD    1
+#define WINDIVERT_LAYER_FLOW               2
+#define WINDIVERT_LAYER_SOCKET             3
+#define WINDIVERT_LAYER_REFLECT            4
+
+// Флаги WinDivertOpen
+#define WINDIVERT_FLAG_SNIFF               0x0001
+#define WINDIVERT_FLAG_DROP                0x0002
+#define WINDIVERT_FLAG_RECV_ONLY           0x0004
+#define WINDIVERT_FLAG_SEND_ONLY           0x0008
+
+// Ограничения пакетного приема/отправки
+#define WINDIVERT_BATCH_MAX                0xFF
+#define WINDIVERT_MTU_MAX                  (40 + 0xFFFF)
+
+// Параметры WinDivertSetParam
+#define WINDIVERT_PARAM_QUEUE_LENGTH       0
+#define WINDIVERT_PARAM_QUEUE_TIME         1
+#define WINDIVERT_PARAM_QUEUE_SIZE         2
+
+typedef enum
+{
+    WINDIVERT_SHUTDOWN_RECV = 0x1,
+    WINDIVERT_SHUTDOWN_SEND = 0x2,
+    WINDIVERT_SHUTDOWN_BOTH = 0x3
+} WINDIVERT_SHUTDOWN;
+
+// События (поле Event адреса)
+typedef enum
+{
+    WINDIVERT_EVENT_NETWORK_PACKET   = 0,
+    WINDIVERT_EVENT_FLOW_ESTABLISHED = 1,
+    WINDIVERT_EVENT_FLOW_DELETED     = 2,
+    WINDIVERT_EVENT_SOCKET_BIND      = 3,
+    WINDIVERT_EVENT_SOCKET_CONNECT   = 4,
+    WINDIVERT_EVENT_SOCKET_LISTEN    = 5,
+    WINDIVERT_EVENT_SOCKET_ACCEPT    = 6,
+    WINDIVERT_EVENT_SOCKET_CLOSE     = 7,
+    WINDIVERT_EVENT_REFLECT_OPEN     = 8,
+    WINDIVERT_EVENT_REFLECT_CLOSE    = 9
+} WINDIVERT_EVENT;
+
+// Данные слоев NETWORK и NETWORK_FORWARD
+typedef struct
+{
+    UINT32 IfIdx;
+    UINT32 SubIfIdx;
+} WINDIVERT_DATA_NETWORK;
+
+// Данные слоя FLOW
+typedef struct
+{
+    UINT64 EndpointId;
+    UINT64 ParentEndpointId;
+    UINT32 ProcessId;
+    UINT32 LocalAddr[4];
+    UINT32 RemoteAddr[4];
+    UINT16 LocalPort;
+    UINT16 RemotePort;
+    UINT8  Protocol;
+} WINDIVERT_DATA_FLOW;
+
+// Данные слоя SOCKET. Адреса - IPv6 (IPv4 как ::ffff:a.b.c.d) в порядке байт хоста
+typedef struct
+{
+    UINT64 EndpointId;
+    UINT64 ParentEndpointId;
+    UINT32 ProcessId;
+    UINT32 LocalAddr[4];
+    UINT32 RemoteAddr[4];
+    UINT16 LocalPort;
+    UINT16 RemotePort;
+    UINT8  Protocol;
+} WINDIVERT_DATA_SOCKET;
+
+// Адрес (метаданные) перехваченного пакета, 80 байт
+typedef struct
+{
+    INT64  Timestamp;
+    UINT32 Layer:8;
+    UINT32 Event:8;
+    UINT32 Sniffed:1;
+    UINT32 Outbound:1;
+    UINT32 Loopback:1;
+    UINT32 Impostor:1;
+    UINT32 IPv6:1;
+    UINT32 IPChecksum:1;
+    UINT32 TCPChecksum:1;
+    UINT32 UDPChecksum:1;
+    UINT32 Reserved1:8;
+    UINT32 Reserved2;
+    union
+    {
+        WINDIVERT_DATA_NETWORK Network;
+        WINDIVERT_DATA_FLOW Flow;
+        WINDIVERT_DATA_SOCKET Socket;
+        UINT8 Reserved3[64];
+    };
+} WINDIVERT_ADDRESS;
 
 typedef void *HANDLE_WINDIVERT;
 
@@ -41,12 +139,45 @@ BOOL WinDivertSend(
     PVOID pAddr,
     UINT *pAddrLen);
 
+// Получить пачку пакетов (до WINDIVERT_BATCH_MAX за один вызов).
+// Пакеты лежат в pPacket подряд, *pAddrLen / sizeof(WINDIVERT_ADDRESS) - их количество.
+BOOL WinDivertRecvEx(
+    HANDLE_WINDIVERT handle,
+    PVOID pPacket,
+    UINT packetLen,
+    UINT *pRecvLen,
+    UINT64 flags,
+    WINDIVERT_ADDRESS *pAddr,
+    UINT *pAddrLen,
+    LPOVERLAPPED lpOverlapped);
+
+// Отправить пачку пакетов, лежащих подряд в pPacket
+BOOL WinDivertSendEx(
+    HANDLE_WINDIVERT handle,
+    const VOID *pPacket,
+    UINT packetLen,
+    UINT *pSendLen,
+    UINT64 flags,
+    const WINDIVERT_ADDRESS *pAddr,
+    UINT addrLen,
+    LPOVERLAPPED lpOverlapped);
+
+// Прервать прием/отправку (разблокирует ожидающие WinDivertRecvEx)
+BOOL WinDivertShutdown(
+    HANDLE_WINDIVERT handle,
+    WINDIVERT_SHUTDOWN how);
+
 // Установить параметр
 BOOL WinDivertSetParam(
     HANDLE_WINDIVERT handle,
     INT param,
     UINT64 value);
 
+// Перевести IPv6-адрес из порядка байт хоста в сетевой
+void WinDivertHelperHtonIPv6Address(
+    const UINT *inAddr,
+    UINT *outAddr);
+
 #ifdef __cplusplus
 }
 #endif
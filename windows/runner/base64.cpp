@@ -0,0 +1,307 @@
+#include "base64.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define BASE64_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BASE64_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_TARGET_AVX2 __attribute__((target("avx2")))
+#define BASE64_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define BASE64_TARGET_AVX2
+#define BASE64_TARGET_SSSE3
+#endif
+
+namespace {
+
+constexpr uint8_t kInvalid = 0xFF;
+constexpr uint8_t kPad = 0xFE;
+
+// Запас в конце вывода: векторная запись выходит за последние байты блока
+constexpr size_t kOutputSlack = 8;
+
+struct DecodeTable {
+  uint8_t values[256];
+
+  DecodeTable() {
+    memset(values, kInvalid, sizeof(values));
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t i = 0; i < 64; i++) {
+      values[(uint8_t)alphabet[i]] = i;
+    }
+    values['-'] = 62;
+    values['_'] = 63;
+    values['='] = kPad;
+  }
+};
+
+const DecodeTable kTable;
+
+std::atomic<Base64Simd> g_simd_limit{Base64Simd::kAvx2};
+
+// Четверки символов по таблице, пока все символы допустимы
+size_t DecodeQuadsScalar(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t consumed = 0;
+  while (length - consumed >= 4) {
+    uint32_t a = kTable.values[in[consumed]];
+    uint32_t b = kTable.values[in[consumed + 1]];
+    uint32_t c = kTable.values[in[consumed + 2]];
+    uint32_t d = kTable.values[in[consumed + 3]];
+    if ((a | b | c | d) >= 64) {
+      break;
+    }
+    uint32_t word = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = (uint8_t)(word >> 16);
+    out[1] = (uint8_t)(word >> 8);
+    out[2] = (uint8_t)word;
+    out += 3;
+    consumed += 4;
+  }
+  return consumed;
+}
+
+#if defined(BASE64_X86)
+
+// Классификация и перевод символов в 6-битные значения через pshufb по
+// старшему и младшему полубайту (W. Muła, D. Lemire. Faster Base64
+// Encoding and Decoding Using AVX2 Instructions). '-' и '_' сначала
+// заменяются на '+' и '/'.
+BASE64_TARGET_AVX2
+size_t DecodeBlocksAvx2(const uint8_t* in, size_t length, uint8_t* out) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B,
+      0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B,
+      0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0,
+                                            0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+  const __m256i minus = _mm256_set1_epi8('-');
+  const __m256i underscore = _mm256_set1_epi8('_');
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+  size_t consumed = 0;
+  while (length - consumed >= 32) {
+    __m256i chars = _mm256_loadu_si256((const __m256i*)(in + consumed));
+    chars = _mm256_sub_epi8(
+        chars, _mm256_and_si256(_mm256_cmpeq_epi8(chars, minus), _mm256_set1_epi8('-' - '+')));
+    chars = _mm256_sub_epi8(chars, _mm256_and_si256(_mm256_cmpeq_epi8(chars, underscore),
+                                                    _mm256_set1_epi8('_' - '/')));
+    __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask_2f);
+    __m256i lo_nibbles = _mm256_and_si256(chars, mask_2f);
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      break;
+    }
+    __m256i eq_2f = _mm256_cmpeq_epi8(chars, mask_2f);
+    __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    __m256i values = _mm256_add_epi8(chars, roll);
+    // 4 x 6 бит -> 24 бита в каждом 32-битном слове, затем плотная упаковка
+    __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    merged = _mm256_shuffle_epi8(merged, pack);
+    merged = _mm256_permutevar8x32_epi32(merged, lanes);
+    _mm256_storeu_si256((__m256i*)out, merged);
+    out += 24;
+    consumed += 32;
+  }
+  return consumed;
+}
+
+// То же на 128-битных регистрах
+BASE64_TARGET_SSSE3
+size_t DecodeBlocksSsse3(const uint8_t* in, size_t length, uint8_t* out) {
+  const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                       0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                                       0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2F);
+  const __m128i minus = _mm_set1_epi8('-');
+  const __m128i underscore = _mm_set1_epi8('_');
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  size_t consumed = 0;
+  while (length - consumed >= 16) {
+    __m128i chars = _mm_loadu_si128((const __m128i*)(in + consumed));
+    chars = _mm_sub_epi8(chars,
+                         _mm_and_si128(_mm_cmpeq_epi8(chars, minus), _mm_set1_epi8('-' - '+')));
+    chars = _mm_sub_epi8(
+        chars, _mm_and_si128(_mm_cmpeq_epi8(chars, underscore), _mm_set1_epi8('_' - '/')));
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2f);
+    __m128i lo_nibbles = _mm_and_si128(chars, mask_2f);
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+      break;
+    }
+    __m128i eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    __m128i values = _mm_add_epi8(chars, roll);
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    merged = _mm_shuffle_epi8(merged, pack);
+    _mm_storeu_si128((__m128i*)out, merged);
+    out += 12;
+    consumed += 16;
+  }
+  return consumed;
+}
+
+// Поддержка SSSE3 и AVX2 процессором и ОС (проверяется один раз)
+Base64Simd DetectSimd() {
+  static const Base64Simd level = [] {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_saves_ymm) {
+      __cpuidex(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    bool ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return avx2 ? Base64Simd::kAvx2 : ssse3 ? Base64Simd::kSsse3 : Base64Simd::kScalar;
+  }();
+  return level;
+}
+
+#endif  // BASE64_X86
+
+// Сколько символов декодировано целыми четверками (в |out| записано
+// consumed / 4 * 3 байт и, возможно, до kOutputSlack байт мусора после них)
+size_t DecodeBlocks(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t consumed = 0;
+#if defined(BASE64_X86)
+  Base64Simd level = std::min(DetectSimd(), g_simd_limit.load(std::memory_order_relaxed));
+  if (level == Base64Simd::kAvx2) {
+    consumed = DecodeBlocksAvx2(in, length, out);
+  } else if (level == Base64Simd::kSsse3) {
+    consumed = DecodeBlocksSsse3(in, length, out);
+  }
+#endif
+  return consumed + DecodeQuadsScalar(in + consumed, length - consumed, out + consumed / 4 * 3);
+}
+
+}  // namespace
+
+bool Base64Decoder::Update(const char* data, size_t length, std::string* out) {
+  if (failed_) {
+    return false;
+  }
+  size_t base = out->size();
+  out->resize(base + length / 4 * 3 + 3 + kOutputSlack);
+  uint8_t* start = (uint8_t*)&(*out)[0] + base;
+  uint8_t* write = start;
+  const uint8_t* read = (const uint8_t*)data;
+  const uint8_t* end = read + length;
+  bool ok = true;
+  while (read < end) {
+    if (pending_count_ == 0 && !padded_) {
+      size_t consumed = DecodeBlocks(read, (size_t)(end - read), write);
+      read += consumed;
+      write += consumed / 4 * 3;
+      if (read == end) {
+        break;
+      }
+    }
+    uint8_t value = kTable.values[*read++];
+    if (value < 64 && !padded_) {
+      pending_ = (pending_ << 6) | value;
+      if (++pending_count_ == 4) {
+        write[0] = (uint8_t)(pending_ >> 16);
+        write[1] = (uint8_t)(pending_ >> 8);
+        write[2] = (uint8_t)pending_;
+        write += 3;
+        pending_ = 0;
+        pending_count_ = 0;
+      }
+    } else if (value == kPad && !padded_ && pending_count_ >= 2) {
+      // Первый '=' завершает данные: неполная четверка дописывается сразу
+      padded_ = true;
+      padding_left_ = 3 - pending_count_;
+      pending_ <<= 6 * (4 - pending_count_);
+      write[0] = (uint8_t)(pending_ >> 16);
+      write[1] = (uint8_t)(pending_ >> 8);
+      write += pending_count_ - 1;
+      pending_ = 0;
+      pending_count_ = 0;
+    } else if (value == kPad && padded_ && padding_left_ > 0) {
+      padding_left_--;
+    } else {
+      ok = Fail();
+      break;
+    }
+  }
+  out->resize(base + (size_t)(write - start));
+  return ok;
+}
+
+bool Base64Decoder::Finish(std::string* out) {
+  if (failed_ || pending_count_ == 1) {
+    return Fail();
+  }
+  if (pending_count_ > 1) {
+    uint32_t word = pending_ << (6 * (4 - pending_count_));
+    out->push_back((char)(word >> 16));
+    if (pending_count_ == 3) {
+      out->push_back((char)(word >> 8));
+    }
+  }
+  pending_ = 0;
+  pending_count_ = 0;
+  return true;
+}
+
+void Base64Decoder::Reset() {
+  pending_ = 0;
+  pending_count_ = 0;
+  padding_left_ = 0;
+  padded_ = false;
+  failed_ = false;
+}
+
+bool Base64Decoder::Fail() {
+  failed_ = true;
+  return false;
+}
+
+bool Base64Decode(const char* data, size_t length, std::string* out) {
+  Base64Decoder decoder;
+  return decoder.Update(data, length, out) && decoder.Finish(out);
+}
+
+Base64Simd Base64SupportedSimd() {
+#if defined(BASE64_X86)
+  return DetectSimd();
+#else
+  return Base64Simd::kScalar;
+#endif
+}
+
+void SetBase64SimdLimit(Base64Simd limit) {
+  g_simd_limit.store(limit, std::memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+#ifndef RUNNER_BASE64_H_
+#define RUNNER_BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Потоковое декодирование base64: стандартный и URL-safe алфавиты (в том
+// числе вперемешку), '=' в конце необязателен. Пробельные символы не
+// допускаются - как и в base64.decode из Dart.
+//
+// Блоки по 32 символа декодируются AVX2 (по 16 - SSSE3, если AVX2 нет);
+// хвосты, паддинг и блоки с недопустимыми символами - по таблице.
+class Base64Decoder {
+ public:
+  // Декодировать очередной фрагмент и дописать байты в |out|. false -
+  // недопустимый символ или данные после паддинга; после ошибки декодер
+  // отвергает все до Reset().
+  bool Update(const char* data, size_t length, std::string* out);
+
+  // Конец данных: дописать неполную четверку. Один лишний символ - ошибка.
+  bool Finish(std::string* out);
+
+  void Reset();
+
+  bool failed() const { return failed_; }
+
+ private:
+  bool Fail();
+
+  uint32_t pending_ = 0;  // накопленные 6-битные значения
+  int pending_count_ = 0;
+  int padding_left_ = 0;  // сколько '=' еще допустимо
+  bool padded_ = false;
+  bool failed_ = false;
+};
+
+// Декодировать строку целиком
+bool Base64Decode(const char* data, size_t length, std::string* out);
+
+// Векторные реализации декодера по возрастанию
+enum class Base64Simd : uint8_t {
+  kScalar = 0,
+  kSsse3,
+  kAvx2,
+};
+
+// Лучшая реализация, которую поддерживают процессор и ОС
+Base64Simd Base64SupportedSimd();
+
+// Не выбирать реализации выше |limit| (по умолчанию - без ограничения).
+// Для тестов и бенчмарков: так на одном процессоре проверяются все пути.
+void SetBase64SimdLimit(Base64Simd limit);
+
+#endif  // RUNNER_BASE64_H_
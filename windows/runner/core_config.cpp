@@ -0,0 +1,428 @@
+#include "core_config.h"
+
+#include <string.h>
+
+namespace {
+
+// Параметры сервера с поведением Map<String, String> в Dart
+class Params {
+ public:
+  Params(const ServerConfigSet& set, const ServerConfig& config) : set_(set), config_(config) {}
+
+  bool Has(ConfigParam param) const { return config_.Has(param); }
+
+  // params[key] == value
+  bool Is(ConfigParam param, const char* value) const {
+    TextSpan span;
+    return set_.Find(config_, param, &span) && span.length == strlen(value) &&
+           memcmp(set_.text() + span.offset, value, span.length) == 0;
+  }
+
+  // params[key] ?? fallback
+  void Write(JsonWriter* writer, ConfigParam param, const char* fallback) const {
+    TextSpan span;
+    if (set_.Find(config_, param, &span)) {
+      writer->String(set_.text() + span.offset, span.length);
+    } else {
+      writer->String(fallback);
+    }
+  }
+
+  // params[key] ?? другое поле сервера
+  void Write(JsonWriter* writer, ConfigParam param, TextSpan fallback) const {
+    TextSpan span;
+    if (!set_.Find(config_, param, &span)) {
+      span = fallback;
+    }
+    writer->String(set_.text() + span.offset, span.length);
+  }
+
+  void WriteField(JsonWriter* writer, TextSpan span) const {
+    writer->String(set_.text() + span.offset, span.length);
+  }
+
+ private:
+  const ServerConfigSet& set_;
+  const ServerConfig& config_;
+};
+
+void WriteSniffing(JsonWriter* writer) {
+  writer->Key("sniffing");
+  writer->BeginObject();
+  writer->Key("enabled");
+  writer->Bool(true);
+  writer->Key("destOverride");
+  writer->BeginArray();
+  writer->String("http");
+  writer->String("tls");
+  writer->String("quic");
+  writer->EndArray();
+  writer->EndObject();
+}
+
+void WriteHeaderNone(JsonWriter* writer) {
+  writer->Key("header");
+  writer->BeginObject();
+  writer->Key("type");
+  writer->String("none");
+  writer->EndObject();
+}
+
+void WriteRoutingRule(JsonWriter* writer, const char* match, const char* value,
+                      const char* outbound) {
+  writer->BeginObject();
+  writer->Key("type");
+  writer->String("field");
+  writer->Key(match);
+  writer->BeginArray();
+  writer->String(value);
+  writer->EndArray();
+  writer->Key("outboundTag");
+  writer->String(outbound);
+  writer->EndObject();
+}
+
+void WriteStreamSettings(const Params& params, const ServerConfig& config, JsonWriter* writer) {
+  writer->Key("streamSettings");
+  writer->BeginObject();
+  writer->Key("network");
+  params.Write(writer, ConfigParam::kType, "tcp");
+  writer->Key("security");
+  params.Write(writer, ConfigParam::kSecurity, "none");
+
+  writer->Key("tlsSettings");
+  if (params.Is(ConfigParam::kSecurity, "tls")) {
+    writer->BeginObject();
+    writer->Key("serverName");
+    params.Write(writer, ConfigParam::kSni, config.address);
+    writer->Key("allowInsecure");
+    writer->Bool(params.Is(ConfigParam::kAllowInsecure, "true"));
+    writer->EndObject();
+  } else {
+    writer->Null();
+  }
+
+  writer->Key("wsSettings");
+  if (params.Is(ConfigParam::kType, "ws")) {
+    writer->BeginObject();
+    writer->Key("path");
+    params.Write(writer, ConfigParam::kPath, "/");
+    writer->Key("headers");
+    writer->BeginObject();
+    writer->Key("Host");
+    params.Write(writer, ConfigParam::kHost, config.address);
+    writer->EndObject();
+    writer->EndObject();
+  } else {
+    writer->Null();
+  }
+
+  writer->Key("tcpSettings");
+  if (params.Is(ConfigParam::kType, "tcp")) {
+    writer->BeginObject();
+    WriteHeaderNone(writer);
+    writer->EndObject();
+  } else {
+    writer->Null();
+  }
+
+  writer->Key("kcpSettings");
+  if (params.Is(ConfigParam::kType, "kcp")) {
+    writer->BeginObject();
+    writer->Key("mtu");
+    writer->Int(1350);
+    writer->Key("tti");
+    writer->Int(50);
+    writer->Key("uplinkCapacity");
+    writer->Int(12);
+    writer->Key("downlinkCapacity");
+    writer->Int(100);
+    writer->Key("congestion");
+    writer->Bool(false);
+    writer->Key("readBufferSize");
+    writer->Int(2);
+    writer->Key("writeBufferSize");
+    writer->Int(2);
+    WriteHeaderNone(writer);
+    writer->EndObject();
+  } else {
+    writer->Null();
+  }
+
+  writer->Key("grpcSettings");
+  if (params.Is(ConfigParam::kType, "grpc")) {
+    writer->BeginObject();
+    writer->Key("serviceName");
+    params.Write(writer, ConfigParam::kServiceName, "");
+    writer->Key("multiMode");
+    writer->Bool(params.Is(ConfigParam::kMultiMode, "true"));
+    writer->EndObject();
+  } else {
+    writer->Null();
+  }
+  writer->EndObject();
+}
+
+void WriteV2Ray(const Params& params, const ServerConfig& config,
+                const CoreConfigOptions& options, JsonWriter* writer) {
+  writer->BeginObject();
+  writer->Key("log");
+  writer->BeginObject();
+  writer->Key("loglevel");
+  writer->String("warning");
+  writer->Key("access");
+  writer->String(options.access_log.data(), options.access_log.size());
+  writer->Key("error");
+  writer->String(options.error_log.data(), options.error_log.size());
+  writer->EndObject();
+
+  writer->Key("inbounds");
+  writer->BeginArray();
+  writer->BeginObject();
+  writer->Key("port");
+  writer->Int(options.socks_port);
+  writer->Key("listen");
+  writer->String("127.0.0.1");
+  writer->Key("protocol");
+  writer->String("socks");
+  writer->Key("settings");
+  writer->BeginObject();
+  writer->Key("udp");
+  writer->Bool(true);
+  writer->Key("auth");
+  writer->String("noauth");
+  writer->EndObject();
+  WriteSniffing(writer);
+  writer->Key("tag");
+  writer->String("socks-in");
+  writer->EndObject();
+
+  writer->BeginObject();
+  writer->Key("port");
+  writer->Int(options.http_port);
+  writer->Key("listen");
+  writer->String("127.0.0.1");
+  writer->Key("protocol");
+  writer->String("http");
+  writer->Key("settings");
+  writer->BeginObject();
+  writer->EndObject();
+  WriteSniffing(writer);
+  writer->Key("tag");
+  writer->String("http-in");
+  writer->EndObject();
+  writer->EndArray();
+
+  writer->Key("outbounds");
+  writer->BeginArray();
+  writer->BeginObject();
+  writer->Key("protocol");
+  writer->String(config.protocol == SubscriptionProtocol::kVmess ? "vmess" : "vless");
+  writer->Key("settings");
+  writer->BeginObject();
+  writer->Key("vnext");
+  writer->BeginArray();
+  writer->BeginObject();
+  writer->Key("address");
+  params.WriteField(writer, config.address);
+  writer->Key("port");
+  writer->Int(config.port);
+  writer->Key("users");
+  writer->BeginArray();
+  writer->BeginObject();
+  writer->Key("id");
+  params.WriteField(writer, config.id);
+  writer->Key("encryption");
+  params.Write(writer, ConfigParam::kEncryption, "none");
+  writer->Key("flow");
+  params.Write(writer, ConfigParam::kFlow, "");
+  writer->Key("security");
+  params.Write(writer, ConfigParam::kSecurity, "none");
+  writer->EndObject();
+  writer->EndArray();
+  writer->EndObject();
+  writer->EndArray();
+  writer->EndObject();
+  WriteStreamSettings(params, config, writer);
+  writer->Key("mux");
+  writer->BeginObject();
+  writer->Key("enabled");
+  writer->Bool(true);
+  writer->Key("concurrency");
+  writer->Int(8);
+  writer->EndObject();
+  writer->Key("tag");
+  writer->String("proxy");
+  writer->EndObject();
+
+  writer->BeginObject();
+  writer->Key("protocol");
+  writer->String("freedom");
+  writer->Key("settings");
+  writer->BeginObject();
+  writer->Key("domainStrategy");
+  writer->String("UseIP");
+  writer->EndObject();
+  writer->Key("tag");
+  writer->String("direct");
+  writer->EndObject();
+
+  writer->BeginObject();
+  writer->Key("protocol");
+  writer->String("blackhole");
+  writer->Key("settings");
+  writer->BeginObject();
+  writer->EndObject();
+  writer->Key("tag");
+  writer->String("block");
+  writer->EndObject();
+  writer->EndArray();
+
+  writer->Key("routing");
+  writer->BeginObject();
+  writer->Key("domainStrategy");
+  writer->String("IPIfNonMatch");
+  writer->Key("rules");
+  writer->BeginArray();
+  WriteRoutingRule(writer, "ip", "geoip:private", "direct");
+  WriteRoutingRule(writer, "domain", "geosite:category-ads", "block");
+  writer->EndArray();
+  writer->EndObject();
+
+  writer->Key("dns");
+  writer->BeginObject();
+  writer->Key("servers");
+  writer->BeginArray();
+  writer->String("8.8.8.8");
+  writer->String("1.1.1.1");
+  writer->String("localhost");
+  writer->EndArray();
+  writer->EndObject();
+  writer->EndObject();
+}
+
+void WriteTrojan(const Params& params, const ServerConfig& config,
+                 const CoreConfigOptions& options, JsonWriter* writer) {
+  bool verify = !params.Is(ConfigParam::kAllowInsecure, "true");
+  writer->BeginObject();
+  writer->Key("run_type");
+  writer->String("client");
+  writer->Key("local_addr");
+  writer->String("127.0.0.1");
+  writer->Key("local_port");
+  writer->Int(options.socks_port);
+  writer->Key("remote_addr");
+  params.WriteField(writer, config.address);
+  writer->Key("remote_port");
+  writer->Int(config.port);
+  writer->Key("password");
+  writer->BeginArray();
+  params.WriteField(writer, config.id);
+  writer->EndArray();
+  writer->Key("log_level");
+  writer->Int(1);
+
+  writer->Key("ssl");
+  writer->BeginObject();
+  writer->Key("verify");
+  writer->Bool(verify);
+  writer->Key("verify_hostname");
+  writer->Bool(verify);
+  writer->Key("sni");
+  params.Write(writer, ConfigParam::kSni, config.address);
+  writer->Key("alpn");
+  writer->BeginArray();
+  writer->String("h2");
+  writer->String("http/1.1");
+  writer->EndArray();
+  writer->Key("reuse_session");
+  writer->Bool(true);
+  writer->Key("session_ticket");
+  writer->Bool(false);
+  writer->Key("curves");
+  writer->String("");
+  writer->EndObject();
+
+  writer->Key("tcp");
+  writer->BeginObject();
+  writer->Key("no_delay");
+  writer->Bool(true);
+  writer->Key("keep_alive");
+  writer->Bool(true);
+  writer->Key("reuse_port");
+  writer->Bool(false);
+  writer->Key("fast_open");
+  writer->Bool(false);
+  writer->Key("fast_open_qlen");
+  writer->Int(20);
+  writer->EndObject();
+
+  writer->Key("udp");
+  writer->BeginObject();
+  writer->Key("enabled");
+  writer->Bool(params.Has(ConfigParam::kEnableUdp) ? params.Is(ConfigParam::kEnableUdp, "true")
+                                                   : true);
+  writer->Key("timeout");
+  writer->Int(30);
+  writer->Key("prefer_ipv4");
+  writer->Bool(true);
+  writer->EndObject();
+  writer->EndObject();
+}
+
+void WriteShadowsocks(const Params& params, const ServerConfig& config,
+                      const CoreConfigOptions& options, JsonWriter* writer) {
+  writer->BeginObject();
+  writer->Key("server");
+  params.WriteField(writer, config.address);
+  writer->Key("server_port");
+  writer->Int(config.port);
+  writer->Key("password");
+  params.WriteField(writer, config.id);
+  writer->Key("method");
+  params.Write(writer, ConfigParam::kMethod, "aes-256-gcm");
+  writer->Key("local_address");
+  writer->String("127.0.0.1");
+  writer->Key("local_port");
+  writer->Int(options.socks_port);
+  writer->Key("timeout");
+  writer->Int(60);
+  writer->Key("fast_open");
+  writer->Bool(false);
+  writer->Key("reuse_port");
+  writer->Bool(false);
+  writer->Key("no_delay");
+  writer->Bool(true);
+  writer->Key("mode");
+  writer->String(params.Is(ConfigParam::kEnableUdp, "false") ? "tcp_only" : "tcp_and_udp");
+  writer->EndObject();
+}
+
+}  // namespace
+
+CoreKind CoreKindFor(SubscriptionProtocol protocol) {
+  switch (protocol) {
+    case SubscriptionProtocol::kTrojan:
+      return CoreKind::kTrojan;
+    case SubscriptionProtocol::kShadowsocks:
+      return CoreKind::kShadowsocks;
+    default:
+      return CoreKind::kV2Ray;
+  }
+}
+
+void WriteCoreConfig(const ServerConfigSet& set, const ServerConfig& config,
+                     const CoreConfigOptions& options, JsonWriter* writer) {
+  Params params(set, config);
+  switch (CoreKindFor(config.protocol)) {
+    case CoreKind::kV2Ray:
+      WriteV2Ray(params, config, options, writer);
+      break;
+    case CoreKind::kTrojan:
+      WriteTrojan(params, config, options, writer);
+      break;
+    case CoreKind::kShadowsocks:
+      WriteShadowsocks(params, config, options, writer);
+      break;
+  }
+}
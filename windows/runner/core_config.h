@@ -0,0 +1,37 @@
+#ifndef RUNNER_CORE_CONFIG_H_
+#define RUNNER_CORE_CONFIG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "json_writer.h"
+#include "server_config.h"
+
+// Конфигурации ядер (V2Ray для vless/vmess, trojan, sslocal) в том же виде,
+// что строит WindowsVpnService в Dart: те же ключи в том же порядке, null
+// для выключенных разделов, так что файлы совпадают байт в байт.
+// Пишется сразу в JsonWriter, без промежуточных структур.
+
+enum class CoreKind : uint8_t {
+  kV2Ray = 0,
+  kTrojan,
+  kShadowsocks,
+};
+
+struct CoreConfigOptions {
+  // Пути журналов V2Ray (раздел "log")
+  std::string access_log;
+  std::string error_log;
+  uint16_t socks_port = 10808;
+  uint16_t http_port = 10809;
+};
+
+CoreKind CoreKindFor(SubscriptionProtocol protocol);
+
+// Записать конфигурацию ядра для сервера |config| набора |set|
+void WriteCoreConfig(const ServerConfigSet& set, const ServerConfig& config,
+                     const CoreConfigOptions& options, JsonWriter* writer);
+
+#endif  // RUNNER_CORE_CONFIG_H_
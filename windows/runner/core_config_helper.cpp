@@ -0,0 +1,50 @@
+#include "core_config_helper.h"
+#include <string.h>
+
+#include <mutex>
+
+#include "core_config.h"
+#include "native_log.h"
+#include "server_block.h"
+#include "server_config.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Состояние генератора: память переиспользуется между подключениями
+struct CoreConfigState {
+    ServerList servers;
+    ServerConfigSet configs;
+    CoreConfigOptions options;
+    JsonWriter writer;
+};
+
+static std::mutex g_coreConfigMutex;
+static CoreConfigState g_coreConfig;
+
+// Сгенерировать конфигурацию ядра
+EXPORT const char* CoreConfigGenerate(const char* serverJson, const char* accessLog,
+                                      const char* errorLog, int32_t* length) {
+    if (serverJson == NULL || length == NULL) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(g_coreConfigMutex);
+    CoreConfigState& state = g_coreConfig;
+    state.servers.entries.clear();
+    state.servers.params.clear();
+    state.servers.text.clear();
+    if (!ParseServerListJson(serverJson, strlen(serverJson), &state.servers) ||
+        state.servers.entries.size() != 1) {
+        LOG_ERROR("Неверный сервер для конфигурации ядра");
+        return NULL;
+    }
+    state.configs.Clear();
+    state.configs.Append(state.servers.entries, state.servers.params, state.servers.text.data());
+    state.options.access_log.assign(accessLog != NULL ? accessLog : "");
+    state.options.error_log.assign(errorLog != NULL ? errorLog : "");
+
+    state.writer.Reset();
+    WriteCoreConfig(state.configs, state.configs[0], state.options, &state.writer);
+    *length = (int32_t)state.writer.buffer().size();
+    return state.writer.buffer().data();
+}
@@ -0,0 +1,22 @@
+#ifndef CORE_CONFIG_HELPER_H
+#define CORE_CONFIG_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Сгенерировать конфигурацию ядра (core_config.h) для сервера.
+// serverJson - массив из одного объекта VpnConfig.toJson() с протоколом
+// vless, vmess, trojan или ss; accessLog и errorLog - пути журналов V2Ray.
+// Возвращает JSON в UTF-8 (length байт, без завершающего нуля) или NULL.
+// Буфер переиспользуется и действителен до следующего вызова.
+__declspec(dllexport) const char* CoreConfigGenerate(const char* serverJson, const char* accessLog,
+                                                     const char* errorLog, int32_t* length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CORE_CONFIG_HELPER_H
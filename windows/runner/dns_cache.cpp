@@ -0,0 +1,160 @@
+#include "dns_cache.h"
+
+#include <chrono>
+#include <mutex>
+
+std::string DnsCache::Normalize(const std::string& name) {
+  std::string key = name;
+  if (!key.empty() && key.back() == '.') {
+    key.pop_back();
+  }
+  for (char& c : key) {
+    if (c >= 'A' && c <= 'Z') {
+      c = (char)(c - 'A' + 'a');
+    }
+  }
+  return key;
+}
+
+int64_t DnsCache::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+DnsCache::Shard& DnsCache::ShardFor(const std::string& key) {
+  return shards_[std::hash<std::string>()(key) % kShardCount];
+}
+
+DnsCache::Status DnsCache::Lookup(const std::string& name, int64_t now_us,
+                                  std::vector<ResolvedAddress>* addresses, bool* refresh) {
+  if (refresh != nullptr) {
+    *refresh = false;
+  }
+  std::string key = Normalize(name);
+  Shard& shard = ShardFor(key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    return Status::kMiss;
+  }
+  Entry& entry = it->second;
+  if (now_us >= entry.stale_until_us) {
+    return Status::kMiss;
+  }
+  if (entry.negative) {
+    return Status::kNegative;
+  }
+  entry.hits.fetch_add(1, std::memory_order_relaxed);
+  *addresses = entry.addresses;
+  if (now_us < entry.expires_us) {
+    return Status::kFresh;
+  }
+  if (refresh != nullptr) {
+    *refresh = !entry.refreshing.exchange(true, std::memory_order_relaxed);
+  }
+  return Status::kStale;
+}
+
+DnsCache::Entry& DnsCache::Insert(Shard& shard, const std::string& key, int64_t now_us) {
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    return it->second;
+  }
+  if (shard.entries.size() >= kShardCapacity) {
+    // Вытесняем запись, которая раньше всех станет бесполезной
+    auto oldest = shard.entries.begin();
+    for (auto entry = shard.entries.begin(); entry != shard.entries.end(); ++entry) {
+      if (entry->second.stale_until_us < oldest->second.stale_until_us) {
+        oldest = entry;
+      }
+      if (oldest->second.stale_until_us <= now_us) {
+        break;
+      }
+    }
+    shard.entries.erase(oldest);
+  }
+  return shard.entries[key];
+}
+
+void DnsCache::Store(const std::string& name, const std::vector<ResolvedAddress>& addresses,
+                     uint32_t ttl_s, int64_t now_us) {
+  if (addresses.empty()) {
+    StoreNegative(name, ttl_s, now_us);
+    return;
+  }
+  ttl_s = ttl_s < kMinTtlS ? kMinTtlS : (ttl_s > kMaxTtlS ? kMaxTtlS : ttl_s);
+  std::string key = Normalize(name);
+  Shard& shard = ShardFor(key);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  Entry& entry = Insert(shard, key, now_us);
+  entry.addresses = addresses;
+  entry.negative = false;
+  entry.stored_us = now_us;
+  entry.expires_us = now_us + (int64_t)ttl_s * 1000 * 1000;
+  entry.stale_until_us = entry.expires_us + kStaleWindowUs;
+  entry.hits.store(0, std::memory_order_relaxed);
+  entry.refreshing.store(false, std::memory_order_relaxed);
+}
+
+void DnsCache::StoreNegative(const std::string& name, uint32_t ttl_s, int64_t now_us) {
+  ttl_s = ttl_s < kMinTtlS ? kMinTtlS : (ttl_s > kMaxNegativeTtlS ? kMaxNegativeTtlS : ttl_s);
+  std::string key = Normalize(name);
+  Shard& shard = ShardFor(key);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  Entry& entry = Insert(shard, key, now_us);
+  entry.addresses.clear();
+  entry.negative = true;
+  entry.stored_us = now_us;
+  entry.expires_us = now_us + (int64_t)ttl_s * 1000 * 1000;
+  // Отсутствие имени устаревшим не отдается
+  entry.stale_until_us = entry.expires_us;
+  entry.hits.store(0, std::memory_order_relaxed);
+  entry.refreshing.store(false, std::memory_order_relaxed);
+}
+
+void DnsCache::RefreshFailed(const std::string& name) {
+  std::string key = Normalize(name);
+  Shard& shard = ShardFor(key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    it->second.refreshing.store(false, std::memory_order_relaxed);
+  }
+}
+
+void DnsCache::CollectPrefetch(int64_t now_us, size_t limit, std::vector<std::string>* names) {
+  for (Shard& shard : shards_) {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    for (auto& item : shard.entries) {
+      if (names->size() >= limit) {
+        return;
+      }
+      Entry& entry = item.second;
+      int64_t remaining = entry.expires_us - now_us;
+      if (entry.negative || remaining <= 0 ||
+          remaining * 10 > entry.expires_us - entry.stored_us ||
+          entry.hits.load(std::memory_order_relaxed) < kPrefetchHits ||
+          entry.refreshing.exchange(true, std::memory_order_relaxed)) {
+        continue;
+      }
+      names->push_back(item.first);
+    }
+  }
+}
+
+void DnsCache::Clear() {
+  for (Shard& shard : shards_) {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.entries.clear();
+  }
+}
+
+size_t DnsCache::size() const {
+  size_t total = 0;
+  for (const Shard& shard : shards_) {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    total += shard.entries.size();
+  }
+  return total;
+}
@@ -0,0 +1,92 @@
+#ifndef RUNNER_DNS_CACHE_H_
+#define RUNNER_DNS_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "host_resolver.h"
+
+// Кеш разрешения имен, общий для прокси и правил маршрутизации.
+//
+// Записи живут по TTL ответа (в пределах kMinTtlS..kMaxTtlS). Отсутствующие
+// имена тоже кешируются (negative caching, RFC 2308), но недолго. После
+// истечения TTL запись еще kStaleWindowUs отдается как устаревшая, а первый
+// получивший ее обновляет имя в фоне (stale-while-revalidate, RFC 5861):
+// соединение не ждет DNS. Часто запрашиваемые имена обновляются заранее,
+// до истечения TTL (CollectPrefetch()).
+//
+// Хеш-таблица разбита на сегменты со своими shared_mutex: чтения разных
+// потоков не блокируют друг друга. Адреса хранятся с портом 0.
+class DnsCache {
+ public:
+  enum class Status : uint8_t {
+    kMiss,      // имени нет или запись истекла совсем
+    kFresh,     // адреса действительны
+    kStale,     // TTL истек, адреса отданы до обновления
+    kNegative,  // имя не существует
+  };
+
+  static constexpr size_t kShardCount = 32;
+  static constexpr size_t kShardCapacity = 512;
+  static constexpr uint32_t kMinTtlS = 5;
+  static constexpr uint32_t kMaxTtlS = 60 * 60;
+  static constexpr uint32_t kMaxNegativeTtlS = 5 * 60;
+  static constexpr int64_t kStaleWindowUs = 5 * 60 * 1000 * 1000LL;
+  // Имя горячее, если с последнего обновления к нему обращались столько раз
+  static constexpr uint32_t kPrefetchHits = 4;
+
+  // Имя в виде ключа: нижний регистр, без завершающей точки
+  static std::string Normalize(const std::string& name);
+  // Часы для |now_us| (монотонные)
+  static int64_t NowUs();
+
+  // Адреса имени. |refresh| (может быть nullptr - только чтение) выставляется
+  // тому, кто должен обновить запись: первому получившему kStale.
+  Status Lookup(const std::string& name, int64_t now_us, std::vector<ResolvedAddress>* addresses,
+                bool* refresh);
+
+  void Store(const std::string& name, const std::vector<ResolvedAddress>& addresses,
+             uint32_t ttl_s, int64_t now_us);
+  void StoreNegative(const std::string& name, uint32_t ttl_s, int64_t now_us);
+
+  // Обновление не удалось: устаревшая запись доживает свое, следующий
+  // запрос попробует снова
+  void RefreshFailed(const std::string& name);
+
+  // Горячие имена, которым пора обновиться (осталось меньше десятой части
+  // TTL); они помечаются обновляемыми. Не больше |limit| имен.
+  void CollectPrefetch(int64_t now_us, size_t limit, std::vector<std::string>* names);
+
+  void Clear();
+  size_t size() const;
+
+ private:
+  struct Entry {
+    std::vector<ResolvedAddress> addresses;
+    bool negative = false;
+    int64_t stored_us = 0;
+    int64_t expires_us = 0;
+    int64_t stale_until_us = 0;
+    // Меняются под разделяемой блокировкой
+    std::atomic<uint32_t> hits{0};
+    std::atomic<bool> refreshing{false};
+  };
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+  };
+
+  Shard& ShardFor(const std::string& key);
+  Entry& Insert(Shard& shard, const std::string& key, int64_t now_us);
+
+  Shard shards_[kShardCount];
+};
+
+#endif  // RUNNER_DNS_CACHE_H_
@@ -0,0 +1,355 @@
+#include "domain_matcher.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+
+// Алфавит автомата: a-z, 0-9, '-', '.', '_' и "прочие" символы
+constexpr uint32_t kAlphabetSize = 40;
+
+struct AlphabetTable {
+  uint8_t symbol[256];
+  char lower[256];
+
+  AlphabetTable() {
+    for (int c = 0; c < 256; c++) {
+      symbol[c] = kAlphabetSize - 1;
+      lower[c] = (char)c;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+      symbol[c] = (uint8_t)(c - 'a');
+      symbol[c - 'a' + 'A'] = (uint8_t)(c - 'a');
+      lower[c - 'a' + 'A'] = (char)c;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+      symbol[c] = (uint8_t)(26 + c - '0');
+    }
+    symbol[(uint8_t)'-'] = 36;
+    symbol[(uint8_t)'.'] = 37;
+    symbol[(uint8_t)'_'] = 38;
+  }
+};
+
+const AlphabetTable& Alphabet() {
+  static const AlphabetTable table;
+  return table;
+}
+
+bool StartsWith(const char* text, size_t length, const char* prefix) {
+  size_t prefix_length = strlen(prefix);
+  return length >= prefix_length && memcmp(text, prefix, prefix_length) == 0;
+}
+
+}  // namespace
+
+DomainMatcher::DomainMatcher() : nodes_(1), edges_(1024) {}
+
+DomainMatcher::~DomainMatcher() = default;
+
+uint64_t DomainMatcher::LabelHash(uint32_t parent, const char* label, size_t length) {
+  const char* lower = Alphabet().lower;
+  uint64_t hash = 0xCBF29CE484222325ull ^ ((uint64_t)parent * 0x9E3779B97F4A7C15ull);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)lower[(uint8_t)label[i]];
+    hash *= 0x100000001B3ull;
+  }
+  hash ^= hash >> 29;
+  return hash;
+}
+
+uint32_t DomainMatcher::FindChild(uint32_t parent, const char* label, size_t length,
+                                  uint64_t hash) const {
+  const char* lower = Alphabet().lower;
+  size_t mask = edges_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const LabelEdge& edge = edges_[i];
+    if (edge.child == 0) {
+      return 0;
+    }
+    if (edge.hash != hash || edge.parent != parent || edge.label_length != length) {
+      continue;
+    }
+    const char* stored = labels_.data() + edge.label_offset;
+    size_t j = 0;
+    while (j < length && stored[j] == lower[(uint8_t)label[j]]) {
+      j++;
+    }
+    if (j == length) {
+      return edge.child;
+    }
+  }
+}
+
+void DomainMatcher::GrowEdges() {
+  std::vector<LabelEdge> old_edges;
+  old_edges.swap(edges_);
+  edges_.assign(old_edges.size() * 2, LabelEdge());
+  size_t mask = edges_.size() - 1;
+  for (const LabelEdge& edge : old_edges) {
+    if (edge.child == 0) {
+      continue;
+    }
+    size_t i = edge.hash & mask;
+    while (edges_[i].child != 0) {
+      i = (i + 1) & mask;
+    }
+    edges_[i] = edge;
+  }
+}
+
+uint32_t DomainMatcher::AddChild(uint32_t parent, const char* label, size_t length) {
+  uint64_t hash = LabelHash(parent, label, length);
+  uint32_t child = FindChild(parent, label, length, hash);
+  if (child != 0) {
+    return child;
+  }
+  if ((edge_count_ + 1) * 2 > edges_.size()) {
+    GrowEdges();
+  }
+
+  child = (uint32_t)nodes_.size();
+  nodes_.emplace_back();
+
+  LabelEdge edge;
+  edge.hash = hash;
+  edge.parent = parent;
+  edge.child = child;
+  edge.label_offset = (uint32_t)labels_.size();
+  edge.label_length = (uint32_t)length;
+  const char* lower = Alphabet().lower;
+  for (size_t i = 0; i < length; i++) {
+    labels_.push_back(lower[(uint8_t)label[i]]);
+  }
+
+  size_t mask = edges_.size() - 1;
+  size_t i = hash & mask;
+  while (edges_[i].child != 0) {
+    i = (i + 1) & mask;
+  }
+  edges_[i] = edge;
+  edge_count_++;
+  return child;
+}
+
+bool DomainMatcher::AddPattern(PatternType type, const char* pattern, size_t length,
+                               uint32_t rule) {
+  // Точки по краям значимы только для подстроки: ".c" не совпадает с "cn"
+  while (type != PatternType::kKeyword && length > 0 && pattern[length - 1] == '.') {
+    length--;
+  }
+  while (type != PatternType::kKeyword && length > 0 && pattern[0] == '.') {
+    pattern++;
+    length--;
+  }
+  if (length == 0 || rule == kNoRule) {
+    return false;
+  }
+
+  if (type == PatternType::kKeyword) {
+    Keyword keyword;
+    keyword.text.assign(pattern, length);
+    keyword.rule = rule;
+    keywords_.push_back(std::move(keyword));
+    pattern_count_++;
+    return true;
+  }
+
+  // Метки добавляются справа налево: "a.example.com" -> com, example, a
+  uint32_t node = 0;
+  size_t end = length;
+  for (;;) {
+    size_t start = end;
+    while (start > 0 && pattern[start - 1] != '.') {
+      start--;
+    }
+    if (start == end) {
+      return false;  // пустая метка ("a..b")
+    }
+    node = AddChild(node, pattern + start, end - start);
+    if (start == 0) {
+      break;
+    }
+    end = start - 1;
+  }
+
+  uint32_t& slot = (type == PatternType::kFull) ? nodes_[node].full_rule
+                                                : nodes_[node].suffix_rule;
+  slot = std::min(slot, rule);
+  pattern_count_++;
+  return true;
+}
+
+bool DomainMatcher::AddRule(const char* value, size_t length, uint32_t rule) {
+  if (StartsWith(value, length, "full:")) {
+    return AddPattern(PatternType::kFull, value + 5, length - 5, rule);
+  }
+  if (StartsWith(value, length, "domain:")) {
+    return AddPattern(PatternType::kSuffix, value + 7, length - 7, rule);
+  }
+  if (StartsWith(value, length, "keyword:")) {
+    return AddPattern(PatternType::kKeyword, value + 8, length - 8, rule);
+  }
+  if (StartsWith(value, length, "regexp:") || StartsWith(value, length, "geosite:") ||
+      StartsWith(value, length, "ext:")) {
+    return false;
+  }
+  return AddPattern(PatternType::kKeyword, value, length, rule);
+}
+
+size_t DomainMatcher::AddDomainList(const char* text, size_t length, uint32_t rule) {
+  size_t added = 0;
+  size_t position = 0;
+  while (position < length) {
+    size_t end = position;
+    while (end < length && text[end] != '\n') {
+      end++;
+    }
+    size_t line_end = end;
+    // Отбрасываем комментарии и атрибуты
+    for (size_t i = position; i < line_end; i++) {
+      if (text[i] == '#' || text[i] == '@' || text[i] == ' ' || text[i] == '\t' ||
+          text[i] == '\r') {
+        line_end = i;
+        break;
+      }
+    }
+    const char* line = text + position;
+    size_t line_length = line_end - position;
+    if (line_length > 0) {
+      bool ok;
+      if (StartsWith(line, line_length, "full:")) {
+        ok = AddPattern(PatternType::kFull, line + 5, line_length - 5, rule);
+      } else if (StartsWith(line, line_length, "keyword:")) {
+        ok = AddPattern(PatternType::kKeyword, line + 8, line_length - 8, rule);
+      } else if (StartsWith(line, line_length, "domain:")) {
+        ok = AddPattern(PatternType::kSuffix, line + 7, line_length - 7, rule);
+      } else if (StartsWith(line, line_length, "regexp:") ||
+                 StartsWith(line, line_length, "include:")) {
+        ok = false;
+      } else {
+        ok = AddPattern(PatternType::kSuffix, line, line_length, rule);
+      }
+      if (ok) {
+        added++;
+      }
+    }
+    position = end + 1;
+  }
+  return added;
+}
+
+void DomainMatcher::BuildAutomaton() {
+  transitions_.clear();
+  state_rules_.clear();
+  if (keywords_.empty()) {
+    return;
+  }
+
+  const AlphabetTable& alphabet = Alphabet();
+
+  // Бор: 0 в таблице переходов означает "нет ребра" (в корень ребер нет)
+  transitions_.assign(kAlphabetSize, 0);
+  state_rules_.assign(1, kNoRule);
+  for (const Keyword& keyword : keywords_) {
+    uint32_t state = 0;
+    for (char c : keyword.text) {
+      uint32_t symbol = alphabet.symbol[(uint8_t)c];
+      uint32_t next = transitions_[state * kAlphabetSize + symbol];
+      if (next == 0) {
+        next = (uint32_t)state_rules_.size();
+        transitions_[state * kAlphabetSize + symbol] = next;
+        transitions_.resize(transitions_.size() + kAlphabetSize, 0);
+        state_rules_.push_back(kNoRule);
+      }
+      state = next;
+    }
+    state_rules_[state] = std::min(state_rules_[state], keyword.rule);
+  }
+
+  // Обход в ширину: ссылки неудач превращаются в полную таблицу переходов,
+  // а номера правил наследуются по цепочке суффиксов
+  std::vector<uint32_t> failure(state_rules_.size(), 0);
+  std::deque<uint32_t> queue;
+  for (uint32_t symbol = 0; symbol < kAlphabetSize; symbol++) {
+    uint32_t next = transitions_[symbol];
+    if (next != 0) {
+      failure[next] = 0;
+      queue.push_back(next);
+    }
+  }
+  while (!queue.empty()) {
+    uint32_t state = queue.front();
+    queue.pop_front();
+    state_rules_[state] = std::min(state_rules_[state], state_rules_[failure[state]]);
+    for (uint32_t symbol = 0; symbol < kAlphabetSize; symbol++) {
+      uint32_t& next = transitions_[state * kAlphabetSize + symbol];
+      uint32_t fallback = transitions_[failure[state] * kAlphabetSize + symbol];
+      if (next != 0) {
+        failure[next] = fallback;
+        queue.push_back(next);
+      } else {
+        next = fallback;
+      }
+    }
+  }
+
+  keywords_.clear();
+  keywords_.shrink_to_fit();
+}
+
+void DomainMatcher::Build() {
+  BuildAutomaton();
+}
+
+uint32_t DomainMatcher::Match(const char* name, size_t length) const {
+  while (length > 0 && name[length - 1] == '.') {
+    length--;
+  }
+  if (length == 0) {
+    return kNoRule;
+  }
+
+  uint32_t best = kNoRule;
+
+  // Дерево меток: идем от зоны верхнего уровня к началу имени
+  uint32_t node = 0;
+  size_t end = length;
+  for (;;) {
+    size_t start = end;
+    while (start > 0 && name[start - 1] != '.') {
+      start--;
+    }
+    uint32_t child = FindChild(node, name + start, end - start,
+                               LabelHash(node, name + start, end - start));
+    if (child == 0) {
+      break;
+    }
+    node = child;
+    best = std::min(best, nodes_[node].suffix_rule);
+    if (start == 0) {
+      best = std::min(best, nodes_[node].full_rule);
+      break;
+    }
+    end = start - 1;
+  }
+
+  // Ахо-Корасик по всему имени
+  if (!transitions_.empty()) {
+    const uint8_t* symbol = Alphabet().symbol;
+    uint32_t state = 0;
+    for (size_t i = 0; i < length; i++) {
+      state = transitions_[state * kAlphabetSize + symbol[(uint8_t)name[i]]];
+      best = std::min(best, state_rules_[state]);
+    }
+  }
+  return best;
+}
+
+size_t DomainMatcher::MemoryUsage() const {
+  return nodes_.size() * sizeof(LabelNode) + edges_.size() * sizeof(LabelEdge) +
+         labels_.size() + transitions_.size() * sizeof(uint32_t) +
+         state_rules_.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,99 @@
+#ifndef RUNNER_DOMAIN_MATCHER_H_
+#define RUNNER_DOMAIN_MATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "route_action.h"
+
+// Сопоставление доменных имен с правилами типа 'domain'.
+//
+// Правила full: и domain: (суффикс) компилируются в дерево по меткам имени,
+// читаемым справа налево, keyword: - в автомат Ахо-Корасик. Проверка имени -
+// один проход по меткам плюс один проход автомата, без выделений памяти.
+// Результат - наименьший номер совпавшего правила (семантика первого
+// совпадения), поэтому тысячи записей одной категории geosite делят номер
+// исходного правила.
+class DomainMatcher {
+ public:
+  enum class PatternType : uint8_t {
+    kFull = 0,     // точное совпадение имени
+    kSuffix = 1,   // имя или любой его поддомен
+    kKeyword = 2,  // подстрока
+  };
+
+  DomainMatcher();
+  ~DomainMatcher();
+
+  DomainMatcher(const DomainMatcher&) = delete;
+  DomainMatcher& operator=(const DomainMatcher&) = delete;
+
+  // Добавить шаблон с номером правила |rule|. Регистр не учитывается.
+  bool AddPattern(PatternType type, const char* pattern, size_t length, uint32_t rule);
+
+  // Добавить значение в синтаксисе V2Ray: "full:", "domain:", "keyword:" или
+  // строка без префикса (в V2Ray она означает подстроку). "regexp:" не
+  // поддерживается и возвращает false.
+  bool AddRule(const char* value, size_t length, uint32_t rule);
+
+  // Загрузить список в формате domain-list-community (geosite): строка без
+  // префикса - суффикс, "full:", "keyword:", "regexp:" (пропускается),
+  // атрибуты "@..." и комментарии '#' отбрасываются.
+  size_t AddDomainList(const char* text, size_t length, uint32_t rule);
+
+  // Скомпилировать структуры. До вызова Match() обязателен.
+  void Build();
+
+  // Наименьший номер совпавшего правила или kNoRule
+  uint32_t Match(const char* name, size_t length) const;
+
+  size_t pattern_count() const { return pattern_count_; }
+  size_t MemoryUsage() const;
+
+ private:
+  // Узел дерева меток
+  struct LabelNode {
+    uint32_t full_rule = kNoRule;
+    uint32_t suffix_rule = kNoRule;
+  };
+
+  // Ребро дерева меток в хеш-таблице (родитель, метка) -> потомок
+  struct LabelEdge {
+    uint64_t hash = 0;
+    uint32_t parent = 0;
+    uint32_t child = 0;  // 0 - пустая ячейка (корень не бывает потомком)
+    uint32_t label_offset = 0;
+    uint32_t label_length = 0;
+  };
+
+  static uint64_t LabelHash(uint32_t parent, const char* label, size_t length);
+
+  uint32_t FindChild(uint32_t parent, const char* label, size_t length,
+                     uint64_t hash) const;
+  uint32_t AddChild(uint32_t parent, const char* label, size_t length);
+  void GrowEdges();
+
+  void BuildAutomaton();
+
+  // Дерево меток
+  std::vector<LabelNode> nodes_;
+  std::vector<LabelEdge> edges_;
+  size_t edge_count_ = 0;
+  std::string labels_;
+
+  // Ахо-Корасик: сначала бор, после Build() - полная таблица переходов
+  struct Keyword {
+    std::string text;
+    uint32_t rule;
+  };
+  std::vector<Keyword> keywords_;
+  std::vector<uint32_t> transitions_;   // состояние * kAlphabetSize + символ
+  std::vector<uint32_t> state_rules_;   // лучший номер правила в состоянии
+
+  size_t pattern_count_ = 0;
+};
+
+#endif  // RUNNER_DOMAIN_MATCHER_H_
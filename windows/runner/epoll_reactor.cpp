@@ -0,0 +1,284 @@
+#include "epoll_reactor.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+// Событий за один вызов epoll_wait
+constexpr int kMaxEvents = 256;
+
+}  // namespace
+
+void EpollReactor::OpQueue::Push(IoOp* op) {
+  op->next = nullptr;
+  if (tail != nullptr) {
+    tail->next = op;
+  } else {
+    head = op;
+  }
+  tail = op;
+}
+
+IoOp* EpollReactor::OpQueue::Pop() {
+  IoOp* op = head;
+  if (op != nullptr) {
+    head = op->next;
+    if (head == nullptr) {
+      tail = nullptr;
+    }
+    op->next = nullptr;
+  }
+  return op;
+}
+
+EpollReactor::EpollReactor() = default;
+
+EpollReactor::~EpollReactor() {
+  if (wake_ >= 0) {
+    close(wake_);
+  }
+  if (epoll_ >= 0) {
+    close(epoll_);
+  }
+}
+
+bool EpollReactor::Open() {
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_ < 0 || wake_ < 0) {
+    return false;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = wake_;
+  return epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event) == 0;
+}
+
+EpollReactor::SocketState* EpollReactor::State(SocketHandle socket) {
+  if (socket < 0) {
+    return nullptr;
+  }
+  if ((size_t)socket >= sockets_.size()) {
+    sockets_.resize((size_t)socket + 1);
+  }
+  if (!sockets_[socket]) {
+    sockets_[socket].reset(new SocketState());
+  }
+  return sockets_[socket].get();
+}
+
+bool EpollReactor::Attach(SocketHandle socket) {
+  SocketState* state = State(socket);
+  if (state == nullptr) {
+    return false;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.fd = socket;
+  if (epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event) != 0) {
+    return false;
+  }
+  // Новый сокет почти всегда готов к записи; ошибка проявится в send()
+  state->attached = true;
+  state->readable = true;
+  state->writable = true;
+  return true;
+}
+
+bool EpollReactor::Submit(IoOp* op) {
+  SocketState* state = State(op->socket);
+  if (state == nullptr || !state->attached) {
+    op->error = EBADF;
+    return false;
+  }
+  op->transferred = 0;
+  op->error = 0;
+  op->accepted = kInvalidSocket;
+
+  if (op->type == IoOpType::kConnect) {
+    // connect() выполняется сразу; EINPROGRESS ждет готовности к записи
+    if (connect(op->socket, (const sockaddr*)&op->address,
+                (socklen_t)op->address_length) == 0) {
+      Complete(op);
+      return true;
+    }
+    if (errno != EINPROGRESS) {
+      op->error = errno;
+      return false;
+    }
+    state->writable = false;
+    state->writes.Push(op);
+    return true;
+  }
+
+  if (op->type == IoOpType::kAccept || op->type == IoOpType::kRead ||
+      op->type == IoOpType::kSpliceIn) {
+    state->reads.Push(op);
+  } else {
+    state->writes.Push(op);
+  }
+  Progress(state);
+  return true;
+}
+
+bool EpollReactor::TryRead(IoOp* op, SocketState* state) {
+  if (op->type == IoOpType::kAccept) {
+    int client = accept4(op->socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client >= 0) {
+      op->accepted = client;
+      return true;
+    }
+  } else if (op->type == IoOpType::kSpliceIn) {
+    // Канал пуст перед каждой операцией, поэтому EAGAIN означает пустой сокет
+    ssize_t moved = splice(op->socket, nullptr, op->pipe, nullptr, op->length,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (moved >= 0) {
+      op->transferred = (size_t)moved;
+      return true;
+    }
+  } else {
+    ssize_t received = recv(op->socket, op->buffer, op->length, 0);
+    if (received >= 0) {
+      op->transferred = (size_t)received;
+      return true;
+    }
+  }
+  if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    state->readable = false;
+    return false;
+  }
+  if (errno == EINTR) {
+    return false;
+  }
+  op->error = errno;
+  return true;
+}
+
+bool EpollReactor::TryWrite(IoOp* op, SocketState* state) {
+  if (op->type == IoOpType::kConnect) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(op->socket, SOL_SOCKET, SO_ERROR, &error, &length);
+    op->error = error;
+    return true;
+  }
+  while (op->transferred < op->length) {
+    ssize_t sent;
+    if (op->type == IoOpType::kSpliceOut) {
+      sent = splice(op->pipe, nullptr, op->socket, nullptr, op->length - op->transferred,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    } else {
+      sent = send(op->socket, op->buffer + op->transferred, op->length - op->transferred,
+                  MSG_NOSIGNAL);
+    }
+    if (sent >= 0) {
+      op->transferred += (size_t)sent;
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      state->writable = false;
+      return false;
+    }
+    if (errno != EINTR) {
+      op->error = errno;
+      return true;
+    }
+  }
+  return true;
+}
+
+void EpollReactor::Progress(SocketState* state) {
+  while (state->readable && state->reads.head != nullptr) {
+    IoOp* op = state->reads.head;
+    if (!TryRead(op, state)) {
+      if (state->readable) {
+        continue;  // EINTR
+      }
+      break;
+    }
+    Complete(state->reads.Pop());
+  }
+  while (state->writable && state->writes.head != nullptr) {
+    IoOp* op = state->writes.head;
+    if (!TryWrite(op, state)) {
+      if (state->writable) {
+        continue;
+      }
+      break;
+    }
+    Complete(state->writes.Pop());
+  }
+}
+
+void EpollReactor::Complete(IoOp* op) {
+  completed_.Push(op);
+}
+
+void EpollReactor::Close(SocketHandle socket) {
+  if (socket >= 0 && (size_t)socket < sockets_.size() && sockets_[socket]) {
+    SocketState* state = sockets_[socket].get();
+    for (IoOp* op = state->reads.Pop(); op != nullptr; op = state->reads.Pop()) {
+      op->error = ECANCELED;
+      Complete(op);
+    }
+    for (IoOp* op = state->writes.Pop(); op != nullptr; op = state->writes.Pop()) {
+      op->error = ECANCELED;
+      Complete(op);
+    }
+    // Состояние остается для повторного использования номера дескриптора
+    *state = SocketState();
+  }
+  close(socket);
+}
+
+size_t EpollReactor::Poll(int timeout_ms) {
+  epoll_event events[kMaxEvents];
+  int count = epoll_wait(epoll_, events, kMaxEvents,
+                         completed_.head != nullptr ? 0 : timeout_ms);
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == wake_) {
+      uint64_t value;
+      while (read(wake_, &value, sizeof(value)) > 0) {
+      }
+      continue;
+    }
+    if ((size_t)fd >= sockets_.size() || !sockets_[fd] || !sockets_[fd]->attached) {
+      continue;
+    }
+    SocketState* state = sockets_[fd].get();
+    uint32_t flags = events[i].events;
+    if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      state->readable = true;
+    }
+    if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      state->writable = true;
+    }
+    Progress(state);
+  }
+
+  // Доставляем завершения; новые, появившиеся из обработчиков, уйдут в
+  // следующий Poll() с нулевым ожиданием
+  OpQueue ready = completed_;
+  completed_ = OpQueue();
+  size_t delivered = 0;
+  for (IoOp* op = ready.Pop(); op != nullptr; op = ready.Pop()) {
+    op->handler->OnIoComplete(op);
+    delivered++;
+  }
+  return delivered;
+}
+
+void EpollReactor::Wake() {
+  uint64_t value = 1;
+  ssize_t written = write(wake_, &value, sizeof(value));
+  (void)written;
+}
+
+#endif  // defined(__linux__)
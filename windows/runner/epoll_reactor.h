@@ -0,0 +1,64 @@
+#ifndef RUNNER_EPOLL_REACTOR_H_
+#define RUNNER_EPOLL_REACTOR_H_
+
+#if defined(__linux__)
+
+#include <memory>
+#include <vector>
+
+#include "reactor.h"
+
+// Реактор на epoll (edge-triggered). Готовность сокета запоминается, и
+// операции выполняются системным вызовом сразу, пока сокет готов; очередь
+// ожидающих операций разбирается при следующем событии epoll. Завершения
+// копятся в списке и доставляются в конце Poll(), поэтому обработчик
+// никогда не вызывается изнутри Submit().
+class EpollReactor : public Reactor {
+ public:
+  EpollReactor();
+  ~EpollReactor() override;
+
+  bool Open();
+
+  bool Attach(SocketHandle socket) override;
+  bool Submit(IoOp* op) override;
+  void Close(SocketHandle socket) override;
+  size_t Poll(int timeout_ms) override;
+  void Wake() override;
+  bool SupportsSplice() const override { return true; }
+  const char* name() const override { return "epoll"; }
+
+ private:
+  // Очередь операций одного направления
+  struct OpQueue {
+    IoOp* head = nullptr;
+    IoOp* tail = nullptr;
+
+    void Push(IoOp* op);
+    IoOp* Pop();
+  };
+
+  struct SocketState {
+    bool attached = false;
+    bool readable = false;
+    bool writable = false;
+    OpQueue reads;   // kAccept, kRead
+    OpQueue writes;  // kConnect, kWrite
+  };
+
+  SocketState* State(SocketHandle socket);
+  void Progress(SocketState* state);
+  // true - операция завершена, false - сокет перестал быть готов
+  bool TryRead(IoOp* op, SocketState* state);
+  bool TryWrite(IoOp* op, SocketState* state);
+  void Complete(IoOp* op);
+
+  int epoll_ = -1;
+  int wake_ = -1;
+  std::vector<std::unique_ptr<SocketState>> sockets_;
+  OpQueue completed_;
+};
+
+#endif  // defined(__linux__)
+
+#endif  // RUNNER_EPOLL_REACTOR_H_
@@ -0,0 +1,370 @@
+#include "fake_dns_server.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#include "host_resolver.h"
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#endif
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+constexpr int64_t kExpireIntervalMs = 1000;
+
+constexpr size_t kHeaderSize = 12;
+constexpr uint16_t kTypeA = 1;
+constexpr uint8_t kRcodeFormatError = 1;
+constexpr uint8_t kRcodeServerFailure = 2;
+// Попыток найти свободное место под случайный идентификатор
+constexpr int kIdAttempts = 8;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint16_t ReadU16(const uint8_t* data) { return (uint16_t)((data[0] << 8) | data[1]); }
+
+void WriteU16(uint8_t* data, uint16_t value) {
+  data[0] = (uint8_t)(value >> 8);
+  data[1] = (uint8_t)value;
+}
+
+bool IsResponse(const uint8_t* message) { return (message[2] & 0x80) != 0; }
+
+// Разобрать единственный вопрос сообщения (запроса или ответа): имя в
+// нижнем регистре и тип. Возвращает длину заголовка с вопросом или 0.
+size_t ReadQuestion(const uint8_t* message, size_t length, std::string* name, uint16_t* type) {
+  if (length < kHeaderSize || ((message[2] >> 3) & 0x0f) != 0 || ReadU16(message + 4) != 1) {
+    return 0;
+  }
+  name->clear();
+  size_t offset = kHeaderSize;
+  for (;;) {
+    if (offset >= length) {
+      return 0;
+    }
+    uint8_t label = message[offset++];
+    if (label == 0) {
+      break;
+    }
+    // Сжатие имен в вопросе не встречается
+    if (label > 63 || offset + label > length ||
+        name->size() + label + 1 > FakeIpTable::kMaxDomain + 1) {
+      return 0;
+    }
+    if (!name->empty()) {
+      name->push_back('.');
+    }
+    for (size_t i = 0; i < label; i++) {
+      char c = (char)message[offset + i];
+      name->push_back(c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+    }
+    offset += label;
+  }
+  if (offset + 4 > length) {
+    return 0;
+  }
+  *type = ReadU16(message + offset);
+  return offset + 4;
+}
+
+// Вопрос запроса клиента; 0 - запрос не подходит
+size_t ParseQuestion(const uint8_t* message, size_t length, std::string* name, uint16_t* type) {
+  if (length < kHeaderSize || IsResponse(message)) {
+    return 0;
+  }
+  return ReadQuestion(message, length, name, type);
+}
+
+// Заголовок ответа на запрос |query| с одним вопросом и |answers| ответами;
+// дополнительные записи (EDNS) не возвращаются
+void WriteResponseHeader(uint8_t* response, const uint8_t* query, uint16_t answers,
+                         uint8_t rcode) {
+  response[0] = query[0];
+  response[1] = query[1];
+  response[2] = (uint8_t)(0x80 | (query[2] & 0x01));  // QR, RD из запроса
+  response[3] = (uint8_t)(0x80 | rcode);              // RA
+  WriteU16(response + 4, 1);
+  WriteU16(response + 6, answers);
+  WriteU16(response + 8, 0);
+  WriteU16(response + 10, 0);
+}
+
+bool SameAddress(const sockaddr_storage& a, const sockaddr_storage& b) {
+  if (a.ss_family != b.ss_family) {
+    return false;
+  }
+  if (a.ss_family == AF_INET) {
+    const sockaddr_in* left = (const sockaddr_in*)&a;
+    const sockaddr_in* right = (const sockaddr_in*)&b;
+    return left->sin_port == right->sin_port &&
+           memcmp(&left->sin_addr, &right->sin_addr, sizeof(left->sin_addr)) == 0;
+  }
+  const sockaddr_in6* left = (const sockaddr_in6*)&a;
+  const sockaddr_in6* right = (const sockaddr_in6*)&b;
+  return left->sin6_port == right->sin6_port &&
+         memcmp(&left->sin6_addr, &right->sin6_addr, sizeof(left->sin6_addr)) == 0;
+}
+
+}  // namespace
+
+FakeDnsServer::FakeDnsServer(FakeIpTable* table, FakePredicate should_fake)
+    : table_(table), should_fake_(std::move(should_fake)) {
+  for (SocketHandle& socket : upstream_sockets_) {
+    socket = kInvalidSocket;
+  }
+  // Идентификаторы пересылки не должен угадать тот, кто не видит запросов
+  std::random_device device;
+  std::seed_seq seed{device(), device(), device(), device(), device(), device(), device(),
+                     device()};
+  random_.seed(seed);
+}
+
+FakeDnsServer::~FakeDnsServer() { Stop(); }
+
+bool FakeDnsServer::Start(const Options& options) {
+  if (running_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  options_ = options;
+
+  sockaddr_storage address;
+  int length;
+  if (!ParseIpLiteral(options_.listen_address, options_.port, &address, &length) ||
+      !ParseIpLiteral(options_.upstream, options_.upstream_port, &upstream_, &upstream_length_)) {
+    return false;
+  }
+
+  socket_ = socket(address.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+  socklen_t bound_length = sizeof(address);
+  bool ok = socket_ != kInvalidSocket && SetSocketNonBlocking(socket_) &&
+            bind(socket_, (const sockaddr*)&address, (socklen_t)length) == 0 &&
+            getsockname(socket_, (sockaddr*)&address, &bound_length) == 0;
+  // Сокеты пересылки: порт 0 - случайный эфемерный порт ОС
+  sockaddr_storage any = {};
+  any.ss_family = upstream_.ss_family;
+  for (size_t i = 0; ok && i < kUpstreamSockets; i++) {
+    upstream_sockets_[i] = socket(upstream_.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    ok = upstream_sockets_[i] != kInvalidSocket && SetSocketNonBlocking(upstream_sockets_[i]) &&
+         bind(upstream_sockets_[i], (const sockaddr*)&any,
+              (socklen_t)(any.ss_family == AF_INET ? sizeof(sockaddr_in)
+                                                   : sizeof(sockaddr_in6))) == 0;
+  }
+  if (!ok) {
+    CloseSockets();
+    return false;
+  }
+  port_ = ntohs(address.ss_family == AF_INET ? ((sockaddr_in*)&address)->sin_port
+                                             : ((sockaddr_in6*)&address)->sin6_port);
+
+  pending_.reset(new Pending[kMaxPending]);
+  next_expire_ms_ = NowMs() + kExpireIntervalMs;
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&FakeDnsServer::Loop, this);
+  return true;
+}
+
+void FakeDnsServer::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  thread_.join();
+  CloseSockets();
+  pending_.reset();
+}
+
+void FakeDnsServer::CloseSockets() {
+  if (socket_ != kInvalidSocket) {
+    CloseSocketHandle(socket_);
+    socket_ = kInvalidSocket;
+  }
+  for (SocketHandle& socket : upstream_sockets_) {
+    if (socket != kInvalidSocket) {
+      CloseSocketHandle(socket);
+      socket = kInvalidSocket;
+    }
+  }
+}
+
+void FakeDnsServer::Loop() {
+  uint8_t message[kMaxMessage];
+  // Первый - сокет клиентов, за ним сокеты пересылки
+#if defined(_WIN32)
+  WSAPOLLFD fds[1 + kUpstreamSockets];
+#else
+  pollfd fds[1 + kUpstreamSockets];
+#endif
+  for (size_t i = 0; i <= kUpstreamSockets; i++) {
+    fds[i].fd = i == 0 ? socket_ : upstream_sockets_[i - 1];
+#if defined(_WIN32)
+    fds[i].events = POLLRDNORM;
+#else
+    fds[i].events = POLLIN;
+#endif
+  }
+  while (running_.load(std::memory_order_acquire)) {
+    for (auto& fd : fds) {
+      fd.revents = 0;
+    }
+#if defined(_WIN32)
+    int ready = WSAPoll(fds, (ULONG)(1 + kUpstreamSockets), kPollTimeoutMs);
+#else
+    int ready = poll(fds, 1 + kUpstreamSockets, kPollTimeoutMs);
+#endif
+    for (size_t i = 0; ready > 0 && i <= kUpstreamSockets; i++) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      SocketHandle socket = fds[i].fd;
+      // Сокеты неблокирующие: читаем все, что накопилось
+      for (;;) {
+        sockaddr_storage from = {};
+        socklen_t from_length = sizeof(from);
+        int received = recvfrom(socket, (char*)message, (int)sizeof(message), 0,
+                                (sockaddr*)&from, &from_length);
+        if (received <= 0) {
+          break;
+        }
+        if (i == 0) {
+          OnQuery(message, (size_t)received, from, (int)from_length);
+        } else {
+          OnUpstreamReply(i - 1, message, (size_t)received, from);
+        }
+      }
+    }
+    int64_t now = NowMs();
+    if (now >= next_expire_ms_) {
+      ExpirePending(now);
+      next_expire_ms_ = now + kExpireIntervalMs;
+    }
+  }
+}
+
+void FakeDnsServer::OnQuery(uint8_t* message, size_t length, const sockaddr_storage& from,
+                            int from_length) {
+  std::string name;
+  uint16_t type = 0;
+  size_t question_length = ParseQuestion(message, length, &name, &type);
+  if (question_length == 0) {
+    // Без единственного вопроса ответ нельзя сверить с запросом
+    if (length >= kHeaderSize && !IsResponse(message)) {
+      ReplyError(message, kRcodeFormatError, from, from_length);
+    }
+    return;
+  }
+  if (name.empty() || !should_fake_ || !should_fake_(name)) {
+    Forward(message, length, name, type, from, from_length);
+    return;
+  }
+  uint32_t address = type == kTypeA ? table_->Assign(name) : 0;
+  if (type == kTypeA && address == 0) {
+    Forward(message, length, name, type, from, from_length);
+    return;
+  }
+
+  uint8_t response[kMaxMessage];
+  memcpy(response, message, question_length);
+  WriteResponseHeader(response, message, type == kTypeA ? 1 : 0, 0);
+  size_t response_length = question_length;
+  if (type == kTypeA) {
+    uint8_t* answer = response + response_length;
+    WriteU16(answer, 0xc000 | kHeaderSize);  // ссылка на имя вопроса
+    WriteU16(answer + 2, kTypeA);
+    WriteU16(answer + 4, 1);  // IN
+    WriteU16(answer + 6, (uint16_t)(kFakeTtlS >> 16));
+    WriteU16(answer + 8, (uint16_t)kFakeTtlS);
+    WriteU16(answer + 10, 4);
+    WriteU16(answer + 12, (uint16_t)(address >> 16));
+    WriteU16(answer + 14, (uint16_t)address);
+    response_length += 16;
+  }
+  faked_.fetch_add(1, std::memory_order_relaxed);
+  Reply(response, response_length, from, from_length);
+}
+
+void FakeDnsServer::Forward(uint8_t* message, size_t length, const std::string& name,
+                            uint16_t type, const sockaddr_storage& from, int from_length) {
+  Pending* pending = nullptr;
+  uint16_t id = 0;
+  for (int attempt = 0; attempt < kIdAttempts && pending == nullptr; attempt++) {
+    id = (uint16_t)random_();
+    if (!pending_[id % kMaxPending].used) {
+      pending = &pending_[id % kMaxPending];
+    }
+  }
+  if (pending == nullptr) {
+    // Почти все места заняты неотвеченными запросами
+    ReplyError(message, kRcodeServerFailure, from, from_length);
+    return;
+  }
+  size_t socket = random_() % kUpstreamSockets;
+  pending->used = true;
+  pending->id = id;
+  pending->client_id = ReadU16(message);
+  pending->socket = (uint8_t)socket;
+  pending->type = type;
+  pending->name = name;
+  pending->client = from;
+  pending->client_length = from_length;
+  pending->deadline_ms = NowMs() + options_.upstream_timeout_ms;
+
+  WriteU16(message, id);
+  sendto(upstream_sockets_[socket], (const char*)message, (int)length, 0,
+         (const sockaddr*)&upstream_, (socklen_t)upstream_length_);
+  forwarded_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FakeDnsServer::OnUpstreamReply(size_t socket, uint8_t* message, size_t length,
+                                    const sockaddr_storage& from) {
+  if (length < kHeaderSize || !SameAddress(from, upstream_) || !IsResponse(message)) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  uint16_t id = ReadU16(message);
+  Pending& pending = pending_[id % kMaxPending];
+  std::string name;
+  uint16_t type = 0;
+  if (!pending.used || pending.id != id || pending.socket != socket ||
+      ReadQuestion(message, length, &name, &type) == 0 || type != pending.type ||
+      name != pending.name) {
+    // Запоздавший или подделанный ответ: ожидающий запрос не трогаем
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  pending.used = false;
+  WriteU16(message, pending.client_id);
+  Reply(message, length, pending.client, pending.client_length);
+}
+
+void FakeDnsServer::ReplyError(const uint8_t* query, uint8_t rcode, const sockaddr_storage& to,
+                               int to_length) {
+  uint8_t response[kHeaderSize];
+  WriteResponseHeader(response, query, 0, rcode);
+  WriteU16(response + 4, 0);
+  Reply(response, sizeof(response), to, to_length);
+}
+
+void FakeDnsServer::Reply(const uint8_t* message, size_t length, const sockaddr_storage& to,
+                          int to_length) {
+  sendto(socket_, (const char*)message, (int)length, 0, (const sockaddr*)&to,
+         (socklen_t)to_length);
+}
+
+void FakeDnsServer::ExpirePending(int64_t now_ms) {
+  // Без ответа вышестоящего сервера клиент повторит запрос сам
+  for (size_t i = 0; i < kMaxPending; i++) {
+    if (pending_[i].used && pending_[i].deadline_ms <= now_ms) {
+      pending_[i].used = false;
+    }
+  }
+}
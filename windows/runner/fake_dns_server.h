@@ -0,0 +1,114 @@
+#ifndef RUNNER_FAKE_DNS_SERVER_H_
+#define RUNNER_FAKE_DNS_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "fake_ip_table.h"
+#include "reactor.h"
+
+// DNS-сервер режима fake-IP (UDP).
+//
+// На A-запрос имени, которое уходит в прокси, сразу отвечает адресом из
+// FakeIpTable с TTL kFakeTtlS - без обращения к настоящему DNS: имя
+// разрешит удаленная сторона, а локальная сеть его не увидит. AAAA, HTTPS
+// и прочие типы для таких имен получают пустой ответ, чтобы приложение
+// не обошло фиктивный адрес. Запросы остальных имен пересылаются
+// вышестоящему серверу.
+//
+// Пересылка защищена от подделки ответов (RFC 5452): идентификатор
+// пересланного запроса случайный, запрос уходит со случайно выбранного из
+// kUpstreamSockets сокетов (у каждого свой случайный порт ОС), а ответ
+// принимается только от вышестоящего сервера, на тот же сокет, с тем же
+// идентификатором и тем же вопросом.
+class FakeDnsServer {
+ public:
+  // Выдавать ли имени фиктивный адрес (вызывается из потока сервера)
+  using FakePredicate = std::function<bool(const std::string& domain)>;
+
+  struct Options {
+    std::string listen_address = "127.0.0.1";
+    uint16_t port = 10853;  // 0 - выбрать свободный порт
+    std::string upstream = "8.8.8.8";
+    uint16_t upstream_port = 53;
+    uint32_t upstream_timeout_ms = 3000;
+  };
+
+  static constexpr uint32_t kFakeTtlS = 1;
+  // Ответ вышестоящего сервера с EDNS может быть больше 512 байт
+  static constexpr size_t kMaxMessage = 4096;
+  // Пересылок в ожидании ответа
+  static constexpr size_t kMaxPending = 1024;
+  // Сокетов для пересылки вышестоящему серверу
+  static constexpr size_t kUpstreamSockets = 8;
+
+  FakeDnsServer(FakeIpTable* table, FakePredicate should_fake);
+  ~FakeDnsServer();
+
+  FakeDnsServer(const FakeDnsServer&) = delete;
+  FakeDnsServer& operator=(const FakeDnsServer&) = delete;
+
+  bool Start(const Options& options);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+  uint16_t port() const { return port_; }
+
+  uint64_t faked_count() const { return faked_.load(std::memory_order_relaxed); }
+  uint64_t forwarded_count() const { return forwarded_.load(std::memory_order_relaxed); }
+  // Ответы вышестоящему серверу не подошли к ожидающему запросу
+  uint64_t rejected_count() const { return rejected_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Pending {
+    bool used = false;
+    uint16_t id = 0;         // идентификатор в пересланном запросе
+    uint16_t client_id = 0;  // исходный идентификатор клиента
+    uint8_t socket = 0;      // номер сокета пересылки
+    uint16_t type = 0;       // вопрос запроса
+    std::string name;
+    sockaddr_storage client = {};
+    int client_length = 0;
+    int64_t deadline_ms = 0;
+  };
+
+  void Loop();
+  void OnQuery(uint8_t* message, size_t length, const sockaddr_storage& from, int from_length);
+  void OnUpstreamReply(size_t socket, uint8_t* message, size_t length,
+                       const sockaddr_storage& from);
+  void Forward(uint8_t* message, size_t length, const std::string& name, uint16_t type,
+               const sockaddr_storage& from, int from_length);
+  void ReplyError(const uint8_t* query, uint8_t rcode, const sockaddr_storage& to, int to_length);
+  void Reply(const uint8_t* message, size_t length, const sockaddr_storage& to, int to_length);
+  void ExpirePending(int64_t now_ms);
+  void CloseSockets();
+
+  FakeIpTable* table_;
+  FakePredicate should_fake_;
+  Options options_;
+  SocketHandle socket_ = kInvalidSocket;
+  SocketHandle upstream_sockets_[kUpstreamSockets];
+  sockaddr_storage upstream_ = {};
+  int upstream_length_ = 0;
+  uint16_t port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  // Поток сервера
+  std::unique_ptr<Pending[]> pending_;
+  std::mt19937 random_;
+  int64_t next_expire_ms_ = 0;
+
+  std::atomic<uint64_t> faked_{0};
+  std::atomic<uint64_t> forwarded_{0};
+  std::atomic<uint64_t> rejected_{0};
+};
+
+#endif  // RUNNER_FAKE_DNS_SERVER_H_
@@ -0,0 +1,161 @@
+#include "fake_ip_table.h"
+
+#include "dns_cache.h"
+
+namespace {
+
+// Вытесненных записей, после которых пробуем их освободить
+constexpr size_t kReclaimBatch = 64;
+
+}  // namespace
+
+FakeIpTable::FakeIpTable()
+    : FakeIpTable(kDefaultBase, kDefaultPrefixLength, kDefaultCapacity) {}
+
+FakeIpTable::FakeIpTable(uint32_t base, int prefix_length, size_t capacity) {
+  if (prefix_length < 8) {
+    prefix_length = 8;
+  } else if (prefix_length > 30) {
+    prefix_length = 30;
+  }
+  size_ = 1u << (32 - prefix_length);
+  base_ = base & ~(size_ - 1);
+  // Адрес сети и широковещательный не выдаются
+  capacity_ = capacity < size_ - 2 ? capacity : size_ - 2;
+  if (capacity_ == 0) {
+    capacity_ = 1;
+  }
+  by_address_.reset(new std::atomic<const Mapping*>[size_]);
+  for (uint32_t i = 0; i < size_; i++) {
+    by_address_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+FakeIpTable::~FakeIpTable() {
+  // Читателей к моменту разрушения быть не должно
+  for (auto& entry : by_domain_) {
+    delete entry.second;
+  }
+  for (auto& retired : retired_) {
+    delete retired.second;
+  }
+}
+
+uint32_t FakeIpTable::Assign(const std::string& domain) {
+  std::string key = DnsCache::Normalize(domain);
+  if (key.empty() || key.size() > kMaxDomain) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_domain_.find(key);
+  if (found != by_domain_.end()) {
+    Mapping* mapping = found->second;
+    Unlink(mapping);
+    PushFront(mapping);
+    mapping->used.store(false, std::memory_order_relaxed);
+    return base_ + mapping->offset;
+  }
+
+  while (by_domain_.size() >= capacity_) {
+    Mapping* victim = tail_;
+    Unlink(victim);
+    if (victim->used.exchange(false, std::memory_order_relaxed)) {
+      // Адресом пользовались: второй шанс
+      PushFront(victim);
+      continue;
+    }
+    Evict(victim);
+  }
+
+  // Следующий свободный адрес по кругу; свободный есть, так как записей
+  // меньше, чем адресов
+  while (by_address_[next_offset_].load(std::memory_order_relaxed) != nullptr) {
+    next_offset_ = next_offset_ + 1 < size_ - 1 ? next_offset_ + 1 : 1;
+  }
+  Mapping* mapping = new Mapping();
+  mapping->domain = key;
+  mapping->offset = next_offset_;
+  next_offset_ = next_offset_ + 1 < size_ - 1 ? next_offset_ + 1 : 1;
+  by_domain_.emplace(key, mapping);
+  PushFront(mapping);
+  by_address_[mapping->offset].store(mapping, std::memory_order_release);
+  return base_ + mapping->offset;
+}
+
+bool FakeIpTable::Lookup(uint32_t ipv4, std::string* domain) const {
+  if (!Contains(ipv4)) {
+    return false;
+  }
+  size_t slot = epochs_.Enter();
+  const Mapping* mapping = by_address_[ipv4 - base_].load(std::memory_order_seq_cst);
+  if (mapping != nullptr) {
+    *domain = mapping->domain;
+    mapping->used.store(true, std::memory_order_relaxed);
+  }
+  epochs_.Exit(slot);
+  return mapping != nullptr;
+}
+
+void FakeIpTable::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (tail_ != nullptr) {
+    Mapping* victim = tail_;
+    Unlink(victim);
+    Evict(victim);
+  }
+  next_offset_ = 1;
+}
+
+size_t FakeIpTable::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return by_domain_.size();
+}
+
+void FakeIpTable::Unlink(Mapping* mapping) {
+  if (mapping->prev != nullptr) {
+    mapping->prev->next = mapping->next;
+  } else {
+    head_ = mapping->next;
+  }
+  if (mapping->next != nullptr) {
+    mapping->next->prev = mapping->prev;
+  } else {
+    tail_ = mapping->prev;
+  }
+  mapping->prev = nullptr;
+  mapping->next = nullptr;
+}
+
+void FakeIpTable::PushFront(Mapping* mapping) {
+  mapping->next = head_;
+  if (head_ != nullptr) {
+    head_->prev = mapping;
+  }
+  head_ = mapping;
+  if (tail_ == nullptr) {
+    tail_ = mapping;
+  }
+}
+
+void FakeIpTable::Evict(Mapping* mapping) {
+  by_domain_.erase(mapping->domain);
+  by_address_[mapping->offset].store(nullptr, std::memory_order_seq_cst);
+  retired_.emplace_back(epochs_.Advance(), mapping);
+  if (retired_.size() >= kReclaimBatch) {
+    Reclaim();
+  }
+}
+
+void FakeIpTable::Reclaim() {
+  uint64_t min_active = epochs_.MinActiveEpoch();
+  size_t kept = 0;
+  for (auto& retired : retired_) {
+    if (retired.first < min_active) {
+      delete retired.second;
+    } else {
+      retired_[kept++] = retired;
+    }
+  }
+  retired_.resize(kept);
+}
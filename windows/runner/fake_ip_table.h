@@ -0,0 +1,89 @@
+#ifndef RUNNER_FAKE_IP_TABLE_H_
+#define RUNNER_FAKE_IP_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rcu_pointer.h"
+
+// Соответствие имен и фиктивных адресов fake-IP DNS.
+//
+// Имени выдается адрес из зарезервированного пула (по умолчанию
+// 198.18.0.0/15, RFC 2544), а прокси по адресу назначения восстанавливает
+// имя и соединяется уже с ним - приложение не ждет настоящего DNS. Адреса
+// выдаются по кругу через весь пул, поэтому освобожденный адрес достается
+// другому имени как можно позже.
+//
+// Число записей ограничено; при переполнении вытесняется давно не
+// запрашивавшаяся запись (LRU со вторым шансом: запись, адрес которой с
+// прошлого раза искали, переносится в начало). Lookup() по адресу не
+// блокируется: указатели на записи читаются атомарно, а вытесненные
+// записи удаляются по эпохам читателей (EpochDomain), как в RcuPointer.
+class FakeIpTable {
+ public:
+  static constexpr uint32_t kDefaultBase = 0xC6120000;  // 198.18.0.0
+  static constexpr int kDefaultPrefixLength = 15;
+  static constexpr size_t kDefaultCapacity = 65536;
+  static constexpr size_t kMaxDomain = 253;
+
+  FakeIpTable();
+  // Адреса в порядке байт хоста; |prefix_length| от 8 до 30
+  FakeIpTable(uint32_t base, int prefix_length, size_t capacity);
+  ~FakeIpTable();
+
+  FakeIpTable(const FakeIpTable&) = delete;
+  FakeIpTable& operator=(const FakeIpTable&) = delete;
+
+  // Адрес из пула (в том числе не выданный)
+  bool Contains(uint32_t ipv4) const { return ipv4 - base_ < size_; }
+
+  // Адрес имени; новое имя получает следующий свободный адрес. 0 - имя
+  // пустое или длиннее kMaxDomain.
+  uint32_t Assign(const std::string& domain);
+
+  // Имя, которому выдан адрес. Без блокировок.
+  bool Lookup(uint32_t ipv4, std::string* domain) const;
+
+  void Clear();
+  size_t size() const;
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Mapping {
+    std::string domain;
+    uint32_t offset = 0;
+    // Адрес искали с момента переноса в начало списка
+    mutable std::atomic<bool> used{false};
+    Mapping* prev = nullptr;
+    Mapping* next = nullptr;
+  };
+
+  void Unlink(Mapping* mapping);
+  void PushFront(Mapping* mapping);
+  void Evict(Mapping* mapping);
+  void Reclaim();
+
+  uint32_t base_;
+  uint32_t size_;
+  size_t capacity_;
+  std::unique_ptr<std::atomic<const Mapping*>[]> by_address_;
+  mutable EpochDomain epochs_;
+
+  // Изменения - под mutex_
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Mapping*> by_domain_;
+  Mapping* head_ = nullptr;  // недавно запрошенные
+  Mapping* tail_ = nullptr;
+  uint32_t next_offset_ = 1;
+  std::vector<std::pair<uint64_t, Mapping*>> retired_;
+};
+
+#endif  // RUNNER_FAKE_IP_TABLE_H_
@@ -0,0 +1,36 @@
+#include "flow_route.h"
+
+RouteQuery FlowRouteQuery(const PacketHeaders& headers, const FakeIpTable& fake_ips,
+                          const SniffResult* sniffed, std::string* domain) {
+  RouteQuery query;
+  if (headers.IsIpv4()) {
+    uint32_t destination = headers.ipv4_destination();
+    if (fake_ips.Lookup(destination, domain)) {
+      query.domain = domain->c_str();
+      query.domain_length = domain->size();
+    } else {
+      query.family = 4;
+      query.ipv4 = destination;
+    }
+  } else {
+    query.family = 6;
+    memcpy(query.ipv6, headers.ipv6_destination(), sizeof(query.ipv6));
+  }
+  query.port = headers.destination_port();
+  query.protocols = headers.IsTcp() ? kRouteProtocolTcp : kRouteProtocolUdp;
+
+  if (sniffed != nullptr) {
+    if (query.domain == nullptr && sniffed->host_length > 0) {
+      query.domain = sniffed->host;
+      query.domain_length = sniffed->host_length;
+    }
+    if (sniffed->protocol == SniffProtocol::kHttp) {
+      query.protocols |= kRouteProtocolHttp;
+    } else if (sniffed->protocol == SniffProtocol::kTls) {
+      query.protocols |= kRouteProtocolTls;
+    } else if (sniffed->protocol == SniffProtocol::kQuic) {
+      query.protocols |= kRouteProtocolQuic;
+    }
+  }
+  return query;
+}
@@ -0,0 +1,24 @@
+#ifndef RUNNER_FLOW_ROUTE_H_
+#define RUNNER_FLOW_ROUTE_H_
+
+#include <string>
+
+#include "fake_ip_table.h"
+#include "packet_headers.h"
+#include "rule_program.h"
+#include "traffic_sniffer.h"
+
+// Запрос к профилю маршрутизации для нового потока: адрес и порт
+// назначения, транспорт и имя, если оно известно.
+//
+// Адрес из пула fake-IP настоящим не является: он попадает в 198.18.0.0/15,
+// то есть под geoip:private, и поток ушел бы напрямую. Поэтому для него
+// запрос строится только по выданному имени (family = 0), как для
+// соединения, адрес которого еще не разрешен. |sniffed| - имя и протокол из
+// первых данных потока (nullptr, пока их нет); имя fake-IP точнее SNI и Host.
+// Имя fake-IP копируется в |domain|, запрос ссылается на него и на |sniffed|.
+// Процесс-владелец заполняет вызывающий.
+RouteQuery FlowRouteQuery(const PacketHeaders& headers, const FakeIpTable& fake_ips,
+                          const SniffResult* sniffed, std::string* domain);
+
+#endif  // RUNNER_FLOW_ROUTE_H_
@@ -0,0 +1,527 @@
+#include "flow_table.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FLOW_TABLE_PAUSE() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FLOW_TABLE_PAUSE() _mm_pause()
+#else
+#define FLOW_TABLE_PAUSE() ((void)0)
+#endif
+
+namespace {
+
+constexpr uint32_t kSlotEmpty = 0;
+constexpr uint32_t kSlotTombstone = 1;
+constexpr uint32_t kNoLink = 0xFFFFFFFF;
+
+constexpr size_t kKeyWords = sizeof(FlowKey) / sizeof(uint64_t);
+constexpr size_t kValueWords = sizeof(FlowValue) / sizeof(uint64_t);
+
+// Метка ячейки из хеша (0 и 1 зарезервированы под пустую и удаленную)
+uint32_t TagFor(uint64_t hash) {
+  return (uint32_t)(hash >> 32) | 2;
+}
+
+size_t RoundUpPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+size_t SlotsPerShard(size_t capacity, size_t shard_count) {
+  size_t per_shard = RoundUpPowerOfTwo((capacity + shard_count - 1) / shard_count);
+  return per_shard < 16 ? 16 : per_shard;
+}
+
+uint64_t HashWords(const uint64_t* words) {
+  uint64_t hash = 0x9E3779B97F4A7C15ull;
+  for (size_t i = 0; i < kKeyWords; i++) {
+    hash ^= words[i];
+    hash *= 0xBF58476D1CE4E5B9ull;
+    hash ^= hash >> 31;
+  }
+  hash *= 0x94D049BB133111EBull;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+}  // namespace
+
+FlowKey FlowKey::FromHeaders(const PacketHeaders& headers) {
+  FlowKey key;
+  key.family = headers.ip_version;
+  key.protocol = headers.protocol;
+  key.source_port = headers.source_port();
+  key.destination_port = headers.destination_port();
+  if (headers.IsIpv4()) {
+    memcpy(key.source, headers.data + 12, 4);
+    memcpy(key.destination, headers.data + 16, 4);
+  } else {
+    memcpy(key.source, headers.ipv6_source(), 16);
+    memcpy(key.destination, headers.ipv6_destination(), 16);
+  }
+  return key;
+}
+
+FlowKey FlowKey::Reversed() const {
+  FlowKey key = *this;
+  key.source_port = destination_port;
+  key.destination_port = source_port;
+  memcpy(key.source, destination, 16);
+  memcpy(key.destination, source, 16);
+  return key;
+}
+
+// Ячейка таблицы. Все поля атомарные, чтобы читатель без блокировки мог
+// безопасно прочитать их во время записи и отбросить результат по seqlock.
+struct FlowSlot {
+  std::atomic<uint32_t> sequence{0};  // нечетное значение - идет запись
+  std::atomic<uint32_t> tag{kSlotEmpty};
+  std::atomic<uint64_t> key[kKeyWords];
+  std::atomic<uint64_t> value[kValueWords];
+  std::atomic<uint32_t> last_seen{0};
+  uint32_t idle_timeout = 0;  // только под мьютексом шарда
+};
+
+// Массив ячеек шарда. После публикации не меняет размер; при росте
+// заменяется вдвое большим.
+struct FlowTable::SlotArray {
+  explicit SlotArray(size_t slot_count)
+      : slots(new FlowSlot[slot_count]), mask((uint32_t)(slot_count - 1)) {}
+
+  std::unique_ptr<FlowSlot[]> slots;
+  uint32_t mask;
+  std::atomic<uint32_t> max_probe{0};
+};
+
+struct FlowTable::Shard {
+  explicit Shard(size_t slot_count)
+      : wheel_next(slot_count, kNoLink),
+        wheel_prev(slot_count, kNoLink),
+        wheel_bucket(slot_count, kNoLink),
+        wheel_heads(kWheelSize, kNoLink) {
+    arrays.emplace_back(new SlotArray(slot_count));
+    current.store(arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  // Текущий массив; прежние остаются в |arrays| для опоздавших читателей
+  std::atomic<SlotArray*> current{nullptr};
+  std::vector<std::unique_ptr<SlotArray>> arrays;
+
+  std::mutex mutex;
+  size_t live = 0;  // занятые ячейки текущего массива
+  // Колесо таймеров: двусвязные списки индексов ячеек по корзинам
+  std::vector<uint32_t> wheel_next;
+  std::vector<uint32_t> wheel_prev;
+  std::vector<uint32_t> wheel_bucket;
+  std::vector<uint32_t> wheel_heads;
+  uint32_t wheel_tick = 0;
+  bool wheel_started = false;
+
+  SlotArray& array() { return *current.load(std::memory_order_relaxed); }
+
+  void Link(uint32_t index, uint32_t deadline) { LinkBucket(index, deadline % kWheelSize); }
+
+  void LinkBucket(uint32_t index, uint32_t bucket) {
+    wheel_bucket[index] = bucket;
+    wheel_prev[index] = kNoLink;
+    wheel_next[index] = wheel_heads[bucket];
+    if (wheel_heads[bucket] != kNoLink) {
+      wheel_prev[wheel_heads[bucket]] = index;
+    }
+    wheel_heads[bucket] = index;
+  }
+
+  void Unlink(uint32_t index) {
+    uint32_t bucket = wheel_bucket[index];
+    if (bucket == kNoLink) {
+      return;
+    }
+    if (wheel_prev[index] != kNoLink) {
+      wheel_next[wheel_prev[index]] = wheel_next[index];
+    } else {
+      wheel_heads[bucket] = wheel_next[index];
+    }
+    if (wheel_next[index] != kNoLink) {
+      wheel_prev[wheel_next[index]] = wheel_prev[index];
+    }
+    wheel_bucket[index] = kNoLink;
+    wheel_next[index] = kNoLink;
+    wheel_prev[index] = kNoLink;
+  }
+
+  // Срок в пределах колеса (дальние сроки переносятся при срабатывании)
+  uint32_t ClampDeadline(uint32_t now, uint32_t deadline) const {
+    uint32_t base = wheel_started ? wheel_tick : now;
+    if (deadline <= base) {
+      return base + 1;
+    }
+    if (deadline - base >= kWheelSize) {
+      return base + kWheelSize - 1;
+    }
+    return deadline;
+  }
+};
+
+FlowTable::FlowTable(size_t capacity, size_t shard_count, size_t initial_capacity) {
+  shard_count_ = RoundUpPowerOfTwo(shard_count == 0 ? 1 : shard_count);
+  max_shard_slots_ = SlotsPerShard(capacity, shard_count_);
+  size_t initial_slots = initial_capacity == 0
+                             ? max_shard_slots_
+                             : SlotsPerShard(initial_capacity, shard_count_);
+  if (initial_slots > max_shard_slots_) {
+    initial_slots = max_shard_slots_;
+  }
+  shards_.reserve(shard_count_);
+  for (size_t i = 0; i < shard_count_; i++) {
+    shards_.emplace_back(new Shard(initial_slots));
+  }
+}
+
+FlowTable::~FlowTable() = default;
+
+size_t FlowTable::capacity() const {
+  size_t total = 0;
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    total += shard->current.load(std::memory_order_acquire)->mask + 1;
+  }
+  return total;
+}
+
+uint64_t FlowTable::Hash(const FlowKey& key) {
+  uint64_t words[kKeyWords];
+  memcpy(words, &key, sizeof(words));
+  return HashWords(words);
+}
+
+bool FlowTable::GrowLocked(Shard& shard) {
+  SlotArray& old_array = shard.array();
+  size_t old_count = (size_t)old_array.mask + 1;
+  if (old_count >= max_shard_slots_) {
+    return false;
+  }
+  size_t new_count = old_count * 2;
+  std::unique_ptr<SlotArray> grown(new SlotArray(new_count));
+
+  // Массив еще не виден читателям, поэтому пишем без seqlock
+  std::vector<uint32_t> buckets(new_count, kNoLink);
+  uint32_t max_probe = 0;
+  for (uint32_t index = 0; index < old_count; index++) {
+    FlowSlot& from = old_array.slots[index];
+    uint32_t tag = from.tag.load(std::memory_order_relaxed);
+    if (tag == kSlotEmpty || tag == kSlotTombstone) {
+      continue;
+    }
+    uint64_t key_words[kKeyWords];
+    for (size_t i = 0; i < kKeyWords; i++) {
+      key_words[i] = from.key[i].load(std::memory_order_relaxed);
+    }
+    uint64_t hash = HashWords(key_words);
+    uint32_t probe = 0;
+    uint32_t target = (uint32_t)(hash & grown->mask);
+    while (grown->slots[target].tag.load(std::memory_order_relaxed) != kSlotEmpty) {
+      probe++;
+      target = (uint32_t)((hash + probe) & grown->mask);
+    }
+    FlowSlot& to = grown->slots[target];
+    for (size_t i = 0; i < kKeyWords; i++) {
+      to.key[i].store(key_words[i], std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kValueWords; i++) {
+      to.value[i].store(from.value[i].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    }
+    to.tag.store(tag, std::memory_order_relaxed);
+    to.last_seen.store(from.last_seen.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+    to.idle_timeout = from.idle_timeout;
+    buckets[target] = shard.wheel_bucket[index];
+    if (probe > max_probe) {
+      max_probe = probe;
+    }
+  }
+  grown->max_probe.store(max_probe, std::memory_order_relaxed);
+
+  // Колесо индексирует ячейки, поэтому собираем его заново с теми же корзинами
+  shard.wheel_next.assign(new_count, kNoLink);
+  shard.wheel_prev.assign(new_count, kNoLink);
+  shard.wheel_bucket.assign(new_count, kNoLink);
+  shard.wheel_heads.assign(kWheelSize, kNoLink);
+  for (uint32_t index = 0; index < new_count; index++) {
+    if (buckets[index] != kNoLink) {
+      shard.LinkBucket(index, buckets[index]);
+    }
+  }
+
+  shard.arrays.push_back(std::move(grown));
+  shard.current.store(shard.arrays.back().get(), std::memory_order_release);
+  return true;
+}
+
+bool FlowTable::Lookup(const FlowKey& key, uint32_t now, FlowValue* value) {
+  uint64_t hash = Hash(key);
+  Shard& shard = ShardFor(hash);
+  uint32_t tag = TagFor(hash);
+
+  uint64_t key_words[kKeyWords];
+  memcpy(key_words, &key, sizeof(key_words));
+
+  SlotArray& array = *shard.current.load(std::memory_order_acquire);
+  uint32_t max_probe = array.max_probe.load(std::memory_order_acquire);
+  for (uint32_t probe = 0; probe <= max_probe; probe++) {
+    FlowSlot& slot = array.slots[(hash + probe) & array.mask];
+
+    for (;;) {
+      uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence & 1) {
+        FLOW_TABLE_PAUSE();
+        continue;
+      }
+
+      uint32_t slot_tag = slot.tag.load(std::memory_order_relaxed);
+      bool match = (slot_tag == tag);
+      for (size_t i = 0; match && i < kKeyWords; i++) {
+        match = slot.key[i].load(std::memory_order_relaxed) == key_words[i];
+      }
+      uint64_t value_words[kValueWords];
+      if (match) {
+        for (size_t i = 0; i < kValueWords; i++) {
+          value_words[i] = slot.value[i].load(std::memory_order_relaxed);
+        }
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        continue;
+      }
+
+      if (slot_tag == kSlotEmpty) {
+        return false;
+      }
+      if (match) {
+        if (value != nullptr) {
+          memcpy(value, value_words, sizeof(*value));
+        }
+        // Пишем время только при смене тика, чтобы не гонять кэш-линию
+        if (slot.last_seen.load(std::memory_order_relaxed) != now) {
+          slot.last_seen.store(now, std::memory_order_relaxed);
+        }
+        return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+bool FlowTable::Insert(const FlowKey& key, const FlowValue& value, uint32_t now,
+                       uint32_t idle_timeout) {
+  uint64_t hash = Hash(key);
+  Shard& shard = ShardFor(hash);
+  uint32_t tag = TagFor(hash);
+
+  uint64_t key_words[kKeyWords];
+  uint64_t value_words[kValueWords];
+  memcpy(key_words, &key, sizeof(key_words));
+  memcpy(value_words, &value, sizeof(value_words));
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // Ищем существующую запись и первую свободную ячейку на пути пробы.
+  // Новой записи, для которой шард слишком заполнен, сначала даем место.
+  uint32_t free_index;
+  uint32_t free_probe;
+  uint32_t found_index;
+  for (;;) {
+    SlotArray& array = shard.array();
+    free_index = kNoLink;
+    free_probe = 0;
+    found_index = kNoLink;
+    for (uint32_t probe = 0; probe < kMaxProbe && probe <= array.mask; probe++) {
+      uint32_t index = (uint32_t)((hash + probe) & array.mask);
+      FlowSlot& slot = array.slots[index];
+      uint32_t slot_tag = slot.tag.load(std::memory_order_relaxed);
+      if (slot_tag == kSlotEmpty) {
+        if (free_index == kNoLink) {
+          free_index = index;
+          free_probe = probe;
+        }
+        break;
+      }
+      if (slot_tag == kSlotTombstone) {
+        if (free_index == kNoLink) {
+          free_index = index;
+          free_probe = probe;
+        }
+        continue;
+      }
+      if (slot_tag == tag) {
+        bool match = true;
+        for (size_t i = 0; match && i < kKeyWords; i++) {
+          match = slot.key[i].load(std::memory_order_relaxed) == key_words[i];
+        }
+        if (match) {
+          found_index = index;
+          break;
+        }
+      }
+    }
+    if (found_index != kNoLink) {
+      break;
+    }
+    bool crowded = free_index == kNoLink || (shard.live + 1) * 2 > (size_t)array.mask + 1;
+    if (!crowded || !GrowLocked(shard)) {
+      break;
+    }
+  }
+
+  bool is_new = (found_index == kNoLink);
+  uint32_t index = is_new ? free_index : found_index;
+  if (index == kNoLink) {
+    return false;
+  }
+
+  SlotArray& array = shard.array();
+  FlowSlot& slot = array.slots[index];
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < kKeyWords; i++) {
+    slot.key[i].store(key_words[i], std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < kValueWords; i++) {
+    slot.value[i].store(value_words[i], std::memory_order_relaxed);
+  }
+  slot.tag.store(tag, std::memory_order_relaxed);
+  slot.last_seen.store(now, std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  slot.idle_timeout = idle_timeout;
+
+  if (is_new) {
+    if (free_probe > array.max_probe.load(std::memory_order_relaxed)) {
+      array.max_probe.store(free_probe, std::memory_order_release);
+    }
+    shard.Link(index, shard.ClampDeadline(now, now + idle_timeout));
+    shard.live++;
+    size_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void FlowTable::EraseLocked(Shard& shard, uint32_t index) {
+  shard.Unlink(index);
+  SlotArray& array = shard.array();
+
+  // Если следующая ячейка пуста, ни одна цепочка пробы не проходит дальше,
+  // и удаленные ячейки можно вернуть в пустое состояние
+  uint32_t next = (index + 1) & array.mask;
+  bool next_empty =
+      array.slots[next].tag.load(std::memory_order_relaxed) == kSlotEmpty;
+
+  FlowSlot& slot = array.slots[index];
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.tag.store(next_empty ? kSlotEmpty : kSlotTombstone, std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+
+  if (next_empty) {
+    uint32_t prev = (index - 1) & array.mask;
+    while (prev != index &&
+           array.slots[prev].tag.load(std::memory_order_relaxed) == kSlotTombstone) {
+      FlowSlot& tombstone = array.slots[prev];
+      uint32_t seq = tombstone.sequence.load(std::memory_order_relaxed);
+      tombstone.sequence.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      tombstone.tag.store(kSlotEmpty, std::memory_order_relaxed);
+      tombstone.sequence.store(seq + 2, std::memory_order_release);
+      prev = (prev - 1) & array.mask;
+    }
+  }
+  shard.live--;
+  size_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool FlowTable::Remove(const FlowKey& key) {
+  uint64_t hash = Hash(key);
+  Shard& shard = ShardFor(hash);
+  uint32_t tag = TagFor(hash);
+
+  uint64_t key_words[kKeyWords];
+  memcpy(key_words, &key, sizeof(key_words));
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  SlotArray& array = shard.array();
+  uint32_t max_probe = array.max_probe.load(std::memory_order_relaxed);
+  for (uint32_t probe = 0; probe <= max_probe; probe++) {
+    uint32_t index = (uint32_t)((hash + probe) & array.mask);
+    FlowSlot& slot = array.slots[index];
+    uint32_t slot_tag = slot.tag.load(std::memory_order_relaxed);
+    if (slot_tag == kSlotEmpty) {
+      return false;
+    }
+    if (slot_tag != tag) {
+      continue;
+    }
+    bool match = true;
+    for (size_t i = 0; match && i < kKeyWords; i++) {
+      match = slot.key[i].load(std::memory_order_relaxed) == key_words[i];
+    }
+    if (match) {
+      EraseLocked(shard, index);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t FlowTable::Expire(uint32_t now) {
+  size_t expired = 0;
+  for (std::unique_ptr<Shard>& shard_ptr : shards_) {
+    Shard& shard = *shard_ptr;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (!shard.wheel_started) {
+      shard.wheel_started = true;
+      shard.wheel_tick = now;
+      continue;
+    }
+    // После долгого простоя достаточно одного полного оборота
+    if (now - shard.wheel_tick > kWheelSize) {
+      shard.wheel_tick = now - kWheelSize;
+    }
+
+    while (shard.wheel_tick != now) {
+      shard.wheel_tick++;
+      uint32_t bucket = shard.wheel_tick % kWheelSize;
+
+      // Отцепляем корзину целиком, затем разбираем ее
+      uint32_t index = shard.wheel_heads[bucket];
+      shard.wheel_heads[bucket] = kNoLink;
+      while (index != kNoLink) {
+        uint32_t next = shard.wheel_next[index];
+        shard.wheel_bucket[index] = kNoLink;
+        shard.wheel_next[index] = kNoLink;
+        shard.wheel_prev[index] = kNoLink;
+
+        FlowSlot& slot = shard.array().slots[index];
+        uint32_t deadline =
+            slot.last_seen.load(std::memory_order_relaxed) + slot.idle_timeout;
+        if ((int32_t)(deadline - shard.wheel_tick) <= 0) {
+          EraseLocked(shard, index);
+          expired++;
+        } else {
+          shard.Link(index, shard.ClampDeadline(now, deadline));
+        }
+        index = next;
+      }
+    }
+  }
+  return expired;
+}
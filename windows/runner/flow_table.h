@@ -0,0 +1,117 @@
+#ifndef RUNNER_FLOW_TABLE_H_
+#define RUNNER_FLOW_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "packet_headers.h"
+
+// Ключ потока (5-tuple). Адреса IPv4 хранятся в первых 4 байтах массивов
+// в сетевом порядке, остальные байты нулевые.
+struct FlowKey {
+  uint8_t family = 0;    // 4 или 6
+  uint8_t protocol = 0;
+  uint16_t source_port = 0;
+  uint16_t destination_port = 0;
+  uint16_t reserved = 0;
+  uint8_t source[16] = {};
+  uint8_t destination[16] = {};
+
+  // Ключ пакета (для фрагментов без транспортного заголовка порты нулевые)
+  static FlowKey FromHeaders(const PacketHeaders& headers);
+
+  // Ключ встречного направления
+  FlowKey Reversed() const;
+};
+
+// Исходное назначение потока, нужное для обратной трансляции ответов
+struct FlowValue {
+  uint8_t original_destination[16] = {};
+  uint16_t original_port = 0;
+  uint8_t family = 0;
+  uint8_t flags = 0;
+  uint32_t reserved = 0;
+};
+
+static_assert(sizeof(FlowKey) == 40, "FlowKey is read as 5 machine words");
+static_assert(sizeof(FlowValue) == 24, "FlowValue is read as 3 machine words");
+
+// Таблица потоков с открытой адресацией, разбитая на шарды.
+//
+// Чтение не берет блокировок: каждая ячейка защищена собственным счетчиком
+// последовательности (seqlock), и читатель повторяет чтение, если попал на
+// запись. Вставка и удаление сериализуются мьютексом шарда.
+//
+// Шард начинает с небольшого массива ячеек и удваивает его под своим
+// мьютексом, когда заполнение превышает половину, пока не достигнет доли
+// |capacity|. Перестраивается только один шард, поэтому пауза ограничена
+// его размером. Читатель берет текущий массив одной атомарной загрузкой;
+// старые массивы не освобождаются до разрушения таблицы, так как их может
+// дочитывать читатель (вместе они меньше последнего массива).
+//
+// Простаивающие потоки удаляются колесом таймеров (одно на шард): Lookup
+// только обновляет время последней активности, а при срабатывании корзины
+// запись либо удаляется, либо переносится на фактический срок.
+class FlowTable {
+ public:
+  // Размер колеса в тиках (тик = единица времени, передаваемого вызывающим)
+  static constexpr uint32_t kWheelSize = 1024;
+
+  // Максимальная длина пробы при вставке
+  static constexpr uint32_t kMaxProbe = 128;
+
+  // |capacity| - наибольшее общее число ячеек (округляется до степени двойки
+  // на шард), |initial_capacity| - сколько выделить сразу (0 - все).
+  // Для стабильной задержки держите заполнение не выше 50-70%.
+  FlowTable(size_t capacity, size_t shard_count, size_t initial_capacity = 0);
+  ~FlowTable();
+
+  FlowTable(const FlowTable&) = delete;
+  FlowTable& operator=(const FlowTable&) = delete;
+
+  // Найти поток. Без блокировок; обновляет время активности значением |now|.
+  bool Lookup(const FlowKey& key, uint32_t now, FlowValue* value);
+
+  // Добавить или обновить поток. Возвращает false, если шард переполнен.
+  bool Insert(const FlowKey& key, const FlowValue& value, uint32_t now,
+              uint32_t idle_timeout);
+
+  // Удалить поток (например, по TCP FIN/RST)
+  bool Remove(const FlowKey& key);
+
+  // Провернуть колеса до момента |now|. Возвращает число удаленных потоков.
+  size_t Expire(uint32_t now);
+
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  // Число уже выделенных ячеек
+  size_t capacity() const;
+  size_t max_capacity() const { return shard_count_ * max_shard_slots_; }
+
+ private:
+  struct SlotArray;
+  struct Shard;
+
+  static uint64_t Hash(const FlowKey& key);
+
+  Shard& ShardFor(uint64_t hash) {
+    return *shards_[(hash >> 40) & (shard_count_ - 1)];
+  }
+
+  void EraseLocked(Shard& shard, uint32_t index);
+
+  // Удвоить массив шарда. false, если шард уже наибольшего размера.
+  bool GrowLocked(Shard& shard);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t shard_count_ = 0;
+  size_t max_shard_slots_ = 0;
+  std::atomic<size_t> size_{0};
+};
+
+#endif  // RUNNER_FLOW_TABLE_H_
@@ -0,0 +1,249 @@
+#include "geo_data.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace {
+
+// Типы полей protobuf, встречающиеся в geosite.dat и geoip.dat
+constexpr uint32_t kWireVarint = 0;
+constexpr uint32_t kWireFixed64 = 1;
+constexpr uint32_t kWireBytes = 2;
+constexpr uint32_t kWireFixed32 = 5;
+
+// Domain.Type в routercommon.proto и соответствующие префиксы списка
+const char* const kDomainPrefixes[] = {"keyword:", "regexp:", "domain:", "full:"};
+
+// Последовательное чтение полей сообщения protobuf
+class ProtoReader {
+ public:
+  ProtoReader(const char* data, size_t length)
+      : cursor_((const uint8_t*)data), end_((const uint8_t*)data + length) {}
+
+  bool done() const { return cursor_ == end_; }
+  bool failed() const { return failed_; }
+
+  // Следующее поле: номер и тип. Для kWireBytes |bytes| и |bytes_length|
+  // указывают на содержимое, для kWireVarint значение в |value|; остальные
+  // типы пропускаются.
+  bool Next(uint32_t* field, uint32_t* wire, uint64_t* value, const char** bytes,
+            size_t* bytes_length) {
+    if (done() || failed_) {
+      return false;
+    }
+    uint64_t key;
+    if (!ReadVarint(&key)) {
+      return Fail();
+    }
+    *field = (uint32_t)(key >> 3);
+    *wire = (uint32_t)(key & 7);
+    switch (*wire) {
+      case kWireVarint:
+        return ReadVarint(value) || Fail();
+      case kWireFixed64:
+        return Skip(8);
+      case kWireFixed32:
+        return Skip(4);
+      case kWireBytes: {
+        uint64_t length;
+        if (!ReadVarint(&length) || length > (uint64_t)(end_ - cursor_)) {
+          return Fail();
+        }
+        *bytes = (const char*)cursor_;
+        *bytes_length = (size_t)length;
+        cursor_ += length;
+        return true;
+      }
+      default:
+        return Fail();
+    }
+  }
+
+ private:
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && cursor_ < end_; shift += 7) {
+      uint8_t byte = *cursor_++;
+      *value |= (uint64_t)(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Skip(size_t count) {
+    if ((size_t)(end_ - cursor_) < count) {
+      return Fail();
+    }
+    cursor_ += count;
+    return true;
+  }
+
+  bool Fail() {
+    failed_ = true;
+    return false;
+  }
+
+  const uint8_t* cursor_;
+  const uint8_t* end_;
+  bool failed_ = false;
+};
+
+bool SameCategory(const char* code, size_t length, const std::string& category) {
+  if (length != category.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    char a = code[i];
+    char b = category[i];
+    if (a >= 'A' && a <= 'Z') a = (char)(a - 'A' + 'a');
+    if (b >= 'A' && b <= 'Z') b = (char)(b - 'A' + 'a');
+    if (a != b) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Найти запись GeoSiteList/GeoIPList (поле 1) с country_code (поле 1) == category
+bool FindEntry(const char* data, size_t length, const std::string& category,
+               const char** entry, size_t* entry_length) {
+  ProtoReader list(data, length);
+  uint32_t field, wire;
+  uint64_t value;
+  const char* bytes;
+  size_t bytes_length;
+  while (list.Next(&field, &wire, &value, &bytes, &bytes_length)) {
+    if (field != 1 || wire != kWireBytes) {
+      continue;
+    }
+    // country_code - первое поле записи, поэтому остальное не разбирается
+    ProtoReader reader(bytes, bytes_length);
+    uint32_t code_field, code_wire;
+    const char* code;
+    size_t code_length;
+    if (reader.Next(&code_field, &code_wire, &value, &code, &code_length) &&
+        code_field == 1 && code_wire == kWireBytes &&
+        SameCategory(code, code_length, category)) {
+      *entry = bytes;
+      *entry_length = bytes_length;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AppendDomain(const char* data, size_t length, std::string* text) {
+  ProtoReader reader(data, length);
+  uint32_t field, wire;
+  uint64_t value, type = 0;
+  const char* bytes;
+  size_t bytes_length;
+  const char* domain = nullptr;
+  size_t domain_length = 0;
+  while (reader.Next(&field, &wire, &value, &bytes, &bytes_length)) {
+    if (field == 1 && wire == kWireVarint) {
+      type = value;
+    } else if (field == 2 && wire == kWireBytes) {
+      domain = bytes;
+      domain_length = bytes_length;
+    }
+  }
+  if (reader.failed() || type > 3) {
+    return false;
+  }
+  if (domain_length > 0) {
+    text->append(kDomainPrefixes[type]);
+    text->append(domain, domain_length);
+    text->push_back('\n');
+  }
+  return true;
+}
+
+bool AppendCidr(const char* data, size_t length, std::string* text) {
+  ProtoReader reader(data, length);
+  uint32_t field, wire;
+  uint64_t value, prefix = 0;
+  const char* bytes;
+  size_t bytes_length;
+  const uint8_t* ip = nullptr;
+  size_t ip_length = 0;
+  while (reader.Next(&field, &wire, &value, &bytes, &bytes_length)) {
+    if (field == 1 && wire == kWireBytes) {
+      ip = (const uint8_t*)bytes;
+      ip_length = bytes_length;
+    } else if (field == 2 && wire == kWireVarint) {
+      prefix = value;
+    }
+  }
+  if (reader.failed()) {
+    return false;
+  }
+
+  char line[64];
+  int written;
+  if (ip_length == 4 && prefix <= 32) {
+    written = snprintf(line, sizeof(line), "%u.%u.%u.%u/%u\n", ip[0], ip[1], ip[2], ip[3],
+                       (unsigned)prefix);
+  } else if (ip_length == 16 && prefix <= 128) {
+    written = snprintf(line, sizeof(line), "%x:%x:%x:%x:%x:%x:%x:%x/%u\n",
+                       (ip[0] << 8) | ip[1], (ip[2] << 8) | ip[3], (ip[4] << 8) | ip[5],
+                       (ip[6] << 8) | ip[7], (ip[8] << 8) | ip[9], (ip[10] << 8) | ip[11],
+                       (ip[12] << 8) | ip[13], (ip[14] << 8) | ip[15], (unsigned)prefix);
+  } else {
+    return false;
+  }
+  text->append(line, (size_t)written);
+  return true;
+}
+
+}  // namespace
+
+bool ExtractGeosite(const char* data, size_t length, const std::string& category,
+                    std::string* text) {
+  const char* entry;
+  size_t entry_length;
+  if (!FindEntry(data, length, category, &entry, &entry_length)) {
+    return false;
+  }
+
+  // GeoSite: 1 - country_code, 2 - повторяющийся Domain
+  ProtoReader reader(entry, entry_length);
+  uint32_t field, wire;
+  uint64_t value;
+  const char* bytes;
+  size_t bytes_length;
+  while (reader.Next(&field, &wire, &value, &bytes, &bytes_length)) {
+    if (field == 2 && wire == kWireBytes && !AppendDomain(bytes, bytes_length, text)) {
+      return false;
+    }
+  }
+  return !reader.failed();
+}
+
+bool ExtractGeoip(const char* data, size_t length, const std::string& category,
+                  std::string* text) {
+  const char* entry;
+  size_t entry_length;
+  if (!FindEntry(data, length, category, &entry, &entry_length)) {
+    return false;
+  }
+
+  // GeoIP: 1 - country_code, 2 - повторяющийся CIDR, 3 - reverse_match
+  ProtoReader reader(entry, entry_length);
+  uint32_t field, wire;
+  uint64_t value;
+  const char* bytes;
+  size_t bytes_length;
+  while (reader.Next(&field, &wire, &value, &bytes, &bytes_length)) {
+    if (field == 2 && wire == kWireBytes) {
+      if (!AppendCidr(bytes, bytes_length, text)) {
+        return false;
+      }
+    } else if (field == 3 && wire == kWireVarint && value != 0) {
+      return false;
+    }
+  }
+  return !reader.failed();
+}
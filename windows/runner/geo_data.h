@@ -0,0 +1,23 @@
+#ifndef RUNNER_GEO_DATA_H_
+#define RUNNER_GEO_DATA_H_
+
+#include <stddef.h>
+
+#include <string>
+
+// Извлечение категорий из geosite.dat и geoip.dat V2Ray (protobuf
+// GeoSiteList / GeoIPList) в текстовые списки, которые принимает RuleLists.
+//
+// Категория ищется по country_code без учета регистра ("cn" -> "CN").
+// Файл просматривается один раз, чужие записи пропускаются по длине без
+// разбора. Возвращает false, если категории нет или файл поврежден.
+
+// Домены в формате domain-list-community: full:, domain:, keyword:, regexp:
+bool ExtractGeosite(const char* data, size_t length, const std::string& category,
+                    std::string* text);
+
+// CIDR по одному в строке. Категории с reverse_match не поддерживаются.
+bool ExtractGeoip(const char* data, size_t length, const std::string& category,
+                  std::string* text);
+
+#endif  // RUNNER_GEO_DATA_H_
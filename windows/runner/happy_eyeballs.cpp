@@ -0,0 +1,286 @@
+#include "happy_eyeballs.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netinet/in.h>
+#endif
+
+namespace {
+
+int HostUnreachableError() {
+#if defined(_WIN32)
+  return WSAEHOSTUNREACH;
+#else
+  return EHOSTUNREACH;
+#endif
+}
+
+}  // namespace
+
+AddressFamilyCache::Shard& AddressFamilyCache::ShardFor(const std::string& key) {
+  return shards_[std::hash<std::string>()(key) % kShardCount];
+}
+
+int AddressFamilyCache::Preferred(const std::string& key, int64_t now_us) {
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    return 0;
+  }
+  if (it->second.expires_us <= now_us) {
+    shard.entries.erase(it);
+    return 0;
+  }
+  return it->second.family;
+}
+
+void AddressFamilyCache::Record(const std::string& key, int family, int64_t now_us) {
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.entries.size() >= kShardCapacity && shard.entries.find(key) == shard.entries.end()) {
+    // Вытесняем запись, которая устареет первой
+    auto oldest = shard.entries.begin();
+    for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+      if (it->second.expires_us < oldest->second.expires_us) {
+        oldest = it;
+      }
+    }
+    shard.entries.erase(oldest);
+  }
+  shard.entries[key] = Entry{family, now_us + kTtlUs};
+}
+
+int64_t ConnectorTimers::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int ConnectorTimers::RunDue(int max_wait_ms) {
+  if (armed_.empty()) {
+    return max_wait_ms;
+  }
+  int64_t now = NowUs();
+  due_.clear();
+  for (HappyEyeballsConnector* connector : armed_) {
+    if (connector->deadline_us() <= now) {
+      due_.push_back(connector);
+    }
+  }
+  // OnTimer() может снять или заново взвести соединитель
+  for (HappyEyeballsConnector* connector : due_) {
+    connector->OnTimer(now);
+  }
+  int64_t wake = now + (int64_t)max_wait_ms * 1000;
+  for (HappyEyeballsConnector* connector : armed_) {
+    wake = std::min(wake, connector->deadline_us());
+  }
+  int64_t wait_ms = (wake - now + 999) / 1000;
+  return wait_ms < 0 ? 0 : (int)wait_ms;
+}
+
+void ConnectorTimers::Arm(HappyEyeballsConnector* connector) {
+  armed_.push_back(connector);
+}
+
+void ConnectorTimers::Disarm(HappyEyeballsConnector* connector) {
+  auto it = std::find(armed_.begin(), armed_.end(), connector);
+  if (it != armed_.end()) {
+    *it = armed_.back();
+    armed_.pop_back();
+  }
+}
+
+HappyEyeballsConnector::HappyEyeballsConnector(Reactor* reactor, ConnectorTimers* timers,
+                                               AddressFamilyCache* cache)
+    : reactor_(reactor), timers_(timers), cache_(cache) {
+  for (IoOp& op : attempts_) {
+    op.handler = this;
+    op.type = IoOpType::kConnect;
+  }
+}
+
+HappyEyeballsConnector::~HappyEyeballsConnector() {
+  if (armed_) {
+    timers_->Disarm(this);
+  }
+}
+
+void HappyEyeballsConnector::Start(const std::string& cache_key,
+                                   const ResolvedAddress* addresses, size_t count,
+                                   ConnectHandler* handler) {
+  handler_ = handler;
+  cache_key_ = cache_key;
+  decided_ = false;
+  winner_ = kInvalidSocket;
+  winner_index_ = 0;
+  error_ = HostUnreachableError();
+  next_ = 0;
+  active_count_ = 0;
+
+  // Первым идет семейство из истории, иначе - первого адреса резолвера
+  // (RFC 6724 обычно ставит IPv6 впереди). Дальше семейства чередуются.
+  int first_family = count > 0 ? addresses[0].address.ss_family : AF_INET6;
+  int64_t now = ConnectorTimers::NowUs();
+  if (cache_ != nullptr && !cache_key.empty()) {
+    int preferred = cache_->Preferred(cache_key, now);
+    if (preferred != 0) {
+      first_family = preferred;
+    }
+  }
+  size_t preferred[kMaxAttempts];
+  size_t other[kMaxAttempts];
+  size_t preferred_count = 0;
+  size_t other_count = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (addresses[i].address.ss_family == first_family) {
+      if (preferred_count < kMaxAttempts) {
+        preferred[preferred_count++] = i;
+      }
+    } else if (other_count < kMaxAttempts) {
+      other[other_count++] = i;
+    }
+  }
+  count_ = 0;
+  for (size_t i = 0; count_ < kMaxAttempts && (i < preferred_count || i < other_count); i++) {
+    if (i < preferred_count) {
+      addresses_[count_++] = addresses[preferred[i]];
+    }
+    if (i < other_count && count_ < kMaxAttempts) {
+      addresses_[count_++] = addresses[other[i]];
+    }
+  }
+
+  LaunchNext(now);
+}
+
+void HappyEyeballsConnector::LaunchNext(int64_t now_us) {
+  while (next_ < count_) {
+    size_t index = next_++;
+    const ResolvedAddress& target = addresses_[index];
+    SocketHandle socket = ::socket(target.address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (socket == kInvalidSocket) {
+      error_ = LastSocketError();
+      continue;
+    }
+    if (!SetSocketNonBlocking(socket) || !reactor_->Attach(socket)) {
+      error_ = LastSocketError();
+      CloseSocketHandle(socket);
+      continue;
+    }
+    IoOp& op = attempts_[index];
+    op.socket = socket;
+    op.address = target.address;
+    op.address_length = target.length;
+    if (!reactor_->Submit(&op)) {
+      // Немедленный отказ (например, нет маршрута IPv6) - сразу следующий
+      error_ = op.error;
+      reactor_->Close(socket);
+      continue;
+    }
+    active_[index] = true;
+    active_count_++;
+    if (next_ < count_) {
+      deadline_us_ = now_us + kAttemptDelayUs;
+      if (!armed_) {
+        armed_ = true;
+        timers_->Arm(this);
+      }
+    } else if (armed_) {
+      armed_ = false;
+      timers_->Disarm(this);
+    }
+    return;
+  }
+  if (armed_) {
+    armed_ = false;
+    timers_->Disarm(this);
+  }
+  MaybeComplete();
+}
+
+void HappyEyeballsConnector::OnTimer(int64_t now_us) {
+  if (!decided_ && now_us >= deadline_us_) {
+    LaunchNext(now_us);
+  }
+}
+
+void HappyEyeballsConnector::OnIoComplete(IoOp* op) {
+  size_t index = (size_t)(op - attempts_);
+  active_[index] = false;
+  active_count_--;
+
+  if (!decided_) {
+    if (op->error == 0) {
+      decided_ = true;
+      winner_ = op->socket;
+      winner_index_ = index;
+      if (cache_ != nullptr && !cache_key_.empty()) {
+        cache_->Record(cache_key_, addresses_[index].address.ss_family,
+                       ConnectorTimers::NowUs());
+      }
+      if (armed_) {
+        armed_ = false;
+        timers_->Disarm(this);
+      }
+      CloseAttempts();
+    } else {
+      error_ = op->error;
+      reactor_->Close(op->socket);
+      LaunchNext(ConnectorTimers::NowUs());
+      return;
+    }
+  }
+  // Проигравшие и отмененные попытки: сокеты уже закрыты
+  MaybeComplete();
+}
+
+void HappyEyeballsConnector::Cancel() {
+  if (handler_ == nullptr) {
+    return;
+  }
+  if (!decided_) {
+    decided_ = true;
+    error_ = SocketCancelledError();
+  }
+  if (winner_ != kInvalidSocket) {
+    reactor_->Close(winner_);
+    winner_ = kInvalidSocket;
+    error_ = SocketCancelledError();
+  }
+  if (armed_) {
+    armed_ = false;
+    timers_->Disarm(this);
+  }
+  CloseAttempts();
+}
+
+SocketHandle HappyEyeballsConnector::TakeSocket() {
+  SocketHandle socket = winner_;
+  winner_ = kInvalidSocket;
+  return socket;
+}
+
+void HappyEyeballsConnector::CloseAttempts() {
+  for (size_t i = 0; i < count_; i++) {
+    if (active_[i]) {
+      // Завершение с отменой придет через Poll(); сокет больше не трогаем
+      reactor_->Close(attempts_[i].socket);
+    }
+  }
+}
+
+void HappyEyeballsConnector::MaybeComplete() {
+  if (handler_ == nullptr || active_count_ > 0 || (!decided_ && next_ < count_)) {
+    return;
+  }
+  ConnectHandler* handler = handler_;
+  handler_ = nullptr;
+  handler->OnConnectComplete(this);
+}
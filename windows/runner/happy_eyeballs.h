@@ -0,0 +1,144 @@
+#ifndef RUNNER_HAPPY_EYEBALLS_H_
+#define RUNNER_HAPPY_EYEBALLS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "host_resolver.h"
+#include "reactor.h"
+
+class HappyEyeballsConnector;
+
+// Какое семейство адресов последним выиграло гонку до назначения.
+// Потокобезопасен; записи устаревают, чтобы починившийся путь IPv6 снова
+// получил первую попытку.
+class AddressFamilyCache {
+ public:
+  static constexpr size_t kShardCount = 16;
+  static constexpr size_t kShardCapacity = 256;
+  static constexpr int64_t kTtlUs = 10 * 60 * 1000 * 1000LL;
+
+  // AF_INET, AF_INET6 или 0 - истории нет
+  int Preferred(const std::string& key, int64_t now_us);
+  void Record(const std::string& key, int family, int64_t now_us);
+
+ private:
+  struct Entry {
+    int family;
+    int64_t expires_us;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+  };
+
+  Shard& ShardFor(const std::string& key);
+
+  Shard shards_[kShardCount];
+};
+
+// Отложенные попытки соединителей одного реактора. Поток реактора вызывает
+// RunDue() перед каждым Poll() и ждет не дольше возвращенного времени.
+class ConnectorTimers {
+ public:
+  // Выполнить наступившие попытки; возвращает таймаут для Poll() в мс, не
+  // больше |max_wait_ms|
+  int RunDue(int max_wait_ms);
+
+  void Arm(HappyEyeballsConnector* connector);
+  void Disarm(HappyEyeballsConnector* connector);
+
+  static int64_t NowUs();
+
+ private:
+  std::vector<HappyEyeballsConnector*> armed_;
+  std::vector<HappyEyeballsConnector*> due_;
+};
+
+// Получатель итога гонки. Вызывается в потоке реактора, когда все попытки
+// вернулись.
+class ConnectHandler {
+ public:
+  virtual void OnConnectComplete(HappyEyeballsConnector* connector) = 0;
+
+ protected:
+  ~ConnectHandler() = default;
+};
+
+// Соединение с назначением по нескольким адресам (Happy Eyeballs v2,
+// RFC 8305).
+//
+// Адреса чередуются по семействам: первым идет семейство, выигравшее в
+// прошлый раз (по AddressFamilyCache), иначе - семейство первого адреса
+// резолвера. Следующая попытка стартует через kAttemptDelayUs или сразу
+// после отказа предыдущей; первая установленная побеждает, остальные
+// закрываются. Работает в потоке реактора, без собственных потоков и
+// выделений памяти на попытку.
+class HappyEyeballsConnector : public IoHandler {
+ public:
+  static constexpr size_t kMaxAttempts = 8;
+  static constexpr int64_t kAttemptDelayUs = 250 * 1000;
+
+  // |cache| может быть nullptr
+  HappyEyeballsConnector(Reactor* reactor, ConnectorTimers* timers, AddressFamilyCache* cache);
+  ~HappyEyeballsConnector();
+
+  HappyEyeballsConnector(const HappyEyeballsConnector&) = delete;
+  HappyEyeballsConnector& operator=(const HappyEyeballsConnector&) = delete;
+
+  // Начать гонку. |cache_key| пустой - без учета истории. Итог придет в
+  // |handler| (возможно, еще внутри Start(), если ни одна попытка не
+  // началась).
+  void Start(const std::string& cache_key, const ResolvedAddress* addresses, size_t count,
+             ConnectHandler* handler);
+
+  // Прервать гонку; итог придет после возврата отмененных попыток
+  void Cancel();
+
+  bool running() const { return handler_ != nullptr; }
+
+  // Итог: победивший сокет (привязан к реактору, владение переходит к
+  // вызывающему) или kInvalidSocket и код последней ошибки
+  SocketHandle TakeSocket();
+  int error() const { return error_; }
+  const ResolvedAddress& address() const { return addresses_[winner_index_]; }
+
+  void OnIoComplete(IoOp* op) override;
+
+  // Для ConnectorTimers
+  int64_t deadline_us() const { return deadline_us_; }
+  void OnTimer(int64_t now_us);
+
+ private:
+  void LaunchNext(int64_t now_us);
+  void CloseAttempts();
+  void MaybeComplete();
+
+  Reactor* reactor_;
+  ConnectorTimers* timers_;
+  AddressFamilyCache* cache_;
+  ConnectHandler* handler_ = nullptr;
+  std::string cache_key_;
+
+  ResolvedAddress addresses_[kMaxAttempts];
+  IoOp attempts_[kMaxAttempts];
+  bool active_[kMaxAttempts] = {};
+  size_t count_ = 0;
+  size_t next_ = 0;
+  size_t active_count_ = 0;
+  bool decided_ = false;
+  bool armed_ = false;
+  int64_t deadline_us_ = 0;
+
+  SocketHandle winner_ = kInvalidSocket;
+  size_t winner_index_ = 0;
+  int error_ = 0;
+};
+
+#endif  // RUNNER_HAPPY_EYEBALLS_H_
@@ -0,0 +1,314 @@
+#include "host_resolver.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#include "dns_cache.h"
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#include <windns.h>
+#pragma comment(lib, "dnsapi.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#endif
+
+namespace {
+
+// TTL, если источник адресов его не сообщает
+constexpr uint32_t kDefaultTtlS = 60;
+constexpr uint32_t kDefaultNegativeTtlS = 30;
+
+enum class QueryResult { kOk, kNotFound, kFailed };
+
+void SetPort(ResolvedAddress* resolved, uint16_t port) {
+  if (resolved->address.ss_family == AF_INET) {
+    ((sockaddr_in*)&resolved->address)->sin_port = htons(port);
+  } else {
+    ((sockaddr_in6*)&resolved->address)->sin6_port = htons(port);
+  }
+}
+
+#if defined(_WIN32)
+// Записи одного типа из ответа DnsQuery; |ttl_s| уменьшается до наименьшего
+// TTL среди них
+DNS_STATUS QueryRecords(const std::string& host, WORD type,
+                        std::vector<ResolvedAddress>* addresses, uint32_t* ttl_s) {
+  PDNS_RECORD records = nullptr;
+  DNS_STATUS status =
+      DnsQuery_A(host.c_str(), type, DNS_QUERY_STANDARD, nullptr, &records, nullptr);
+  if (status != ERROR_SUCCESS) {
+    return status;
+  }
+  for (PDNS_RECORD record = records;
+       record != nullptr && addresses->size() < HostResolver::kMaxAddresses;
+       record = record->pNext) {
+    // CNAME цепочки пропускаем, берем только адреса из ответа
+    if (record->wType != type || record->Flags.S.Section != DnsSectionAnswer) {
+      continue;
+    }
+    ResolvedAddress resolved = {};
+    if (type == DNS_TYPE_A) {
+      sockaddr_in* ipv4 = (sockaddr_in*)&resolved.address;
+      ipv4->sin_family = AF_INET;
+      ipv4->sin_addr.s_addr = record->Data.A.IpAddress;
+      resolved.length = sizeof(sockaddr_in);
+    } else {
+      sockaddr_in6* ipv6 = (sockaddr_in6*)&resolved.address;
+      ipv6->sin6_family = AF_INET6;
+      memcpy(&ipv6->sin6_addr, &record->Data.AAAA.Ip6Address, sizeof(ipv6->sin6_addr));
+      resolved.length = sizeof(sockaddr_in6);
+    }
+    addresses->push_back(resolved);
+    if (record->dwTtl < *ttl_s) {
+      *ttl_s = record->dwTtl;
+    }
+  }
+  DnsRecordListFree(records, DnsFreeRecordList);
+  return ERROR_SUCCESS;
+}
+#endif
+
+// Адреса имени с портом 0 и время, на которое их можно запомнить
+QueryResult QueryHost(const std::string& host, std::vector<ResolvedAddress>* addresses,
+                      uint32_t* ttl_s) {
+#if defined(_WIN32)
+  // DnsQuery сообщает TTL записей. Файл hosts, NetBIOS и прочие источники
+  // без TTL закрывает getaddrinfo ниже.
+  uint32_t ttl = UINT32_MAX;
+  DNS_STATUS ipv6 = QueryRecords(host, DNS_TYPE_AAAA, addresses, &ttl);
+  DNS_STATUS ipv4 = QueryRecords(host, DNS_TYPE_A, addresses, &ttl);
+  if (!addresses->empty()) {
+    *ttl_s = ttl;
+    return QueryResult::kOk;
+  }
+  if (ipv6 == DNS_ERROR_RCODE_NAME_ERROR && ipv4 == DNS_ERROR_RCODE_NAME_ERROR) {
+    *ttl_s = kDefaultNegativeTtlS;
+    return QueryResult::kNotFound;
+  }
+#endif
+
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  addrinfo* result = nullptr;
+  int status = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+  if (status != 0) {
+    *ttl_s = kDefaultNegativeTtlS;
+    return status == EAI_NONAME ? QueryResult::kNotFound : QueryResult::kFailed;
+  }
+  for (addrinfo* entry = result; entry != nullptr && addresses->size() < HostResolver::kMaxAddresses;
+       entry = entry->ai_next) {
+    if ((entry->ai_family != AF_INET && entry->ai_family != AF_INET6) ||
+        entry->ai_addrlen > sizeof(sockaddr_storage)) {
+      continue;
+    }
+    ResolvedAddress resolved = {};
+    memcpy(&resolved.address, entry->ai_addr, entry->ai_addrlen);
+    resolved.length = (int)entry->ai_addrlen;
+    SetPort(&resolved, 0);
+    addresses->push_back(resolved);
+  }
+  freeaddrinfo(result);
+  *ttl_s = kDefaultTtlS;
+  return addresses->empty() ? QueryResult::kFailed : QueryResult::kOk;
+}
+
+}  // namespace
+
+bool ParseIpLiteral(const std::string& host, uint16_t port, sockaddr_storage* address,
+                    int* length) {
+  memset(address, 0, sizeof(*address));
+  sockaddr_in* ipv4 = (sockaddr_in*)address;
+  if (inet_pton(AF_INET, host.c_str(), &ipv4->sin_addr) == 1) {
+    ipv4->sin_family = AF_INET;
+    ipv4->sin_port = htons(port);
+    *length = sizeof(sockaddr_in);
+    return true;
+  }
+  sockaddr_in6* ipv6 = (sockaddr_in6*)address;
+  if (inet_pton(AF_INET6, host.c_str(), &ipv6->sin6_addr) == 1) {
+    ipv6->sin6_family = AF_INET6;
+    ipv6->sin6_port = htons(port);
+    *length = sizeof(sockaddr_in6);
+    return true;
+  }
+  return false;
+}
+
+HostResolver::HostResolver(size_t thread_count, DnsCache* cache) : cache_(cache) {
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back(&HostResolver::Loop, this);
+  }
+}
+
+HostResolver::~HostResolver() { Shutdown(); }
+
+void HostResolver::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  std::unordered_map<std::string, std::vector<Waiter>> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.clear();
+    waiters.swap(waiters_);
+  }
+  for (auto& item : waiters) {
+    for (Waiter& waiter : item.second) {
+      waiter.callback(std::vector<ResolvedAddress>());
+    }
+  }
+}
+
+void HostResolver::Resolve(std::string host, uint16_t port, Callback callback) {
+  ResolveAll(std::move(host), port,
+             [callback](const std::vector<ResolvedAddress>& addresses) {
+               if (addresses.empty()) {
+                 sockaddr_storage none = {};
+                 callback(false, none, 0);
+                 return;
+               }
+               callback(true, addresses[0].address, addresses[0].length);
+             });
+}
+
+void HostResolver::ResolveAll(std::string host, uint16_t port, ListCallback callback) {
+  if (cache_ != nullptr) {
+    std::vector<ResolvedAddress> addresses;
+    bool refresh = false;
+    switch (cache_->Lookup(host, DnsCache::NowUs(), &addresses, &refresh)) {
+      case DnsCache::Status::kFresh:
+      case DnsCache::Status::kStale:
+        if (refresh) {
+          // Устаревшие адреса отдаем сразу, имя обновляется в фоне
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!stopping_) {
+            Enqueue(host);
+          }
+        }
+        for (ResolvedAddress& resolved : addresses) {
+          SetPort(&resolved, port);
+        }
+        callback(addresses);
+        return;
+      case DnsCache::Status::kNegative:
+        callback(std::vector<ResolvedAddress>());
+        return;
+      case DnsCache::Status::kMiss:
+        break;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_) {
+      Enqueue(host);
+      waiters_[host].push_back(Waiter{port, std::move(callback)});
+      return;
+    }
+  }
+  callback(std::vector<ResolvedAddress>());
+}
+
+void HostResolver::Enqueue(const std::string& host) {
+  // Имя уже в очереди или в работе: ожидающие получат тот же ответ
+  if (waiters_.emplace(host, std::vector<Waiter>()).second) {
+    jobs_.push_back(host);
+    ready_.notify_one();
+  }
+}
+
+void HostResolver::Prefetch() {
+  std::vector<std::string> names;
+  cache_->CollectPrefetch(DnsCache::NowUs(), kPrefetchBatch, &names);
+  if (names.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_) {
+    return;
+  }
+  for (const std::string& name : names) {
+    Enqueue(name);
+  }
+}
+
+void HostResolver::Loop() {
+  for (;;) {
+    std::string host;
+    bool job = false;
+    bool prefetch = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto ready = [this] { return stopping_ || !jobs_.empty(); };
+      if (cache_ == nullptr) {
+        ready_.wait(lock, ready);
+      } else {
+        ready_.wait_for(lock, std::chrono::milliseconds(kPrefetchIntervalMs), ready);
+      }
+      if (stopping_) {
+        return;
+      }
+      if (cache_ != nullptr) {
+        int64_t now = DnsCache::NowUs();
+        if (now >= next_prefetch_us_) {
+          next_prefetch_us_ = now + (int64_t)kPrefetchIntervalMs * 1000;
+          prefetch = true;
+        }
+      }
+      if (!jobs_.empty()) {
+        host = std::move(jobs_.front());
+        jobs_.pop_front();
+        job = true;
+      }
+    }
+    if (prefetch) {
+      Prefetch();
+    }
+    if (!job) {
+      continue;
+    }
+
+    std::vector<ResolvedAddress> addresses;
+    uint32_t ttl_s = 0;
+    QueryResult result = QueryHost(host, &addresses, &ttl_s);
+    if (cache_ != nullptr) {
+      int64_t now = DnsCache::NowUs();
+      if (result == QueryResult::kOk) {
+        cache_->Store(host, addresses, ttl_s, now);
+      } else if (result == QueryResult::kNotFound) {
+        cache_->StoreNegative(host, ttl_s, now);
+      } else {
+        // Сбой сети не значит, что имени нет: запись не трогаем
+        cache_->RefreshFailed(host);
+      }
+    }
+
+    std::vector<Waiter> waiters;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = waiters_.find(host);
+      if (it != waiters_.end()) {
+        waiters.swap(it->second);
+        waiters_.erase(it);
+      }
+    }
+    for (Waiter& waiter : waiters) {
+      std::vector<ResolvedAddress> resolved = addresses;
+      for (ResolvedAddress& entry : resolved) {
+        SetPort(&entry, waiter.port);
+      }
+      waiter.callback(resolved);
+    }
+  }
+}
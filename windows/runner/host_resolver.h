@@ -0,0 +1,87 @@
+#ifndef RUNNER_HOST_RESOLVER_H_
+#define RUNNER_HOST_RESOLVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "reactor.h"
+
+class DnsCache;
+
+// Адрес сокета с длиной
+struct ResolvedAddress {
+  sockaddr_storage address;
+  int length;
+};
+
+// Разобрать IP-литерал (IPv4 или IPv6) без обращения к DNS
+bool ParseIpLiteral(const std::string& host, uint16_t port, sockaddr_storage* address,
+                    int* length);
+
+// Пул потоков для getaddrinfo: разрешение имен блокирующее и не должно
+// выполняться в потоке реактора. Callback вызывается из потока пула, а при
+// ответе из кеша - сразу внутри Resolve()/ResolveAll().
+//
+// Одновременные запросы одного имени разрешаются одним обращением к DNS.
+// С кешем пул еще обновляет устаревшие и горячие имена в фоне.
+class HostResolver {
+ public:
+  using Callback =
+      std::function<void(bool ok, const sockaddr_storage& address, int length)>;
+  // Все адреса имени в порядке getaddrinfo (RFC 6724); пусто - ошибка
+  using ListCallback = std::function<void(const std::vector<ResolvedAddress>& addresses)>;
+
+  // Адресов на имя, не больше
+  static constexpr size_t kMaxAddresses = 16;
+
+  // Как часто искать горячие имена для упреждающего обновления
+  static constexpr int kPrefetchIntervalMs = 1000;
+  static constexpr size_t kPrefetchBatch = 64;
+
+  // |cache| может быть nullptr; иначе должен пережить резолвер
+  explicit HostResolver(size_t thread_count, DnsCache* cache = nullptr);
+  ~HostResolver();
+
+  HostResolver(const HostResolver&) = delete;
+  HostResolver& operator=(const HostResolver&) = delete;
+
+  // Останавливает потоки; невыполненные и последующие запросы завершаются
+  // с ошибкой. Объект остается доступным потокам реакторов до их остановки.
+  void Shutdown();
+
+  // Первый адрес имени
+  void Resolve(std::string host, uint16_t port, Callback callback);
+  void ResolveAll(std::string host, uint16_t port, ListCallback callback);
+
+ private:
+  struct Waiter {
+    uint16_t port;
+    ListCallback callback;
+  };
+
+  void Loop();
+  // Поставить имя в очередь (под mutex_); без ожидающих - фоновое обновление
+  void Enqueue(const std::string& host);
+  void Prefetch();
+
+  DnsCache* cache_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::string> jobs_;
+  // Имена в очереди или в работе и кто ждет их адреса
+  std::unordered_map<std::string, std::vector<Waiter>> waiters_;
+  bool stopping_ = false;
+  int64_t next_prefetch_us_ = 0;
+  std::vector<std::thread> threads_;
+};
+
+#endif  // RUNNER_HOST_RESOLVER_H_
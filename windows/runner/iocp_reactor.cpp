@@ -0,0 +1,232 @@
+#include "iocp_reactor.h"
+
+#if defined(_WIN32)
+
+#include <string.h>
+
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "mswsock.lib")
+
+namespace {
+
+// Завершений за один вызов GetQueuedCompletionStatusEx
+constexpr ULONG kMaxEntries = 128;
+
+// Ключ завершения для Wake()
+constexpr ULONG_PTR kWakeKey = 1;
+
+// Размер адреса в буфере AcceptEx (требование API: +16 байт)
+constexpr DWORD kAcceptAddressLength = sizeof(sockaddr_in6) + 16;
+
+static_assert(sizeof(OVERLAPPED) <= sizeof(((IoOp*)nullptr)->platform),
+              "IoOp::platform must hold OVERLAPPED");
+static_assert(2 * kAcceptAddressLength <= sizeof(sockaddr_storage),
+              "AcceptEx addresses are stored in IoOp::address");
+
+OVERLAPPED* Overlapped(IoOp* op) {
+  return reinterpret_cast<OVERLAPPED*>(op->platform);
+}
+
+IoOp* OpFromOverlapped(OVERLAPPED* overlapped) {
+  return reinterpret_cast<IoOp*>(reinterpret_cast<uint8_t*>(overlapped) -
+                                 offsetof(IoOp, platform));
+}
+
+}  // namespace
+
+IocpReactor::IocpReactor() = default;
+
+IocpReactor::~IocpReactor() {
+  if (port_ != NULL) {
+    CloseHandle(port_);
+  }
+}
+
+bool IocpReactor::Open() {
+  port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+  return port_ != NULL;
+}
+
+bool IocpReactor::LoadExtensions(SocketHandle socket) {
+  if (accept_ex_ != nullptr && connect_ex_ != nullptr) {
+    return true;
+  }
+  GUID accept_guid = WSAID_ACCEPTEX;
+  GUID connect_guid = WSAID_CONNECTEX;
+  DWORD bytes = 0;
+  if (WSAIoctl(socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &accept_guid,
+               sizeof(accept_guid), &accept_ex_, sizeof(accept_ex_), &bytes, NULL,
+               NULL) != 0) {
+    return false;
+  }
+  return WSAIoctl(socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &connect_guid,
+                  sizeof(connect_guid), &connect_ex_, sizeof(connect_ex_), &bytes, NULL,
+                  NULL) == 0;
+}
+
+bool IocpReactor::Attach(SocketHandle socket) {
+  if (CreateIoCompletionPort((HANDLE)socket, port_, 0, 0) != port_) {
+    return false;
+  }
+  return LoadExtensions(socket);
+}
+
+bool IocpReactor::Submit(IoOp* op) {
+  memset(Overlapped(op), 0, sizeof(OVERLAPPED));
+  op->transferred = 0;
+  op->error = 0;
+
+  switch (op->type) {
+    case IoOpType::kAccept: {
+      // AcceptEx принимает в заранее созданный сокет того же семейства
+      WSAPROTOCOL_INFOW info;
+      int info_length = sizeof(info);
+      if (getsockopt(op->socket, SOL_SOCKET, SO_PROTOCOL_INFOW, (char*)&info,
+                     &info_length) != 0) {
+        op->error = WSAGetLastError();
+        return false;
+      }
+      op->accepted = WSASocketW(info.iAddressFamily, SOCK_STREAM, IPPROTO_TCP, NULL, 0,
+                                WSA_FLAG_OVERLAPPED);
+      if (op->accepted == INVALID_SOCKET) {
+        op->error = WSAGetLastError();
+        return false;
+      }
+      DWORD bytes = 0;
+      if (!accept_ex_(op->socket, op->accepted, &op->address, 0, kAcceptAddressLength,
+                      kAcceptAddressLength, &bytes, Overlapped(op)) &&
+          WSAGetLastError() != ERROR_IO_PENDING) {
+        op->error = WSAGetLastError();
+        closesocket(op->accepted);
+        op->accepted = INVALID_SOCKET;
+        return false;
+      }
+      return true;
+    }
+
+    case IoOpType::kConnect: {
+      // ConnectEx требует предварительно привязанный сокет
+      sockaddr_storage local = {};
+      local.ss_family = op->address.ss_family;
+      int local_length = local.ss_family == AF_INET6 ? sizeof(sockaddr_in6)
+                                                     : sizeof(sockaddr_in);
+      bind(op->socket, (const sockaddr*)&local, local_length);
+      if (!connect_ex_(op->socket, (const sockaddr*)&op->address, op->address_length,
+                       NULL, 0, NULL, Overlapped(op)) &&
+          WSAGetLastError() != ERROR_IO_PENDING) {
+        op->error = WSAGetLastError();
+        return false;
+      }
+      return true;
+    }
+
+    case IoOpType::kRead: {
+      WSABUF buffer;
+      buffer.buf = op->buffer;
+      buffer.len = (ULONG)op->length;
+      DWORD flags = 0;
+      if (WSARecv(op->socket, &buffer, 1, NULL, &flags, Overlapped(op), NULL) != 0 &&
+          WSAGetLastError() != WSA_IO_PENDING) {
+        op->error = WSAGetLastError();
+        return false;
+      }
+      return true;
+    }
+
+    case IoOpType::kWrite:
+      return StartWrite(op);
+
+    case IoOpType::kSpliceIn:
+    case IoOpType::kSpliceOut:
+      break;
+  }
+  op->error = WSAEOPNOTSUPP;
+  return false;
+}
+
+bool IocpReactor::StartWrite(IoOp* op) {
+  WSABUF buffer;
+  buffer.buf = op->buffer + op->transferred;
+  buffer.len = (ULONG)(op->length - op->transferred);
+  if (WSASend(op->socket, &buffer, 1, NULL, 0, Overlapped(op), NULL) != 0 &&
+      WSAGetLastError() != WSA_IO_PENDING) {
+    op->error = WSAGetLastError();
+    return false;
+  }
+  return true;
+}
+
+void IocpReactor::Close(SocketHandle socket) {
+  // Ожидающие операции завершатся через порт с WSA_OPERATION_ABORTED
+  closesocket(socket);
+}
+
+void IocpReactor::Finish(IoOp* op, DWORD bytes, bool success) {
+  if (!success) {
+    DWORD flags = 0;
+    if (!WSAGetOverlappedResult(op->socket, Overlapped(op), &bytes, FALSE, &flags)) {
+      op->error = WSAGetLastError();
+    }
+  }
+
+  switch (op->type) {
+    case IoOpType::kAccept:
+      if (op->error == 0) {
+        setsockopt(op->accepted, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                   (const char*)&op->socket, sizeof(op->socket));
+      } else if (op->accepted != INVALID_SOCKET) {
+        closesocket(op->accepted);
+        op->accepted = INVALID_SOCKET;
+      }
+      break;
+    case IoOpType::kConnect:
+      if (op->error == 0) {
+        setsockopt(op->socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0);
+      }
+      break;
+    case IoOpType::kRead:
+      op->transferred = bytes;
+      break;
+    case IoOpType::kWrite:
+      op->transferred += bytes;
+      // Частичная отправка: дописываем остаток, завершение придет позже
+      if (op->error == 0 && bytes > 0 && op->transferred < op->length) {
+        memset(Overlapped(op), 0, sizeof(OVERLAPPED));
+        if (StartWrite(op)) {
+          return;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  op->handler->OnIoComplete(op);
+}
+
+size_t IocpReactor::Poll(int timeout_ms) {
+  OVERLAPPED_ENTRY entries[kMaxEntries];
+  ULONG count = 0;
+  if (!GetQueuedCompletionStatusEx(port_, entries, kMaxEntries, &count,
+                                   timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms, FALSE)) {
+    return 0;
+  }
+
+  size_t delivered = 0;
+  for (ULONG i = 0; i < count; i++) {
+    if (entries[i].lpCompletionKey == kWakeKey || entries[i].lpOverlapped == NULL) {
+      continue;
+    }
+    IoOp* op = OpFromOverlapped(entries[i].lpOverlapped);
+    // Internal содержит NTSTATUS; успех - 0
+    bool success = entries[i].lpOverlapped->Internal == 0;
+    Finish(op, entries[i].dwNumberOfBytesTransferred, success);
+    delivered++;
+  }
+  return delivered;
+}
+
+void IocpReactor::Wake() {
+  PostQueuedCompletionStatus(port_, 0, kWakeKey, NULL);
+}
+
+#endif  // defined(_WIN32)
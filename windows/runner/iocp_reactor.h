@@ -0,0 +1,41 @@
+#ifndef RUNNER_IOCP_REACTOR_H_
+#define RUNNER_IOCP_REACTOR_H_
+
+#if defined(_WIN32)
+
+#include <winsock2.h>
+#include <mswsock.h>
+#include <windows.h>
+
+#include "reactor.h"
+
+// Реактор на порте завершения ввода-вывода (IOCP). Операции запускаются
+// перекрывающимися вызовами AcceptEx/ConnectEx/WSARecv/WSASend, а Poll()
+// забирает завершения пачкой через GetQueuedCompletionStatusEx.
+class IocpReactor : public Reactor {
+ public:
+  IocpReactor();
+  ~IocpReactor() override;
+
+  bool Open();
+
+  bool Attach(SocketHandle socket) override;
+  bool Submit(IoOp* op) override;
+  void Close(SocketHandle socket) override;
+  size_t Poll(int timeout_ms) override;
+  void Wake() override;
+  const char* name() const override { return "iocp"; }
+
+ private:
+  bool LoadExtensions(SocketHandle socket);
+  bool StartWrite(IoOp* op);
+  void Finish(IoOp* op, DWORD bytes, bool success);
+
+  HANDLE port_ = NULL;
+  LPFN_ACCEPTEX accept_ex_ = nullptr;
+  LPFN_CONNECTEX connect_ex_ = nullptr;
+};
+
+#endif  // defined(_WIN32)
+
+#endif  // RUNNER_IOCP_REACTOR_H_
@@ -0,0 +1,265 @@
+#include "json_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+// Ограничение вложенности для Skip()
+constexpr int kMaxDepth = 128;
+
+void AppendUtf8(std::string* out, uint32_t code) {
+  if (code < 0x80) {
+    out->push_back((char)code);
+  } else if (code < 0x800) {
+    out->push_back((char)(0xC0 | (code >> 6)));
+    out->push_back((char)(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out->push_back((char)(0xE0 | (code >> 12)));
+    out->push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back((char)(0x80 | (code & 0x3F)));
+  } else {
+    out->push_back((char)(0xF0 | (code >> 18)));
+    out->push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+    out->push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back((char)(0x80 | (code & 0x3F)));
+  }
+}
+
+}  // namespace
+
+JsonReader::JsonReader(const char* data, size_t length)
+    : data_(data), length_(length) {}
+
+void JsonReader::SkipWhitespace() {
+  while (position_ < length_) {
+    char c = data_[position_];
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+      break;
+    }
+    position_++;
+  }
+}
+
+bool JsonReader::Fail() {
+  failed_ = true;
+  return false;
+}
+
+bool JsonReader::Expect(char c) {
+  if (failed_) {
+    return false;
+  }
+  SkipWhitespace();
+  if (position_ >= length_ || data_[position_] != c) {
+    return Fail();
+  }
+  position_++;
+  return true;
+}
+
+char JsonReader::Peek() {
+  if (failed_) {
+    return '\0';
+  }
+  SkipWhitespace();
+  return position_ < length_ ? data_[position_] : '\0';
+}
+
+bool JsonReader::BeginObject() {
+  return Expect('{');
+}
+
+bool JsonReader::BeginArray() {
+  return Expect('[');
+}
+
+bool JsonReader::NextKey(std::string* key) {
+  char c = Peek();
+  if (c == '}') {
+    position_++;
+    return false;
+  }
+  if (c == ',') {
+    position_++;
+  }
+  return ReadString(key) && Expect(':');
+}
+
+bool JsonReader::NextElement() {
+  char c = Peek();
+  if (c == ']') {
+    position_++;
+    return false;
+  }
+  if (c == ',') {
+    position_++;
+    c = Peek();
+  }
+  return c != '\0' && c != ']' && !failed_ ? true : Fail();
+}
+
+bool JsonReader::ReadHex4(uint32_t* value) {
+  if (length_ - position_ < 4) {
+    return Fail();
+  }
+  uint32_t result = 0;
+  for (int i = 0; i < 4; i++) {
+    char c = data_[position_++];
+    result <<= 4;
+    if (c >= '0' && c <= '9') {
+      result |= (uint32_t)(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      result |= (uint32_t)(c - 'a' + 10);
+    } else if (c >= 'A' && c <= 'F') {
+      result |= (uint32_t)(c - 'A' + 10);
+    } else {
+      return Fail();
+    }
+  }
+  *value = result;
+  return true;
+}
+
+bool JsonReader::ReadString(std::string* value) {
+  if (!Expect('"')) {
+    return false;
+  }
+  value->clear();
+  while (position_ < length_) {
+    // Копируем участок без экранирования целиком
+    size_t start = position_;
+    while (position_ < length_ && data_[position_] != '"' && data_[position_] != '\\') {
+      position_++;
+    }
+    value->append(data_ + start, position_ - start);
+    if (position_ >= length_) {
+      break;
+    }
+    if (data_[position_++] == '"') {
+      return true;
+    }
+    if (position_ >= length_) {
+      break;
+    }
+    char escape = data_[position_++];
+    switch (escape) {
+      case '"': value->push_back('"'); break;
+      case '\\': value->push_back('\\'); break;
+      case '/': value->push_back('/'); break;
+      case 'b': value->push_back('\b'); break;
+      case 'f': value->push_back('\f'); break;
+      case 'n': value->push_back('\n'); break;
+      case 'r': value->push_back('\r'); break;
+      case 't': value->push_back('\t'); break;
+      case 'u': {
+        uint32_t code;
+        if (!ReadHex4(&code)) {
+          return false;
+        }
+        // Суррогатная пара
+        if (code >= 0xD800 && code < 0xDC00 && length_ - position_ >= 6 &&
+            data_[position_] == '\\' && data_[position_ + 1] == 'u') {
+          position_ += 2;
+          uint32_t low;
+          if (!ReadHex4(&low)) {
+            return false;
+          }
+          if (low >= 0xDC00 && low < 0xE000) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+        }
+        AppendUtf8(value, code);
+        break;
+      }
+      default:
+        return Fail();
+    }
+  }
+  return Fail();
+}
+
+bool JsonReader::ReadLiteral(const char* literal) {
+  size_t length = strlen(literal);
+  if (length_ - position_ < length || memcmp(data_ + position_, literal, length) != 0) {
+    return Fail();
+  }
+  position_ += length;
+  return true;
+}
+
+bool JsonReader::ReadBool(bool* value) {
+  char c = Peek();
+  if (c == 't' && ReadLiteral("true")) {
+    *value = true;
+    return true;
+  }
+  if (c == 'f' && ReadLiteral("false")) {
+    *value = false;
+    return true;
+  }
+  return Fail();
+}
+
+bool JsonReader::ReadNumber(double* value) {
+  char c = Peek();
+  if (c != '-' && (c < '0' || c > '9')) {
+    return Fail();
+  }
+  // strtod не знает длины буфера, поэтому копируем лексему
+  char buffer[64];
+  size_t length = 0;
+  while (position_ < length_ && length + 1 < sizeof(buffer)) {
+    c = data_[position_];
+    if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' ||
+          c == 'E')) {
+      break;
+    }
+    buffer[length++] = c;
+    position_++;
+  }
+  buffer[length] = '\0';
+  char* end = nullptr;
+  *value = strtod(buffer, &end);
+  return end == buffer + length ? true : Fail();
+}
+
+bool JsonReader::Skip() {
+  char c = Peek();
+  switch (c) {
+    case '"': {
+      std::string ignored;
+      return ReadString(&ignored);
+    }
+    case 't':
+      return ReadLiteral("true");
+    case 'f':
+      return ReadLiteral("false");
+    case 'n':
+      return ReadLiteral("null");
+    case '{':
+    case '[': {
+      if (++depth_ > kMaxDepth) {
+        return Fail();
+      }
+      position_++;
+      bool ok = true;
+      if (c == '{') {
+        std::string key;
+        while (ok && NextKey(&key)) {
+          ok = Skip();
+        }
+      } else {
+        while (ok && NextElement()) {
+          ok = Skip();
+        }
+      }
+      depth_--;
+      return ok && !failed_;
+    }
+    default: {
+      double ignored;
+      return ReadNumber(&ignored);
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef RUNNER_JSON_READER_H_
+#define RUNNER_JSON_READER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Потоковое чтение JSON без построения дерева.
+//
+// Читатель идет по тексту курсором: вызывающий сам открывает объекты и
+// массивы, перебирает ключи/элементы и читает нужные значения, а ненужные
+// пропускает через Skip(). Первая ошибка запоминается, и все последующие
+// вызовы возвращают false.
+class JsonReader {
+ public:
+  JsonReader(const char* data, size_t length);
+
+  // Открыть объект/массив ('{' / '[')
+  bool BeginObject();
+  bool BeginArray();
+
+  // Следующий ключ объекта (после него курсор стоит на значении).
+  // false - объект закончился ('}' прочитана) или ошибка.
+  bool NextKey(std::string* key);
+
+  // Есть ли следующий элемент массива. false - массив закончился или ошибка.
+  bool NextElement();
+
+  // Прочитать значение. Тип не совпал - ошибка.
+  bool ReadString(std::string* value);
+  bool ReadBool(bool* value);
+  bool ReadNumber(double* value);
+
+  // Пропустить значение любого типа
+  bool Skip();
+
+  // Тип следующего значения: '{', '[', '"', 't', 'f', 'n', цифра или '-'
+  char Peek();
+
+  bool failed() const { return failed_; }
+
+ private:
+  void SkipWhitespace();
+  bool Fail();
+  bool Expect(char c);
+  bool ReadLiteral(const char* literal);
+  bool ReadHex4(uint32_t* value);
+
+  const char* data_;
+  size_t length_;
+  size_t position_ = 0;
+  int depth_ = 0;
+  bool failed_ = false;
+};
+
+#endif  // RUNNER_JSON_READER_H_
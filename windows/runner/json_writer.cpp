@@ -0,0 +1,144 @@
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// Символы, которые экранирует jsonEncode: управляющие, '"' и '\'
+struct EscapeTable {
+  bool escape[256] = {};
+
+  EscapeTable() {
+    for (int c = 0; c < 0x20; c++) {
+      escape[c] = true;
+    }
+    escape['"'] = true;
+    escape['\\'] = true;
+  }
+};
+
+const EscapeTable kEscape;
+
+}  // namespace
+
+void JsonWriter::Reset() {
+  buffer_.clear();
+  has_items_ = 0;
+  depth_ = 0;
+  after_key_ = false;
+  overflow_ = false;
+}
+
+void JsonWriter::BeforeValue() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (depth_ > 0 && depth_ <= kMaxDepth) {
+    uint64_t bit = 1ull << (depth_ - 1);
+    if (has_items_ & bit) {
+      buffer_.push_back(',');
+    }
+    has_items_ |= bit;
+  }
+}
+
+void JsonWriter::Open(char bracket) {
+  BeforeValue();
+  buffer_.push_back(bracket);
+  if (++depth_ > kMaxDepth) {
+    overflow_ = true;
+    return;
+  }
+  has_items_ &= ~(1ull << (depth_ - 1));
+}
+
+void JsonWriter::Close(char bracket) {
+  buffer_.push_back(bracket);
+  if (depth_ > 0) {
+    depth_--;
+  }
+}
+
+void JsonWriter::BeginObject() { Open('{'); }
+
+void JsonWriter::EndObject() { Close('}'); }
+
+void JsonWriter::BeginArray() { Open('['); }
+
+void JsonWriter::EndArray() { Close(']'); }
+
+void JsonWriter::Key(const char* key) {
+  BeforeValue();
+  AppendEscaped(key, strlen(key));
+  buffer_.push_back(':');
+  after_key_ = true;
+}
+
+void JsonWriter::String(const char* value) { String(value, strlen(value)); }
+
+void JsonWriter::String(const char* value, size_t length) {
+  BeforeValue();
+  AppendEscaped(value, length);
+}
+
+void JsonWriter::Int(int64_t value) {
+  BeforeValue();
+  char digits[24];
+  int length = snprintf(digits, sizeof(digits), "%lld", (long long)value);
+  buffer_.append(digits, (size_t)length);
+}
+
+void JsonWriter::Bool(bool value) {
+  BeforeValue();
+  buffer_.append(value ? "true" : "false");
+}
+
+void JsonWriter::Null() {
+  BeforeValue();
+  buffer_.append("null");
+}
+
+void JsonWriter::AppendEscaped(const char* value, size_t length) {
+  buffer_.push_back('"');
+  size_t run = 0;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = (uint8_t)value[i];
+    if (!kEscape.escape[c]) {
+      continue;
+    }
+    buffer_.append(value + run, i - run);
+    run = i + 1;
+    buffer_.push_back('\\');
+    switch (c) {
+      case '"':
+      case '\\':
+        buffer_.push_back((char)c);
+        break;
+      case '\b':
+        buffer_.push_back('b');
+        break;
+      case '\t':
+        buffer_.push_back('t');
+        break;
+      case '\n':
+        buffer_.push_back('n');
+        break;
+      case '\f':
+        buffer_.push_back('f');
+        break;
+      case '\r':
+        buffer_.push_back('r');
+        break;
+      default: {
+        static const char kHex[] = "0123456789abcdef";
+        const char escaped[] = {'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+        buffer_.append(escaped, sizeof(escaped));
+        break;
+      }
+    }
+  }
+  buffer_.append(value + run, length - run);
+  buffer_.push_back('"');
+}
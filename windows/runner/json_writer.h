@@ -0,0 +1,54 @@
+#ifndef RUNNER_JSON_WRITER_H_
+#define RUNNER_JSON_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Потоковая запись JSON в буфер, без дерева значений. Вывод совпадает с
+// jsonEncode() в Dart: без пробелов, в строках экранируются только '"',
+// '\' и управляющие символы, остальной UTF-8 пишется как есть.
+//
+// Буфер переиспользуется: Reset() очищает его, не освобождая память.
+class JsonWriter {
+ public:
+  static constexpr int kMaxDepth = 64;
+
+  JsonWriter() = default;
+
+  void Reset();
+
+  void BeginObject();
+  void EndObject();
+  void BeginArray();
+  void EndArray();
+
+  // Ключ объекта; следующий вызов пишет его значение
+  void Key(const char* key);
+
+  void String(const char* value);
+  void String(const char* value, size_t length);
+  void Int(int64_t value);
+  void Bool(bool value);
+  void Null();
+
+  const std::string& buffer() const { return buffer_; }
+  // Скобки сбалансированы и ключей без значения нет
+  bool complete() const { return depth_ == 0 && !after_key_ && !overflow_; }
+
+ private:
+  void BeforeValue();
+  void Open(char bracket);
+  void Close(char bracket);
+  void AppendEscaped(const char* value, size_t length);
+
+  std::string buffer_;
+  // Бит уровня вложенности: на нем уже есть элемент (нужна запятая)
+  uint64_t has_items_ = 0;
+  int depth_ = 0;
+  bool after_key_ = false;
+  bool overflow_ = false;
+};
+
+#endif  // RUNNER_JSON_WRITER_H_
@@ -0,0 +1,358 @@
+#include "latency_prober.h"
+
+#include <chrono>
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netinet/in.h>
+#endif
+
+namespace {
+
+// Предельное ожидание в Poll(): столько же ждет остановка потока
+constexpr int kPollTimeoutMs = 100;
+
+// Сколько ждать отмены замеров при остановке
+constexpr int64_t kShutdownTimeoutUs = 2 * 1000 * 1000;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool IsRefused(int error) {
+#if defined(_WIN32)
+  return error == WSAECONNREFUSED;
+#else
+  return error == ECONNREFUSED;
+#endif
+}
+
+}  // namespace
+
+// Один замер: гонка соединений к адресам цели
+class LatencyProber::Probe : public ConnectHandler {
+ public:
+  explicit Probe(LatencyProber* owner)
+      : connector(owner->reactor_.get(), &owner->timers_, &owner->family_cache_),
+        owner_(owner) {}
+
+  void OnConnectComplete(HappyEyeballsConnector* completed) override {
+    (void)completed;
+    owner_->OnProbeComplete(this);
+  }
+
+  HappyEyeballsConnector connector;
+  size_t slot = 0;
+  uint32_t epoch = 0;
+  int64_t started_us = 0;
+  int64_t deadline_us = 0;
+  bool active = false;
+  bool timed_out = false;
+
+ private:
+  LatencyProber* owner_;
+};
+
+LatencyProber::LatencyProber() = default;
+
+LatencyProber::~LatencyProber() { Stop(); }
+
+bool LatencyProber::Start(const Options& options) {
+  if (running_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  reactor_ = Reactor::Create();
+  if (!reactor_) {
+    return false;
+  }
+  resolver_.reset(new HostResolver(1));
+  options_ = options;
+  if (options_.max_in_flight == 0) {
+    options_.max_in_flight = 1;
+  }
+  probes_.clear();
+  free_probes_.clear();
+  for (size_t i = 0; i < options_.max_in_flight; i++) {
+    probes_.emplace_back(new Probe(this));
+    free_probes_.push_back(probes_.back().get());
+  }
+  for (Estimate& estimate : estimates_) {
+    estimate = Estimate();
+  }
+  queue_.clear();
+  queue_head_ = 0;
+  next_round_us_ = 0;
+  stopping_.store(false, std::memory_order_relaxed);
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&LatencyProber::Loop, this);
+  return true;
+}
+
+void LatencyProber::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  // Незавершенные разрешения имен завершаются с ошибкой и целей не меняют
+  resolver_->Shutdown();
+  stopping_.store(true, std::memory_order_release);
+  reactor_->Wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  probes_.clear();
+  free_probes_.clear();
+  reactor_.reset();
+  resolver_.reset();
+}
+
+int32_t LatencyProber::AddTarget(const sockaddr_storage& address, int length) {
+  if (length <= 0 || (size_t)length > sizeof(address)) {
+    return -1;
+  }
+  ResolvedAddress target;
+  target.address = address;
+  target.length = length;
+  return Register(std::string(), std::vector<ResolvedAddress>(1, target));
+}
+
+int32_t LatencyProber::AddTarget(const std::string& host, uint16_t port) {
+  ResolvedAddress literal;
+  if (ParseIpLiteral(host, port, &literal.address, &literal.length)) {
+    return Register(std::string(), std::vector<ResolvedAddress>(1, literal));
+  }
+  if (!IsRunning()) {
+    return -1;
+  }
+  int32_t id = Register(host, std::vector<ResolvedAddress>());
+  if (id < 0) {
+    return -1;
+  }
+  uint32_t epoch = slots_[id].epoch.load(std::memory_order_relaxed);
+  resolver_->ResolveAll(host, port, [this, id, epoch](const std::vector<ResolvedAddress>& addresses) {
+    if (addresses.empty()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Target& target = targets_[id];
+      if (!target.used || target.epoch != epoch) {
+        return;  // цель удалена, пока разрешалось имя
+      }
+      target.addresses = addresses;
+    }
+    ProbeNow();
+  });
+  return id;
+}
+
+int32_t LatencyProber::Register(const std::string& host, std::vector<ResolvedAddress> addresses) {
+  int32_t id = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < kMaxTargets; i++) {
+      if (!targets_[i].used) {
+        Target& target = targets_[i];
+        target.used = true;
+        target.epoch++;
+        target.host = host;
+        target.addresses = std::move(addresses);
+        // Читатели отсекают статистику прежней цели этого места по эпохе
+        slots_[i].epoch.store(target.epoch, std::memory_order_release);
+        id = (int32_t)i;
+        break;
+      }
+    }
+  }
+  if (id >= 0) {
+    ProbeNow();
+  }
+  return id;
+}
+
+void LatencyProber::RemoveTarget(int32_t id) {
+  if (id < 0 || (size_t)id >= kMaxTargets) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Target& target = targets_[id];
+  if (target.used) {
+    target.used = false;
+    target.epoch++;
+    slots_[id].epoch.store(target.epoch, std::memory_order_release);
+  }
+}
+
+void LatencyProber::ProbeNow() {
+  probe_now_.store(true, std::memory_order_release);
+  if (IsRunning()) {
+    reactor_->Wake();
+  }
+}
+
+bool LatencyProber::Read(int32_t id, LatencyStats* stats) const {
+  if (id < 0 || (size_t)id >= kMaxTargets) {
+    return false;
+  }
+  const Slot& slot = slots_[id];
+  uint32_t epoch = slot.epoch.load(std::memory_order_acquire);
+  for (;;) {
+    uint32_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;  // идет запись
+    }
+    uint32_t stats_epoch = slot.stats_epoch.load(std::memory_order_relaxed);
+    LatencyStats result;
+    result.smoothed_us = slot.smoothed_us.load(std::memory_order_relaxed);
+    result.jitter_us = slot.jitter_us.load(std::memory_order_relaxed);
+    result.last_us = slot.last_us.load(std::memory_order_relaxed);
+    result.samples = slot.samples.load(std::memory_order_relaxed);
+    result.failures = slot.failures.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != before) {
+      continue;
+    }
+    // Замеры прежней цели этого места не показываем
+    if (stats_epoch != epoch || (result.samples == 0 && result.failures == 0)) {
+      return false;
+    }
+    *stats = result;
+    return true;
+  }
+}
+
+void LatencyProber::Publish(size_t index, uint32_t epoch, const LatencyStats& stats) {
+  Slot& slot = slots_[index];
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.stats_epoch.store(epoch, std::memory_order_relaxed);
+  slot.smoothed_us.store(stats.smoothed_us, std::memory_order_relaxed);
+  slot.jitter_us.store(stats.jitter_us, std::memory_order_relaxed);
+  slot.last_us.store(stats.last_us, std::memory_order_relaxed);
+  slot.samples.store(stats.samples, std::memory_order_relaxed);
+  slot.failures.store(stats.failures, std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void LatencyProber::Loop() {
+  while (!stopping_.load(std::memory_order_acquire)) {
+    int64_t now = NowUs();
+    if (probe_now_.exchange(false, std::memory_order_acq_rel) || now >= next_round_us_) {
+      StartRound();
+      next_round_us_ = now + (int64_t)options_.interval_ms * 1000;
+    }
+    Launch(now);
+    Expire(now);
+
+    // Ждем до ближайшего события: нового круга или таймаута замера
+    int64_t wake = next_round_us_;
+    for (const auto& probe : probes_) {
+      if (probe->active && !probe->timed_out && probe->deadline_us < wake) {
+        wake = probe->deadline_us;
+      }
+    }
+    int64_t wait_ms = (wake - now + 999) / 1000;
+    reactor_->Poll(timers_.RunDue(
+        wait_ms < 0 ? 0 : (wait_ms > kPollTimeoutMs ? kPollTimeoutMs : (int)wait_ms)));
+  }
+
+  // Отменяем незавершенные замеры и дожидаемся их завершений
+  int64_t deadline = NowUs() + kShutdownTimeoutUs;
+  Expire(INT64_MAX);
+  while (free_probes_.size() < probes_.size() && NowUs() < deadline) {
+    reactor_->Poll(kPollTimeoutMs);
+  }
+}
+
+void LatencyProber::StartRound() {
+  // Незапущенный остаток прошлого круга заменяется новым
+  queue_.clear();
+  queue_head_ = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < kMaxTargets; i++) {
+    const Target& target = targets_[i];
+    if (!target.used || target.addresses.empty() ||
+        (estimates_[i].in_flight && estimates_[i].epoch == target.epoch)) {
+      continue;
+    }
+    queue_.push_back(Pending{i, target.epoch, target.host, target.addresses});
+  }
+}
+
+void LatencyProber::Launch(int64_t now_us) {
+  while (queue_head_ < queue_.size() && !free_probes_.empty()) {
+    const Pending& pending = queue_[queue_head_++];
+    Estimate& estimate = estimates_[pending.slot];
+    if (estimate.epoch != pending.epoch) {
+      // Новая цель на месте прежней: сглаживание начинается заново
+      estimate = Estimate();
+      estimate.epoch = pending.epoch;
+    }
+    if (estimate.in_flight) {
+      continue;
+    }
+
+    Probe* probe = free_probes_.back();
+    free_probes_.pop_back();
+    probe->slot = pending.slot;
+    probe->epoch = pending.epoch;
+    probe->started_us = now_us;
+    probe->deadline_us = now_us + (int64_t)options_.timeout_ms * 1000;
+    probe->timed_out = false;
+    probe->active = true;
+    estimate.in_flight = true;
+    // Итог может прийти сразу, если ни одна попытка не началась
+    probe->connector.Start(pending.host, pending.addresses.data(), pending.addresses.size(),
+                           probe);
+  }
+}
+
+void LatencyProber::Expire(int64_t now_us) {
+  for (const auto& probe : probes_) {
+    if (probe->active && !probe->timed_out && now_us >= probe->deadline_us) {
+      // Завершение с отменой придет через Poll()
+      probe->timed_out = true;
+      probe->connector.Cancel();
+    }
+  }
+}
+
+void LatencyProber::OnProbeComplete(Probe* probe) {
+  int64_t elapsed = NowUs() - probe->started_us;
+  SocketHandle socket = probe->connector.TakeSocket();
+  if (socket != kInvalidSocket) {
+    reactor_->Close(socket);
+  }
+  probe->active = false;
+  free_probes_.push_back(probe);
+
+  Estimate& estimate = estimates_[probe->slot];
+  if (estimate.epoch != probe->epoch) {
+    return;  // цель заменена, пока шел замер
+  }
+  estimate.in_flight = false;
+  LatencyStats& stats = estimate.stats;
+  bool answered = socket != kInvalidSocket || IsRefused(probe->connector.error());
+  if (probe->timed_out || !answered) {
+    stats.failures++;
+  } else {
+    uint32_t rtt = elapsed > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    if (stats.samples == 0) {
+      stats.smoothed_us = rtt;
+      stats.jitter_us = rtt / 2;
+    } else {
+      uint32_t deviation = rtt > stats.smoothed_us ? rtt - stats.smoothed_us
+                                                   : stats.smoothed_us - rtt;
+      stats.jitter_us = (uint32_t)(((uint64_t)stats.jitter_us * 3 + deviation) / 4);
+      stats.smoothed_us = (uint32_t)(((uint64_t)stats.smoothed_us * 7 + rtt) / 8);
+    }
+    stats.last_us = rtt;
+    stats.samples++;
+    stats.failures = 0;
+  }
+  Publish(probe->slot, probe->epoch, stats);
+}
@@ -0,0 +1,144 @@
+#ifndef RUNNER_LATENCY_PROBER_H_
+#define RUNNER_LATENCY_PROBER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "happy_eyeballs.h"
+#include "host_resolver.h"
+#include "reactor.h"
+
+// Сглаженные результаты замеров одной цели
+struct LatencyStats {
+  uint32_t smoothed_us = 0;  // EWMA времени установки соединения
+  uint32_t jitter_us = 0;    // EWMA отклонения от smoothed_us
+  uint32_t last_us = 0;      // последний успешный замер
+  uint32_t samples = 0;      // успешных замеров
+  uint32_t failures = 0;     // таймаутов и ошибок подряд
+};
+
+// Фоновый замер задержки до серверов по времени установки TCP-соединения.
+//
+// Все замеры идут параллельно в одном потоке на собственном Reactor: раз в
+// interval_ms для каждой цели отправляется connect(), время до его
+// завершения и есть RTT (отказ RST тоже ответ сервера и считается замером).
+// К целям, заданным именем, соединение идет гонкой Happy Eyeballs по всем
+// адресам имени, так что замер отражает путь, которым пойдет трафик.
+// Сглаживание - как SRTT/RTTVAR в TCP (RFC 6298): коэффициенты 1/8 и 1/4.
+//
+// Результаты читаются без блокировок и из любого потока: статистика каждой
+// цели публикуется под seqlock, писатель у нее один - поток замеров.
+class LatencyProber {
+ public:
+  static constexpr size_t kMaxTargets = 256;
+
+  struct Options {
+    uint32_t interval_ms = 10 * 1000;
+    uint32_t timeout_ms = 1000;
+    size_t max_in_flight = 64;
+  };
+
+  LatencyProber();
+  ~LatencyProber();
+
+  LatencyProber(const LatencyProber&) = delete;
+  LatencyProber& operator=(const LatencyProber&) = delete;
+
+  bool Start(const Options& options);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  // Добавить цель; возвращает ее номер или -1, если мест нет. Первый замер
+  // новой цели выполняется сразу.
+  int32_t AddTarget(const sockaddr_storage& address, int length);
+  // Цель по имени или IP-литералу; имя разрешается в фоне, до этого
+  // цель не замеряется. Только после Start().
+  int32_t AddTarget(const std::string& host, uint16_t port);
+  void RemoveTarget(int32_t id);
+
+  // Начать внеочередной круг замеров
+  void ProbeNow();
+
+  // Последние сглаженные значения; false - цели нет или еще не было ни
+  // одного замера (ни удачного, ни неудачного)
+  bool Read(int32_t id, LatencyStats* stats) const;
+
+ private:
+  class Probe;
+
+  // Опубликованная статистика цели. Поля атомарны, чтобы чтение во время
+  // записи не было гонкой; согласованность снимка обеспечивает sequence.
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> epoch{0};  // текущая цель места (AddTarget)
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> stats_epoch{0};  // цель, к которой относятся замеры
+    std::atomic<uint32_t> smoothed_us{0};
+    std::atomic<uint32_t> jitter_us{0};
+    std::atomic<uint32_t> last_us{0};
+    std::atomic<uint32_t> samples{0};
+    std::atomic<uint32_t> failures{0};
+  };
+
+  // Цель под mutex_ (меняется из потоков вызывающих)
+  struct Target {
+    bool used = false;
+    uint32_t epoch = 0;
+    std::string host;  // ключ истории семейств; пусто - цель задана адресом
+    std::vector<ResolvedAddress> addresses;
+  };
+
+  // Поток замеров: очередной запуск и состояние цели
+  struct Pending {
+    size_t slot;
+    uint32_t epoch;
+    std::string host;
+    std::vector<ResolvedAddress> addresses;
+  };
+
+  struct Estimate {
+    uint32_t epoch = 0;
+    bool in_flight = false;
+    LatencyStats stats;
+  };
+
+  void Loop();
+  void StartRound();
+  void Launch(int64_t now_us);
+  void Expire(int64_t now_us);
+  void OnProbeComplete(Probe* probe);
+  void Publish(size_t slot, uint32_t epoch, const LatencyStats& stats);
+  int32_t Register(const std::string& host, std::vector<ResolvedAddress> addresses);
+
+  Options options_;
+  std::unique_ptr<Reactor> reactor_;
+  std::unique_ptr<HostResolver> resolver_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> probe_now_{false};
+
+  Slot slots_[kMaxTargets];
+
+  std::mutex mutex_;
+  Target targets_[kMaxTargets];
+
+  // Поток замеров
+  ConnectorTimers timers_;
+  AddressFamilyCache family_cache_;
+  Estimate estimates_[kMaxTargets];
+  std::vector<Pending> queue_;
+  size_t queue_head_ = 0;
+  std::vector<std::unique_ptr<Probe>> probes_;
+  std::vector<Probe*> free_probes_;
+  int64_t next_round_us_ = 0;
+};
+
+#endif  // RUNNER_LATENCY_PROBER_H_
@@ -17,12 +17,30 @@ __declspec(dllexport) int32_t SetupSocksProxy(const char* serverAddress, const c
 // Настройка поддержки UDP
 __declspec(dllexport) int32_t SetupUdpRedirection(int32_t enableUdp);
 
+// Запуск и остановка встроенного SOCKS5/HTTP CONNECT прокси
+__declspec(dllexport) int32_t StartLocalProxy(int32_t port, int32_t workers);
+__declspec(dllexport) int32_t StopLocalProxy();
+
+// Тот же прокси перед ядром VPN: маршрут по текущему профилю, proxy - в
+// SOCKS5 ядра на 127.0.0.1:upstreamPort
+__declspec(dllexport) int32_t StartRoutingProxy(int32_t port, int32_t upstreamPort, int32_t workers);
+
+// Fake-IP DNS: адреса из 198.18.0.0/15 для имен, уходящих в прокси
+__declspec(dllexport) int32_t StartFakeDns(int32_t port, const char* upstream);
+__declspec(dllexport) int32_t StopFakeDns();
+__declspec(dllexport) int32_t FakeIpToDomain(const char* address, char* domain, int32_t capacity);
+
 // Очистка ресурсов и восстановление настроек
 __declspec(dllexport) int32_t CleanupWinDivert();
 
 // Получение статистики трафика
 __declspec(dllexport) int32_t GetTrafficStats(int64_t* downloadedBytes, int64_t* uploadedBytes, int32_t* ping);
 
+// Фоновый замер пинга до произвольных серверов
+__declspec(dllexport) int32_t AddLatencyTarget(const char* address, int32_t port);
+__declspec(dllexport) int32_t RemoveLatencyTarget(int32_t id);
+__declspec(dllexport) int32_t GetLatencyStats(int32_t id, int32_t* smoothedMs, int32_t* jitterMs, int32_t* lastMs, int32_t* failures);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,250 @@
+#include "log_file.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Длина данных файла, не закрытого после сбоя: он остается размером с
+// отображение, а строки журнала не содержат нулей, так что данные - префикс
+// без нулей, и граница ищется делением пополам. |read_byte(offset, &byte)|
+template <typename ReadByte>
+uint64_t DataLength(uint64_t size, ReadByte read_byte) {
+  uint64_t low = 0;
+  uint64_t high = size;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    char byte;
+    if (!read_byte(middle, &byte)) {
+      return size;
+    }
+    if (byte != '\0') {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+#if defined(_WIN32)
+
+std::wstring Widen(const std::string& text) {
+  int size = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), NULL, 0);
+  std::wstring result(size > 0 ? size : 0, L'\0');
+  if (size > 0) {
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &result[0], size);
+  }
+  return result;
+}
+
+void RenameFile(const std::string& from, const std::string& to) {
+  MoveFileExW(Widen(from).c_str(), Widen(to).c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+bool SetFileSize(HANDLE file, uint64_t size) {
+  LARGE_INTEGER position;
+  position.QuadPart = (LONGLONG)size;
+  return SetFilePointerEx(file, position, NULL, FILE_BEGIN) && SetEndOfFile(file);
+}
+
+void TrimZeroTail(const std::string& path) {
+  HANDLE file = CreateFileW(Widen(path).c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size)) {
+    uint64_t size = (uint64_t)file_size.QuadPart;
+    uint64_t length = DataLength(size, [file](uint64_t offset, char* byte) {
+      LARGE_INTEGER position;
+      position.QuadPart = (LONGLONG)offset;
+      DWORD read = 0;
+      return SetFilePointerEx(file, position, NULL, FILE_BEGIN) &&
+             ReadFile(file, byte, 1, &read, NULL) && read == 1;
+    });
+    if (length != size) {
+      SetFileSize(file, length);
+    }
+  }
+  CloseHandle(file);
+}
+
+#else
+
+void RenameFile(const std::string& from, const std::string& to) {
+  rename(from.c_str(), to.c_str());
+}
+
+bool SetFileSize(int fd, uint64_t size) { return ftruncate(fd, (off_t)size) == 0; }
+
+void TrimZeroTail(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0) {
+    uint64_t size = (uint64_t)info.st_size;
+    uint64_t length = DataLength(size, [fd](uint64_t offset, char* byte) {
+      return pread(fd, byte, 1, (off_t)offset) == 1;
+    });
+    if (length != size) {
+      SetFileSize(fd, length);
+    }
+  }
+  close(fd);
+}
+
+#endif
+
+}  // namespace
+
+LogFile::LogFile() {}
+
+LogFile::~LogFile() { Close(); }
+
+bool LogFile::Open(const std::string& path, size_t capacity, size_t max_capacity) {
+  Close();
+  path_ = path;
+  initial_capacity_ = capacity;
+  max_capacity_ = max_capacity;
+  TrimZeroTail(path_);
+  return Create();
+}
+
+void LogFile::Close() { Unmap(); }
+
+bool LogFile::Rotate() {
+  if (path_.empty()) {
+    return false;
+  }
+  Unmap();
+  return Create();
+}
+
+bool LogFile::Append(const char* data, size_t length) {
+  if (data_ == nullptr || (capacity_ - size_ < length && !Grow(size_ + length))) {
+    return false;
+  }
+  memcpy(data_ + size_, data, length);
+  size_ += length;
+  return true;
+}
+
+bool LogFile::Grow(size_t needed) {
+  size_t capacity = capacity_;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  if (capacity > max_capacity_) {
+    return false;
+  }
+  size_t previous = capacity_;
+  UnmapView();
+  if (Map(capacity)) {
+    return true;
+  }
+  // Прежний размер файла еще отображается
+  if (!Map(previous)) {
+    Unmap();
+  }
+  return false;
+}
+
+bool LogFile::Create() {
+  for (int i = kKeepRotated; i > 0; i--) {
+    std::string from = i > 1 ? path_ + "." + std::to_string(i - 1) : path_;
+    RenameFile(from, path_ + "." + std::to_string(i));
+  }
+  size_ = 0;
+#if defined(_WIN32)
+  HANDLE file = CreateFileW(Widen(path_).c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+#else
+  int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  fd_ = fd;
+#endif
+  if (!Map(initial_capacity_)) {
+    Unmap();
+    return false;
+  }
+  return true;
+}
+
+bool LogFile::Map(size_t capacity) {
+#if defined(_WIN32)
+  void* view = NULL;
+  if (SetFileSize((HANDLE)file_, capacity)) {
+    HANDLE mapping = CreateFileMappingW((HANDLE)file_, NULL, PAGE_READWRITE, 0, 0, NULL);
+    if (mapping != NULL) {
+      view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+      CloseHandle(mapping);
+    }
+  }
+  if (view == NULL) {
+    return false;
+  }
+#else
+  void* view = MAP_FAILED;
+  if (SetFileSize(fd_, capacity)) {
+    view = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  }
+  if (view == MAP_FAILED) {
+    return false;
+  }
+#endif
+  data_ = (char*)view;
+  capacity_ = capacity;
+  return true;
+}
+
+void LogFile::UnmapView() {
+  if (data_ == nullptr) {
+    return;
+  }
+#if defined(_WIN32)
+  UnmapViewOfFile(data_);
+#else
+  munmap(data_, capacity_);
+#endif
+  data_ = nullptr;
+}
+
+void LogFile::Unmap() {
+  UnmapView();
+#if defined(_WIN32)
+  if (file_ == nullptr) {
+    return;
+  }
+  // Отображение держит размер файла: обрезать можно только после него
+  SetFileSize((HANDLE)file_, size_);
+  CloseHandle((HANDLE)file_);
+  file_ = nullptr;
+#else
+  if (fd_ < 0) {
+    return;
+  }
+  SetFileSize(fd_, size_);
+  close(fd_);
+  fd_ = -1;
+#endif
+  size_ = 0;
+}
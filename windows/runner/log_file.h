@@ -0,0 +1,71 @@
+#ifndef RUNNER_LOG_FILE_H_
+#define RUNNER_LOG_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Файл журнала, отображенный в память, с ротацией.
+//
+// Файл создается сразу размером capacity и отображается на запись, так что
+// дописывание строки - memcpy без системных вызовов. Записанное уже в
+// страничном кэше ОС и переживает аварийное завершение процесса. Когда
+// строка не помещается, файл и отображение удваиваются до max_capacity;
+// дальше Append() отказывает, и Rotate() обрезает файл до занятой длины и
+// сдвигает имена: log -> log.1 -> ... -> log.<kKeepRotated>. Open() так же
+// отодвигает файл прошлого запуска (после сбоя - без нулевого хвоста).
+//
+// Класс не потокобезопасен.
+class LogFile {
+ public:
+  static constexpr size_t kDefaultCapacity = 8 << 20;
+  static constexpr size_t kMaxCapacity = 512 << 20;
+  static constexpr int kKeepRotated = 2;
+
+  LogFile();
+  ~LogFile();
+
+  LogFile(const LogFile&) = delete;
+  LogFile& operator=(const LogFile&) = delete;
+
+  bool Open(const std::string& path, size_t capacity = kDefaultCapacity,
+            size_t max_capacity = kMaxCapacity);
+  // Обрезать файл до занятой длины и закрыть
+  void Close();
+
+  // Закрыть текущий файл и начать новый
+  bool Rotate();
+
+  // Дописать данные; false, если не помещаются и в наибольший файл
+  bool Append(const char* data, size_t length);
+
+  bool is_open() const { return data_ != nullptr; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  // Сдвинуть прежние файлы и создать новый
+  bool Create();
+  // Установить размер файла и отобразить его целиком
+  bool Map(size_t capacity);
+  void UnmapView();
+  bool Grow(size_t needed);
+  // Снять отображение, обрезать и закрыть файл
+  void Unmap();
+
+  std::string path_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  size_t initial_capacity_ = 0;
+  size_t max_capacity_ = 0;
+#if defined(_WIN32)
+  void* file_ = nullptr;  // HANDLE
+#else
+  int fd_ = -1;
+#endif
+};
+
+#endif  // RUNNER_LOG_FILE_H_
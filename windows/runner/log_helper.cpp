@@ -0,0 +1,89 @@
+#include "log_helper.h"
+
+#include <vector>
+
+#include "native_log.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Начать журнал
+EXPORT int32_t NativeLogOpen(const char* directory) {
+    if (directory == NULL) {
+        return 0;
+    }
+    if (!NativeLog::Instance().Open(directory)) {
+        LOG_ERROR("Не удалось открыть журнал в %s", directory);
+        return 0;
+    }
+    return 1;
+}
+
+EXPORT void NativeLogClose() {
+    NativeLog::Instance().Close();
+}
+
+EXPORT void NativeLogWrite(int32_t level, const char* message, int32_t length) {
+    if (message == NULL || length < 0 || level < 0 || level > 3) {
+        return;
+    }
+    NativeLog::Instance().WriteText((LogLevel)level, message, (size_t)length);
+}
+
+EXPORT int64_t NativeLogLineCount() {
+    return (int64_t)NativeLog::Instance().line_count();
+}
+
+EXPORT int64_t NativeLogFirstLine() {
+    return (int64_t)NativeLog::Instance().first_line();
+}
+
+// Прочитать страницу строк
+EXPORT int32_t NativeLogRead(int64_t first, int32_t count, char* buffer, int32_t capacity,
+                             int32_t* offsets, int64_t* actualFirst) {
+    if (first < 0 || count <= 0 || buffer == NULL || capacity <= 0 || offsets == NULL ||
+        actualFirst == NULL) {
+        return 0;
+    }
+    uint64_t actual = 0;
+    size_t lines = NativeLog::Instance().ReadLines((uint64_t)first, (size_t)count, buffer,
+                                                   (size_t)capacity, (uint32_t*)offsets, &actual);
+    *actualFirst = (int64_t)actual;
+    return (int32_t)lines;
+}
+
+// Поиск по индексу журнала
+EXPORT int32_t NativeLogSearch(int32_t levels, int32_t timeBounds, int64_t fromMs, int64_t toMs,
+                               const char* text, int64_t startLine, int64_t* lines,
+                               int32_t capacity, int64_t* nextLine) {
+    if (startLine < 0 || lines == NULL || capacity <= 0 || nextLine == NULL) {
+        return 0;
+    }
+    LogIndex::Query query;
+    query.levels = (uint32_t)levels & 0xF;
+    if (timeBounds & LOG_SEARCH_FROM) {
+        query.from_ms = fromMs;
+    }
+    if (timeBounds & LOG_SEARCH_TO) {
+        query.to_ms = toMs;
+    }
+    if (text != NULL) {
+        query.text = text;
+    }
+    std::vector<uint64_t> found;
+    found.reserve((size_t)capacity);
+    *nextLine = (int64_t)NativeLog::Instance().Search(query, (uint64_t)startLine,
+                                                      (size_t)capacity, &found);
+    for (size_t i = 0; i < found.size(); i++) {
+        lines[i] = (int64_t)found[i];
+    }
+    return (int32_t)found.size();
+}
+
+EXPORT int32_t NativeLogClear() {
+    return NativeLog::Instance().Clear() ? 1 : 0;
+}
+
+EXPORT int64_t NativeLogDropped() {
+    return (int64_t)NativeLog::Instance().dropped();
+}
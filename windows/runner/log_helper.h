@@ -0,0 +1,61 @@
+#ifndef LOG_HELPER_H
+#define LOG_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Журнал приложения (native_log.h): записи модулей библиотеки и Dart в
+// одном файле app.log. Уровни: 0 - DEBUG, 1 - INFO, 2 - WARNING, 3 - ERROR.
+
+// Начать журнал в каталоге directory (UTF-8)
+__declspec(dllexport) int32_t NativeLogOpen(const char* directory);
+
+__declspec(dllexport) void NativeLogClose();
+
+// Записать сообщение (UTF-8, length байт)
+__declspec(dllexport) void NativeLogWrite(int32_t level, const char* message, int32_t length);
+
+// Номер следующей строки сессии и первой доступной для чтения
+__declspec(dllexport) int64_t NativeLogLineCount();
+__declspec(dllexport) int64_t NativeLogFirstLine();
+
+// Скопировать до count строк с номера first в buffer (capacity байт):
+// строка i - байты [offsets[i], offsets[i + 1]) с '\n' в конце, offsets
+// вмещает count + 1 чисел. Возвращает число строк; в actualFirst - номер
+// первой из них. Буфер должен вмещать строку наибольшей длины (4096 байт).
+__declspec(dllexport) int32_t NativeLogRead(int64_t first, int32_t count, char* buffer,
+                                            int32_t capacity, int32_t* offsets,
+                                            int64_t* actualFirst);
+
+// Границы времени в NativeLogSearch: флаги timeBounds
+enum LogSearchTimeBound {
+    LOG_SEARCH_FROM = 1,  // учитывать fromMs
+    LOG_SEARCH_TO = 2,    // учитывать toMs
+};
+
+// Найти строки с номера startLine: уровень - маска levels (бит 1 << уровень),
+// время записи не раньше fromMs и не позже toMs (мс от эпохи; каждая граница
+// учитывается, только если ее флаг есть в timeBounds), в сообщении -
+// подстрока text (UTF-8 без учета регистра; NULL или пустая - любая).
+// Номера строк - в lines (до capacity штук). Возвращает число найденных; в
+// nextLine - номер, с которого продолжать (NativeLogLineCount(), если
+// журнал просмотрен до конца).
+__declspec(dllexport) int32_t NativeLogSearch(int32_t levels, int32_t timeBounds,
+                                              int64_t fromMs, int64_t toMs, const char* text,
+                                              int64_t startLine, int64_t* lines,
+                                              int32_t capacity, int64_t* nextLine);
+
+// Начать новый файл журнала
+__declspec(dllexport) int32_t NativeLogClear();
+
+// Сколько записей отброшено из-за переполнения
+__declspec(dllexport) int64_t NativeLogDropped();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_HELPER_H
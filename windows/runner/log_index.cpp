@@ -0,0 +1,381 @@
+#include "log_index.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string_view>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+static_assert(LogIndex::kSkipFanout == 16, "skip levels shift by 4 bits");
+static_assert(LogIndex::kTextBlockLines % LogIndex::kBlockLines == 0, "text block layout");
+
+constexpr size_t kBlocksPerTextBlock = LogIndex::kTextBlockLines / LogIndex::kBlockLines;
+constexpr size_t kSeenSize = 4096;
+
+int LowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+uint32_t HashKey(uint32_t key) { return key * 2654435761u; }
+
+// Ячейка таблицы из |size| (степень двойки) по старшим битам хеша: младшие
+// биты мультипликативного хеша зависят только от младших битов ключа
+size_t Slot(uint32_t key, size_t size) { return (size_t)(((uint64_t)HashKey(key) * size) >> 32); }
+
+int32_t ClampTime(int64_t value) {
+  return (int32_t)std::max<int64_t>(INT32_MIN, std::min<int64_t>(INT32_MAX, value));
+}
+
+// Разность с насыщением: границы запроса бывают INT64_MIN/INT64_MAX
+int64_t SaturatingSubtract(int64_t value, int64_t base) {
+  if (base > 0 && value < INT64_MIN + base) {
+    return INT64_MIN;
+  }
+  if (base < 0 && value > INT64_MAX + base) {
+    return INT64_MAX;
+  }
+  return value - base;
+}
+
+void AppendVarint(uint32_t value, std::vector<uint8_t>* out) {
+  while (value >= 0x80) {
+    out->push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back((uint8_t)value);
+}
+
+}  // namespace
+
+LogIndex::LogIndex() { Clear(); }
+
+void LogIndex::Clear() {
+  offsets_.clear();
+  times_.clear();
+  base_ms_ = 0;
+  for (auto& bits : level_bits_) {
+    bits.clear();
+  }
+  for (auto& ranges : ranges_) {
+    ranges.clear();
+  }
+  postings_.clear();
+  table_.assign(4096, 0);
+  seen_.assign(kSeenSize, 0);
+}
+
+void LogIndex::FoldCase(char* text, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = (uint8_t)text[i];
+    if (c < 0x80) {
+      // Без ветвления по букве: ASCII - большая часть текста журнала
+      text[i] = (char)(c | (uint8_t)((uint8_t)(c - 'A') < 26) << 5);
+    } else if (c == 0xD0 && i + 1 < length) {
+      uint8_t next = (uint8_t)text[i + 1];
+      if (next >= 0x90 && next <= 0x9F) {
+        // А-П -> а-п
+        text[i + 1] = (char)(next + 0x20);
+      } else if (next >= 0xA0 && next <= 0xAF) {
+        // Р-Я -> р-я
+        text[i] = (char)0xD1;
+        text[i + 1] = (char)(next - 0x20);
+      } else if (next == 0x81) {
+        // Ё -> ё
+        text[i] = (char)0xD1;
+        text[i + 1] = (char)0x91;
+      }
+      i++;
+    }
+  }
+}
+
+void LogIndex::Add(uint32_t offset, int level, int64_t timestamp_ms, const char* message,
+                   size_t length) {
+  size_t line = offsets_.size();
+  if (line == 0) {
+    base_ms_ = timestamp_ms;
+  }
+  int32_t time = ClampTime(timestamp_ms - base_ms_);
+  offsets_.push_back(offset);
+  times_.push_back(time);
+
+  size_t block = line / kBlockLines;
+  if (line % kBlockLines == 0) {
+    for (auto& bits : level_bits_) {
+      bits.push_back(0);
+    }
+  }
+  level_bits_[level & (kLevelCount - 1)][block] |= 1ull << (line % kBlockLines);
+
+  for (int k = 0; k < kSkipLevels; k++) {
+    size_t group = block >> (4 * k);
+    std::vector<TimeRange>& ranges = ranges_[k];
+    if (group == ranges.size()) {
+      ranges.push_back(TimeRange{time, time});
+    } else {
+      ranges[group].min = std::min(ranges[group].min, time);
+      ranges[group].max = std::max(ranges[group].max, time);
+    }
+  }
+
+  if (line % kTextBlockLines == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+  }
+  IndexText(line / kTextBlockLines, message, length);
+}
+
+LogIndex::Posting* LogIndex::FindPosting(uint32_t key) {
+  return const_cast<Posting*>(static_cast<const LogIndex*>(this)->FindPosting(key));
+}
+
+const LogIndex::Posting* LogIndex::FindPosting(uint32_t key) const {
+  size_t mask = table_.size() - 1;
+  for (size_t i = Slot(key, table_.size());; i = (i + 1) & mask) {
+    uint32_t slot = table_[i];
+    if (slot == 0) {
+      return nullptr;
+    }
+    if (postings_[slot - 1].key == key) {
+      return &postings_[slot - 1];
+    }
+  }
+}
+
+LogIndex::Posting* LogIndex::AddPosting(uint32_t key) {
+  if ((postings_.size() + 1) * 2 > table_.size()) {
+    std::vector<uint32_t> table(table_.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (size_t p = 0; p < postings_.size(); p++) {
+      size_t i = Slot(postings_[p].key, table.size());
+      while (table[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      table[i] = (uint32_t)p + 1;
+    }
+    table_.swap(table);
+  }
+  size_t mask = table_.size() - 1;
+  size_t i = Slot(key, table_.size());
+  while (table_[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  postings_.emplace_back();
+  postings_.back().key = key;
+  table_[i] = (uint32_t)postings_.size();
+  return &postings_.back();
+}
+
+void LogIndex::IndexText(size_t text_block, const char* message, size_t length) {
+  if (length < 3) {
+    return;
+  }
+  scratch_.assign(message, length);
+  FoldCase(&scratch_[0], length);
+  const uint8_t* bytes = (const uint8_t*)scratch_.data();
+  for (size_t i = 0; i + 3 <= length; i++) {
+    uint32_t key = ((uint32_t)bytes[i] << 16 | (uint32_t)bytes[i + 1] << 8 | bytes[i + 2]) + 1;
+    uint32_t& seen = seen_[Slot(key, kSeenSize)];
+    if (seen == key) {
+      continue;
+    }
+    seen = key;
+    Posting* posting = FindPosting(key);
+    if (posting == nullptr) {
+      posting = AddPosting(key);
+    } else if (posting->last_block == text_block) {
+      continue;
+    }
+    AppendVarint((uint32_t)text_block - (posting->blocks > 0 ? posting->last_block : 0),
+                 &posting->deltas);
+    posting->last_block = (uint32_t)text_block;
+    posting->blocks++;
+  }
+}
+
+void LogIndex::CandidateBlocks(const std::string& needle, std::vector<uint32_t>* blocks) const {
+  blocks->clear();
+  const uint8_t* bytes = (const uint8_t*)needle.data();
+  std::vector<const Posting*> postings;
+  for (size_t i = 0; i + 3 <= needle.size(); i++) {
+    uint32_t key = ((uint32_t)bytes[i] << 16 | (uint32_t)bytes[i + 1] << 8 | bytes[i + 2]) + 1;
+    const Posting* posting = FindPosting(key);
+    if (posting == nullptr) {
+      return;
+    }
+    postings.push_back(posting);
+  }
+  std::sort(postings.begin(), postings.end(),
+            [](const Posting* a, const Posting* b) { return a->blocks < b->blocks; });
+  postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+
+  // Самый короткий список, затем пересечение с остальными
+  std::vector<uint32_t> other;
+  for (size_t p = 0; p < postings.size(); p++) {
+    std::vector<uint32_t>* target = p == 0 ? blocks : &other;
+    target->clear();
+    uint32_t block = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (uint8_t byte : postings[p]->deltas) {
+      delta |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+      if ((byte & 0x80) == 0) {
+        block += delta;
+        target->push_back(block);
+        delta = 0;
+        shift = 0;
+      }
+    }
+    if (p > 0) {
+      std::vector<uint32_t>::iterator end = std::set_intersection(
+          blocks->begin(), blocks->end(), other.begin(), other.end(), blocks->begin());
+      blocks->erase(end, blocks->end());
+      if (blocks->empty()) {
+        return;
+      }
+    }
+  }
+}
+
+bool LogIndex::Overlaps(int level, size_t group, int32_t from, int32_t to) const {
+  const TimeRange& range = ranges_[level][group];
+  return range.max >= from && range.min <= to;
+}
+
+size_t LogIndex::NextTimeBlock(size_t block, int32_t from, int32_t to) const {
+  size_t count = ranges_[0].size();
+  while (block < count) {
+    if (Overlaps(0, block, from, to)) {
+      return block;
+    }
+    // Пропустить самую крупную группу вокруг блока, не задевающую диапазон
+    size_t next = block + 1;
+    for (int k = 1; k < kSkipLevels; k++) {
+      size_t group = block >> (4 * k);
+      if (Overlaps(k, group, from, to)) {
+        break;
+      }
+      next = (group + 1) << (4 * k);
+    }
+    block = next;
+  }
+  return count;
+}
+
+bool LogIndex::LineMatches(size_t line, const std::string& needle, const char* data,
+                           size_t data_size) {
+  size_t start = offsets_[line];
+  size_t end = line + 1 < offsets_.size() ? offsets_[line + 1] : data_size;
+  // Сообщение - после "[УРОВЕНЬ] "
+  const char* level = (const char*)memchr(data + start, ']', end - start);
+  if (level == nullptr) {
+    return false;
+  }
+  size_t message = (size_t)(level - data) + 2;
+  if (message >= end) {
+    return false;
+  }
+  scratch_.assign(data + message, end - message);
+  FoldCase(&scratch_[0], scratch_.size());
+  return std::string_view(scratch_).find(needle) != std::string_view::npos;
+}
+
+size_t LogIndex::Search(const Query& query, const char* data, size_t data_size, size_t first,
+                        size_t max_results, std::vector<uint32_t>* results) {
+  size_t count = offsets_.size();
+  uint32_t levels = query.levels & ((1u << kLevelCount) - 1);
+  int32_t from = ClampTime(SaturatingSubtract(query.from_ms, base_ms_));
+  int32_t to = ClampTime(SaturatingSubtract(query.to_ms, base_ms_));
+  if (first >= count || levels == 0 || from > to || max_results == 0) {
+    return count;
+  }
+  std::string needle = query.text;
+  if (!needle.empty()) {
+    FoldCase(&needle[0], needle.size());
+  }
+  std::vector<uint32_t> candidates;
+  bool use_text = needle.size() >= 3;
+  if (use_text) {
+    CandidateBlocks(needle, &candidates);
+  }
+
+  size_t candidate = 0;
+  size_t block = first / kBlockLines;
+  size_t verified = 0;
+  for (;;) {
+    if (use_text) {
+      while (candidate < candidates.size() &&
+             (candidates[candidate] + 1) * kBlocksPerTextBlock <= block) {
+        candidate++;
+      }
+      if (candidate == candidates.size()) {
+        return count;
+      }
+      block = std::max(block, candidates[candidate] * kBlocksPerTextBlock);
+    }
+    block = NextTimeBlock(block, from, to);
+    if (block >= ranges_[0].size()) {
+      return count;
+    }
+    if (use_text && block / kBlocksPerTextBlock != candidates[candidate]) {
+      continue;
+    }
+    uint64_t mask = 0;
+    for (int level = 0; level < kLevelCount; level++) {
+      if (levels & (1u << level)) {
+        mask |= level_bits_[level][block];
+      }
+    }
+    if (block == first / kBlockLines) {
+      mask &= ~0ull << (first % kBlockLines);
+    }
+    while (mask != 0) {
+      size_t line = block * kBlockLines + LowestBit(mask);
+      mask &= mask - 1;
+      if (times_[line] < from || times_[line] > to) {
+        continue;
+      }
+      if (!needle.empty()) {
+        if (verified == kSearchBudget) {
+          return line;
+        }
+        verified++;
+        if (!LineMatches(line, needle, data, data_size)) {
+          continue;
+        }
+      }
+      results->push_back((uint32_t)line);
+      if (results->size() >= max_results) {
+        return line + 1;
+      }
+    }
+    block++;
+  }
+}
+
+size_t LogIndex::MemoryUsage() const {
+  size_t bytes = offsets_.capacity() * sizeof(uint32_t) + times_.capacity() * sizeof(int32_t) +
+                 table_.capacity() * sizeof(uint32_t) + seen_.capacity() * sizeof(uint32_t) +
+                 postings_.capacity() * sizeof(Posting);
+  for (const auto& bits : level_bits_) {
+    bytes += bits.capacity() * sizeof(uint64_t);
+  }
+  for (const auto& ranges : ranges_) {
+    bytes += ranges.capacity() * sizeof(TimeRange);
+  }
+  for (const Posting& posting : postings_) {
+    bytes += posting.deltas.capacity();
+  }
+  return bytes;
+}
@@ -0,0 +1,107 @@
+#ifndef RUNNER_LOG_INDEX_H_
+#define RUNNER_LOG_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Индекс строк файла журнала для поиска (native_log.h). Строится по мере
+// дописывания строк, перестраивать его не нужно.
+//
+// - Уровни: на каждый блок из kBlockLines строк - битовая маска строк
+//   каждого уровня, так что фильтр по уровню - OR нескольких слов.
+// - Время: у блока есть диапазон времени его строк, а над блоками -
+//   уровни групп по kSkipFanout с объединенными диапазонами (список с
+//   пропусками): блоки вне диапазона запроса пропускаются целыми группами.
+//   Время строк почти монотонно (записи разных потоков перемешаны), поэтому
+//   хранятся диапазоны, а не одна метка на блок.
+// - Текст: для каждой триграммы байтов сообщения (после приведения к
+//   нижнему регистру) - список текстовых блоков из kTextBlockLines строк,
+//   где она встречается; номера блоков хранятся разностями в varint.
+//   Подстрока от трех байт ищется только в блоках, где есть все ее
+//   триграммы, и проверяется по тексту строки.
+//
+// Нижний регистр - для латиницы и кириллицы (длина в UTF-8 не меняется).
+// Класс не потокобезопасен.
+class LogIndex {
+ public:
+  static constexpr size_t kBlockLines = 64;
+  static constexpr size_t kTextBlockLines = 256;
+  static constexpr size_t kSkipFanout = 16;
+  static constexpr int kSkipLevels = 5;
+  static constexpr int kLevelCount = 4;
+  // Строк, проверяемых по тексту за один вызов Search()
+  static constexpr size_t kSearchBudget = 1 << 16;
+
+  struct Query {
+    uint32_t levels = 0xF;  // бит на уровень LogLevel
+    int64_t from_ms = INT64_MIN;
+    int64_t to_ms = INT64_MAX;  // включительно
+    std::string text;
+  };
+
+  LogIndex();
+
+  void Clear();
+
+  // Добавить строку: смещение в файле, уровень, время и текст сообщения
+  void Add(uint32_t offset, int level, int64_t timestamp_ms, const char* message, size_t length);
+
+  size_t size() const { return offsets_.size(); }
+  uint32_t offset(size_t line) const { return offsets_[line]; }
+
+  // Строки с номера |first|, подходящие под запрос, в |results| (не больше
+  // |max_results|). |data| - файл, |data_size| - его занятая длина.
+  // Возвращает номер строки, с которой продолжать поиск (size(), если
+  // строк больше нет).
+  size_t Search(const Query& query, const char* data, size_t data_size, size_t first,
+                size_t max_results, std::vector<uint32_t>* results);
+
+  // Память индекса в байтах
+  size_t MemoryUsage() const;
+
+  // Привести UTF-8 к нижнему регистру на месте (латиница и кириллица)
+  static void FoldCase(char* text, size_t length);
+
+ private:
+  struct TimeRange {
+    int32_t min;
+    int32_t max;
+  };
+
+  struct Posting {
+    uint32_t key = 0;  // триграмма + 1
+    uint32_t last_block = 0;
+    uint32_t blocks = 0;
+    std::vector<uint8_t> deltas;
+  };
+
+  // Блок, с которого начинается пересекающийся с [from, to] диапазон
+  size_t NextTimeBlock(size_t block, int32_t from, int32_t to) const;
+  bool Overlaps(int level, size_t group, int32_t from, int32_t to) const;
+
+  Posting* FindPosting(uint32_t trigram);
+  const Posting* FindPosting(uint32_t trigram) const;
+  Posting* AddPosting(uint32_t trigram);
+  void IndexText(size_t text_block, const char* message, size_t length);
+  // Текстовые блоки, где есть все триграммы |needle|
+  void CandidateBlocks(const std::string& needle, std::vector<uint32_t>* blocks) const;
+
+  bool LineMatches(size_t line, const std::string& needle, const char* data, size_t data_size);
+
+  std::vector<uint32_t> offsets_;
+  std::vector<int32_t> times_;  // мс от base_ms_
+  int64_t base_ms_ = 0;
+  std::vector<uint64_t> level_bits_[kLevelCount];
+  std::vector<TimeRange> ranges_[kSkipLevels];
+
+  std::vector<Posting> postings_;
+  std::vector<uint32_t> table_;  // номер в postings_ + 1, открытая адресация
+  // Триграммы, уже записанные в текущий текстовый блок (кэш, не точный)
+  std::vector<uint32_t> seen_;
+  std::string scratch_;
+};
+
+#endif  // RUNNER_LOG_INDEX_H_
@@ -0,0 +1,46 @@
+#include "log_ring.h"
+
+LogRing::LogRing(size_t capacity) : mask_(capacity - 1), cells_(new Cell[capacity]) {
+  for (size_t i = 0; i < capacity; i++) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+LogRecord* LogRing::Claim(uint64_t* position) {
+  uint64_t current = enqueue_position_.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = cells_[current & mask_];
+    uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+    int64_t difference = (int64_t)(sequence - current);
+    if (difference == 0) {
+      if (enqueue_position_.compare_exchange_weak(current, current + 1,
+                                                  std::memory_order_relaxed)) {
+        *position = current;
+        return &cell.record;
+      }
+    } else if (difference < 0) {
+      // Ячейку круг назад еще не прочитали
+      return nullptr;
+    } else {
+      current = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void LogRing::Publish(uint64_t position) {
+  cells_[position & mask_].sequence.store(position + 1, std::memory_order_release);
+}
+
+const LogRecord* LogRing::Peek() {
+  Cell& cell = cells_[dequeue_position_ & mask_];
+  if (cell.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1) {
+    return nullptr;
+  }
+  return &cell.record;
+}
+
+void LogRing::Pop() {
+  cells_[dequeue_position_ & mask_].sequence.store(dequeue_position_ + mask_ + 1,
+                                                   std::memory_order_release);
+  dequeue_position_++;
+}
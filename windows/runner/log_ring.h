@@ -0,0 +1,63 @@
+#ifndef RUNNER_LOG_RING_H_
+#define RUNNER_LOG_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+// Запись журнала в кольце: номер формата и аргументы в двоичном виде.
+// Строка из них собирается только в потоке журнала (native_log.h).
+struct LogRecord {
+  static constexpr size_t kArgsCapacity = 1008;
+  // Аргументы не поместились и обрезаны
+  static constexpr uint8_t kTruncated = 1;
+
+  int64_t timestamp_us;  // system_clock, микросекунды от эпохи Unix
+  uint16_t format;
+  uint16_t size;  // занято байт в args
+  uint8_t flags;
+  uint8_t reserved[3];
+  uint8_t args[kArgsCapacity];
+};
+static_assert(sizeof(LogRecord) == 1024, "LogRecord layout");
+
+// Кольцо записей для многих писателей и одного читателя без блокировок
+// (ограниченная очередь Вьюкова). У каждой ячейки свой номер
+// последовательности: писатель занимает ячейку одной CAS позиции записи,
+// заполняет ее на месте и публикует номером; читатель видит ячейку готовой,
+// когда номер равен его позиции + 1. Полное кольцо не ждет читателя:
+// Claim() возвращает nullptr, и запись отбрасывается.
+class LogRing {
+ public:
+  // |capacity| - степень двойки
+  explicit LogRing(size_t capacity);
+
+  LogRing(const LogRing&) = delete;
+  LogRing& operator=(const LogRing&) = delete;
+
+  // Писатель: занять ячейку или nullptr, если кольцо полно. Занятую ячейку
+  // нужно опубликовать, иначе читатель остановится на ней.
+  LogRecord* Claim(uint64_t* position);
+  void Publish(uint64_t position);
+
+  // Читатель: следующая готовая запись или nullptr; после обработки - Pop()
+  const LogRecord* Peek();
+  void Pop();
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<uint64_t> sequence;
+    LogRecord record;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<uint64_t> enqueue_position_{0};
+  alignas(64) uint64_t dequeue_position_ = 0;  // только читатель
+};
+
+#endif  // RUNNER_LOG_RING_H_
@@ -0,0 +1,550 @@
+#include "native_log.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+
+namespace {
+
+const char* const kLevelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+
+// Ширина и точность больше этих обрезаются
+constexpr int kMaxWidth = 256;
+
+// Начало строки с локальным временем; секунда пересчитывается только при
+// смене, localtime заметно дороже остального форматирования
+struct TimeCache {
+  int64_t second = INT64_MIN;
+  char text[24];
+};
+
+void AppendTimestamp(int64_t timestamp_us, TimeCache* cache, std::string* out) {
+  int64_t second = timestamp_us / 1000000;
+  int64_t micros = timestamp_us % 1000000;
+  if (micros < 0) {
+    second--;
+    micros += 1000000;
+  }
+  if (second != cache->second) {
+    time_t seconds = (time_t)second;
+    struct tm local;
+#if defined(_WIN32)
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    strftime(cache->text, sizeof(cache->text), "%Y-%m-%d %H:%M:%S", &local);
+    cache->second = second;
+  }
+  int millis = (int)(micros / 1000);
+  char fraction[4] = {'.', (char)('0' + millis / 100), (char)('0' + millis / 10 % 10),
+                      (char)('0' + millis % 10)};
+  out->append(cache->text);
+  out->append(fraction, sizeof(fraction));
+}
+
+// Аргумент записи
+struct LogArg {
+  char tag = 0;  // 'i', 'u', 'd', 's', 'p'
+  int64_t signed_value = 0;
+  uint64_t unsigned_value = 0;
+  double double_value = 0;
+  const char* text = nullptr;
+  size_t length = 0;
+};
+
+class ArgReader {
+ public:
+  explicit ArgReader(const LogRecord& record) : data_(record.args), end_(record.args + record.size) {}
+
+  bool Next(LogArg* arg) {
+    if (end_ - data_ < 1) {
+      return false;
+    }
+    arg->tag = (char)*data_++;
+    if (arg->tag == 's') {
+      uint16_t length;
+      if (end_ - data_ < 2) {
+        return false;
+      }
+      memcpy(&length, data_, 2);
+      data_ += 2;
+      if ((size_t)(end_ - data_) < length) {
+        return false;
+      }
+      arg->text = (const char*)data_;
+      arg->length = length;
+      data_ += length;
+      return true;
+    }
+    if (end_ - data_ < 8) {
+      return false;
+    }
+    if (arg->tag == 'i') {
+      memcpy(&arg->signed_value, data_, 8);
+    } else if (arg->tag == 'd') {
+      memcpy(&arg->double_value, data_, 8);
+    } else {
+      memcpy(&arg->unsigned_value, data_, 8);
+    }
+    data_ += 8;
+    return true;
+  }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+};
+
+int ArgAsInt(const LogArg& arg) {
+  int64_t value = arg.tag == 'i' ? arg.signed_value : (int64_t)arg.unsigned_value;
+  return (int)std::max<int64_t>(-kMaxWidth, std::min<int64_t>(kMaxWidth, value));
+}
+
+// Спецификация преобразования printf без модификатора длины
+struct Conversion {
+  char flags[8];
+  int width = -1;
+  int precision = -1;
+  char type = 0;
+};
+
+// Разобрать спецификацию после '%'; '*' берет число из аргументов
+const char* ParseConversion(const char* p, ArgReader* args, Conversion* conversion) {
+  size_t flags = 0;
+  while (*p != '\0' && strchr("-+ #0", *p) != nullptr) {
+    if (flags + 1 < sizeof(conversion->flags)) {
+      conversion->flags[flags++] = *p;
+    }
+    p++;
+  }
+  conversion->flags[flags] = '\0';
+  LogArg arg;
+  if (*p == '*') {
+    p++;
+    if (args->Next(&arg)) {
+      conversion->width = ArgAsInt(arg);
+    }
+  } else if (*p >= '0' && *p <= '9') {
+    conversion->width = 0;
+    while (*p >= '0' && *p <= '9') {
+      conversion->width = std::min(kMaxWidth, conversion->width * 10 + (*p++ - '0'));
+    }
+  }
+  if (*p == '.') {
+    p++;
+    conversion->precision = 0;
+    if (*p == '*') {
+      p++;
+      if (args->Next(&arg)) {
+        conversion->precision = std::max(-1, ArgAsInt(arg));
+      }
+    } else {
+      while (*p >= '0' && *p <= '9') {
+        conversion->precision = std::min(kMaxWidth, conversion->precision * 10 + (*p++ - '0'));
+      }
+    }
+  }
+  while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+    p++;
+  }
+  conversion->type = *p;
+  return *p != '\0' ? p + 1 : p;
+}
+
+void AppendPadded(const char* text, size_t length, const Conversion& conversion,
+                  std::string* out) {
+  size_t width = conversion.width > 0 ? (size_t)conversion.width : 0;
+  bool left = strchr(conversion.flags, '-') != nullptr;
+  if (!left && width > length) {
+    out->append(width - length, ' ');
+  }
+  out->append(text, length);
+  if (left && width > length) {
+    out->append(width - length, ' ');
+  }
+}
+
+// Напечатать аргумент по спецификации; тип берется из записи, поэтому
+// несовпадение формата и аргумента не приводит к неопределенному поведению
+void AppendArg(const Conversion& conversion, const LogArg& arg, std::string* out) {
+  if (arg.tag == 's') {
+    size_t length = arg.length;
+    if (conversion.precision >= 0 && (size_t)conversion.precision < length) {
+      length = (size_t)conversion.precision;
+    }
+    AppendPadded(arg.text, length, conversion, out);
+    return;
+  }
+  char type = conversion.type;
+  // Частый случай - целое без флагов, ширины и точности - без snprintf
+  if (arg.tag != 'd' && arg.tag != 'p' && conversion.flags[0] == '\0' && conversion.width < 0 &&
+      conversion.precision < 0 && strchr("diuxo", type) != nullptr) {
+    char digits[24];
+    std::to_chars_result result;
+    if (arg.tag == 'i' && (type == 'd' || type == 'i')) {
+      result = std::to_chars(digits, digits + sizeof(digits), arg.signed_value);
+    } else {
+      uint64_t value = arg.tag == 'i' ? (uint64_t)arg.signed_value : arg.unsigned_value;
+      result = std::to_chars(digits, digits + sizeof(digits), value,
+                             type == 'x' ? 16 : type == 'o' ? 8 : 10);
+    }
+    out->append(digits, result.ptr - digits);
+    return;
+  }
+  const char* length_modifier = "ll";
+  if (arg.tag == 'd') {
+    length_modifier = "";
+    if (strchr("fFeEgGaA", type) == nullptr) {
+      type = 'g';
+    }
+  } else if (arg.tag == 'p' && type != 'x' && type != 'X') {
+    type = 'p';
+    length_modifier = "";
+  } else if (type == 'c') {
+    length_modifier = "";
+  } else if (strchr("diuxXo", type) == nullptr) {
+    type = arg.tag == 'i' ? 'd' : 'u';
+  } else if (arg.tag != 'i' && (type == 'd' || type == 'i')) {
+    type = 'u';
+  }
+
+  char spec[48];
+  int spec_length = snprintf(spec, sizeof(spec), "%%%s", conversion.flags);
+  if (conversion.width >= 0) {
+    spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, "%d", conversion.width);
+  }
+  if (conversion.precision >= 0) {
+    spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, ".%d",
+                            conversion.precision);
+  }
+  snprintf(spec + spec_length, sizeof(spec) - spec_length, "%s%c", length_modifier, type);
+
+  char buffer[kMaxWidth * 2 + 64];
+  int written;
+  if (arg.tag == 'd') {
+    written = snprintf(buffer, sizeof(buffer), spec, arg.double_value);
+  } else if (type == 'p') {
+    written = snprintf(buffer, sizeof(buffer), spec, (void*)(uintptr_t)arg.unsigned_value);
+  } else if (type == 'c') {
+    written = snprintf(buffer, sizeof(buffer), spec,
+                       (int)(arg.tag == 'i' ? arg.signed_value : (int64_t)arg.unsigned_value));
+  } else if (arg.tag == 'i') {
+    written = snprintf(buffer, sizeof(buffer), spec, (long long)arg.signed_value);
+  } else {
+    written = snprintf(buffer, sizeof(buffer), spec, (unsigned long long)arg.unsigned_value);
+  }
+  if (written > 0) {
+    out->append(buffer, std::min<size_t>((size_t)written, sizeof(buffer) - 1));
+  }
+}
+
+void AppendMessage(const char* format, const LogRecord& record, std::string* out) {
+  ArgReader args(record);
+  const char* p = format;
+  while (*p != '\0') {
+    const char* percent = strchr(p, '%');
+    if (percent == nullptr) {
+      out->append(p);
+      break;
+    }
+    out->append(p, percent - p);
+    p = percent + 1;
+    if (*p == '%') {
+      out->push_back('%');
+      p++;
+      continue;
+    }
+    Conversion conversion;
+    p = ParseConversion(p, &args, &conversion);
+    LogArg arg;
+    // Недостающий аргумент (обрезанная запись) не печатается
+    if (conversion.type != '\0' && args.Next(&arg)) {
+      AppendArg(conversion, arg, out);
+    }
+  }
+}
+
+// Строка журнала: "2024-01-31 12:00:00.123 [INFO] сообщение\n". Переводы
+// строк внутри сообщения заменяются пробелами: журнал читается построчно.
+// Возвращает начало сообщения в строке.
+size_t FormatLine(LogLevel level, const char* format, const LogRecord& record, TimeCache* cache,
+                  std::string* out) {
+  out->clear();
+  AppendTimestamp(record.timestamp_us, cache, out);
+  out->append(" [");
+  out->append(kLevelNames[(size_t)level & 3]);
+  out->append("] ");
+  size_t message = out->size();
+  AppendMessage(format, record, out);
+  for (size_t i = message; i < out->size(); i++) {
+    if ((*out)[i] == '\n' || (*out)[i] == '\r') {
+      (*out)[i] = ' ';
+    }
+  }
+  bool truncated = (record.flags & LogRecord::kTruncated) != 0;
+  const size_t limit = NativeLog::kMaxLineLength - 4;
+  if (out->size() > limit) {
+    size_t length = limit;
+    // Не разрезать символ UTF-8
+    while (length > message && ((uint8_t)(*out)[length] & 0xC0) == 0x80) {
+      length--;
+    }
+    out->resize(length);
+    truncated = true;
+  }
+  if (truncated) {
+    out->append("\xE2\x80\xA6");
+  }
+  out->push_back('\n');
+  return message;
+}
+
+}  // namespace
+
+void NativeLog::ArgWriter::AddString(const char* text, size_t length) {
+  size_t available = LogRecord::kArgsCapacity - record_->size;
+  if (available < 3) {
+    record_->flags |= LogRecord::kTruncated;
+    return;
+  }
+  available -= 3;
+  if (length > available) {
+    length = available;
+    while (length > 0 && ((uint8_t)text[length] & 0xC0) == 0x80) {
+      length--;
+    }
+    record_->flags |= LogRecord::kTruncated;
+  }
+  uint16_t length16 = (uint16_t)length;
+  uint8_t* data = record_->args + record_->size;
+  data[0] = 's';
+  memcpy(data + 1, &length16, 2);
+  memcpy(data + 3, text, length);
+  record_->size += (uint16_t)(3 + length);
+}
+
+NativeLog& NativeLog::Instance() {
+  // Не разрушается: выгрузка библиотеки не должна ждать потока журнала
+  static NativeLog* log = new NativeLog();
+  return *log;
+}
+
+NativeLog::NativeLog() : ring_(kRingCapacity) {
+  // Номера 0-3 - готовый текст каждого уровня (WriteText)
+  for (uint8_t level = 0; level < 4; level++) {
+    formats_[level].level = (LogLevel)level;
+    formats_[level].text = "%s";
+  }
+  format_count_.store(4, std::memory_order_release);
+  line_.reserve(kMaxLineLength);
+}
+
+uint16_t NativeLog::RegisterFormat(LogLevel level, const char* format) {
+  NativeLog& log = Instance();
+  std::lock_guard<std::mutex> lock(log.format_mutex_);
+  uint32_t count = log.format_count_.load(std::memory_order_relaxed);
+  if (count >= kMaxFormats) {
+    // Таблица полна: печатается только первый аргумент
+    return (uint16_t)level;
+  }
+  log.formats_[count].level = level;
+  log.formats_[count].text = format;
+  log.format_count_.store(count + 1, std::memory_order_release);
+  return (uint16_t)count;
+}
+
+LogRecord* NativeLog::Begin(uint16_t format, LogRecord* local, uint64_t* position) {
+  LogRecord* record = local;
+  *position = kDirect;
+  if (open_.load(std::memory_order_acquire)) {
+    record = ring_.Claim(position);
+    if (record == nullptr) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  record->timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+  record->format = format;
+  record->size = 0;
+  record->flags = 0;
+  return record;
+}
+
+void NativeLog::End(const LogRecord& record, uint64_t position) {
+  if (position == kDirect) {
+    // Журнал не открыт: сразу в stdout
+    TimeCache cache;
+    std::string line;
+    const Format& format = formats_[record.format];
+    FormatLine(format.level, format.text, record, &cache, &line);
+    std::lock_guard<std::mutex> lock(direct_mutex_);
+    fwrite(line.data(), 1, line.size(), stdout);
+    return;
+  }
+  ring_.Publish(position);
+  if ((position & (kWakeEvery - 1)) == kWakeEvery - 1) {
+    // Под блокировкой: иначе сигнал теряется, если поток журнала как раз
+    // проверил кольцо и еще не уснул
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_one();
+  }
+}
+
+void NativeLog::WriteText(LogLevel level, const char* text, size_t length) {
+  LogRecord local;
+  uint64_t position;
+  LogRecord* record = Begin((uint16_t)((uint8_t)level & 3), &local, &position);
+  if (record == nullptr) {
+    return;
+  }
+  ArgWriter writer(record);
+  writer.AddString(text, length);
+  End(*record, position);
+}
+
+bool NativeLog::Open(const std::string& directory) {
+  std::lock_guard<std::mutex> control(control_mutex_);
+  if (open_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.Open(directory + "/app.log")) {
+      return false;
+    }
+    index_.Clear();
+    first_line_ = 0;
+  }
+  stopping_ = false;
+  thread_ = std::thread(&NativeLog::Loop, this);
+  open_.store(true, std::memory_order_release);
+  return true;
+}
+
+void NativeLog::Close() {
+  std::lock_guard<std::mutex> control(control_mutex_);
+  if (!open_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_.Close();
+  index_.Clear();
+}
+
+bool NativeLog::Clear() {
+  std::lock_guard<std::mutex> control(control_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file_.is_open()) {
+    return false;
+  }
+  first_line_ += index_.size();
+  index_.Clear();
+  return file_.Rotate();
+}
+
+uint64_t NativeLog::line_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return first_line_ + index_.size();
+}
+
+uint64_t NativeLog::first_line() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return first_line_;
+}
+
+size_t NativeLog::ReadLines(uint64_t first, size_t count, char* buffer, size_t capacity,
+                            uint32_t* offsets, uint64_t* actual_first) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  first = std::max(first, first_line_);
+  *actual_first = first;
+  offsets[0] = 0;
+  size_t copied = 0;
+  size_t used = 0;
+  for (size_t index = (size_t)(first - first_line_); copied < count && index < index_.size();
+       index++) {
+    size_t start = index_.offset(index);
+    size_t end = index + 1 < index_.size() ? index_.offset(index + 1) : file_.size();
+    if (end - start > capacity - used) {
+      break;
+    }
+    memcpy(buffer + used, file_.data() + start, end - start);
+    used += end - start;
+    offsets[++copied] = (uint32_t)used;
+  }
+  return copied;
+}
+
+void NativeLog::Loop() {
+  for (;;) {
+    bool stopping;
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_.wait_for(lock, std::chrono::milliseconds(kFlushIntervalMs),
+                     [this] { return stopping_ || ring_.Peek() != nullptr; });
+      stopping = stopping_;
+    }
+    Drain();
+    if (stopping) {
+      break;
+    }
+  }
+}
+
+void NativeLog::Drain() {
+  TimeCache cache;
+  const LogRecord* record = ring_.Peek();
+  while (record != nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t n = 0; n < kBatch && record != nullptr; n++) {
+      const Format& format = formats_[record->format];
+      size_t message = FormatLine(format.level, format.text, *record, &cache, &line_);
+      int64_t timestamp_us = record->timestamp_us;
+      ring_.Pop();
+      AppendLine(format.level, timestamp_us, message);
+      record = ring_.Peek();
+    }
+  }
+}
+
+void NativeLog::AppendLine(LogLevel level, int64_t timestamp_us, size_t message) {
+  size_t start = file_.size();
+  if (!file_.Append(line_.data(), line_.size())) {
+    if (!file_.Rotate()) {
+      return;
+    }
+    first_line_ += index_.size();
+    index_.Clear();
+    start = 0;
+    if (!file_.Append(line_.data(), line_.size())) {
+      return;
+    }
+  }
+  // Без '\n' в конце
+  index_.Add((uint32_t)start, (int)level, timestamp_us / 1000, line_.data() + message,
+             line_.size() - message - 1);
+}
+
+uint64_t NativeLog::Search(const LogIndex::Query& query, uint64_t first, size_t max_lines,
+                           std::vector<uint64_t>* lines) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  first = std::max(first, first_line_);
+  search_results_.clear();
+  size_t next = index_.Search(query, file_.data(), file_.size(), (size_t)(first - first_line_),
+                              max_lines, &search_results_);
+  for (uint32_t line : search_results_) {
+    lines->push_back(first_line_ + line);
+  }
+  return first_line_ + next;
+}
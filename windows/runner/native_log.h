@@ -0,0 +1,203 @@
+#ifndef RUNNER_NATIVE_LOG_H_
+#define RUNNER_NATIVE_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "log_file.h"
+#include "log_index.h"
+#include "log_ring.h"
+
+enum class LogLevel : uint8_t { kDebug = 0, kInfo = 1, kWarning = 2, kError = 3 };
+
+// Журнал приложения: и модулей библиотеки, и Dart (LoggerService).
+//
+// Вызов LOG_INFO(...) не форматирует строку: формат регистрируется один раз
+// на место вызова, а в кольцо (log_ring.h) пишутся только его номер, время
+// и аргументы в двоичном виде. Строку собирает фоновый поток и дописывает
+// ее в файл, отображенный в память (log_file.h), и в индекс (log_index.h):
+// по началам строк страница журнала читается без просмотра файла, а поиск
+// по уровню, времени и подстроке не читает строки, которые не подходят.
+// Писатель не ждет ни потока, ни диска: при полном кольце запись
+// отбрасывается и учитывается в dropped().
+//
+// Форматы - подмножество printf: флаги, ширина и точность сохраняются, а
+// модификаторы длины не нужны - тип аргумента записан вместе с ним. Строки
+// копируются в запись (обрезаются, если не помещаются).
+//
+// До Open() записи сразу печатаются в stdout, как раньше printf.
+class NativeLog {
+ public:
+  static constexpr size_t kRingCapacity = 4096;
+  static constexpr size_t kMaxFormats = 1024;
+  // Поток журнала просыпается по таймеру и каждые kWakeEvery записей
+  static constexpr int kFlushIntervalMs = 20;
+  static constexpr uint64_t kWakeEvery = kRingCapacity / 4;
+  // Строк за один захват блокировки читателей
+  static constexpr size_t kBatch = 256;
+  // Строка длиннее обрезается; буфер ReadLines() должен ее вмещать
+  static constexpr size_t kMaxLineLength = 4096;
+
+  static NativeLog& Instance();
+
+  // Номер формата; |format| должен жить до конца процесса (литерал)
+  static uint16_t RegisterFormat(LogLevel level, const char* format);
+
+  template <typename... Args>
+  void Write(uint16_t format, const Args&... args);
+
+  // Готовый текст (Dart)
+  void WriteText(LogLevel level, const char* text, size_t length);
+
+  // Писать в <directory>/app.log; файл прошлого запуска становится app.log.1
+  bool Open(const std::string& directory);
+  void Close();
+  // Начать новый файл; прежние строки больше не читаются
+  bool Clear();
+
+  // Строки сессии нумеруются с нуля; читать можно с first_line() (строки
+  // ротированных файлов недоступны) до line_count()
+  uint64_t line_count();
+  uint64_t first_line();
+
+  // Скопировать до |count| строк с номера |first| в |buffer|: строка i
+  // занимает [offsets[i], offsets[i + 1]) вместе с '\n', так что |offsets|
+  // вмещает count + 1 чисел. Возвращает число строк; |actual_first| - номер
+  // первой (больше |first|, если те строки ушли при ротации).
+  size_t ReadLines(uint64_t first, size_t count, char* buffer, size_t capacity, uint32_t* offsets,
+                   uint64_t* actual_first);
+
+  // Номера строк с |first|, подходящих под запрос, - не больше |max_lines|.
+  // Возвращает номер, с которого продолжать поиск (line_count(), если
+  // журнал просмотрен до конца). Один вызов проверяет по тексту не больше
+  // LogIndex::kSearchBudget строк, чтобы не задерживать поток журнала.
+  uint64_t Search(const LogIndex::Query& query, uint64_t first, size_t max_lines,
+                  std::vector<uint64_t>* lines);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // Разбор аргументов записи для потока журнала
+  class ArgWriter {
+   public:
+    explicit ArgWriter(LogRecord* record) : record_(record) {}
+
+    template <typename T>
+    void Add(const T& value) {
+      if constexpr (std::is_convertible<const T&, const char*>::value) {
+        const char* text = value;
+        AddString(text != nullptr ? text : "(null)", text != nullptr ? strlen(text) : 6);
+      } else if constexpr (std::is_same<T, std::string>::value) {
+        AddString(value.data(), value.size());
+      } else if constexpr (std::is_floating_point<T>::value) {
+        Put('d', (double)value);
+      } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+        Put('i', (int64_t)value);
+      } else if constexpr (std::is_integral<T>::value) {
+        Put('u', (uint64_t)value);
+      } else if constexpr (std::is_enum<T>::value) {
+        Put('i', (int64_t)value);
+      } else {
+        static_assert(std::is_pointer<T>::value, "unsupported log argument");
+        Put('p', (uint64_t)(uintptr_t)value);
+      }
+    }
+
+    void AddString(const char* text, size_t length);
+
+   private:
+    template <typename T>
+    void Put(char tag, T value) {
+      if (record_->size + 1 + sizeof(T) > LogRecord::kArgsCapacity) {
+        record_->flags |= LogRecord::kTruncated;
+        return;
+      }
+      record_->args[record_->size] = (uint8_t)tag;
+      memcpy(record_->args + record_->size + 1, &value, sizeof(T));
+      record_->size += (uint16_t)(1 + sizeof(T));
+    }
+
+    LogRecord* record_;
+  };
+
+ private:
+  struct Format {
+    LogLevel level;
+    const char* text;
+  };
+
+  // Позиция записи, которая не попала в кольцо и печатается сразу
+  static constexpr uint64_t kDirect = UINT64_MAX;
+
+  NativeLog();
+
+  // Начать запись: ячейка кольца или |local|, если журнал не открыт;
+  // nullptr - кольцо полно, запись отброшена
+  LogRecord* Begin(uint16_t format, LogRecord* local, uint64_t* position);
+  void End(const LogRecord& record, uint64_t position);
+
+  void Loop();
+  void Drain();
+  // Дописать line_ в файл и индекс (поток журнала под mutex_); сообщение
+  // начинается в line_ с |message|
+  void AppendLine(LogLevel level, int64_t timestamp_us, size_t message);
+
+  Format formats_[kMaxFormats];
+  std::atomic<uint32_t> format_count_{0};
+  std::mutex format_mutex_;
+
+  LogRing ring_;
+  std::atomic<bool> open_{false};
+  std::atomic<uint64_t> dropped_{0};
+
+  std::mutex control_mutex_;  // Open/Close/Clear
+  std::thread thread_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  // Файл и индекс его строк; пишет поток журнала, читают ReadLines() и
+  // Search()
+  std::mutex mutex_;
+  LogFile file_;
+  LogIndex index_;
+  uint64_t first_line_ = 0;
+  std::vector<uint32_t> search_results_;
+
+  std::string line_;  // поток журнала
+  std::mutex direct_mutex_;
+};
+
+template <typename... Args>
+void NativeLog::Write(uint16_t format, const Args&... args) {
+  LogRecord local;
+  uint64_t position;
+  LogRecord* record = Begin(format, &local, &position);
+  if (record == nullptr) {
+    return;
+  }
+  ArgWriter writer(record);
+  (writer.Add(args), ...);
+  End(*record, position);
+}
+
+#define NATIVE_LOG(level, format, ...)                                                    \
+  do {                                                                                    \
+    static const uint16_t native_log_format = NativeLog::RegisterFormat(level, format);  \
+    NativeLog::Instance().Write(native_log_format, ##__VA_ARGS__);                       \
+  } while (0)
+
+#define LOG_DEBUG(format, ...) NATIVE_LOG(LogLevel::kDebug, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) NATIVE_LOG(LogLevel::kInfo, format, ##__VA_ARGS__)
+#define LOG_WARNING(format, ...) NATIVE_LOG(LogLevel::kWarning, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) NATIVE_LOG(LogLevel::kError, format, ##__VA_ARGS__)
+
+#endif  // RUNNER_NATIVE_LOG_H_
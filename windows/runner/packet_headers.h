@@ -0,0 +1,532 @@
+#ifndef RUNNER_PACKET_HEADERS_H_
+#define RUNNER_PACKET_HEADERS_H_
+
+// Разбор и перезапись заголовков IPv4/IPv6/TCP/UDP прямо в буфере пакета.
+// Библиотека целиком в заголовке: никаких копий и выделений памяти.
+// Адреса IPv4 и порты возвращаются в порядке байт хоста.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PACKET_HEADERS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Атрибут для функций с AVX2 при сборке без /arch:AVX2 (-mavx2)
+#if defined(PACKET_HEADERS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PACKET_HEADERS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PACKET_HEADERS_TARGET_AVX2
+#endif
+
+constexpr uint8_t kIpProtocolTcp = 6;
+constexpr uint8_t kIpProtocolUdp = 17;
+constexpr uint8_t kIpProtocolAh = 51;
+
+// ---------------------------------------------------------------------------
+// Порядок байт
+
+inline uint16_t LoadBe16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+inline uint32_t LoadBe32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void StoreBe16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)(value >> 8);
+  p[1] = (uint8_t)value;
+}
+
+inline void StoreBe32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value >> 24);
+  p[1] = (uint8_t)(value >> 16);
+  p[2] = (uint8_t)(value >> 8);
+  p[3] = (uint8_t)value;
+}
+
+// ---------------------------------------------------------------------------
+// Контрольная сумма Интернета (RFC 1071)
+//
+// Все суммы ниже - значения в сетевом порядке, сложенные как числа.
+// Сумма в дополнительном коде не зависит от порядка байт, поэтому блоки
+// данных суммируются машинными словами, а результат переворачивается в конце.
+
+// Свернуть 64-битную сумму до 16 бит
+inline uint16_t ChecksumFold(uint64_t sum) {
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return (uint16_t)sum;
+}
+
+inline uint16_t ByteSwap16(uint16_t value) {
+  return (uint16_t)((value << 8) | (value >> 8));
+}
+
+// Сумма блока машинными словами (порядок байт хоста, little-endian).
+// Возвращает свернутую 16-битную сумму в порядке байт хоста.
+inline uint16_t ChecksumBlockScalar(const uint8_t* data, size_t length) {
+  uint64_t sum = 0;
+  while (length >= 32) {
+    uint32_t words[8];
+    memcpy(words, data, sizeof(words));
+    sum += (uint64_t)words[0] + words[1] + words[2] + words[3] +
+           words[4] + words[5] + words[6] + words[7];
+    data += 32;
+    length -= 32;
+  }
+  while (length >= 4) {
+    uint32_t word;
+    memcpy(&word, data, 4);
+    sum += word;
+    data += 4;
+    length -= 4;
+  }
+  if (length >= 2) {
+    uint16_t word;
+    memcpy(&word, data, 2);
+    sum += word;
+    data += 2;
+    length -= 2;
+  }
+  if (length == 1) {
+    // Нечетный последний байт дополняется нулем справа (в сетевом порядке)
+    uint8_t tail[2] = {data[0], 0};
+    uint16_t word;
+    memcpy(&word, tail, 2);
+    sum += word;
+  }
+  return ChecksumFold(sum);
+}
+
+#if defined(PACKET_HEADERS_X86)
+
+// SSE2: 16-битные слова расширяются до 32-битных полос и накапливаются.
+// Полосы сбрасываются в 64-битную сумму раньше, чем могут переполниться.
+inline uint16_t ChecksumBlockSse2(const uint8_t* data, size_t length) {
+  uint64_t sum = 0;
+  const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+  while (length >= 64) {
+    size_t chunk = length & ~(size_t)63;
+    if (chunk > 65536) {
+      chunk = 65536;
+    }
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    for (size_t i = 0; i < chunk; i += 64) {
+      __m128i v0 = _mm_loadu_si128((const __m128i*)(data + i));
+      __m128i v1 = _mm_loadu_si128((const __m128i*)(data + i + 16));
+      __m128i v2 = _mm_loadu_si128((const __m128i*)(data + i + 32));
+      __m128i v3 = _mm_loadu_si128((const __m128i*)(data + i + 48));
+      acc0 = _mm_add_epi32(acc0, _mm_and_si128(v0, low_mask));
+      acc1 = _mm_add_epi32(acc1, _mm_srli_epi32(v0, 16));
+      acc0 = _mm_add_epi32(acc0, _mm_and_si128(v1, low_mask));
+      acc1 = _mm_add_epi32(acc1, _mm_srli_epi32(v1, 16));
+      acc0 = _mm_add_epi32(acc0, _mm_and_si128(v2, low_mask));
+      acc1 = _mm_add_epi32(acc1, _mm_srli_epi32(v2, 16));
+      acc0 = _mm_add_epi32(acc0, _mm_and_si128(v3, low_mask));
+      acc1 = _mm_add_epi32(acc1, _mm_srli_epi32(v3, 16));
+    }
+    alignas(16) uint32_t lanes[8];
+    _mm_store_si128((__m128i*)lanes, acc0);
+    _mm_store_si128((__m128i*)(lanes + 4), acc1);
+    for (uint32_t lane : lanes) {
+      sum += lane;
+    }
+    data += chunk;
+    length -= chunk;
+  }
+  sum += ChecksumBlockScalar(data, length);
+  return ChecksumFold(sum);
+}
+
+// AVX2: та же схема на 256-битных регистрах
+PACKET_HEADERS_TARGET_AVX2
+inline uint16_t ChecksumBlockAvx2(const uint8_t* data, size_t length) {
+  uint64_t sum = 0;
+  const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+  while (length >= 128) {
+    size_t chunk = length & ~(size_t)127;
+    if (chunk > 131072) {
+      chunk = 131072;
+    }
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    for (size_t i = 0; i < chunk; i += 128) {
+      __m256i v0 = _mm256_loadu_si256((const __m256i*)(data + i));
+      __m256i v1 = _mm256_loadu_si256((const __m256i*)(data + i + 32));
+      __m256i v2 = _mm256_loadu_si256((const __m256i*)(data + i + 64));
+      __m256i v3 = _mm256_loadu_si256((const __m256i*)(data + i + 96));
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v0, low_mask));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v0, 16));
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v1, low_mask));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v1, 16));
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v2, low_mask));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v2, 16));
+      acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v3, low_mask));
+      acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v3, 16));
+    }
+    alignas(32) uint32_t lanes[16];
+    _mm256_store_si256((__m256i*)lanes, acc0);
+    _mm256_store_si256((__m256i*)(lanes + 8), acc1);
+    for (uint32_t lane : lanes) {
+      sum += lane;
+    }
+    data += chunk;
+    length -= chunk;
+  }
+  sum += ChecksumBlockSse2(data, length);
+  return ChecksumFold(sum);
+}
+
+// Проверка поддержки AVX2 процессором и ОС (выполняется один раз)
+inline bool CpuHasAvx2() {
+  static const bool has_avx2 = [] {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+      return false;
+    }
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) != 0 &&
+                        (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+  }();
+  return has_avx2;
+}
+
+#endif  // PACKET_HEADERS_X86
+
+// Реализация, выбранная под текущий процессор
+inline uint16_t ChecksumBlock(const uint8_t* data, size_t length) {
+#if defined(PACKET_HEADERS_X86)
+  if (length >= 128 && CpuHasAvx2()) {
+    return ChecksumBlockAvx2(data, length);
+  }
+  return ChecksumBlockSse2(data, length);
+#else
+  return ChecksumBlockScalar(data, length);
+#endif
+}
+
+// Добавить блок данных к сумме (сумма в сетевом порядке)
+inline uint32_t ChecksumAdd(uint32_t sum, const uint8_t* data, size_t length) {
+  return sum + ByteSwap16(ChecksumBlock(data, length));
+}
+
+// Завершить сумму: свернуть и инвертировать
+inline uint16_t ChecksumFinish(uint32_t sum) {
+  return (uint16_t)~ChecksumFold(sum);
+}
+
+// Полная контрольная сумма блока
+inline uint16_t InternetChecksum(const uint8_t* data, size_t length) {
+  return ChecksumFinish(ChecksumAdd(0, data, length));
+}
+
+// Инкрементальное обновление (RFC 1624, уравнение 3): HC' = ~(~HC + ~m + m')
+inline uint16_t ChecksumAdjust16(uint16_t checksum, uint16_t old_word,
+                                 uint16_t new_word) {
+  uint32_t sum = (uint16_t)~checksum;
+  sum += (uint16_t)~old_word;
+  sum += new_word;
+  return (uint16_t)~ChecksumFold(sum);
+}
+
+inline uint16_t ChecksumAdjust32(uint16_t checksum, uint32_t old_value,
+                                 uint32_t new_value) {
+  uint32_t sum = (uint16_t)~checksum;
+  sum += (uint16_t)~(old_value >> 16);
+  sum += (uint16_t)~(old_value & 0xFFFF);
+  sum += new_value >> 16;
+  sum += new_value & 0xFFFF;
+  return (uint16_t)~ChecksumFold(sum);
+}
+
+// Обновление по замене произвольного числа 16-битных слов (адреса IPv6)
+inline uint16_t ChecksumAdjustBytes(uint16_t checksum, const uint8_t* old_bytes,
+                                    const uint8_t* new_bytes, size_t length) {
+  uint32_t sum = (uint16_t)~checksum;
+  for (size_t i = 0; i + 1 < length; i += 2) {
+    sum += (uint16_t)~LoadBe16(old_bytes + i);
+    sum += LoadBe16(new_bytes + i);
+  }
+  return (uint16_t)~ChecksumFold(sum);
+}
+
+// ---------------------------------------------------------------------------
+// Разбор пакета
+
+// Смещения и параметры разобранного пакета. Хранит только указатель на
+// исходный буфер, поэтому стоит несколько десятков байт на стеке.
+struct PacketHeaders {
+  uint8_t* data = nullptr;
+  uint32_t length = 0;
+
+  uint8_t ip_version = 0;
+  uint8_t protocol = 0;       // протокол транспортного уровня
+  uint16_t l3_length = 0;     // длина IP-заголовка вместе с расширениями
+  uint32_t l4_offset = 0;
+  uint32_t l4_length = 0;     // транспортный заголовок + данные
+  uint32_t payload_offset = 0;
+  bool has_l4 = false;        // false для фрагментов, кроме первого
+
+  bool IsIpv4() const { return ip_version == 4; }
+  bool IsIpv6() const { return ip_version == 6; }
+  bool IsTcp() const { return has_l4 && protocol == kIpProtocolTcp; }
+  bool IsUdp() const { return has_l4 && protocol == kIpProtocolUdp; }
+
+  uint8_t* l4() const { return data + l4_offset; }
+  uint8_t* payload() const { return data + payload_offset; }
+  uint32_t payload_length() const { return length - payload_offset; }
+
+  // IPv4 (порядок байт хоста)
+  uint32_t ipv4_source() const { return LoadBe32(data + 12); }
+  uint32_t ipv4_destination() const { return LoadBe32(data + 16); }
+
+  // IPv6 (16 байт в сетевом порядке)
+  const uint8_t* ipv6_source() const { return data + 8; }
+  const uint8_t* ipv6_destination() const { return data + 24; }
+
+  uint16_t source_port() const { return has_l4 ? LoadBe16(l4()) : 0; }
+  uint16_t destination_port() const { return has_l4 ? LoadBe16(l4() + 2) : 0; }
+
+  // Смещение поля контрольной суммы транспортного уровня или 0
+  uint32_t l4_checksum_offset() const {
+    if (IsTcp()) return l4_offset + 16;
+    if (IsUdp()) return l4_offset + 6;
+    return 0;
+  }
+
+  // Флаги TCP (SYN/FIN/RST и т.д.), 0 для остальных протоколов
+  uint8_t tcp_flags() const { return IsTcp() ? data[l4_offset + 13] : 0; }
+
+  // Порядковый номер сегмента TCP, 0 для остальных протоколов
+  uint32_t tcp_sequence() const { return IsTcp() ? LoadBe32(data + l4_offset + 4) : 0; }
+};
+
+constexpr uint8_t kTcpFlagFin = 0x01;
+constexpr uint8_t kTcpFlagSyn = 0x02;
+constexpr uint8_t kTcpFlagRst = 0x04;
+constexpr uint8_t kTcpFlagAck = 0x10;
+
+// Пропустить заголовок AH (RFC 4302): длина в 4-байтовых словах минус 2,
+// в отличие от остальных расширений IPv6
+inline bool SkipAuthenticationHeader(const uint8_t* data, uint32_t length,
+                                     uint32_t* offset, uint8_t* next) {
+  if (*offset + 8 > length) return false;
+  *next = data[*offset];
+  *offset += ((uint32_t)data[*offset + 1] + 2) * 4;
+  return true;
+}
+
+// Разобрать пакет. Возвращает false для обрезанных и некорректных пакетов.
+inline bool ParsePacketHeaders(uint8_t* data, uint32_t length,
+                               PacketHeaders* out) {
+  *out = PacketHeaders();
+  if (length < 1) {
+    return false;
+  }
+  out->data = data;
+  out->ip_version = data[0] >> 4;
+
+  uint32_t offset;
+  bool first_fragment = true;
+  if (out->ip_version == 4) {
+    if (length < 20) return false;
+    uint32_t ihl = (uint32_t)(data[0] & 0x0F) * 4;
+    uint32_t total = LoadBe16(data + 2);
+    if (ihl < 20 || total < ihl || total > length) return false;
+    length = total;
+    out->protocol = data[9];
+    first_fragment = (LoadBe16(data + 6) & 0x1FFF) == 0;
+    offset = ihl;
+    if (out->protocol == kIpProtocolAh && first_fragment) {
+      if (!SkipAuthenticationHeader(data, length, &offset, &out->protocol)) return false;
+      if (offset > length) return false;
+    }
+  } else if (out->ip_version == 6) {
+    if (length < 40) return false;
+    uint32_t total = 40 + (uint32_t)LoadBe16(data + 4);
+    if (total > length) return false;
+    length = total;
+    uint8_t next = data[6];
+    offset = 40;
+    // Пропускаем заголовки расширений
+    for (;;) {
+      if (next == 0 || next == 43 || next == 60) {
+        if (offset + 8 > length) return false;
+        next = data[offset];
+        offset += 8 + (uint32_t)data[offset + 1] * 8;
+      } else if (next == 44) {
+        if (offset + 8 > length) return false;
+        first_fragment = (LoadBe16(data + offset + 2) & 0xFFF8) == 0;
+        next = data[offset];
+        offset += 8;
+      } else if (next == kIpProtocolAh) {
+        if (!SkipAuthenticationHeader(data, length, &offset, &next)) return false;
+      } else {
+        break;
+      }
+    }
+    if (offset > length) return false;
+    out->protocol = next;
+  } else {
+    return false;
+  }
+
+  out->length = length;
+  out->l3_length = (uint16_t)offset;
+  out->l4_offset = offset;
+  out->l4_length = length - offset;
+  out->payload_offset = offset;
+
+  if (!first_fragment) {
+    return true;
+  }
+  if (out->protocol == kIpProtocolTcp) {
+    if (out->l4_length < 20) return false;
+    uint32_t data_offset = (uint32_t)(data[offset + 12] >> 4) * 4;
+    if (data_offset < 20 || data_offset > out->l4_length) return false;
+    out->payload_offset = offset + data_offset;
+    out->has_l4 = true;
+  } else if (out->protocol == kIpProtocolUdp) {
+    if (out->l4_length < 8) return false;
+    out->payload_offset = offset + 8;
+    out->has_l4 = true;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Перезапись с инкрементальным обновлением контрольных сумм
+
+// Обновить контрольную сумму транспортного уровня на замену слов. Нулевая
+// сумма UDP по IPv4 означает "не вычислялась" и остается нулевой.
+inline void AdjustL4Checksum32(const PacketHeaders& headers, uint32_t old_value,
+                               uint32_t new_value) {
+  uint32_t offset = headers.l4_checksum_offset();
+  if (offset == 0) return;
+  uint16_t checksum = LoadBe16(headers.data + offset);
+  if (headers.IsUdp() && checksum == 0 && headers.IsIpv4()) return;
+  checksum = ChecksumAdjust32(checksum, old_value, new_value);
+  if (headers.IsUdp() && checksum == 0) checksum = 0xFFFF;
+  StoreBe16(headers.data + offset, checksum);
+}
+
+inline void SetIpv4Address(const PacketHeaders& headers, uint32_t field_offset,
+                           uint32_t address) {
+  uint32_t old_address = LoadBe32(headers.data + field_offset);
+  if (old_address == address) return;
+  StoreBe32(headers.data + field_offset, address);
+  StoreBe16(headers.data + 10,
+            ChecksumAdjust32(LoadBe16(headers.data + 10), old_address, address));
+  AdjustL4Checksum32(headers, old_address, address);
+}
+
+inline void SetIpv4Source(const PacketHeaders& headers, uint32_t address) {
+  SetIpv4Address(headers, 12, address);
+}
+
+inline void SetIpv4Destination(const PacketHeaders& headers, uint32_t address) {
+  SetIpv4Address(headers, 16, address);
+}
+
+inline void SetIpv6Address(const PacketHeaders& headers, uint32_t field_offset,
+                           const uint8_t address[16]) {
+  uint8_t* field = headers.data + field_offset;
+  uint32_t offset = headers.l4_checksum_offset();
+  if (offset != 0) {
+    uint16_t checksum = LoadBe16(headers.data + offset);
+    checksum = ChecksumAdjustBytes(checksum, field, address, 16);
+    if (headers.IsUdp() && checksum == 0) checksum = 0xFFFF;
+    StoreBe16(headers.data + offset, checksum);
+  }
+  memcpy(field, address, 16);
+}
+
+inline void SetIpv6Source(const PacketHeaders& headers, const uint8_t address[16]) {
+  SetIpv6Address(headers, 8, address);
+}
+
+inline void SetIpv6Destination(const PacketHeaders& headers, const uint8_t address[16]) {
+  SetIpv6Address(headers, 24, address);
+}
+
+inline void SetPort(const PacketHeaders& headers, uint32_t field_offset, uint16_t port) {
+  if (!headers.has_l4) return;
+  uint8_t* field = headers.l4() + field_offset;
+  uint16_t old_port = LoadBe16(field);
+  if (old_port == port) return;
+  StoreBe16(field, port);
+  uint32_t offset = headers.l4_checksum_offset();
+  if (offset == 0) return;
+  uint16_t checksum = LoadBe16(headers.data + offset);
+  if (headers.IsUdp() && checksum == 0 && headers.IsIpv4()) return;
+  checksum = ChecksumAdjust16(checksum, old_port, port);
+  if (headers.IsUdp() && checksum == 0) checksum = 0xFFFF;
+  StoreBe16(headers.data + offset, checksum);
+}
+
+inline void SetSourcePort(const PacketHeaders& headers, uint16_t port) {
+  SetPort(headers, 0, port);
+}
+
+inline void SetDestinationPort(const PacketHeaders& headers, uint16_t port) {
+  SetPort(headers, 2, port);
+}
+
+// ---------------------------------------------------------------------------
+// Полный пересчет (после изменения данных пакета)
+
+// Контрольная сумма заголовка IPv4 (без AH, даже если он есть)
+inline void RecomputeIpv4HeaderChecksum(const PacketHeaders& headers) {
+  if (!headers.IsIpv4()) return;
+  StoreBe16(headers.data + 10, 0);
+  StoreBe16(headers.data + 10,
+            InternetChecksum(headers.data, (size_t)(headers.data[0] & 0x0F) * 4));
+}
+
+// Контрольная сумма TCP/UDP с псевдозаголовком (векторизованная)
+inline void RecomputeL4Checksum(const PacketHeaders& headers) {
+  uint32_t offset = headers.l4_checksum_offset();
+  if (offset == 0) return;
+  StoreBe16(headers.data + offset, 0);
+
+  uint32_t sum = 0;
+  if (headers.IsIpv4()) {
+    sum = ChecksumAdd(sum, headers.data + 12, 8);
+  } else {
+    sum = ChecksumAdd(sum, headers.data + 8, 32);
+  }
+  sum += headers.protocol;
+  sum += headers.l4_length >> 16;
+  sum += headers.l4_length & 0xFFFF;
+  sum = ChecksumAdd(sum, headers.l4(), headers.l4_length);
+
+  uint16_t checksum = ChecksumFinish(sum);
+  if (headers.IsUdp() && checksum == 0) checksum = 0xFFFF;
+  StoreBe16(headers.data + offset, checksum);
+}
+
+inline void RecomputeChecksums(const PacketHeaders& headers) {
+  RecomputeIpv4HeaderChecksum(headers);
+  RecomputeL4Checksum(headers);
+}
+
+#endif  // RUNNER_PACKET_HEADERS_H_
@@ -0,0 +1,45 @@
+#include "packet_io.h"
+
+#include <string.h>
+
+PacketBatchRing::PacketBatchRing(size_t depth)
+    : storage_(new uint8_t[depth * PacketBatch::kBufferCapacity]),
+      batches_(depth) {
+  for (size_t i = 0; i < depth; i++) {
+    batches_[i].data = storage_.get() + i * PacketBatch::kBufferCapacity;
+    batches_[i].Clear();
+  }
+}
+
+PacketBatch* PacketBatchRing::Next() {
+  PacketBatch* batch = &batches_[cursor_];
+  cursor_ = (cursor_ + 1) % batches_.size();
+  batch->Clear();
+  return batch;
+}
+
+size_t CompactForwardedPackets(PacketBatch* batch) {
+  size_t kept = 0;
+  size_t write_offset = 0;
+  for (size_t i = 0; i < batch->count; i++) {
+    if (batch->verdict[i] != PacketVerdict::kForward) {
+      continue;
+    }
+    uint32_t length = batch->length[i];
+    if (batch->offset[i] != write_offset) {
+      memmove(batch->data + write_offset, batch->data + batch->offset[i], length);
+    }
+    if (kept != i) {
+      batch->meta[kept] = batch->meta[i];
+      batch->outbound[kept] = batch->outbound[i];
+    }
+    batch->offset[kept] = static_cast<uint32_t>(write_offset);
+    batch->length[kept] = length;
+    batch->verdict[kept] = PacketVerdict::kForward;
+    write_offset += length;
+    kept++;
+  }
+  batch->count = kept;
+  batch->data_size = write_offset;
+  return kept;
+}
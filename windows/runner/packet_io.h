@@ -0,0 +1,104 @@
+#ifndef RUNNER_PACKET_IO_H_
+#define RUNNER_PACKET_IO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+// Максимальное количество пакетов в одной пачке (WinDivert допускает до 0xFF)
+constexpr size_t kPacketBatchMax = 64;
+
+// Максимальный размер одного IP-пакета, который может вернуть драйвер
+constexpr size_t kPacketMtuMax = 40 + 0xFFFF;
+
+// Решение обработчика по пакету
+enum class PacketVerdict : uint8_t {
+  kForward = 0,
+  kDrop = 1,
+};
+
+// Непрозрачные метаданные пакета, которыми владеет бэкенд
+// (для WinDivert это WINDIVERT_ADDRESS, 80 байт).
+struct PacketMeta {
+  alignas(8) uint8_t opaque[80];
+};
+
+// Пачка пакетов, лежащих подряд в одном буфере. Буфер выделяется заранее
+// и принадлежит кольцу PacketBatchRing конкретного рабочего потока.
+struct PacketBatch {
+  // Емкость буфера: полная пачка типичных кадров плюс один пакет
+  // максимального размера, чтобы драйвер всегда мог вернуть хотя бы один.
+  static constexpr size_t kBufferCapacity = kPacketBatchMax * 1536 + kPacketMtuMax;
+
+  uint8_t* data = nullptr;
+  size_t data_size = 0;
+  size_t count = 0;
+
+  uint32_t offset[kPacketBatchMax];
+  uint32_t length[kPacketBatchMax];
+  bool outbound[kPacketBatchMax];
+  PacketVerdict verdict[kPacketBatchMax];
+  PacketMeta meta[kPacketBatchMax];
+
+  uint8_t* Packet(size_t index) { return data + offset[index]; }
+
+  // Очистить пачку перед новым приемом
+  void Clear() {
+    data_size = 0;
+    count = 0;
+  }
+
+  // Добавить пакет, уже скопированный в data по смещению data_size
+  void Commit(uint32_t packet_length, bool is_outbound) {
+    offset[count] = static_cast<uint32_t>(data_size);
+    length[count] = packet_length;
+    outbound[count] = is_outbound;
+    verdict[count] = PacketVerdict::kForward;
+    data_size += packet_length;
+    count++;
+  }
+};
+
+// Кольцо заранее выделенных пачек одного рабочего потока. Пока одна пачка
+// обрабатывается, предыдущие могут еще находиться в отправке.
+class PacketBatchRing {
+ public:
+  explicit PacketBatchRing(size_t depth);
+
+  PacketBatchRing(const PacketBatchRing&) = delete;
+  PacketBatchRing& operator=(const PacketBatchRing&) = delete;
+
+  // Следующая свободная пачка (по кругу)
+  PacketBatch* Next();
+
+ private:
+  std::unique_ptr<uint8_t[]> storage_;
+  std::vector<PacketBatch> batches_;
+  size_t cursor_ = 0;
+};
+
+// Сдвинуть пакеты с вердиктом kForward (и их метаданные) в начало буфера
+// без изменения порядка. Возвращает количество оставшихся пакетов.
+size_t CompactForwardedPackets(PacketBatch* batch);
+
+// Источник и приемник пакетов. Реализации должны допускать одновременные
+// вызовы ReceiveBatch/SendBatch из нескольких рабочих потоков.
+class PacketIo {
+ public:
+  virtual ~PacketIo() = default;
+
+  // Принять одну пачку (один системный вызов). Блокируется до появления
+  // хотя бы одного пакета. Возвращает false после Shutdown() или при ошибке.
+  virtual bool ReceiveBatch(PacketBatch* batch) = 0;
+
+  // Отправить все пакеты пачки с вердиктом kForward одним вызовом.
+  // Реализация может переупорядочить содержимое буфера пачки.
+  virtual bool SendBatch(PacketBatch* batch) = 0;
+
+  // Прервать ожидающие ReceiveBatch во всех потоках.
+  virtual void Shutdown() = 0;
+};
+
+#endif  // RUNNER_PACKET_IO_H_
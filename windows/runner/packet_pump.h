@@ -0,0 +1,59 @@
+#ifndef RUNNER_PACKET_PUMP_H_
+#define RUNNER_PACKET_PUMP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "packet_io.h"
+#include "traffic_counters.h"
+
+// Конвейер обработки пакетов: рабочие потоки принимают пачки из PacketIo,
+// передают их обработчику и отправляют обратно одним вызовом на пачку.
+// Каждый поток работает только со своим кольцом буферов. Трафик учитывается
+// после обработчика: отброшенные пакеты (kDrop) в счетчики не попадают.
+class PacketPump {
+ public:
+  // Обработчик пачки. Может менять пакеты на месте и ставить вердикт kDrop.
+  using BatchHandler = std::function<void(PacketBatch* batch)>;
+
+  // Глубина кольца пачек на один рабочий поток
+  static constexpr size_t kRingDepth = 4;
+
+  // |counters| может быть nullptr, если учет трафика не нужен.
+  PacketPump(PacketIo* io, TrafficCounters* counters);
+  ~PacketPump();
+
+  PacketPump(const PacketPump&) = delete;
+  PacketPump& operator=(const PacketPump&) = delete;
+
+  // Запустить |worker_count| рабочих потоков. Возвращает false, если
+  // конвейер уже запущен.
+  bool Start(size_t worker_count, BatchHandler handler);
+
+  // Прервать прием и дождаться завершения всех потоков.
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  // Количество обработанных пачек и пакетов (для диагностики)
+  uint64_t batch_count() const { return batch_count_.load(std::memory_order_relaxed); }
+  uint64_t packet_count() const { return packet_count_.load(std::memory_order_relaxed); }
+
+ private:
+  void WorkerLoop();
+
+  PacketIo* io_;
+  TrafficCounters* counters_;
+  BatchHandler handler_;
+  std::vector<std::thread> workers_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> batch_count_{0};
+  std::atomic<uint64_t> packet_count_{0};
+};
+
+#endif  // RUNNER_PACKET_PUMP_H_
@@ -0,0 +1,195 @@
+#include "pcap_packet_io.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "native_log.h"
+
+namespace {
+
+// Типы канального уровня pcap
+constexpr uint32_t kLinkTypeNull = 0;
+constexpr uint32_t kLinkTypeEthernet = 1;
+constexpr uint32_t kLinkTypeRaw = 101;
+constexpr uint32_t kLinkTypeLinuxSll = 113;
+constexpr uint32_t kLinkTypeIpv4 = 228;
+constexpr uint32_t kLinkTypeIpv6 = 229;
+
+uint32_t Swap32(uint32_t value) {
+  return ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) |
+         ((value >> 8) & 0xFF00) | (value >> 24);
+}
+
+// Смещение IP-заголовка внутри кадра или -1, если кадр не IP
+int IpOffset(uint32_t link_type, const uint8_t* frame, uint32_t length) {
+  switch (link_type) {
+    case kLinkTypeRaw:
+    case kLinkTypeIpv4:
+    case kLinkTypeIpv6:
+      return 0;
+    case kLinkTypeNull:
+      return length > 4 ? 4 : -1;
+    case kLinkTypeLinuxSll:
+      return length > 16 ? 16 : -1;
+    case kLinkTypeEthernet: {
+      uint32_t offset = 14;
+      if (length < offset) {
+        return -1;
+      }
+      uint16_t ether_type = (uint16_t)((frame[12] << 8) | frame[13]);
+      // Пропускаем метки VLAN (802.1Q / 802.1ad)
+      while ((ether_type == 0x8100 || ether_type == 0x88A8) && length >= offset + 4) {
+        ether_type = (uint16_t)((frame[offset + 2] << 8) | frame[offset + 3]);
+        offset += 4;
+      }
+      if (ether_type != 0x0800 && ether_type != 0x86DD) {
+        return -1;
+      }
+      return (int)offset;
+    }
+    default:
+      return -1;
+  }
+}
+
+}  // namespace
+
+bool PcapPacketIo::Open(const char* path, size_t loops) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    LOG_ERROR("Не удалось открыть pcap-файл: %s", path);
+    return false;
+  }
+
+  uint8_t header[24];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+    fclose(file);
+    return false;
+  }
+
+  uint32_t magic;
+  memcpy(&magic, header, 4);
+  bool swapped;
+  if (magic == 0xA1B2C3D4 || magic == 0xA1B23C4D) {
+    swapped = false;
+  } else if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) {
+    swapped = true;
+  } else {
+    LOG_ERROR("Неизвестный формат pcap: %08x", magic);
+    fclose(file);
+    return false;
+  }
+
+  uint32_t link_type;
+  memcpy(&link_type, header + 20, 4);
+  if (swapped) {
+    link_type = Swap32(link_type);
+  }
+
+  std::vector<uint8_t> frame;
+  uint8_t record[16];
+  while (fread(record, 1, sizeof(record), file) == sizeof(record)) {
+    uint32_t captured;
+    memcpy(&captured, record + 8, 4);
+    if (swapped) {
+      captured = Swap32(captured);
+    }
+    if (captured > kPacketMtuMax + 64) {
+      break;
+    }
+    frame.resize(captured);
+    if (fread(frame.data(), 1, captured, file) != captured) {
+      break;
+    }
+    int offset = IpOffset(link_type, frame.data(), captured);
+    if (offset < 0 || (uint32_t)offset >= captured) {
+      continue;
+    }
+    AddPacket(frame.data() + offset, captured - (uint32_t)offset);
+  }
+  fclose(file);
+
+  Rewind(loops);
+  return !lengths_.empty();
+}
+
+void PcapPacketIo::AddPacket(const uint8_t* packet, uint32_t length) {
+  if (length == 0 || length > kPacketMtuMax) {
+    return;
+  }
+  offsets_.push_back((uint32_t)frames_.size());
+  lengths_.push_back(length);
+  frames_.insert(frames_.end(), packet, packet + length);
+
+  bool outbound = false;
+  if (local_ipv4_ != 0 && length >= 20 && (packet[0] >> 4) == 4) {
+    uint32_t source;
+    memcpy(&source, packet + 12, 4);
+    outbound = (source == local_ipv4_);
+  }
+  outbound_.push_back(outbound ? 1 : 0);
+}
+
+void PcapPacketIo::Rewind(size_t loops) {
+  // Разбиваем пакеты на пачки, каждая из которых гарантированно помещается
+  // в буфер PacketBatch, чтобы потоки забирали их без блокировок
+  batch_starts_.clear();
+  size_t used = 0;
+  size_t count = 0;
+  for (size_t i = 0; i < lengths_.size(); i++) {
+    if (count == 0 || count == kPacketBatchMax ||
+        used + lengths_[i] > PacketBatch::kBufferCapacity) {
+      batch_starts_.push_back((uint32_t)i);
+      used = 0;
+      count = 0;
+    }
+    used += lengths_[i];
+    count++;
+  }
+  batch_starts_.push_back((uint32_t)lengths_.size());
+
+  loops_ = loops;
+  next_batch_.store(0, std::memory_order_relaxed);
+  shutdown_.store(false, std::memory_order_relaxed);
+}
+
+bool PcapPacketIo::ReceiveBatch(PacketBatch* batch) {
+  batch->Clear();
+  if (shutdown_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  uint64_t batches_per_loop = batch_starts_.size() - 1;
+  if (batches_per_loop == 0) {
+    return false;
+  }
+  uint64_t index = next_batch_.fetch_add(1, std::memory_order_relaxed);
+  if (index >= batches_per_loop * loops_) {
+    return false;
+  }
+  index %= batches_per_loop;
+
+  for (uint32_t i = batch_starts_[index]; i < batch_starts_[index + 1]; i++) {
+    memcpy(batch->data + batch->data_size, frames_.data() + offsets_[i], lengths_[i]);
+    batch->Commit(lengths_[i], outbound_[i] != 0);
+  }
+  return true;
+}
+
+bool PcapPacketIo::SendBatch(PacketBatch* batch) {
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < batch->count; i++) {
+    if (batch->verdict[i] == PacketVerdict::kForward) {
+      packets++;
+      bytes += batch->length[i];
+    }
+  }
+  sent_packets_.fetch_add(packets, std::memory_order_relaxed);
+  sent_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void PcapPacketIo::Shutdown() {
+  shutdown_.store(true, std::memory_order_release);
+}
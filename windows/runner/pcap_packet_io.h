@@ -0,0 +1,62 @@
+#ifndef RUNNER_PCAP_PACKET_IO_H_
+#define RUNNER_PCAP_PACKET_IO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "packet_io.h"
+
+// Переносимый бэкенд PacketIo, воспроизводящий пакеты из pcap-файла.
+// Файл целиком загружается в память и заранее разбивается на пачки, так что
+// рабочие потоки разбирают их одним атомарным инкрементом. Отправленные
+// пакеты только подсчитываются. Используется для проверки и замеров
+// конвейера на Linux без драйвера WinDivert.
+class PcapPacketIo : public PacketIo {
+ public:
+  PcapPacketIo() = default;
+
+  // Адрес локальной машины (IPv4, сетевой порядок байт). Пакеты с таким
+  // адресом источника считаются исходящими. Задается до Open().
+  void SetLocalIpv4(uint32_t address) { local_ipv4_ = address; }
+
+  // Загрузить файл и воспроизвести его |loops| раз.
+  // Поддерживаются Ethernet, Linux SLL, BSD loopback и raw IP.
+  bool Open(const char* path, size_t loops);
+
+  // Загрузить готовые IP-пакеты из памяти (для синтетической нагрузки).
+  void AddPacket(const uint8_t* packet, uint32_t length);
+
+  // Пересобрать разбиение на пачки после AddPacket().
+  void Rewind(size_t loops);
+
+  size_t packet_count() const { return lengths_.size(); }
+
+  uint64_t sent_packets() const { return sent_packets_.load(std::memory_order_relaxed); }
+  uint64_t sent_bytes() const { return sent_bytes_.load(std::memory_order_relaxed); }
+
+  // PacketIo:
+  bool ReceiveBatch(PacketBatch* batch) override;
+  bool SendBatch(PacketBatch* batch) override;
+  void Shutdown() override;
+
+ private:
+  std::vector<uint8_t> frames_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> lengths_;
+  std::vector<uint8_t> outbound_;
+
+  // Индексы первых пакетов пачек (последний элемент - конец списка)
+  std::vector<uint32_t> batch_starts_;
+
+  uint32_t local_ipv4_ = 0;
+  size_t loops_ = 1;
+  std::atomic<uint64_t> next_batch_{0};
+  std::atomic<bool> shutdown_{false};
+  std::atomic<uint64_t> sent_packets_{0};
+  std::atomic<uint64_t> sent_bytes_{0};
+};
+
+#endif  // RUNNER_PCAP_PACKET_IO_H_
@@ -0,0 +1,209 @@
+#include "prefix_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+namespace {
+
+// Обнулить биты адреса за пределами префикса
+void MaskAddress(uint8_t* address, int address_bytes, uint8_t prefix_length) {
+  for (int i = 0; i < address_bytes; i++) {
+    int bits = (int)prefix_length - i * 8;
+    if (bits >= 8) {
+      continue;
+    }
+    address[i] &= (bits <= 0) ? 0 : (uint8_t)(0xFF << (8 - bits));
+  }
+}
+
+}  // namespace
+
+PrefixTable::PrefixTable()
+    : ipv4_root_(1 << 16, kNoMatch), ipv6_root_(1 << 16, kNoMatch) {}
+
+bool PrefixTable::AddIpv4(uint32_t address, uint8_t prefix_length, uint32_t value) {
+  if (prefix_length > 32 || value == kNoMatch || value > kMaxValue) {
+    return false;
+  }
+  Prefix prefix = {};
+  prefix.address[0] = (uint8_t)(address >> 24);
+  prefix.address[1] = (uint8_t)(address >> 16);
+  prefix.address[2] = (uint8_t)(address >> 8);
+  prefix.address[3] = (uint8_t)address;
+  MaskAddress(prefix.address, 4, prefix_length);
+  prefix.length = prefix_length;
+  prefix.value = value;
+  prefix.order = (uint32_t)ipv4_prefixes_.size();
+  ipv4_prefixes_.push_back(prefix);
+  return true;
+}
+
+bool PrefixTable::AddIpv6(const uint8_t address[16], uint8_t prefix_length,
+                          uint32_t value) {
+  if (prefix_length > 128 || value == kNoMatch || value > kMaxValue) {
+    return false;
+  }
+  Prefix prefix = {};
+  memcpy(prefix.address, address, 16);
+  MaskAddress(prefix.address, 16, prefix_length);
+  prefix.length = prefix_length;
+  prefix.value = value;
+  prefix.order = (uint32_t)ipv6_prefixes_.size();
+  ipv6_prefixes_.push_back(prefix);
+  return true;
+}
+
+bool PrefixTable::ParseCidr(const char* cidr, uint8_t address[16], uint8_t* prefix_length,
+                            uint8_t* family) {
+  char buffer[64];
+  size_t length = strlen(cidr);
+  if (length == 0 || length >= sizeof(buffer)) {
+    return false;
+  }
+  memcpy(buffer, cidr, length + 1);
+
+  long parsed_length = -1;
+  char* slash = strchr(buffer, '/');
+  if (slash != nullptr) {
+    *slash = '\0';
+    char* end = nullptr;
+    parsed_length = strtol(slash + 1, &end, 10);
+    if (end == slash + 1 || *end != '\0' || parsed_length < 0) {
+      return false;
+    }
+  }
+
+  memset(address, 0, 16);
+  if (strchr(buffer, ':') != nullptr) {
+    if (inet_pton(AF_INET6, buffer, address) != 1 || parsed_length > 128) {
+      return false;
+    }
+    *family = 6;
+    *prefix_length = (uint8_t)(parsed_length < 0 ? 128 : parsed_length);
+    MaskAddress(address, 16, *prefix_length);
+    return true;
+  }
+  if (inet_pton(AF_INET, buffer, address) != 1 || parsed_length > 32) {
+    return false;
+  }
+  *family = 4;
+  *prefix_length = (uint8_t)(parsed_length < 0 ? 32 : parsed_length);
+  MaskAddress(address, 4, *prefix_length);
+  return true;
+}
+
+bool PrefixTable::AddCidr(const char* cidr, uint32_t value) {
+  uint8_t address[16];
+  uint8_t prefix_length;
+  uint8_t family;
+  if (!ParseCidr(cidr, address, &prefix_length, &family)) {
+    return false;
+  }
+  if (family == 6) {
+    return AddIpv6(address, prefix_length, value);
+  }
+  uint32_t ipv4 = ((uint32_t)address[0] << 24) | ((uint32_t)address[1] << 16) |
+                  ((uint32_t)address[2] << 8) | address[3];
+  return AddIpv4(ipv4, prefix_length, value);
+}
+
+size_t PrefixTable::AddCidrList(const char* text, size_t length, uint32_t value) {
+  size_t added = 0;
+  size_t position = 0;
+  while (position < length) {
+    size_t end = position;
+    while (end < length && text[end] != '\n' && text[end] != ',') {
+      end++;
+    }
+    // Обрезаем пробелы по краям
+    size_t begin = position;
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) begin++;
+    size_t last = end;
+    while (last > begin && (text[last - 1] == ' ' || text[last - 1] == '\t' ||
+                            text[last - 1] == '\r')) last--;
+
+    if (last > begin && text[begin] != '#' && last - begin < 64) {
+      char line[64];
+      memcpy(line, text + begin, last - begin);
+      line[last - begin] = '\0';
+      if (AddCidr(line, value)) {
+        added++;
+      }
+    }
+    position = end + 1;
+  }
+  return added;
+}
+
+void PrefixTable::Compile(std::vector<Prefix>& prefixes, int address_bytes,
+                          std::vector<uint32_t>* root, std::vector<uint32_t>* chunks) {
+  // Короткие префиксы раскрашиваются первыми, длинные переписывают их участки.
+  // Поэтому при раскраске диапазона в нем еще нет дочерних узлов.
+  std::stable_sort(prefixes.begin(), prefixes.end(),
+                   [](const Prefix& a, const Prefix& b) {
+                     if (a.length != b.length) return a.length < b.length;
+                     return a.order < b.order;
+                   });
+
+  root->assign(1 << 16, kNoMatch);
+  chunks->clear();
+
+  for (const Prefix& prefix : prefixes) {
+    uint32_t root_index = ((uint32_t)prefix.address[0] << 8) | prefix.address[1];
+    if (prefix.length <= 16) {
+      uint32_t span = 1u << (16 - prefix.length);
+      std::fill(root->begin() + root_index, root->begin() + root_index + span,
+                prefix.value);
+      continue;
+    }
+
+    // Спускаемся по уровням по 8 бит, создавая узлы с унаследованным значением.
+    // Ячейка адресуется индексом: resize() может переместить chunks.
+    std::vector<uint32_t>* table = root;
+    size_t entry = root_index;
+    int consumed = 16;
+    int level = 2;
+    for (;;) {
+      if (!((*table)[entry] & kChildFlag)) {
+        uint32_t inherited = (*table)[entry];
+        uint32_t chunk = (uint32_t)(chunks->size() >> 8);
+        (*table)[entry] = kChildFlag | chunk;
+        chunks->resize(chunks->size() + 256, inherited);
+      }
+      size_t base = (size_t)((*table)[entry] & ~kChildFlag) << 8;
+      uint8_t byte = prefix.address[level];
+      int remaining = (int)prefix.length - consumed;
+      if (remaining <= 8 || level + 1 >= address_bytes) {
+        uint32_t span = 1u << (8 - remaining);
+        std::fill(chunks->begin() + base + byte, chunks->begin() + base + byte + span,
+                  prefix.value);
+        break;
+      }
+      table = chunks;
+      entry = base + byte;
+      consumed += 8;
+      level++;
+    }
+  }
+
+  chunks->shrink_to_fit();
+}
+
+void PrefixTable::Build() {
+  Compile(ipv4_prefixes_, 4, &ipv4_root_, &ipv4_chunks_);
+  Compile(ipv6_prefixes_, 16, &ipv6_root_, &ipv6_chunks_);
+}
+
+size_t PrefixTable::MemoryUsage() const {
+  return (ipv4_root_.size() + ipv4_chunks_.size() + ipv6_root_.size() +
+          ipv6_chunks_.size()) * sizeof(uint32_t);
+}
@@ -0,0 +1,100 @@
+#ifndef RUNNER_PREFIX_TABLE_H_
+#define RUNNER_PREFIX_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Таблица поиска по наибольшему совпадению префикса (LPM) для IPv4 и IPv6.
+//
+// Префиксы сначала накапливаются, затем Build() компилирует их в многоуровневое
+// дерево с фиксированными шагами 16-8-8 (IPv4) и 16-8-...-8 (IPv6) с
+// протолкнутыми в листья значениями. Поиск - не больше 3 (IPv4) или 15 (IPv6)
+// обращений к памяти без ветвлений по длине префикса и без выделений.
+class PrefixTable {
+ public:
+  // Значение "совпадений нет"
+  static constexpr uint32_t kNoMatch = 0;
+
+  // Наибольшее допустимое значение (старший бит занят флагом узла)
+  static constexpr uint32_t kMaxValue = 0x7FFFFFFFu;
+
+  PrefixTable();
+
+  PrefixTable(const PrefixTable&) = delete;
+  PrefixTable& operator=(const PrefixTable&) = delete;
+  PrefixTable(PrefixTable&&) = default;
+  PrefixTable& operator=(PrefixTable&&) = default;
+
+  // Добавить префикс. |address| в порядке байт хоста (IPv4) или 16 байт в
+  // сетевом порядке (IPv6). |value| - от 1 до kMaxValue. При совпадении
+  // длины побеждает последний добавленный префикс.
+  bool AddIpv4(uint32_t address, uint8_t prefix_length, uint32_t value);
+  bool AddIpv6(const uint8_t address[16], uint8_t prefix_length, uint32_t value);
+
+  // Разобрать "10.0.0.0/8", "fc00::/7" или одиночный адрес.
+  bool AddCidr(const char* cidr, uint32_t value);
+
+  // Разобрать CIDR без добавления: |address| - 16 байт в сетевом порядке
+  // (для IPv4 заняты первые 4), биты за пределами префикса обнулены,
+  // |family| - 4 или 6.
+  static bool ParseCidr(const char* cidr, uint8_t address[16], uint8_t* prefix_length,
+                        uint8_t* family);
+
+  // Загрузить список CIDR по одному в строке (пустые строки и '#' пропускаются).
+  // Возвращает количество добавленных префиксов.
+  size_t AddCidrList(const char* text, size_t length, uint32_t value);
+
+  // Скомпилировать таблицы. После Build() таблица доступна только на чтение
+  // и может использоваться из любого числа потоков.
+  void Build();
+
+  uint32_t LookupIpv4(uint32_t address) const {
+    uint32_t entry = ipv4_root_[address >> 16];
+    if (entry & kChildFlag) {
+      entry = ipv4_chunks_[((entry & ~kChildFlag) << 8) | ((address >> 8) & 0xFF)];
+      if (entry & kChildFlag) {
+        entry = ipv4_chunks_[((entry & ~kChildFlag) << 8) | (address & 0xFF)];
+      }
+    }
+    return entry;
+  }
+
+  uint32_t LookupIpv6(const uint8_t address[16]) const {
+    uint32_t entry = ipv6_root_[((uint32_t)address[0] << 8) | address[1]];
+    for (int i = 2; (entry & kChildFlag) && i < 16; i++) {
+      entry = ipv6_chunks_[((entry & ~kChildFlag) << 8) | address[i]];
+    }
+    return entry;
+  }
+
+  size_t ipv4_prefix_count() const { return ipv4_prefixes_.size(); }
+  size_t ipv6_prefix_count() const { return ipv6_prefixes_.size(); }
+
+  // Объем скомпилированных таблиц в байтах
+  size_t MemoryUsage() const;
+
+ private:
+  static constexpr uint32_t kChildFlag = 0x80000000u;
+
+  struct Prefix {
+    uint8_t address[16];
+    uint8_t length;
+    uint32_t value;
+    uint32_t order;
+  };
+
+  static void Compile(std::vector<Prefix>& prefixes, int address_bytes,
+                      std::vector<uint32_t>* root, std::vector<uint32_t>* chunks);
+
+  std::vector<Prefix> ipv4_prefixes_;
+  std::vector<Prefix> ipv6_prefixes_;
+
+  std::vector<uint32_t> ipv4_root_;
+  std::vector<uint32_t> ipv4_chunks_;
+  std::vector<uint32_t> ipv6_root_;
+  std::vector<uint32_t> ipv6_chunks_;
+};
+
+#endif  // RUNNER_PREFIX_TABLE_H_
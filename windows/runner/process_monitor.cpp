@@ -0,0 +1,505 @@
+#include "process_monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <set>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <windows.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#include <windivert.h>
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "WinDivert.lib")
+#else
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "native_log.h"
+
+namespace {
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#if defined(_WIN32)
+
+constexpr size_t kEventBatch = 64;
+
+std::string QueryProcessPath(uint32_t pid) {
+  if (pid == 0) {
+    return std::string();
+  }
+  if (pid == 4) {
+    return "System";
+  }
+  HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (process == NULL) {
+    return std::string();
+  }
+  wchar_t path[MAX_PATH * 2];
+  DWORD length = MAX_PATH * 2;
+  std::string result;
+  if (QueryFullProcessImageNameW(process, 0, path, &length)) {
+    // Значения правил приходят из Dart в UTF-8
+    int size = WideCharToMultiByte(CP_UTF8, 0, path, (int)length, NULL, 0, NULL, NULL);
+    if (size > 0) {
+      result.resize(size);
+      WideCharToMultiByte(CP_UTF8, 0, path, (int)length, &result[0], size, NULL, NULL);
+    }
+  }
+  CloseHandle(process);
+  return result;
+}
+
+// Таблица IP Helper целиком; повтор, если таблица выросла между вызовами
+template <typename Query>
+bool ReadTable(Query query, std::vector<uint8_t>* buffer) {
+  for (int attempt = 0; attempt < 4; attempt++) {
+    DWORD size = (DWORD)buffer->size();
+    DWORD status = query(buffer->empty() ? NULL : buffer->data(), &size);
+    if (status == NO_ERROR) {
+      return true;
+    }
+    if (status != ERROR_INSUFFICIENT_BUFFER) {
+      return false;
+    }
+    buffer->resize(size + size / 4);
+  }
+  return false;
+}
+
+#else
+
+std::string QueryProcessPath(uint32_t pid) {
+  char link[64];
+  snprintf(link, sizeof(link), "/proc/%u/exe", pid);
+  char path[4096];
+  ssize_t length = readlink(link, path, sizeof(path) - 1);
+  if (length > 0) {
+    return std::string(path, (size_t)length);
+  }
+  // exe чужого процесса без прав не читается, имя из comm - читается
+  snprintf(link, sizeof(link), "/proc/%u/comm", pid);
+  FILE* file = fopen(link, "r");
+  if (file == nullptr) {
+    return std::string();
+  }
+  std::string result;
+  if (fgets(path, sizeof(path), file) != nullptr) {
+    result = path;
+    while (!result.empty() && (result.back() == '\n' || result.back() == '\r')) {
+      result.pop_back();
+    }
+  }
+  fclose(file);
+  return result;
+}
+
+struct SocketDump {
+  uint64_t inode;
+  FlowKey key;
+  bool listening;
+};
+
+// Все сокеты семейства и протокола через sock_diag (без владельцев)
+bool DumpSockets(int netlink, uint8_t family, uint8_t protocol, std::vector<SocketDump>* out) {
+  struct {
+    nlmsghdr header;
+    inet_diag_req_v2 request;
+  } message;
+  memset(&message, 0, sizeof(message));
+  message.header.nlmsg_len = sizeof(message);
+  message.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  message.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  message.request.sdiag_family = family;
+  message.request.sdiag_protocol = protocol;
+  message.request.idiag_states = ~0u;
+  sockaddr_nl kernel;
+  memset(&kernel, 0, sizeof(kernel));
+  kernel.nl_family = AF_NETLINK;
+  if (sendto(netlink, &message, sizeof(message), 0, (const sockaddr*)&kernel, sizeof(kernel)) < 0) {
+    return false;
+  }
+
+  alignas(nlmsghdr) char buffer[32768];
+  for (;;) {
+    ssize_t received = recv(netlink, buffer, sizeof(buffer), 0);
+    if (received <= 0) {
+      return false;
+    }
+    int remaining = (int)received;
+    for (nlmsghdr* header = (nlmsghdr*)buffer; NLMSG_OK(header, remaining);
+         header = NLMSG_NEXT(header, remaining)) {
+      if (header->nlmsg_type == NLMSG_DONE) {
+        return true;
+      }
+      if (header->nlmsg_type == NLMSG_ERROR) {
+        return false;
+      }
+      const inet_diag_msg* socket = (const inet_diag_msg*)NLMSG_DATA(header);
+      // TIME_WAIT и полуоткрытые соединения никому не принадлежат
+      if (socket->idiag_inode == 0) {
+        continue;
+      }
+      SocketDump dump;
+      dump.inode = socket->idiag_inode;
+      dump.key = ProcessTable::SocketKey(protocol, family == AF_INET ? 4 : 6,
+                                         (const uint8_t*)socket->id.idiag_src,
+                                         ntohs(socket->id.idiag_sport));
+      dump.listening = protocol == IPPROTO_TCP && socket->idiag_state == TCP_LISTEN;
+      out->push_back(dump);
+    }
+  }
+}
+
+// Владельцы сокетов по inode: просмотр /proc/<pid>/fd, пока не найдены все
+void FindSocketOwners(std::unordered_map<uint64_t, uint32_t>* owners) {
+  size_t remaining = owners->size();
+  DIR* processes = opendir("/proc");
+  if (processes == nullptr) {
+    return;
+  }
+  dirent* process;
+  while (remaining > 0 && (process = readdir(processes)) != nullptr) {
+    char* end = nullptr;
+    unsigned long pid = strtoul(process->d_name, &end, 10);
+    if (pid == 0 || *end != '\0') {
+      continue;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%lu/fd", pid);
+    DIR* descriptors = opendir(path);
+    if (descriptors == nullptr) {
+      continue;
+    }
+    dirent* descriptor;
+    while (remaining > 0 && (descriptor = readdir(descriptors)) != nullptr) {
+      if (descriptor->d_name[0] == '.') {
+        continue;
+      }
+      char link[320];
+      char target[64];
+      snprintf(link, sizeof(link), "/proc/%lu/fd/%s", pid, descriptor->d_name);
+      ssize_t length = readlink(link, target, sizeof(target) - 1);
+      if (length <= 8 || memcmp(target, "socket:[", 8) != 0) {
+        continue;
+      }
+      target[length] = '\0';
+      auto owner = owners->find(strtoull(target + 8, nullptr, 10));
+      if (owner != owners->end() && owner->second == 0) {
+        owner->second = (uint32_t)pid;
+        remaining--;
+      }
+    }
+    closedir(descriptors);
+  }
+  closedir(processes);
+}
+
+struct FlowKeyLess {
+  bool operator()(const FlowKey& left, const FlowKey& right) const {
+    return memcmp(&left, &right, sizeof(FlowKey)) < 0;
+  }
+};
+
+#endif
+
+}  // namespace
+
+ProcessMonitor::ProcessMonitor(ProcessTable* table) : table_(table) {}
+
+ProcessMonitor::~ProcessMonitor() { Stop(); }
+
+const std::string& ProcessMonitor::ProcessPath(uint32_t pid) {
+  int64_t now = NowMs();
+  CachedPath& cached = paths_[pid];
+  if (cached.resolved_ms == 0 || now - cached.resolved_ms >= kPathTtlMs) {
+    cached.path = QueryProcessPath(pid);
+    cached.resolved_ms = now;
+  }
+  return cached.path;
+}
+
+#if defined(_WIN32)
+
+bool ProcessMonitor::Start() {
+  if (running_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  // Слой SOCKET только сообщает о событиях и ничего не задерживает
+  HANDLE handle = WinDivertOpen("true", WINDIVERT_LAYER_SOCKET, 0,
+                                WINDIVERT_FLAG_SNIFF | WINDIVERT_FLAG_RECV_ONLY);
+  if (handle == INVALID_HANDLE_VALUE) {
+    LOG_ERROR("Ошибка открытия слоя SOCKET WinDivert: %lu", GetLastError());
+    return false;
+  }
+  handle_ = handle;
+  // События с момента открытия копятся в очереди, поэтому снимок после
+  // открытия ничего не пропускает
+  Resync();
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&ProcessMonitor::Loop, this);
+  return true;
+}
+
+void ProcessMonitor::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  WinDivertShutdown((HANDLE)handle_, WINDIVERT_SHUTDOWN_BOTH);
+  thread_.join();
+  WinDivertClose((HANDLE)handle_);
+  handle_ = nullptr;
+}
+
+void ProcessMonitor::Loop() {
+  WINDIVERT_ADDRESS addresses[kEventBatch];
+  while (running_.load(std::memory_order_acquire)) {
+    UINT addresses_length = sizeof(addresses);
+    if (!WinDivertRecvEx((HANDLE)handle_, NULL, 0, NULL, 0, addresses, &addresses_length,
+                         NULL)) {
+      // ERROR_NO_DATA означает, что был вызван WinDivertShutdown
+      if (GetLastError() == ERROR_NO_DATA) {
+        break;
+      }
+      continue;
+    }
+    for (size_t i = 0; i < addresses_length / sizeof(WINDIVERT_ADDRESS); i++) {
+      OnSocketEvent(&addresses[i]);
+    }
+    if (ProcessTable::NowSeconds() >= next_resync_s_) {
+      Resync();
+    }
+    table_->Expire();
+  }
+}
+
+void ProcessMonitor::OnSocketEvent(const void* event) {
+  const WINDIVERT_ADDRESS& address = *(const WINDIVERT_ADDRESS*)event;
+  const WINDIVERT_DATA_SOCKET& socket = address.Socket;
+  // Адреса слоя SOCKET - IPv6 (IPv4 как ::ffff:a.b.c.d) в порядке байт хоста
+  uint8_t local[16];
+  WinDivertHelperHtonIPv6Address(socket.LocalAddr, (UINT*)local);
+  uint8_t family = address.IPv6 ? 6 : 4;
+  FlowKey key = ProcessTable::SocketKey(socket.Protocol, family,
+                                        family == 4 ? local + 12 : local, socket.LocalPort);
+  switch (address.Event) {
+    case WINDIVERT_EVENT_SOCKET_BIND:
+    case WINDIVERT_EVENT_SOCKET_CONNECT:
+      table_->Update(key, ProcessPath(socket.ProcessId), false);
+      break;
+    case WINDIVERT_EVENT_SOCKET_LISTEN:
+      table_->Update(key, ProcessPath(socket.ProcessId), true);
+      break;
+    case WINDIVERT_EVENT_SOCKET_CLOSE:
+      table_->Remove(key, socket.RemotePort != 0);
+      break;
+    default:
+      // ACCEPT: порт уже записан слушающим сокетом
+      break;
+  }
+}
+
+void ProcessMonitor::Resync() {
+  std::vector<uint8_t> buffer;
+  if (ReadTable(
+          [](void* table, DWORD* size) {
+            return GetExtendedTcpTable(table, size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0);
+          },
+          &buffer)) {
+    const MIB_TCPTABLE_OWNER_PID* table = (const MIB_TCPTABLE_OWNER_PID*)buffer.data();
+    for (DWORD i = 0; i < table->dwNumEntries; i++) {
+      const MIB_TCPROW_OWNER_PID& row = table->table[i];
+      if (row.dwOwningPid != 0) {
+        table_->Update(ProcessTable::SocketKey(IPPROTO_TCP, 4, (const uint8_t*)&row.dwLocalAddr,
+                                               ntohs((u_short)row.dwLocalPort)),
+                       ProcessPath(row.dwOwningPid), row.dwState == MIB_TCP_STATE_LISTEN);
+      }
+    }
+  }
+  if (ReadTable(
+          [](void* table, DWORD* size) {
+            return GetExtendedTcpTable(table, size, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0);
+          },
+          &buffer)) {
+    const MIB_TCP6TABLE_OWNER_PID* table = (const MIB_TCP6TABLE_OWNER_PID*)buffer.data();
+    for (DWORD i = 0; i < table->dwNumEntries; i++) {
+      const MIB_TCP6ROW_OWNER_PID& row = table->table[i];
+      if (row.dwOwningPid != 0) {
+        table_->Update(ProcessTable::SocketKey(IPPROTO_TCP, 6, row.ucLocalAddr,
+                                               ntohs((u_short)row.dwLocalPort)),
+                       ProcessPath(row.dwOwningPid), row.dwState == MIB_TCP_STATE_LISTEN);
+      }
+    }
+  }
+  if (ReadTable(
+          [](void* table, DWORD* size) {
+            return GetExtendedUdpTable(table, size, FALSE, AF_INET, UDP_TABLE_OWNER_PID, 0);
+          },
+          &buffer)) {
+    const MIB_UDPTABLE_OWNER_PID* table = (const MIB_UDPTABLE_OWNER_PID*)buffer.data();
+    for (DWORD i = 0; i < table->dwNumEntries; i++) {
+      const MIB_UDPROW_OWNER_PID& row = table->table[i];
+      table_->Update(ProcessTable::SocketKey(IPPROTO_UDP, 4, (const uint8_t*)&row.dwLocalAddr,
+                                             ntohs((u_short)row.dwLocalPort)),
+                     ProcessPath(row.dwOwningPid), false);
+    }
+  }
+  if (ReadTable(
+          [](void* table, DWORD* size) {
+            return GetExtendedUdpTable(table, size, FALSE, AF_INET6, UDP_TABLE_OWNER_PID, 0);
+          },
+          &buffer)) {
+    const MIB_UDP6TABLE_OWNER_PID* table = (const MIB_UDP6TABLE_OWNER_PID*)buffer.data();
+    for (DWORD i = 0; i < table->dwNumEntries; i++) {
+      const MIB_UDP6ROW_OWNER_PID& row = table->table[i];
+      table_->Update(ProcessTable::SocketKey(IPPROTO_UDP, 6, row.ucLocalAddr,
+                                             ntohs((u_short)row.dwLocalPort)),
+                     ProcessPath(row.dwOwningPid), false);
+    }
+  }
+  PrunePaths();
+  next_resync_s_ = ProcessTable::NowSeconds() + kResyncIntervalS;
+}
+
+#else
+
+bool ProcessMonitor::Start() {
+  if (running_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  netlink_ = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+  if (netlink_ < 0) {
+    return false;
+  }
+  Resync();
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&ProcessMonitor::Loop, this);
+  return true;
+}
+
+void ProcessMonitor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+  wait_.notify_all();
+  thread_.join();
+  close(netlink_);
+  netlink_ = -1;
+}
+
+void ProcessMonitor::Loop() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(wait_mutex_);
+      wait_.wait_for(lock, std::chrono::milliseconds(kRefreshIntervalMs),
+                     [this] { return !running_.load(std::memory_order_acquire); });
+      if (!running_.load(std::memory_order_acquire)) {
+        break;
+      }
+    }
+    if (ProcessTable::NowSeconds() >= next_resync_s_) {
+      Resync();
+    } else {
+      Refresh(false);
+    }
+    table_->Expire();
+  }
+}
+
+void ProcessMonitor::Resync() {
+  Refresh(true);
+  PrunePaths();
+  next_resync_s_ = ProcessTable::NowSeconds() + kResyncIntervalS;
+}
+
+void ProcessMonitor::Refresh(bool resync) {
+  std::vector<SocketDump> dumps;
+  const uint8_t kFamilies[] = {AF_INET, AF_INET6};
+  const uint8_t kProtocols[] = {IPPROTO_TCP, IPPROTO_UDP};
+  for (uint8_t family : kFamilies) {
+    for (uint8_t protocol : kProtocols) {
+      if (!DumpSockets(netlink_, family, protocol, &dumps)) {
+        // Неполная выгрузка выдала бы живые сокеты за закрытые
+        return;
+      }
+    }
+  }
+
+  // Новые сокеты (при полной сверке - и те, чей владелец не нашелся)
+  std::unordered_map<uint64_t, SocketRecord> current;
+  std::unordered_map<uint64_t, uint32_t> owners;
+  for (const SocketDump& dump : dumps) {
+    SocketRecord& record = current[dump.inode];
+    record.key = dump.key;
+    record.listening = dump.listening;
+    auto known = sockets_.find(dump.inode);
+    if (known != sockets_.end() && (known->second.pid != 0 || !resync)) {
+      record.pid = known->second.pid;
+    } else {
+      owners.emplace(dump.inode, 0);
+    }
+  }
+  if (!owners.empty()) {
+    FindSocketOwners(&owners);
+  }
+  for (auto& entry : current) {
+    SocketRecord& record = entry.second;
+    auto owner = owners.find(entry.first);
+    if (owner != owners.end()) {
+      record.pid = owner->second;
+    }
+    if (record.pid != 0 && (resync || owner != owners.end())) {
+      table_->Update(record.key, ProcessPath(record.pid), record.listening);
+    }
+  }
+
+  // Закрытые сокеты; ключ остается, пока его держит другой сокет (например,
+  // принятое соединение на порту слушающего)
+  std::set<FlowKey, FlowKeyLess> live;
+  for (const auto& entry : sockets_) {
+    if (current.find(entry.first) != current.end()) {
+      continue;
+    }
+    if (live.empty()) {
+      for (const auto& record : current) {
+        live.insert(record.second.key);
+      }
+    }
+    if (live.find(entry.second.key) == live.end()) {
+      table_->Remove(entry.second.key, false);
+    }
+  }
+  sockets_.swap(current);
+}
+
+#endif
+
+void ProcessMonitor::PrunePaths() {
+  int64_t now = NowMs();
+  for (auto it = paths_.begin(); it != paths_.end();) {
+    if (now - it->second.resolved_ms >= kPathTtlMs) {
+      it = paths_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
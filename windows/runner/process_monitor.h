@@ -0,0 +1,90 @@
+#ifndef RUNNER_PROCESS_MONITOR_H_
+#define RUNNER_PROCESS_MONITOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "process_table.h"
+
+// Фоновое заполнение ProcessTable.
+//
+// Windows: при запуске - снимок таблиц TCP/UDP с PID владельцев
+// (GetExtendedTcpTable/GetExtendedUdpTable), дальше - события bind,
+// connect, listen и close слоя SOCKET WinDivert (в режиме наблюдения, без
+// задержки сокетов). Событие connect приходит раньше первого пакета
+// соединения, но обрабатывается асинхронно, поэтому первый пакет может
+// его опередить; полный снимок повторяется раз в kResyncIntervalS на
+// случай потерянных событий.
+//
+// Linux: раз в kRefreshIntervalMs сокеты выгружаются через netlink
+// sock_diag, и сравниваются с прошлой выгрузкой; /proc/<pid>/fd
+// просматривается только ради появившихся сокетов.
+//
+// Путь исполняемого файла по PID запоминается на kPathTtlMs: PID может
+// достаться другому процессу.
+class ProcessMonitor {
+ public:
+  static constexpr int kRefreshIntervalMs = 500;
+  static constexpr uint32_t kResyncIntervalS = 600;
+  static constexpr int64_t kPathTtlMs = 30000;
+
+  explicit ProcessMonitor(ProcessTable* table);
+  ~ProcessMonitor();
+
+  ProcessMonitor(const ProcessMonitor&) = delete;
+  ProcessMonitor& operator=(const ProcessMonitor&) = delete;
+
+  bool Start();
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+ private:
+  struct CachedPath {
+    std::string path;
+    int64_t resolved_ms = 0;
+  };
+
+  void Loop();
+  // Полная сверка с системными таблицами
+  void Resync();
+  const std::string& ProcessPath(uint32_t pid);
+  void PrunePaths();
+
+#if defined(_WIN32)
+  void OnSocketEvent(const void* address);
+
+  void* handle_ = nullptr;  // HANDLE WinDivert слоя SOCKET
+#else
+  // Сокет из выгрузки sock_diag
+  struct SocketRecord {
+    FlowKey key;
+    bool listening = false;
+    uint32_t pid = 0;
+  };
+
+  // Выгрузить сокеты и обновить таблицу; |resync| - переписать все записи
+  void Refresh(bool resync);
+
+  int netlink_ = -1;
+  std::unordered_map<uint64_t, SocketRecord> sockets_;  // по inode
+  std::mutex wait_mutex_;
+  std::condition_variable wait_;
+#endif
+
+  ProcessTable* table_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  uint32_t next_resync_s_ = 0;
+  std::unordered_map<uint32_t, CachedPath> paths_;  // поток монитора
+};
+
+#endif  // RUNNER_PROCESS_MONITOR_H_
@@ -0,0 +1,99 @@
+#include "process_table.h"
+
+#include <string.h>
+
+#include <chrono>
+
+ProcessTable::ProcessTable(size_t capacity)
+    : sockets_(capacity, 16), paths_(new std::atomic<const std::string*>[kMaxPaths]) {
+  for (size_t i = 0; i < kMaxPaths; i++) {
+    paths_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+FlowKey ProcessTable::SocketKey(uint8_t protocol, uint8_t family, const uint8_t* address,
+                                uint16_t port) {
+  FlowKey key;
+  key.family = family;
+  key.protocol = protocol;
+  key.source_port = port;
+  if (address != nullptr) {
+    memcpy(key.source, address, family == 4 ? 4 : 16);
+  }
+  return key;
+}
+
+const std::string* ProcessTable::Lookup(const FlowKey& flow) {
+  uint32_t now = NowSeconds();
+  FlowKey key = SocketKey(flow.protocol, flow.family, flow.source, flow.source_port);
+  FlowValue value;
+  bool found = sockets_.Lookup(key, now, &value);
+  if (!found) {
+    memset(key.source, 0, sizeof(key.source));
+    found = sockets_.Lookup(key, now, &value);
+  }
+  if (!found && flow.family == 4) {
+    key.family = 6;
+    found = sockets_.Lookup(key, now, &value);
+  }
+  if (!found || value.reserved == 0 || value.reserved >= kMaxPaths) {
+    return nullptr;
+  }
+  return paths_[value.reserved].load(std::memory_order_acquire);
+}
+
+void ProcessTable::Update(const FlowKey& socket, const std::string& path, bool listening) {
+  uint32_t number = InternPath(path);
+  if (number == 0) {
+    return;
+  }
+  uint32_t now = NowSeconds();
+  FlowValue value;
+  // Принятое соединение на порту слушающего сокета не снимает признак
+  if (!listening && sockets_.Lookup(socket, now, &value) && (value.flags & kListening) &&
+      value.reserved == number) {
+    listening = true;
+  }
+  value = FlowValue();
+  value.family = socket.family;
+  value.flags = listening ? kListening : 0;
+  value.reserved = number;
+  sockets_.Insert(socket, value, now, kIdleTimeoutS);
+}
+
+void ProcessTable::Remove(const FlowKey& socket, bool connected) {
+  if (connected) {
+    FlowValue value;
+    if (sockets_.Lookup(socket, NowSeconds(), &value) && (value.flags & kListening)) {
+      return;
+    }
+  }
+  sockets_.Remove(socket);
+}
+
+void ProcessTable::Expire() { sockets_.Expire(NowSeconds()); }
+
+uint32_t ProcessTable::NowSeconds() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t ProcessTable::InternPath(const std::string& path) {
+  if (path.empty()) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = path_numbers_.find(path);
+  if (found != path_numbers_.end()) {
+    return found->second;
+  }
+  uint32_t number = (uint32_t)owned_paths_.size() + 1;
+  if (number >= kMaxPaths) {
+    return 0;
+  }
+  owned_paths_.emplace_back(new std::string(path));
+  paths_[number].store(owned_paths_.back().get(), std::memory_order_release);
+  path_numbers_.emplace(path, number);
+  return number;
+}
@@ -0,0 +1,73 @@
+#ifndef RUNNER_PROCESS_TABLE_H_
+#define RUNNER_PROCESS_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flow_table.h"
+
+// Владельцы сокетов для правил 'process': локальный адрес и порт сокета ->
+// исполняемый файл процесса.
+//
+// Записи хранятся в FlowTable с ключом сокета (SocketKey: назначение
+// нулевое), поэтому поиск для нового потока - одна-три пробы хеш-таблицы
+// без блокировок и системных вызовов. Значение записи - номер пути в
+// таблице путей; пути только добавляются и живут до разрушения таблицы.
+// Заполняет таблицу ProcessMonitor.
+class ProcessTable {
+ public:
+  static constexpr size_t kMaxPaths = 4096;
+  // Сокет без трафика и событий забывается через час
+  static constexpr uint32_t kIdleTimeoutS = 3600;
+
+  explicit ProcessTable(size_t capacity = 16384);
+
+  ProcessTable(const ProcessTable&) = delete;
+  ProcessTable& operator=(const ProcessTable&) = delete;
+
+  // Ключ сокета; адрес в сетевом порядке (4 или 16 байт), нулевой - сокет
+  // на всех адресах
+  static FlowKey SocketKey(uint8_t protocol, uint8_t family, const uint8_t* address,
+                           uint16_t port);
+
+  // Путь исполняемого файла владельца исходящего потока |flow| (по его
+  // источнику) или nullptr. Проверяются сокет на адресе источника, сокет на
+  // всех адресах и двухстековый сокет IPv6 на всех адресах.
+  const std::string* Lookup(const FlowKey& flow);
+
+  // Записать владельца сокета; |listening| - слушающий сокет TCP
+  void Update(const FlowKey& socket, const std::string& path, bool listening);
+
+  // Забыть сокет. Закрытие принятого соединения (|connected|) не удаляет
+  // слушающий сокет на том же порту.
+  void Remove(const FlowKey& socket, bool connected);
+
+  // Удалить простаивающие записи
+  void Expire();
+
+  size_t size() const { return sockets_.size(); }
+
+  static uint32_t NowSeconds();
+
+ private:
+  static constexpr uint8_t kListening = 1;
+
+  uint32_t InternPath(const std::string& path);
+
+  FlowTable sockets_;
+  // Пути по номеру (0 - нет пути); запись до публикации номера
+  std::unique_ptr<std::atomic<const std::string*>[]> paths_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, uint32_t> path_numbers_;
+  std::vector<std::unique_ptr<std::string>> owned_paths_;
+};
+
+#endif  // RUNNER_PROCESS_TABLE_H_
@@ -0,0 +1,1299 @@
+#include "proxy_server.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#include "native_log.h"
+
+namespace {
+
+// Буфер одного направления ретрансляции (режим копирования)
+constexpr size_t kRelayBufferSize = 16 * 1024;
+
+// Каналов splice() на поток (по два на соединение). Канал - два
+// дескриптора, а без предела при тысячах соединений дескрипторы кончаются
+// раньше, чем сокеты к серверам
+constexpr size_t kMaxPipesPerWorker = 1024;
+
+// Одновременно ожидающих приема операций на слушающий сокет
+constexpr size_t kAcceptDepth = 8;
+
+constexpr int kPollTimeoutMs = 100;
+
+// Сколько ждать завершения операций при остановке
+constexpr auto kShutdownTimeout = std::chrono::seconds(2);
+
+#if defined(SO_REUSEPORT)
+// Ядро само распределяет соединения между слушающими сокетами потоков
+constexpr bool kShardedAccept = true;
+#else
+constexpr bool kShardedAccept = false;
+#endif
+
+// Команды запроса SOCKS5 (RFC 1928)
+constexpr uint8_t kSocksCommandConnect = 0x01;
+constexpr uint8_t kSocksCommandBind = 0x02;
+constexpr uint8_t kSocksCommandUdpAssociate = 0x03;
+
+// Коды ответа SOCKS5
+constexpr uint8_t kSocksSucceeded = 0x00;
+constexpr uint8_t kSocksGeneralFailure = 0x01;
+constexpr uint8_t kSocksNotAllowed = 0x02;
+constexpr uint8_t kSocksHostUnreachable = 0x04;
+constexpr uint8_t kSocksConnectionRefused = 0x05;
+constexpr uint8_t kSocksCommandNotSupported = 0x07;
+constexpr uint8_t kSocksAddressNotSupported = 0x08;
+
+const char kHttpEstablished[] = "HTTP/1.1 200 Connection Established\r\n\r\n";
+const char kHttpBadRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+const char kHttpNotAllowed[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: CONNECT\r\nConnection: close\r\n\r\n";
+const char kHttpBadGateway[] = "HTTP/1.1 502 Bad Gateway\r\nConnection: close\r\n\r\n";
+
+// Буфер ответа соединения вмещает любой из ответов выше и ответ SOCKS5 с
+// адресом IPv6 (22 байта)
+constexpr size_t kMaxReplySize = 80;
+static_assert(sizeof(kHttpEstablished) - 1 <= kMaxReplySize, "reply buffer too small");
+static_assert(sizeof(kHttpBadRequest) - 1 <= kMaxReplySize, "reply buffer too small");
+static_assert(sizeof(kHttpNotAllowed) - 1 <= kMaxReplySize, "reply buffer too small");
+static_assert(sizeof(kHttpBadGateway) - 1 <= kMaxReplySize, "reply buffer too small");
+
+void SetNoDelay(SocketHandle socket) {
+  int enable = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+}
+
+}  // namespace
+
+// Рабочий поток: реактор, слушающий сокет (если есть) и пул соединений
+class ProxyServer::Worker : public IoHandler {
+ public:
+  Worker(ProxyServer* server, std::unique_ptr<Reactor> reactor, bool zero_copy)
+      : server_(server),
+        reactor_(std::move(reactor)),
+        zero_copy_(zero_copy && reactor_->SupportsSplice()),
+        buffers_(kRelayBufferSize),
+        pipes_(kMaxPipesPerWorker) {}
+
+  ~Worker() { Join(); }
+
+  bool SetListener(SocketHandle listener) {
+    if (!reactor_->Attach(listener)) {
+      return false;
+    }
+    listener_ = listener;
+    return true;
+  }
+
+  void Start() { thread_ = std::thread(&Worker::Loop, this); }
+
+  void RequestStop() {
+    stopping_.store(true, std::memory_order_release);
+    reactor_->Wake();
+  }
+
+  void Join() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Выполнить задачу в потоке реактора
+  void Post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(inbox_mutex_);
+      inbox_.push_back(std::move(task));
+    }
+    reactor_->Wake();
+  }
+
+  // Принять соединение в обработку (в потоке реактора)
+  void Adopt(SocketHandle client);
+
+  void Release(Connection* connection);
+
+  Reactor* reactor() { return reactor_.get(); }
+  ConnectorTimers* timers() { return &timers_; }
+  ProxyServer* server() { return server_; }
+  bool zero_copy() const { return zero_copy_; }
+  BufferPool& buffers() { return buffers_; }
+  PipePool& pipes() { return pipes_; }
+
+  // Завершения приема
+  void OnIoComplete(IoOp* op) override;
+
+ private:
+  void Loop();
+  void DrainInbox();
+  void SubmitAccept(IoOp* op);
+  void Shutdown();
+
+  ProxyServer* server_;
+  std::unique_ptr<Reactor> reactor_;
+  bool zero_copy_;
+  BufferPool buffers_;
+  PipePool pipes_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+
+  SocketHandle listener_ = kInvalidSocket;
+  IoOp accept_ops_[kAcceptDepth];
+  size_t pending_accepts_ = 0;
+
+  // Объявлены до соединений: соединители снимаются с таймеров при удалении
+  ConnectorTimers timers_;
+
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<Connection*> free_connections_;
+  size_t connections_in_use_ = 0;
+
+  std::mutex inbox_mutex_;
+  std::vector<std::function<void()>> inbox_;
+};
+
+// Соединение клиента: рукопожатие SOCKS5/HTTP CONNECT, подключение к
+// назначению (или через вышестоящий SOCKS5) и двунаправленная ретрансляция
+class ProxyServer::Connection : public IoHandler, public ConnectHandler {
+ public:
+  explicit Connection(Worker* worker)
+      : worker_(worker),
+        connector_(worker->reactor(), worker->timers(), &worker->server()->family_cache_) {
+    IoOp* ops[] = {&client_read_, &client_write_, &upstream_read_, &upstream_write_};
+    for (IoOp* op : ops) {
+      op->handler = this;
+    }
+    client_read_.type = IoOpType::kRead;
+    client_write_.type = IoOpType::kWrite;
+    upstream_read_.type = IoOpType::kRead;
+    upstream_write_.type = IoOpType::kWrite;
+  }
+
+  void Start(SocketHandle client);
+
+  // Закрыть оба сокета; объект вернется в пул после завершения операций
+  void Close();
+
+  void OnIoComplete(IoOp* op) override;
+
+  // Итог гонки соединений к назначению
+  void OnConnectComplete(HappyEyeballsConnector* connector) override;
+
+ private:
+  enum class State {
+    kIdle,
+    kGreeting,      // SOCKS5: выбор метода
+    kSocksRequest,  // SOCKS5: запрос CONNECT
+    kHttpRequest,   // HTTP CONNECT
+    kResolving,
+    kConnecting,
+    kUpstreamHandshake,  // запрос CONNECT к вышестоящему SOCKS5
+    kReplying,      // отправка ответа об успехе
+    kRelaying,
+    kAssociated,    // UDP ASSOCIATE: ждем закрытия управляющего соединения
+    kClosing,
+  };
+
+  enum class Protocol { kUnknown, kSocks5, kHttp };
+
+  bool Submit(IoOp* op);
+  void ReadHandshake();
+  void ContinueHandshake();
+  bool ParseGreeting();
+  bool ParseSocksRequest();
+  bool ParseHttpRequest();
+  void Consume(size_t length);
+  void Connect();
+  void SendUpstreamRequest();
+  void ReadUpstreamReply(size_t total);
+  void OnUpstreamReply();
+  void ReplyConnected();
+  void Associate();
+  void WatchAssociation();
+  void ConnectTo(const std::string& cache_key, const ResolvedAddress* addresses, size_t count);
+  void Fail(uint8_t socks_code);
+  void SendReply(const void* data, size_t length, bool close_after);
+  void StartRelay();
+  void Finish();
+
+  // Операции ретрансляции: буфер или канал в зависимости от режима
+  bool SubmitClientRead();
+  bool SubmitUpstreamWrite(size_t length);
+  bool SubmitUpstreamRead();
+  bool SubmitClientWrite(size_t length);
+
+  void OnClientRead();
+  void OnClientWrite();
+  void OnUpstreamRead();
+  void OnUpstreamWrite();
+
+  Worker* worker_;
+  State state_ = State::kIdle;
+  Protocol protocol_ = Protocol::kUnknown;
+
+  SocketHandle client_ = kInvalidSocket;
+  SocketHandle upstream_ = kInvalidSocket;
+  size_t pending_ops_ = 0;
+  bool client_eof_ = false;
+  bool upstream_eof_ = false;
+  bool close_after_reply_ = false;
+  bool chained_ = false;             // соединение идет через вышестоящий SOCKS5
+  size_t upstream_received_ = 0;     // принятая часть его ответа
+
+  // Разобранное назначение
+  std::string host_;
+  uint16_t port_ = 0;
+
+  // Ассоциация в UdpRelay (0 - нет)
+  uint32_t association_ = 0;
+
+  // Принятые, но не разобранные/не отправленные байты клиента
+  size_t buffered_ = 0;
+
+  IoOp client_read_;
+  IoOp client_write_;
+  IoOp upstream_read_;
+  IoOp upstream_write_;
+  HappyEyeballsConnector connector_;
+
+  char reply_[kMaxReplySize];
+
+  // Буферы из пула потока: upload_ нужен с рукопожатия, download_ - только
+  // при ретрансляции копированием. В режиме splice данные идут через каналы.
+  char* upload_ = nullptr;
+  char* download_ = nullptr;
+  int upload_pipe_[2] = {-1, -1};
+  int download_pipe_[2] = {-1, -1};
+  bool splice_ = false;
+};
+
+void ProxyServer::Connection::Start(SocketHandle client) {
+  client_ = client;
+  upstream_ = kInvalidSocket;
+  state_ = State::kGreeting;
+  protocol_ = Protocol::kUnknown;
+  pending_ops_ = 0;
+  client_eof_ = false;
+  upstream_eof_ = false;
+  close_after_reply_ = false;
+  chained_ = false;
+  upstream_received_ = 0;
+  host_.clear();
+  port_ = 0;
+  association_ = 0;
+  buffered_ = 0;
+  splice_ = false;
+  upload_ = worker_->buffers().Acquire();
+  client_read_.type = IoOpType::kRead;
+  client_write_.type = IoOpType::kWrite;
+  upstream_read_.type = IoOpType::kRead;
+  upstream_write_.type = IoOpType::kWrite;
+  client_read_.socket = client;
+  client_write_.socket = client;
+  ReadHandshake();
+}
+
+bool ProxyServer::Connection::Submit(IoOp* op) {
+  pending_ops_++;
+  if (!worker_->reactor()->Submit(op)) {
+    pending_ops_--;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void ProxyServer::Connection::Close() {
+  if (state_ == State::kClosing || state_ == State::kIdle) {
+    return;
+  }
+  bool connecting = state_ == State::kConnecting;
+  state_ = State::kClosing;
+  if (connecting) {
+    // Отмененные попытки вернутся через OnConnectComplete()
+    connector_.Cancel();
+  }
+  if (association_ != 0) {
+    worker_->server()->udp_relay_->Dissociate(association_);
+    association_ = 0;
+  }
+  worker_->reactor()->Close(client_);
+  if (upstream_ != kInvalidSocket) {
+    worker_->reactor()->Close(upstream_);
+  }
+  client_ = kInvalidSocket;
+  upstream_ = kInvalidSocket;
+  if (pending_ops_ == 0) {
+    Finish();
+  }
+}
+
+void ProxyServer::Connection::Finish() {
+  worker_->buffers().Release(upload_);
+  worker_->buffers().Release(download_);
+  upload_ = nullptr;
+  download_ = nullptr;
+  worker_->pipes().Release(upload_pipe_);
+  worker_->pipes().Release(download_pipe_);
+  state_ = State::kIdle;
+  worker_->Release(this);
+}
+
+void ProxyServer::Connection::OnIoComplete(IoOp* op) {
+  pending_ops_--;
+  if (state_ == State::kClosing) {
+    if (pending_ops_ == 0) {
+      Finish();
+    }
+    return;
+  }
+
+  if (op == &client_read_) {
+    OnClientRead();
+  } else if (op == &client_write_) {
+    OnClientWrite();
+  } else if (op == &upstream_read_) {
+    OnUpstreamRead();
+  } else if (op == &upstream_write_) {
+    OnUpstreamWrite();
+  }
+}
+
+void ProxyServer::Connection::ReadHandshake() {
+  if (buffered_ >= kRelayBufferSize) {
+    // Заголовок не поместился в буфер
+    if (protocol_ == Protocol::kHttp) {
+      SendReply(kHttpBadRequest, sizeof(kHttpBadRequest) - 1, true);
+    } else {
+      Close();
+    }
+    return;
+  }
+  client_read_.buffer = upload_ + buffered_;
+  client_read_.length = kRelayBufferSize - buffered_;
+  Submit(&client_read_);
+}
+
+void ProxyServer::Connection::Consume(size_t length) {
+  memmove(upload_, upload_ + length, buffered_ - length);
+  buffered_ -= length;
+}
+
+void ProxyServer::Connection::ContinueHandshake() {
+  if (protocol_ == Protocol::kUnknown && buffered_ > 0) {
+    if ((uint8_t)upload_[0] == 0x05) {
+      protocol_ = Protocol::kSocks5;
+    } else {
+      protocol_ = Protocol::kHttp;
+      state_ = State::kHttpRequest;
+    }
+  }
+
+  bool complete = false;
+  switch (state_) {
+    case State::kGreeting:
+      complete = ParseGreeting();
+      break;
+    case State::kSocksRequest:
+      complete = ParseSocksRequest();
+      break;
+    case State::kHttpRequest:
+      complete = ParseHttpRequest();
+      break;
+    default:
+      return;
+  }
+  // Сообщение еще не пришло целиком
+  if (!complete && state_ != State::kClosing) {
+    ReadHandshake();
+  }
+}
+
+bool ProxyServer::Connection::ParseGreeting() {
+  if (buffered_ < 2 || buffered_ < 2 + (size_t)(uint8_t)upload_[1]) {
+    return false;
+  }
+  size_t method_count = (uint8_t)upload_[1];
+  bool no_auth = memchr(upload_ + 2, 0x00, method_count) != nullptr;
+  Consume(2 + method_count);
+
+  // Поддерживается только метод без аутентификации (локальный прокси)
+  uint8_t reply[2] = {0x05, (uint8_t)(no_auth ? 0x00 : 0xFF)};
+  state_ = State::kSocksRequest;
+  SendReply(reply, sizeof(reply), !no_auth);
+  return true;
+}
+
+bool ProxyServer::Connection::ParseSocksRequest() {
+  if (buffered_ < 5) {
+    return false;
+  }
+  const uint8_t* request = (const uint8_t*)upload_;
+  size_t address_length;
+  switch (request[3]) {
+    case 0x01:
+      address_length = 4;
+      break;
+    case 0x03:
+      address_length = 1 + (size_t)request[4];
+      break;
+    case 0x04:
+      address_length = 16;
+      break;
+    default:
+      Fail(kSocksAddressNotSupported);
+      return true;
+  }
+  size_t total = 4 + address_length + 2;
+  if (buffered_ < total) {
+    return false;
+  }
+  if (request[0] != 0x05) {
+    Close();
+    return true;
+  }
+
+  char text[INET6_ADDRSTRLEN];
+  if (request[3] == 0x01) {
+    inet_ntop(AF_INET, (const void*)(request + 4), text, sizeof(text));
+    host_ = text;
+  } else if (request[3] == 0x04) {
+    inet_ntop(AF_INET6, (const void*)(request + 4), text, sizeof(text));
+    host_ = text;
+  } else {
+    host_.assign((const char*)request + 5, request[4]);
+  }
+  port_ = (uint16_t)((request[4 + address_length] << 8) | request[5 + address_length]);
+  uint8_t command = request[1];
+  Consume(total);
+
+  switch (command) {
+    case kSocksCommandConnect:
+      Connect();
+      break;
+    case kSocksCommandUdpAssociate:
+      // Обслуживает UdpRelay; без него - ответ "команда не поддерживается"
+      Associate();
+      break;
+    case kSocksCommandBind:
+      // BIND не поддерживается
+    default:
+      Fail(kSocksCommandNotSupported);
+      break;
+  }
+  return true;
+}
+
+bool ProxyServer::Connection::ParseHttpRequest() {
+  const char* end = nullptr;
+  for (size_t i = 3; i < buffered_; i++) {
+    if (memcmp(upload_ + i - 3, "\r\n\r\n", 4) == 0) {
+      end = upload_ + i + 1;
+      break;
+    }
+  }
+  if (end == nullptr) {
+    return false;
+  }
+
+  // "CONNECT host:port HTTP/1.1"
+  const char* line_end = (const char*)memchr(upload_, '\r', end - upload_);
+  std::string line(upload_, line_end - upload_);
+  size_t header_length = end - upload_;
+  Consume(header_length);
+
+  if (line.compare(0, 8, "CONNECT ") != 0) {
+    SendReply(kHttpNotAllowed, sizeof(kHttpNotAllowed) - 1, true);
+    return true;
+  }
+  size_t target_end = line.find(' ', 8);
+  std::string target = line.substr(8, target_end == std::string::npos
+                                          ? std::string::npos
+                                          : target_end - 8);
+  size_t colon = target.rfind(':');
+  if (colon == std::string::npos || colon + 1 >= target.size()) {
+    SendReply(kHttpBadRequest, sizeof(kHttpBadRequest) - 1, true);
+    return true;
+  }
+  int port = atoi(target.c_str() + colon + 1);
+  host_ = target.substr(0, colon);
+  if (host_.size() >= 2 && host_.front() == '[' && host_.back() == ']') {
+    host_ = host_.substr(1, host_.size() - 2);
+  }
+  if (port <= 0 || port > 65535 || host_.empty()) {
+    SendReply(kHttpBadRequest, sizeof(kHttpBadRequest) - 1, true);
+    return true;
+  }
+  port_ = (uint16_t)port;
+  Connect();
+  return true;
+}
+
+void ProxyServer::Connection::Connect() {
+  ProxyServer* server = worker_->server();
+  ResolvedAddress literal;
+  bool is_literal = ParseIpLiteral(host_, port_, &literal.address, &literal.length);
+  if (is_literal) {
+    const FakeIpTable* fake_ips = server->fake_ips_;
+    uint32_t address = literal.address.ss_family == AF_INET
+                           ? ntohl(((sockaddr_in*)&literal.address)->sin_addr.s_addr)
+                           : 0;
+    if (fake_ips != nullptr && fake_ips->Contains(address)) {
+      // Адрес выдан fake-IP DNS: соединяемся с именем, которое за ним стоит
+      if (!fake_ips->Lookup(address, &host_)) {
+        Fail(kSocksHostUnreachable);
+        return;
+      }
+      is_literal = false;
+    }
+  }
+
+  // Маршрут выбирается по имени, если оно известно, иначе по адресу
+  RouteAction action = server->route_ ? server->route_(host_, port_) : RouteAction::kNone;
+  if (action == RouteAction::kBlock) {
+    server->blocked_.fetch_add(1, std::memory_order_relaxed);
+    Fail(kSocksNotAllowed);
+    return;
+  }
+  if (action != RouteAction::kDirect && server->upstream_address_length_ != 0) {
+    // Имя разрешит вышестоящий прокси
+    chained_ = true;
+    ResolvedAddress upstream;
+    upstream.address = server->upstream_address_;
+    upstream.length = server->upstream_address_length_;
+    ConnectTo(std::string(), &upstream, 1);
+    return;
+  }
+  if (is_literal) {
+    ConnectTo(std::string(), &literal, 1);
+    return;
+  }
+
+  // Результат вернется в поток реактора; до него соединение занято
+  state_ = State::kResolving;
+  pending_ops_++;
+  Worker* worker = worker_;
+  worker->server()->resolver_->ResolveAll(
+      host_, port_, [this, worker](const std::vector<ResolvedAddress>& addresses) {
+        worker->Post([this, addresses] {
+          pending_ops_--;
+          if (state_ == State::kClosing) {
+            if (pending_ops_ == 0) {
+              Finish();
+            }
+            return;
+          }
+          if (addresses.empty()) {
+            Fail(kSocksHostUnreachable);
+            return;
+          }
+          // Семейство-победитель запоминается по имени назначения
+          ConnectTo(host_, addresses.data(), addresses.size());
+        });
+      });
+}
+
+void ProxyServer::Connection::Associate() {
+  ProxyServer* server = worker_->server();
+  if (!server->udp_relay_ || !server->udp_enabled_.load(std::memory_order_relaxed)) {
+    Fail(kSocksCommandNotSupported);
+    return;
+  }
+  // Датаграммы принимаются только с адреса управляющего соединения; порт
+  // источника клиент может указать в запросе (0 - любой)
+  sockaddr_storage peer = {};
+  socklen_t peer_length = sizeof(peer);
+  if (getpeername(client_, (sockaddr*)&peer, &peer_length) != 0) {
+    Fail(kSocksGeneralFailure);
+    return;
+  }
+  if (peer.ss_family == AF_INET6) {
+    ((sockaddr_in6*)&peer)->sin6_port = htons(port_);
+  } else {
+    ((sockaddr_in*)&peer)->sin_port = htons(port_);
+  }
+  association_ = server->udp_relay_->Associate(peer, (int)peer_length);
+  if (association_ == 0) {
+    Fail(kSocksGeneralFailure);
+    return;
+  }
+
+  // Ответ содержит адрес сокета ретранслятора
+  const sockaddr_storage& relay = server->udp_relay_->address();
+  uint8_t reply[22] = {0x05, kSocksSucceeded, 0x00};
+  size_t length;
+  if (relay.ss_family == AF_INET6) {
+    const sockaddr_in6* ipv6 = (const sockaddr_in6*)&relay;
+    reply[3] = 0x04;
+    memcpy(reply + 4, &ipv6->sin6_addr, 16);
+    memcpy(reply + 20, &ipv6->sin6_port, 2);
+    length = 22;
+  } else {
+    const sockaddr_in* ipv4 = (const sockaddr_in*)&relay;
+    reply[3] = 0x01;
+    memcpy(reply + 4, &ipv4->sin_addr, 4);
+    memcpy(reply + 8, &ipv4->sin_port, 2);
+    length = 10;
+  }
+  state_ = State::kAssociated;
+  SendReply(reply, length, false);
+}
+
+void ProxyServer::Connection::WatchAssociation() {
+  // Данные по управляющему соединению не ожидаются и отбрасываются
+  buffered_ = 0;
+  ReadHandshake();
+}
+
+void ProxyServer::Connection::ConnectTo(const std::string& cache_key,
+                                        const ResolvedAddress* addresses, size_t count) {
+  state_ = State::kConnecting;
+  pending_ops_++;
+  connector_.Start(cache_key, addresses, count, this);
+}
+
+void ProxyServer::Connection::OnConnectComplete(HappyEyeballsConnector* connector) {
+  pending_ops_--;
+  if (state_ == State::kClosing) {
+    if (pending_ops_ == 0) {
+      Finish();
+    }
+    return;
+  }
+
+  SocketHandle upstream = connector->TakeSocket();
+  if (upstream == kInvalidSocket) {
+    Fail(kSocksConnectionRefused);
+    return;
+  }
+  SetNoDelay(upstream);
+  upstream_ = upstream;
+  upstream_read_.socket = upstream;
+  upstream_write_.socket = upstream;
+
+  if (chained_) {
+    SendUpstreamRequest();
+    return;
+  }
+  ReplyConnected();
+}
+
+void ProxyServer::Connection::SendUpstreamRequest() {
+  // Адрес в запросе SOCKS5: IPv4, IPv6 или имя длиной до 255 байт
+  uint8_t address[16];
+  uint8_t address_type;
+  size_t address_length;
+  if (inet_pton(AF_INET, host_.c_str(), address) == 1) {
+    address_type = 0x01;
+    address_length = 4;
+  } else if (inet_pton(AF_INET6, host_.c_str(), address) == 1) {
+    address_type = 0x04;
+    address_length = 16;
+  } else if (host_.size() <= 255) {
+    address_type = 0x03;
+    address_length = host_.size();
+  } else {
+    Fail(kSocksAddressNotSupported);
+    return;
+  }
+
+  // Выбор метода без аутентификации и запрос CONNECT уходят одной записью.
+  // Буфер ответов вышестоящего прокси потом станет буфером ретрансляции.
+  download_ = worker_->buffers().Acquire();
+  uint8_t* request = (uint8_t*)download_;
+  size_t length = 0;
+  const uint8_t header[] = {0x05, 0x01, 0x00, 0x05, 0x01, 0x00, address_type};
+  memcpy(request, header, sizeof(header));
+  length += sizeof(header);
+  if (address_type == 0x03) {
+    request[length++] = (uint8_t)address_length;
+    memcpy(request + length, host_.data(), address_length);
+  } else {
+    memcpy(request + length, address, address_length);
+  }
+  length += address_length;
+  request[length++] = (uint8_t)(port_ >> 8);
+  request[length++] = (uint8_t)port_;
+
+  state_ = State::kUpstreamHandshake;
+  upstream_received_ = 0;
+  upstream_write_.type = IoOpType::kWrite;
+  upstream_write_.buffer = download_;
+  upstream_write_.length = length;
+  Submit(&upstream_write_);
+}
+
+void ProxyServer::Connection::ReadUpstreamReply(size_t total) {
+  // Читаем не больше ответа, чтобы не захватить данные назначения
+  upstream_read_.type = IoOpType::kRead;
+  upstream_read_.buffer = download_ + upstream_received_;
+  upstream_read_.length = total - upstream_received_;
+  Submit(&upstream_read_);
+}
+
+void ProxyServer::Connection::OnUpstreamReply() {
+  if (upstream_read_.error != 0 || upstream_read_.transferred == 0) {
+    Fail(kSocksGeneralFailure);
+    return;
+  }
+  upstream_received_ += upstream_read_.transferred;
+
+  // Выбор метода (2 байта), затем ответ: VER REP RSV ATYP адрес порт
+  const uint8_t* reply = (const uint8_t*)download_;
+  if (upstream_received_ >= 2 && (reply[0] != 0x05 || reply[1] != 0x00)) {
+    Fail(kSocksGeneralFailure);
+    return;
+  }
+  if (upstream_received_ < 7) {
+    ReadUpstreamReply(7);
+    return;
+  }
+  if (reply[2] != 0x05) {
+    Fail(kSocksGeneralFailure);
+    return;
+  }
+  if (reply[3] != kSocksSucceeded) {
+    // Код ошибки вышестоящего прокси передается клиенту как есть
+    Fail(reply[3]);
+    return;
+  }
+  size_t total;
+  switch (reply[5]) {
+    case 0x01:
+      total = 2 + 4 + 4 + 2;
+      break;
+    case 0x03:
+      total = 2 + 4 + 1 + (size_t)reply[6] + 2;
+      break;
+    case 0x04:
+      total = 2 + 4 + 16 + 2;
+      break;
+    default:
+      Fail(kSocksGeneralFailure);
+      return;
+  }
+  if (upstream_received_ < total) {
+    ReadUpstreamReply(total);
+    return;
+  }
+  ReplyConnected();
+}
+
+void ProxyServer::Connection::ReplyConnected() {
+  state_ = State::kReplying;
+  if (protocol_ == Protocol::kHttp) {
+    SendReply(kHttpEstablished, sizeof(kHttpEstablished) - 1, false);
+    return;
+  }
+  // Привязанный адрес не сообщаем: клиенты CONNECT его не используют
+  uint8_t reply[10] = {0x05, kSocksSucceeded, 0x00, 0x01, 0, 0, 0, 0, 0, 0};
+  SendReply(reply, sizeof(reply), false);
+}
+
+void ProxyServer::Connection::Fail(uint8_t socks_code) {
+  worker_->server()->failed_.fetch_add(1, std::memory_order_relaxed);
+  if (protocol_ == Protocol::kHttp) {
+    SendReply(kHttpBadGateway, sizeof(kHttpBadGateway) - 1, true);
+    return;
+  }
+  uint8_t reply[10] = {0x05, socks_code, 0x00, 0x01, 0, 0, 0, 0, 0, 0};
+  SendReply(reply, sizeof(reply), true);
+}
+
+void ProxyServer::Connection::SendReply(const void* data, size_t length, bool close_after) {
+  assert(length <= sizeof(reply_));
+  memcpy(reply_, data, length);
+  close_after_reply_ = close_after;
+  client_write_.buffer = reply_;
+  client_write_.length = length;
+  Submit(&client_write_);
+}
+
+void ProxyServer::Connection::StartRelay() {
+  state_ = State::kRelaying;
+
+  // Каналы нужны оба; без них - копирование через буферы пула
+  if (worker_->zero_copy() && worker_->pipes().Acquire(upload_pipe_)) {
+    splice_ = worker_->pipes().Acquire(download_pipe_);
+    if (!splice_) {
+      worker_->pipes().Release(upload_pipe_);
+    }
+  }
+  if (!splice_) {
+    if (download_ == nullptr) {
+      download_ = worker_->buffers().Acquire();
+    }
+  } else if (download_ != nullptr) {
+    worker_->buffers().Release(download_);
+    download_ = nullptr;
+  }
+
+  if (!SubmitUpstreamRead()) {
+    return;
+  }
+
+  // Данные, пришедшие вместе с запросом, уходят первыми и всегда из буфера
+  if (buffered_ > 0) {
+    TrafficCounters* counters = worker_->server()->counters_;
+    if (counters != nullptr) {
+      counters->AddPacket(TrafficDirection::kOutbound, buffered_);
+    }
+    upstream_write_.type = IoOpType::kWrite;
+    upstream_write_.buffer = upload_;
+    upstream_write_.length = buffered_;
+    buffered_ = 0;
+    Submit(&upstream_write_);
+    return;
+  }
+  if (splice_) {
+    worker_->buffers().Release(upload_);
+    upload_ = nullptr;
+  }
+  SubmitClientRead();
+}
+
+bool ProxyServer::Connection::SubmitClientRead() {
+  if (splice_) {
+    client_read_.type = IoOpType::kSpliceIn;
+    client_read_.pipe = upload_pipe_[1];
+    client_read_.length = PipePool::kPipeCapacity;
+  } else {
+    client_read_.type = IoOpType::kRead;
+    client_read_.buffer = upload_;
+    client_read_.length = kRelayBufferSize;
+  }
+  return Submit(&client_read_);
+}
+
+bool ProxyServer::Connection::SubmitUpstreamWrite(size_t length) {
+  if (splice_) {
+    upstream_write_.type = IoOpType::kSpliceOut;
+    upstream_write_.pipe = upload_pipe_[0];
+  } else {
+    upstream_write_.type = IoOpType::kWrite;
+    upstream_write_.buffer = upload_;
+  }
+  upstream_write_.length = length;
+  return Submit(&upstream_write_);
+}
+
+bool ProxyServer::Connection::SubmitUpstreamRead() {
+  if (splice_) {
+    upstream_read_.type = IoOpType::kSpliceIn;
+    upstream_read_.pipe = download_pipe_[1];
+    upstream_read_.length = PipePool::kPipeCapacity;
+  } else {
+    upstream_read_.type = IoOpType::kRead;
+    upstream_read_.buffer = download_;
+    upstream_read_.length = kRelayBufferSize;
+  }
+  return Submit(&upstream_read_);
+}
+
+bool ProxyServer::Connection::SubmitClientWrite(size_t length) {
+  if (splice_) {
+    client_write_.type = IoOpType::kSpliceOut;
+    client_write_.pipe = download_pipe_[0];
+  } else {
+    client_write_.type = IoOpType::kWrite;
+    client_write_.buffer = download_;
+  }
+  client_write_.length = length;
+  return Submit(&client_write_);
+}
+
+void ProxyServer::Connection::OnClientRead() {
+  if (client_read_.error != 0) {
+    Close();
+    return;
+  }
+  size_t received = client_read_.transferred;
+
+  if (state_ == State::kAssociated) {
+    // Закрытие управляющего соединения завершает ассоциацию
+    if (received == 0) {
+      Close();
+      return;
+    }
+    WatchAssociation();
+    return;
+  }
+  if (state_ != State::kRelaying) {
+    if (received == 0) {
+      Close();
+      return;
+    }
+    buffered_ += received;
+    ContinueHandshake();
+    return;
+  }
+
+  if (received == 0) {
+    // Клиент закончил передачу: передаем половинное закрытие дальше
+    client_eof_ = true;
+    ShutdownSocketSend(upstream_);
+    if (upstream_eof_) {
+      Close();
+    }
+    return;
+  }
+  TrafficCounters* counters = worker_->server()->counters_;
+  if (counters != nullptr) {
+    counters->AddPacket(TrafficDirection::kOutbound, received);
+  }
+  SubmitUpstreamWrite(received);
+}
+
+void ProxyServer::Connection::OnUpstreamWrite() {
+  if (upstream_write_.error != 0) {
+    Close();
+    return;
+  }
+  if (state_ == State::kUpstreamHandshake) {
+    ReadUpstreamReply(7);
+    return;
+  }
+  // После ранних данных буфер в режиме splice больше не нужен
+  if (splice_ && upload_ != nullptr) {
+    worker_->buffers().Release(upload_);
+    upload_ = nullptr;
+  }
+  SubmitClientRead();
+}
+
+void ProxyServer::Connection::OnUpstreamRead() {
+  if (state_ == State::kUpstreamHandshake) {
+    OnUpstreamReply();
+    return;
+  }
+  if (upstream_read_.error != 0) {
+    Close();
+    return;
+  }
+  size_t received = upstream_read_.transferred;
+  if (received == 0) {
+    upstream_eof_ = true;
+    ShutdownSocketSend(client_);
+    if (client_eof_) {
+      Close();
+    }
+    return;
+  }
+  TrafficCounters* counters = worker_->server()->counters_;
+  if (counters != nullptr) {
+    counters->AddPacket(TrafficDirection::kInbound, received);
+  }
+  SubmitClientWrite(received);
+}
+
+void ProxyServer::Connection::OnClientWrite() {
+  if (client_write_.error != 0) {
+    Close();
+    return;
+  }
+  switch (state_) {
+    case State::kRelaying:
+      SubmitUpstreamRead();
+      return;
+    case State::kReplying:
+      StartRelay();
+      return;
+    case State::kAssociated:
+      WatchAssociation();
+      return;
+    default:
+      // Ответ рукопожатия отправлен
+      if (close_after_reply_) {
+        Close();
+        return;
+      }
+      if (buffered_ > 0) {
+        ContinueHandshake();
+      } else {
+        ReadHandshake();
+      }
+      return;
+  }
+}
+
+void ProxyServer::Worker::Adopt(SocketHandle client) {
+  if (stopping_.load(std::memory_order_acquire) || !SetSocketNonBlocking(client) ||
+      !reactor_->Attach(client)) {
+    CloseSocketHandle(client);
+    return;
+  }
+  SetNoDelay(client);
+
+  Connection* connection;
+  if (!free_connections_.empty()) {
+    connection = free_connections_.back();
+    free_connections_.pop_back();
+  } else {
+    connections_.emplace_back(new Connection(this));
+    connection = connections_.back().get();
+  }
+  connections_in_use_++;
+  server_->accepted_.fetch_add(1, std::memory_order_relaxed);
+  server_->active_.fetch_add(1, std::memory_order_relaxed);
+  connection->Start(client);
+}
+
+void ProxyServer::Worker::Release(Connection* connection) {
+  free_connections_.push_back(connection);
+  connections_in_use_--;
+  server_->active_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ProxyServer::Worker::SubmitAccept(IoOp* op) {
+  op->type = IoOpType::kAccept;
+  op->socket = listener_;
+  op->handler = this;
+  if (reactor_->Submit(op)) {
+    pending_accepts_++;
+  }
+}
+
+void ProxyServer::Worker::OnIoComplete(IoOp* op) {
+  pending_accepts_--;
+  if (stopping_.load(std::memory_order_acquire)) {
+    if (op->accepted != kInvalidSocket) {
+      CloseSocketHandle(op->accepted);
+    }
+    return;
+  }
+  if (op->error == 0 && op->accepted != kInvalidSocket) {
+    server_->Dispatch(this, op->accepted);
+  }
+  SubmitAccept(op);
+}
+
+void ProxyServer::Worker::DrainInbox() {
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(inbox_mutex_);
+    tasks.swap(inbox_);
+  }
+  for (auto& task : tasks) {
+    task();
+  }
+}
+
+void ProxyServer::Worker::Loop() {
+  if (listener_ != kInvalidSocket) {
+    for (IoOp& op : accept_ops_) {
+      SubmitAccept(&op);
+    }
+  }
+
+  while (!stopping_.load(std::memory_order_acquire)) {
+    // Отложенные попытки соединения определяют, сколько можно ждать
+    reactor_->Poll(timers_.RunDue(kPollTimeoutMs));
+    DrainInbox();
+  }
+
+  Shutdown();
+}
+
+void ProxyServer::Worker::Shutdown() {
+  if (listener_ != kInvalidSocket) {
+    reactor_->Close(listener_);
+    listener_ = kInvalidSocket;
+  }
+  for (auto& connection : connections_) {
+    connection->Close();
+  }
+
+  // Дожидаемся отмененных операций: память IoOp должна пережить их
+  auto deadline = std::chrono::steady_clock::now() + kShutdownTimeout;
+  while ((connections_in_use_ > 0 || pending_accepts_ > 0) &&
+         std::chrono::steady_clock::now() < deadline) {
+    reactor_->Poll(10);
+    DrainInbox();
+  }
+  if (connections_in_use_ > 0) {
+    LOG_WARNING("Прокси: %zu соединений не завершились при остановке", connections_in_use_);
+  }
+}
+
+ProxyServer::ProxyServer(TrafficCounters* counters) : counters_(counters) {}
+
+ProxyServer::~ProxyServer() {
+  Stop();
+}
+
+SocketHandle ProxyServer::OpenListener(const sockaddr_storage& address, int address_length,
+                                       bool reuse_port) {
+  SocketHandle listener = socket(address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+  if (listener == kInvalidSocket) {
+    return kInvalidSocket;
+  }
+  int enable = 1;
+#if defined(_WIN32)
+  setsockopt(listener, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&enable,
+             sizeof(enable));
+#else
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+#endif
+#if defined(SO_REUSEPORT)
+  if (reuse_port) {
+    setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, (const char*)&enable, sizeof(enable));
+  }
+#else
+  (void)reuse_port;
+#endif
+  if (bind(listener, (const sockaddr*)&address, address_length) != 0 ||
+      listen(listener, SOMAXCONN) != 0 || !SetSocketNonBlocking(listener)) {
+    CloseSocketHandle(listener);
+    return kInvalidSocket;
+  }
+  return listener;
+}
+
+bool ProxyServer::Start(const Options& options) {
+  if (running_.exchange(true, std::memory_order_acq_rel)) {
+    return false;
+  }
+
+  sockaddr_storage address;
+  int address_length;
+  if (!ParseIpLiteral(options.listen_address, options.port, &address, &address_length)) {
+    LOG_ERROR("Прокси: неверный адрес %s", options.listen_address.c_str());
+    running_.store(false, std::memory_order_release);
+    return false;
+  }
+
+  size_t worker_count = options.worker_count;
+  if (worker_count == 0) {
+    worker_count = std::thread::hardware_concurrency();
+  }
+  worker_count = worker_count == 0 ? 1 : (worker_count > kMaxWorkers ? kMaxWorkers
+                                                                     : worker_count);
+
+  resolver_.reset(new HostResolver(options.resolver_threads == 0 ? 1 : options.resolver_threads,
+                                   options.dns_cache));
+  fake_ips_ = options.fake_ips;
+  route_ = options.route;
+  upstream_address_length_ = 0;
+  if (options.upstream_port != 0 &&
+      !ParseIpLiteral("127.0.0.1", options.upstream_port, &upstream_address_,
+                      &upstream_address_length_)) {
+    upstream_address_length_ = 0;
+  }
+
+  if (options.udp_relay) {
+    udp_relay_.reset(new UdpRelay(
+        counters_, [this](const std::string& host, uint16_t port,
+                          UdpRelay::ResolveCallback callback) {
+          resolver_->Resolve(host, port, std::move(callback));
+        }));
+    udp_relay_->set_fake_ips(fake_ips_);
+    if (!udp_relay_->Start(address, address_length, options.udp_idle_timeout_ms)) {
+      LOG_WARNING("Прокси: UDP-ретранслятор недоступен");
+      udp_relay_.reset();
+    }
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < worker_count && ok; i++) {
+    std::unique_ptr<Reactor> reactor = Reactor::Create(options.reactor);
+    if (!reactor) {
+      ok = false;
+      break;
+    }
+    workers_.emplace_back(new Worker(this, std::move(reactor), options.zero_copy));
+
+    // Без распределения ядром слушает только первый поток
+    if (i > 0 && !kShardedAccept) {
+      continue;
+    }
+    SocketHandle listener = OpenListener(address, address_length, kShardedAccept);
+    if (listener == kInvalidSocket || !workers_.back()->SetListener(listener)) {
+      if (listener != kInvalidSocket) {
+        CloseSocketHandle(listener);
+      }
+      ok = false;
+      break;
+    }
+    // Порт 0: остальные сокеты привязываются к выбранному ядром порту
+    if (i == 0) {
+      socklen_t length = sizeof(address);
+      getsockname(listener, (sockaddr*)&address, &length);
+      port_ = ntohs(address.ss_family == AF_INET6 ? ((sockaddr_in6*)&address)->sin6_port
+                                                  : ((sockaddr_in*)&address)->sin_port);
+    }
+  }
+
+  if (!ok) {
+    LOG_ERROR("Прокси: не удалось открыть порт %s:%u", options.listen_address.c_str(),
+              options.port);
+    if (udp_relay_) {
+      resolver_->Shutdown();
+      udp_relay_->Stop();
+    }
+    workers_.clear();
+    resolver_.reset();
+    udp_relay_.reset();
+    running_.store(false, std::memory_order_release);
+    return false;
+  }
+
+  for (auto& worker : workers_) {
+    worker->Start();
+  }
+  LOG_INFO("Прокси запущен на %s:%u (%zu потоков, %s%s)", options.listen_address.c_str(),
+           port_, workers_.size(), workers_[0]->reactor()->name(),
+           workers_[0]->zero_copy() ? ", splice" : "");
+  if (udp_relay_) {
+    LOG_INFO("UDP-ретранслятор на порту %u%s%s", udp_relay_->port(),
+             udp_relay_->gso() ? ", GSO" : "", udp_relay_->gro() ? ", GRO" : "");
+  }
+  return true;
+}
+
+void ProxyServer::Dispatch(Worker* acceptor, SocketHandle client) {
+  if (kShardedAccept || workers_.size() == 1) {
+    acceptor->Adopt(client);
+    return;
+  }
+  Worker* target =
+      workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()].get();
+  if (target == acceptor) {
+    acceptor->Adopt(client);
+  } else {
+    target->Post([target, client] { target->Adopt(client); });
+  }
+}
+
+void ProxyServer::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  // Сначала резолвер: его обратные вызовы обращаются к потокам реакторов.
+  // Сам объект живет до остановки потоков, которые еще могут к нему обратиться
+  resolver_->Shutdown();
+  if (udp_relay_) {
+    udp_relay_->Stop();
+  }
+  for (auto& worker : workers_) {
+    worker->RequestStop();
+  }
+  for (auto& worker : workers_) {
+    worker->Join();
+  }
+  workers_.clear();
+  resolver_.reset();
+  udp_relay_.reset();
+  port_ = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef RUNNER_PROXY_SERVER_H_
+#define RUNNER_PROXY_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fake_ip_table.h"
+#include "happy_eyeballs.h"
+#include "host_resolver.h"
+#include "reactor.h"
+#include "relay_buffers.h"
+#include "route_action.h"
+#include "traffic_counters.h"
+#include "udp_relay.h"
+
+// Локальный прокси-сервер SOCKS5 (CONNECT, UDP ASSOCIATE) и HTTP CONNECT.
+//
+// Каждый рабочий поток крутит собственный Reactor. Где ядро умеет
+// распределять входящие соединения (SO_REUSEPORT в Linux), у каждого потока
+// свой слушающий сокет на общем порту; иначе (Windows) принимает первый
+// поток и раздает сокеты остальным по кругу. Объекты соединений и буферы
+// переиспользуются из пулов потока, поэтому установка соединения не
+// выделяет память. Где реактор поддерживает splice() (Linux), полезная
+// нагрузка идет сокет -> канал -> сокет и не копируется в память процесса;
+// иначе - через буферы фиксированного размера. К назначениям с адресами
+// обоих семейств соединение устанавливается гонкой Happy Eyeballs. Переданные байты в обоих
+// режимах учитываются в TrafficCounters. Датаграммы UDP ASSOCIATE
+// ретранслирует отдельный поток UdpRelay.
+//
+// Перед ядром VPN прокси выбирает маршрут каждого соединения: route()
+// решает по назначению, block получает отказ, direct соединяется напрямую,
+// остальное уходит CONNECT-запросом в вышестоящий SOCKS5 на loopback.
+// Решение принимается при установке соединения, поэтому смена правил
+// действует на новые соединения без перезапуска прокси.
+class ProxyServer {
+ public:
+  // Маршрут соединения; вызывается из потоков реакторов
+  using RouteCallback = std::function<RouteAction(const std::string& host, uint16_t port)>;
+
+  struct Options {
+    std::string listen_address = "127.0.0.1";
+    uint16_t port = 10808;      // 0 - выбрать свободный порт
+    size_t worker_count = 0;    // 0 - по числу ядер, но не больше kMaxWorkers
+    size_t resolver_threads = 2;
+    DnsCache* dns_cache = nullptr;  // общий кеш имен; должен пережить прокси
+    // Адреса fake-IP DNS: назначение восстанавливается по имени
+    const FakeIpTable* fake_ips = nullptr;
+    bool zero_copy = true;      // splice() через канал, где реактор умеет
+    ReactorKind reactor = ReactorKind::kDefault;
+    bool udp_relay = true;      // поддержка UDP ASSOCIATE
+    uint32_t udp_idle_timeout_ms = 60 * 1000;
+    RouteCallback route;        // пусто - все соединения по умолчанию
+    // Порт SOCKS5 на 127.0.0.1 для соединений, кроме direct (0 - напрямую)
+    uint16_t upstream_port = 0;
+  };
+
+  static constexpr size_t kMaxWorkers = 8;
+
+  // |counters| может быть nullptr, если учет трафика не нужен.
+  explicit ProxyServer(TrafficCounters* counters);
+  ~ProxyServer();
+
+  ProxyServer(const ProxyServer&) = delete;
+  ProxyServer& operator=(const ProxyServer&) = delete;
+
+  bool Start(const Options& options);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  // Разрешить или запретить новые UDP-ассоциации (действующие доживают)
+  void SetUdpEnabled(bool enabled) { udp_enabled_.store(enabled, std::memory_order_relaxed); }
+
+  // Фактический порт (после Start с port = 0)
+  uint16_t port() const { return port_; }
+
+  uint64_t accepted_count() const { return accepted_.load(std::memory_order_relaxed); }
+  uint64_t active_count() const { return active_.load(std::memory_order_relaxed); }
+  uint64_t failed_count() const { return failed_.load(std::memory_order_relaxed); }
+  uint64_t blocked_count() const { return blocked_.load(std::memory_order_relaxed); }
+
+ private:
+  class Worker;
+  class Connection;
+  friend class Connection;
+
+  SocketHandle OpenListener(const sockaddr_storage& address, int address_length,
+                            bool reuse_port);
+  void Dispatch(Worker* acceptor, SocketHandle client);
+
+  TrafficCounters* counters_;
+  const FakeIpTable* fake_ips_ = nullptr;
+  RouteCallback route_;
+  sockaddr_storage upstream_address_ = {};
+  int upstream_address_length_ = 0;  // 0 - вышестоящего прокси нет
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::unique_ptr<HostResolver> resolver_;
+  AddressFamilyCache family_cache_;
+  std::unique_ptr<UdpRelay> udp_relay_;
+  std::atomic<bool> udp_enabled_{true};
+  std::atomic<bool> running_{false};
+  std::atomic<size_t> next_worker_{0};
+  uint16_t port_ = 0;
+
+  std::atomic<uint64_t> accepted_{0};
+  std::atomic<uint64_t> active_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::atomic<uint64_t> blocked_{0};
+};
+
+#endif  // RUNNER_PROXY_SERVER_H_
@@ -0,0 +1,399 @@
+#include "quic_crypto.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr uint32_t kSha256Init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+constexpr uint32_t kSha256Rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+    0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+    0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+    0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2};
+
+constexpr uint8_t kAesSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab,
+    0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4,
+    0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71,
+    0xd8, 0x31, 0x15, 0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6,
+    0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb,
+    0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf, 0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45,
+    0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44,
+    0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73, 0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a,
+    0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49,
+    0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08, 0xba, 0x78, 0x25,
+    0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e,
+    0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1,
+    0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb,
+    0x16};
+
+uint32_t RotateRight(uint32_t value, int bits) { return (value >> bits) | (value << (32 - bits)); }
+
+uint32_t ReadU32(const uint8_t* data) {
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) |
+         data[3];
+}
+
+void WriteU32(uint8_t* data, uint32_t value) {
+  data[0] = (uint8_t)(value >> 24);
+  data[1] = (uint8_t)(value >> 16);
+  data[2] = (uint8_t)(value >> 8);
+  data[3] = (uint8_t)value;
+}
+
+uint8_t Xtime(uint8_t value) { return (uint8_t)((value << 1) ^ ((value & 0x80) ? 0x1b : 0)); }
+
+// Таблица раунда AES: SubBytes и MixColumns для байта первой строки;
+// остальные строки - ее циклические сдвиги
+struct AesTable {
+  uint32_t round[256];
+
+  AesTable() {
+    for (int i = 0; i < 256; i++) {
+      uint8_t s = kAesSbox[i];
+      uint8_t twice = Xtime(s);
+      round[i] = ((uint32_t)twice << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) |
+                 (uint8_t)(twice ^ s);
+    }
+  }
+};
+
+const AesTable& AesRoundTable() {
+  static const AesTable table;
+  return table;
+}
+
+uint32_t SubWord(uint32_t word) {
+  return ((uint32_t)kAesSbox[word >> 24] << 24) | ((uint32_t)kAesSbox[(word >> 16) & 0xff] << 16) |
+         ((uint32_t)kAesSbox[(word >> 8) & 0xff] << 8) | kAesSbox[word & 0xff];
+}
+
+// Умножение на H в GF(2^128) для GHASH (NIST SP 800-38D, 6.3) по
+// 4-битным таблицам кратных H (метод Шоупа)
+class GhashKey {
+ public:
+  explicit GhashKey(const uint8_t h[16]) {
+    uint64_t high = ReadU64(h);
+    uint64_t low = ReadU64(h + 8);
+    high_[0] = 0;
+    low_[0] = 0;
+    high_[8] = high;
+    low_[8] = low;
+    for (int i = 4; i > 0; i >>= 1) {
+      uint64_t carry = (low & 1) ? 0xe100000000000000ull : 0;
+      low = (high << 63) | (low >> 1);
+      high = (high >> 1) ^ carry;
+      high_[i] = high;
+      low_[i] = low;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+      for (int j = 1; j < i; j++) {
+        high_[i + j] = high_[i] ^ high_[j];
+        low_[i + j] = low_[i] ^ low_[j];
+      }
+    }
+  }
+
+  void Multiply(uint8_t x[16]) const {
+    // Редукция четырех выдвинутых битов
+    static const uint16_t kReduce[16] = {0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0,
+                                         0x48c0, 0x54e0, 0xe100, 0xfd20, 0xd940, 0xc560,
+                                         0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+    uint64_t high = high_[x[15] & 0x0f];
+    uint64_t low = low_[x[15] & 0x0f];
+    for (int i = 15; i >= 0; i--) {
+      int nibbles[2] = {x[i] & 0x0f, x[i] >> 4};
+      for (int k = i == 15 ? 1 : 0; k < 2; k++) {
+        uint8_t shifted = (uint8_t)(low & 0x0f);
+        low = (high << 60) | (low >> 4);
+        high = (high >> 4) ^ ((uint64_t)kReduce[shifted] << 48);
+        high ^= high_[nibbles[k]];
+        low ^= low_[nibbles[k]];
+      }
+    }
+    WriteU64(x, high);
+    WriteU64(x + 8, low);
+  }
+
+  void Update(uint8_t state[16], const uint8_t* data, size_t length) const {
+    while (length > 0) {
+      size_t chunk = length < 16 ? length : 16;
+      for (size_t i = 0; i < chunk; i++) {
+        state[i] ^= data[i];
+      }
+      Multiply(state);
+      data += chunk;
+      length -= chunk;
+    }
+  }
+
+ private:
+  static uint64_t ReadU64(const uint8_t* data) {
+    return ((uint64_t)ReadU32(data) << 32) | ReadU32(data + 4);
+  }
+
+  static void WriteU64(uint8_t* data, uint64_t value) {
+    WriteU32(data, (uint32_t)(value >> 32));
+    WriteU32(data + 4, (uint32_t)value);
+  }
+
+  uint64_t high_[16];
+  uint64_t low_[16];
+};
+
+void IncrementCounter(uint8_t counter[16]) {
+  for (int i = 15; i >= 12; i--) {
+    if (++counter[i] != 0) {
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+Sha256::Sha256() { memcpy(state_, kSha256Init, sizeof(state_)); }
+
+void Sha256::Update(const uint8_t* data, size_t length) {
+  total_ += length;
+  if (buffered_ > 0) {
+    size_t take = kBlockSize - buffered_ < length ? kBlockSize - buffered_ : length;
+    memcpy(buffer_ + buffered_, data, take);
+    buffered_ += take;
+    data += take;
+    length -= take;
+    if (buffered_ < kBlockSize) {
+      return;
+    }
+    Transform(buffer_);
+    buffered_ = 0;
+  }
+  for (; length >= kBlockSize; data += kBlockSize, length -= kBlockSize) {
+    Transform(data);
+  }
+  memcpy(buffer_, data, length);
+  buffered_ = length;
+}
+
+void Sha256::Final(uint8_t digest[kDigestSize]) {
+  uint64_t bits = total_ * 8;
+  uint8_t padding[kBlockSize * 2] = {0x80};
+  size_t padding_length = (buffered_ < 56 ? 56 : 120) - buffered_;
+  for (int i = 0; i < 8; i++) {
+    padding[padding_length + i] = (uint8_t)(bits >> (56 - 8 * i));
+  }
+  Update(padding, padding_length + 8);
+  for (int i = 0; i < 8; i++) {
+    WriteU32(digest + 4 * i, state_[i]);
+  }
+}
+
+void Sha256::Transform(const uint8_t block[kBlockSize]) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ReadU32(block + 4 * i);
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+  uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+    uint32_t choice = (e & f) ^ (~e & g);
+    uint32_t t1 = h + s1 + choice + kSha256Rounds[i] + w[i];
+    uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+    uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + majority;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+  state_[4] += e;
+  state_[5] += f;
+  state_[6] += g;
+  state_[7] += h;
+}
+
+void HmacSha256(const uint8_t* key, size_t key_length, const uint8_t* data, size_t length,
+                uint8_t mac[Sha256::kDigestSize]) {
+  uint8_t block[Sha256::kBlockSize] = {};
+  if (key_length > Sha256::kBlockSize) {
+    Sha256 hash;
+    hash.Update(key, key_length);
+    hash.Final(block);
+  } else {
+    memcpy(block, key, key_length);
+  }
+
+  uint8_t pad[Sha256::kBlockSize];
+  for (size_t i = 0; i < Sha256::kBlockSize; i++) {
+    pad[i] = block[i] ^ 0x36;
+  }
+  uint8_t inner[Sha256::kDigestSize];
+  Sha256 inner_hash;
+  inner_hash.Update(pad, sizeof(pad));
+  inner_hash.Update(data, length);
+  inner_hash.Final(inner);
+
+  for (size_t i = 0; i < Sha256::kBlockSize; i++) {
+    pad[i] = block[i] ^ 0x5c;
+  }
+  Sha256 outer_hash;
+  outer_hash.Update(pad, sizeof(pad));
+  outer_hash.Update(inner, sizeof(inner));
+  outer_hash.Final(mac);
+}
+
+void HkdfExtract(const uint8_t* salt, size_t salt_length, const uint8_t* key, size_t key_length,
+                 uint8_t secret[Sha256::kDigestSize]) {
+  HmacSha256(salt, salt_length, key, key_length, secret);
+}
+
+void HkdfExpandLabel(const uint8_t secret[Sha256::kDigestSize], const char* label, uint8_t* out,
+                     size_t length) {
+  // HkdfLabel: длина, "tls13 " + метка, пустой контекст; затем счетчик
+  // блока HKDF-Expand (нужен только первый)
+  uint8_t info[4 + 6 + 255 + 2];
+  size_t label_length = strlen(label);
+  if (label_length > 255 - 6) {
+    label_length = 255 - 6;
+  }
+  size_t size = 0;
+  info[size++] = (uint8_t)(length >> 8);
+  info[size++] = (uint8_t)length;
+  info[size++] = (uint8_t)(6 + label_length);
+  memcpy(info + size, "tls13 ", 6);
+  size += 6;
+  memcpy(info + size, label, label_length);
+  size += label_length;
+  info[size++] = 0;
+  info[size++] = 1;
+
+  uint8_t block[Sha256::kDigestSize];
+  HmacSha256(secret, Sha256::kDigestSize, info, size, block);
+  memcpy(out, block, length < sizeof(block) ? length : sizeof(block));
+}
+
+Aes128::Aes128(const uint8_t key[16]) {
+  for (int i = 0; i < 4; i++) {
+    round_keys_[i] = ReadU32(key + 4 * i);
+  }
+  uint8_t round_constant = 1;
+  for (int i = 4; i < 44; i++) {
+    uint32_t word = round_keys_[i - 1];
+    if (i % 4 == 0) {
+      word = SubWord((word << 8) | (word >> 24)) ^ ((uint32_t)round_constant << 24);
+      round_constant = Xtime(round_constant);
+    }
+    round_keys_[i] = round_keys_[i - 4] ^ word;
+  }
+}
+
+void Aes128::EncryptBlock(const uint8_t in[kBlockSize], uint8_t out[kBlockSize]) const {
+  const uint32_t* table = AesRoundTable().round;
+  const uint32_t* keys = round_keys_;
+  // Столбцы состояния
+  uint32_t s0 = ReadU32(in) ^ keys[0];
+  uint32_t s1 = ReadU32(in + 4) ^ keys[1];
+  uint32_t s2 = ReadU32(in + 8) ^ keys[2];
+  uint32_t s3 = ReadU32(in + 12) ^ keys[3];
+  for (int round = 1; round < 10; round++) {
+    keys += 4;
+    uint32_t t0 = table[s0 >> 24] ^ RotateRight(table[(s1 >> 16) & 0xff], 8) ^
+                  RotateRight(table[(s2 >> 8) & 0xff], 16) ^ RotateRight(table[s3 & 0xff], 24) ^
+                  keys[0];
+    uint32_t t1 = table[s1 >> 24] ^ RotateRight(table[(s2 >> 16) & 0xff], 8) ^
+                  RotateRight(table[(s3 >> 8) & 0xff], 16) ^ RotateRight(table[s0 & 0xff], 24) ^
+                  keys[1];
+    uint32_t t2 = table[s2 >> 24] ^ RotateRight(table[(s3 >> 16) & 0xff], 8) ^
+                  RotateRight(table[(s0 >> 8) & 0xff], 16) ^ RotateRight(table[s1 & 0xff], 24) ^
+                  keys[2];
+    uint32_t t3 = table[s3 >> 24] ^ RotateRight(table[(s0 >> 16) & 0xff], 8) ^
+                  RotateRight(table[(s1 >> 8) & 0xff], 16) ^ RotateRight(table[s2 & 0xff], 24) ^
+                  keys[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+  // Последний раунд без MixColumns
+  keys += 4;
+  uint32_t columns[4] = {s0, s1, s2, s3};
+  for (int i = 0; i < 4; i++) {
+    uint32_t word = ((uint32_t)kAesSbox[columns[i] >> 24] << 24) |
+                    ((uint32_t)kAesSbox[(columns[(i + 1) & 3] >> 16) & 0xff] << 16) |
+                    ((uint32_t)kAesSbox[(columns[(i + 2) & 3] >> 8) & 0xff] << 8) |
+                    kAesSbox[columns[(i + 3) & 3] & 0xff];
+    WriteU32(out + 4 * i, word ^ keys[i]);
+  }
+}
+
+bool Aes128GcmOpen(const uint8_t key[16], const uint8_t nonce[12], const uint8_t* aad,
+                   size_t aad_length, const uint8_t* sealed, size_t sealed_length,
+                   uint8_t* plaintext) {
+  constexpr size_t kTagSize = 16;
+  if (sealed_length < kTagSize) {
+    return false;
+  }
+  size_t length = sealed_length - kTagSize;
+  Aes128 aes(key);
+
+  uint8_t h[16] = {};
+  aes.EncryptBlock(h, h);
+  GhashKey ghash(h);
+  uint8_t state[16] = {};
+  ghash.Update(state, aad, aad_length);
+  ghash.Update(state, sealed, length);
+  uint8_t lengths[16];
+  WriteU32(lengths, (uint32_t)((uint64_t)aad_length * 8 >> 32));
+  WriteU32(lengths + 4, (uint32_t)((uint64_t)aad_length * 8));
+  WriteU32(lengths + 8, (uint32_t)((uint64_t)length * 8 >> 32));
+  WriteU32(lengths + 12, (uint32_t)((uint64_t)length * 8));
+  ghash.Update(state, lengths, sizeof(lengths));
+
+  uint8_t counter[16];
+  memcpy(counter, nonce, 12);
+  WriteU32(counter + 12, 1);
+  uint8_t mask[16];
+  aes.EncryptBlock(counter, mask);
+  uint8_t difference = 0;
+  for (size_t i = 0; i < kTagSize; i++) {
+    difference |= (uint8_t)(state[i] ^ mask[i] ^ sealed[length + i]);
+  }
+  if (difference != 0) {
+    return false;
+  }
+
+  for (size_t offset = 0; offset < length; offset += 16) {
+    IncrementCounter(counter);
+    aes.EncryptBlock(counter, mask);
+    size_t chunk = length - offset < 16 ? length - offset : 16;
+    for (size_t i = 0; i < chunk; i++) {
+      plaintext[offset + i] = sealed[offset + i] ^ mask[i];
+    }
+  }
+  return true;
+}
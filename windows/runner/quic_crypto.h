@@ -0,0 +1,63 @@
+#ifndef RUNNER_QUIC_CRYPTO_H_
+#define RUNNER_QUIC_CRYPTO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Примитивы для снятия защиты с пакетов QUIC Initial (RFC 9001, раздел 5):
+// SHA-256, HMAC, HKDF, AES-128 и AES-128-GCM.
+//
+// Ключи Initial выводятся из открытого Destination Connection ID, так что
+// секретов здесь нет, и реализация не защищена от атак по времени.
+// Рассчитана на разбор первых пакетов соединения, а не на поток данных.
+
+class Sha256 {
+ public:
+  static constexpr size_t kDigestSize = 32;
+  static constexpr size_t kBlockSize = 64;
+
+  Sha256();
+
+  void Update(const uint8_t* data, size_t length);
+  void Final(uint8_t digest[kDigestSize]);
+
+ private:
+  void Transform(const uint8_t block[kBlockSize]);
+
+  uint32_t state_[8];
+  uint8_t buffer_[kBlockSize];
+  size_t buffered_ = 0;
+  uint64_t total_ = 0;
+};
+
+void HmacSha256(const uint8_t* key, size_t key_length, const uint8_t* data, size_t length,
+                uint8_t mac[Sha256::kDigestSize]);
+
+void HkdfExtract(const uint8_t* salt, size_t salt_length, const uint8_t* key, size_t key_length,
+                 uint8_t secret[Sha256::kDigestSize]);
+
+// HKDF-Expand-Label из TLS 1.3 (RFC 8446, 7.1) с пустым контекстом;
+// |length| не больше Sha256::kDigestSize
+void HkdfExpandLabel(const uint8_t secret[Sha256::kDigestSize], const char* label, uint8_t* out,
+                     size_t length);
+
+class Aes128 {
+ public:
+  static constexpr size_t kBlockSize = 16;
+
+  explicit Aes128(const uint8_t key[16]);
+
+  void EncryptBlock(const uint8_t in[kBlockSize], uint8_t out[kBlockSize]) const;
+
+ private:
+  uint32_t round_keys_[44];
+};
+
+// Расшифровать AES-128-GCM с 12-байтовым nonce и проверить тег (последние
+// 16 байт |sealed|). |plaintext| вмещает |sealed_length| - 16 байт и может
+// совпадать с |sealed|.
+bool Aes128GcmOpen(const uint8_t key[16], const uint8_t nonce[12], const uint8_t* aad,
+                   size_t aad_length, const uint8_t* sealed, size_t sealed_length,
+                   uint8_t* plaintext);
+
+#endif  // RUNNER_QUIC_CRYPTO_H_
@@ -0,0 +1,132 @@
+#include "ranking_helper.h"
+#include <string.h>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json_reader.h"
+#include "native_log.h"
+#include "server_ranker.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Оценка серверов подписки (одна на процесс)
+static std::mutex g_rankerMutex;
+static ServerRanker g_ranker;
+
+// Разобрать список серверов из JSON
+static bool ParseTargets(const char* json, std::vector<RankTarget>* targets) {
+    JsonReader reader(json, strlen(json));
+    if (!reader.BeginArray()) {
+        return false;
+    }
+    while (reader.NextElement()) {
+        if (!reader.BeginObject()) {
+            return false;
+        }
+        RankTarget target;
+        std::string key;
+        while (reader.NextKey(&key)) {
+            if (key == "address") {
+                reader.ReadString(&target.host);
+            } else if (key == "port") {
+                double port = 0;
+                reader.ReadNumber(&port);
+                target.port = (port > 0 && port <= 65535) ? (uint16_t)port : 0;
+            } else if (key == "tls") {
+                reader.ReadBool(&target.tls);
+            } else if (key == "sni") {
+                reader.ReadString(&target.sni);
+            } else {
+                reader.Skip();
+            }
+        }
+        if (reader.failed()) {
+            return false;
+        }
+        targets->push_back(std::move(target));
+    }
+    return !reader.failed();
+}
+
+static int32_t ClampMicroseconds(uint32_t value) {
+    return value > (uint32_t)INT32_MAX ? INT32_MAX : (int32_t)value;
+}
+
+static void FillRecord(const RankResult& result, int32_t* record) {
+    record[RANK_INDEX] = (int32_t)result.index;
+    record[RANK_SCORE] =
+        result.score == RankResult::kUnreachable ? -1 : ClampMicroseconds(result.score);
+    record[RANK_CONNECT] = ClampMicroseconds(result.connect_us);
+    record[RANK_JITTER] = ClampMicroseconds(result.jitter_us);
+    record[RANK_TLS] = ClampMicroseconds(result.tls_us);
+    record[RANK_SUCCESSES] = (int32_t)result.successes;
+    record[RANK_ATTEMPTS] = (int32_t)result.attempts;
+}
+
+// Начать оценку серверов
+EXPORT int32_t RankServersStart(const char* targetsJson, int32_t maxInFlight,
+                                int32_t attempts, int32_t timeoutMs,
+                                RankResultCallback callback) {
+    if (targetsJson == NULL) {
+        return 0;
+    }
+    
+    std::vector<RankTarget> targets;
+    if (!ParseTargets(targetsJson, &targets)) {
+        LOG_ERROR("Ошибка разбора списка серверов для оценки");
+        return 0;
+    }
+    
+    ServerRanker::Options options;
+    if (maxInFlight > 0) options.max_in_flight = (size_t)maxInFlight;
+    if (attempts > 0) options.attempts = (uint32_t)attempts;
+    if (timeoutMs > 0) options.timeout_ms = (uint32_t)timeoutMs;
+    
+    ServerRanker::ResultCallback onResult;
+    if (callback != NULL) {
+        onResult = [callback](const RankResult& result) {
+            int32_t record[RANK_RECORD_FIELDS];
+            FillRecord(result, record);
+            callback(record);
+        };
+    }
+    
+    std::lock_guard<std::mutex> lock(g_rankerMutex);
+    if (!g_ranker.Start(std::move(targets), options, std::move(onResult))) {
+        LOG_ERROR("Ошибка запуска оценки серверов");
+        return 0;
+    }
+    return 1;
+}
+
+// Прервать оценку
+EXPORT int32_t RankServersCancel() {
+    std::lock_guard<std::mutex> lock(g_rankerMutex);
+    g_ranker.Cancel();
+    return 1;
+}
+
+// Прогресс оценки
+EXPORT int32_t RankServersProgress(int32_t* completed, int32_t* total) {
+    if (completed) *completed = (int32_t)g_ranker.completed();
+    if (total) *total = (int32_t)g_ranker.total();
+    return g_ranker.IsRunning() ? 1 : 0;
+}
+
+// Готовые результаты, лучшие первыми
+EXPORT int32_t RankServersResults(int32_t* records, int32_t capacity) {
+    if (records == NULL || capacity <= 0) {
+        return 0;
+    }
+    
+    std::vector<RankResult> results = g_ranker.Results();
+    size_t count = results.size() < (size_t)capacity ? results.size() : (size_t)capacity;
+    for (size_t i = 0; i < count; i++) {
+        FillRecord(results[i], records + i * RANK_RECORD_FIELDS);
+    }
+    return (int32_t)count;
+}
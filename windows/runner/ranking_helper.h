@@ -0,0 +1,48 @@
+#ifndef RANKING_HELPER_H
+#define RANKING_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Запись результата оценки сервера: RANK_RECORD_FIELDS чисел int32 подряд.
+// Время - в микросекундах; score < 0 - сервер недоступен.
+#define RANK_RECORD_FIELDS 7
+enum RankRecordField {
+    RANK_INDEX = 0,      // номер сервера в исходном списке
+    RANK_SCORE = 1,      // меньше - лучше
+    RANK_CONNECT = 2,    // медиана времени соединения
+    RANK_JITTER = 3,     // разброс времени соединения
+    RANK_TLS = 4,        // медиана времени TLS-рукопожатия (0 - не мерялось)
+    RANK_SUCCESSES = 5,
+    RANK_ATTEMPTS = 6,
+};
+
+// Вызывается из потока оценки по готовности каждого сервера
+typedef void (*RankResultCallback)(const int32_t* record);
+
+// Начать оценку серверов. targetsJson - массив объектов
+// {"address": "...", "port": 443, "tls": true, "sni": "..."}.
+// Нулевые параметры - значения по умолчанию, callback может быть NULL.
+// Прежняя оценка прерывается.
+__declspec(dllexport) int32_t RankServersStart(const char* targetsJson, int32_t maxInFlight,
+                                               int32_t attempts, int32_t timeoutMs,
+                                               RankResultCallback callback);
+
+// Прервать оценку (готовые результаты сохраняются)
+__declspec(dllexport) int32_t RankServersCancel();
+
+// Прогресс оценки; возвращает 1, пока оценка идет
+__declspec(dllexport) int32_t RankServersProgress(int32_t* completed, int32_t* total);
+
+// Готовые результаты, лучшие первыми: не больше capacity записей в records
+// (capacity * RANK_RECORD_FIELDS чисел). Возвращает число записей.
+__declspec(dllexport) int32_t RankServersResults(int32_t* records, int32_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RANKING_HELPER_H
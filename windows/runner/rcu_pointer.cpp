@@ -0,0 +1,47 @@
+#include "rcu_pointer.h"
+
+EpochDomain::EpochDomain() = default;
+
+size_t EpochDomain::ThreadSlot() {
+  static std::atomic<size_t> next_slot{0};
+  thread_local size_t slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed) & (kSlotCount - 1);
+  return slot;
+}
+
+size_t EpochDomain::Enter() {
+  size_t slot = ThreadSlot();
+  std::atomic<uint64_t>& word = slots_[slot].word;
+  uint64_t current = word.load(std::memory_order_relaxed);
+  for (;;) {
+    // Первый читатель слота записывает эпоху, остальные наследуют более раннюю
+    uint64_t epoch = (current & kCountMask) == 0
+                         ? epoch_.load(std::memory_order_seq_cst)
+                         : current >> kCountBits;
+    uint64_t next = (epoch << kCountBits) | ((current & kCountMask) + 1);
+    if (word.compare_exchange_weak(current, next, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed)) {
+      return slot;
+    }
+  }
+}
+
+void EpochDomain::Exit(size_t slot) {
+  // Эпоха остается в слове, но без читателей не учитывается
+  slots_[slot].word.fetch_sub(1, std::memory_order_release);
+}
+
+uint64_t EpochDomain::Advance() {
+  return epoch_.fetch_add(1, std::memory_order_seq_cst);
+}
+
+uint64_t EpochDomain::MinActiveEpoch() const {
+  uint64_t min_epoch = kNoReaders;
+  for (const Slot& slot : slots_) {
+    uint64_t word = slot.word.load(std::memory_order_seq_cst);
+    if ((word & kCountMask) != 0 && (word >> kCountBits) < min_epoch) {
+      min_epoch = word >> kCountBits;
+    }
+  }
+  return min_epoch;
+}
@@ -0,0 +1,158 @@
+#ifndef RUNNER_RCU_POINTER_H_
+#define RUNNER_RCU_POINTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Учет эпох читателей для отложенного освобождения (epoch-based reclamation).
+//
+// Читатель входит в критическую секцию, отмечая в своем слоте текущую
+// глобальную эпоху, и снимает отметку при выходе. Писатель, заменив объект,
+// продвигает эпоху и освобождает старый объект только когда все активные
+// слоты отмечены более поздней эпохой: такие читатели уже не могли его
+// увидеть. Слот закрепляется за потоком, но может делиться несколькими
+// потоками, поэтому хранит эпоху первого вошедшего и число читателей.
+// Вход и выход - одна CAS-операция в своей кэш-линии, без блокировок.
+class EpochDomain {
+ public:
+  static constexpr size_t kSlotCount = 64;
+
+  // Эпоха, которой нет ни у одного читателя
+  static constexpr uint64_t kNoReaders = UINT64_MAX;
+
+  EpochDomain();
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Войти в критическую секцию. Возвращает слот для Exit().
+  size_t Enter();
+  void Exit(size_t slot);
+
+  // Продвинуть эпоху. Возвращает эпоху, в которой был виден заменяемый объект.
+  uint64_t Advance();
+
+  // Наименьшая эпоха активных читателей или kNoReaders
+  uint64_t MinActiveEpoch() const;
+
+ private:
+  // Слово слота: эпоха в старших 40 битах, число читателей в младших 24
+  static constexpr int kCountBits = 24;
+  static constexpr uint64_t kCountMask = (1ull << kCountBits) - 1;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> word{0};
+  };
+
+  static size_t ThreadSlot();
+
+  std::atomic<uint64_t> epoch_{1};
+  Slot slots_[kSlotCount];
+};
+
+// Указатель на неизменяемый объект с публикацией по принципу RCU.
+//
+// Читатели берут ReadGuard и работают со снимком, не блокируясь и не
+// мешая писателю. Publish() заменяет объект атомарной записью указателя;
+// старый объект уходит в список ожидания и удаляется Reclaim(), как только
+// его не может держать ни один читатель.
+template <typename T>
+class RcuPointer {
+ public:
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&& other) noexcept
+        : domain_(other.domain_), slot_(other.slot_), value_(other.value_) {
+      other.domain_ = nullptr;
+    }
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ReadGuard& operator=(ReadGuard&&) = delete;
+
+    ~ReadGuard() {
+      if (domain_ != nullptr) {
+        domain_->Exit(slot_);
+      }
+    }
+
+    const T* get() const { return value_; }
+    const T* operator->() const { return value_; }
+    const T& operator*() const { return *value_; }
+    explicit operator bool() const { return value_ != nullptr; }
+
+   private:
+    friend class RcuPointer;
+
+    ReadGuard(EpochDomain* domain, const std::atomic<const T*>& current)
+        : domain_(domain), slot_(domain->Enter()),
+          value_(current.load(std::memory_order_seq_cst)) {}
+
+    EpochDomain* domain_;
+    size_t slot_;
+    const T* value_;
+  };
+
+  RcuPointer() = default;
+
+  RcuPointer(const RcuPointer&) = delete;
+  RcuPointer& operator=(const RcuPointer&) = delete;
+
+  // Читателей к моменту разрушения быть не должно
+  ~RcuPointer() {
+    delete current_.load(std::memory_order_relaxed);
+    for (auto& retired : retired_) {
+      delete retired.second;
+    }
+  }
+
+  ReadGuard Read() const { return ReadGuard(&domain_, current_); }
+
+  // Опубликовать новый объект. Не ждет читателей старого.
+  void Publish(std::unique_ptr<const T> value) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const T* previous = current_.exchange(value.release(), std::memory_order_seq_cst);
+    if (previous != nullptr) {
+      retired_.emplace_back(domain_.Advance(), previous);
+    }
+    ReclaimLocked();
+  }
+
+  // Удалить объекты, которые больше не видны читателям. Возвращает число
+  // оставшихся в ожидании.
+  size_t Reclaim() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    ReclaimLocked();
+    return retired_.size();
+  }
+
+ private:
+  void ReclaimLocked() {
+    if (retired_.empty()) {
+      return;
+    }
+    uint64_t min_active = domain_.MinActiveEpoch();
+    size_t kept = 0;
+    for (auto& retired : retired_) {
+      if (retired.first < min_active) {
+        delete retired.second;
+      } else {
+        retired_[kept++] = retired;
+      }
+    }
+    retired_.resize(kept);
+  }
+
+  mutable EpochDomain domain_;
+  std::atomic<const T*> current_{nullptr};
+
+  std::mutex writer_mutex_;
+  std::vector<std::pair<uint64_t, const T*>> retired_;
+};
+
+#endif  // RUNNER_RCU_POINTER_H_
@@ -0,0 +1,81 @@
+#include "reactor.h"
+
+#if defined(_WIN32)
+#include "iocp_reactor.h"
+#elif defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "epoll_reactor.h"
+#include "native_log.h"
+#include "uring_reactor.h"
+#endif
+
+std::unique_ptr<Reactor> Reactor::Create(ReactorKind kind) {
+#if defined(_WIN32)
+  (void)kind;
+  std::unique_ptr<IocpReactor> reactor(new IocpReactor());
+  if (!reactor->Open()) {
+    return nullptr;
+  }
+  return reactor;
+#elif defined(__linux__)
+  if (kind == ReactorKind::kIoUring) {
+    std::unique_ptr<UringReactor> uring(new UringReactor());
+    if (uring->Open()) {
+      return uring;
+    }
+    LOG_WARNING("io_uring недоступен, используется epoll");
+  }
+  std::unique_ptr<EpollReactor> reactor(new EpollReactor());
+  if (!reactor->Open()) {
+    return nullptr;
+  }
+  return reactor;
+#else
+  return nullptr;
+#endif
+}
+
+bool SetSocketNonBlocking(SocketHandle socket) {
+#if defined(_WIN32)
+  u_long mode = 1;
+  return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+  int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+void CloseSocketHandle(SocketHandle socket) {
+#if defined(_WIN32)
+  closesocket(socket);
+#else
+  close(socket);
+#endif
+}
+
+void ShutdownSocketSend(SocketHandle socket) {
+#if defined(_WIN32)
+  shutdown(socket, SD_SEND);
+#else
+  shutdown(socket, SHUT_WR);
+#endif
+}
+
+int LastSocketError() {
+#if defined(_WIN32)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+int SocketCancelledError() {
+#if defined(_WIN32)
+  return WSA_OPERATION_ABORTED;
+#else
+  return ECANCELED;
+#endif
+}
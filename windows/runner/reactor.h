@@ -0,0 +1,121 @@
+#ifndef RUNNER_REACTOR_H_
+#define RUNNER_REACTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+// Тип асинхронной операции
+enum class IoOpType : uint8_t {
+  kAccept = 0,
+  kConnect = 1,
+  kRead = 2,
+  kWrite = 3,
+  kSpliceIn = 4,   // сокет -> канал без копирования в память процесса
+  kSpliceOut = 5,  // канал -> сокет
+};
+
+// Выбор реализации в Reactor::Create()
+enum class ReactorKind : uint8_t {
+  kDefault = 0,  // IOCP на Windows, epoll на Linux
+  kIoUring = 1,  // io_uring на Linux (5.19+), иначе kDefault
+};
+
+struct IoOp;
+
+// Получатель завершений. Вызывается только из потока, крутящего Poll().
+class IoHandler {
+ public:
+  virtual void OnIoComplete(IoOp* op) = 0;
+
+ protected:
+  ~IoHandler() = default;
+};
+
+// Асинхронная операция над сокетом. Память принадлежит вызывающему и не
+// должна освобождаться до завершения. Поле platform занимает OVERLAPPED
+// на Windows и обязано идти первым.
+struct IoOp {
+  alignas(8) uint8_t platform[64];
+
+  IoOpType type = IoOpType::kRead;
+  SocketHandle socket = kInvalidSocket;  // для kAccept - слушающий сокет
+  SocketHandle accepted = kInvalidSocket;  // результат kAccept
+  char* buffer = nullptr;
+  size_t length = 0;
+  sockaddr_storage address = {};  // адрес для kConnect
+  int address_length = 0;
+  int pipe = -1;  // конец канала для kSpliceIn/kSpliceOut
+  IoHandler* handler = nullptr;
+
+  // Результат: байты (0 для kRead - конец потока) и код ошибки сокета
+  size_t transferred = 0;
+  int error = 0;
+
+  // Служебные поля реализации
+  IoOp* next = nullptr;
+};
+
+// Цикл событий ввода-вывода в стиле проактора: операции отправляются через
+// Submit(), а завершения доставляются обработчикам внутри Poll(). Один
+// экземпляр обслуживается одним потоком (кроме Wake()).
+//
+// kWrite завершается, когда передан весь буфер или произошла ошибка.
+// kRead завершается при получении хотя бы одного байта.
+// kSpliceIn/kSpliceOut - аналоги kRead/kWrite, где вместо буфера выступает
+// канал (pipe): данные не покидают ядро. Доступны, если SupportsSplice().
+class Reactor {
+ public:
+  // Реализация для текущей платформы
+  static std::unique_ptr<Reactor> Create(ReactorKind kind = ReactorKind::kDefault);
+
+  virtual ~Reactor() = default;
+
+  // Привязать неблокирующий сокет к реактору. Обязательно перед Submit().
+  virtual bool Attach(SocketHandle socket) = 0;
+
+  // Отправить операцию. false - операцию не удалось начать (op->error
+  // заполнен, завершение не придет).
+  virtual bool Submit(IoOp* op) = 0;
+
+  // Закрыть сокет. Незавершенные операции завершатся с ошибкой.
+  virtual void Close(SocketHandle socket) = 0;
+
+  // Дождаться событий не дольше |timeout_ms| (-1 - без ограничения) и
+  // доставить завершения. Возвращает число доставленных завершений.
+  virtual size_t Poll(int timeout_ms) = 0;
+
+  // Прервать ожидание в Poll() из другого потока
+  virtual void Wake() = 0;
+
+  virtual bool SupportsSplice() const { return false; }
+
+  virtual const char* name() const = 0;
+};
+
+// Общие операции над сокетами
+bool SetSocketNonBlocking(SocketHandle socket);
+void CloseSocketHandle(SocketHandle socket);
+void ShutdownSocketSend(SocketHandle socket);
+int LastSocketError();
+
+// Код ошибки "операция отменена" для завершений после Close()
+int SocketCancelledError();
+
+#endif  // RUNNER_REACTOR_H_
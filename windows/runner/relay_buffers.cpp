@@ -0,0 +1,82 @@
+#include "relay_buffers.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+BufferPool::BufferPool(size_t buffer_size) : buffer_size_(buffer_size) {}
+
+char* BufferPool::Acquire() {
+  if (free_.empty()) {
+    std::unique_ptr<char[]> chunk(new char[buffer_size_ * kBlocksPerChunk]);
+    // В обратном порядке, чтобы первым выдавался начальный буфер блока
+    for (size_t i = kBlocksPerChunk; i > 0; i--) {
+      free_.push_back(chunk.get() + (i - 1) * buffer_size_);
+    }
+    chunks_.push_back(std::move(chunk));
+  }
+  char* buffer = free_.back();
+  free_.pop_back();
+  return buffer;
+}
+
+void BufferPool::Release(char* buffer) {
+  if (buffer != nullptr) {
+    free_.push_back(buffer);
+  }
+}
+
+PipePool::PipePool(size_t max_pipes) : max_pipes_(max_pipes) {}
+
+PipePool::~PipePool() {
+#if defined(__linux__)
+  for (const Pipe& pipe : free_) {
+    close(pipe.read_end);
+    close(pipe.write_end);
+  }
+#endif
+}
+
+bool PipePool::Acquire(int fds[2]) {
+#if defined(__linux__)
+  if (in_use_ >= max_pipes_) {
+    return false;
+  }
+  if (!free_.empty()) {
+    fds[0] = free_.back().read_end;
+    fds[1] = free_.back().write_end;
+    free_.pop_back();
+  } else if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0) {
+    fcntl(fds[1], F_SETPIPE_SZ, (int)kPipeCapacity);
+  } else {
+    return false;
+  }
+  in_use_++;
+  return true;
+#else
+  (void)fds;
+  return false;
+#endif
+}
+
+void PipePool::Release(int fds[2]) {
+#if defined(__linux__)
+  if (fds[0] < 0) {
+    return;
+  }
+  in_use_--;
+  int pending = 0;
+  if (ioctl(fds[0], FIONREAD, &pending) == 0 && pending == 0) {
+    free_.push_back(Pipe{fds[0], fds[1]});
+  } else {
+    close(fds[0]);
+    close(fds[1]);
+  }
+  fds[0] = -1;
+  fds[1] = -1;
+#else
+  (void)fds;
+#endif
+}
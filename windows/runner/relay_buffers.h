@@ -0,0 +1,68 @@
+#ifndef RUNNER_RELAY_BUFFERS_H_
+#define RUNNER_RELAY_BUFFERS_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+// Пул буферов фиксированного размера для ретрансляции. Память выделяется
+// блоками по kBlocksPerChunk буферов и не возвращается системе до
+// уничтожения пула; освобожденные буферы уходят в стек и выдаются первыми,
+// пока они еще в кэше. Один пул обслуживается одним потоком.
+class BufferPool {
+ public:
+  static constexpr size_t kBlocksPerChunk = 64;
+
+  explicit BufferPool(size_t buffer_size);
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  char* Acquire();
+  void Release(char* buffer);
+
+  size_t buffer_size() const { return buffer_size_; }
+  size_t allocated_count() const { return chunks_.size() * kBlocksPerChunk; }
+  size_t free_count() const { return free_.size(); }
+
+ private:
+  size_t buffer_size_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  std::vector<char*> free_;
+};
+
+// Пул каналов для splice(). Возвращаемый канал должен быть пуст, иначе он
+// закрывается: остаток данных принадлежит прерванному соединению. Каждый
+// канал - два дескриптора, поэтому число выданных каналов ограничено:
+// сверх предела Acquire() неудачен и соединение идет через буферы. На
+// платформах без splice() Acquire() всегда неудачен.
+class PipePool {
+ public:
+  // Емкость канала; одна операция splice переносит не больше
+  static constexpr size_t kPipeCapacity = 64 * 1024;
+
+  explicit PipePool(size_t max_pipes);
+  ~PipePool();
+
+  PipePool(const PipePool&) = delete;
+  PipePool& operator=(const PipePool&) = delete;
+
+  // fds[0] - чтение, fds[1] - запись
+  bool Acquire(int fds[2]);
+  void Release(int fds[2]);
+
+  size_t in_use_count() const { return in_use_; }
+
+ private:
+  struct Pipe {
+    int read_end;
+    int write_end;
+  };
+
+  size_t max_pipes_;
+  size_t in_use_ = 0;
+  std::vector<Pipe> free_;
+};
+
+#endif  // RUNNER_RELAY_BUFFERS_H_
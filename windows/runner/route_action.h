@@ -0,0 +1,26 @@
+#ifndef RUNNER_ROUTE_ACTION_H_
+#define RUNNER_ROUTE_ACTION_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Действие правила маршрутизации (RouteRule.action на стороне Dart).
+// Числовые значения возвращаются через FFI.
+enum class RouteAction : uint8_t {
+  kNone = 0,
+  kProxy = 1,
+  kDirect = 2,
+  kBlock = 3,
+};
+
+// Номер правила, означающий "ни одно правило не совпало"
+constexpr uint32_t kNoRule = 0xFFFFFFFF;
+
+inline RouteAction ParseRouteAction(const char* action, size_t length) {
+  if (length == 5 && memcmp(action, "proxy", 5) == 0) return RouteAction::kProxy;
+  if (length == 6 && memcmp(action, "direct", 6) == 0) return RouteAction::kDirect;
+  if (length == 5 && memcmp(action, "block", 5) == 0) return RouteAction::kBlock;
+  return RouteAction::kNone;
+}
+
+#endif  // RUNNER_ROUTE_ACTION_H_
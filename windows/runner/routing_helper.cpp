@@ -0,0 +1,232 @@
+#include "routing_helper.h"
+#include <ws2tcpip.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geo_data.h"
+#include "native_log.h"
+#include "prefix_table.h"
+#include "route_action.h"
+#include "rule_program.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Загруженные списки geosite/geoip
+static std::mutex g_listsMutex;
+static RuleLists g_ruleLists;
+
+// Текущий скомпилированный профиль
+static RcuPointer<RuleProgram> g_ruleProgram;
+
+// Кеш имен: наполняет прокси, читают и правила
+static DnsCache g_dnsCache;
+
+RcuPointer<RuleProgram>& ActiveRuleProgram() {
+    return g_ruleProgram;
+}
+
+DnsCache& SharedDnsCache() {
+    return g_dnsCache;
+}
+
+// Прочитать файл списка целиком
+static bool ReadListFile(const char* path, std::string* content) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || file == NULL) {
+        LOG_ERROR("Не удалось открыть список: %s", path);
+        return false;
+    }
+    
+    char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content->append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+// Файл в формате V2Ray (geosite.dat, geoip.dat), а не текстовый список
+static bool IsDatFile(const char* path) {
+    size_t length = strlen(path);
+    return length >= 4 && _stricmp(path + length - 4, ".dat") == 0;
+}
+
+// Зарегистрировать список geosite-категории
+EXPORT int32_t RoutingLoadGeosite(const char* category, const char* path) {
+    if (category == NULL || path == NULL) {
+        return 0;
+    }
+    
+    std::string content;
+    if (!ReadListFile(path, &content)) {
+        return 0;
+    }
+    
+    if (IsDatFile(path)) {
+        std::string text;
+        if (!ExtractGeosite(content.data(), content.size(), category, &text)) {
+            LOG_ERROR("Категория geosite:%s не найдена в %s", category, path);
+            return 0;
+        }
+        content.swap(text);
+    }
+    
+    std::lock_guard<std::mutex> lock(g_listsMutex);
+    g_ruleLists.SetGeosite(category, std::move(content));
+    return 1;
+}
+
+// Зарегистрировать список geoip-категории
+EXPORT int32_t RoutingLoadGeoip(const char* category, const char* path) {
+    if (category == NULL || path == NULL) {
+        return 0;
+    }
+    
+    std::string content;
+    if (!ReadListFile(path, &content)) {
+        return 0;
+    }
+    
+    if (IsDatFile(path)) {
+        std::string text;
+        if (!ExtractGeoip(content.data(), content.size(), category, &text)) {
+            LOG_ERROR("Категория geoip:%s не найдена в %s", category, path);
+            return 0;
+        }
+        content.swap(text);
+    }
+    
+    std::lock_guard<std::mutex> lock(g_listsMutex);
+    g_ruleLists.SetGeoip(category, std::move(content));
+    return 1;
+}
+
+// Скомпилировать профиль маршрутизации
+EXPORT int32_t RoutingCompileProfile(const char* profileJson) {
+    if (profileJson == NULL) {
+        return 0;
+    }
+    
+    // Профиль собирается в стороне от потоков обработки пакетов и публикуется
+    // одной атомарной заменой указателя
+    std::unique_ptr<RuleProgram> program(new RuleProgram());
+    {
+        std::lock_guard<std::mutex> lock(g_listsMutex);
+        if (!program->CompileProfile(profileJson, strlen(profileJson), g_ruleLists)) {
+            LOG_ERROR("Ошибка разбора профиля маршрутизации");
+            return 0;
+        }
+    }
+    
+    LOG_INFO("Профиль маршрутизации скомпилирован: %zu правил (не поддерживается: %zu), %zu КБ",
+             program->rule_count(), program->unsupported_count(), program->MemoryUsage() / 1024);
+    g_ruleProgram.Publish(std::move(program));
+    return 1;
+}
+
+// Действие первого совпавшего доменного правила
+EXPORT int32_t RoutingMatchDomain(const char* domain) {
+    RcuPointer<RuleProgram>::ReadGuard program = g_ruleProgram.Read();
+    if (!program || domain == NULL) {
+        return (int32_t)RouteAction::kNone;
+    }
+    
+    return (int32_t)program->MatchDomain(domain, strlen(domain)).action;
+}
+
+// Адрес из кеша имен, чтобы для имени сработали и правила по IP (geoip).
+// В DNS отсюда не обращаемся.
+static void FillCachedAddress(const char* domain, RouteQuery* query) {
+    std::vector<ResolvedAddress> addresses;
+    if (g_dnsCache.Lookup(domain, DnsCache::NowUs(), &addresses, NULL) ==
+            DnsCache::Status::kMiss ||
+        addresses.empty()) {
+        return;
+    }
+    const sockaddr_storage* resolved = &addresses[0].address;
+    if (resolved->ss_family == AF_INET) {
+        const sockaddr_in* ipv4 = (const sockaddr_in*)resolved;
+        query->family = 4;
+        query->ipv4 = ntohl(ipv4->sin_addr.s_addr);
+    } else {
+        const sockaddr_in6* ipv6 = (const sockaddr_in6*)resolved;
+        query->family = 6;
+        memcpy(query->ipv6, &ipv6->sin6_addr, sizeof(query->ipv6));
+    }
+}
+
+// Разобрать IP-литерал в запрос. false - это не адрес
+static bool FillLiteralAddress(const char* address, RouteQuery* query) {
+    uint8_t bytes[16];
+    uint8_t prefixLength;
+    uint8_t family;
+    if (!PrefixTable::ParseCidr(address, bytes, &prefixLength, &family)) {
+        return false;
+    }
+    query->family = family;
+    if (family == 4) {
+        query->ipv4 = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                      ((uint32_t)bytes[2] << 8) | bytes[3];
+    } else {
+        memcpy(query->ipv6, bytes, sizeof(query->ipv6));
+    }
+    return true;
+}
+
+RouteAction RouteConnection(const std::string& host, uint16_t port) {
+    RcuPointer<RuleProgram>::ReadGuard program = g_ruleProgram.Read();
+    if (!program) {
+        return RouteAction::kNone;
+    }
+    
+    RouteQuery query;
+    query.port = port;
+    query.protocols = kRouteProtocolTcp;
+    if (!FillLiteralAddress(host.c_str(), &query)) {
+        query.domain = host.c_str();
+        query.domain_length = host.size();
+        FillCachedAddress(query.domain, &query);
+    }
+    return program->Evaluate(query).action;
+}
+
+// Действие профиля для соединения
+EXPORT int32_t RoutingEvaluate(const char* address, int32_t port, int32_t protocols,
+                               const char* domain, const char* process) {
+    RcuPointer<RuleProgram>::ReadGuard program = g_ruleProgram.Read();
+    if (!program) {
+        return (int32_t)RouteAction::kNone;
+    }
+    
+    RouteQuery query;
+    if (address != NULL && address[0] != '\0') {
+        FillLiteralAddress(address, &query);
+    }
+    if (port > 0 && port <= 65535) {
+        query.port = (uint16_t)port;
+    }
+    query.protocols = (uint32_t)protocols;
+    if (domain != NULL) {
+        query.domain = domain;
+        query.domain_length = strlen(domain);
+        
+        // Адрес неизвестен: берем его из кеша имен
+        if (query.family == 0) {
+            FillCachedAddress(domain, &query);
+        }
+    }
+    if (process != NULL) {
+        query.process = process;
+        query.process_length = strlen(process);
+    }
+    
+    return (int32_t)program->Evaluate(query).action;
+}
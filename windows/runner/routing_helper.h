@@ -0,0 +1,54 @@
+#ifndef ROUTING_HELPER_H
+#define ROUTING_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Зарегистрировать список geosite-категории из файла: текст в формате
+// domain-list-community или geosite.dat V2Ray (*.dat), из которого берется
+// категория |category|
+__declspec(dllexport) int32_t RoutingLoadGeosite(const char* category, const char* path);
+
+// Зарегистрировать список geoip-категории из файла: CIDR по одному в строке
+// или geoip.dat V2Ray (*.dat)
+__declspec(dllexport) int32_t RoutingLoadGeoip(const char* category, const char* path);
+
+// Скомпилировать профиль маршрутизации (JSON RoutingProfile.toJson())
+__declspec(dllexport) int32_t RoutingCompileProfile(const char* profileJson);
+
+// Действие первого совпавшего доменного правила:
+// 0 - нет совпадений, 1 - proxy, 2 - direct, 3 - block
+__declspec(dllexport) int32_t RoutingMatchDomain(const char* domain);
+
+// Действие профиля для соединения. Неизвестные параметры - NULL или 0,
+// protocols - маска RouteProtocol (1 - tcp, 2 - udp, 4 - http, 8 - tls, ...)
+__declspec(dllexport) int32_t RoutingEvaluate(const char* address, int32_t port,
+                                              int32_t protocols, const char* domain,
+                                              const char* process);
+
+#ifdef __cplusplus
+}
+
+#include <string>
+
+#include "dns_cache.h"
+#include "rcu_pointer.h"
+#include "route_action.h"
+#include "rule_program.h"
+
+// Текущий профиль для потоков обработки пакетов. Замена профиля не
+// останавливает трафик: пакеты дочитывают свой снимок, новые потоки
+// оцениваются по новому профилю.
+RcuPointer<RuleProgram>& ActiveRuleProgram();
+
+// Кеш имен, общий для встроенного прокси и правил маршрутизации
+DnsCache& SharedDnsCache();
+
+// Действие текущего профиля для TCP-соединения с |host| (имя или IP-литерал)
+RouteAction RouteConnection(const std::string& host, uint16_t port);
+#endif
+
+#endif // ROUTING_HELPER_H
@@ -0,0 +1,421 @@
+#include "rule_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "json_reader.h"
+
+const char kGeoipPrivateRanges[] =
+    "0.0.0.0/8\n10.0.0.0/8\n100.64.0.0/10\n127.0.0.0/8\n169.254.0.0/16\n"
+    "172.16.0.0/12\n192.0.0.0/24\n192.0.2.0/24\n192.88.99.0/24\n192.168.0.0/16\n"
+    "198.18.0.0/15\n198.51.100.0/24\n203.0.113.0/24\n224.0.0.0/4\n240.0.0.0/4\n"
+    "::/128\n::1/128\nfc00::/7\nfe80::/10\nff00::/8\n";
+
+namespace {
+
+// Соответствие значений RouteRule(type: 'protocol') битам RouteProtocol
+struct ProtocolName {
+  const char* name;
+  uint32_t bit;
+};
+
+const ProtocolName kProtocolNames[] = {
+    {"tcp", 0}, {"udp", 1}, {"http", 2}, {"tls", 3}, {"quic", 4}, {"bittorrent", 5},
+};
+
+constexpr size_t kProtocolCount = sizeof(kProtocolNames) / sizeof(kProtocolNames[0]);
+
+// Максимальная длина имени процесса (MAX_PATH)
+constexpr size_t kMaxProcessName = 260;
+
+bool StartsWith(const std::string& text, const char* prefix) {
+  return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Имя исполняемого файла без каталога в нижнем регистре
+size_t ProcessBaseName(const char* process, size_t length, char* out) {
+  size_t start = length;
+  while (start > 0 && process[start - 1] != '\\' && process[start - 1] != '/') {
+    start--;
+  }
+  size_t out_length = std::min(length - start, kMaxProcessName);
+  for (size_t i = 0; i < out_length; i++) {
+    char c = process[start + i];
+    out[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+  }
+  return out_length;
+}
+
+// Ключ префикса после обнуления битов за пределами |length|
+std::string PrefixKey(const uint8_t* address, int address_bytes, uint8_t length) {
+  std::string key(1 + address_bytes, '\0');
+  key[0] = (char)length;
+  for (int i = 0; i < address_bytes; i++) {
+    int bits = (int)length - i * 8;
+    uint8_t mask = bits >= 8 ? 0xFF : (bits <= 0 ? 0 : (uint8_t)(0xFF << (8 - bits)));
+    key[1 + i] = (char)(address[i] & mask);
+  }
+  return key;
+}
+
+}  // namespace
+
+RuleLists::RuleLists() {
+  geoip_["private"] = kGeoipPrivateRanges;
+}
+
+void RuleLists::SetGeosite(const std::string& category, std::string text) {
+  geosite_[category] = std::move(text);
+}
+
+void RuleLists::SetGeoip(const std::string& category, std::string text) {
+  geoip_[category] = std::move(text);
+}
+
+const std::string* RuleLists::FindGeosite(const std::string& category) const {
+  auto it = geosite_.find(category);
+  return it != geosite_.end() ? &it->second : nullptr;
+}
+
+const std::string* RuleLists::FindGeoip(const std::string& category) const {
+  auto it = geoip_.find(category);
+  return it != geoip_.end() ? &it->second : nullptr;
+}
+
+RuleProgram::RuleProgram() {
+  std::fill(protocol_rules_, protocol_rules_ + kProtocolCount, kNoRule);
+}
+
+bool RuleProgram::CompileProfile(const char* json, size_t length, const RuleLists& lists) {
+  JsonReader reader(json, length);
+  if (!reader.BeginObject()) {
+    return false;
+  }
+
+  std::string key;
+  while (reader.NextKey(&key)) {
+    if (key == "udpSupport" && reader.Peek() != 'n') {
+      if (!reader.ReadBool(&udp_support_)) {
+        return false;
+      }
+    } else if (key == "rules") {
+      if (!reader.BeginArray()) {
+        return false;
+      }
+      while (reader.NextElement()) {
+        std::string type, value, action, field;
+        if (!reader.BeginObject()) {
+          return false;
+        }
+        while (reader.NextKey(&field)) {
+          bool ok;
+          if (field == "type") {
+            ok = reader.ReadString(&type);
+          } else if (field == "value") {
+            ok = reader.ReadString(&value);
+          } else if (field == "action") {
+            ok = reader.ReadString(&action);
+          } else {
+            ok = reader.Skip();
+          }
+          if (!ok) {
+            return false;
+          }
+        }
+        AddRule(type, value, ParseRouteAction(action.data(), action.size()), lists);
+      }
+    } else if (!reader.Skip()) {
+      return false;
+    }
+  }
+  if (reader.failed()) {
+    return false;
+  }
+
+  Build();
+  return true;
+}
+
+bool RuleProgram::AddRule(const std::string& type, const std::string& value,
+                          RouteAction action, const RuleLists& lists) {
+  uint32_t rule = (uint32_t)actions_.size();
+  actions_.push_back(action);
+
+  bool ok = false;
+  if (action == RouteAction::kNone) {
+    ok = false;
+  } else if (type == "domain") {
+    if (StartsWith(value, "geosite:")) {
+      const std::string* list = lists.FindGeosite(value.substr(8));
+      ok = list != nullptr && domains_.AddDomainList(list->data(), list->size(), rule) > 0;
+    } else {
+      ok = domains_.AddRule(value.data(), value.size(), rule);
+    }
+  } else if (type == "ip") {
+    if (StartsWith(value, "geoip:")) {
+      const std::string* list = lists.FindGeoip(value.substr(6));
+      ok = list != nullptr && AddCidrs(list->data(), list->size(), rule);
+    } else {
+      ok = AddCidrs(value.data(), value.size(), rule);
+    }
+  } else if (type == "port") {
+    ok = AddPorts(value, rule);
+  } else if (type == "protocol") {
+    for (size_t i = 0; i < kProtocolCount; i++) {
+      if (value == kProtocolNames[i].name) {
+        uint32_t& slot = protocol_rules_[kProtocolNames[i].bit];
+        slot = std::min(slot, rule);
+        ok = true;
+      }
+    }
+  } else if (type == "process") {
+    char name[kMaxProcessName];
+    size_t length = ProcessBaseName(value.data(), value.size(), name);
+    if (length > 0) {
+      auto found = processes_.find(std::string_view(name, length));
+      if (found != processes_.end()) {
+        found->second = std::min(found->second, rule);
+      } else {
+        process_names_.emplace_back(name, length);
+        processes_.emplace(process_names_.back(), rule);
+      }
+      ok = true;
+    }
+  } else if (type == "default") {
+    default_rule_ = std::min(default_rule_, rule);
+    ok = true;
+  }
+
+  if (!ok) {
+    unsupported_count_++;
+  }
+  return ok;
+}
+
+bool RuleProgram::AddPorts(const std::string& value, uint32_t rule) {
+  // "53", "27000-27050" или список через запятую
+  bool added = false;
+  const char* cursor = value.c_str();
+  while (*cursor != '\0') {
+    char* end = nullptr;
+    long first = strtol(cursor, &end, 10);
+    if (end == cursor) {
+      return false;
+    }
+    long last = first;
+    cursor = end;
+    if (*cursor == '-') {
+      cursor++;
+      last = strtol(cursor, &end, 10);
+      if (end == cursor) {
+        return false;
+      }
+      cursor = end;
+    }
+    while (*cursor == ' ') {
+      cursor++;
+    }
+    if (*cursor == ',') {
+      cursor++;
+    } else if (*cursor != '\0') {
+      return false;
+    }
+    if (first < 0 || last > 65535 || first > last) {
+      return false;
+    }
+    port_ranges_.push_back({(uint16_t)first, (uint16_t)last, rule});
+    added = true;
+  }
+  return added;
+}
+
+bool RuleProgram::AddCidrs(const char* text, size_t length, uint32_t rule) {
+  bool added = false;
+  size_t position = 0;
+  while (position < length) {
+    size_t end = position;
+    while (end < length && text[end] != '\n' && text[end] != ',') {
+      end++;
+    }
+    size_t begin = position;
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) begin++;
+    size_t last = end;
+    while (last > begin && (text[last - 1] == ' ' || text[last - 1] == '\t' ||
+                            text[last - 1] == '\r')) last--;
+
+    if (last > begin && text[begin] != '#' && last - begin < 64) {
+      char cidr[64];
+      memcpy(cidr, text + begin, last - begin);
+      cidr[last - begin] = '\0';
+      CidrEntry entry;
+      if (PrefixTable::ParseCidr(cidr, entry.address, &entry.length, &entry.family)) {
+        entry.rule = rule;
+        cidrs_.push_back(entry);
+        added = true;
+      }
+    }
+    position = end + 1;
+  }
+  return added;
+}
+
+void RuleProgram::BuildAddresses() {
+  // Сначала короткие префиксы: к моменту обработки префикса минимумы всех
+  // покрывающих его префиксов уже известны
+  std::sort(cidrs_.begin(), cidrs_.end(), [](const CidrEntry& a, const CidrEntry& b) {
+    if (a.length != b.length) return a.length < b.length;
+    return a.rule < b.rule;
+  });
+
+  std::unordered_map<std::string, uint32_t> first_rules;
+  for (const CidrEntry& entry : cidrs_) {
+    int address_bytes = entry.family == 4 ? 4 : 16;
+    uint32_t rule = entry.rule;
+    for (int length = 0; length < entry.length; length++) {
+      auto cover = first_rules.find(PrefixKey(entry.address, address_bytes, (uint8_t)length));
+      if (cover != first_rules.end()) {
+        rule = std::min(rule, cover->second);
+      }
+    }
+    auto inserted =
+        first_rules.emplace(PrefixKey(entry.address, address_bytes, entry.length), rule);
+    inserted.first->second = std::min(inserted.first->second, rule);
+  }
+
+  for (const auto& prefix : first_rules) {
+    const uint8_t* address = (const uint8_t*)prefix.first.data() + 1;
+    uint8_t length = (uint8_t)prefix.first[0];
+    if (prefix.first.size() == 5) {
+      uint32_t ipv4 = ((uint32_t)address[0] << 24) | ((uint32_t)address[1] << 16) |
+                      ((uint32_t)address[2] << 8) | address[3];
+      addresses_.AddIpv4(ipv4, length, prefix.second + 1);
+    } else {
+      addresses_.AddIpv6(address, length, prefix.second + 1);
+    }
+  }
+  addresses_.Build();
+
+  cidrs_.clear();
+  cidrs_.shrink_to_fit();
+}
+
+void RuleProgram::BuildPorts() {
+  ports_.clear();
+  if (port_ranges_.empty()) {
+    return;
+  }
+
+  // Диапазоны раскрашиваются по возрастанию номера правила, уже занятые
+  // порты пропускаются через ссылку на следующий свободный порт
+  std::sort(port_ranges_.begin(), port_ranges_.end(),
+            [](const PortRange& a, const PortRange& b) { return a.rule < b.rule; });
+  ports_.assign(65536, kNoRule);
+  std::vector<uint32_t> next_free(65537);
+  for (uint32_t port = 0; port <= 65536; port++) {
+    next_free[port] = port;
+  }
+  auto find_free = [&next_free](uint32_t port) {
+    uint32_t root = port;
+    while (next_free[root] != root) {
+      root = next_free[root];
+    }
+    while (next_free[port] != root) {
+      uint32_t next = next_free[port];
+      next_free[port] = root;
+      port = next;
+    }
+    return root;
+  };
+  for (const PortRange& range : port_ranges_) {
+    for (uint32_t port = find_free(range.first); port <= range.last;
+         port = find_free(port)) {
+      ports_[port] = range.rule;
+      next_free[port] = port + 1;
+    }
+  }
+
+  port_ranges_.clear();
+  port_ranges_.shrink_to_fit();
+}
+
+void RuleProgram::Build() {
+  domains_.Build();
+  BuildAddresses();
+  BuildPorts();
+}
+
+RouteDecision RuleProgram::Decision(uint32_t rule) const {
+  RouteDecision decision;
+  if (rule != kNoRule) {
+    decision.action = actions_[rule];
+    decision.rule = rule;
+  }
+  return decision;
+}
+
+RouteDecision RuleProgram::Evaluate(const RouteQuery& query) const {
+  uint32_t best = kNoRule;
+
+  if (query.domain != nullptr && query.domain_length > 0) {
+    best = std::min(best, domains_.Match(query.domain, query.domain_length));
+  }
+
+  uint32_t address_rule = PrefixTable::kNoMatch;
+  if (query.family == 4) {
+    address_rule = addresses_.LookupIpv4(query.ipv4);
+  } else if (query.family == 6) {
+    address_rule = addresses_.LookupIpv6(query.ipv6);
+  }
+  if (address_rule != PrefixTable::kNoMatch) {
+    best = std::min(best, address_rule - 1);
+  }
+
+  if (query.port != 0 && !ports_.empty()) {
+    best = std::min(best, ports_[query.port]);
+  }
+
+  for (uint32_t protocols = query.protocols; protocols != 0; protocols &= protocols - 1) {
+    uint32_t bit = 0;
+    while (!(protocols & (1u << bit))) {
+      bit++;
+    }
+    if (bit < kProtocolCount) {
+      best = std::min(best, protocol_rules_[bit]);
+    }
+  }
+
+  if (query.process != nullptr && query.process_length > 0 && !processes_.empty()) {
+    char name[kMaxProcessName];
+    size_t length = ProcessBaseName(query.process, query.process_length, name);
+    auto it = processes_.find(std::string_view(name, length));
+    if (it != processes_.end()) {
+      best = std::min(best, it->second);
+    }
+  }
+
+  if (best != kNoRule) {
+    return Decision(best);
+  }
+  if (!udp_support_ && (query.protocols & kRouteProtocolUdp)) {
+    RouteDecision decision;
+    decision.action = RouteAction::kDirect;
+    return decision;
+  }
+  return Decision(default_rule_);
+}
+
+RouteDecision RuleProgram::MatchDomain(const char* name, size_t length) const {
+  return Decision(domains_.Match(name, length));
+}
+
+size_t RuleProgram::MemoryUsage() const {
+  size_t process_bytes = 0;
+  for (const std::string& name : process_names_) {
+    process_bytes += sizeof(name) + sizeof(std::pair<std::string_view, uint32_t>) +
+                     name.capacity();
+  }
+  return actions_.size() * sizeof(RouteAction) + domains_.MemoryUsage() +
+         addresses_.MemoryUsage() + ports_.size() * sizeof(uint32_t) + process_bytes;
+}
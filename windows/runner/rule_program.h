@@ -0,0 +1,163 @@
+#ifndef RUNNER_RULE_PROGRAM_H_
+#define RUNNER_RULE_PROGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain_matcher.h"
+#include "prefix_table.h"
+#include "route_action.h"
+
+// Протоколы для правил типа 'protocol' (битовая маска в RouteQuery)
+enum RouteProtocol : uint32_t {
+  kRouteProtocolTcp = 1u << 0,
+  kRouteProtocolUdp = 1u << 1,
+  kRouteProtocolHttp = 1u << 2,
+  kRouteProtocolTls = 1u << 3,
+  kRouteProtocolQuic = 1u << 4,
+  kRouteProtocolBittorrent = 1u << 5,
+};
+
+// Диапазоны geoip:private (совпадают с geoip.dat V2Ray)
+extern const char kGeoipPrivateRanges[];
+
+// Параметры соединения, по которым выбирается правило. Неизвестные
+// измерения оставляются пустыми и ни с чем не совпадают.
+struct RouteQuery {
+  uint8_t family = 0;       // 0 - адрес неизвестен, 4 или 6
+  uint32_t ipv4 = 0;        // в порядке байт хоста
+  uint8_t ipv6[16] = {};
+  uint16_t port = 0;        // порт назначения, 0 - неизвестен
+  uint32_t protocols = 0;   // маска RouteProtocol
+  const char* domain = nullptr;
+  size_t domain_length = 0;
+  const char* process = nullptr;  // имя или полный путь исполняемого файла
+  size_t process_length = 0;
+};
+
+// Результат: действие и номер сработавшего правила (kNoRule - сработало
+// неявное правило профиля или не сработало ничего)
+struct RouteDecision {
+  RouteAction action = RouteAction::kNone;
+  uint32_t rule = kNoRule;
+};
+
+// Списки для значений geosite:<категория> и geoip:<категория>
+class RuleLists {
+ public:
+  RuleLists();
+
+  void SetGeosite(const std::string& category, std::string text);
+  void SetGeoip(const std::string& category, std::string text);
+
+  const std::string* FindGeosite(const std::string& category) const;
+  const std::string* FindGeoip(const std::string& category) const;
+
+ private:
+  std::map<std::string, std::string> geosite_;
+  std::map<std::string, std::string> geoip_;
+};
+
+// Скомпилированный профиль маршрутизации (RoutingProfile.toJson()).
+//
+// Правила профиля упорядочены, и срабатывает первое совпавшее. Каждое
+// измерение (домен, адрес, порт, протокол, процесс) компилируется в свою
+// структуру, которая по значению сразу дает наименьший номер совпавшего в
+// этом измерении правила - то есть первый установленный бит битовой маски
+// правил этого измерения:
+//  - порт: таблица на 65536 портов;
+//  - протокол: по номеру на бит маски;
+//  - адрес: PrefixTable, где значение каждого префикса заранее сведено к
+//    минимуму по всем покрывающим его префиксам;
+//  - домен: DomainMatcher;
+//  - процесс: хеш-таблица имен.
+// RouteRule задает ровно одно условие, поэтому пересечение масок измерений
+// (правило без условия в измерении - всегда 1) сводится к минимуму их
+// первых битов. Стоимость Evaluate() не зависит от числа правил.
+//
+// Как и в generateV2RayRouting(), правило 'default' проверяется последним
+// независимо от позиции в списке, а перед ним при выключенном udpSupport
+// UDP направляется напрямую.
+class RuleProgram {
+ public:
+  RuleProgram();
+
+  RuleProgram(const RuleProgram&) = delete;
+  RuleProgram& operator=(const RuleProgram&) = delete;
+
+  // Разобрать JSON профиля и скомпилировать его. Неподдерживаемые правила
+  // (regexp:, неизвестные категории и типы) занимают номер, но ни с чем
+  // не совпадают.
+  bool CompileProfile(const char* json, size_t length, const RuleLists& lists);
+
+  // Добавить правило в конец списка (до Build())
+  bool AddRule(const std::string& type, const std::string& value, RouteAction action,
+               const RuleLists& lists);
+
+  // Правила, добавляемые генератором конфигурации V2Ray вне списка
+  void set_udp_support(bool enabled) { udp_support_ = enabled; }
+
+  void Build();
+
+  RouteDecision Evaluate(const RouteQuery& query) const;
+
+  // Первое совпавшее доменное правило без учета остальных измерений
+  RouteDecision MatchDomain(const char* name, size_t length) const;
+
+  size_t rule_count() const { return actions_.size(); }
+  size_t unsupported_count() const { return unsupported_count_; }
+  // Нужен ли Evaluate() владелец потока (RouteQuery::process)
+  bool has_process_rules() const { return !processes_.empty(); }
+  size_t MemoryUsage() const;
+
+ private:
+  struct CidrEntry {
+    uint8_t address[16];
+    uint8_t length;
+    uint8_t family;
+    uint32_t rule;
+  };
+
+  struct PortRange {
+    uint16_t first;
+    uint16_t last;
+    uint32_t rule;
+  };
+
+  bool AddPorts(const std::string& value, uint32_t rule);
+  bool AddCidrs(const char* text, size_t length, uint32_t rule);
+  void BuildAddresses();
+  void BuildPorts();
+
+  RouteDecision Decision(uint32_t rule) const;
+
+  std::vector<RouteAction> actions_;
+  size_t unsupported_count_ = 0;
+
+  DomainMatcher domains_;
+
+  std::vector<CidrEntry> cidrs_;
+  PrefixTable addresses_;  // значение - номер правила + 1
+
+  std::vector<PortRange> port_ranges_;
+  std::vector<uint32_t> ports_;  // пусто, если правил по портам нет
+
+  uint32_t protocol_rules_[6];
+
+  // Ключи указывают в process_names_ (элементы deque не перемещаются),
+  // поэтому Evaluate() ищет имя без создания std::string
+  std::deque<std::string> process_names_;
+  std::unordered_map<std::string_view, uint32_t> processes_;
+
+  uint32_t default_rule_ = kNoRule;
+  bool udp_support_ = true;
+};
+
+#endif  // RUNNER_RULE_PROGRAM_H_
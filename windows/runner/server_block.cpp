@@ -0,0 +1,161 @@
+#include "server_block.h"
+
+#include <string.h>
+
+#include "json_reader.h"
+
+namespace {
+
+bool SpanInside(int32_t offset, int32_t length, size_t limit) {
+  return offset >= 0 && length >= 0 && (size_t)offset + (size_t)length <= limit;
+}
+
+TextSpan AppendText(const std::string& value, std::string* text) {
+  TextSpan span;
+  span.offset = (uint32_t)text->size();
+  span.length = (uint32_t)value.size();
+  text->append(value);
+  return span;
+}
+
+bool ParseProtocol(const std::string& name, SubscriptionProtocol* protocol) {
+  if (name == "vless") {
+    *protocol = SubscriptionProtocol::kVless;
+  } else if (name == "vmess") {
+    *protocol = SubscriptionProtocol::kVmess;
+  } else if (name == "trojan") {
+    *protocol = SubscriptionProtocol::kTrojan;
+  } else if (name == "ss") {
+    *protocol = SubscriptionProtocol::kShadowsocks;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+void EncodeServerBlock(const std::vector<SubscriptionEntry>& entries,
+                       const std::vector<TextSpan>& params, const std::string& text,
+                       size_t skipped, std::vector<int32_t>* block) {
+  size_t fields = SUBSCRIPTION_HEADER_FIELDS + entries.size() * SUBSCRIPTION_RECORD_FIELDS +
+                  params.size() * 2;
+  block->assign(fields + (text.size() + 3) / 4, 0);
+  int32_t* out = block->data();
+  out[SUBSCRIPTION_ENTRIES] = (int32_t)entries.size();
+  out[SUBSCRIPTION_PARAMS] = (int32_t)(params.size() / 2);
+  out[SUBSCRIPTION_TEXT] = (int32_t)text.size();
+  out[SUBSCRIPTION_SKIPPED] = (int32_t)skipped;
+  out += SUBSCRIPTION_HEADER_FIELDS;
+
+  for (const SubscriptionEntry& entry : entries) {
+    out[SUBSCRIPTION_PROTOCOL] = (int32_t)entry.protocol;
+    out[SUBSCRIPTION_PORT] = entry.port;
+    out[SUBSCRIPTION_ID_OFFSET] = (int32_t)entry.id.offset;
+    out[SUBSCRIPTION_ID_LENGTH] = (int32_t)entry.id.length;
+    out[SUBSCRIPTION_ADDRESS_OFFSET] = (int32_t)entry.address.offset;
+    out[SUBSCRIPTION_ADDRESS_LENGTH] = (int32_t)entry.address.length;
+    out[SUBSCRIPTION_TAG_OFFSET] = (int32_t)entry.tag.offset;
+    out[SUBSCRIPTION_TAG_LENGTH] = (int32_t)entry.tag.length;
+    out[SUBSCRIPTION_FIRST_PARAM] = (int32_t)(entry.first_param / 2);
+    out[SUBSCRIPTION_PARAM_COUNT] = (int32_t)entry.param_count;
+    out += SUBSCRIPTION_RECORD_FIELDS;
+  }
+  for (const TextSpan& span : params) {
+    out[0] = (int32_t)span.offset;
+    out[1] = (int32_t)span.length;
+    out += 2;
+  }
+  if (!text.empty()) {
+    memcpy(out, text.data(), text.size());
+  }
+}
+
+bool DecodeServerBlock(const int32_t* block, size_t ints, ServerBlockView* view) {
+  if (ints < SUBSCRIPTION_HEADER_FIELDS || block[SUBSCRIPTION_ENTRIES] < 0 ||
+      block[SUBSCRIPTION_PARAMS] < 0 || block[SUBSCRIPTION_TEXT] < 0) {
+    return false;
+  }
+  size_t count = (size_t)block[SUBSCRIPTION_ENTRIES];
+  size_t pairs = (size_t)block[SUBSCRIPTION_PARAMS];
+  size_t text_length = (size_t)block[SUBSCRIPTION_TEXT];
+  size_t fields = SUBSCRIPTION_HEADER_FIELDS + count * SUBSCRIPTION_RECORD_FIELDS + pairs * 4;
+  if (fields + (text_length + 3) / 4 > ints) {
+    return false;
+  }
+  view->count = count;
+  view->param_pairs = pairs;
+  view->skipped = block[SUBSCRIPTION_SKIPPED] > 0 ? (size_t)block[SUBSCRIPTION_SKIPPED] : 0;
+  view->records = block + SUBSCRIPTION_HEADER_FIELDS;
+  view->params = view->records + count * SUBSCRIPTION_RECORD_FIELDS;
+  view->text = (const char*)(view->params + pairs * 4);
+  view->text_length = text_length;
+
+  for (size_t i = 0; i < pairs * 2; i++) {
+    if (!SpanInside(view->params[2 * i], view->params[2 * i + 1], text_length)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    const int32_t* record = view->records + i * SUBSCRIPTION_RECORD_FIELDS;
+    if (record[SUBSCRIPTION_PROTOCOL] < 0 ||
+        record[SUBSCRIPTION_PROTOCOL] > (int32_t)SubscriptionProtocol::kShadowsocks ||
+        record[SUBSCRIPTION_PORT] < 0 || record[SUBSCRIPTION_PORT] > 65535 ||
+        !SpanInside(record[SUBSCRIPTION_ID_OFFSET], record[SUBSCRIPTION_ID_LENGTH], text_length) ||
+        !SpanInside(record[SUBSCRIPTION_ADDRESS_OFFSET], record[SUBSCRIPTION_ADDRESS_LENGTH],
+                    text_length) ||
+        !SpanInside(record[SUBSCRIPTION_TAG_OFFSET], record[SUBSCRIPTION_TAG_LENGTH],
+                    text_length) ||
+        !SpanInside(record[SUBSCRIPTION_FIRST_PARAM], record[SUBSCRIPTION_PARAM_COUNT], pairs)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParseServerListJson(const char* json, size_t length, ServerList* servers) {
+  JsonReader reader(json, length);
+  if (!reader.BeginArray()) {
+    return false;
+  }
+  std::string key;
+  std::string value;
+  while (reader.NextElement()) {
+    if (!reader.BeginObject()) {
+      return false;
+    }
+    SubscriptionEntry entry;
+    entry.first_param = (uint32_t)servers->params.size();
+    bool known = false;
+    while (reader.NextKey(&key)) {
+      if (key == "protocol") {
+        known = reader.ReadString(&value) && ParseProtocol(value, &entry.protocol);
+      } else if (key == "id" && reader.ReadString(&value)) {
+        entry.id = AppendText(value, &servers->text);
+      } else if (key == "address" && reader.ReadString(&value)) {
+        entry.address = AppendText(value, &servers->text);
+      } else if (key == "tag" && reader.ReadString(&value)) {
+        entry.tag = AppendText(value, &servers->text);
+      } else if (key == "port") {
+        double port = 0;
+        reader.ReadNumber(&port);
+        entry.port = (port > 0 && port <= 65535) ? (uint16_t)port : 0;
+      } else if (key == "params" && reader.BeginObject()) {
+        std::string name;
+        while (reader.NextKey(&name) && reader.ReadString(&value)) {
+          servers->params.push_back(AppendText(name, &servers->text));
+          servers->params.push_back(AppendText(value, &servers->text));
+          entry.param_count++;
+        }
+      } else if (!reader.failed()) {
+        reader.Skip();
+      }
+    }
+    if (reader.failed() || !known) {
+      return false;
+    }
+    servers->entries.push_back(entry);
+  }
+  // Смещения в int32
+  return !reader.failed() && servers->text.size() <= (size_t)INT32_MAX / 2;
+}
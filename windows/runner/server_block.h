@@ -0,0 +1,48 @@
+#ifndef RUNNER_SERVER_BLOCK_H_
+#define RUNNER_SERVER_BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "subscription_helper.h"
+#include "subscription_parser.h"
+
+// Список серверов в памяти: строки записей и параметров - в text
+struct ServerList {
+  std::vector<SubscriptionEntry> entries;
+  std::vector<TextSpan> params;  // ключ, значение, ключ, ...
+  std::string text;
+};
+
+// Блок серверов - список, упакованный в числа int32 (раскладка описана в
+// subscription_helper.h). Его отдает Dart разбор подписки, и в нем же
+// хранится снимок ServerStore, так что чтение - это проверка границ.
+struct ServerBlockView {
+  size_t count = 0;
+  size_t param_pairs = 0;
+  size_t skipped = 0;
+  const int32_t* records = nullptr;
+  const int32_t* params = nullptr;  // по 4 числа на пару
+  const char* text = nullptr;
+  size_t text_length = 0;
+};
+
+// Упаковать список (|params| - пары спанов, как в SubscriptionParser)
+void EncodeServerBlock(const std::vector<SubscriptionEntry>& entries,
+                       const std::vector<TextSpan>& params, const std::string& text,
+                       size_t skipped, std::vector<int32_t>* block);
+
+// Разметить блок из |ints| чисел. false - блок обрезан или ссылки записей
+// выходят за его пределы.
+bool DecodeServerBlock(const int32_t* block, size_t ints, ServerBlockView* view);
+
+// Разобрать массив VpnConfig.toJson():
+// [{"protocol": "vless", "id": "...", "address": "...", "port": 443,
+//   "params": {"key": "value"}, "tag": "..."}, ...].
+// Протоколы - vless, vmess, trojan, ss; с другим протоколом - false.
+bool ParseServerListJson(const char* json, size_t length, ServerList* servers);
+
+#endif  // RUNNER_SERVER_BLOCK_H_
@@ -0,0 +1,247 @@
+#include "server_config.h"
+
+#include <string.h>
+
+namespace {
+
+struct ParamName {
+  const char* name;
+  uint8_t length;
+};
+
+constexpr ParamName kParamNames[kConfigParamCount] = {
+    {"type", 4},          {"security", 8},   {"sni", 3},        {"host", 4},
+    {"path", 4},          {"flow", 4},       {"serviceName", 11}, {"encryption", 10},
+    {"allowInsecure", 13}, {"method", 6},    {"multiMode", 9},  {"enableUdp", 9},
+    {"alpn", 4},          {"fp", 2},         {"pbk", 3},        {"sid", 3},
+    {"spx", 3},           {"headerType", 10}, {"mode", 4},      {"authority", 9},
+    {"plugin", 6},        {"aid", 3},        {"scy", 3},
+};
+
+constexpr size_t kMaxParamName = 13;
+
+// Номера параметров по длине имени: поиск сравнивает имя с двумя-пятью
+// кандидатами, а не со всем списком
+struct ParamsByLength {
+  uint8_t first[kMaxParamName + 2] = {};
+  uint8_t order[kConfigParamCount] = {};
+
+  ParamsByLength() {
+    uint8_t count[kMaxParamName + 1] = {};
+    for (const ParamName& param : kParamNames) {
+      count[param.length]++;
+    }
+    for (size_t length = 0; length <= kMaxParamName; length++) {
+      first[length + 1] = (uint8_t)(first[length] + count[length]);
+    }
+    uint8_t next[kMaxParamName + 1];
+    memcpy(next, first, sizeof(next));
+    for (size_t i = 0; i < kConfigParamCount; i++) {
+      order[next[kParamNames[i].length]++] = (uint8_t)i;
+    }
+  }
+};
+
+const ParamsByLength kParamsByLength;
+
+}  // namespace
+
+const char* ConfigParamName(ConfigParam param) {
+  return (size_t)param < kConfigParamCount ? kParamNames[(size_t)param].name : "";
+}
+
+bool FindConfigParam(const char* name, size_t length, ConfigParam* param) {
+  if (length == 0 || length > kMaxParamName) {
+    return false;
+  }
+  for (size_t i = kParamsByLength.first[length]; i < kParamsByLength.first[length + 1]; i++) {
+    uint8_t candidate = kParamsByLength.order[i];
+    if (memcmp(kParamNames[candidate].name, name, length) == 0) {
+      *param = (ConfigParam)candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+StringArena::StringArena() : slots_(1024) {}
+
+uint32_t StringArena::Hash(const char* data, size_t length) {
+  uint32_t hash = 0x811C9DC5u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+TextSpan StringArena::Intern(const char* data, size_t length) {
+  if (length == 0) {
+    return TextSpan();
+  }
+  uint32_t hash = Hash(data, length);
+  size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  for (;; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.span.length == 0) {
+      break;
+    }
+    if (slot.hash == hash && slot.span.length == length &&
+        memcmp(text_.data() + slot.span.offset, data, length) == 0) {
+      return slot.span;
+    }
+  }
+  TextSpan span;
+  span.offset = (uint32_t)text_.size();
+  span.length = (uint32_t)length;
+  text_.append(data, length);
+  slots_[i].hash = hash;
+  slots_[i].span = span;
+  if (++used_ * 2 > slots_.size()) {
+    Grow(slots_.size() * 2);
+  }
+  return span;
+}
+
+void StringArena::Grow(size_t slots) {
+  std::vector<Slot> old_slots(slots);
+  old_slots.swap(slots_);
+  size_t mask = slots_.size() - 1;
+  for (const Slot& slot : old_slots) {
+    if (slot.span.length == 0) {
+      continue;
+    }
+    size_t i = slot.hash & mask;
+    while (slots_[i].span.length != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = slot;
+  }
+}
+
+void StringArena::Clear() {
+  text_.clear();
+  for (Slot& slot : slots_) {
+    slot = Slot();
+  }
+  used_ = 0;
+}
+
+void StringArena::Reserve(size_t text_bytes, size_t strings) {
+  text_.reserve(text_bytes);
+  size_t slots = slots_.size();
+  while (slots < strings * 2) {
+    slots *= 2;
+  }
+  if (slots != slots_.size()) {
+    Grow(slots);
+  }
+}
+
+void ServerConfigSet::Clear() {
+  arena_.Clear();
+  configs_.clear();
+  extras_.clear();
+}
+
+void ServerConfigSet::Reserve(size_t configs, size_t text_bytes) {
+  configs_.reserve(configs);
+  // Идентификатор, адрес и имя сервера обычно свои, значения параметров
+  // повторяются
+  arena_.Reserve(text_bytes, configs * 4);
+}
+
+ServerConfig* ServerConfigSet::AddConfig(SubscriptionProtocol protocol, uint16_t port,
+                                         const char* text, TextSpan id, TextSpan address,
+                                         TextSpan tag) {
+  configs_.emplace_back();
+  ServerConfig* config = &configs_.back();
+  config->protocol = protocol;
+  config->port = port;
+  config->id = arena_.Intern(text + id.offset, id.length);
+  config->address = arena_.Intern(text + address.offset, address.length);
+  config->tag = arena_.Intern(text + tag.offset, tag.length);
+  config->first_extra = (uint32_t)extras_.size();
+  return config;
+}
+
+void ServerConfigSet::AddParam(ServerConfig* config, const char* key, size_t key_length,
+                               const char* value, size_t value_length) {
+  ConfigParam param;
+  if (FindConfigParam(key, key_length, &param)) {
+    // Повтор ключа - последнее значение, как при заполнении Map в Dart
+    config->known[(size_t)param] = arena_.Intern(value, value_length);
+    config->present |= 1u << (uint32_t)param;
+    return;
+  }
+  TextSpan key_span = arena_.Intern(key, key_length);
+  TextSpan value_span = arena_.Intern(value, value_length);
+  for (uint32_t i = 0; i < config->extra_count; i++) {
+    TextSpan& extra_key = extras_[config->first_extra + 2 * i];
+    if (extra_key.offset == key_span.offset && extra_key.length == key_span.length) {
+      extras_[config->first_extra + 2 * i + 1] = value_span;
+      return;
+    }
+  }
+  extras_.push_back(key_span);
+  extras_.push_back(value_span);
+  config->extra_count++;
+}
+
+void ServerConfigSet::Append(const std::vector<SubscriptionEntry>& entries,
+                             const std::vector<TextSpan>& params, const char* text) {
+  for (const SubscriptionEntry& entry : entries) {
+    ServerConfig* config =
+        AddConfig(entry.protocol, entry.port, text, entry.id, entry.address, entry.tag);
+    for (uint32_t p = 0; p < entry.param_count; p++) {
+      const TextSpan& key = params[entry.first_param + 2 * p];
+      const TextSpan& value = params[entry.first_param + 2 * p + 1];
+      AddParam(config, text + key.offset, key.length, text + value.offset, value.length);
+    }
+  }
+}
+
+void ServerConfigSet::Append(const ServerBlockView& block) {
+  auto span = [](const int32_t* fields) {
+    TextSpan result;
+    result.offset = (uint32_t)fields[0];
+    result.length = (uint32_t)fields[1];
+    return result;
+  };
+  for (size_t i = 0; i < block.count; i++) {
+    const int32_t* record = block.records + i * SUBSCRIPTION_RECORD_FIELDS;
+    ServerConfig* config = AddConfig((SubscriptionProtocol)record[SUBSCRIPTION_PROTOCOL],
+                                     (uint16_t)record[SUBSCRIPTION_PORT], block.text,
+                                     span(record + SUBSCRIPTION_ID_OFFSET),
+                                     span(record + SUBSCRIPTION_ADDRESS_OFFSET),
+                                     span(record + SUBSCRIPTION_TAG_OFFSET));
+    const int32_t* param = block.params + (size_t)record[SUBSCRIPTION_FIRST_PARAM] * 4;
+    for (int32_t p = 0; p < record[SUBSCRIPTION_PARAM_COUNT]; p++, param += 4) {
+      AddParam(config, block.text + param[0], (size_t)param[1], block.text + param[2],
+               (size_t)param[3]);
+    }
+  }
+}
+
+bool ServerConfigSet::Find(const ServerConfig& config, ConfigParam param,
+                           TextSpan* value) const {
+  if (!config.Has(param)) {
+    return false;
+  }
+  *value = config.known[(size_t)param];
+  return true;
+}
+
+bool ServerConfigSet::FindExtra(const ServerConfig& config, const char* name, size_t length,
+                                TextSpan* value) const {
+  const char* text = arena_.text();
+  for (uint32_t i = 0; i < config.extra_count; i++) {
+    const TextSpan& key = extras_[config.first_extra + 2 * i];
+    if (key.length == length && memcmp(text + key.offset, name, length) == 0) {
+      *value = extras_[config.first_extra + 2 * i + 1];
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,138 @@
+#ifndef RUNNER_SERVER_CONFIG_H_
+#define RUNNER_SERVER_CONFIG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "server_block.h"
+#include "subscription_parser.h"
+
+// Параметры ссылок, которые читают генераторы конфигураций
+enum class ConfigParam : uint8_t {
+  kType = 0,
+  kSecurity,
+  kSni,
+  kHost,
+  kPath,
+  kFlow,
+  kServiceName,
+  kEncryption,
+  kAllowInsecure,
+  kMethod,
+  kMultiMode,
+  kEnableUdp,
+  kAlpn,
+  kFingerprint,  // fp
+  kPublicKey,    // pbk
+  kShortId,      // sid
+  kSpiderX,      // spx
+  kHeaderType,
+  kMode,
+  kAuthority,
+  kPlugin,
+  kAlterId,         // aid
+  kVmessSecurity,   // scy
+  kCount,
+};
+
+constexpr size_t kConfigParamCount = (size_t)ConfigParam::kCount;
+static_assert(kConfigParamCount <= 32, "ServerConfig::present is 32 bits");
+
+// Имя параметра в ссылке
+const char* ConfigParamName(ConfigParam param);
+
+// Известный параметр по имени (с учетом регистра, как в Dart params[...])
+bool FindConfigParam(const char* name, size_t length, ConfigParam* param);
+
+// Пул строк без повторов: одна строка в памяти на все конфигурации.
+// Открытая адресация по хешу FNV-1a, ключ - спан в text(), так что
+// поиск и вставка не создают временных строк.
+class StringArena {
+ public:
+  StringArena();
+
+  TextSpan Intern(const char* data, size_t length);
+
+  // Указатель действителен до следующего Intern()
+  const char* text() const { return text_.data(); }
+  size_t text_size() const { return text_.size(); }
+  size_t unique_count() const { return used_; }
+
+  // Очистить, сохранив выделенную память
+  void Clear();
+  void Reserve(size_t text_bytes, size_t strings);
+
+ private:
+  struct Slot {
+    uint32_t hash = 0;
+    TextSpan span;  // length 0 - свободно
+  };
+
+  static uint32_t Hash(const char* data, size_t length);
+  void Grow(size_t slots);
+
+  std::string text_;
+  std::vector<Slot> slots_;
+  size_t used_ = 0;
+};
+
+// Сервер с параметрами по номерам: known[ConfigParam] и битовая маска
+// present (пустое значение и отсутствие различаются, как null и '' в
+// Dart). Параметры вне списка - пары в ServerConfigSet::extras().
+// Все строки - спаны в арене набора.
+struct ServerConfig {
+  SubscriptionProtocol protocol = SubscriptionProtocol::kVless;
+  uint16_t port = 0;
+  TextSpan id;
+  TextSpan address;
+  TextSpan tag;
+  uint32_t present = 0;
+  TextSpan known[kConfigParamCount];
+  uint32_t first_extra = 0;  // номер спана ключа первой пары
+  uint32_t extra_count = 0;
+
+  bool Has(ConfigParam param) const { return (present >> (uint32_t)param) & 1; }
+};
+
+// Набор конфигураций. Повторное заполнение после Clear() переиспользует
+// память, поэтому перевод подписки или списка из хранилища почти не
+// выделяет ее: строки и ключи сводятся в арену, известные ключи - в
+// номера параметров.
+class ServerConfigSet {
+ public:
+  void Clear();
+  void Reserve(size_t configs, size_t text_bytes);
+
+  // Серверы разбора подписки или списка (ServerList)
+  void Append(const std::vector<SubscriptionEntry>& entries, const std::vector<TextSpan>& params,
+              const char* text);
+  // Серверы блока (ответ разбора подписки, вид хранилища)
+  void Append(const ServerBlockView& block);
+
+  size_t size() const { return configs_.size(); }
+  const ServerConfig& operator[](size_t index) const { return configs_[index]; }
+
+  // Значение параметра; false - параметра нет
+  bool Find(const ServerConfig& config, ConfigParam param, TextSpan* value) const;
+  bool FindExtra(const ServerConfig& config, const char* name, size_t length,
+                 TextSpan* value) const;
+
+  const std::vector<TextSpan>& extras() const { return extras_; }
+  const char* text() const { return arena_.text(); }
+  const StringArena& arena() const { return arena_; }
+
+ private:
+  ServerConfig* AddConfig(SubscriptionProtocol protocol, uint16_t port, const char* text,
+                          TextSpan id, TextSpan address, TextSpan tag);
+  void AddParam(ServerConfig* config, const char* key, size_t key_length, const char* value,
+                size_t value_length);
+
+  StringArena arena_;
+  std::vector<ServerConfig> configs_;
+  std::vector<TextSpan> extras_;  // ключ, значение, ключ, ...
+};
+
+#endif  // RUNNER_SERVER_CONFIG_H_
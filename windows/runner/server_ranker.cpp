@@ -0,0 +1,540 @@
+#include "server_ranker.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#endif
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+
+// Сколько ждать отмены замеров при остановке
+constexpr int64_t kShutdownTimeoutUs = 2 * 1000 * 1000;
+
+// Типы записей TLS, которыми сервер может ответить на ClientHello
+constexpr uint8_t kTlsAlert = 0x15;
+constexpr uint8_t kTlsHandshake = 0x16;
+
+constexpr size_t kMaxHostName = 255;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t NextRandom(uint64_t* state) {
+  // xorshift64*: ClientHello нужна только непредсказуемость для сервера
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+void FillRandom(uint64_t* state, uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i += 8) {
+    uint64_t value = NextRandom(state);
+    memcpy(data + i, &value, std::min<size_t>(8, length - i));
+  }
+}
+
+class Writer {
+ public:
+  explicit Writer(uint8_t* data) : data_(data) {}
+
+  void U8(uint8_t value) { data_[length_++] = value; }
+  void U16(uint16_t value) {
+    U8((uint8_t)(value >> 8));
+    U8((uint8_t)value);
+  }
+  void Bytes(const void* data, size_t length) {
+    memcpy(data_ + length_, data, length);
+    length_ += length;
+  }
+
+  // Место под длину, заполняемую в EndLength()
+  size_t BeginLength(size_t width) {
+    size_t at = length_;
+    length_ += width;
+    return at;
+  }
+  void EndLength(size_t at, size_t width) {
+    size_t value = length_ - at - width;
+    for (size_t i = 0; i < width; i++) {
+      data_[at + i] = (uint8_t)(value >> (8 * (width - 1 - i)));
+    }
+  }
+
+  size_t length() const { return length_; }
+
+ private:
+  uint8_t* data_;
+  size_t length_ = 0;
+};
+
+// ClientHello, на который отвечают и серверы TLS 1.2, и серверы TLS 1.3
+// (включая REALITY). Ключ X25519 - случайные байты: рукопожатие дальше
+// ServerHello не продолжается.
+size_t BuildClientHello(const std::string& sni, uint64_t* random, uint8_t* out) {
+  static const uint16_t kCipherSuites[] = {0x1301, 0x1302, 0x1303, 0xc02b, 0xc02f,
+                                           0xc02c, 0xc030, 0xcca9, 0xcca8};
+  static const uint16_t kSignatureAlgorithms[] = {0x0403, 0x0804, 0x0401, 0x0503,
+                                                  0x0805, 0x0501, 0x0806, 0x0601};
+  Writer w(out);
+  w.U8(kTlsHandshake);
+  w.U16(0x0301);
+  size_t record = w.BeginLength(2);
+  w.U8(0x01);  // ClientHello
+  size_t hello = w.BeginLength(3);
+  w.U16(0x0303);
+  uint8_t bytes[32];
+  FillRandom(random, bytes, sizeof(bytes));
+  w.Bytes(bytes, sizeof(bytes));
+  w.U8(32);  // session_id для совместимости с промежуточными узлами
+  FillRandom(random, bytes, sizeof(bytes));
+  w.Bytes(bytes, sizeof(bytes));
+  w.U16(sizeof(kCipherSuites));
+  for (uint16_t suite : kCipherSuites) {
+    w.U16(suite);
+  }
+  w.U8(1);
+  w.U8(0);  // без сжатия
+
+  size_t extensions = w.BeginLength(2);
+  if (!sni.empty()) {
+    w.U16(0x0000);  // server_name
+    size_t extension = w.BeginLength(2);
+    size_t list = w.BeginLength(2);
+    w.U8(0);  // host_name
+    w.U16((uint16_t)sni.size());
+    w.Bytes(sni.data(), sni.size());
+    w.EndLength(list, 2);
+    w.EndLength(extension, 2);
+  }
+  w.U16(0x000a);  // supported_groups: x25519, secp256r1
+  w.U16(6);
+  w.U16(4);
+  w.U16(0x001d);
+  w.U16(0x0017);
+  w.U16(0x000b);  // ec_point_formats: uncompressed
+  w.U16(2);
+  w.U8(1);
+  w.U8(0);
+  w.U16(0x000d);  // signature_algorithms
+  w.U16(2 + sizeof(kSignatureAlgorithms));
+  w.U16(sizeof(kSignatureAlgorithms));
+  for (uint16_t algorithm : kSignatureAlgorithms) {
+    w.U16(algorithm);
+  }
+  w.U16(0x002b);  // supported_versions: TLS 1.3, TLS 1.2
+  w.U16(5);
+  w.U8(4);
+  w.U16(0x0304);
+  w.U16(0x0303);
+  w.U16(0x002d);  // psk_key_exchange_modes: psk_dhe_ke
+  w.U16(2);
+  w.U8(1);
+  w.U8(1);
+  w.U16(0x0033);  // key_share: x25519
+  w.U16(2 + 4 + 32);
+  w.U16(4 + 32);
+  w.U16(0x001d);
+  w.U16(32);
+  FillRandom(random, bytes, sizeof(bytes));
+  w.Bytes(bytes, sizeof(bytes));
+  w.EndLength(extensions, 2);
+
+  w.EndLength(hello, 3);
+  w.EndLength(record, 2);
+  return w.length();
+}
+
+uint32_t Median(std::vector<uint32_t> samples) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Средний модуль отклонения от среднего
+uint32_t MeanDeviation(const std::vector<uint32_t>& samples) {
+  if (samples.size() < 2) {
+    return 0;
+  }
+  uint64_t sum = 0;
+  for (uint32_t sample : samples) {
+    sum += sample;
+  }
+  uint64_t mean = sum / samples.size();
+  uint64_t deviation = 0;
+  for (uint32_t sample : samples) {
+    deviation += sample > mean ? sample - mean : mean - sample;
+  }
+  return (uint32_t)(deviation / samples.size());
+}
+
+}  // namespace
+
+// Одна попытка: connect, затем для TLS - ClientHello и чтение ответа.
+// Попытка завершается, когда исход известен и все операции вернулись.
+class ServerRanker::Probe : public IoHandler {
+ public:
+  explicit Probe(ServerRanker* owner) : owner_(owner) {
+    connect_op.handler = this;
+    connect_op.type = IoOpType::kConnect;
+    write_op.handler = this;
+    write_op.type = IoOpType::kWrite;
+    read_op.handler = this;
+    read_op.type = IoOpType::kRead;
+  }
+
+  void Begin(size_t index, SocketHandle socket, const Job& target, int64_t now_us,
+             int64_t deadline) {
+    job = index;
+    connect_op.socket = socket;
+    connect_op.address = target.address;
+    connect_op.address_length = target.length;
+    write_op.socket = socket;
+    read_op.socket = socket;
+    started_us = now_us;
+    deadline_us = deadline;
+    connect_us = 0;
+    tls_us = 0;
+    pending = 0;
+    active = true;
+    settled = false;
+    ok = false;
+  }
+
+  void OnIoComplete(IoOp* op) override {
+    pending--;
+    if (!settled) {
+      if (op == &connect_op) {
+        OnConnected();
+      } else if (op == &write_op) {
+        if (op->error != 0) {
+          Settle(false);
+        }
+      } else if (op->error != 0 || op->transferred == 0 ||
+                 (reply[0] != kTlsHandshake && reply[0] != kTlsAlert)) {
+        Settle(false);
+      } else {
+        tls_us = (uint32_t)(NowUs() - started_us) - connect_us;
+        Settle(true);
+      }
+    }
+    if (settled && pending == 0) {
+      owner_->OnProbeComplete(this, ok);
+    }
+  }
+
+  // Исход известен: сокет закрывается, незавершенные операции вернутся
+  // с ошибкой
+  void Settle(bool success) {
+    settled = true;
+    ok = success;
+    owner_->reactor_->Close(connect_op.socket);
+  }
+
+  bool Submit(IoOp* op) {
+    pending++;
+    if (!owner_->reactor_->Submit(op)) {
+      pending--;
+      return false;
+    }
+    return true;
+  }
+
+  IoOp connect_op;
+  IoOp write_op;
+  IoOp read_op;
+  size_t job = 0;
+  int64_t started_us = 0;
+  int64_t deadline_us = 0;
+  uint32_t connect_us = 0;
+  uint32_t tls_us = 0;
+  int pending = 0;
+  bool active = false;
+  bool settled = false;
+  bool ok = false;
+  uint8_t hello[512];
+  char reply[16];
+
+ private:
+  void OnConnected() {
+    if (connect_op.error != 0) {
+      Settle(false);
+      return;
+    }
+    connect_us = (uint32_t)(NowUs() - started_us);
+    const RankTarget& target = owner_->jobs_[job].target;
+    if (!target.tls) {
+      Settle(true);
+      return;
+    }
+    // Время рукопожатия - от отправки ClientHello до первого байта ответа
+    std::string sni = target.sni;
+    sockaddr_storage literal;
+    int literal_length;
+    if (sni.empty() && !ParseIpLiteral(target.host, 0, &literal, &literal_length)) {
+      sni = target.host;
+    }
+    if (sni.size() > kMaxHostName) {
+      sni.clear();
+    }
+    write_op.buffer = (char*)hello;
+    write_op.length = BuildClientHello(sni, &owner_->random_state_, hello);
+    read_op.buffer = reply;
+    read_op.length = sizeof(reply);
+    if (!Submit(&write_op) || !Submit(&read_op)) {
+      Settle(false);
+    }
+  }
+
+  ServerRanker* owner_;
+};
+
+ServerRanker::ServerRanker() = default;
+
+ServerRanker::~ServerRanker() { Cancel(); }
+
+bool ServerRanker::Start(std::vector<RankTarget> targets, const Options& options,
+                         ResultCallback on_result) {
+  Cancel();
+  reactor_ = Reactor::Create();
+  if (!reactor_) {
+    return false;
+  }
+  options_ = options;
+  if (options_.max_in_flight == 0) {
+    options_.max_in_flight = 1;
+  }
+  if (options_.attempts == 0) {
+    options_.attempts = 1;
+  }
+  resolver_.reset(
+      new HostResolver(options_.resolver_threads == 0 ? 1 : options_.resolver_threads));
+  on_result_ = std::move(on_result);
+
+  jobs_.clear();
+  jobs_.resize(targets.size());
+  for (size_t i = 0; i < targets.size(); i++) {
+    jobs_[i].target = std::move(targets[i]);
+  }
+  ready_.clear();
+  probes_.clear();
+  free_probes_.clear();
+  for (size_t i = 0; i < std::min(options_.max_in_flight, jobs_.size()); i++) {
+    probes_.emplace_back(new Probe(this));
+    free_probes_.push_back(probes_.back().get());
+  }
+  random_state_ = (uint64_t)NowUs() ^ (uint64_t)(uintptr_t)this;
+  if (random_state_ == 0) {
+    random_state_ = 1;
+  }
+  {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results_.clear();
+  }
+  total_.store(jobs_.size(), std::memory_order_relaxed);
+  completed_.store(0, std::memory_order_relaxed);
+  cancelled_.store(false, std::memory_order_relaxed);
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&ServerRanker::Loop, this);
+  return true;
+}
+
+void ServerRanker::Cancel() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  cancelled_.store(true, std::memory_order_release);
+  reactor_->Wake();
+  thread_.join();
+  resolver_.reset();
+  reactor_.reset();
+  probes_.clear();
+  free_probes_.clear();
+}
+
+std::vector<RankResult> ServerRanker::Results() const {
+  std::vector<RankResult> results;
+  {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results = results_;
+  }
+  std::sort(results.begin(), results.end(), [](const RankResult& a, const RankResult& b) {
+    return a.score != b.score ? a.score < b.score : a.index < b.index;
+  });
+  return results;
+}
+
+void ServerRanker::Loop() {
+  // IP-литералы готовы сразу, имена разрешает пул
+  for (size_t i = 0; i < jobs_.size(); i++) {
+    Job& job = jobs_[i];
+    if (ParseIpLiteral(job.target.host, job.target.port, &job.address, &job.length)) {
+      job.state = JobState::kReady;
+      ready_.push_back(i);
+      continue;
+    }
+    resolver_->Resolve(job.target.host, job.target.port,
+                       [this, i](bool ok, const sockaddr_storage& address, int length) {
+                         {
+                           std::lock_guard<std::mutex> lock(resolved_mutex_);
+                           resolved_.push_back(Resolved{i, ok, address, length});
+                         }
+                         reactor_->Wake();
+                       });
+  }
+
+  while (!cancelled_.load(std::memory_order_acquire) &&
+         completed_.load(std::memory_order_relaxed) < jobs_.size()) {
+    int64_t now = NowUs();
+    ApplyResolved();
+    Launch(now);
+    Expire(now);
+
+    int64_t wake = now + kPollTimeoutMs * 1000;
+    for (const auto& probe : probes_) {
+      if (probe->active && !probe->settled && probe->deadline_us < wake) {
+        wake = probe->deadline_us;
+      }
+    }
+    int64_t wait_ms = (wake - now + 999) / 1000;
+    reactor_->Poll(wait_ms < 0 ? 0 : (int)wait_ms);
+  }
+
+  // Отменяем незавершенные попытки и дожидаемся их завершений
+  int64_t deadline = NowUs() + kShutdownTimeoutUs;
+  Expire(INT64_MAX);
+  while (free_probes_.size() < probes_.size() && NowUs() < deadline) {
+    reactor_->Poll(kPollTimeoutMs);
+  }
+  resolver_->Shutdown();
+  running_.store(false, std::memory_order_release);
+}
+
+void ServerRanker::ApplyResolved() {
+  std::vector<Resolved> resolved;
+  {
+    std::lock_guard<std::mutex> lock(resolved_mutex_);
+    resolved.swap(resolved_);
+  }
+  for (const Resolved& entry : resolved) {
+    Job& job = jobs_[entry.job];
+    if (job.state != JobState::kResolving) {
+      continue;
+    }
+    if (!entry.ok) {
+      Finish(entry.job);
+      continue;
+    }
+    job.address = entry.address;
+    job.length = entry.length;
+    job.state = JobState::kReady;
+    ready_.push_back(entry.job);
+  }
+}
+
+void ServerRanker::Launch(int64_t now_us) {
+  while (!ready_.empty() && !free_probes_.empty()) {
+    size_t index = ready_.front();
+    ready_.pop_front();
+    Job& job = jobs_[index];
+
+    SocketHandle socket = ::socket(job.address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (socket == kInvalidSocket) {
+      ready_.push_front(index);  // кончились дескрипторы: подождем завершений
+      return;
+    }
+    if (!SetSocketNonBlocking(socket) || !reactor_->Attach(socket)) {
+      CloseSocketHandle(socket);
+      ready_.push_front(index);
+      return;
+    }
+
+    Probe* probe = free_probes_.back();
+    free_probes_.pop_back();
+    probe->Begin(index, socket, job, now_us, now_us + (int64_t)options_.timeout_ms * 1000);
+    if (!probe->Submit(&probe->connect_op)) {
+      probe->Settle(false);
+      OnProbeComplete(probe, false);
+    }
+  }
+}
+
+void ServerRanker::Expire(int64_t now_us) {
+  for (const auto& probe : probes_) {
+    if (probe->active && !probe->settled && now_us >= probe->deadline_us) {
+      // Завершения с отменой придут через Poll()
+      probe->Settle(false);
+    }
+  }
+}
+
+void ServerRanker::OnProbeComplete(Probe* probe, bool ok) {
+  probe->active = false;
+  free_probes_.push_back(probe);
+  if (cancelled_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  size_t index = probe->job;
+  Job& job = jobs_[index];
+  job.attempts++;
+  if (ok) {
+    job.connect_samples.push_back(probe->connect_us);
+    if (job.target.tls) {
+      job.tls_samples.push_back(probe->tls_us);
+    }
+  }
+  // Недоступный сервер не тратит остальные попытки
+  bool unreachable = !ok && job.connect_samples.empty();
+  if (unreachable || job.attempts >= options_.attempts) {
+    Finish(index);
+  } else {
+    ready_.push_back(index);
+  }
+}
+
+void ServerRanker::Finish(size_t index) {
+  Job& job = jobs_[index];
+  job.state = JobState::kDone;
+
+  RankResult result;
+  result.index = index;
+  result.attempts = job.attempts;
+  result.successes = (uint32_t)job.connect_samples.size();
+  if (result.successes == 0) {
+    result.score = RankResult::kUnreachable;
+  } else {
+    result.connect_us = Median(job.connect_samples);
+    result.jitter_us = MeanDeviation(job.connect_samples);
+    result.tls_us = Median(job.tls_samples);
+    uint64_t base = (uint64_t)result.connect_us + result.tls_us + 2 * (uint64_t)result.jitter_us;
+    uint32_t failures = result.attempts - result.successes;
+    uint64_t score = base * (result.attempts + 3 * (uint64_t)failures) / result.attempts;
+    result.score = score >= RankResult::kUnreachable ? RankResult::kUnreachable - 1
+                                                     : (uint32_t)score;
+  }
+  job.connect_samples.clear();
+  job.tls_samples.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results_.push_back(result);
+  }
+  completed_.fetch_add(1, std::memory_order_relaxed);
+  if (on_result_) {
+    on_result_(result);
+  }
+}
@@ -0,0 +1,141 @@
+#ifndef RUNNER_SERVER_RANKER_H_
+#define RUNNER_SERVER_RANKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_resolver.h"
+#include "reactor.h"
+
+// Сервер для оценки
+struct RankTarget {
+  std::string host;  // имя или IP-литерал
+  uint16_t port = 0;
+  bool tls = false;  // замерять и TLS-рукопожатие
+  std::string sni;   // пусто - host, если это имя
+};
+
+// Итог оценки одного сервера
+struct RankResult {
+  size_t index = 0;         // номер в исходном списке
+  uint32_t connect_us = 0;  // медиана времени установки соединения
+  uint32_t jitter_us = 0;   // средний разброс времени соединения
+  uint32_t tls_us = 0;      // медиана времени до ответа на ClientHello
+  uint32_t attempts = 0;
+  uint32_t successes = 0;
+  uint32_t score = 0;       // меньше - лучше; kUnreachable - сервер недоступен
+
+  static constexpr uint32_t kUnreachable = UINT32_MAX;
+};
+
+// Массовая оценка серверов подписки.
+//
+// Один поток на собственном Reactor ведет не больше max_in_flight замеров
+// одновременно: connect(), а для TLS-серверов еще ClientHello и ожидание
+// первого байта ответа (ServerHello или alert) - это время рукопожатия без
+// проверки сертификата. Попытки разных серверов чередуются. Сервер, первая
+// попытка которого не удалась, дальше не проверяется: за время таймаута
+// ядро уже повторило SYN.
+//
+// Композитная оценка - (connect + tls + 2 * jitter), увеличенная на долю
+// неудачных попыток: score = base * (1 + 3 * failures / attempts).
+//
+// Результаты по мере готовности передаются в callback (из потока оценки) и
+// доступны через Results(), отсортированные по оценке.
+class ServerRanker {
+ public:
+  using ResultCallback = std::function<void(const RankResult& result)>;
+
+  struct Options {
+    size_t max_in_flight = 64;
+    uint32_t attempts = 3;
+    uint32_t timeout_ms = 1500;  // на попытку целиком (соединение и TLS)
+    size_t resolver_threads = 8;
+  };
+
+  ServerRanker();
+  ~ServerRanker();
+
+  ServerRanker(const ServerRanker&) = delete;
+  ServerRanker& operator=(const ServerRanker&) = delete;
+
+  // Начать оценку; прежняя оценка прерывается. |on_result| может быть
+  // пустым.
+  bool Start(std::vector<RankTarget> targets, const Options& options,
+             ResultCallback on_result);
+
+  // Прервать оценку и дождаться потока. Готовые результаты сохраняются.
+  void Cancel();
+
+  // Идет ли оценка
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  size_t total() const { return total_.load(std::memory_order_relaxed); }
+  size_t completed() const { return completed_.load(std::memory_order_relaxed); }
+
+  // Готовые результаты, лучшие первыми
+  std::vector<RankResult> Results() const;
+
+ private:
+  class Probe;
+
+  enum class JobState : uint8_t { kResolving, kReady, kDone };
+
+  struct Job {
+    RankTarget target;
+    JobState state = JobState::kResolving;
+    sockaddr_storage address = {};
+    int length = 0;
+    uint32_t attempts = 0;
+    std::vector<uint32_t> connect_samples;
+    std::vector<uint32_t> tls_samples;
+  };
+
+  struct Resolved {
+    size_t job;
+    bool ok;
+    sockaddr_storage address;
+    int length;
+  };
+
+  void Loop();
+  void ApplyResolved();
+  void Launch(int64_t now_us);
+  void Expire(int64_t now_us);
+  void OnProbeComplete(Probe* probe, bool ok);
+  void Finish(size_t index);
+
+  Options options_;
+  ResultCallback on_result_;
+  std::unique_ptr<Reactor> reactor_;
+  std::unique_ptr<HostResolver> resolver_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> cancelled_{false};
+  std::atomic<size_t> total_{0};
+  std::atomic<size_t> completed_{0};
+
+  // Поток оценки
+  std::vector<Job> jobs_;
+  std::deque<size_t> ready_;
+  std::vector<std::unique_ptr<Probe>> probes_;
+  std::vector<Probe*> free_probes_;
+  uint64_t random_state_ = 0;
+
+  std::mutex resolved_mutex_;
+  std::vector<Resolved> resolved_;
+
+  mutable std::mutex results_mutex_;
+  std::vector<RankResult> results_;
+};
+
+#endif  // RUNNER_SERVER_RANKER_H_
@@ -0,0 +1,663 @@
+#include "server_store.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "native_log.h"
+
+namespace {
+
+const char kSnapshotMagic[8] = {'V', 'P', 'N', 'S', 'R', 'V', 'D', 'B'};
+const char kLogMagic[8] = {'V', 'P', 'N', 'S', 'R', 'V', 'L', 'G'};
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_ints;
+  uint64_t generation;
+  uint32_t checksum;  // CRC32 блока
+  uint32_t reserved;
+};
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout");
+
+struct LogHeader {
+  char magic[8];
+  uint64_t generation;  // поколение снимка, к которому относится журнал
+};
+static_assert(sizeof(LogHeader) == 16, "LogHeader layout");
+
+// Запись журнала: длина и CRC32 данных, затем данные - числа int32
+// {операция, позиция, количество[, блок вставляемых серверов]}
+struct LogRecordHeader {
+  uint32_t length;
+  uint32_t checksum;
+};
+
+constexpr size_t kLogOpFields = 3;
+
+// CRC32 (полином 0xEDB88320) по 8 байт за шаг: снимок проверяется при
+// каждом запуске, и побайтовая таблица заняла бы большую часть открытия
+struct Crc32Table {
+  uint32_t values[8][256];
+
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+      }
+      values[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      for (int slice = 1; slice < 8; slice++) {
+        uint32_t previous = values[slice - 1][i];
+        values[slice][i] = values[0][previous & 0xFF] ^ (previous >> 8);
+      }
+    }
+  }
+};
+
+const Crc32Table kCrc32;
+
+uint32_t Crc32(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  const uint32_t(*t)[256] = kCrc32.values;
+  uint32_t crc = 0xFFFFFFFFu;
+  while (length >= 8) {
+    uint32_t low = crc ^ ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 |
+                          (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+    crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^
+          t[4][low >> 24] ^ t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    bytes += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    crc = t[0][(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+TextSpan InternText(const char* data, size_t length, std::string* pool,
+                    std::unordered_map<std::string, uint32_t>* interned) {
+  TextSpan span;
+  if (length == 0) {
+    return span;
+  }
+  auto inserted = interned->emplace(std::string(data, length), (uint32_t)pool->size());
+  if (inserted.second) {
+    pool->append(data, length);
+  }
+  span.offset = inserted.first->second;
+  span.length = (uint32_t)length;
+  return span;
+}
+
+// Скопировать серверы |entries| из |source| в |target| со сведением строк
+void CopyServers(const ServerList& source, const SubscriptionEntry* entries, size_t count,
+                 ServerList* target, std::unordered_map<std::string, uint32_t>* interned,
+                 std::vector<SubscriptionEntry>* out) {
+  auto intern = [&](TextSpan span) {
+    return InternText(source.text.data() + span.offset, span.length, &target->text, interned);
+  };
+  for (size_t i = 0; i < count; i++) {
+    SubscriptionEntry entry = entries[i];
+    entry.id = intern(entry.id);
+    entry.address = intern(entry.address);
+    entry.tag = intern(entry.tag);
+    uint32_t first = entry.first_param;
+    entry.first_param = (uint32_t)target->params.size();
+    for (uint32_t p = 0; p < entry.param_count * 2; p++) {
+      target->params.push_back(intern(source.params[first + p]));
+    }
+    out->push_back(entry);
+  }
+}
+
+#if defined(_WIN32)
+
+std::wstring Widen(const std::string& text) {
+  int size = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), NULL, 0);
+  std::wstring result(size > 0 ? size : 0, L'\0');
+  if (size > 0) {
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &result[0], size);
+  }
+  return result;
+}
+
+bool MapFile(const std::string& path, const uint8_t** data, size_t* size) {
+  HANDLE file = CreateFileW(Widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  bool ok = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 &&
+            (uint64_t)file_size.QuadPart <= (uint64_t)INT32_MAX;
+  void* view = NULL;
+  if (ok) {
+    // Отображение держит файл открытым и после закрытия описателей
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+      view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+  if (view == NULL) {
+    return false;
+  }
+  *data = (const uint8_t*)view;
+  *size = (size_t)file_size.QuadPart;
+  return true;
+}
+
+void UnmapFile(const uint8_t* data, size_t size) {
+  (void)size;
+  UnmapViewOfFile(data);
+}
+
+bool ReadWholeFile(const std::string& path, std::string* content) {
+  HANDLE file = CreateFileW(Widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  char buffer[64 * 1024];
+  DWORD read = 0;
+  while (ReadFile(file, buffer, sizeof(buffer), &read, NULL) && read > 0) {
+    content->append(buffer, read);
+  }
+  CloseHandle(file);
+  return true;
+}
+
+// Записать файл целиком: временный файл, сброс на диск, атомарная замена
+bool WriteFileAtomically(const std::string& path, const void* data, size_t size) {
+  std::wstring target = Widen(path);
+  std::wstring temporary = target + L".tmp";
+  HANDLE file = CreateFileW(temporary.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  const char* bytes = (const char*)data;
+  bool ok = true;
+  while (ok && size > 0) {
+    DWORD written = 0;
+    DWORD chunk = (DWORD)std::min<size_t>(size, 1 << 30);
+    ok = WriteFile(file, bytes, chunk, &written, NULL) && written > 0;
+    bytes += written;
+    size -= written;
+  }
+  ok = ok && FlushFileBuffers(file);
+  CloseHandle(file);
+  ok = ok && MoveFileExW(temporary.c_str(), target.c_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+  if (!ok) {
+    DeleteFileW(temporary.c_str());
+  }
+  return ok;
+}
+
+#else
+
+bool MapFile(const std::string& path, const uint8_t** data, size_t* size) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  void* view = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0 && (uint64_t)info.st_size <= (uint64_t)INT32_MAX) {
+    view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+  *data = (const uint8_t*)view;
+  *size = (size_t)info.st_size;
+  return true;
+}
+
+void UnmapFile(const uint8_t* data, size_t size) { munmap((void*)data, size); }
+
+bool ReadWholeFile(const std::string& path, std::string* content) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  char buffer[64 * 1024];
+  ssize_t read_bytes;
+  while ((read_bytes = read(fd, buffer, sizeof(buffer))) > 0) {
+    content->append(buffer, (size_t)read_bytes);
+  }
+  close(fd);
+  return true;
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+  const char* bytes = (const char*)data;
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+bool WriteFileAtomically(const std::string& path, const void* data, size_t size) {
+  std::string temporary = path + ".tmp";
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = WriteAll(fd, data, size) && fsync(fd) == 0;
+  close(fd);
+  ok = ok && rename(temporary.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    unlink(temporary.c_str());
+  }
+  return ok;
+}
+
+#endif
+
+}  // namespace
+
+ServerStore::ServerStore() {}
+
+ServerStore::~ServerStore() { Close(); }
+
+bool ServerStore::Open(const std::string& directory) {
+  Close();
+  snapshot_path_ = directory + "/servers.db";
+  log_path_ = directory + "/servers.log";
+  if (!MapSnapshot() || !ReplayLog()) {
+    Close();
+    return false;
+  }
+  open_ = true;
+  return true;
+}
+
+void ServerStore::Close() {
+  CloseLog();
+  Unmap();
+  open_ = false;
+  materialized_ = false;
+  list_ = ServerList();
+  interned_.clear();
+  view_.clear();
+  view_dirty_ = true;
+  generation_ = 0;
+  snapshot_bytes_ = 0;
+  log_bytes_ = 0;
+}
+
+const int32_t* ServerStore::View(size_t* ints) {
+  if (!materialized_ && mapped_block_ != nullptr) {
+    *ints = mapped_ints_;
+    return mapped_block_;
+  }
+  if (view_dirty_) {
+    EncodeServerBlock(list_.entries, list_.params, list_.text, 0, &view_);
+    view_dirty_ = false;
+  }
+  *ints = view_.size();
+  return view_.data();
+}
+
+size_t ServerStore::size() const {
+  if (materialized_) {
+    return list_.entries.size();
+  }
+  return mapped_block_ != nullptr ? (size_t)mapped_block_[SUBSCRIPTION_ENTRIES] : 0;
+}
+
+bool ServerStore::Insert(size_t position, const ServerList& servers) {
+  if (!open_ || position > size()) {
+    return false;
+  }
+  if (servers.entries.empty()) {
+    return true;
+  }
+  std::vector<int32_t> payload = {kLogInsert, (int32_t)position,
+                                  (int32_t)servers.entries.size()};
+  std::vector<int32_t> block;
+  EncodeServerBlock(servers.entries, servers.params, servers.text, 0, &block);
+  payload.insert(payload.end(), block.begin(), block.end());
+  ServerBlockView view;
+  // Сначала журнал, потом список: сбой между ними не теряет правку
+  if (!DecodeServerBlock(payload.data() + kLogOpFields, block.size(), &view) ||
+      !Materialize() || !AppendLog(payload)) {
+    return false;
+  }
+  ApplyInsert(position, view);
+  return CompactIfNeeded();
+}
+
+bool ServerStore::Remove(size_t position, size_t count) {
+  if (!open_ || count == 0 || position > size() || count > size() - position) {
+    return false;
+  }
+  std::vector<int32_t> payload = {kLogRemove, (int32_t)position, (int32_t)count};
+  if (!Materialize() || !AppendLog(payload)) {
+    return false;
+  }
+  ApplyRemove(position, count);
+  return CompactIfNeeded();
+}
+
+bool ServerStore::Replace(const ServerList& servers) {
+  return open_ && WriteSnapshot(servers);
+}
+
+bool ServerStore::Compact() {
+  return open_ && Materialize() && WriteSnapshot(list_);
+}
+
+bool ServerStore::MapSnapshot() {
+  if (!MapFile(snapshot_path_, &map_data_, &map_size_)) {
+    // Снимка еще нет - пустой список поколения 0
+    map_data_ = nullptr;
+    map_size_ = 0;
+    return true;
+  }
+  SnapshotHeader header;
+  if (map_size_ < sizeof(header)) {
+    LOG_ERROR("Хранилище серверов повреждено: %s", snapshot_path_.c_str());
+    return false;
+  }
+  memcpy(&header, map_data_, sizeof(header));
+  if (memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+      header.version != kVersion) {
+    LOG_ERROR("Неизвестный формат хранилища серверов: %s", snapshot_path_.c_str());
+    return false;
+  }
+  const int32_t* block = (const int32_t*)(map_data_ + sizeof(header));
+  size_t block_bytes = (size_t)header.block_ints * sizeof(int32_t);
+  ServerBlockView view;
+  if (block_bytes > map_size_ - sizeof(header) || Crc32(block, block_bytes) != header.checksum ||
+      !DecodeServerBlock(block, header.block_ints, &view)) {
+    LOG_ERROR("Хранилище серверов повреждено: %s", snapshot_path_.c_str());
+    return false;
+  }
+  mapped_block_ = block;
+  mapped_ints_ = header.block_ints;
+  generation_ = header.generation;
+  snapshot_bytes_ = map_size_;
+  return true;
+}
+
+bool ServerStore::Materialize() {
+  if (materialized_) {
+    return true;
+  }
+  list_ = ServerList();
+  interned_.clear();
+  if (mapped_block_ != nullptr) {
+    // Блок снимка проверен при открытии. Его строки в interned_ не
+    // попадают: повтор новой строки со старой уберет сжатие, а первая
+    // правка не платит за разбор всего пула.
+    ServerBlockView view;
+    DecodeServerBlock(mapped_block_, mapped_ints_, &view);
+    list_.text.assign(view.text, view.text_length);
+    auto adopt = [](int32_t offset, int32_t length) {
+      TextSpan span;
+      span.offset = (uint32_t)offset;
+      span.length = (uint32_t)length;
+      return span;
+    };
+    list_.params.reserve(view.param_pairs * 2);
+    for (size_t i = 0; i < view.param_pairs * 2; i++) {
+      list_.params.push_back(adopt(view.params[2 * i], view.params[2 * i + 1]));
+    }
+    list_.entries.resize(view.count);
+    for (size_t i = 0; i < view.count; i++) {
+      const int32_t* record = view.records + i * SUBSCRIPTION_RECORD_FIELDS;
+      SubscriptionEntry& entry = list_.entries[i];
+      entry.protocol = (SubscriptionProtocol)record[SUBSCRIPTION_PROTOCOL];
+      entry.port = (uint16_t)record[SUBSCRIPTION_PORT];
+      entry.id = adopt(record[SUBSCRIPTION_ID_OFFSET], record[SUBSCRIPTION_ID_LENGTH]);
+      entry.address =
+          adopt(record[SUBSCRIPTION_ADDRESS_OFFSET], record[SUBSCRIPTION_ADDRESS_LENGTH]);
+      entry.tag = adopt(record[SUBSCRIPTION_TAG_OFFSET], record[SUBSCRIPTION_TAG_LENGTH]);
+      entry.first_param = (uint32_t)record[SUBSCRIPTION_FIRST_PARAM] * 2;
+      entry.param_count = (uint32_t)record[SUBSCRIPTION_PARAM_COUNT];
+    }
+  }
+  // Дальше список живет в памяти, и снимок можно подменять
+  Unmap();
+  materialized_ = true;
+  view_dirty_ = true;
+  return true;
+}
+
+void ServerStore::ApplyInsert(size_t position, const ServerBlockView& block) {
+  std::vector<SubscriptionEntry> added;
+  added.reserve(block.count);
+  auto intern = [this, &block](int32_t offset, int32_t length) {
+    return InternText(block.text + offset, (size_t)length, &list_.text, &interned_);
+  };
+  for (size_t i = 0; i < block.count; i++) {
+    const int32_t* record = block.records + i * SUBSCRIPTION_RECORD_FIELDS;
+    SubscriptionEntry entry;
+    entry.protocol = (SubscriptionProtocol)record[SUBSCRIPTION_PROTOCOL];
+    entry.port = (uint16_t)record[SUBSCRIPTION_PORT];
+    entry.id = intern(record[SUBSCRIPTION_ID_OFFSET], record[SUBSCRIPTION_ID_LENGTH]);
+    entry.address = intern(record[SUBSCRIPTION_ADDRESS_OFFSET], record[SUBSCRIPTION_ADDRESS_LENGTH]);
+    entry.tag = intern(record[SUBSCRIPTION_TAG_OFFSET], record[SUBSCRIPTION_TAG_LENGTH]);
+    entry.first_param = (uint32_t)list_.params.size();
+    entry.param_count = (uint32_t)record[SUBSCRIPTION_PARAM_COUNT];
+    const int32_t* param = block.params + (size_t)record[SUBSCRIPTION_FIRST_PARAM] * 4;
+    for (uint32_t p = 0; p < entry.param_count * 2; p++) {
+      list_.params.push_back(intern(param[2 * p], param[2 * p + 1]));
+    }
+    added.push_back(entry);
+  }
+  list_.entries.insert(list_.entries.begin() + position, added.begin(), added.end());
+  view_dirty_ = true;
+}
+
+void ServerStore::ApplyRemove(size_t position, size_t count) {
+  // Строки и параметры удаленных серверов остаются в пуле до сжатия
+  list_.entries.erase(list_.entries.begin() + position,
+                      list_.entries.begin() + position + count);
+  view_dirty_ = true;
+}
+
+bool ServerStore::ReplayLog() {
+  std::string log;
+  size_t good = 0;
+  size_t applied = 0;
+  LogHeader header;
+  if (ReadWholeFile(log_path_, &log) && log.size() >= sizeof(header)) {
+    memcpy(&header, log.data(), sizeof(header));
+    if (memcmp(header.magic, kLogMagic, sizeof(kLogMagic)) == 0 &&
+        header.generation == generation_) {
+      good = sizeof(header);
+    }
+  }
+  std::vector<int32_t> payload;
+  while (good > 0 && good + sizeof(LogRecordHeader) <= log.size()) {
+    LogRecordHeader record;
+    memcpy(&record, log.data() + good, sizeof(record));
+    const char* data = log.data() + good + sizeof(record);
+    if (record.length % sizeof(int32_t) != 0 || record.length < kLogOpFields * sizeof(int32_t) ||
+        record.length > log.size() - good - sizeof(record) ||
+        Crc32(data, record.length) != record.checksum) {
+      break;
+    }
+    payload.resize(record.length / sizeof(int32_t));
+    memcpy(payload.data(), data, record.length);
+    int32_t op = payload[0];
+    size_t position = (size_t)(uint32_t)payload[1];
+    size_t count = (size_t)(uint32_t)payload[2];
+    if (!Materialize() || position > list_.entries.size()) {
+      break;
+    }
+    if (op == kLogInsert) {
+      ServerBlockView view;
+      if (!DecodeServerBlock(payload.data() + kLogOpFields, payload.size() - kLogOpFields,
+                             &view) ||
+          view.count != count) {
+        break;
+      }
+      ApplyInsert(position, view);
+    } else if (op == kLogRemove && count <= list_.entries.size() - position) {
+      ApplyRemove(position, count);
+    } else {
+      break;
+    }
+    good += sizeof(record) + record.length;
+    applied++;
+  }
+
+  if (good > 0 && good == log.size()) {
+    log_bytes_ = good;
+    return OpenLog() && CompactIfNeeded();
+  }
+  // Журнала нет, он от другого снимка или оборван: применимое - в снимок
+  if (applied > 0) {
+    LOG_WARNING("Журнал хранилища серверов оборван, сохранено %zu изменений", applied);
+    return WriteSnapshot(list_);
+  }
+  return ResetLog();
+}
+
+bool ServerStore::AppendLog(const std::vector<int32_t>& payload) {
+  LogRecordHeader header;
+  header.length = (uint32_t)(payload.size() * sizeof(int32_t));
+  header.checksum = Crc32(payload.data(), header.length);
+  std::string record((const char*)&header, sizeof(header));
+  record.append((const char*)payload.data(), header.length);
+  // Запись целиком одним вызовом; оборванную отбросит ReplayLog
+#if defined(_WIN32)
+  DWORD written = 0;
+  bool ok = log_file_ != nullptr &&
+            WriteFile((HANDLE)log_file_, record.data(), (DWORD)record.size(), &written, NULL) &&
+            written == record.size();
+#else
+  bool ok = log_fd_ >= 0 && WriteAll(log_fd_, record.data(), record.size());
+#endif
+  if (!ok) {
+    LOG_ERROR("Ошибка записи журнала хранилища серверов");
+    return false;
+  }
+  log_bytes_ += record.size();
+  return true;
+}
+
+bool ServerStore::OpenLog() {
+  CloseLog();
+#if defined(_WIN32)
+  HANDLE file = CreateFileW(Widen(log_path_).c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  log_file_ = file;
+#else
+  log_fd_ = open(log_path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (log_fd_ < 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+void ServerStore::CloseLog() {
+#if defined(_WIN32)
+  if (log_file_ != nullptr) {
+    CloseHandle((HANDLE)log_file_);
+    log_file_ = nullptr;
+  }
+#else
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
+#endif
+}
+
+bool ServerStore::ResetLog() {
+  CloseLog();
+  LogHeader header;
+  memcpy(header.magic, kLogMagic, sizeof(kLogMagic));
+  header.generation = generation_;
+  if (!WriteFileAtomically(log_path_, &header, sizeof(header))) {
+    LOG_ERROR("Не удалось создать журнал хранилища серверов: %s", log_path_.c_str());
+    return false;
+  }
+  log_bytes_ = sizeof(header);
+  return OpenLog();
+}
+
+bool ServerStore::CompactIfNeeded() {
+  if (log_bytes_ <= std::max(kMinCompactBytes, snapshot_bytes_)) {
+    return true;
+  }
+  return Materialize() && WriteSnapshot(list_);
+}
+
+bool ServerStore::WriteSnapshot(const ServerList& list) {
+  // Живые серверы со сведенными строками: мусор удалений уходит
+  ServerList compacted;
+  std::unordered_map<std::string, uint32_t> interned;
+  compacted.entries.reserve(list.entries.size());
+  CopyServers(list, list.entries.data(), list.entries.size(), &compacted, &interned,
+              &compacted.entries);
+  std::vector<int32_t> block;
+  EncodeServerBlock(compacted.entries, compacted.params, compacted.text, 0, &block);
+
+  SnapshotHeader header;
+  memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.version = kVersion;
+  header.block_ints = (uint32_t)block.size();
+  header.generation = generation_ + 1;
+  header.checksum = Crc32(block.data(), block.size() * sizeof(int32_t));
+  header.reserved = 0;
+  std::string file((const char*)&header, sizeof(header));
+  file.append((const char*)block.data(), block.size() * sizeof(int32_t));
+
+  // Отображенный файл не подменить (Windows), поэтому сначала - в память
+  if (!Materialize()) {
+    return false;
+  }
+  if (!WriteFileAtomically(snapshot_path_, file.data(), file.size())) {
+    LOG_ERROR("Не удалось записать хранилище серверов: %s", snapshot_path_.c_str());
+    return false;
+  }
+  generation_ = header.generation;
+  snapshot_bytes_ = file.size();
+  list_ = std::move(compacted);
+  interned_ = std::move(interned);
+  view_dirty_ = true;
+  return ResetLog();
+}
+
+void ServerStore::Unmap() {
+  if (map_data_ != nullptr) {
+    UnmapFile(map_data_, map_size_);
+    map_data_ = nullptr;
+    map_size_ = 0;
+  }
+  mapped_block_ = nullptr;
+  mapped_ints_ = 0;
+}
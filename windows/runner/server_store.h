@@ -0,0 +1,109 @@
+#ifndef RUNNER_SERVER_STORE_H_
+#define RUNNER_SERVER_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "server_block.h"
+
+// Список серверов на диске вместо servers.json.
+//
+// servers.db - снимок: заголовок и блок серверов (server_block.h) со
+// строками, сведенными в один пул без повторов. При запуске снимок
+// отображается в память, проверяется его контрольная сумма, и View()
+// отдает блок прямо из отображения - без разбора и копирования.
+//
+// servers.log - журнал изменений после снимка: каждая вставка и удаление
+// дописывается одной записью с CRC32, так что правка стоит O(1) ввода-
+// вывода. При открытии журнал применяется к снимку; оборванная запись в
+// конце (сбой при записи) отбрасывается. Когда журнал перерастает снимок,
+// список сжимается в новый снимок: он пишется во временный файл и
+// атомарно подменяет старый, а журнал начинается заново. Журнал прежнего
+// снимка узнается по поколению в заголовке и не применяется повторно.
+//
+// Класс не потокобезопасен.
+class ServerStore {
+ public:
+  static constexpr uint32_t kVersion = 1;
+  // Журнал меньше этого не сжимается, даже если перерос снимок
+  static constexpr size_t kMinCompactBytes = 256 * 1024;
+
+  ServerStore();
+  ~ServerStore();
+
+  ServerStore(const ServerStore&) = delete;
+  ServerStore& operator=(const ServerStore&) = delete;
+
+  // Открыть хранилище в каталоге |directory| (UTF-8); файлов может не быть
+  bool Open(const std::string& directory);
+  void Close();
+
+  bool is_open() const { return open_; }
+
+  // Блок серверов; действителен до следующего изменения или Close()
+  const int32_t* View(size_t* ints);
+
+  size_t size() const;
+
+  // Вставить серверы перед позицией |position|
+  bool Insert(size_t position, const ServerList& servers);
+  bool Remove(size_t position, size_t count);
+  // Заменить список целиком (сразу новым снимком)
+  bool Replace(const ServerList& servers);
+  // Записать снимок текущего списка и очистить журнал
+  bool Compact();
+
+  size_t log_bytes() const { return log_bytes_; }
+
+ private:
+  enum LogOp : int32_t {
+    kLogInsert = 1,
+    kLogRemove = 2,
+  };
+
+  bool MapSnapshot();
+  bool Materialize();
+  void ApplyInsert(size_t position, const ServerBlockView& block);
+  void ApplyRemove(size_t position, size_t count);
+  bool ReplayLog();
+  bool AppendLog(const std::vector<int32_t>& payload);
+  bool OpenLog();
+  void CloseLog();
+  bool ResetLog();
+  bool CompactIfNeeded();
+  bool WriteSnapshot(const ServerList& list);
+  void Unmap();
+
+  std::string snapshot_path_;
+  std::string log_path_;
+  bool open_ = false;
+
+  // Отображение снимка
+  const uint8_t* map_data_ = nullptr;
+  size_t map_size_ = 0;
+  const int32_t* mapped_block_ = nullptr;
+  size_t mapped_ints_ = 0;
+
+  // Список в памяти - с первого изменения (до этого все в отображении)
+  bool materialized_ = false;
+  ServerList list_;
+  // Строки, добавленные с материализации: строка -> смещение в list_.text
+  std::unordered_map<std::string, uint32_t> interned_;
+  std::vector<int32_t> view_;
+  bool view_dirty_ = true;
+
+  uint64_t generation_ = 0;
+  size_t snapshot_bytes_ = 0;
+  size_t log_bytes_ = 0;
+#if defined(_WIN32)
+  void* log_file_ = nullptr;  // HANDLE журнала (дозапись)
+#else
+  int log_fd_ = -1;
+#endif
+};
+
+#endif  // RUNNER_SERVER_STORE_H_
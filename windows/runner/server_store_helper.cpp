@@ -0,0 +1,73 @@
+#include "server_store_helper.h"
+#include <string.h>
+
+#include <mutex>
+#include <string>
+
+#include "native_log.h"
+#include "server_store.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Хранилище серверов (одно на процесс)
+static std::mutex g_storeMutex;
+static ServerStore g_store;
+
+// Открыть хранилище
+EXPORT int32_t ServerStoreOpen(const char* directory) {
+    if (directory == NULL) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    if (!g_store.Open(directory)) {
+        LOG_ERROR("Не удалось открыть хранилище серверов в %s", directory);
+        return 0;
+    }
+    LOG_INFO("Хранилище серверов открыто: %zu серверов", g_store.size());
+    return 1;
+}
+
+EXPORT void ServerStoreClose() {
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    g_store.Close();
+}
+
+EXPORT const int32_t* ServerStoreView() {
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    if (!g_store.is_open()) {
+        return NULL;
+    }
+    size_t ints = 0;
+    return g_store.View(&ints);
+}
+
+// Вставить серверы
+EXPORT int32_t ServerStoreInsert(int32_t position, const char* serversJson) {
+    ServerList servers;
+    if (position < 0 || serversJson == NULL || !ParseServerListJson(serversJson, strlen(serversJson), &servers)) {
+        LOG_ERROR("Неверный список серверов для вставки");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    return g_store.Insert((size_t)position, servers) ? 1 : 0;
+}
+
+EXPORT int32_t ServerStoreRemove(int32_t position, int32_t count) {
+    if (position < 0 || count < 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    return g_store.Remove((size_t)position, (size_t)count) ? 1 : 0;
+}
+
+// Заменить список
+EXPORT int32_t ServerStoreReplace(const char* serversJson) {
+    ServerList servers;
+    if (serversJson == NULL || !ParseServerListJson(serversJson, strlen(serversJson), &servers)) {
+        LOG_ERROR("Неверный список серверов");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+    return g_store.Replace(servers) ? 1 : 0;
+}
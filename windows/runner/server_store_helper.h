@@ -0,0 +1,40 @@
+#ifndef SERVER_STORE_HELPER_H
+#define SERVER_STORE_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Хранилище списка серверов (servers.db и журнал servers.log, см.
+// server_store.h). Список отдается блоком той же раскладки, что и разбор
+// подписки (subscription_helper.h); SUBSCRIPTION_SKIPPED в нем всегда 0.
+//
+// serversJson - массив объектов VpnConfig.toJson():
+// {"protocol": "vless", "id": "...", "address": "...", "port": 443,
+//  "params": {"key": "value"}, "tag": "..."}.
+// Протоколы - vless, vmess, trojan, ss: блок хранит протокол номером, и
+// другое написание не восстановить, поэтому с ним вызов не выполняется.
+
+// Открыть хранилище в каталоге directory (UTF-8); прежнее закрывается
+__declspec(dllexport) int32_t ServerStoreOpen(const char* directory);
+
+__declspec(dllexport) void ServerStoreClose();
+
+// Текущий список; блок действителен до следующего изменения или закрытия
+__declspec(dllexport) const int32_t* ServerStoreView();
+
+// Вставить серверы перед позицией position
+__declspec(dllexport) int32_t ServerStoreInsert(int32_t position, const char* serversJson);
+
+__declspec(dllexport) int32_t ServerStoreRemove(int32_t position, int32_t count);
+
+// Заменить список целиком
+__declspec(dllexport) int32_t ServerStoreReplace(const char* serversJson);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVER_STORE_HELPER_H
@@ -0,0 +1,57 @@
+#include "subscription_helper.h"
+
+#include <new>
+#include <vector>
+
+#include "native_log.h"
+#include "server_block.h"
+#include "subscription_parser.h"
+
+// Для экспорта функций
+#define EXPORT __declspec(dllexport)
+
+// Разбор одной подписки и его результат
+struct SubscriptionJob {
+    SubscriptionParser parser;
+    std::vector<int32_t> result;
+    bool finished = false;
+};
+
+// Новый разбор подписки
+EXPORT void* SubscriptionParserCreate() {
+    return new (std::nothrow) SubscriptionJob();
+}
+
+// Очередной фрагмент тела ответа
+EXPORT int32_t SubscriptionParserFeed(void* parser, const char* data, int32_t length) {
+    SubscriptionJob* job = (SubscriptionJob*)parser;
+    if (job == NULL || job->finished || data == NULL || length < 0) {
+        return 0;
+    }
+    job->parser.Feed(data, (size_t)length);
+    return 1;
+}
+
+// Конец тела: результат одним блоком
+EXPORT const int32_t* SubscriptionParserFinish(void* parser) {
+    SubscriptionJob* job = (SubscriptionJob*)parser;
+    if (job == NULL) {
+        return NULL;
+    }
+    if (!job->finished) {
+        job->parser.Finish();
+        job->finished = true;
+        // Смещения в int32: подписка больше 2 ГБ не поддерживается
+        if (job->parser.text().size() > (size_t)INT32_MAX / 2) {
+            LOG_WARNING("Подписка слишком велика для разбора");
+            job->parser.Reset();
+        }
+        EncodeServerBlock(job->parser.entries(), job->parser.params(), job->parser.text(),
+                          job->parser.skipped(), &job->result);
+    }
+    return job->result.data();
+}
+
+EXPORT void SubscriptionParserDestroy(void* parser) {
+    delete (SubscriptionJob*)parser;
+}
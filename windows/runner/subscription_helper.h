@@ -0,0 +1,55 @@
+#ifndef SUBSCRIPTION_HELPER_H
+#define SUBSCRIPTION_HELPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Результат разбора подписки - один блок чисел int32:
+//  - заголовок: SUBSCRIPTION_HEADER_FIELDS чисел;
+//  - записи серверов: по SUBSCRIPTION_RECORD_FIELDS чисел;
+//  - параметры: по 4 числа на пару (смещение и длина ключа, смещение и
+//    длина значения);
+//  - текст UTF-8, на который ссылаются смещения (от начала текста).
+// Той же раскладкой отдает список хранилище серверов (server_store_helper.h).
+#define SUBSCRIPTION_HEADER_FIELDS 4
+enum SubscriptionHeaderField {
+    SUBSCRIPTION_ENTRIES = 0,   // число серверов
+    SUBSCRIPTION_PARAMS = 1,    // число пар параметров всего
+    SUBSCRIPTION_TEXT = 2,      // байт текста
+    SUBSCRIPTION_SKIPPED = 3,   // непустые строки без сервера
+};
+
+#define SUBSCRIPTION_RECORD_FIELDS 10
+enum SubscriptionRecordField {
+    SUBSCRIPTION_PROTOCOL = 0,  // 0 - vless, 1 - vmess, 2 - trojan, 3 - ss
+    SUBSCRIPTION_PORT = 1,
+    SUBSCRIPTION_ID_OFFSET = 2,
+    SUBSCRIPTION_ID_LENGTH = 3,
+    SUBSCRIPTION_ADDRESS_OFFSET = 4,
+    SUBSCRIPTION_ADDRESS_LENGTH = 5,
+    SUBSCRIPTION_TAG_OFFSET = 6,
+    SUBSCRIPTION_TAG_LENGTH = 7,
+    SUBSCRIPTION_FIRST_PARAM = 8,  // номер первой пары параметров
+    SUBSCRIPTION_PARAM_COUNT = 9,
+};
+
+// Новый разбор подписки
+__declspec(dllexport) void* SubscriptionParserCreate();
+
+// Очередной фрагмент тела ответа
+__declspec(dllexport) int32_t SubscriptionParserFeed(void* parser, const char* data, int32_t length);
+
+// Конец тела. Возвращает блок результата; он действителен до
+// SubscriptionParserDestroy.
+__declspec(dllexport) const int32_t* SubscriptionParserFinish(void* parser);
+
+__declspec(dllexport) void SubscriptionParserDestroy(void* parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SUBSCRIPTION_HELPER_H
@@ -0,0 +1,605 @@
+#include "subscription_parser.h"
+
+#include <string.h>
+
+#include "json_reader.h"
+
+namespace {
+
+struct Scheme {
+  const char* prefix;
+  size_t length;
+};
+
+const Scheme kSchemes[] = {
+    {"vless://", 8},
+    {"vmess://", 8},
+    {"trojan://", 9},
+    {"ss://", 5},
+};
+
+constexpr size_t kLongestScheme = 9;
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void Trim(const char** data, size_t* length) {
+  while (*length > 0 && IsSpace(**data)) {
+    (*data)++;
+    (*length)--;
+  }
+  while (*length > 0 && IsSpace((*data)[*length - 1])) {
+    (*length)--;
+  }
+}
+
+// Ссылка ли это на сервер (как _isVpnUrl в Dart)
+bool HasScheme(const char* data, size_t length) {
+  for (const Scheme& scheme : kSchemes) {
+    if (length >= scheme.length && memcmp(data, scheme.prefix, scheme.length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+const char* FindChar(const char* data, size_t length, char c) {
+  return (const char*)memchr(data, c, length);
+}
+
+// Раскрыть %XX (и '+' в параметрах запроса); неправильные '%' остаются
+void AppendUnescaped(const char* data, size_t length, bool plus_is_space, std::string* out) {
+  if (length == 0) {
+    return;
+  }
+  // Без '%' и '+' строка копируется целиком
+  if (FindChar(data, length, '%') == nullptr &&
+      (!plus_is_space || FindChar(data, length, '+') == nullptr)) {
+    out->append(data, length);
+    return;
+  }
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (c == '%' && i + 2 < length && HexValue(data[i + 1]) >= 0 && HexValue(data[i + 2]) >= 0) {
+      out->push_back((char)(HexValue(data[i + 1]) * 16 + HexValue(data[i + 2])));
+      i += 2;
+    } else if (c == '+' && plus_is_space) {
+      out->push_back(' ');
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+const char* FindLastChar(const char* data, size_t length, char c) {
+  while (length > 0) {
+    if (data[--length] == c) {
+      return data + length;
+    }
+  }
+  return nullptr;
+}
+
+bool ParsePort(const char* data, size_t length, uint16_t* port) {
+  if (length == 0 || length > 5) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] < '0' || data[i] > '9') {
+      return false;
+    }
+    value = value * 10 + (uint32_t)(data[i] - '0');
+  }
+  if (value == 0 || value > 65535) {
+    return false;
+  }
+  *port = (uint16_t)value;
+  return true;
+}
+
+// host:port или [IPv6]:port; адрес IPv6 - без скобок
+bool SplitHostPort(const char* data, size_t length, const char** host, size_t* host_length,
+                   uint16_t* port) {
+  const char* colon;
+  if (length > 0 && data[0] == '[') {
+    const char* close = FindChar(data, length, ']');
+    if (close == nullptr || close + 1 == data + length || close[1] != ':') {
+      return false;
+    }
+    *host = data + 1;
+    *host_length = (size_t)(close - data) - 1;
+    colon = close + 1;
+  } else {
+    colon = FindLastChar(data, length, ':');
+    if (colon == nullptr) {
+      return false;
+    }
+    *host = data;
+    *host_length = (size_t)(colon - data);
+  }
+  return *host_length > 0 &&
+         ParsePort(colon + 1, (size_t)(data + length - colon - 1), port);
+}
+
+// Части ссылки после "схема://"
+struct UrlParts {
+  const char* authority = nullptr;
+  size_t authority_length = 0;
+  const char* query = nullptr;
+  size_t query_length = 0;
+  const char* fragment = nullptr;
+  size_t fragment_length = 0;
+};
+
+UrlParts SplitUrl(const char* body, size_t length) {
+  UrlParts parts;
+  const char* hash = FindChar(body, length, '#');
+  if (hash != nullptr) {
+    parts.fragment = hash + 1;
+    parts.fragment_length = (size_t)(body + length - hash - 1);
+    length = (size_t)(hash - body);
+  }
+  const char* question = FindChar(body, length, '?');
+  if (question != nullptr) {
+    parts.query = question + 1;
+    parts.query_length = (size_t)(body + length - question - 1);
+    length = (size_t)(question - body);
+  }
+  const char* slash = FindChar(body, length, '/');
+  parts.authority = body;
+  parts.authority_length = slash != nullptr ? (size_t)(slash - body) : length;
+  return parts;
+}
+
+// Значение JSON строкой: v2rayN пишет порт и aid то строкой, то числом
+bool ReadScalar(JsonReader* reader, std::string* value) {
+  char type = reader->Peek();
+  if (type == '"') {
+    return reader->ReadString(value);
+  }
+  if (type == '-' || (type >= '0' && type <= '9')) {
+    double number = 0;
+    if (!reader->ReadNumber(&number)) {
+      return false;
+    }
+    if (number >= 0 && number < 4294967296.0 && number == (double)(uint32_t)number) {
+      *value = std::to_string((uint32_t)number);
+    } else {
+      value->clear();
+    }
+    return true;
+  }
+  value->clear();
+  return reader->Skip();
+}
+
+}  // namespace
+
+void SubscriptionParser::Feed(const char* data, size_t length) {
+  if (mode_ == Mode::kStart) {
+    start_.append(data, length);
+    ChooseMode(false);
+    return;
+  }
+  if (mode_ == Mode::kLines) {
+    FeedLines(data, length);
+  } else {
+    FeedBase64(data, length);
+  }
+}
+
+void SubscriptionParser::Finish() {
+  if (mode_ == Mode::kStart) {
+    ChooseMode(true);
+  }
+  if (mode_ == Mode::kBase64 || mode_ == Mode::kBase64Tail) {
+    decoded_.clear();
+    if (decoder_.Finish(&decoded_)) {
+      FeedLines(decoded_.data(), decoded_.size());
+    } else {
+      FallBackToLines(nullptr, 0);
+    }
+  }
+  FlushLine();
+}
+
+void SubscriptionParser::Reset() {
+  mode_ = Mode::kStart;
+  start_.clear();
+  raw_.clear();
+  raw_dropped_ = false;
+  tail_newline_ = false;
+  decoder_.Reset();
+  decoded_.clear();
+  line_.clear();
+  line_overflow_ = false;
+  entries_.clear();
+  params_.clear();
+  text_.clear();
+  skipped_ = 0;
+}
+
+void SubscriptionParser::ChooseMode(bool finished) {
+  size_t first = 0;
+  while (first < start_.size() && IsSpace(start_[first])) {
+    first++;
+  }
+  if (start_.size() - first < kLongestScheme && !finished) {
+    return;
+  }
+  // Ссылка в начале - тело разбирается строками, иначе сначала base64
+  std::string start;
+  start.swap(start_);
+  if (HasScheme(start.data() + first, start.size() - first)) {
+    mode_ = Mode::kLines;
+    FeedLines(start.data(), start.size());
+  } else {
+    mode_ = Mode::kBase64;
+    FeedBase64(start.data() + first, start.size() - first);
+  }
+}
+
+void SubscriptionParser::FeedBase64(const char* data, size_t length) {
+  if (mode_ == Mode::kBase64) {
+    // Все символы base64 больше пробела
+    size_t run = 0;
+    while (run < length && (uint8_t)data[run] > ' ') {
+      run++;
+    }
+    decoded_.clear();
+    if (!decoder_.Update(data, run, &decoded_)) {
+      FallBackToLines(data, length);
+      return;
+    }
+    KeepRaw(data, run);
+    FeedLines(decoded_.data(), decoded_.size());
+    if (run == length) {
+      return;
+    }
+    mode_ = Mode::kBase64Tail;
+    data += run;
+    length -= run;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (!IsSpace(data[i])) {
+      FallBackToLines(data, length);
+      return;
+    }
+  }
+  KeepRaw(data, length);
+  if (FindChar(data, length, '\n') != nullptr) {
+    tail_newline_ = true;
+  }
+}
+
+void SubscriptionParser::KeepRaw(const char* data, size_t length) {
+  if (raw_dropped_) {
+    return;
+  }
+  if (raw_.size() + length > kMaxLine) {
+    raw_dropped_ = true;
+    raw_.clear();
+    raw_.shrink_to_fit();
+    return;
+  }
+  raw_.append(data, length);
+}
+
+void SubscriptionParser::FallBackToLines(const char* data, size_t length) {
+  // Разобранное из декодированного тела отбрасывается
+  entries_.clear();
+  params_.clear();
+  text_.clear();
+  skipped_ = 0;
+  line_.clear();
+  line_overflow_ = false;
+  mode_ = Mode::kLines;
+  if (raw_dropped_) {
+    // Начало тела - одна строка длиннее kMaxLine
+    line_overflow_ = true;
+    if (tail_newline_) {
+      FlushLine();
+    }
+  } else {
+    std::string raw;
+    raw.swap(raw_);
+    FeedLines(raw.data(), raw.size());
+  }
+  FeedLines(data, length);
+}
+
+void SubscriptionParser::FeedLines(const char* data, size_t length) {
+  while (length > 0) {
+    const char* newline = FindChar(data, length, '\n');
+    size_t piece = newline != nullptr ? (size_t)(newline - data) : length;
+    if (line_overflow_ || line_.size() + piece > kMaxLine) {
+      line_overflow_ = true;
+      line_.clear();
+    } else if (newline != nullptr && line_.empty()) {
+      ParseLine(data, piece);
+    } else {
+      line_.append(data, piece);
+    }
+    if (newline == nullptr) {
+      return;
+    }
+    FlushLine();
+    data = newline + 1;
+    length -= piece + 1;
+  }
+}
+
+void SubscriptionParser::FlushLine() {
+  if (line_overflow_) {
+    skipped_++;
+    line_overflow_ = false;
+  } else if (!line_.empty()) {
+    ParseLine(line_.data(), line_.size());
+  }
+  line_.clear();
+}
+
+void SubscriptionParser::ParseLine(const char* line, size_t length) {
+  // Одиночный '\r' тоже разделяет строки (как LineSplitter)
+  const char* cr = FindChar(line, length, '\r');
+  while (cr != nullptr && cr + 1 < line + length) {
+    ParseLine(line, (size_t)(cr - line));
+    length -= (size_t)(cr - line) + 1;
+    line = cr + 1;
+    cr = FindChar(line, length, '\r');
+  }
+  Trim(&line, &length);
+  if (length == 0) {
+    return;
+  }
+  if (HasScheme(line, length)) {
+    if (!ParseUri(line, length)) {
+      skipped_++;
+    }
+    return;
+  }
+  line_decoded_.clear();
+  if (Base64Decode(line, length, &line_decoded_)) {
+    const char* decoded = line_decoded_.data();
+    size_t decoded_length = line_decoded_.size();
+    Trim(&decoded, &decoded_length);
+    if (HasScheme(decoded, decoded_length) && ParseUri(decoded, decoded_length)) {
+      return;
+    }
+  }
+  skipped_++;
+}
+
+bool SubscriptionParser::ParseUri(const char* uri, size_t length) {
+  // Неудачный разбор не оставляет следов в результате
+  size_t text_size = text_.size();
+  size_t params_size = params_.size();
+  bool parsed = false;
+  if (length > 8 && memcmp(uri, "vless://", 8) == 0) {
+    parsed = ParseUrl(SubscriptionProtocol::kVless, uri + 8, length - 8);
+  } else if (length > 8 && memcmp(uri, "vmess://", 8) == 0) {
+    parsed = ParseVmess(uri + 8, length - 8);
+  } else if (length > 9 && memcmp(uri, "trojan://", 9) == 0) {
+    parsed = ParseUrl(SubscriptionProtocol::kTrojan, uri + 9, length - 9);
+  } else if (length > 5 && memcmp(uri, "ss://", 5) == 0) {
+    parsed = ParseShadowsocks(uri + 5, length - 5);
+  }
+  if (!parsed) {
+    text_.resize(text_size);
+    params_.resize(params_size);
+  }
+  return parsed;
+}
+
+bool SubscriptionParser::ParseUrl(SubscriptionProtocol protocol, const char* body,
+                                  size_t length) {
+  UrlParts parts = SplitUrl(body, length);
+  const char* at = FindLastChar(parts.authority, parts.authority_length, '@');
+  const char* host_port = at != nullptr ? at + 1 : parts.authority;
+  const char* host;
+  size_t host_length;
+  SubscriptionEntry entry;
+  if (!SplitHostPort(host_port, (size_t)(parts.authority + parts.authority_length - host_port),
+                     &host, &host_length, &entry.port)) {
+    return false;
+  }
+  entry.protocol = protocol;
+  if (at != nullptr) {
+    entry.id = AddUnescaped(parts.authority, (size_t)(at - parts.authority), false);
+  }
+  entry.address = AddLowercase(host, host_length);
+  entry.tag = AddUnescaped(parts.fragment, parts.fragment_length, false);
+  entry.first_param = (uint32_t)params_.size();
+  AddQuery(parts.query, parts.query_length);
+  entry.param_count = (uint32_t)(params_.size() - entry.first_param) / 2;
+  entries_.push_back(entry);
+  return true;
+}
+
+bool SubscriptionParser::ParseShadowsocks(const char* body, size_t length) {
+  UrlParts parts = SplitUrl(body, length);
+  const char* at = FindLastChar(parts.authority, parts.authority_length, '@');
+  const char* credentials;
+  size_t credentials_length;
+  const char* host_port;
+  size_t host_port_length;
+  std::string unescaped;
+  if (at != nullptr) {
+    // SIP002: userinfo - "метод:пароль" в base64url или открытым текстом
+    host_port = at + 1;
+    host_port_length = (size_t)(parts.authority + parts.authority_length - host_port);
+    AppendUnescaped(parts.authority, (size_t)(at - parts.authority), false, &unescaped);
+    inner_decoded_.clear();
+    if (FindChar(unescaped.data(), unescaped.size(), ':') == nullptr) {
+      if (!Base64Decode(unescaped.data(), unescaped.size(), &inner_decoded_)) {
+        return false;
+      }
+      unescaped.swap(inner_decoded_);
+    }
+    credentials = unescaped.data();
+    credentials_length = unescaped.size();
+  } else {
+    // Старый формат: base64("метод:пароль@адрес:порт")
+    inner_decoded_.clear();
+    if (!Base64Decode(parts.authority, parts.authority_length, &inner_decoded_)) {
+      return false;
+    }
+    const char* inner = inner_decoded_.data();
+    const char* inner_at = FindLastChar(inner, inner_decoded_.size(), '@');
+    if (inner_at == nullptr) {
+      return false;
+    }
+    credentials = inner;
+    credentials_length = (size_t)(inner_at - inner);
+    host_port = inner_at + 1;
+    host_port_length = inner_decoded_.size() - credentials_length - 1;
+  }
+
+  const char* colon = FindChar(credentials, credentials_length, ':');
+  const char* host;
+  size_t host_length;
+  SubscriptionEntry entry;
+  if (colon == nullptr || colon == credentials ||
+      !SplitHostPort(host_port, host_port_length, &host, &host_length, &entry.port)) {
+    return false;
+  }
+  entry.protocol = SubscriptionProtocol::kShadowsocks;
+  entry.id = AddText(colon + 1, (size_t)(credentials + credentials_length - colon - 1));
+  entry.address = AddLowercase(host, host_length);
+  entry.tag = AddUnescaped(parts.fragment, parts.fragment_length, false);
+  entry.first_param = (uint32_t)params_.size();
+  AddParam("method", 6, credentials, (size_t)(colon - credentials));
+  AddQuery(parts.query, parts.query_length);
+  entry.param_count = (uint32_t)(params_.size() - entry.first_param) / 2;
+  entries_.push_back(entry);
+  return true;
+}
+
+bool SubscriptionParser::ParseVmess(const char* body, size_t length) {
+  // Формат v2rayN: base64 от JSON с полями ссылки
+  const char* hash = FindChar(body, length, '#');
+  inner_decoded_.clear();
+  if (!Base64Decode(body, hash != nullptr ? (size_t)(hash - body) : length, &inner_decoded_)) {
+    return false;
+  }
+  JsonReader reader(inner_decoded_.data(), inner_decoded_.size());
+  if (!reader.BeginObject()) {
+    return false;
+  }
+  // Поля JSON -> параметры в именах ссылок vless://
+  static const struct {
+    const char* json;
+    const char* param;
+  } kParams[] = {
+      {"net", "type"}, {"tls", "security"}, {"sni", "sni"},   {"host", "host"},
+      {"path", "path"}, {"alpn", "alpn"},   {"fp", "fp"},     {"type", "headerType"},
+      {"aid", "aid"},   {"scy", "scy"},
+  };
+  SubscriptionEntry entry;
+  entry.protocol = SubscriptionProtocol::kVmess;
+  entry.first_param = (uint32_t)params_.size();
+  std::string key;
+  std::string value;
+  std::string address;
+  bool has_port = false;
+  while (reader.NextKey(&key)) {
+    if (!ReadScalar(&reader, &value)) {
+      return false;
+    }
+    if (key == "add") {
+      address = value;
+    } else if (key == "port") {
+      has_port = ParsePort(value.data(), value.size(), &entry.port);
+    } else if (key == "id") {
+      entry.id = AddText(value.data(), value.size());
+    } else if (key == "ps") {
+      entry.tag = AddText(value.data(), value.size());
+    } else if (!value.empty()) {
+      for (const auto& param : kParams) {
+        if (key == param.json) {
+          AddParam(param.param, strlen(param.param), value.data(), value.size());
+          break;
+        }
+      }
+    }
+  }
+  if (reader.failed() || address.empty() || !has_port) {
+    return false;
+  }
+  if (address[0] == '[' && address.back() == ']') {
+    address = address.substr(1, address.size() - 2);
+  }
+  entry.address = AddLowercase(address.data(), address.size());
+  entry.param_count = (uint32_t)(params_.size() - entry.first_param) / 2;
+  entries_.push_back(entry);
+  return true;
+}
+
+TextSpan SubscriptionParser::AddText(const char* data, size_t length) {
+  TextSpan span;
+  span.offset = (uint32_t)text_.size();
+  span.length = (uint32_t)length;
+  text_.append(data, length);
+  return span;
+}
+
+TextSpan SubscriptionParser::AddLowercase(const char* data, size_t length) {
+  TextSpan span = AddText(data, length);
+  for (size_t i = span.offset; i < text_.size(); i++) {
+    if (text_[i] >= 'A' && text_[i] <= 'Z') {
+      text_[i] = (char)(text_[i] - 'A' + 'a');
+    }
+  }
+  return span;
+}
+
+TextSpan SubscriptionParser::AddUnescaped(const char* data, size_t length, bool plus_is_space) {
+  TextSpan span;
+  span.offset = (uint32_t)text_.size();
+  AppendUnescaped(data, length, plus_is_space, &text_);
+  span.length = (uint32_t)(text_.size() - span.offset);
+  return span;
+}
+
+void SubscriptionParser::AddParam(const char* key, size_t key_length, const char* value,
+                                  size_t value_length) {
+  params_.push_back(AddText(key, key_length));
+  params_.push_back(AddText(value, value_length));
+}
+
+void SubscriptionParser::AddQuery(const char* query, size_t length) {
+  while (length > 0) {
+    const char* amp = FindChar(query, length, '&');
+    size_t pair = amp != nullptr ? (size_t)(amp - query) : length;
+    if (pair > 0) {
+      const char* equals = FindChar(query, pair, '=');
+      size_t key_length = equals != nullptr ? (size_t)(equals - query) : pair;
+      params_.push_back(AddUnescaped(query, key_length, true));
+      if (equals != nullptr) {
+        params_.push_back(AddUnescaped(equals + 1, pair - key_length - 1, true));
+      } else {
+        params_.push_back(AddText("", 0));
+      }
+    }
+    if (amp == nullptr) {
+      break;
+    }
+    query = amp + 1;
+    length -= pair + 1;
+  }
+}
@@ -0,0 +1,113 @@
+#ifndef RUNNER_SUBSCRIPTION_PARSER_H_
+#define RUNNER_SUBSCRIPTION_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base64.h"
+
+enum class SubscriptionProtocol : uint8_t {
+  kVless = 0,
+  kVmess,
+  kTrojan,
+  kShadowsocks,
+};
+
+// Строка результата: байты UTF-8 в SubscriptionParser::text()
+struct TextSpan {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+};
+
+// Сервер подписки в тех же полях, что VpnConfig.fromUrl() в Dart
+struct SubscriptionEntry {
+  SubscriptionProtocol protocol = SubscriptionProtocol::kVless;
+  uint16_t port = 0;
+  TextSpan id;  // UUID или пароль
+  TextSpan address;
+  TextSpan tag;
+  // Параметры: params()[first_param .. first_param + 2 * param_count),
+  // ключ и значение по очереди
+  uint32_t first_param = 0;
+  uint32_t param_count = 0;
+};
+
+// Потоковый разбор подписки (ответа сервера подписок).
+//
+// Порядок тот же, что в ConfigImportService: тело целиком в base64 (без
+// пробельных символов внутри) декодируется, иначе разбирается как есть;
+// затем каждая строка - ссылка vless://, vmess://, trojan:// или ss://,
+// либо ссылка в base64. Тело передается фрагментами по мере получения:
+// base64 декодируется и строки разбираются сразу, копируется только
+// строка, разрезанная границей фрагментов. Для отката, если тело все же
+// не base64, сохраняется не больше kMaxLine его байт: более длинное
+// начало тела при разборе строками было бы пропущено целиком.
+//
+// В отличие от Uri.parse, ss:// понимает SIP002 и старый формат (id -
+// пароль, метод - параметр 'method'), а vmess:// - JSON v2rayN.
+class SubscriptionParser {
+ public:
+  // Более длинные строки пропускаются
+  static constexpr size_t kMaxLine = 64 * 1024;
+
+  void Feed(const char* data, size_t length);
+  void Finish();
+  void Reset();
+
+  const std::vector<SubscriptionEntry>& entries() const { return entries_; }
+  const std::vector<TextSpan>& params() const { return params_; }
+  const std::string& text() const { return text_; }
+
+  // Непустые строки, из которых не получилось сервера
+  size_t skipped() const { return skipped_; }
+
+ private:
+  enum class Mode {
+    kStart,       // начало тела еще не ясно
+    kBase64,      // тело декодируется
+    kBase64Tail,  // после base64 допустимы только пробельные символы
+    kLines,       // тело - строки как есть
+  };
+
+  void ChooseMode(bool finished);
+  void FeedBase64(const char* data, size_t length);
+  void KeepRaw(const char* data, size_t length);
+  // Тело не base64: разобрать строками сохраненное начало и |data|
+  void FallBackToLines(const char* data, size_t length);
+
+  void FeedLines(const char* data, size_t length);
+  void FlushLine();
+  void ParseLine(const char* line, size_t length);
+  bool ParseUri(const char* uri, size_t length);
+  bool ParseUrl(SubscriptionProtocol protocol, const char* body, size_t length);
+  bool ParseShadowsocks(const char* body, size_t length);
+  bool ParseVmess(const char* body, size_t length);
+
+  TextSpan AddText(const char* data, size_t length);
+  TextSpan AddLowercase(const char* data, size_t length);
+  TextSpan AddUnescaped(const char* data, size_t length, bool plus_is_space);
+  void AddParam(const char* key, size_t key_length, const char* value, size_t value_length);
+  void AddQuery(const char* query, size_t length);
+
+  Mode mode_ = Mode::kStart;
+  std::string start_;    // начало тела до выбора режима
+  std::string raw_;      // начало тела в режиме base64
+  bool raw_dropped_ = false;
+  bool tail_newline_ = false;  // перевод строки после base64
+  Base64Decoder decoder_;
+  std::string decoded_;  // декодированный фрагмент
+  std::string line_;     // строка, разрезанная фрагментами
+  bool line_overflow_ = false;
+  std::string line_decoded_;   // строка, декодированная из base64
+  std::string inner_decoded_;  // base64 внутри ссылки (vmess://, ss://)
+
+  std::vector<SubscriptionEntry> entries_;
+  std::vector<TextSpan> params_;
+  std::string text_;
+  size_t skipped_ = 0;
+};
+
+#endif  // RUNNER_SUBSCRIPTION_PARSER_H_
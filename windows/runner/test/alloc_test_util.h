@@ -0,0 +1,40 @@
+#ifndef RUNNER_TEST_ALLOC_TEST_UTIL_H_
+#define RUNNER_TEST_ALLOC_TEST_UTIL_H_
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+// Счетчик выделений памяти для тестов и бенчмарков, которые проверяют,
+// что горячий путь не выделяет память. Заменяет глобальные operator
+// new/delete, поэтому включается ровно в один файл исполняемого файла.
+namespace alloc_test {
+
+inline std::atomic<size_t> allocations{0};
+
+inline size_t Allocations() { return allocations.load(std::memory_order_relaxed); }
+
+}  // namespace alloc_test
+
+// GCC видит free() после встроенного operator new и считает пару несогласованной
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+  alloc_test::allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+
+#endif  // RUNNER_TEST_ALLOC_TEST_UTIL_H_
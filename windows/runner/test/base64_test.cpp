@@ -0,0 +1,167 @@
+#include "base64.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string Encode(const std::string& data, bool url_safe, bool padded) {
+  const char* alphabet = url_safe
+                             ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+                             : "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 3 <= data.size(); i += 3) {
+    uint32_t word = ((uint8_t)data[i] << 16) | ((uint8_t)data[i + 1] << 8) | (uint8_t)data[i + 2];
+    for (int shift = 18; shift >= 0; shift -= 6) out.push_back(alphabet[(word >> shift) & 63]);
+  }
+  size_t rest = data.size() - i;
+  if (rest > 0) {
+    uint32_t word = (uint8_t)data[i] << 16;
+    if (rest == 2) word |= (uint8_t)data[i + 1] << 8;
+    out.push_back(alphabet[(word >> 18) & 63]);
+    out.push_back(alphabet[(word >> 12) & 63]);
+    if (rest == 2) out.push_back(alphabet[(word >> 6) & 63]);
+    if (padded) out.append(3 - rest, '=');
+  }
+  return out;
+}
+
+std::string RandomBytes(std::mt19937* random, size_t length) {
+  std::string data(length, '\0');
+  for (char& c : data) c = (char)(*random)();
+  return data;
+}
+
+// Каждый тест - для таблицы, SSSE3 и AVX2 (что поддерживает процессор)
+class Base64Test : public ::testing::TestWithParam<Base64Simd> {
+ protected:
+  void SetUp() override {
+    if (GetParam() > Base64SupportedSimd()) {
+      GTEST_SKIP() << "not supported by this CPU";
+    }
+    SetBase64SimdLimit(GetParam());
+  }
+  void TearDown() override { SetBase64SimdLimit(Base64Simd::kAvx2); }
+};
+
+TEST_P(Base64Test, RoundTripsEveryLength) {
+  std::mt19937 random(1);
+  for (size_t length = 0; length < 300; length++) {
+    std::string data = RandomBytes(&random, length);
+    for (bool url_safe : {false, true}) {
+      for (bool padded : {false, true}) {
+        std::string encoded = Encode(data, url_safe, padded);
+        std::string decoded;
+        ASSERT_TRUE(Base64Decode(encoded.data(), encoded.size(), &decoded)) << length;
+        ASSERT_EQ(decoded, data) << length << " " << url_safe << padded;
+      }
+    }
+  }
+}
+
+// Оба алфавита в одной строке: '-' и '+' одинаково дают 62
+TEST_P(Base64Test, MixedAlphabets) {
+  std::string encoded(64, '+');
+  for (size_t i = 0; i < encoded.size(); i += 3) encoded[i] = '-';
+  for (size_t i = 1; i < encoded.size(); i += 5) encoded[i] = '_';
+  std::string standard = encoded;
+  for (char& c : standard) c = c == '-' ? '+' : c == '_' ? '/' : c;
+  std::string decoded;
+  std::string expected;
+  ASSERT_TRUE(Base64Decode(encoded.data(), encoded.size(), &decoded));
+  ASSERT_TRUE(Base64Decode(standard.data(), standard.size(), &expected));
+  EXPECT_EQ(decoded, expected);
+}
+
+// Поток с разрезом в любом месте дает те же байты
+TEST_P(Base64Test, ChunkedInput) {
+  std::mt19937 random(2);
+  std::string data = RandomBytes(&random, 200);
+  std::string encoded = Encode(data, false, true);
+  for (size_t first = 0; first <= encoded.size(); first++) {
+    for (size_t second : {(size_t)1, (size_t)7, (size_t)33, encoded.size()}) {
+      Base64Decoder decoder;
+      std::string decoded;
+      size_t offset = 0;
+      for (size_t chunk = first; offset < encoded.size(); chunk = second) {
+        size_t length = std::min(chunk, encoded.size() - offset);
+        ASSERT_TRUE(decoder.Update(encoded.data() + offset, length, &decoded));
+        offset += length;
+      }
+      ASSERT_TRUE(decoder.Finish(&decoded));
+      ASSERT_EQ(decoded, data) << first << " " << second;
+    }
+  }
+}
+
+// Недопустимый символ в любой позиции - в векторном блоке, в хвосте и
+// на границе между ними
+TEST_P(Base64Test, RejectsInvalidCharacterAnywhere) {
+  std::mt19937 random(3);
+  std::string encoded = Encode(RandomBytes(&random, 150), false, false);
+  for (char bad : {' ', '\n', '.', '\0', '*', (char)0x80, (char)0xff}) {
+    for (size_t position = 0; position < encoded.size(); position++) {
+      std::string corrupted = encoded;
+      corrupted[position] = bad;
+      std::string decoded;
+      ASSERT_FALSE(Base64Decode(corrupted.data(), corrupted.size(), &decoded))
+          << position << " " << (int)(uint8_t)bad;
+    }
+  }
+}
+
+TEST_P(Base64Test, Padding) {
+  std::string decoded;
+  EXPECT_TRUE(Base64Decode("YQ==", 4, &decoded));
+  EXPECT_EQ(decoded, "a");
+  decoded.clear();
+  EXPECT_TRUE(Base64Decode("YQ", 2, &decoded));
+  EXPECT_EQ(decoded, "a");
+  decoded.clear();
+  EXPECT_TRUE(Base64Decode("YWI=", 4, &decoded));
+  EXPECT_EQ(decoded, "ab");
+
+  const char* const kInvalid[] = {"Y",    "YQ===", "=YQ", "Y===", "YQ==YQ==",
+                                  "YQ=a", "YWJj=", "YW=I"};
+  for (const char* invalid : kInvalid) {
+    decoded.clear();
+    EXPECT_FALSE(Base64Decode(invalid, strlen(invalid), &decoded)) << invalid;
+  }
+
+  // Паддинг, разрезанный фрагментами
+  Base64Decoder decoder;
+  decoded.clear();
+  EXPECT_TRUE(decoder.Update("YQ=", 3, &decoded));
+  EXPECT_TRUE(decoder.Update("=", 1, &decoded));
+  EXPECT_FALSE(decoder.Update("=", 1, &decoded));
+  EXPECT_TRUE(decoder.failed());
+  EXPECT_FALSE(decoder.Finish(&decoded));
+  decoder.Reset();
+  decoded.clear();
+  EXPECT_TRUE(decoder.Update("YWJj", 4, &decoded) && decoder.Finish(&decoded));
+  EXPECT_EQ(decoded, "abc");
+}
+
+// Дописывает к уже имеющимся байтам, не трогая их
+TEST_P(Base64Test, AppendsToOutput) {
+  std::string out = "prefix:";
+  std::string encoded = Encode(std::string(100, 'x'), false, true);
+  ASSERT_TRUE(Base64Decode(encoded.data(), encoded.size(), &out));
+  EXPECT_EQ(out, "prefix:" + std::string(100, 'x'));
+}
+
+std::string SimdName(const ::testing::TestParamInfo<Base64Simd>& info) {
+  const char* const kNames[] = {"Scalar", "Ssse3", "Avx2"};
+  return kNames[(int)info.param];
+}
+
+INSTANTIATE_TEST_SUITE_P(Simd, Base64Test,
+                         ::testing::Values(Base64Simd::kScalar, Base64Simd::kSsse3,
+                                           Base64Simd::kAvx2),
+                         SimdName);
+
+}  // namespace
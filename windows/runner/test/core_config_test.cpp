@@ -0,0 +1,94 @@
+#include "core_config.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "core_config_helper.h"
+#include "file_test_util.h"
+
+namespace {
+
+// Эталоны golden/core_config: <имя>.server.json - VpnConfig.toJson(),
+// <имя>.json - jsonEncode карт WindowsVpnService для него с путями
+// журналов ниже. Те же файлы проверяет test/core/core_config_golden_test.dart,
+// так что совпадение с эталоном здесь - совпадение с генератором Dart.
+const char kAccessLog[] = "C:\\Users\\tester\\AppData\\Local\\Temp\\v2ray_access.log";
+const char kErrorLog[] = "C:\\Users\\tester\\AppData\\Local\\Temp\\v2ray_error.log";
+
+std::vector<std::string> FixtureNames() {
+  std::vector<std::string> names;
+  const std::string suffix = ".server.json";
+  for (const auto& entry : std::filesystem::directory_iterator(RUNNER_GOLDEN_DIR "/core_config")) {
+    std::string file = entry.path().filename().string();
+    if (file.size() > suffix.size() &&
+        file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      names.push_back(file.substr(0, file.size() - suffix.size()));
+    }
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+std::string Fixture(const std::string& name) {
+  return file_test::ReadFile(std::string(RUNNER_GOLDEN_DIR "/core_config/") + name);
+}
+
+std::string Generate(const std::string& server_json) {
+  std::string servers = "[" + server_json + "]";
+  int32_t length = 0;
+  const char* config = CoreConfigGenerate(servers.c_str(), kAccessLog, kErrorLog, &length);
+  return config != nullptr ? std::string(config, (size_t)length) : "<null>";
+}
+
+class CoreConfigGoldenTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(CoreConfigGoldenTest, MatchesDartGenerator) {
+  std::string expected = Fixture(GetParam() + ".json");
+  ASSERT_FALSE(expected.empty());
+  std::string actual = Generate(Fixture(GetParam() + ".server.json"));
+  if (actual != expected) {
+    size_t at = 0;
+    while (at < actual.size() && at < expected.size() && actual[at] == expected[at]) at++;
+    FAIL() << "first difference at byte " << at << "\n  expected: ..."
+           << expected.substr(at < 40 ? 0 : at - 40, 80) << "\n  actual:   ..."
+           << actual.substr(at < 40 ? 0 : at - 40, 80);
+  }
+}
+
+std::string FixtureName(const ::testing::TestParamInfo<std::string>& info) { return info.param; }
+
+INSTANTIATE_TEST_SUITE_P(Fixtures, CoreConfigGoldenTest, ::testing::ValuesIn(FixtureNames()),
+                         FixtureName);
+
+// Каждое ядро и каждый транспорт V2Ray есть среди эталонов
+TEST(CoreConfigGoldenCoverageTest, EveryProtocolAndTransport) {
+  std::vector<std::string> names = FixtureNames();
+  auto has = [&](const std::string& prefix) {
+    for (const std::string& name : names) {
+      if (name.compare(0, prefix.size(), prefix) == 0) return true;
+    }
+    return false;
+  };
+  for (const char* prefix : {"vless_tcp", "vless_ws", "vless_grpc", "vless_kcp", "vless_reality",
+                             "vless_h2", "vmess_tcp", "vmess_ws", "vmess_grpc", "trojan_", "ss_"}) {
+    EXPECT_TRUE(has(prefix)) << prefix;
+  }
+}
+
+TEST(CoreConfigHelperTest, RejectsInvalidServers) {
+  int32_t length = -1;
+  EXPECT_EQ(CoreConfigGenerate(nullptr, kAccessLog, kErrorLog, &length), nullptr);
+  EXPECT_EQ(CoreConfigGenerate("[]", kAccessLog, kErrorLog, &length), nullptr);
+  EXPECT_EQ(CoreConfigGenerate("[{\"protocol\": \"hysteria2\"}]", kAccessLog, kErrorLog, &length),
+            nullptr);
+  std::string two = "[" + Fixture("trojan_default.server.json") + "," +
+                    Fixture("ss_method.server.json") + "]";
+  EXPECT_EQ(CoreConfigGenerate(two.c_str(), kAccessLog, kErrorLog, &length), nullptr);
+  EXPECT_EQ(CoreConfigGenerate("[]", kAccessLog, kErrorLog, nullptr), nullptr);
+}
+
+}  // namespace
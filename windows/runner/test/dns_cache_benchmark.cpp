@@ -0,0 +1,189 @@
+#include "dns_cache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int64_t kSecondUs = 1000 * 1000;
+
+// Запрос трассы: время от начала, имя и TTL ответа (0 - имени нет)
+struct Query {
+  int64_t time_us;
+  std::string name;
+  uint32_t ttl_s;
+};
+
+// Трасса из файла RUNNER_DNS_TRACE: строка на запрос
+// "<секунды от начала> <имя> <TTL ответа или 0 для NXDOMAIN>", например из
+// журнала DNS-сервера или tshark -T fields -e frame.time_relative
+// -e dns.qry.name -e dns.resp.ttl. Без файла - синтетическая трасса с
+// распределением Ципфа: 20 тыс. имен, 400 тыс. запросов за два часа,
+// TTL от 20 секунд до часа, 3% несуществующих имен.
+const std::vector<Query>& Trace() {
+  static const std::vector<Query> trace = [] {
+    std::vector<Query> queries;
+    if (const char* path = std::getenv("RUNNER_DNS_TRACE")) {
+      std::ifstream file(path);
+      std::string line;
+      while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        double seconds = 0;
+        Query query;
+        if (fields >> seconds >> query.name >> query.ttl_s) {
+          query.time_us = (int64_t)(seconds * kSecondUs);
+          queries.push_back(std::move(query));
+        }
+      }
+      if (!queries.empty()) {
+        return queries;
+      }
+    }
+
+    constexpr size_t kNames = 20000;
+    constexpr size_t kQueries = 400000;
+    constexpr int64_t kDurationUs = 2 * 3600 * kSecondUs;
+    std::mt19937 random(42);
+    std::vector<double> weights(kNames);
+    for (size_t i = 0; i < kNames; i++) {
+      weights[i] = 1.0 / (double)(i + 1);
+    }
+    std::discrete_distribution<size_t> popularity(weights.begin(), weights.end());
+    const uint32_t kTtls[] = {20, 60, 60, 60, 300, 300, 300, 300, 3600, 3600};
+    std::vector<uint32_t> ttls(kNames);
+    for (size_t i = 0; i < kNames; i++) {
+      ttls[i] = random() % 100 < 3 ? 0 : kTtls[random() % 10];
+    }
+    queries.reserve(kQueries);
+    for (size_t i = 0; i < kQueries; i++) {
+      size_t name = popularity(random);
+      queries.push_back(Query{(int64_t)(kDurationUs * (double)i / kQueries),
+                              "host" + std::to_string(name) + ".example.com", ttls[name]});
+    }
+    return queries;
+  }();
+  return trace;
+}
+
+std::vector<ResolvedAddress> Addresses() {
+  ResolvedAddress resolved = {};
+  sockaddr_in address = socket_test::Loopback(0);
+  memcpy(&resolved.address, &address, sizeof(address));
+  resolved.length = sizeof(address);
+  return std::vector<ResolvedAddress>(1, resolved);
+}
+
+void Answer(DnsCache* cache, const Query& query, int64_t now_us) {
+  if (query.ttl_s == 0) {
+    cache->StoreNegative(query.name, 60, now_us);
+  } else {
+    cache->Store(query.name, Addresses(), query.ttl_s, now_us);
+  }
+}
+
+double Percentile(std::vector<double>* values, double fraction) {
+  if (values->empty()) return 0;
+  size_t index = std::min(values->size() - 1, (size_t)(fraction * (double)values->size()));
+  std::nth_element(values->begin(), values->begin() + (ptrdiff_t)index, values->end());
+  return (*values)[index];
+}
+
+// Проигрывание трассы через кеш, как это делает HostResolver: промах
+// разрешается мгновенно, устаревшая запись обновляется первым получившим.
+// Аргумент: 1 - раз в секунду упреждающее обновление горячих имен (его
+// проход по кешу в фоновом потоке резолвера в замер не входит).
+// hit_rate - доля запросов без ожидания DNS, fresh_rate - из них со свежими
+// адресами; p50_ns/p99_ns - задержка Lookup().
+void BM_TraceReplay(benchmark::State& state) {
+  const std::vector<Query>& trace = Trace();
+  const bool prefetch = state.range(0) != 0;
+  std::unordered_map<std::string, uint32_t> ttl_of;
+  for (const Query& query : trace) ttl_of[DnsCache::Normalize(query.name)] = query.ttl_s;
+
+  uint64_t answered = 0;
+  uint64_t fresh = 0;
+  std::vector<double> latencies;
+  latencies.reserve(trace.size());
+  for (auto _ : state) {
+    state.PauseTiming();
+    DnsCache cache;
+    answered = 0;
+    fresh = 0;
+    latencies.clear();
+    int64_t next_prefetch_us = 0;
+    std::vector<std::string> names;
+    std::vector<ResolvedAddress> addresses;
+    state.ResumeTiming();
+
+    for (const Query& query : trace) {
+      if (prefetch && query.time_us >= next_prefetch_us) {
+        state.PauseTiming();
+        next_prefetch_us = query.time_us + kSecondUs;
+        names.clear();
+        cache.CollectPrefetch(query.time_us, HostResolver::kPrefetchBatch, &names);
+        for (const std::string& name : names) {
+          Answer(&cache, Query{0, name, ttl_of[name]}, query.time_us);
+        }
+        state.ResumeTiming();
+      }
+      bool refresh = false;
+      Clock::time_point start = Clock::now();
+      DnsCache::Status status = cache.Lookup(query.name, query.time_us, &addresses, &refresh);
+      latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+      if (status == DnsCache::Status::kMiss) {
+        Answer(&cache, query, query.time_us);
+        continue;
+      }
+      answered++;
+      if (status == DnsCache::Status::kFresh) fresh++;
+      if (refresh) Answer(&cache, query, query.time_us);
+    }
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * trace.size()));
+  state.counters["hit_rate"] = (double)answered / (double)trace.size();
+  state.counters["fresh_rate"] = (double)fresh / (double)trace.size();
+  state.counters["p50_ns"] = Percentile(&latencies, 0.50);
+  state.counters["p99_ns"] = Percentile(&latencies, 0.99);
+  state.SetLabel(prefetch ? "prefetch" : "no prefetch");
+}
+BENCHMARK(BM_TraceReplay)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Поиск из нескольких потоков по заполненному кешу (прокси и правила
+// маршрутизации читают одновременно): сегменты не блокируют друг друга
+void BM_ConcurrentLookup(benchmark::State& state) {
+  static DnsCache* cache = nullptr;
+  const std::vector<Query>& trace = Trace();
+  if (state.thread_index() == 0) {
+    cache = new DnsCache();
+    for (const Query& query : trace) {
+      Answer(cache, query, 0);
+    }
+  }
+  std::vector<ResolvedAddress> addresses;
+  size_t next = (size_t)state.thread_index() * 7919;
+  for (auto _ : state) {
+    const Query& query = trace[next++ % trace.size()];
+    benchmark::DoNotOptimize(cache->Lookup(query.name, 0, &addresses, nullptr));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  if (state.thread_index() == 0) {
+    delete cache;
+  }
+}
+BENCHMARK(BM_ConcurrentLookup)->Threads(1)->Threads(4)->Threads(8)->UseRealTime();
+
+}  // namespace
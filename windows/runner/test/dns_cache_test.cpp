@@ -0,0 +1,291 @@
+#include "dns_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+constexpr int64_t kSecondUs = 1000 * 1000;
+
+std::vector<ResolvedAddress> Addresses(uint32_t ipv4) {
+  ResolvedAddress resolved = {};
+  sockaddr_in* address = (sockaddr_in*)&resolved.address;
+  address->sin_family = AF_INET;
+  address->sin_addr.s_addr = htonl(ipv4);
+  resolved.length = sizeof(sockaddr_in);
+  return std::vector<ResolvedAddress>(1, resolved);
+}
+
+uint32_t Ipv4(const ResolvedAddress& resolved) {
+  return ntohl(((const sockaddr_in*)&resolved.address)->sin_addr.s_addr);
+}
+
+TEST(DnsCacheTest, NormalizesNames) {
+  EXPECT_EQ(DnsCache::Normalize("Example.COM."), "example.com");
+  EXPECT_EQ(DnsCache::Normalize("a.b"), "a.b");
+  EXPECT_EQ(DnsCache::Normalize(""), "");
+
+  DnsCache cache;
+  cache.Store("WWW.Example.com.", Addresses(0x01020304), 60, 0);
+  std::vector<ResolvedAddress> addresses;
+  EXPECT_EQ(cache.Lookup("www.example.com", 0, &addresses, nullptr), DnsCache::Status::kFresh);
+  ASSERT_EQ(addresses.size(), 1u);
+  EXPECT_EQ(Ipv4(addresses[0]), 0x01020304u);
+}
+
+TEST(DnsCacheTest, FreshThenStaleThenMiss) {
+  DnsCache cache;
+  cache.Store("a.test", Addresses(1), 60, 0);
+  std::vector<ResolvedAddress> addresses;
+  bool refresh = true;
+  EXPECT_EQ(cache.Lookup("a.test", 59 * kSecondUs, &addresses, &refresh),
+            DnsCache::Status::kFresh);
+  EXPECT_FALSE(refresh);
+
+  // После TTL адреса отдаются устаревшими, обновлять идет только первый
+  EXPECT_EQ(cache.Lookup("a.test", 60 * kSecondUs, &addresses, &refresh),
+            DnsCache::Status::kStale);
+  EXPECT_TRUE(refresh);
+  EXPECT_EQ(cache.Lookup("a.test", 61 * kSecondUs, &addresses, &refresh),
+            DnsCache::Status::kStale);
+  EXPECT_FALSE(refresh);
+  EXPECT_EQ(addresses.size(), 1u);
+
+  EXPECT_EQ(cache.Lookup("a.test", 60 * kSecondUs + DnsCache::kStaleWindowUs, &addresses,
+                         &refresh),
+            DnsCache::Status::kMiss);
+  EXPECT_EQ(cache.Lookup("b.test", 0, &addresses, &refresh), DnsCache::Status::kMiss);
+}
+
+TEST(DnsCacheTest, ClampsTtl) {
+  DnsCache cache;
+  std::vector<ResolvedAddress> addresses;
+  cache.Store("short.test", Addresses(1), 0, 0);
+  EXPECT_EQ(cache.Lookup("short.test", (DnsCache::kMinTtlS - 1) * kSecondUs, &addresses, nullptr),
+            DnsCache::Status::kFresh);
+  EXPECT_EQ(cache.Lookup("short.test", DnsCache::kMinTtlS * kSecondUs, &addresses, nullptr),
+            DnsCache::Status::kStale);
+
+  cache.Store("long.test", Addresses(1), 7 * 24 * 3600, 0);
+  EXPECT_EQ(cache.Lookup("long.test", DnsCache::kMaxTtlS * kSecondUs, &addresses, nullptr),
+            DnsCache::Status::kStale);
+}
+
+TEST(DnsCacheTest, RefreshFailedAllowsNextRefresh) {
+  DnsCache cache;
+  cache.Store("a.test", Addresses(1), 10, 0);
+  std::vector<ResolvedAddress> addresses;
+  bool refresh = false;
+  cache.Lookup("a.test", 11 * kSecondUs, &addresses, &refresh);
+  EXPECT_TRUE(refresh);
+  cache.RefreshFailed("a.test");
+  cache.Lookup("a.test", 12 * kSecondUs, &addresses, &refresh);
+  EXPECT_TRUE(refresh);
+
+  // Новый ответ снова делает запись свежей
+  cache.Store("a.test", Addresses(2), 10, 12 * kSecondUs);
+  EXPECT_EQ(cache.Lookup("a.test", 13 * kSecondUs, &addresses, &refresh),
+            DnsCache::Status::kFresh);
+  EXPECT_EQ(Ipv4(addresses[0]), 2u);
+}
+
+// Отсутствие имени кешируется недолго и устаревшим не отдается
+TEST(DnsCacheTest, NegativeEntries) {
+  DnsCache cache;
+  std::vector<ResolvedAddress> addresses;
+  cache.StoreNegative("missing.test", 30, 0);
+  EXPECT_EQ(cache.Lookup("missing.test", 29 * kSecondUs, &addresses, nullptr),
+            DnsCache::Status::kNegative);
+  EXPECT_EQ(cache.Lookup("missing.test", 30 * kSecondUs, &addresses, nullptr),
+            DnsCache::Status::kMiss);
+
+  cache.StoreNegative("forever.test", 24 * 3600, 0);
+  EXPECT_EQ(cache.Lookup("forever.test", DnsCache::kMaxNegativeTtlS * kSecondUs, &addresses,
+                         nullptr),
+            DnsCache::Status::kMiss);
+
+  // Пустой ответ - тоже отсутствие имени; положительный ответ его заменяет
+  cache.Store("empty.test", std::vector<ResolvedAddress>(), 30, 0);
+  EXPECT_EQ(cache.Lookup("empty.test", 0, &addresses, nullptr), DnsCache::Status::kNegative);
+  cache.Store("empty.test", Addresses(3), 30, 0);
+  EXPECT_EQ(cache.Lookup("empty.test", 0, &addresses, nullptr), DnsCache::Status::kFresh);
+}
+
+// Горячие имена обновляются заранее, холодные - нет; имя отдается один раз
+TEST(DnsCacheTest, PrefetchesHotNamesNearExpiry) {
+  DnsCache cache;
+  cache.Store("hot.test", Addresses(1), 100, 0);
+  cache.Store("cold.test", Addresses(2), 100, 0);
+  cache.StoreNegative("missing.test", 100, 0);
+  std::vector<ResolvedAddress> addresses;
+  for (uint32_t i = 0; i < DnsCache::kPrefetchHits; i++) {
+    cache.Lookup("hot.test", 0, &addresses, nullptr);
+  }
+  cache.Lookup("cold.test", 0, &addresses, nullptr);
+
+  std::vector<std::string> names;
+  cache.CollectPrefetch(50 * kSecondUs, 10, &names);
+  EXPECT_TRUE(names.empty());
+
+  cache.CollectPrefetch(95 * kSecondUs, 10, &names);
+  ASSERT_EQ(names.size(), 1u);
+  EXPECT_EQ(names[0], "hot.test");
+
+  names.clear();
+  cache.CollectPrefetch(96 * kSecondUs, 10, &names);
+  EXPECT_TRUE(names.empty());
+
+  // Обновляемое имя не отдается на обновление и первому, кто увидит kStale
+  bool refresh = true;
+  EXPECT_EQ(cache.Lookup("hot.test", 101 * kSecondUs, &addresses, &refresh),
+            DnsCache::Status::kStale);
+  EXPECT_FALSE(refresh);
+}
+
+TEST(DnsCacheTest, PrefetchRespectsLimit) {
+  DnsCache cache;
+  std::vector<ResolvedAddress> addresses;
+  for (int i = 0; i < 20; i++) {
+    std::string name = "name" + std::to_string(i) + ".test";
+    cache.Store(name, Addresses((uint32_t)i), 100, 0);
+    for (uint32_t hit = 0; hit < DnsCache::kPrefetchHits; hit++) {
+      cache.Lookup(name, 0, &addresses, nullptr);
+    }
+  }
+  std::vector<std::string> names;
+  cache.CollectPrefetch(95 * kSecondUs, 8, &names);
+  EXPECT_EQ(names.size(), 8u);
+  names.clear();
+  cache.CollectPrefetch(95 * kSecondUs, 100, &names);
+  EXPECT_EQ(names.size(), 12u);
+}
+
+// Переполненный сегмент вытесняет запись, которая раньше всех истечет
+TEST(DnsCacheTest, EvictsEarliestExpiring) {
+  DnsCache cache;
+  constexpr size_t kNames = DnsCache::kShardCount * DnsCache::kShardCapacity * 2;
+  for (size_t i = 0; i < kNames; i++) {
+    cache.Store("n" + std::to_string(i) + ".test", Addresses((uint32_t)i),
+                i == 0 ? DnsCache::kMaxTtlS : 60, (int64_t)i);
+  }
+  EXPECT_LE(cache.size(), DnsCache::kShardCount * DnsCache::kShardCapacity);
+  std::vector<ResolvedAddress> addresses;
+  EXPECT_EQ(cache.Lookup("n0.test", kNames, &addresses, nullptr), DnsCache::Status::kFresh);
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+// Читатели и писатели разных потоков: без гонок (под TSan) и без потерь
+TEST(DnsCacheTest, ConcurrentReadersAndWriters) {
+  DnsCache cache;
+  constexpr int kNames = 1000;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> wrong{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      std::vector<ResolvedAddress> addresses;
+      for (int round = 0; !stop.load(std::memory_order_relaxed); round++) {
+        int i = (round * 7 + t) % kNames;
+        std::string name = "n" + std::to_string(i) + ".test";
+        if (t == 0) {
+          cache.Store(name, Addresses((uint32_t)i), 60, 0);
+        } else if (cache.Lookup(name, 0, &addresses, nullptr) == DnsCache::Status::kFresh &&
+                   Ipv4(addresses[0]) != (uint32_t)i) {
+          wrong++;
+        }
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  stop = true;
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(wrong.load(), 0u);
+  EXPECT_EQ(cache.size(), (size_t)kNames);
+}
+
+// Резолвер с кешем: ответ из кеша приходит внутри вызова
+class CachedResolverTest : public ::testing::Test {
+ protected:
+  CachedResolverTest() : resolver_(2, &cache_) {}
+
+  // true, если callback пришел синхронно
+  bool ResolveNow(const std::string& host, std::vector<ResolvedAddress>* addresses) {
+    bool called = false;
+    resolver_.ResolveAll(host, 443, [&](const std::vector<ResolvedAddress>& result) {
+      called = true;
+      *addresses = result;
+    });
+    return called;
+  }
+
+  DnsCache cache_;
+  HostResolver resolver_;
+};
+
+TEST_F(CachedResolverTest, FreshEntryAnswersInline) {
+  cache_.Store("cached.test", Addresses(0x0a000001), 60, DnsCache::NowUs());
+  std::vector<ResolvedAddress> addresses;
+  ASSERT_TRUE(ResolveNow("Cached.Test", &addresses));
+  ASSERT_EQ(addresses.size(), 1u);
+  EXPECT_EQ(Ipv4(addresses[0]), 0x0a000001u);
+  // Порт подставляется запросу, в кеше хранится 0
+  EXPECT_EQ(ntohs(((sockaddr_in*)&addresses[0].address)->sin_port), 443);
+}
+
+TEST_F(CachedResolverTest, NegativeEntryFailsInline) {
+  cache_.StoreNegative("missing.test", 60, DnsCache::NowUs());
+  std::vector<ResolvedAddress> addresses = Addresses(1);
+  ASSERT_TRUE(ResolveNow("missing.test", &addresses));
+  EXPECT_TRUE(addresses.empty());
+}
+
+// Устаревшие адреса отдаются сразу, имя обновляется в фоне
+TEST_F(CachedResolverTest, StaleEntryRefreshesInBackground) {
+  int64_t past = DnsCache::NowUs() - 2 * (int64_t)DnsCache::kMinTtlS * kSecondUs;
+  cache_.Store("localhost", Addresses(0x0a000002), DnsCache::kMinTtlS, past);
+  std::vector<ResolvedAddress> addresses;
+  ASSERT_TRUE(ResolveNow("localhost", &addresses));
+  ASSERT_EQ(addresses.size(), 1u);
+  EXPECT_EQ(Ipv4(addresses[0]), 0x0a000002u);
+
+  DnsCache::Status status = DnsCache::Status::kStale;
+  for (int i = 0; i < 500 && status != DnsCache::Status::kFresh; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    status = cache_.Lookup("localhost", DnsCache::NowUs(), &addresses, nullptr);
+  }
+  ASSERT_EQ(status, DnsCache::Status::kFresh);
+  ASSERT_FALSE(addresses.empty());
+  bool old = addresses[0].address.ss_family == AF_INET && Ipv4(addresses[0]) == 0x0a000002u;
+  EXPECT_FALSE(old);
+}
+
+TEST_F(CachedResolverTest, MissResolvesAndStores) {
+  std::atomic<bool> done{false};
+  std::vector<ResolvedAddress> resolved;
+  resolver_.ResolveAll("localhost", 80, [&](const std::vector<ResolvedAddress>& result) {
+    resolved = result;
+    done = true;
+  });
+  for (int i = 0; i < 500 && !done; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(done);
+  ASSERT_FALSE(resolved.empty());
+
+  // Второй запрос уже из кеша
+  std::vector<ResolvedAddress> addresses;
+  ASSERT_TRUE(ResolveNow("localhost", &addresses));
+  EXPECT_EQ(addresses.size(), resolved.size());
+}
+
+}  // namespace
@@ -0,0 +1,134 @@
+#include "domain_matcher.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 500 тыс. шаблонов: как у полного geosite - в основном суффиксы, много
+// full-имен и немного подстрок
+constexpr size_t kPatterns = 500000;
+constexpr size_t kKeywords = 5000;
+constexpr size_t kFull = 195000;
+constexpr size_t kProbes = 1 << 16;
+// Номера правил: категории geosite делят номер исходного правила
+constexpr uint32_t kRules = 32;
+
+const char* const kSyllables[] = {"ka", "zo", "mi", "tel", "ex", "am", "ple", "net", "cdn",
+                                  "ru", "vi", "de", "o",   "st", "ream", "go", "lo", "pix",
+                                  "ya", "sh", "ap", "i",   "s",  "dat", "web", "mail"};
+const char* const kZones[] = {"com", "net", "org", "ru", "cn", "io", "de", "co.uk", "com.cn"};
+
+std::string Label(std::mt19937* random, int min_syllables) {
+  std::string label;
+  int syllables = min_syllables + (int)((*random)() % 3);
+  for (int i = 0; i < syllables; i++) {
+    label += kSyllables[(*random)() % (sizeof(kSyllables) / sizeof(kSyllables[0]))];
+  }
+  if ((*random)() % 4 == 0) label += std::to_string((*random)() % 100);
+  return label;
+}
+
+std::string Domain(std::mt19937* random) {
+  return Label(random, 2) + "." + kZones[(*random)() % (sizeof(kZones) / sizeof(kZones[0]))];
+}
+
+struct PatternSet {
+  std::vector<std::string> suffixes;
+  std::vector<std::string> full;
+  std::vector<std::string> keywords;
+  // Имена для поиска по видам: 0 - поддомены суффиксов, 1 - full-имена,
+  // 2 - имена вне списков full и суффиксов (подстроки изредка совпадают)
+  std::vector<std::string> probes[3];
+
+  PatternSet() {
+    std::mt19937 random(11);
+    for (size_t i = 0; i < kKeywords; i++) {
+      keywords.push_back(Label(&random, 3));
+    }
+    for (size_t i = 0; i < kFull; i++) {
+      full.push_back(Label(&random, 1) + "." + Domain(&random));
+    }
+    while (suffixes.size() < kPatterns - kKeywords - kFull) {
+      suffixes.push_back(Domain(&random));
+    }
+    for (size_t i = 0; i < kProbes; i++) {
+      probes[0].push_back("www." + Label(&random, 1) + "." +
+                          suffixes[random() % suffixes.size()]);
+      probes[1].push_back(full[random() % full.size()]);
+      probes[2].push_back(Label(&random, 1) + ".unlisted-" + Domain(&random));
+    }
+  }
+
+  void AddTo(DomainMatcher* matcher) const {
+    for (size_t i = 0; i < suffixes.size(); i++) {
+      matcher->AddPattern(DomainMatcher::PatternType::kSuffix, suffixes[i].data(),
+                          suffixes[i].size(), (uint32_t)(i % kRules));
+    }
+    for (size_t i = 0; i < full.size(); i++) {
+      matcher->AddPattern(DomainMatcher::PatternType::kFull, full[i].data(), full[i].size(),
+                          (uint32_t)(i % kRules));
+    }
+    for (size_t i = 0; i < keywords.size(); i++) {
+      matcher->AddPattern(DomainMatcher::PatternType::kKeyword, keywords[i].data(),
+                          keywords[i].size(), (uint32_t)(i % kRules));
+    }
+  }
+};
+
+const PatternSet& Patterns() {
+  static const PatternSet set;
+  return set;
+}
+
+const DomainMatcher& BuiltMatcher() {
+  static const DomainMatcher* matcher = [] {
+    DomainMatcher* built = new DomainMatcher();
+    Patterns().AddTo(built);
+    built->Build();
+    return built;
+  }();
+  return *matcher;
+}
+
+// Загрузка и компиляция всех шаблонов, как при применении профиля
+void BM_Build(benchmark::State& state) {
+  const PatternSet& set = Patterns();
+  size_t memory = 0;
+  size_t patterns = 0;
+  for (auto _ : state) {
+    DomainMatcher matcher;
+    set.AddTo(&matcher);
+    matcher.Build();
+    memory = matcher.MemoryUsage();
+    patterns = matcher.pattern_count();
+  }
+  state.counters["patterns"] = (double)patterns;
+  state.counters["memory_bytes"] = (double)memory;
+  state.counters["bytes_per_pattern"] = (double)memory / (double)patterns;
+  state.SetItemsProcessed((int64_t)(state.iterations() * patterns));
+}
+BENCHMARK(BM_Build)->Unit(benchmark::kMillisecond);
+
+// Аргумент - вид имени (см. PatternSet::probes); время - нс на имя
+void BM_Match(benchmark::State& state) {
+  const DomainMatcher& matcher = BuiltMatcher();
+  const std::vector<std::string>& probes = Patterns().probes[state.range(0)];
+  size_t matched = 0;
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& name = probes[i++ % kProbes];
+    uint32_t rule = matcher.Match(name.data(), name.size());
+    matched += rule != kNoRule;
+    benchmark::DoNotOptimize(rule);
+  }
+  state.counters["matched"] = (double)matched / (double)state.iterations();
+  state.counters["memory_bytes"] = (double)matcher.MemoryUsage();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Match)->DenseRange(0, 2);
+
+}  // namespace
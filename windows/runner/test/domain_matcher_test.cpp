@@ -0,0 +1,72 @@
+#include "domain_matcher.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+namespace {
+
+uint32_t Match(const DomainMatcher& matcher, const char* name) {
+  return matcher.Match(name, strlen(name));
+}
+
+TEST(DomainMatcherTest, FullSuffixAndKeyword) {
+  DomainMatcher matcher;
+  ASSERT_TRUE(matcher.AddRule("full:www.example.com", 20, 5));
+  ASSERT_TRUE(matcher.AddRule("domain:example.com", 18, 7));
+  ASSERT_TRUE(matcher.AddRule("keyword:tube", 12, 3));
+  ASSERT_TRUE(matcher.AddRule("cdn", 3, 9));  // без префикса - подстрока
+  EXPECT_FALSE(matcher.AddRule("regexp:.*", 9, 1));
+  matcher.Build();
+
+  EXPECT_EQ(Match(matcher, "www.example.com"), 5u);
+  EXPECT_EQ(Match(matcher, "WWW.Example.COM."), 5u);
+  EXPECT_EQ(Match(matcher, "a.www.example.com"), 7u);
+  EXPECT_EQ(Match(matcher, "example.com"), 7u);
+  EXPECT_EQ(Match(matcher, "badexample.com"), kNoRule);
+  EXPECT_EQ(Match(matcher, "youtube.com"), 3u);
+  EXPECT_EQ(Match(matcher, "cdn.example.com"), 7u);
+  EXPECT_EQ(Match(matcher, "mycdn.net"), 9u);
+  EXPECT_EQ(Match(matcher, ""), kNoRule);
+}
+
+// Точки в подстроке значимы, как в V2Ray: ".c" - это не "c"
+TEST(DomainMatcherTest, KeywordKeepsDots) {
+  DomainMatcher matcher;
+  ASSERT_TRUE(matcher.AddRule(".c", 2, 1));
+  ASSERT_TRUE(matcher.AddRule("keyword:google.", 15, 2));
+  matcher.Build();
+  EXPECT_EQ(Match(matcher, "tracker.org"), kNoRule);
+  EXPECT_EQ(Match(matcher, "example.com"), 1u);
+  EXPECT_EQ(Match(matcher, "google.org"), 2u);
+  EXPECT_EQ(Match(matcher, "google"), kNoRule);
+}
+
+TEST(DomainMatcherTest, GeositeList) {
+  DomainMatcher matcher;
+  const char kList[] =
+      "# comment\n"
+      "google.com @ads\n"
+      "full:ads.example.net\r\n"
+      "keyword:doubleclick\n"
+      "regexp:^ad\\d+\n"
+      "\n";
+  EXPECT_EQ(matcher.AddDomainList(kList, sizeof(kList) - 1, 4), 3u);
+  matcher.Build();
+  EXPECT_EQ(Match(matcher, "mail.google.com"), 4u);
+  EXPECT_EQ(Match(matcher, "ads.example.net"), 4u);
+  EXPECT_EQ(Match(matcher, "x.ads.example.net"), kNoRule);
+  EXPECT_EQ(Match(matcher, "stats.doubleclick.io"), 4u);
+}
+
+// Наименьший номер правила побеждает независимо от вида шаблона
+TEST(DomainMatcherTest, LowestRuleWins) {
+  DomainMatcher matcher;
+  matcher.AddPattern(DomainMatcher::PatternType::kSuffix, "com", 3, 10);
+  matcher.AddPattern(DomainMatcher::PatternType::kKeyword, "exam", 4, 2);
+  matcher.AddPattern(DomainMatcher::PatternType::kFull, "example.com", 11, 6);
+  matcher.Build();
+  EXPECT_EQ(Match(matcher, "example.com"), 2u);
+  EXPECT_EQ(Match(matcher, "test.com"), 10u);
+}
+
+}  // namespace
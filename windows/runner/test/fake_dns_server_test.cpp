@@ -0,0 +1,242 @@
+#include "fake_dns_server.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using socket_test::Loopback;
+
+constexpr uint16_t kTypeA = 1;
+constexpr uint16_t kTypeAaaa = 28;
+
+// Запрос с одним вопросом (RD)
+std::string Query(uint16_t id, const std::string& name, uint16_t type) {
+  std::string message = {(char)(id >> 8), (char)id, 0x01, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  size_t start = 0;
+  while (start <= name.size()) {
+    size_t dot = name.find('.', start);
+    if (dot == std::string::npos) dot = name.size();
+    message.push_back((char)(dot - start));
+    message += name.substr(start, dot - start);
+    start = dot + 1;
+  }
+  message.push_back(0);
+  message += {(char)(type >> 8), (char)type, 0, 1};
+  return message;
+}
+
+// Ответ вышестоящего сервера на |query|: A-запись 203.0.113.7
+std::string Answer(const std::string& query) {
+  std::string answer = query;
+  answer[2] = (char)0x81;
+  answer[3] = (char)0x80;
+  answer[7] = 1;
+  answer += {(char)0xc0, 12, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, (char)203, 0, 113, 7};
+  return answer;
+}
+
+uint16_t Id(const std::string& message) {
+  return (uint16_t)(((uint8_t)message[0] << 8) | (uint8_t)message[1]);
+}
+
+class FakeDnsServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    upstream_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = Loopback(0);
+    ASSERT_EQ(bind(upstream_, (sockaddr*)&address, sizeof(address)), 0);
+    socket_test::SetReceiveTimeout(upstream_, 2000);
+
+    server_.reset(new FakeDnsServer(&table_, [](const std::string& domain) {
+      return domain.size() >= 6 && domain.compare(domain.size() - 6, 6, ".proxy") == 0;
+    }));
+    FakeDnsServer::Options options;
+    options.port = 0;
+    options.upstream = "127.0.0.1";
+    options.upstream_port = socket_test::LocalPort(upstream_);
+    ASSERT_TRUE(server_->Start(options));
+
+    client_ = socket(AF_INET, SOCK_DGRAM, 0);
+    socket_test::SetReceiveTimeout(client_, 2000);
+  }
+
+  void TearDown() override {
+    server_->Stop();
+    close(client_);
+    close(upstream_);
+  }
+
+  void Ask(const std::string& query) {
+    sockaddr_in server = Loopback(server_->port());
+    sendto(client_, query.data(), query.size(), 0, (sockaddr*)&server, sizeof(server));
+  }
+
+  // Ответ клиенту или пустая строка по таймауту
+  std::string ReceiveAnswer() { return ReceiveOn(client_, nullptr); }
+
+  // Пересланный запрос и адрес сокета, с которого он пришел
+  std::string ReceiveForwarded(sockaddr_in* from) { return ReceiveOn(upstream_, from); }
+
+  void SendFromUpstream(const std::string& message, const sockaddr_in& to) {
+    sendto(upstream_, message.data(), message.size(), 0, (const sockaddr*)&to, sizeof(to));
+  }
+
+  static std::string ReceiveOn(int socket, sockaddr_in* from) {
+    char buffer[4096];
+    sockaddr_in source = {};
+    socklen_t length = sizeof(source);
+    ssize_t received;
+    do {
+      received = recvfrom(socket, buffer, sizeof(buffer), 0, (sockaddr*)&source, &length);
+    } while (received < 0 && errno == EINTR);
+    if (from != nullptr) *from = source;
+    return received > 0 ? std::string(buffer, (size_t)received) : std::string();
+  }
+
+  FakeIpTable table_;
+  std::unique_ptr<FakeDnsServer> server_;
+  int upstream_ = -1;
+  int client_ = -1;
+};
+
+TEST_F(FakeDnsServerTest, FakesProxiedNames) {
+  Ask(Query(0x1234, "Game.Proxy", kTypeA));
+  std::string answer = ReceiveAnswer();
+  ASSERT_EQ(answer.size(), Query(0, "game.proxy", kTypeA).size() + 16);
+  EXPECT_EQ(Id(answer), 0x1234);
+  const uint8_t* address = (const uint8_t*)answer.data() + answer.size() - 4;
+  uint32_t fake = ((uint32_t)address[0] << 24) | (address[1] << 16) | (address[2] << 8) | address[3];
+  std::string domain;
+  ASSERT_TRUE(table_.Lookup(fake, &domain));
+  EXPECT_EQ(domain, "game.proxy");
+
+  // AAAA для такого имени - пустой ответ, чтобы приложение не обошло fake-IP
+  Ask(Query(0x1235, "game.proxy", kTypeAaaa));
+  answer = ReceiveAnswer();
+  ASSERT_GE(answer.size(), 12u);
+  EXPECT_EQ(answer[7], 0);
+  EXPECT_EQ(answer[3] & 0x0f, 0);
+  EXPECT_EQ(server_->faked_count(), 2u);
+}
+
+TEST_F(FakeDnsServerTest, ForwardsOtherNamesAndRestoresId) {
+  std::string query = Query(0x4242, "example.com", kTypeA);
+  Ask(query);
+  sockaddr_in from;
+  std::string forwarded = ReceiveForwarded(&from);
+  ASSERT_EQ(forwarded.size(), query.size());
+  EXPECT_EQ(forwarded.substr(2), query.substr(2));
+
+  SendFromUpstream(Answer(forwarded), from);
+  std::string answer = ReceiveAnswer();
+  EXPECT_EQ(Id(answer), 0x4242);
+  EXPECT_EQ(answer.substr(2), Answer(query).substr(2));
+  EXPECT_EQ(server_->forwarded_count(), 1u);
+}
+
+// Идентификаторы и порты пересылки случайны (RFC 5452), а не 0, 1, 2...
+TEST_F(FakeDnsServerTest, RandomizesIdsAndPorts) {
+  constexpr int kQueries = 64;
+  std::set<uint16_t> ids;
+  std::set<uint16_t> ports;
+  int sequential = 0;
+  uint16_t previous = 0;
+  for (int i = 0; i < kQueries; i++) {
+    Ask(Query((uint16_t)i, "name" + std::to_string(i) + ".example.com", kTypeA));
+    sockaddr_in from;
+    std::string forwarded = ReceiveForwarded(&from);
+    ASSERT_FALSE(forwarded.empty());
+    uint16_t id = Id(forwarded);
+    if (i > 0 && id == (uint16_t)(previous + 1)) sequential++;
+    previous = id;
+    ids.insert(id);
+    ports.insert(ntohs(from.sin_port));
+    SendFromUpstream(Answer(forwarded), from);
+    ASSERT_FALSE(ReceiveAnswer().empty());
+  }
+  EXPECT_GT(ids.size(), (size_t)kQueries - 4);
+  EXPECT_LT(sequential, 4);
+  EXPECT_GT(ports.size(), 1u);
+}
+
+// Ответ с чужим вопросом не принимается, и ожидающий запрос остается ждать
+TEST_F(FakeDnsServerTest, RejectsAnswerToAnotherQuestion) {
+  Ask(Query(7, "victim.example.com", kTypeA));
+  sockaddr_in from;
+  std::string forwarded = ReceiveForwarded(&from);
+  ASSERT_FALSE(forwarded.empty());
+
+  std::string spoofed = Answer(Query(Id(forwarded), "other.example.com", kTypeA));
+  SendFromUpstream(spoofed, from);
+  std::string wrong_type = Answer(Query(Id(forwarded), "victim.example.com", kTypeAaaa));
+  SendFromUpstream(wrong_type, from);
+  std::string wrong_id = Answer(forwarded);
+  wrong_id[0] = (char)(wrong_id[0] ^ 0x5a);
+  SendFromUpstream(wrong_id, from);
+  // Не ответ, а запрос с тем же идентификатором
+  SendFromUpstream(forwarded, from);
+
+  SendFromUpstream(Answer(forwarded), from);
+  std::string answer = ReceiveAnswer();
+  EXPECT_EQ(Id(answer), 7);
+  EXPECT_EQ(answer.substr(2), Answer(Query(7, "victim.example.com", kTypeA)).substr(2));
+  EXPECT_EQ(server_->rejected_count(), 4u);
+}
+
+// Ответ на другой сокет пересылки или не от вышестоящего сервера
+TEST_F(FakeDnsServerTest, RejectsAnswerOnWrongSocketOrFromStranger) {
+  // Узнаем порты сокетов пересылки
+  std::vector<sockaddr_in> sockets;
+  for (int i = 0; i < 64 && sockets.size() < 2; i++) {
+    Ask(Query((uint16_t)i, "probe" + std::to_string(i) + ".example.com", kTypeA));
+    sockaddr_in from;
+    std::string forwarded = ReceiveForwarded(&from);
+    ASSERT_FALSE(forwarded.empty());
+    if (sockets.empty() || sockets[0].sin_port != from.sin_port) sockets.push_back(from);
+    SendFromUpstream(Answer(forwarded), from);
+    ASSERT_FALSE(ReceiveAnswer().empty());
+  }
+  ASSERT_EQ(sockets.size(), 2u);
+  uint64_t rejected = server_->rejected_count();
+
+  Ask(Query(99, "target.example.com", kTypeA));
+  sockaddr_in from;
+  std::string forwarded = ReceiveForwarded(&from);
+  const sockaddr_in& other = sockets[0].sin_port != from.sin_port ? sockets[0] : sockets[1];
+  SendFromUpstream(Answer(forwarded), other);
+
+  int stranger = socket(AF_INET, SOCK_DGRAM, 0);
+  std::string answer = Answer(forwarded);
+  sendto(stranger, answer.data(), answer.size(), 0, (const sockaddr*)&from, sizeof(from));
+  close(stranger);
+
+  SendFromUpstream(Answer(forwarded), from);
+  EXPECT_EQ(Id(ReceiveAnswer()), 99);
+  // Ответ на другой сокет мог быть разобран после верного
+  for (int i = 0; i < 100 && server_->rejected_count() < rejected + 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(server_->rejected_count(), rejected + 2);
+}
+
+// Запрос без единственного вопроса: FORMERR вместо пересылки
+TEST_F(FakeDnsServerTest, RejectsQueryWithoutSingleQuestion) {
+  std::string query = Query(0x0101, "example.com", kTypeA);
+  query[5] = 2;
+  Ask(query);
+  std::string answer = ReceiveAnswer();
+  ASSERT_EQ(answer.size(), 12u);
+  EXPECT_EQ(Id(answer), 0x0101);
+  EXPECT_EQ(answer[3] & 0x0f, 1);
+  EXPECT_EQ(server_->forwarded_count(), 0u);
+}
+
+}  // namespace
@@ -0,0 +1,180 @@
+#include "fake_ip_table.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kBase = 0x0A000000;  // 10.0.0.0
+
+std::string Name(const FakeIpTable& table, uint32_t address) {
+  std::string domain;
+  return table.Lookup(address, &domain) ? domain : "";
+}
+
+TEST(FakeIpTableTest, AssignsAndNormalizes) {
+  FakeIpTable table(kBase, 24, 100);
+  uint32_t first = table.Assign("Example.COM.");
+  EXPECT_EQ(first, kBase + 1);  // адрес сети не выдается
+  EXPECT_EQ(table.Assign("example.com"), first);
+  EXPECT_EQ(table.Assign("www.example.com"), kBase + 2);
+  EXPECT_EQ(Name(table, first), "example.com");
+  EXPECT_EQ(Name(table, kBase + 3), "");
+  EXPECT_EQ(table.Assign(""), 0u);
+  EXPECT_EQ(table.Assign(std::string(FakeIpTable::kMaxDomain + 1, 'a')), 0u);
+  EXPECT_NE(table.Assign(std::string(FakeIpTable::kMaxDomain, 'a')), 0u);
+  EXPECT_EQ(table.size(), 3u);
+
+  EXPECT_TRUE(table.Contains(kBase));
+  EXPECT_TRUE(table.Contains(kBase + 255));
+  EXPECT_FALSE(table.Contains(kBase + 256));
+  EXPECT_FALSE(table.Contains(kBase - 1));
+  std::string domain;
+  EXPECT_FALSE(table.Lookup(0xC0A80001, &domain));
+
+  table.Clear();
+  EXPECT_EQ(table.size(), 0u);
+  EXPECT_EQ(Name(table, first), "");
+  EXPECT_EQ(table.Assign("other.com"), kBase + 1);
+}
+
+// Емкость не больше адресов пула без адреса сети и широковещательного
+TEST(FakeIpTableTest, BoundedCapacity) {
+  FakeIpTable table(kBase, 24, 4);
+  EXPECT_EQ(table.capacity(), 4u);
+  std::vector<uint32_t> addresses;
+  for (int i = 0; i < 10; i++) {
+    addresses.push_back(table.Assign("host" + std::to_string(i) + ".test"));
+    EXPECT_LE(table.size(), 4u);
+  }
+  EXPECT_EQ(table.size(), 4u);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(Name(table, addresses[i]), i < 6 ? "" : "host" + std::to_string(i) + ".test")
+        << i;
+  }
+
+  FakeIpTable small(kBase, 30, 1000);
+  EXPECT_EQ(small.capacity(), 2u);
+  FakeIpTable prefix(kBase, 40, 1000);  // длина префикса ограничивается 30
+  EXPECT_EQ(prefix.capacity(), 2u);
+}
+
+// Вытесняется самая старая запись, но запись, адрес которой искали,
+// получает второй шанс; повторный Assign тоже переносит имя в начало
+TEST(FakeIpTableTest, SecondChanceEviction) {
+  FakeIpTable table(kBase, 24, 3);
+  uint32_t a = table.Assign("a.test");
+  uint32_t b = table.Assign("b.test");
+  uint32_t c = table.Assign("c.test");
+  EXPECT_EQ(Name(table, a), "a.test");  // a получает второй шанс
+  uint32_t d = table.Assign("d.test");
+  EXPECT_EQ(Name(table, b), "");
+  EXPECT_EQ(Name(table, c), "c.test");  // поиск помечает c и d
+  EXPECT_EQ(Name(table, d), "d.test");
+
+  // Второй шанс снял пометку a: теперь вытесняется a, а c переносится
+  uint32_t e = table.Assign("e.test");
+  EXPECT_EQ(table.size(), 3u);
+  EXPECT_EQ(Name(table, a), "");
+  EXPECT_EQ(Name(table, c), "c.test");
+  EXPECT_EQ(Name(table, d), "d.test");
+  EXPECT_EQ(Name(table, e), "e.test");
+
+  FakeIpTable fresh(kBase, 24, 3);
+  uint32_t x = fresh.Assign("x.test");
+  uint32_t y = fresh.Assign("y.test");
+  fresh.Assign("z.test");
+  EXPECT_EQ(fresh.Assign("x.test"), x);  // x - снова самая новая
+  fresh.Assign("w.test");
+  std::string name;
+  EXPECT_TRUE(fresh.Lookup(x, &name));
+  EXPECT_FALSE(fresh.Lookup(y, &name));
+}
+
+// Адреса выдаются по кругу через весь пул: освобожденный адрес достается
+// новому имени как можно позже, занятые при переходе через конец
+// пропускаются
+TEST(FakeIpTableTest, AddressReuseOrder) {
+  // /29: восемь адресов, выдаются 1..6
+  FakeIpTable table(kBase, 29, 3);
+  std::vector<uint32_t> offsets;
+  for (int i = 0; i < 10; i++) {
+    offsets.push_back(table.Assign("n" + std::to_string(i) + ".test") - kBase);
+  }
+  EXPECT_EQ(offsets, std::vector<uint32_t>({1, 2, 3, 4, 5, 6, 1, 2, 3, 4}));
+
+  FakeIpTable wrap(kBase, 29, 5);
+  uint32_t a = wrap.Assign("a.test");
+  for (const char* name : {"b.test", "c.test", "d.test", "e.test"}) {
+    wrap.Assign(name);
+  }
+  EXPECT_EQ(Name(wrap, a), "a.test");
+  EXPECT_EQ(wrap.Assign("f.test") - kBase, 6u);  // вытеснен b (адрес 2)
+  EXPECT_EQ(Name(wrap, kBase + 2), "");
+  // Вытеснен c (адрес 3); адрес 1 занят a, поэтому новое имя получает 2
+  EXPECT_EQ(wrap.Assign("g.test") - kBase, 2u);
+  EXPECT_EQ(Name(wrap, a), "a.test");
+  EXPECT_EQ(Name(wrap, kBase + 3), "");
+}
+
+// Lookup() без блокировок во время вытеснения: имя по адресу всегда то,
+// которому этот адрес выдан, вытесненные записи не читаются после
+// освобождения (проверяется и под -DRUNNER_SANITIZE=thread/address)
+TEST(FakeIpTableTest, ConcurrentLookup) {
+  constexpr int kNames = 100000;
+  constexpr int kReaders = 4;
+  FakeIpTable table(kBase, 16, 1024);
+  std::unique_ptr<std::atomic<uint32_t>[]> assigned(new std::atomic<uint32_t>[kNames]);
+  for (int i = 0; i < kNames; i++) {
+    assigned[i].store(0, std::memory_order_relaxed);
+  }
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> mismatches{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < kReaders; r++) {
+    readers.emplace_back([&, r] {
+      std::mt19937 random(r);
+      std::string domain;
+      uint64_t local_hits = 0;
+      while (!done.load(std::memory_order_acquire)) {
+        uint32_t address = kBase + 1 + random() % 4096;
+        if (!table.Lookup(address, &domain)) continue;
+        local_hits++;
+        int index = -1;
+        if (sscanf(domain.c_str(), "host%d.test", &index) != 1 || index < 0 ||
+            index >= kNames) {
+          mismatches++;
+          continue;
+        }
+        // Адрес мог быть опубликован раньше, чем писатель его записал
+        uint32_t expected = assigned[index].load(std::memory_order_acquire);
+        if (expected != 0 && expected != address) {
+          mismatches++;
+        }
+      }
+      hits += local_hits;
+    });
+  }
+  for (int i = 0; i < kNames; i++) {
+    uint32_t address = table.Assign("host" + std::to_string(i) + ".test");
+    EXPECT_NE(address, 0u);
+    assigned[i].store(address, std::memory_order_release);
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& reader : readers) reader.join();
+
+  EXPECT_EQ(mismatches.load(), 0u);
+  EXPECT_GT(hits.load(), 0u);
+  EXPECT_EQ(table.size(), 1024u);
+}
+
+}  // namespace
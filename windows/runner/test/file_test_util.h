@@ -0,0 +1,52 @@
+#ifndef RUNNER_TEST_FILE_TEST_UTIL_H_
+#define RUNNER_TEST_FILE_TEST_UTIL_H_
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Временный каталог для тестов и бенчмарков модулей, которые пишут файлы
+// (хранилище серверов, журнал); удаляется вместе с содержимым.
+namespace file_test {
+
+class TempDirectory {
+ public:
+  TempDirectory() {
+    static std::atomic<int> counter{0};
+    std::string name = "runner_test_" +
+                       std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+                       "_" + std::to_string(counter++);
+    path_ = std::filesystem::temp_directory_path() / name;
+    std::filesystem::create_directories(path_);
+  }
+  ~TempDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+  }
+
+  TempDirectory(const TempDirectory&) = delete;
+  TempDirectory& operator=(const TempDirectory&) = delete;
+
+  std::string path() const { return path_.string(); }
+  std::string file(const std::string& name) const { return (path_ / name).string(); }
+
+ private:
+  std::filesystem::path path_;
+};
+
+inline std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+inline void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), (std::streamsize)content.size());
+}
+
+}  // namespace file_test
+
+#endif  // RUNNER_TEST_FILE_TEST_UTIL_H_
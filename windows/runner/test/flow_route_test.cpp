@@ -0,0 +1,146 @@
+#include "flow_route.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "packet_test_util.h"
+#include "sniff_test_util.h"
+
+namespace {
+
+using packet_test::Ipv4;
+using packet_test::Ipv4Packet;
+
+// Профили как их сохраняет RoutingProfile.toJson() (routing_service.dart)
+const char kGamingProfile[] = R"({"name": "Gaming", "rules": [
+  {"type": "ip", "value": "geoip:private", "action": "direct"},
+  {"type": "domain", "value": "geosite:category-games", "action": "proxy"},
+  {"type": "domain", "value": "steam", "action": "proxy"},
+  {"type": "domain", "value": "steampowered.com", "action": "proxy"},
+  {"type": "domain", "value": "epicgames.com", "action": "proxy"},
+  {"type": "domain", "value": "battlenet.com", "action": "proxy"},
+  {"type": "domain", "value": "ea.com", "action": "proxy"},
+  {"type": "domain", "value": "origin.com", "action": "proxy"},
+  {"type": "domain", "value": "riotgames.com", "action": "proxy"},
+  {"type": "domain", "value": "geosite:category-ads", "action": "block"},
+  {"type": "protocol", "value": "udp", "action": "proxy"},
+  {"type": "protocol", "value": "tcp", "action": "proxy"},
+  {"type": "port", "value": "3074", "action": "proxy"},
+  {"type": "port", "value": "3478-3480", "action": "proxy"},
+  {"type": "port", "value": "27000-27050", "action": "proxy"}],
+  "isSplitTunnelingEnabled": true, "isProxyOnlyEnabled": true, "udpSupport": true})";
+
+const char kStandardProfile[] = R"({"name": "Standard", "rules": [
+  {"type": "default", "value": "default", "action": "proxy"},
+  {"type": "ip", "value": "geoip:private", "action": "direct"},
+  {"type": "domain", "value": "geosite:category-ads", "action": "block"},
+  {"type": "protocol", "value": "tcp", "action": "proxy"},
+  {"type": "protocol", "value": "udp", "action": "proxy"},
+  {"type": "port", "value": "53", "action": "proxy"}],
+  "isSplitTunnelingEnabled": false, "isProxyOnlyEnabled": false, "udpSupport": true})";
+
+class FlowRouteTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    lists_.SetGeosite("category-ads", "doubleclick.net\n");
+    lists_.SetGeosite("category-games", "full:store.example-games.com\n");
+  }
+
+  void Compile(const char* profile, size_t length) {
+    ASSERT_TRUE(program_.CompileProfile(profile, length, lists_));
+  }
+
+  // Действие профиля для первого пакета потока к |destination|
+  RouteAction Route(uint8_t protocol, uint32_t destination, uint16_t port,
+                    const SniffResult* sniffed = nullptr) {
+    packet_ = Ipv4Packet(protocol, Ipv4(10, 0, 0, 2), 50000, destination, port, 0);
+    PacketHeaders headers;
+    EXPECT_TRUE(ParsePacketHeaders(packet_.data(), (uint32_t)packet_.size(), &headers));
+    query_ = FlowRouteQuery(headers, fake_ips_, sniffed, &domain_);
+    return program_.Evaluate(query_).action;
+  }
+
+  RuleLists lists_;
+  RuleProgram program_;
+  FakeIpTable fake_ips_;
+  std::vector<uint8_t> packet_;
+  std::string domain_;
+  RouteQuery query_;
+};
+
+// Фиктивный адрес из 198.18.0.0/15 попадал под geoip:private, и поток к
+// игровому серверу уходил напрямую вместо прокси
+TEST_F(FlowRouteTest, FakeIpRoutesByDomainNotPrivateRange) {
+  Compile(kGamingProfile, sizeof(kGamingProfile) - 1);
+  uint32_t fake = fake_ips_.Assign("euw.riotgames.com");
+  ASSERT_NE(fake, 0u);
+  EXPECT_EQ(Route(packet_test::kTcp, fake, 443), RouteAction::kProxy);
+  EXPECT_EQ(query_.family, 0);
+  EXPECT_EQ(std::string(query_.domain, query_.domain_length), "euw.riotgames.com");
+  EXPECT_EQ(query_.port, 443);
+
+  // Настоящий частный адрес по-прежнему идет напрямую
+  EXPECT_EQ(Route(packet_test::kTcp, Ipv4(192, 168, 1, 10), 443), RouteAction::kDirect);
+  EXPECT_EQ(query_.family, 4);
+}
+
+TEST_F(FlowRouteTest, FakeIpReachesDomainBlockRule) {
+  Compile(kStandardProfile, sizeof(kStandardProfile) - 1);
+  uint32_t fake = fake_ips_.Assign("ad.doubleclick.net");
+  EXPECT_EQ(Route(packet_test::kTcp, fake, 443), RouteAction::kBlock);
+  uint32_t other = fake_ips_.Assign("example.org");
+  EXPECT_EQ(Route(packet_test::kUdp, other, 443), RouteAction::kProxy);
+}
+
+// Имя fake-IP точнее SNI; без fake-IP имя берется из разобранных данных,
+// а адрес остается в запросе
+TEST_F(FlowRouteTest, SniffedNameAndProtocol) {
+  Compile(kGamingProfile, sizeof(kGamingProfile) - 1);
+  const char kSni[] = "cdn.example.net";
+  SniffResult sniffed;
+  sniffed.status = SniffStatus::kFound;
+  sniffed.protocol = SniffProtocol::kTls;
+  sniffed.host = kSni;
+  sniffed.host_length = sizeof(kSni) - 1;
+
+  uint32_t fake = fake_ips_.Assign("store.example-games.com");
+  EXPECT_EQ(Route(packet_test::kTcp, fake, 443, &sniffed), RouteAction::kProxy);
+  EXPECT_EQ(std::string(query_.domain, query_.domain_length), "store.example-games.com");
+  EXPECT_EQ(query_.protocols, kRouteProtocolTcp | kRouteProtocolTls);
+
+  Route(packet_test::kTcp, Ipv4(93, 184, 216, 34), 443, &sniffed);
+  EXPECT_EQ(query_.family, 4);
+  EXPECT_EQ(query_.ipv4, Ipv4(93, 184, 216, 34));
+  EXPECT_EQ(std::string(query_.domain, query_.domain_length), kSni);
+}
+
+// Повторная оценка после разбора (SniffedFlowFlags) идет через тот же
+// запрос: поток QUIC к fake-IP не попадает под geoip:private
+TEST_F(FlowRouteTest, SniffedFakeIpFlowStaysOffPrivateRange) {
+  Compile(kGamingProfile, sizeof(kGamingProfile) - 1);
+  uint32_t fake = fake_ips_.Assign("euw.riotgames.com");
+  std::vector<uint8_t> initial = sniff_test::QuicInitial(
+      sniff_test::kQuicV1, sniff_test::Dcid(1),
+      {sniff_test::CryptoFrame(0, sniff_test::ClientHello("euw.riotgames.com"))});
+  FlowSniffer sniffer;
+  SniffResult sniffed = sniffer.FeedDatagram(initial.data(), initial.size());
+  ASSERT_EQ(sniffed.status, SniffStatus::kFound);
+
+  EXPECT_EQ(Route(packet_test::kUdp, fake, 443, &sniffed), RouteAction::kProxy);
+  EXPECT_EQ(query_.family, 0);
+  EXPECT_EQ(query_.protocols, kRouteProtocolUdp | kRouteProtocolQuic);
+  EXPECT_EQ(std::string(query_.domain, query_.domain_length), "euw.riotgames.com");
+}
+
+// Адрес пула, за которым нет имени (запись вытеснена), остается адресом
+TEST_F(FlowRouteTest, UnassignedFakeAddressKeepsAddress) {
+  Compile(kGamingProfile, sizeof(kGamingProfile) - 1);
+  uint32_t address = FakeIpTable::kDefaultBase + 1000;
+  EXPECT_EQ(Route(packet_test::kUdp, address, 3074), RouteAction::kDirect);
+  EXPECT_EQ(query_.family, 4);
+  EXPECT_EQ(query_.domain, nullptr);
+}
+
+}  // namespace
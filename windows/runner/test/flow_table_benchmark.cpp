@@ -0,0 +1,70 @@
+#include "flow_table.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+namespace {
+
+FlowKey KeyFor(uint32_t id) {
+  FlowKey key;
+  key.family = 4;
+  key.protocol = 17;
+  key.source_port = (uint16_t)(id & 0xFFFF);
+  key.destination_port = 6881;
+  memcpy(key.source, &id, sizeof(id));
+  key.destination[0] = 1;
+  key.destination[3] = (uint8_t)(id >> 16);
+  return key;
+}
+
+// Миллион потоков (торрент-клиент) в таблице на 2M ячеек, как в
+// windivert_helper. Таблица общая для всех потоков бенчмарка.
+constexpr uint32_t kFlows = 1 << 20;
+std::unique_ptr<FlowTable> g_table;
+
+void SetUp(const benchmark::State& state) {
+  if (state.thread_index() != 0 || g_table) {
+    return;
+  }
+  g_table.reset(new FlowTable((size_t)1 << 21, 64));
+  FlowValue value;
+  for (uint32_t id = 0; id < kFlows; id++) {
+    g_table->Insert(KeyFor(id), value, 0, 300);
+  }
+}
+
+// Поиск без блокировок из нескольких потоков: задержка не должна расти
+// с числом читателей
+void BM_Lookup(benchmark::State& state) {
+  uint32_t id = (uint32_t)state.thread_index() * 7919;
+  FlowValue value;
+  for (auto _ : state) {
+    id = (id + 40503) & (kFlows - 1);
+    benchmark::DoNotOptimize(g_table->Lookup(KeyFor(id), 1, &value));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_Lookup)->Setup(SetUp)->ThreadRange(1, 8)->UseRealTime();
+
+// Смесь 90% поиска и 10% вставки/удаления (открытие и закрытие потоков)
+void BM_MixedChurn(benchmark::State& state) {
+  uint32_t id = (uint32_t)state.thread_index() * 7919;
+  uint32_t churn = kFlows + (uint32_t)state.thread_index() * (1 << 16);
+  uint32_t step = 0;
+  FlowValue value;
+  for (auto _ : state) {
+    id = (id + 40503) & (kFlows - 1);
+    if (++step % 10 == 0) {
+      FlowKey key = KeyFor(churn + (step & 0xFFFF));
+      g_table->Insert(key, value, 1, 300);
+      g_table->Remove(key);
+    } else {
+      benchmark::DoNotOptimize(g_table->Lookup(KeyFor(id), 1, &value));
+    }
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_MixedChurn)->Setup(SetUp)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,252 @@
+#include "flow_table.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Ключ и значение, однозначно выведенные из номера потока: по ним читатель
+// замечает разорванное чтение
+FlowKey KeyFor(uint32_t id) {
+  FlowKey key;
+  key.family = 4;
+  key.protocol = 6;
+  key.source_port = (uint16_t)(id & 0xFFFF);
+  key.destination_port = 443;
+  memcpy(key.source, &id, sizeof(id));
+  key.destination[0] = 1;
+  key.destination[3] = (uint8_t)(id >> 16);
+  return key;
+}
+
+FlowValue ValueFor(uint32_t id, uint32_t generation) {
+  FlowValue value;
+  uint32_t words[4] = {id, generation, id ^ generation, ~id};
+  memcpy(value.original_destination, words, sizeof(words));
+  value.original_port = (uint16_t)(id * 7);
+  value.family = 4;
+  value.flags = (uint8_t)generation;
+  value.reserved = id + generation;
+  return value;
+}
+
+bool ValueConsistent(uint32_t id, const FlowValue& value) {
+  uint32_t words[4];
+  memcpy(words, value.original_destination, sizeof(words));
+  uint32_t generation = words[1];
+  return words[0] == id && words[2] == (id ^ generation) && words[3] == ~id &&
+         value.original_port == (uint16_t)(id * 7) && value.family == 4 &&
+         value.flags == (uint8_t)generation && value.reserved == id + generation;
+}
+
+TEST(FlowTableTest, InsertLookupRemove) {
+  FlowTable table(1024, 4);
+  FlowValue value;
+  EXPECT_FALSE(table.Lookup(KeyFor(1), 0, &value));
+  ASSERT_TRUE(table.Insert(KeyFor(1), ValueFor(1, 0), 0, 60));
+  ASSERT_TRUE(table.Lookup(KeyFor(1), 0, &value));
+  EXPECT_TRUE(ValueConsistent(1, value));
+  EXPECT_FALSE(table.Lookup(KeyFor(1).Reversed(), 0, &value));
+
+  // Повторная вставка обновляет запись, а не добавляет новую
+  ASSERT_TRUE(table.Insert(KeyFor(1), ValueFor(1, 5), 0, 60));
+  EXPECT_EQ(table.size(), 1u);
+  ASSERT_TRUE(table.Lookup(KeyFor(1), 0, &value));
+  EXPECT_EQ(value.flags, 5);
+
+  EXPECT_TRUE(table.Remove(KeyFor(1)));
+  EXPECT_FALSE(table.Remove(KeyFor(1)));
+  EXPECT_FALSE(table.Lookup(KeyFor(1), 0, &value));
+  EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(FlowTableTest, ReversedKeySwapsEndpoints) {
+  FlowKey key = KeyFor(0x01020304);
+  FlowKey reversed = key.Reversed();
+  EXPECT_EQ(reversed.source_port, key.destination_port);
+  EXPECT_EQ(reversed.destination_port, key.source_port);
+  EXPECT_EQ(memcmp(reversed.source, key.destination, 16), 0);
+  EXPECT_EQ(memcmp(reversed.Reversed().source, key.source, 16), 0);
+}
+
+// Поток живет idle_timeout тиков с последнего Lookup
+TEST(FlowTableTest, ExpiresIdleFlows) {
+  FlowTable table(1024, 2);
+  table.Expire(0);
+  ASSERT_TRUE(table.Insert(KeyFor(1), ValueFor(1, 0), 0, 10));
+  ASSERT_TRUE(table.Insert(KeyFor(2), ValueFor(2, 0), 0, 10));
+
+  EXPECT_EQ(table.Expire(5), 0u);
+  EXPECT_TRUE(table.Lookup(KeyFor(1), 8, nullptr));
+  EXPECT_EQ(table.Expire(12), 1u);
+  EXPECT_FALSE(table.Lookup(KeyFor(2), 12, nullptr));
+  EXPECT_TRUE(table.Lookup(KeyFor(1), 12, nullptr));
+  EXPECT_EQ(table.Expire(40), 1u);
+  EXPECT_EQ(table.size(), 0u);
+}
+
+// Срок длиннее оборота колеса переносится, а не срабатывает раньше
+TEST(FlowTableTest, TimeoutLongerThanWheel) {
+  FlowTable table(64, 1);
+  table.Expire(0);
+  uint32_t timeout = FlowTable::kWheelSize * 2 + 10;
+  ASSERT_TRUE(table.Insert(KeyFor(1), ValueFor(1, 0), 0, timeout));
+  for (uint32_t now = 1; now < timeout; now += 100) {
+    ASSERT_EQ(table.Expire(now), 0u) << now;
+  }
+  EXPECT_EQ(table.Expire(timeout + 1), 1u);
+}
+
+// Удаленные записи не удлиняют пробы бесконечно и не мешают поиску
+TEST(FlowTableTest, ReusesTombstones) {
+  FlowTable table(64, 1);
+  for (uint32_t round = 0; round < 1000; round++) {
+    for (uint32_t i = 0; i < 40; i++) {
+      ASSERT_TRUE(table.Insert(KeyFor(round * 40 + i), ValueFor(i, round), round, 60));
+    }
+    for (uint32_t i = 0; i < 40; i += 2) {
+      ASSERT_TRUE(table.Remove(KeyFor(round * 40 + i)));
+    }
+    for (uint32_t i = 1; i < 40; i += 2) {
+      ASSERT_TRUE(table.Lookup(KeyFor(round * 40 + i), round, nullptr));
+      ASSERT_TRUE(table.Remove(KeyFor(round * 40 + i)));
+    }
+  }
+  EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(FlowTableTest, FullShardRejectsInsert) {
+  FlowTable table(16, 1);
+  ASSERT_EQ(table.capacity(), 16u);
+  for (uint32_t i = 0; i < 16; i++) {
+    ASSERT_TRUE(table.Insert(KeyFor(i), ValueFor(i, 0), 0, 60));
+  }
+  EXPECT_FALSE(table.Insert(KeyFor(100), ValueFor(100, 0), 0, 60));
+  EXPECT_TRUE(table.Insert(KeyFor(3), ValueFor(3, 1), 0, 60));
+}
+
+// Шард растет по мере заполнения, не теряя записей и их сроков
+TEST(FlowTableTest, GrowsShardsOnDemand) {
+  FlowTable table(1 << 12, 4, 64);
+  EXPECT_EQ(table.capacity(), 64u);
+  EXPECT_EQ(table.max_capacity(), 1u << 12);
+  table.Expire(0);
+  for (uint32_t i = 0; i < 1500; i++) {
+    ASSERT_TRUE(table.Insert(KeyFor(i), ValueFor(i, 0), 0, i % 2 ? 10 : 1000)) << i;
+  }
+  EXPECT_GE(table.capacity(), 3000u);
+  EXPECT_LE(table.capacity(), table.max_capacity());
+  FlowValue value;
+  for (uint32_t i = 0; i < 1500; i++) {
+    ASSERT_TRUE(table.Lookup(KeyFor(i), 0, &value)) << i;
+    ASSERT_TRUE(ValueConsistent(i, value));
+  }
+  EXPECT_EQ(table.Expire(20), 750u);
+  for (uint32_t i = 0; i < 1500; i++) {
+    ASSERT_EQ(table.Lookup(KeyFor(i), 20, nullptr), i % 2 == 0) << i;
+  }
+}
+
+// Выросший до предела шард отказывает, как таблица фиксированного размера
+TEST(FlowTableTest, GrowthStopsAtCapacity) {
+  FlowTable table(64, 1, 16);
+  for (uint32_t i = 0; i < 64; i++) {
+    ASSERT_TRUE(table.Insert(KeyFor(i), ValueFor(i, 0), 0, 60)) << i;
+  }
+  EXPECT_EQ(table.capacity(), 64u);
+  EXPECT_FALSE(table.Insert(KeyFor(100), ValueFor(100, 0), 0, 60));
+}
+
+// Писатели вставляют, обновляют и удаляют свои потоки, читатели без
+// блокировок сверяют каждое найденное значение, а колесо проворачивается
+// параллельно, а шарды растут под нагрузкой. Разорванное чтение или
+// потерянный поток - ошибка.
+TEST(FlowTableTest, ConcurrentStressWithExpiry) {
+  constexpr uint32_t kWriters = 4;
+  constexpr uint32_t kReaders = 4;
+  constexpr uint32_t kFlowsPerWriter = 20000;
+  FlowTable table(1 << 18, 16, 1 << 8);
+  std::atomic<uint32_t> now{0};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> torn{0};
+  std::atomic<uint64_t> missing{0};
+
+  std::vector<std::thread> threads;
+  for (uint32_t w = 0; w < kWriters; w++) {
+    threads.emplace_back([&, w] {
+      uint32_t base = w * kFlowsPerWriter;
+      for (uint32_t generation = 1; generation <= 6; generation++) {
+        for (uint32_t i = 0; i < kFlowsPerWriter; i++) {
+          uint32_t id = base + i;
+          if (!table.Insert(KeyFor(id), ValueFor(id, generation), now.load(), 1000000)) {
+            missing++;
+          }
+        }
+        // Свои потоки с долгим сроком обязаны находиться
+        for (uint32_t i = 0; i < kFlowsPerWriter; i += 7) {
+          if (!table.Lookup(KeyFor(base + i), now.load(), nullptr)) {
+            missing++;
+          }
+        }
+        for (uint32_t i = generation % 2; i < kFlowsPerWriter; i += 2) {
+          table.Remove(KeyFor(base + i));
+        }
+      }
+    });
+  }
+  for (uint32_t r = 0; r < kReaders; r++) {
+    threads.emplace_back([&, r] {
+      uint32_t id = r;
+      FlowValue value;
+      while (!stop.load(std::memory_order_relaxed)) {
+        id = (id * 1103515245u + 12345u) % (kWriters * kFlowsPerWriter);
+        if (table.Lookup(KeyFor(id), now.load(), &value) && !ValueConsistent(id, value)) {
+          torn++;
+        }
+      }
+    });
+  }
+  // Потоки с коротким сроком, которые истекают во время нагрузки
+  threads.emplace_back([&] {
+    uint32_t id = kWriters * kFlowsPerWriter;
+    while (!stop.load(std::memory_order_relaxed)) {
+      uint32_t tick = now.fetch_add(1) + 1;
+      for (int i = 0; i < 100; i++) {
+        table.Insert(KeyFor(id), ValueFor(id, 0), tick, 2);
+        id++;
+      }
+      table.Expire(tick);
+    }
+  });
+
+  for (uint32_t w = 0; w < kWriters; w++) {
+    threads[w].join();
+  }
+  stop = true;
+  for (size_t i = kWriters; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  EXPECT_EQ(torn.load(), 0u);
+  EXPECT_EQ(missing.load(), 0u);
+
+  // После последнего поколения остались нечетные номера каждого писателя
+  FlowValue value;
+  for (uint32_t id = 0; id < kWriters * kFlowsPerWriter; id++) {
+    bool expected = (id % kFlowsPerWriter) % 2 == 1;
+    ASSERT_EQ(table.Lookup(KeyFor(id), now.load(), &value), expected) << id;
+    if (expected) {
+      ASSERT_TRUE(ValueConsistent(id, value));
+      ASSERT_EQ(value.flags, 6);
+    }
+  }
+
+  // Короткие потоки истекают, долгие остаются
+  table.Expire(now.load() + 10);
+  EXPECT_EQ(table.size(), kWriters * kFlowsPerWriter / 2);
+}
+
+}  // namespace
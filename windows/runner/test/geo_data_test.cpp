@@ -0,0 +1,143 @@
+#include "geo_data.h"
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <string>
+
+#include "rule_program.h"
+
+namespace {
+
+// Минимальная запись protobuf для сборки geosite.dat / geoip.dat в тесте
+std::string Varint(uint64_t value) {
+  std::string out;
+  while (value >= 0x80) {
+    out.push_back((char)(0x80 | (value & 0x7F)));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+  return out;
+}
+
+std::string BytesField(uint32_t field, const std::string& bytes) {
+  return Varint((field << 3) | 2) + Varint(bytes.size()) + bytes;
+}
+
+std::string VarintField(uint32_t field, uint64_t value) {
+  return Varint(field << 3) + Varint(value);
+}
+
+// Domain.Type: 0 - Plain (keyword), 1 - Regex, 2 - Domain, 3 - Full
+std::string Domain(uint64_t type, const std::string& value) {
+  return VarintField(1, type) + BytesField(2, value) +
+         BytesField(3, BytesField(1, "cn") + VarintField(2, 1));
+}
+
+std::string Cidr(const std::string& ip, uint32_t prefix) {
+  return BytesField(1, ip) + VarintField(2, prefix);
+}
+
+std::string GeositeDat() {
+  std::string ads = BytesField(1, "CATEGORY-ADS") + BytesField(2, Domain(2, "doubleclick.net"));
+  std::string cn = BytesField(1, "CN") + BytesField(2, Domain(2, "baidu.com")) +
+                   BytesField(2, Domain(3, "www.qq.com")) +
+                   BytesField(2, Domain(0, "taobao")) +
+                   BytesField(2, Domain(1, "^cn\\..*$"));
+  return BytesField(1, ads) + BytesField(1, cn);
+}
+
+std::string GeoipDat() {
+  std::string ipv6 = std::string("\x24\x08", 2) + std::string(14, '\0');
+  std::string cn = BytesField(1, "CN") +
+                   BytesField(2, Cidr(std::string("\x01\x00\x01\x00", 4), 24)) +
+                   BytesField(2, Cidr(ipv6, 20));
+  std::string reversed = BytesField(1, "NOT-CN") + BytesField(2, Cidr("\x08\x08\x08\x08", 32)) +
+                         VarintField(3, 1);
+  return BytesField(1, cn) + BytesField(1, reversed);
+}
+
+RouteQuery DomainQuery(const char* domain) {
+  RouteQuery query;
+  query.domain = domain;
+  query.domain_length = strlen(domain);
+  return query;
+}
+
+TEST(GeoDataTest, ExtractsGeositeCategory) {
+  std::string dat = GeositeDat();
+  std::string text;
+  ASSERT_TRUE(ExtractGeosite(dat.data(), dat.size(), "cn", &text));
+  EXPECT_EQ(text, "domain:baidu.com\nfull:www.qq.com\nkeyword:taobao\nregexp:^cn\\..*$\n");
+
+  text.clear();
+  ASSERT_TRUE(ExtractGeosite(dat.data(), dat.size(), "category-ads", &text));
+  EXPECT_EQ(text, "domain:doubleclick.net\n");
+
+  EXPECT_FALSE(ExtractGeosite(dat.data(), dat.size(), "ru", &text));
+  EXPECT_FALSE(ExtractGeosite(dat.data(), dat.size() - 3, "cn", &text));
+}
+
+TEST(GeoDataTest, ExtractsGeoipCategory) {
+  std::string dat = GeoipDat();
+  std::string text;
+  ASSERT_TRUE(ExtractGeoip(dat.data(), dat.size(), "CN", &text));
+  EXPECT_EQ(text, "1.0.1.0/24\n2408:0:0:0:0:0:0:0/20\n");
+
+  // reverse_match не поддерживается
+  EXPECT_FALSE(ExtractGeoip(dat.data(), dat.size(), "not-cn", &text));
+}
+
+// Профиль China() с категориями из geosite.dat / geoip.dat: от файла до
+// решения по домену и адресу
+TEST(GeoDataTest, ChinaProfileMatchesDatCategories) {
+  std::string geosite = GeositeDat();
+  std::string geoip = GeoipDat();
+  RuleLists lists;
+  std::string text;
+  ASSERT_TRUE(ExtractGeosite(geosite.data(), geosite.size(), "cn", &text));
+  lists.SetGeosite("cn", text);
+  text.clear();
+  ASSERT_TRUE(ExtractGeosite(geosite.data(), geosite.size(), "category-ads", &text));
+  lists.SetGeosite("category-ads", text);
+  text.clear();
+  ASSERT_TRUE(ExtractGeoip(geoip.data(), geoip.size(), "cn", &text));
+  lists.SetGeoip("cn", text);
+
+  const char kProfile[] = R"({
+    "name": "China", "udpSupport": true,
+    "rules": [
+      {"type": "ip", "value": "geoip:private", "action": "direct"},
+      {"type": "ip", "value": "geoip:cn", "action": "direct"},
+      {"type": "domain", "value": "geosite:cn", "action": "direct"},
+      {"type": "domain", "value": "geosite:category-ads", "action": "block"},
+      {"type": "default", "value": "", "action": "proxy"}
+    ]})";
+  RuleProgram program;
+  ASSERT_TRUE(program.CompileProfile(kProfile, sizeof(kProfile) - 1, lists));
+  EXPECT_EQ(program.unsupported_count(), 0u);
+
+  EXPECT_EQ(program.MatchDomain("map.baidu.com", 13).action, RouteAction::kDirect);
+  EXPECT_EQ(program.MatchDomain("www.qq.com", 10).action, RouteAction::kDirect);
+  EXPECT_EQ(program.MatchDomain("m.qq.com", 8).rule, kNoRule);
+  EXPECT_EQ(program.MatchDomain("world.taobao.net", 16).action, RouteAction::kDirect);
+  EXPECT_EQ(program.MatchDomain("ad.doubleclick.net", 18).action, RouteAction::kBlock);
+  EXPECT_EQ(program.Evaluate(DomainQuery("example.com")).action, RouteAction::kProxy);
+
+  RouteQuery address;
+  address.family = 4;
+  address.ipv4 = 0x010001FE;
+  EXPECT_EQ(program.Evaluate(address).rule, 1u);
+  address.ipv4 = 0x01000201;
+  EXPECT_EQ(program.Evaluate(address).action, RouteAction::kProxy);
+
+  RouteQuery ipv6;
+  ipv6.family = 6;
+  ipv6.ipv6[0] = 0x24;
+  ipv6.ipv6[1] = 0x08;
+  ipv6.ipv6[2] = 0x0F;
+  EXPECT_EQ(program.Evaluate(ipv6).rule, 1u);
+}
+
+}  // namespace
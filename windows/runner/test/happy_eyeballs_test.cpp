@@ -0,0 +1,303 @@
+#include "happy_eyeballs.h"
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+sockaddr_in6 Loopback6(uint16_t port) {
+  sockaddr_in6 address = {};
+  address.sin6_family = AF_INET6;
+  address.sin6_port = htons(port);
+  address.sin6_addr = in6addr_loopback;
+  return address;
+}
+
+uint16_t LocalPort6(int socket) {
+  sockaddr_in6 address = {};
+  socklen_t length = sizeof(address);
+  getsockname(socket, (sockaddr*)&address, &length);
+  return ntohs(address.sin6_port);
+}
+
+ResolvedAddress V4(uint16_t port) {
+  ResolvedAddress resolved = {};
+  sockaddr_in address = socket_test::Loopback(port);
+  memcpy(&resolved.address, &address, sizeof(address));
+  resolved.length = sizeof(address);
+  return resolved;
+}
+
+ResolvedAddress V6(uint16_t port) {
+  ResolvedAddress resolved = {};
+  sockaddr_in6 address = Loopback6(port);
+  memcpy(&resolved.address, &address, sizeof(address));
+  resolved.length = sizeof(address);
+  return resolved;
+}
+
+// Слушатель, connect() к которому завершается без accept()
+class Listener {
+ public:
+  explicit Listener(int family) : socket_(socket(family, SOCK_STREAM, 0)) {
+    if (family == AF_INET6) {
+      sockaddr_in6 address = Loopback6(0);
+      bind(socket_, (sockaddr*)&address, sizeof(address));
+      port_ = LocalPort6(socket_);
+    } else {
+      sockaddr_in address = socket_test::Loopback(0);
+      bind(socket_, (sockaddr*)&address, sizeof(address));
+      port_ = socket_test::LocalPort(socket_);
+    }
+    listen(socket_, SOMAXCONN);
+  }
+  ~Listener() { close(socket_); }
+
+  uint16_t port() const { return port_; }
+
+ protected:
+  int socket_;
+  uint16_t port_ = 0;
+};
+
+// "Черная дыра" на ::1: очередь accept() переполнена, и ядро молча
+// отбрасывает новые SYN - connect() висит, как при сломанном пути IPv6
+class Blackhole {
+ public:
+  Blackhole() : socket_(socket(AF_INET6, SOCK_STREAM, 0)) {
+    sockaddr_in6 address = Loopback6(0);
+    bind(socket_, (sockaddr*)&address, sizeof(address));
+    listen(socket_, 0);
+    port_ = LocalPort6(socket_);
+    address = Loopback6(port_);
+    // Заполняем очередь, пока очередной connect() не перестанет завершаться
+    for (int i = 0; i < 16; i++) {
+      int filler = socket(AF_INET6, SOCK_STREAM, 0);
+      SetSocketNonBlocking(filler);
+      connect(filler, (sockaddr*)&address, sizeof(address));
+      fillers_.push_back(filler);
+      pollfd wait = {filler, POLLOUT, 0};
+      if (poll(&wait, 1, 100) == 0) {
+        full_ = true;
+        break;
+      }
+    }
+  }
+  ~Blackhole() {
+    for (int filler : fillers_) close(filler);
+    close(socket_);
+  }
+
+  uint16_t port() const { return port_; }
+  bool full() const { return full_; }
+
+ private:
+  int socket_;
+  uint16_t port_ = 0;
+  bool full_ = false;
+  std::vector<int> fillers_;
+};
+
+// Порт ::1 или 127.0.0.1, на котором никто не слушает: connect() получает RST
+uint16_t ClosedPort(int family) {
+  Listener probe(family);
+  return probe.port();
+}
+
+size_t OpenDescriptors() {
+  size_t count = 0;
+  DIR* directory = opendir("/proc/self/fd");
+  while (readdir(directory) != nullptr) count++;
+  closedir(directory);
+  return count;
+}
+
+struct Completion : ConnectHandler {
+  bool done = false;
+  void OnConnectComplete(HappyEyeballsConnector*) override { done = true; }
+};
+
+class HappyEyeballsTest : public ::testing::TestWithParam<ReactorKind> {
+ protected:
+  void SetUp() override {
+    reactor_ = Reactor::Create(GetParam());
+    ASSERT_NE(reactor_, nullptr);
+  }
+
+  // Цикл потока реактора: таймеры соединителей перед каждым Poll()
+  bool RunUntil(const std::function<bool()>& done) {
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    while (!done()) {
+      if (Clock::now() > deadline) return false;
+      reactor_->Poll(timers_.RunDue(10));
+    }
+    return true;
+  }
+
+  // Гонка до завершения; возвращает время в мкс
+  int64_t Race(HappyEyeballsConnector* connector, const std::string& key,
+               const std::vector<ResolvedAddress>& addresses) {
+    Completion completion;
+    Clock::time_point start = Clock::now();
+    connector->Start(key, addresses.data(), addresses.size(), &completion);
+    EXPECT_TRUE(RunUntil([&] { return completion.done; }));
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  }
+
+  int WinnerFamily(HappyEyeballsConnector* connector) {
+    SocketHandle socket = connector->TakeSocket();
+    if (socket == kInvalidSocket) return 0;
+    reactor_->Close(socket);
+    return connector->address().address.ss_family;
+  }
+
+  std::unique_ptr<Reactor> reactor_;
+  ConnectorTimers timers_;
+  AddressFamilyCache cache_;
+};
+
+// IPv6 не отвечает: IPv4 стартует через kAttemptDelayUs и побеждает, а
+// висящая попытка IPv6 закрывается до вызова обработчика
+TEST_P(HappyEyeballsTest, StaggersAfterDelayAndClosesLosers) {
+  Blackhole blackhole;
+  ASSERT_TRUE(blackhole.full());
+  Listener v4(AF_INET);
+  size_t descriptors = OpenDescriptors();
+  HappyEyeballsConnector connector(reactor_.get(), &timers_, nullptr);
+  int64_t elapsed = Race(&connector, "", {V6(blackhole.port()), V4(v4.port())});
+  EXPECT_GE(elapsed, HappyEyeballsConnector::kAttemptDelayUs);
+  EXPECT_LT(elapsed, HappyEyeballsConnector::kAttemptDelayUs + 500 * 1000);
+  EXPECT_EQ(connector.error(), EHOSTUNREACH);
+  EXPECT_FALSE(connector.running());
+  EXPECT_EQ(WinnerFamily(&connector), AF_INET);
+  // Сокеты победителя и проигравшего закрыты
+  reactor_->Poll(0);
+  EXPECT_EQ(OpenDescriptors(), descriptors);
+}
+
+// Отказ (RST) не ждет задержки: следующий адрес пробуется сразу
+TEST_P(HappyEyeballsTest, RefusedFallsBackImmediately) {
+  Listener v4(AF_INET);
+  HappyEyeballsConnector connector(reactor_.get(), &timers_, nullptr);
+  int64_t elapsed = Race(&connector, "", {V6(ClosedPort(AF_INET6)), V4(v4.port())});
+  EXPECT_LT(elapsed, HappyEyeballsConnector::kAttemptDelayUs / 2);
+  EXPECT_EQ(WinnerFamily(&connector), AF_INET);
+}
+
+TEST_P(HappyEyeballsTest, AllRefusedReportsLastError) {
+  HappyEyeballsConnector connector(reactor_.get(), &timers_, nullptr);
+  int64_t elapsed =
+      Race(&connector, "", {V6(ClosedPort(AF_INET6)), V4(ClosedPort(AF_INET))});
+  EXPECT_LT(elapsed, HappyEyeballsConnector::kAttemptDelayUs / 2);
+  EXPECT_EQ(connector.TakeSocket(), kInvalidSocket);
+  EXPECT_EQ(connector.error(), ECONNREFUSED);
+
+  // Без адресов итог приходит внутри Start()
+  Completion completion;
+  connector.Start("", nullptr, 0, &completion);
+  EXPECT_TRUE(completion.done);
+  EXPECT_EQ(connector.error(), EHOSTUNREACH);
+}
+
+// Cancel() посреди гонки: обе попытки закрываются, итог - ECANCELED
+TEST_P(HappyEyeballsTest, CancelMidRace) {
+  Blackhole blackhole;
+  ASSERT_TRUE(blackhole.full());
+  size_t descriptors = OpenDescriptors();
+  HappyEyeballsConnector connector(reactor_.get(), &timers_, nullptr);
+  Completion completion;
+  std::vector<ResolvedAddress> addresses = {V6(blackhole.port()), V6(blackhole.port())};
+  connector.Start("", addresses.data(), addresses.size(), &completion);
+  // Вторая попытка уже начата
+  Clock::time_point started = Clock::now();
+  ASSERT_TRUE(RunUntil([&] {
+    return Clock::now() - started > std::chrono::microseconds(
+                                        HappyEyeballsConnector::kAttemptDelayUs + 50 * 1000);
+  }));
+  EXPECT_FALSE(completion.done);
+  connector.Cancel();
+  ASSERT_TRUE(RunUntil([&] { return completion.done; }));
+  EXPECT_EQ(connector.error(), ECANCELED);
+  EXPECT_EQ(connector.TakeSocket(), kInvalidSocket);
+  reactor_->Poll(0);
+  EXPECT_EQ(OpenDescriptors(), descriptors);
+}
+
+// Выигравшее семейство запоминается: следующий раз IPv4 идет первым и
+// соединяется без задержки
+TEST_P(HappyEyeballsTest, CachedFamilyGoesFirst) {
+  Blackhole blackhole;
+  ASSERT_TRUE(blackhole.full());
+  Listener v4(AF_INET);
+  std::vector<ResolvedAddress> addresses = {V6(blackhole.port()), V4(v4.port())};
+  HappyEyeballsConnector connector(reactor_.get(), &timers_, &cache_);
+  EXPECT_GE(Race(&connector, "example.com", addresses),
+            HappyEyeballsConnector::kAttemptDelayUs);
+  EXPECT_EQ(WinnerFamily(&connector), AF_INET);
+  EXPECT_EQ(cache_.Preferred("example.com", ConnectorTimers::NowUs()), AF_INET);
+
+  EXPECT_LT(Race(&connector, "example.com", addresses),
+            HappyEyeballsConnector::kAttemptDelayUs / 2);
+  EXPECT_EQ(WinnerFamily(&connector), AF_INET);
+  // Без ключа история не учитывается
+  EXPECT_GE(Race(&connector, "", addresses), HappyEyeballsConnector::kAttemptDelayUs);
+  EXPECT_EQ(WinnerFamily(&connector), AF_INET);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, HappyEyeballsTest,
+                         ::testing::Values(ReactorKind::kDefault, ReactorKind::kIoUring),
+                         [](const ::testing::TestParamInfo<ReactorKind>& info) {
+                           return std::string(info.param == ReactorKind::kIoUring ? "Uring"
+                                                                                  : "Epoll");
+                         });
+
+TEST(AddressFamilyCacheTest, PreferenceAndExpiry) {
+  AddressFamilyCache cache;
+  const int64_t now = 1000;
+  EXPECT_EQ(cache.Preferred("a.example", now), 0);
+  cache.Record("a.example", AF_INET6, now);
+  cache.Record("b.example", AF_INET, now);
+  EXPECT_EQ(cache.Preferred("a.example", now + 1), AF_INET6);
+  EXPECT_EQ(cache.Preferred("b.example", now + 1), AF_INET);
+  // Новая победа заменяет семейство и продлевает срок
+  cache.Record("a.example", AF_INET, now + 100);
+  EXPECT_EQ(cache.Preferred("a.example", now + AddressFamilyCache::kTtlUs), AF_INET);
+  // Запись устаревает через kTtlUs
+  EXPECT_EQ(cache.Preferred("b.example", now + AddressFamilyCache::kTtlUs), 0);
+  EXPECT_EQ(cache.Preferred("b.example", now), 0);
+  EXPECT_EQ(cache.Preferred("a.example", now + 100 + AddressFamilyCache::kTtlUs), 0);
+}
+
+// Емкость ограничена: вытесняются записи, устаревающие первыми
+TEST(AddressFamilyCacheTest, BoundedCapacity) {
+  AddressFamilyCache cache;
+  constexpr size_t kCapacity =
+      AddressFamilyCache::kShardCount * AddressFamilyCache::kShardCapacity;
+  constexpr size_t kKeys = kCapacity * 4;
+  for (size_t i = 0; i < kKeys; i++) {
+    cache.Record("host" + std::to_string(i), AF_INET, (int64_t)i);
+  }
+  size_t kept = 0;
+  size_t recent = 0;
+  for (size_t i = 0; i < kKeys; i++) {
+    if (cache.Preferred("host" + std::to_string(i), (int64_t)kKeys) != 0) {
+      kept++;
+      if (i >= kKeys - 64) recent++;
+    }
+  }
+  EXPECT_LE(kept, kCapacity);
+  EXPECT_GT(kept, kCapacity / 2);
+  EXPECT_EQ(recent, 64u);
+}
+
+}  // namespace
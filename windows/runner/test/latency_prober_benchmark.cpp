@@ -0,0 +1,140 @@
+#include "latency_prober.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+// Цели на 127.0.0.1: половина - слушатель, половина - закрытый порт (RST).
+// Слушатель принимает и сразу закрывает соединения, иначе очередь
+// принятия переполнится и замеры начнут уходить в таймаут.
+class Targets {
+ public:
+  explicit Targets(size_t count) : listener_(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in address = socket_test::Loopback(0);
+    bind(listener_, (sockaddr*)&address, sizeof(address));
+    listen(listener_, SOMAXCONN);
+    acceptor_ = std::thread([this] {
+      for (;;) {
+        int accepted = accept(listener_, nullptr, nullptr);
+        if (accepted >= 0) {
+          close(accepted);
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+          return;
+        }
+      }
+    });
+    int closed = socket(AF_INET, SOCK_STREAM, 0);
+    bind(closed, (sockaddr*)&address, sizeof(address));
+    uint16_t closed_port = socket_test::LocalPort(closed);
+    close(closed);
+    for (size_t i = 0; i < count; i++) {
+      ports_.push_back(i % 2 == 0 ? socket_test::LocalPort(listener_) : closed_port);
+    }
+  }
+  ~Targets() {
+    shutdown(listener_, SHUT_RDWR);
+    acceptor_.join();
+    close(listener_);
+  }
+
+  const std::vector<uint16_t>& ports() const { return ports_; }
+
+ private:
+  int listener_;
+  std::thread acceptor_;
+  std::vector<uint16_t> ports_;
+};
+
+// Круг замеров: ProbeNow() и ожидание нового замера у каждой цели.
+// Аргумент - число целей; items/s - замеров в секунду.
+void BM_ProbeRound(benchmark::State& state) {
+  Targets targets((size_t)state.range(0));
+  LatencyProber prober;
+  LatencyProber::Options options;
+  options.interval_ms = 60 * 1000;
+  if (!prober.Start(options)) {
+    state.SkipWithError("prober failed");
+    return;
+  }
+  std::vector<int32_t> ids;
+  for (uint16_t port : targets.ports()) {
+    ids.push_back(prober.AddTarget("127.0.0.1", port));
+  }
+  uint32_t round = 0;
+  for (auto _ : state) {
+    round++;
+    if (round > 1) prober.ProbeNow();
+    bool failed = false;
+    for (int32_t id : ids) {
+      LatencyStats stats;
+      while (!failed && (!prober.Read(id, &stats) || stats.samples < round)) {
+        failed = stats.failures > 0;
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+      }
+    }
+    if (failed) {
+      state.SkipWithError("probe failed");
+      break;
+    }
+  }
+  prober.Stop();
+  state.SetItemsProcessed((int64_t)(state.iterations() * ids.size()));
+}
+BENCHMARK(BM_ProbeRound)->Arg(16)->Arg(256)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Прежний способ для сравнения: блокирующий connect() к целям по одной
+void BM_SequentialBlockingProbe(benchmark::State& state) {
+  Targets targets((size_t)state.range(0));
+  for (auto _ : state) {
+    for (uint16_t port : targets.ports()) {
+      int client = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address = socket_test::Loopback(port);
+      benchmark::DoNotOptimize(connect(client, (sockaddr*)&address, sizeof(address)));
+      close(client);
+    }
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * targets.ports().size()));
+}
+BENCHMARK(BM_SequentialBlockingProbe)
+    ->Arg(16)
+    ->Arg(256)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// Чтение опубликованной статистики (GetTrafficStats, GetLatencyStats) из
+// нескольких потоков, пока поток замеров публикует новые значения
+void BM_ReadStats(benchmark::State& state) {
+  static LatencyProber* prober = nullptr;
+  static Targets* targets = nullptr;
+  static int32_t id = -1;
+  if (state.thread_index() == 0) {
+    targets = new Targets(1);
+    prober = new LatencyProber();
+    LatencyProber::Options options;
+    options.interval_ms = 1;
+    prober->Start(options);
+    id = prober->AddTarget("127.0.0.1", targets->ports()[0]);
+    LatencyStats stats;
+    while (!prober->Read(id, &stats)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  for (auto _ : state) {
+    LatencyStats stats;
+    benchmark::DoNotOptimize(prober->Read(id, &stats));
+    benchmark::DoNotOptimize(stats);
+  }
+  if (state.thread_index() == 0) {
+    delete prober;
+    delete targets;
+  }
+}
+BENCHMARK(BM_ReadStats)->Threads(1)->Threads(4);
+
+}  // namespace
@@ -0,0 +1,255 @@
+#include "latency_prober.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+sockaddr_storage Storage(const sockaddr_in& address) {
+  sockaddr_storage storage = {};
+  memcpy(&storage, &address, sizeof(address));
+  return storage;
+}
+
+// Слушатель на 127.0.0.1: connect() завершается без accept()
+class Listener {
+ public:
+  Listener() : socket_(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in address = socket_test::Loopback(0);
+    bind(socket_, (sockaddr*)&address, sizeof(address));
+    listen(socket_, SOMAXCONN);
+  }
+  ~Listener() { close(socket_); }
+
+  uint16_t port() const { return socket_test::LocalPort(socket_); }
+
+ private:
+  int socket_;
+};
+
+// Порт, на котором никто не слушает: connect() получает RST
+uint16_t ClosedPort() {
+  int probe = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  bind(probe, (sockaddr*)&address, sizeof(address));
+  uint16_t port = socket_test::LocalPort(probe);
+  close(probe);
+  return port;
+}
+
+bool WaitFor(const std::function<bool()>& done) {
+  Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+  while (!done()) {
+    if (Clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+class LatencyProberTest : public ::testing::Test {
+ protected:
+  void Start(uint32_t interval_ms = 60 * 1000, uint32_t timeout_ms = 1000) {
+    LatencyProber::Options options;
+    options.interval_ms = interval_ms;
+    options.timeout_ms = timeout_ms;
+    ASSERT_TRUE(prober_.Start(options));
+  }
+
+  bool WaitForSamples(int32_t id, uint32_t samples, LatencyStats* stats) {
+    return WaitFor([&] { return prober_.Read(id, stats) && stats->samples >= samples; });
+  }
+
+  LatencyProber prober_;
+};
+
+TEST_F(LatencyProberTest, MeasuresListener) {
+  Listener listener;
+  Start();
+  int32_t id = prober_.AddTarget(Storage(socket_test::Loopback(listener.port())),
+                                 sizeof(sockaddr_in));
+  ASSERT_GE(id, 0);
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+  EXPECT_EQ(stats.failures, 0u);
+  EXPECT_EQ(stats.smoothed_us, stats.last_us);
+  // Первый замер: джиттер - половина RTT (RFC 6298)
+  EXPECT_EQ(stats.jitter_us, stats.last_us / 2);
+  EXPECT_LT(stats.last_us, 1000u * 1000u);
+}
+
+TEST_F(LatencyProberTest, NoStatsBeforeFirstProbe) {
+  LatencyStats stats;
+  EXPECT_FALSE(prober_.Read(0, &stats));
+  EXPECT_FALSE(prober_.Read(-1, &stats));
+  EXPECT_FALSE(prober_.Read((int32_t)LatencyProber::kMaxTargets, &stats));
+}
+
+// RST - тоже ответ сервера: замер засчитывается
+TEST_F(LatencyProberTest, RefusedConnectionIsSample) {
+  Start();
+  int32_t id = prober_.AddTarget("127.0.0.1", ClosedPort());
+  ASSERT_GE(id, 0);
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+  EXPECT_EQ(stats.failures, 0u);
+}
+
+TEST_F(LatencyProberTest, ProbeNowStartsNextRound) {
+  Listener listener;
+  Start();
+  int32_t id = prober_.AddTarget("127.0.0.1", listener.port());
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+  for (uint32_t round = 2; round <= 5; round++) {
+    prober_.ProbeNow();
+    ASSERT_TRUE(WaitForSamples(id, round, &stats)) << "round " << round;
+  }
+  EXPECT_EQ(stats.failures, 0u);
+}
+
+TEST_F(LatencyProberTest, RoundsRepeatOnInterval) {
+  Listener listener;
+  Start(20);
+  int32_t id = prober_.AddTarget("127.0.0.1", listener.port());
+  LatencyStats stats;
+  EXPECT_TRUE(WaitForSamples(id, 3, &stats));
+}
+
+// Имя разрешается в фоне, потом цель замеряется как обычно
+TEST_F(LatencyProberTest, ResolvesNameTarget) {
+  Listener listener;
+  Start();
+  int32_t id = prober_.AddTarget("localhost", listener.port());
+  ASSERT_GE(id, 0);
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+  EXPECT_EQ(stats.failures, 0u);
+}
+
+TEST_F(LatencyProberTest, NameTargetNeedsRunningProber) {
+  EXPECT_EQ(prober_.AddTarget("localhost", 80), -1);
+  // IP-литерал регистрируется и до запуска
+  EXPECT_GE(prober_.AddTarget("127.0.0.1", 80), 0);
+}
+
+// Сервер, который не отвечает: очередь принятия заполнена, новые SYN
+// отбрасываются. Таймаут считается неудачей, замеры не появляются.
+TEST_F(LatencyProberTest, SilentServerCountsFailures) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  ASSERT_EQ(bind(listener, (sockaddr*)&address, sizeof(address)), 0);
+  ASSERT_EQ(listen(listener, 0), 0);
+  address = socket_test::Loopback(socket_test::LocalPort(listener));
+  std::vector<int> backlog;
+  for (int i = 0; i < 4; i++) {
+    backlog.push_back(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0));
+    connect(backlog.back(), (sockaddr*)&address, sizeof(address));
+  }
+
+  Start(20, 50);
+  int32_t id = prober_.AddTarget(Storage(address), sizeof(address));
+  ASSERT_GE(id, 0);
+  LatencyStats stats;
+  EXPECT_TRUE(WaitFor([&] { return prober_.Read(id, &stats) && stats.failures >= 2; }));
+  EXPECT_EQ(stats.samples, 0u);
+  prober_.Stop();
+  for (int client : backlog) close(client);
+  close(listener);
+}
+
+// Место удаленной цели переиспользуется; замеры прежней цели не видны
+TEST_F(LatencyProberTest, RemovedTargetHidesStats) {
+  Listener listener;
+  Start();
+  int32_t id = prober_.AddTarget("127.0.0.1", listener.port());
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+  prober_.RemoveTarget(id);
+  EXPECT_FALSE(prober_.Read(id, &stats));
+
+  // Новая цель на том же месте начинает сглаживание заново
+  int32_t reused = prober_.AddTarget("127.0.0.1", ClosedPort());
+  EXPECT_EQ(reused, id);
+  ASSERT_TRUE(WaitForSamples(reused, 1, &stats));
+  EXPECT_EQ(stats.samples, 1u);
+}
+
+TEST_F(LatencyProberTest, TargetLimit) {
+  Start();
+  for (size_t i = 0; i < LatencyProber::kMaxTargets; i++) {
+    ASSERT_EQ(prober_.AddTarget("127.0.0.1", 1), (int32_t)i);
+  }
+  EXPECT_EQ(prober_.AddTarget("127.0.0.1", 1), -1);
+  prober_.RemoveTarget(7);
+  EXPECT_EQ(prober_.AddTarget("127.0.0.1", 1), 7);
+}
+
+// Все цели замеряются за один круг, а не по очереди с ожиданием каждой
+TEST_F(LatencyProberTest, ProbesTargetsInParallel) {
+  constexpr size_t kTargets = 200;
+  Listener listener;
+  Start(60 * 1000, 2000);
+  std::vector<int32_t> ids;
+  for (size_t i = 0; i < kTargets; i++) {
+    ids.push_back(prober_.AddTarget("127.0.0.1", i % 2 == 0 ? listener.port() : ClosedPort()));
+  }
+  EXPECT_TRUE(WaitFor([&] {
+    LatencyStats stats;
+    for (int32_t id : ids) {
+      if (!prober_.Read(id, &stats) || stats.samples == 0) return false;
+    }
+    return true;
+  }));
+}
+
+// Чтение во время публикации: снимок не разорван (поля одного замера)
+TEST_F(LatencyProberTest, ReadersSeeConsistentSnapshots) {
+  Listener listener;
+  Start(1);
+  int32_t id = prober_.AddTarget("127.0.0.1", listener.port());
+  LatencyStats stats;
+  ASSERT_TRUE(WaitForSamples(id, 1, &stats));
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> torn{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      uint32_t last_samples = 0;
+      LatencyStats seen;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (!prober_.Read(id, &seen)) continue;
+        // Число замеров не убывает, замер без ошибок имеет RTT
+        if (seen.samples < last_samples || (seen.failures == 0 && seen.samples == 0)) torn++;
+        last_samples = seen.samples;
+      }
+    });
+  }
+  WaitForSamples(id, stats.samples + 50, &stats);
+  stop = true;
+  for (std::thread& reader : readers) reader.join();
+  EXPECT_EQ(torn.load(), 0u);
+}
+
+TEST_F(LatencyProberTest, RestartsAfterStop) {
+  Listener listener;
+  Start();
+  prober_.Stop();
+  EXPECT_FALSE(prober_.IsRunning());
+  Start();
+  int32_t id = prober_.AddTarget("localhost", listener.port());
+  LatencyStats stats;
+  EXPECT_TRUE(WaitForSamples(id, 1, &stats));
+}
+
+}  // namespace
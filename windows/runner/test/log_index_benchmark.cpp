@@ -0,0 +1,168 @@
+#include "log_index.h"
+
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr size_t kLines = 500000;
+// Страница поиска, как у NativeLogBridge.maxSearchLines
+constexpr size_t kPage = 4096;
+
+const char* const kLevelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+const char* const kWords[] = {"Соединение", "закрыто", "dns",    "Proxy",  "ёлка",
+                              "timeout",    "TUN",     "сервер", "Reality", "маршрут",
+                              "UDP",        "www.example-video.com"};
+
+struct Journal {
+  std::string data;
+  std::vector<uint32_t> offsets;
+  std::vector<int> levels;
+  std::vector<int64_t> times;
+  std::vector<std::pair<size_t, size_t>> messages;  // смещение и длина
+  int64_t last_ms = 0;
+};
+
+// Журнал за несколько часов работы: 500 тыс. строк, в основном INFO,
+// ошибок около 1%, время почти монотонно
+const Journal& TestJournal() {
+  static const Journal journal = [] {
+    Journal result;
+    std::mt19937 random(5);
+    int64_t now = 1700000000000;
+    for (size_t i = 0; i < kLines; i++) {
+      now += random() % 40;
+      uint32_t roll = random() % 100;
+      int level = roll == 0 ? 3 : roll < 5 ? 2 : roll < 30 ? 0 : 1;
+      std::string message;
+      int words = 2 + random() % 4;
+      for (int w = 0; w < words; w++) {
+        if (w > 0) message += ' ';
+        message += kWords[random() % (sizeof(kWords) / sizeof(kWords[0]))];
+      }
+      message += " " + std::to_string(random() % 100000);
+      result.offsets.push_back((uint32_t)result.data.size());
+      result.data += std::to_string(now) + " [" + kLevelNames[level] + "] ";
+      result.messages.emplace_back(result.data.size(), message.size());
+      result.data += message + "\n";
+      result.levels.push_back(level);
+      result.times.push_back(now);
+    }
+    result.last_ms = now;
+    return result;
+  }();
+  return journal;
+}
+
+void Build(const Journal& journal, LogIndex* index) {
+  index->Clear();
+  for (size_t i = 0; i < kLines; i++) {
+    index->Add(journal.offsets[i], journal.levels[i], journal.times[i],
+               journal.data.data() + journal.messages[i].first, journal.messages[i].second);
+  }
+}
+
+// Построение индекса по мере записи строк
+void BM_IndexAdd(benchmark::State& state) {
+  const Journal& journal = TestJournal();
+  LogIndex index;
+  for (auto _ : state) {
+    Build(journal, &index);
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * kLines));
+  state.counters["index_bytes"] = (double)index.MemoryUsage();
+  state.counters["file_bytes"] = (double)journal.data.size();
+}
+BENCHMARK(BM_IndexAdd)->Unit(benchmark::kMillisecond);
+
+// Аргумент - вид запроса: 0 - редкая подстрока, 1 - частая подстрока,
+// 2 - только ошибки, 3 - последние 5 минут, 4 - ошибки с подстрокой
+LogIndex::Query MakeQuery(int64_t kind, const Journal& journal) {
+  LogIndex::Query query;
+  switch (kind) {
+    case 0:
+      query.text = "ЁЛКА 4242";
+      break;
+    case 1:
+      query.text = "dns";
+      break;
+    case 2:
+      query.levels = 1u << 3;
+      break;
+    case 3:
+      query.from_ms = journal.last_ms - 5 * 60 * 1000;
+      break;
+    default:
+      query.levels = 1u << 3;
+      query.text = "Сервер";
+      break;
+  }
+  return query;
+}
+
+// Поиск по индексу до конца журнала страницами по kPage строк
+void BM_Search(benchmark::State& state) {
+  const Journal& journal = TestJournal();
+  static LogIndex* index = [&] {
+    LogIndex* built = new LogIndex();
+    Build(journal, built);
+    return built;
+  }();
+  LogIndex::Query query = MakeQuery(state.range(0), journal);
+  std::vector<uint32_t> found;
+  size_t matches = 0;
+  for (auto _ : state) {
+    matches = 0;
+    for (size_t next = 0; next < kLines;) {
+      found.clear();
+      next = index->Search(query, journal.data.data(), journal.data.size(), next, kPage, &found);
+      matches += found.size();
+    }
+  }
+  state.counters["matches"] = (double)matches;
+  state.SetItemsProcessed((int64_t)(state.iterations() * kLines));
+}
+BENCHMARK(BM_Search)->DenseRange(0, 4)->Unit(benchmark::kMillisecond);
+
+// Для сравнения - перебор строк: разбор уровня и времени, нижний регистр
+// и поиск подстроки в каждой строке, как без индекса
+void BM_Scan(benchmark::State& state) {
+  const Journal& journal = TestJournal();
+  LogIndex::Query query = MakeQuery(state.range(0), journal);
+  std::string needle = query.text;
+  LogIndex::FoldCase(&needle[0], needle.size());
+  std::string message;
+  size_t matches = 0;
+  for (auto _ : state) {
+    matches = 0;
+    for (size_t i = 0; i < kLines; i++) {
+      const char* line = journal.data.data() + journal.offsets[i];
+      int64_t time = strtoll(line, nullptr, 10);
+      const char* open = strchr(line, '[');
+      int level = 0;
+      while (level < 3 &&
+             strncmp(open + 1, kLevelNames[level], strlen(kLevelNames[level])) != 0) {
+        level++;
+      }
+      if ((query.levels & (1u << level)) == 0 || time < query.from_ms || time > query.to_ms) {
+        continue;
+      }
+      message.assign(journal.data, journal.messages[i].first, journal.messages[i].second);
+      LogIndex::FoldCase(&message[0], message.size());
+      if (message.find(needle) != std::string::npos) {
+        matches++;
+      }
+    }
+  }
+  state.counters["matches"] = (double)matches;
+  state.SetItemsProcessed((int64_t)(state.iterations() * kLines));
+}
+BENCHMARK(BM_Scan)->DenseRange(0, 4)->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,245 @@
+#include "log_index.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_test_util.h"
+#include "log_helper.h"
+#include "native_log.h"
+
+namespace {
+
+const char* const kLevelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+
+// Слова сообщений: латиница и кириллица в разном регистре, Ё и ё
+const char* const kWords[] = {"Соединение", "ЗАКРЫТО", "dns",    "Proxy",  "ёлка",
+                              "Ёж",         "timeout", "TUN",    "сервер", "Reality",
+                              "маршрут",    "ошибка",  "UDP",    "www.Example.com"};
+
+struct Line {
+  int level;
+  int64_t time_ms;
+  std::string message;
+};
+
+// Журнал из |count| строк: время почти монотонно (перемешано в пределах
+// 50 мс, как у записей разных потоков), с редкими паузами в минуты
+struct Journal {
+  std::vector<Line> lines;
+  std::string data;
+  LogIndex index;
+
+  explicit Journal(size_t count, uint32_t seed = 1) {
+    std::mt19937 random(seed);
+    int64_t now = 1700000000000;
+    for (size_t i = 0; i < count; i++) {
+      now += random() % 5;
+      if (random() % 5000 == 0) now += 60000 * (1 + random() % 10);
+      Line line;
+      line.level = random() % 10 < 6 ? 1 : (int)(random() % 4);
+      line.time_ms = now + (int64_t)(random() % 100) - 50;
+      int words = 1 + random() % 5;
+      for (int w = 0; w < words; w++) {
+        if (w > 0) line.message += ' ';
+        line.message += kWords[random() % (sizeof(kWords) / sizeof(kWords[0]))];
+      }
+      line.message += " " + std::to_string(random() % 1000);
+      Append(line);
+    }
+  }
+
+  void Append(const Line& line) {
+    uint32_t offset = (uint32_t)data.size();
+    data += std::to_string(line.time_ms) + " [" + kLevelNames[line.level] + "] " +
+            line.message + "\n";
+    index.Add(offset, line.level, line.time_ms, line.message.data(), line.message.size());
+    lines.push_back(line);
+  }
+
+  // Поиск полным перебором
+  std::vector<uint32_t> Scan(const LogIndex::Query& query, size_t first) const {
+    std::string needle = query.text;
+    LogIndex::FoldCase(&needle[0], needle.size());
+    std::vector<uint32_t> found;
+    for (size_t i = first; i < lines.size(); i++) {
+      const Line& line = lines[i];
+      if ((query.levels & (1u << line.level)) == 0 || line.time_ms < query.from_ms ||
+          line.time_ms > query.to_ms) {
+        continue;
+      }
+      std::string message = line.message;
+      LogIndex::FoldCase(&message[0], message.size());
+      if (message.find(needle) != std::string::npos) found.push_back((uint32_t)i);
+    }
+    return found;
+  }
+
+  // Поиск по индексу страницами по |page| строк до конца журнала
+  std::vector<uint32_t> Search(const LogIndex::Query& query, size_t first, size_t page) {
+    std::vector<uint32_t> found;
+    size_t next = first;
+    while (next < index.size()) {
+      size_t before = found.size();
+      size_t resume = index.Search(query, data.data(), data.size(), next, page, &found);
+      EXPECT_LE(found.size() - before, page);
+      EXPECT_GT(resume, next);
+      if (resume <= next) break;
+      next = resume;
+    }
+    return found;
+  }
+};
+
+TEST(LogIndexTest, FoldCase) {
+  std::string text = "ABC xyz АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ абв ёЁ 😀 [Z]";
+  LogIndex::FoldCase(&text[0], text.size());
+  EXPECT_EQ(text, "abc xyz абвгдеёжзийклмнопрстуфхцчшщъыьэюя абв ёё 😀 [z]");
+  // Обрезанный на середине символа текст не выходит за границу
+  std::string cut = "ok \xD0";
+  LogIndex::FoldCase(&cut[0], cut.size());
+  EXPECT_EQ(cut, "ok \xD0");
+}
+
+// Уровни, время и подстроки (индекс триграмм и строки короче трех байт)
+// дают то же, что перебор, с любого места и при любом размере страницы
+TEST(LogIndexTest, MatchesFullScan) {
+  Journal journal(100000);
+  const int64_t start = journal.lines.front().time_ms;
+  const int64_t end = journal.lines.back().time_ms;
+  std::vector<LogIndex::Query> queries;
+  for (uint32_t levels : {0xFu, 0x1u, 0x8u, 0xCu, 0x5u}) {
+    LogIndex::Query query;
+    query.levels = levels;
+    queries.push_back(query);
+  }
+  for (const char* text : {"соед", "ЗАКР", "dns", "example.COM", "ёл", "ЁЖ", "ЕЛК", "e", "12",
+                           "ection", "Нет такого", "server", "ошибка 99"}) {
+    LogIndex::Query query;
+    query.text = text;
+    queries.push_back(query);
+  }
+  for (int64_t from : {start - 1000, start + (end - start) / 3, end - 500}) {
+    for (int64_t width : {(int64_t)0, (int64_t)200, (int64_t)60000, end - start}) {
+      LogIndex::Query query;
+      query.from_ms = from;
+      query.to_ms = from + width;
+      query.levels = width == 200 ? 0x8 : 0xF;
+      query.text = width == 60000 ? "ёлка" : "";
+      queries.push_back(query);
+    }
+  }
+  // Только одна граница и граница вне журнала
+  LogIndex::Query only_from;
+  only_from.from_ms = end - 10000;
+  LogIndex::Query only_to;
+  only_to.to_ms = start + 10000;
+  LogIndex::Query before;
+  before.to_ms = start - 100;
+  queries.insert(queries.end(), {only_from, only_to, before});
+
+  for (size_t q = 0; q < queries.size(); q++) {
+    const LogIndex::Query& query = queries[q];
+    for (size_t first : {(size_t)0, (size_t)1, (size_t)4000, (size_t)77777}) {
+      std::vector<uint32_t> expected = journal.Scan(query, first);
+      for (size_t page : {(size_t)1000000, (size_t)100, (size_t)1}) {
+        if (page == 1 && expected.size() > 5000) continue;
+        ASSERT_EQ(journal.Search(query, first, page), expected)
+            << "query " << q << " '" << query.text << "' first " << first << " page " << page;
+      }
+    }
+  }
+}
+
+// Одна строка проверяется по тексту не больше kSearchBudget раз за вызов:
+// поиск останавливается раньше и продолжается с возвращенного номера
+TEST(LogIndexTest, StopsAtSearchBudget) {
+  Journal journal(LogIndex::kSearchBudget + 5000);
+  LogIndex::Query query;
+  // Короче триграммы и нет ни в одной строке: проверяется каждая
+  query.text = "q";
+  std::vector<uint32_t> found;
+  size_t next = journal.index.Search(query, journal.data.data(), journal.data.size(), 0,
+                                     1000000, &found);
+  EXPECT_EQ(next, LogIndex::kSearchBudget);
+  EXPECT_TRUE(found.empty());
+  next = journal.index.Search(query, journal.data.data(), journal.data.size(), next, 1000000,
+                              &found);
+  EXPECT_EQ(next, journal.index.size());
+}
+
+TEST(LogIndexTest, EmptyQueriesAndClear) {
+  Journal journal(1000);
+  std::vector<uint32_t> found;
+  LogIndex::Query query;
+  query.levels = 0;
+  EXPECT_EQ(journal.index.Search(query, journal.data.data(), journal.data.size(), 0, 10, &found),
+            1000u);
+  query.levels = 0xF;
+  query.from_ms = 10;
+  query.to_ms = 9;
+  EXPECT_EQ(journal.index.Search(query, journal.data.data(), journal.data.size(), 0, 10, &found),
+            1000u);
+  EXPECT_TRUE(found.empty());
+
+  journal.index.Clear();
+  journal.lines.clear();
+  journal.data.clear();
+  EXPECT_EQ(journal.index.size(), 0u);
+  Line line{3, 1, "после очистки"};
+  journal.Append(line);
+  LogIndex::Query all;
+  all.text = "ОЧИСТ";
+  EXPECT_EQ(journal.Search(all, 0, 10), std::vector<uint32_t>({0}));
+  all.text = "ёлка";
+  EXPECT_TRUE(journal.Search(all, 0, 10).empty());
+}
+
+bool WaitForLines(uint64_t count) {
+  for (int i = 0; i < 500; i++) {
+    if ((uint64_t)NativeLogLineCount() >= count) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+// Экспорт для Dart: границы времени задаются флагами, значения без флага
+// не учитываются
+TEST(LogHelperTest, SearchTimeBoundsAreExplicit) {
+  file_test::TempDirectory directory;
+  ASSERT_EQ(NativeLogOpen(directory.path().c_str()), 1);
+  const char* message = "search me";
+  for (int i = 0; i < 10; i++) NativeLogWrite(i % 4, message, (int32_t)strlen(message));
+  ASSERT_TRUE(WaitForLines(10));
+  int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+  const int64_t hour = 3600 * 1000;
+  int64_t lines[16];
+  int64_t next = 0;
+  auto search = [&](int32_t bounds, int64_t from, int64_t to) {
+    return NativeLogSearch(0xF, bounds, from, to, "SEARCH", 0, lines, 16, &next);
+  };
+  // Без флагов значения не важны, в том числе fromMs > toMs
+  EXPECT_EQ(search(0, 5, 1), 10);
+  EXPECT_EQ(next, 10);
+  EXPECT_EQ(search(0, 0, 0), 10);
+  EXPECT_EQ(search(LOG_SEARCH_FROM, now - hour, 0), 10);
+  EXPECT_EQ(search(LOG_SEARCH_FROM, now + hour, 0), 0);
+  EXPECT_EQ(search(LOG_SEARCH_TO, 0, now + hour), 10);
+  EXPECT_EQ(search(LOG_SEARCH_TO, now + hour, now - hour), 0);
+  EXPECT_EQ(search(LOG_SEARCH_FROM | LOG_SEARCH_TO, now - hour, now + hour), 10);
+  EXPECT_EQ(search(LOG_SEARCH_FROM | LOG_SEARCH_TO, now + hour, now - hour), 0);
+  EXPECT_EQ(NativeLogSearch(0x8, 0, 0, 0, NULL, 0, lines, 16, &next), 2);
+  EXPECT_EQ(lines[0], 3);
+  EXPECT_EQ(lines[1], 7);
+  NativeLogClose();
+}
+
+}  // namespace
@@ -0,0 +1,127 @@
+#include "native_log.h"
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "file_test_util.h"
+
+namespace {
+
+// Запись идет раундами: за раунд все потоки вместе пишут половину кольца,
+// затем ждут поток журнала. Так замер - цена записи, а не отбрасывания при
+// полном кольце. Ожидание может занять до kFlushIntervalMs, поэтому число
+// раундов задано явно.
+constexpr int kRoundRecords = (int)NativeLog::kRingCapacity / 2;
+constexpr int kRounds = 64;
+
+file_test::TempDirectory* g_directory = nullptr;
+std::atomic<uint64_t> g_written{0};
+uint64_t g_base_lines = 0;
+uint64_t g_base_dropped = 0;
+
+void OpenLog(const benchmark::State& state) {
+  if (state.thread_index() != 0) {
+    return;
+  }
+  g_directory = new file_test::TempDirectory();
+  NativeLog::Instance().Open(g_directory->path());
+  g_written = 0;
+  g_base_lines = NativeLog::Instance().line_count();
+  g_base_dropped = NativeLog::Instance().dropped();
+}
+
+void CloseLog(const benchmark::State& state) {
+  if (state.thread_index() != 0) {
+    return;
+  }
+  NativeLog::Instance().Close();
+  delete g_directory;
+  g_directory = nullptr;
+}
+
+// Ждать, пока поток журнала допишет все записанное
+void WaitForDrain() {
+  NativeLog& log = NativeLog::Instance();
+  while (log.line_count() - g_base_lines + (log.dropped() - g_base_dropped) <
+         g_written.load(std::memory_order_relaxed)) {
+    std::this_thread::yield();
+  }
+}
+
+// LOG_INFO с 4 аргументами: число, строка, число без знака, double.
+// Время CPU - на поток; задержка форматирования уходит в поток журнала.
+void BM_LogInfo(benchmark::State& state) {
+  const int round = kRoundRecords / state.threads();
+  int n = 0;
+  const char* host = "www.example-video.com";
+  for (auto _ : state) {
+    LOG_INFO("Соединение %d с %s:%u закрыто за %.3f мс", n, host, 443u, 12.5);
+    if (++n % round == 0) {
+      state.PauseTiming();
+      g_written.fetch_add(round, std::memory_order_relaxed);
+      WaitForDrain();
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    state.counters["dropped"] = (double)(NativeLog::Instance().dropped() - g_base_dropped);
+  }
+}
+BENCHMARK(BM_LogInfo)
+    ->Threads(1)
+    ->Iterations(kRounds * kRoundRecords)
+    ->Setup(OpenLog)
+    ->Teardown(CloseLog);
+BENCHMARK(BM_LogInfo)
+    ->Threads(8)
+    ->Iterations(kRounds * kRoundRecords / 8)
+    ->Setup(OpenLog)
+    ->Teardown(CloseLog);
+
+// Прежний путь: строка собирается на месте и пишется в файл под мьютексом
+std::mutex g_file_mutex;
+FILE* g_file = nullptr;
+
+void OpenFile(const benchmark::State& state) {
+  if (state.thread_index() != 0) {
+    return;
+  }
+  g_directory = new file_test::TempDirectory();
+  g_file = fopen(g_directory->file("printf.log").c_str(), "wb");
+}
+
+void CloseFile(const benchmark::State& state) {
+  if (state.thread_index() != 0) {
+    return;
+  }
+  fclose(g_file);
+  delete g_directory;
+  g_directory = nullptr;
+}
+
+void BM_SnprintfFwrite(benchmark::State& state) {
+  int n = 0;
+  const char* host = "www.example-video.com";
+  char line[512];
+  for (auto _ : state) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    long long millis =
+        (long long)std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    int length = snprintf(line, sizeof(line),
+                          "%lld [INFO] Соединение %d с %s:%u закрыто за %.3f мс\n", millis, n++,
+                          host, 443u, 12.5);
+    std::lock_guard<std::mutex> lock(g_file_mutex);
+    fwrite(line, 1, (size_t)length, g_file);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SnprintfFwrite)->Threads(1)->Threads(8)->Setup(OpenFile)->Teardown(CloseFile);
+
+}  // namespace
@@ -0,0 +1,314 @@
+#include "native_log.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_test_util.h"
+#include "log_file.h"
+#include "log_ring.h"
+
+namespace {
+
+using file_test::ReadFile;
+using file_test::TempDirectory;
+using file_test::WriteFile;
+
+std::vector<std::string> SplitLines(const std::string& text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  for (size_t end; (end = text.find('\n', start)) != std::string::npos; start = end + 1) {
+    lines.push_back(text.substr(start, end - start));
+  }
+  EXPECT_EQ(start, text.size()) << "last line without '\\n'";
+  return lines;
+}
+
+// Сообщение строки "2024-01-31 12:00:00.123 [INFO] сообщение"
+std::string Message(const std::string& line) {
+  size_t close = line.find("] ");
+  return close == std::string::npos ? "" : line.substr(close + 2);
+}
+
+std::string Level(const std::string& line) {
+  size_t open = line.find(" [");
+  size_t close = line.find("] ");
+  return open == std::string::npos || close == std::string::npos
+             ? ""
+             : line.substr(open + 2, close - open - 2);
+}
+
+bool IsValidUtf8(const std::string& text) {
+  for (size_t i = 0; i < text.size();) {
+    uint8_t byte = (uint8_t)text[i];
+    size_t length = byte < 0x80           ? 1
+                    : (byte >> 5) == 6    ? 2
+                    : (byte >> 4) == 14   ? 3
+                    : (byte >> 3) == 30   ? 4
+                                          : 0;
+    if (length == 0 || i + length > text.size()) return false;
+    for (size_t k = 1; k < length; k++) {
+      if (((uint8_t)text[i + k] & 0xC0) != 0x80) return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+// Журнал - синглтон процесса: каждый тест открывает его в своем каталоге и
+// закрывает; Close() дописывает все из кольца и обрезает файл
+class NativeLogTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(NativeLog::Instance().Open(directory_.path())); }
+  void TearDown() override { NativeLog::Instance().Close(); }
+
+  std::vector<std::string> CloseAndReadLines() {
+    NativeLog::Instance().Close();
+    return SplitLines(ReadFile(directory_.file("app.log")));
+  }
+
+  // Дождаться, пока поток журнала допишет |count| строк
+  bool WaitForLines(uint64_t count) {
+    for (int i = 0; i < 500; i++) {
+      if (NativeLog::Instance().line_count() >= count) return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+  }
+
+  TempDirectory directory_;
+};
+
+TEST(LogRingTest, DropsWhenFullAndKeepsOrder) {
+  LogRing ring(8);
+  EXPECT_EQ(ring.capacity(), 8u);
+  EXPECT_EQ(ring.Peek(), nullptr);
+  for (uint16_t i = 0; i < 8; i++) {
+    uint64_t position;
+    LogRecord* record = ring.Claim(&position);
+    ASSERT_NE(record, nullptr);
+    record->format = i;
+    ring.Publish(position);
+  }
+  uint64_t position;
+  EXPECT_EQ(ring.Claim(&position), nullptr);
+  for (uint16_t i = 0; i < 8; i++) {
+    const LogRecord* record = ring.Peek();
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->format, i);
+    ring.Pop();
+  }
+  EXPECT_EQ(ring.Peek(), nullptr);
+
+  // Занятая, но не опубликованная ячейка останавливает читателя
+  LogRecord* first = ring.Claim(&position);
+  ASSERT_NE(first, nullptr);
+  uint64_t second_position;
+  ASSERT_NE(ring.Claim(&second_position), nullptr);
+  ring.Publish(second_position);
+  EXPECT_EQ(ring.Peek(), nullptr);
+  ring.Publish(position);
+  ASSERT_NE(ring.Peek(), nullptr);
+  ring.Pop();
+  ASSERT_NE(ring.Peek(), nullptr);
+}
+
+TEST(LogFileTest, GrowsThenRotates) {
+  TempDirectory directory;
+  std::string path = directory.file("app.log");
+  LogFile file;
+  ASSERT_TRUE(file.Open(path, 4096, 16384));
+  std::string line(1000, 'a');
+  line.back() = '\n';
+  for (int i = 0; i < 16; i++) {
+    ASSERT_TRUE(file.Append(line.data(), line.size())) << i;
+  }
+  EXPECT_EQ(file.capacity(), 16384u);
+  EXPECT_FALSE(file.Append(line.data(), line.size()));
+  EXPECT_EQ(file.size(), 16000u);
+
+  // Ротация: файл обрезан до занятой длины и стал app.log.1
+  ASSERT_TRUE(file.Rotate());
+  EXPECT_EQ(file.size(), 0u);
+  EXPECT_EQ(file.capacity(), 4096u);
+  EXPECT_EQ(std::filesystem::file_size(path + ".1"), 16000u);
+  ASSERT_TRUE(file.Append("second\n", 7));
+  ASSERT_TRUE(file.Rotate());
+  ASSERT_TRUE(file.Append("third\n", 6));
+  ASSERT_TRUE(file.Rotate());
+  // Хранятся kKeepRotated прежних файлов
+  EXPECT_EQ(ReadFile(path + ".1"), "third\n");
+  EXPECT_EQ(ReadFile(path + ".2"), "second\n");
+  EXPECT_FALSE(std::filesystem::exists(path + ".3"));
+  file.Close();
+  EXPECT_EQ(std::filesystem::file_size(path), 0u);
+}
+
+// Файл после сбоя остается размером с отображение: нулевой хвост
+// отрезается, и файл прошлого запуска становится app.log.1
+TEST(LogFileTest, TrimsZeroTailOnOpen) {
+  TempDirectory directory;
+  std::string path = directory.file("app.log");
+  for (size_t lines : {0, 1, 37}) {
+    std::string data;
+    for (size_t i = 0; i < lines; i++) data += "line " + std::to_string(i) + "\n";
+    WriteFile(path, data + std::string(8192 - data.size(), '\0'));
+    LogFile file;
+    ASSERT_TRUE(file.Open(path, 4096));
+    EXPECT_EQ(ReadFile(path + ".1"), data) << lines;
+    file.Close();
+  }
+}
+
+TEST_F(NativeLogTest, FormatsPrintfConversions) {
+  std::string owned = "std::string";
+  const char* null_text = nullptr;
+  LOG_INFO("d=%d i=%i u=%u x=%x X=%X o=%o c=%c", -42, 7, 42u, 255, 255, 8, 'Z');
+  LOG_WARNING("ll=%lld zu=%zu lu=%lu hd=%hd", -(1LL << 40), (size_t)123, 456ul,
+              (short)-5);
+  LOG_ERROR("f=%.2f e=%.1e g=%g", 3.14159, 12345.0, 0.5);
+  LOG_DEBUG("w=[%5d] l=[%-5d] z=[%05d] s=[%6s] ls=[%-6s] p=[%.3s] *=[%*d] .*=[%.*s]", 42, 42, 42,
+            "ab", "ab", "abcdef", 4, 7, 2, "xyz");
+  LOG_INFO("%s and %s and %s %%", owned, null_text, "literal");
+  LOG_INFO("mismatch %s %d", 17, "text");
+  LOG_INFO("missing %d %s", 1);
+  LOG_INFO("line\nbreak\rhere");
+  NativeLog::Instance().WriteText(LogLevel::kWarning, "from Dart", 9);
+  std::vector<std::string> lines = CloseAndReadLines();
+  ASSERT_EQ(lines.size(), 9u);
+
+  EXPECT_EQ(Message(lines[0]), "d=-42 i=7 u=42 x=ff X=FF o=10 c=Z");
+  EXPECT_EQ(Message(lines[1]), "ll=-1099511627776 zu=123 lu=456 hd=-5");
+  EXPECT_EQ(Message(lines[2]), "f=3.14 e=1.2e+04 g=0.5");
+  EXPECT_EQ(Message(lines[3]), "w=[   42] l=[42   ] z=[00042] s=[    ab] ls=[ab    ] p=[abc] "
+                               "*=[   7] .*=[xy]");
+  EXPECT_EQ(Message(lines[4]), "std::string and (null) and literal %");
+  // Тип берется из записи: несовпадение формата не ломает строку
+  EXPECT_EQ(Message(lines[5]), "mismatch 17 text");
+  EXPECT_EQ(Message(lines[6]), "missing 1 ");
+  EXPECT_EQ(Message(lines[7]), "line break here");
+  EXPECT_EQ(Message(lines[8]), "from Dart");
+
+  EXPECT_EQ(Level(lines[0]), "INFO");
+  EXPECT_EQ(Level(lines[1]), "WARNING");
+  EXPECT_EQ(Level(lines[2]), "ERROR");
+  EXPECT_EQ(Level(lines[3]), "DEBUG");
+  EXPECT_EQ(Level(lines[8]), "WARNING");
+  // "2024-01-31 12:00:00.123 [INFO] "
+  ASSERT_GE(lines[0].size(), 24u);
+  EXPECT_EQ(lines[0][4], '-');
+  EXPECT_EQ(lines[0][10], ' ');
+  EXPECT_EQ(lines[0][19], '.');
+  EXPECT_EQ(lines[0][23], ' ');
+}
+
+// Длинные строки обрезаются по границе символа UTF-8 и помечаются "…"
+TEST_F(NativeLogTest, TruncatesWithoutSplittingUtf8) {
+  std::string cyrillic;
+  while (cyrillic.size() < 3000) cyrillic += "Журнал";
+  LOG_INFO("arg %s", cyrillic);
+  std::string long_text;
+  while (long_text.size() < 10000) long_text += "ё€😀";
+  NativeLog::Instance().WriteText(LogLevel::kInfo, long_text.data(), long_text.size());
+  LOG_INFO("%d %s", 1, std::string(2000, 'a') + "ж");
+  std::vector<std::string> lines = CloseAndReadLines();
+  ASSERT_EQ(lines.size(), 3u);
+  const std::string ellipsis = "\xE2\x80\xA6";
+  for (const std::string& line : lines) {
+    EXPECT_TRUE(IsValidUtf8(line));
+    EXPECT_LT(line.size(), NativeLog::kMaxLineLength);
+    EXPECT_EQ(line.compare(line.size() - ellipsis.size(), ellipsis.size(), ellipsis), 0);
+  }
+  // Аргумент обрезается по месту в записи (около 1 КБ)
+  EXPECT_LT(lines[0].size(), LogRecord::kArgsCapacity + 64);
+  EXPECT_EQ(Message(lines[0]).compare(0, 4 + 12, "arg Журнал"), 0);
+}
+
+// 8 писателей: строки каждого потока идут в его порядке, и каждая запись
+// либо записана, либо учтена в dropped()
+TEST_F(NativeLogTest, ConcurrentWritersKeepPerThreadOrder) {
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 20000;
+  uint64_t dropped_before = NativeLog::Instance().dropped();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kPerThread; i++) {
+        LOG_INFO("writer %d record %d", t, i);
+        if (i % 512 == 511) std::this_thread::yield();
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  std::vector<std::string> lines = CloseAndReadLines();
+  uint64_t dropped = NativeLog::Instance().dropped() - dropped_before;
+  EXPECT_EQ(lines.size() + dropped, (size_t)kThreads * kPerThread);
+  EXPECT_GT(lines.size(), 0u);
+
+  std::vector<int> last(kThreads, -1);
+  for (const std::string& line : lines) {
+    int thread = -1;
+    int record = -1;
+    ASSERT_EQ(sscanf(Message(line).c_str(), "writer %d record %d", &thread, &record), 2) << line;
+    ASSERT_TRUE(thread >= 0 && thread < kThreads);
+    ASSERT_GT(record, last[thread]) << line;
+    last[thread] = record;
+  }
+}
+
+TEST_F(NativeLogTest, ReadsPagesWhileOpen) {
+  NativeLog& log = NativeLog::Instance();
+  uint64_t base = log.line_count();
+  for (int i = 0; i < 1000; i++) {
+    LOG_INFO("page line %d", i);
+    if (i % 256 == 255) {
+      ASSERT_TRUE(WaitForLines(base + i + 1));
+    }
+  }
+  ASSERT_TRUE(WaitForLines(base + 1000));
+  std::vector<char> buffer(NativeLog::kMaxLineLength * 4);
+  std::vector<uint32_t> offsets(101);
+  uint64_t actual = 0;
+  size_t read = log.ReadLines(base + 500, 100, buffer.data(), buffer.size(), offsets.data(),
+                              &actual);
+  EXPECT_EQ(actual, base + 500);
+  ASSERT_GT(read, 10u);
+  for (size_t i = 0; i < read; i++) {
+    std::string line(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    ASSERT_EQ(line.back(), '\n');
+    line.pop_back();
+    EXPECT_EQ(Message(line), "page line " + std::to_string(500 + i));
+  }
+
+  // Clear(): новый файл, прежние строки не читаются
+  ASSERT_TRUE(log.Clear());
+  EXPECT_EQ(log.first_line(), base + 1000);
+  EXPECT_EQ(log.ReadLines(base, 10, buffer.data(), buffer.size(), offsets.data(), &actual), 0u);
+  EXPECT_EQ(actual, base + 1000);
+  LOG_INFO("after clear");
+  ASSERT_TRUE(WaitForLines(base + 1001));
+  ASSERT_EQ(log.ReadLines(base, 10, buffer.data(), buffer.size(), offsets.data(), &actual), 1u);
+  EXPECT_EQ(Message(std::string(buffer.data(), offsets[1] - 1)), "after clear");
+  EXPECT_EQ(SplitLines(ReadFile(directory_.file("app.log.1"))).size(), 1000u);
+}
+
+// Повторное открытие: файл прошлой сессии становится app.log.1
+TEST_F(NativeLogTest, ReopenRotatesPreviousSession) {
+  LOG_INFO("first session");
+  NativeLog::Instance().Close();
+  ASSERT_TRUE(NativeLog::Instance().Open(directory_.path()));
+  EXPECT_EQ(NativeLog::Instance().line_count(), 0u);
+  LOG_INFO("second session");
+  std::vector<std::string> lines = CloseAndReadLines();
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(Message(lines[0]), "second session");
+  std::vector<std::string> previous = SplitLines(ReadFile(directory_.file("app.log.1")));
+  ASSERT_EQ(previous.size(), 1u);
+  EXPECT_EQ(Message(previous[0]), "first session");
+}
+
+}  // namespace
@@ -0,0 +1,68 @@
+#include "packet_headers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "packet_test_util.h"
+
+namespace {
+
+std::vector<uint8_t> RandomBytes(size_t length) {
+  std::mt19937 random(7);
+  std::vector<uint8_t> data(length);
+  for (uint8_t& byte : data) byte = (uint8_t)random();
+  return data;
+}
+
+// Пропускная способность суммы на типичных размерах кадров (64/512/1500);
+// bytes_per_second * 8 дает Гбит/с
+template <uint16_t (*Block)(const uint8_t*, size_t)>
+void BM_Checksum(benchmark::State& state) {
+  std::vector<uint8_t> data = RandomBytes((size_t)state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Block(data.data(), data.size()));
+  }
+  state.SetBytesProcessed((int64_t)(state.iterations() * data.size()));
+}
+BENCHMARK_TEMPLATE(BM_Checksum, ChecksumBlockScalar)->Arg(64)->Arg(512)->Arg(1500);
+#if defined(PACKET_HEADERS_X86)
+BENCHMARK_TEMPLATE(BM_Checksum, ChecksumBlockSse2)->Arg(64)->Arg(512)->Arg(1500);
+BENCHMARK_TEMPLATE(BM_Checksum, ChecksumBlockAvx2)->Arg(64)->Arg(512)->Arg(1500);
+#endif
+BENCHMARK_TEMPLATE(BM_Checksum, ChecksumBlock)->Arg(64)->Arg(512)->Arg(1500);
+
+// Разбор заголовков и полный пересчет сумм после перезаписи
+void BM_ParseAndRewrite(benchmark::State& state) {
+  std::vector<uint8_t> packet = packet_test::Ipv4Packet(
+      packet_test::kTcp, packet_test::Ipv4(10, 0, 0, 1), 40000,
+      packet_test::Ipv4(1, 1, 1, 1), 443, (size_t)state.range(0) - 40);
+  uint32_t address = packet_test::Ipv4(127, 0, 0, 1);
+  for (auto _ : state) {
+    PacketHeaders headers;
+    ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers);
+    SetIpv4Destination(headers, address);
+    SetDestinationPort(headers, 10808);
+    address ^= 1;
+    benchmark::DoNotOptimize(packet.data());
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_ParseAndRewrite)->Arg(64)->Arg(1500);
+
+void BM_RecomputeChecksums(benchmark::State& state) {
+  std::vector<uint8_t> packet = packet_test::Ipv4Packet(
+      packet_test::kTcp, packet_test::Ipv4(10, 0, 0, 1), 40000,
+      packet_test::Ipv4(1, 1, 1, 1), 443, (size_t)state.range(0) - 40);
+  PacketHeaders headers;
+  ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers);
+  for (auto _ : state) {
+    RecomputeChecksums(headers);
+    benchmark::DoNotOptimize(packet.data());
+  }
+  state.SetBytesProcessed((int64_t)(state.iterations() * packet.size()));
+}
+BENCHMARK(BM_RecomputeChecksums)->Arg(64)->Arg(512)->Arg(1500);
+
+}  // namespace
@@ -0,0 +1,246 @@
+#include "packet_headers.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "packet_test_util.h"
+
+namespace {
+
+using packet_test::Ipv4;
+using packet_test::Ipv4Packet;
+using packet_test::Ipv6Packet;
+
+const uint8_t kSource6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+const uint8_t kDestination6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2};
+
+// Побайтовая сумма по RFC 1071 - эталон для векторных реализаций
+uint16_t ReferenceChecksum(const uint8_t* data, size_t length) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i + 1 < length; i += 2) {
+    sum += (uint32_t)(data[i] << 8) | data[i + 1];
+  }
+  if (length & 1) {
+    sum += (uint32_t)data[length - 1] << 8;
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+  return (uint16_t)~sum;
+}
+
+// Пакет с верными суммами: проверка сводится к нулю после пересчета
+bool ChecksumsValid(std::vector<uint8_t>& packet) {
+  PacketHeaders headers;
+  if (!ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers)) return false;
+  if (headers.IsIpv4() && InternetChecksum(headers.data, (headers.data[0] & 0x0F) * 4) != 0) {
+    return false;
+  }
+  uint32_t sum = 0;
+  if (headers.IsIpv4()) {
+    sum = ChecksumAdd(sum, headers.data + 12, 8);
+  } else {
+    sum = ChecksumAdd(sum, headers.data + 8, 32);
+  }
+  sum += headers.protocol;
+  sum += headers.l4_length;
+  sum = ChecksumAdd(sum, headers.l4(), headers.l4_length);
+  return ChecksumFinish(sum) == 0;
+}
+
+// Вставить заголовок расширения IPv6 перед транспортным
+std::vector<uint8_t> InsertIpv6Extension(const std::vector<uint8_t>& packet, uint8_t type,
+                                         size_t length) {
+  std::vector<uint8_t> out(packet.begin(), packet.begin() + 40);
+  std::vector<uint8_t> extension(length, 0);
+  extension[0] = packet[6];
+  extension[1] = type == kIpProtocolAh ? (uint8_t)(length / 4 - 2) : (uint8_t)(length / 8 - 1);
+  out.insert(out.end(), extension.begin(), extension.end());
+  out.insert(out.end(), packet.begin() + 40, packet.end());
+  out[6] = type;
+  packet_test::PutUint16(&out[4], (uint16_t)(out.size() - 40));
+  return out;
+}
+
+TEST(ParsePacketHeadersTest, Ipv4Tcp) {
+  std::vector<uint8_t> packet =
+      Ipv4Packet(packet_test::kTcp, Ipv4(10, 0, 0, 1), 40000, Ipv4(1, 1, 1, 1), 443, 100,
+                 packet_test::kTcpSyn);
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  EXPECT_TRUE(headers.IsIpv4());
+  EXPECT_TRUE(headers.IsTcp());
+  EXPECT_EQ(headers.ipv4_source(), Ipv4(10, 0, 0, 1));
+  EXPECT_EQ(headers.ipv4_destination(), Ipv4(1, 1, 1, 1));
+  EXPECT_EQ(headers.source_port(), 40000);
+  EXPECT_EQ(headers.destination_port(), 443);
+  EXPECT_EQ(headers.l4_offset, 20u);
+  EXPECT_EQ(headers.payload_offset, 40u);
+  EXPECT_EQ(headers.payload_length(), 100u);
+  EXPECT_EQ(headers.tcp_flags(), kTcpFlagSyn);
+}
+
+TEST(ParsePacketHeadersTest, Ipv6UdpWithExtensions) {
+  std::vector<uint8_t> packet =
+      Ipv6Packet(packet_test::kUdp, kSource6, 5353, kDestination6, 53, 40);
+  packet = InsertIpv6Extension(packet, 60, 16);  // Destination Options
+  packet = InsertIpv6Extension(packet, 0, 8);    // Hop-by-Hop
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  EXPECT_TRUE(headers.IsUdp());
+  EXPECT_EQ(headers.l4_offset, 40u + 8 + 16);
+  EXPECT_EQ(headers.destination_port(), 53);
+  EXPECT_EQ(headers.payload_length(), 40u);
+}
+
+// Длина AH считается в 4-байтовых словах: 24 байта (ICV 12 байт) не
+// кратны 8 и прежде давали неверное смещение TCP
+TEST(ParsePacketHeadersTest, Ipv6AuthenticationHeader) {
+  std::vector<uint8_t> packet =
+      Ipv6Packet(packet_test::kTcp, kSource6, 40000, kDestination6, 443, 10);
+  packet = InsertIpv6Extension(packet, kIpProtocolAh, 20);
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  EXPECT_TRUE(headers.IsTcp());
+  EXPECT_EQ(headers.l4_offset, 60u);
+  EXPECT_EQ(headers.source_port(), 40000);
+  EXPECT_EQ(headers.destination_port(), 443);
+  EXPECT_EQ(headers.payload_length(), 10u);
+}
+
+TEST(ParsePacketHeadersTest, Ipv4AuthenticationHeader) {
+  std::vector<uint8_t> inner =
+      Ipv4Packet(packet_test::kUdp, Ipv4(10, 0, 0, 1), 1000, Ipv4(10, 0, 0, 2), 2000, 5);
+  std::vector<uint8_t> packet(inner.begin(), inner.begin() + 20);
+  std::vector<uint8_t> ah(24, 0);
+  ah[0] = kIpProtocolUdp;
+  ah[1] = 24 / 4 - 2;
+  packet.insert(packet.end(), ah.begin(), ah.end());
+  packet.insert(packet.end(), inner.begin() + 20, inner.end());
+  packet[9] = kIpProtocolAh;
+  packet_test::PutUint16(&packet[2], (uint16_t)packet.size());
+
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  EXPECT_TRUE(headers.IsUdp());
+  EXPECT_EQ(headers.l4_offset, 44u);
+  EXPECT_EQ(headers.destination_port(), 2000);
+
+  // Контрольная сумма IPv4 покрывает только базовый заголовок
+  RecomputeChecksums(headers);
+  EXPECT_EQ(InternetChecksum(packet.data(), 20), 0);
+}
+
+TEST(ParsePacketHeadersTest, TruncatedAuthenticationHeader) {
+  std::vector<uint8_t> packet =
+      Ipv6Packet(packet_test::kTcp, kSource6, 40000, kDestination6, 443, 0);
+  packet = InsertIpv6Extension(packet, kIpProtocolAh, 64);
+  packet.resize(40 + 32);
+  packet_test::PutUint16(&packet[4], 32);
+  PacketHeaders headers;
+  EXPECT_FALSE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+}
+
+TEST(ParsePacketHeadersTest, NonFirstFragmentHasNoTransport) {
+  std::vector<uint8_t> packet =
+      Ipv4Packet(packet_test::kUdp, Ipv4(10, 0, 0, 1), 1000, Ipv4(10, 0, 0, 2), 2000, 100);
+  packet_test::PutUint16(&packet[6], 185);  // смещение 1480 байт
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  EXPECT_FALSE(headers.has_l4);
+  EXPECT_EQ(headers.source_port(), 0);
+}
+
+TEST(ParsePacketHeadersTest, RejectsMalformedPackets) {
+  std::vector<uint8_t> packet =
+      Ipv4Packet(packet_test::kTcp, Ipv4(10, 0, 0, 1), 1000, Ipv4(10, 0, 0, 2), 2000, 0);
+  PacketHeaders headers;
+  EXPECT_FALSE(ParsePacketHeaders(packet.data(), 0, &headers));
+  EXPECT_FALSE(ParsePacketHeaders(packet.data(), 19, &headers));
+  EXPECT_FALSE(ParsePacketHeaders(packet.data(), 39, &headers));  // total > length
+
+  std::vector<uint8_t> bad = packet;
+  bad[0] = 0x44;  // IHL < 20
+  EXPECT_FALSE(ParsePacketHeaders(bad.data(), (uint32_t)bad.size(), &headers));
+  bad = packet;
+  bad[32] = 0x40;  // data offset < 20
+  EXPECT_FALSE(ParsePacketHeaders(bad.data(), (uint32_t)bad.size(), &headers));
+  bad = packet;
+  bad[0] = 0x55;
+  EXPECT_FALSE(ParsePacketHeaders(bad.data(), (uint32_t)bad.size(), &headers));
+}
+
+// Ни один обрезанный префикс корректного пакета не читает за границу
+TEST(ParsePacketHeadersTest, TruncationNeverOverreads) {
+  std::vector<uint8_t> packet =
+      Ipv6Packet(packet_test::kTcp, kSource6, 40000, kDestination6, 443, 30);
+  packet = InsertIpv6Extension(packet, kIpProtocolAh, 24);
+  packet = InsertIpv6Extension(packet, 0, 8);
+  for (size_t length = 0; length <= packet.size(); length++) {
+    std::vector<uint8_t> prefix(packet.begin(), packet.begin() + length);
+    PacketHeaders headers;
+    ParsePacketHeaders(prefix.data(), (uint32_t)prefix.size(), &headers);
+  }
+}
+
+TEST(ChecksumTest, MatchesReferenceForAllLengthsAndAlignments) {
+  std::mt19937 random(1);
+  std::vector<uint8_t> buffer(2048 + 64);
+  for (uint8_t& byte : buffer) byte = (uint8_t)random();
+  for (size_t alignment = 0; alignment < 8; alignment++) {
+    for (size_t length = 0; length <= 1600; length += (length < 300 ? 1 : 37)) {
+      const uint8_t* data = buffer.data() + alignment;
+      uint16_t expected = ReferenceChecksum(data, length);
+      ASSERT_EQ(InternetChecksum(data, length), expected) << length << "/" << alignment;
+#if defined(PACKET_HEADERS_X86)
+      ASSERT_EQ(ChecksumBlockSse2(data, length), ChecksumBlockScalar(data, length));
+      if (CpuHasAvx2()) {
+        ASSERT_EQ(ChecksumBlockAvx2(data, length), ChecksumBlockScalar(data, length));
+      }
+#endif
+    }
+  }
+}
+
+// Инкрементальное обновление дает то же, что полный пересчет
+TEST(ChecksumTest, RewriteKeepsChecksumsValid) {
+  std::vector<uint8_t> packet =
+      Ipv4Packet(packet_test::kTcp, Ipv4(10, 0, 0, 1), 40000, Ipv4(1, 1, 1, 1), 443, 333);
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  RecomputeChecksums(headers);
+  ASSERT_TRUE(ChecksumsValid(packet));
+
+  SetIpv4Destination(headers, Ipv4(127, 0, 0, 1));
+  SetDestinationPort(headers, 10808);
+  SetIpv4Source(headers, Ipv4(192, 168, 1, 77));
+  SetSourcePort(headers, 1);
+  EXPECT_TRUE(ChecksumsValid(packet));
+  EXPECT_EQ(headers.ipv4_destination(), Ipv4(127, 0, 0, 1));
+  EXPECT_EQ(headers.destination_port(), 10808);
+
+  std::vector<uint8_t> packet6 =
+      Ipv6Packet(packet_test::kUdp, kSource6, 5353, kDestination6, 53, 77);
+  ASSERT_TRUE(ParsePacketHeaders(packet6.data(), (uint32_t)packet6.size(), &headers));
+  RecomputeChecksums(headers);
+  uint8_t loopback[16] = {};
+  loopback[15] = 1;
+  SetIpv6Destination(headers, loopback);
+  SetDestinationPort(headers, 1053);
+  EXPECT_TRUE(ChecksumsValid(packet6));
+}
+
+// Нулевая сумма UDP по IPv4 означает "не вычислялась" и не трогается
+TEST(ChecksumTest, KeepsZeroUdpChecksumOnIpv4) {
+  std::vector<uint8_t> packet =
+      Ipv4Packet(packet_test::kUdp, Ipv4(10, 0, 0, 1), 1000, Ipv4(10, 0, 0, 2), 53, 20);
+  PacketHeaders headers;
+  ASSERT_TRUE(ParsePacketHeaders(packet.data(), (uint32_t)packet.size(), &headers));
+  SetDestinationPort(headers, 5353);
+  SetIpv4Destination(headers, Ipv4(127, 0, 0, 1));
+  EXPECT_EQ(LoadBe16(packet.data() + 26), 0);
+}
+
+}  // namespace
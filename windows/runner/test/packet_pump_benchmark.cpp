@@ -0,0 +1,55 @@
+#include "packet_pump.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "packet_headers.h"
+#include "packet_test_util.h"
+#include "pcap_packet_io.h"
+
+namespace {
+
+// Пропускная способность конвейера на pcap-бэкенде: пачки по 64 пакета,
+// обработчик разбирает заголовки, как цикл перехвата. Аргументы - размер
+// кадра и число рабочих потоков.
+void BM_PumpThroughput(benchmark::State& state) {
+  size_t frame = (size_t)state.range(0);
+  size_t workers = (size_t)state.range(1);
+  PcapPacketIo io;
+  for (uint32_t i = 0; i < 8192; i++) {
+    std::vector<uint8_t> packet = packet_test::Ipv4Packet(
+        packet_test::kUdp, packet_test::Ipv4(192, 168, 0, 2), 40000,
+        packet_test::Ipv4(10, 0, (uint8_t)(i >> 8), (uint8_t)i), 443, frame - 28);
+    io.AddPacket(packet.data(), (uint32_t)packet.size());
+  }
+  TrafficCounters counters;
+  PacketPump pump(&io, &counters);
+  constexpr size_t kLoops = 8;
+  uint64_t total = io.packet_count() * kLoops;
+
+  for (auto _ : state) {
+    io.Rewind(kLoops);
+    uint64_t sent = io.sent_packets();
+    pump.Start(workers, [](PacketBatch* batch) {
+      PacketHeaders headers;
+      for (size_t i = 0; i < batch->count; i++) {
+        benchmark::DoNotOptimize(
+            ParsePacketHeaders(batch->Packet(i), batch->length[i], &headers));
+      }
+    });
+    while (io.sent_packets() - sent < total) {
+      std::this_thread::yield();
+    }
+    pump.Stop();
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * total));
+  state.SetBytesProcessed((int64_t)(state.iterations() * total * frame));
+}
+BENCHMARK(BM_PumpThroughput)
+    ->ArgsProduct({{64, 512, 1500}, {1, 4}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
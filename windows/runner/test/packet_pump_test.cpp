@@ -0,0 +1,126 @@
+#include "packet_pump.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "packet_headers.h"
+#include "packet_test_util.h"
+#include "pcap_packet_io.h"
+
+namespace {
+
+using packet_test::Ipv4;
+using packet_test::Ipv4Packet;
+
+constexpr uint32_t kLocal = 0xC0A80002;  // 192.168.0.2
+
+// Конвейер на pcap-бэкенде: пачки разбираются несколькими потоками, каждый
+// третий пакет отбрасывается обработчиком
+class PacketPumpTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    uint32_t local;
+    uint8_t bytes[4] = {192, 168, 0, 2};
+    memcpy(&local, bytes, 4);
+    io_.SetLocalIpv4(local);
+    for (int i = 0; i < 3000; i++) {
+      bool outbound = i % 2 == 0;
+      uint32_t remote = Ipv4(10, 1, (uint8_t)(i >> 8), (uint8_t)i);
+      std::vector<uint8_t> packet =
+          outbound ? Ipv4Packet(packet_test::kUdp, kLocal, 40000, remote, 443, (size_t)(i % 1200))
+                   : Ipv4Packet(packet_test::kUdp, remote, 443, kLocal, 40000, (size_t)(i % 1200));
+      io_.AddPacket(packet.data(), (uint32_t)packet.size());
+      Expect(i, outbound, (uint64_t)packet.size());
+    }
+  }
+
+  void Expect(int index, bool outbound, uint64_t length) {
+    if (index % 3 == 2) {
+      dropped_++;
+      return;
+    }
+    (outbound ? tx_bytes_ : rx_bytes_) += length;
+    (outbound ? tx_packets_ : rx_packets_)++;
+  }
+
+  // Прогнать файл |loops| раз и дождаться, пока все пачки уйдут
+  void Run(PacketPump* pump, size_t workers, size_t loops) {
+    io_.Rewind(loops);
+    uint64_t sent = io_.sent_packets();
+    std::atomic<uint64_t> handled{0};
+    ASSERT_TRUE(pump->Start(workers, [&handled](PacketBatch* batch) {
+      PacketHeaders headers;
+      for (size_t i = 0; i < batch->count; i++) {
+        ASSERT_TRUE(ParsePacketHeaders(batch->Packet(i), batch->length[i], &headers));
+        // Номер пакета зашифрован в адресе удаленной стороны
+        uint32_t remote = batch->outbound[i] ? headers.ipv4_destination() : headers.ipv4_source();
+        if ((remote & 0xFFFF) % 3 == 2) {
+          batch->verdict[i] = PacketVerdict::kDrop;
+        }
+      }
+      handled.fetch_add(batch->count, std::memory_order_relaxed);
+    }));
+    uint64_t total = io_.packet_count() * loops;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (io_.sent_packets() - sent + dropped_ * loops < total &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pump->Stop();
+    EXPECT_EQ(handled.load(), total);
+  }
+
+  PcapPacketIo io_;
+  uint64_t rx_bytes_ = 0;
+  uint64_t tx_bytes_ = 0;
+  uint64_t rx_packets_ = 0;
+  uint64_t tx_packets_ = 0;
+  uint64_t dropped_ = 0;
+};
+
+// Отброшенные обработчиком пакеты не отправляются и не учитываются
+TEST_F(PacketPumpTest, CountsOnlyForwardedPackets) {
+  TrafficCounters counters;
+  PacketPump pump(&io_, &counters);
+  Run(&pump, 4, 2);
+
+  TrafficSnapshot snapshot = counters.Snapshot();
+  EXPECT_EQ(snapshot.uploaded_bytes, 2 * tx_bytes_);
+  EXPECT_EQ(snapshot.downloaded_bytes, 2 * rx_bytes_);
+  EXPECT_EQ(snapshot.uploaded_packets, 2 * tx_packets_);
+  EXPECT_EQ(snapshot.downloaded_packets, 2 * rx_packets_);
+  EXPECT_EQ(io_.sent_bytes(), 2 * (tx_bytes_ + rx_bytes_));
+  EXPECT_EQ(pump.packet_count(), 2 * io_.packet_count());
+}
+
+TEST_F(PacketPumpTest, RestartsAfterStop) {
+  TrafficCounters counters;
+  PacketPump pump(&io_, &counters);
+  Run(&pump, 1, 1);
+  Run(&pump, 2, 1);
+  EXPECT_EQ(counters.Snapshot().uploaded_packets, 2 * tx_packets_);
+}
+
+TEST(CompactForwardedPacketsTest, KeepsOrderOfForwardedPackets) {
+  PacketBatchRing ring(1);
+  PacketBatch* batch = ring.Next();
+  for (uint8_t i = 0; i < 5; i++) {
+    memset(batch->data + batch->data_size, i, 10 + i);
+    batch->Commit(10 + i, true);
+  }
+  batch->verdict[1] = PacketVerdict::kDrop;
+  batch->verdict[3] = PacketVerdict::kDrop;
+
+  ASSERT_EQ(CompactForwardedPackets(batch), 3u);
+  const uint8_t expected[] = {0, 2, 4};
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(batch->length[i], 10u + expected[i]);
+    EXPECT_EQ(batch->Packet(i)[0], expected[i]);
+    EXPECT_EQ(batch->Packet(i)[batch->length[i] - 1], expected[i]);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,90 @@
+#ifndef RUNNER_TEST_PACKET_TEST_UTIL_H_
+#define RUNNER_TEST_PACKET_TEST_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+// Синтетические IP-пакеты для тестов и бенчмарков пакетного тракта.
+// Адреса и порты - в порядке байт хоста; контрольные суммы не считаются.
+namespace packet_test {
+
+constexpr uint8_t kTcp = 6;
+constexpr uint8_t kUdp = 17;
+
+constexpr uint8_t kTcpFin = 0x01;
+constexpr uint8_t kTcpSyn = 0x02;
+constexpr uint8_t kTcpRst = 0x04;
+constexpr uint8_t kTcpAck = 0x10;
+
+inline void PutUint16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)(value >> 8);
+  out[1] = (uint8_t)value;
+}
+
+inline void PutUint32(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+// Заголовок L4 (TCP - 20 байт, UDP - 8) и полезная нагрузка |payload|
+// байт после |offset|
+inline void FillTransport(uint8_t* l4, uint8_t protocol, uint16_t source_port,
+                          uint16_t destination_port, uint8_t tcp_flags, size_t payload) {
+  PutUint16(l4, source_port);
+  PutUint16(l4 + 2, destination_port);
+  if (protocol == kTcp) {
+    PutUint32(l4 + 4, 1000);
+    l4[12] = 5 << 4;
+    l4[13] = tcp_flags;
+    PutUint16(l4 + 14, 65535);
+  } else {
+    PutUint16(l4 + 4, (uint16_t)(8 + payload));
+  }
+}
+
+inline std::vector<uint8_t> Ipv4Packet(uint8_t protocol, uint32_t source, uint16_t source_port,
+                                       uint32_t destination, uint16_t destination_port,
+                                       size_t payload, uint8_t tcp_flags = kTcpAck) {
+  size_t l4_length = protocol == kTcp ? 20 : 8;
+  std::vector<uint8_t> packet(20 + l4_length + payload, 0);
+  packet[0] = 0x45;
+  PutUint16(&packet[2], (uint16_t)packet.size());
+  packet[8] = 64;
+  packet[9] = protocol;
+  PutUint32(&packet[12], source);
+  PutUint32(&packet[16], destination);
+  FillTransport(&packet[20], protocol, source_port, destination_port, tcp_flags, payload);
+  for (size_t i = 0; i < payload; i++) {
+    packet[20 + l4_length + i] = (uint8_t)(i * 31 + 7);
+  }
+  return packet;
+}
+
+inline std::vector<uint8_t> Ipv6Packet(uint8_t protocol, const uint8_t source[16],
+                                       uint16_t source_port, const uint8_t destination[16],
+                                       uint16_t destination_port, size_t payload,
+                                       uint8_t tcp_flags = kTcpAck) {
+  size_t l4_length = protocol == kTcp ? 20 : 8;
+  std::vector<uint8_t> packet(40 + l4_length + payload, 0);
+  packet[0] = 0x60;
+  PutUint16(&packet[4], (uint16_t)(l4_length + payload));
+  packet[6] = protocol;
+  packet[7] = 64;
+  memcpy(&packet[8], source, 16);
+  memcpy(&packet[24], destination, 16);
+  FillTransport(&packet[40], protocol, source_port, destination_port, tcp_flags, payload);
+  return packet;
+}
+
+inline uint32_t Ipv4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d;
+}
+
+}  // namespace packet_test
+
+#endif  // RUNNER_TEST_PACKET_TEST_UTIL_H_
@@ -0,0 +1,102 @@
+#include "prefix_table.h"
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// Набор размером с geoip:cn (около 8500 префиксов IPv4 длиной 10-24 и
+// 1500 IPv6), сгенерированный детерминированно: распределение длин, а не
+// конкретные сети, определяет число уровней дерева
+struct GeoipSet {
+  std::vector<uint32_t> ipv4;
+  std::vector<uint8_t> ipv4_lengths;
+  PrefixTable table;
+  std::vector<uint32_t> probes;
+
+  GeoipSet() {
+    std::mt19937 random(42);
+    for (int i = 0; i < 8500; i++) {
+      uint8_t length = (uint8_t)(10 + random() % 15);
+      uint32_t address = (uint32_t)random() & (0xFFFFFFFFu << (32 - length));
+      ipv4.push_back(address);
+      ipv4_lengths.push_back(length);
+      table.AddIpv4(address, length, 1);
+    }
+    for (int i = 0; i < 1500; i++) {
+      uint8_t address[16] = {0x24, 0x0e};
+      for (int j = 2; j < 6; j++) address[j] = (uint8_t)random();
+      table.AddIpv6(address, (uint8_t)(32 + random() % 17), 1);
+    }
+    table.Build();
+    for (int i = 0; i < 1 << 16; i++) {
+      probes.push_back((uint32_t)random());
+    }
+  }
+};
+
+const GeoipSet& Set() {
+  static const GeoipSet set;
+  return set;
+}
+
+void BM_PrefixTableLookupIpv4(benchmark::State& state) {
+  const GeoipSet& set = Set();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.table.LookupIpv4(set.probes[i++ & 0xFFFF]));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.counters["table_bytes"] = (double)set.table.MemoryUsage();
+}
+BENCHMARK(BM_PrefixTableLookupIpv4);
+
+// Для сравнения: перебор всех префиксов, как делали маски IsPrivateAddress
+void BM_BruteForceLookupIpv4(benchmark::State& state) {
+  const GeoipSet& set = Set();
+  size_t i = 0;
+  for (auto _ : state) {
+    uint32_t address = set.probes[i++ & 0xFFFF];
+    int best = -1;
+    for (size_t p = 0; p < set.ipv4.size(); p++) {
+      uint32_t mask = 0xFFFFFFFFu << (32 - set.ipv4_lengths[p]);
+      if ((address & mask) == set.ipv4[p] && set.ipv4_lengths[p] > best) {
+        best = set.ipv4_lengths[p];
+      }
+    }
+    benchmark::DoNotOptimize(best);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_BruteForceLookupIpv4);
+
+void BM_PrefixTableLookupIpv6(benchmark::State& state) {
+  const GeoipSet& set = Set();
+  size_t i = 0;
+  uint8_t address[16] = {0x24, 0x0e};
+  for (auto _ : state) {
+    uint32_t probe = set.probes[i++ & 0xFFFF];
+    memcpy(address + 2, &probe, 4);
+    benchmark::DoNotOptimize(set.table.LookupIpv6(address));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_PrefixTableLookupIpv6);
+
+void BM_PrefixTableBuild(benchmark::State& state) {
+  const GeoipSet& set = Set();
+  for (auto _ : state) {
+    PrefixTable table;
+    for (size_t p = 0; p < set.ipv4.size(); p++) {
+      table.AddIpv4(set.ipv4[p], set.ipv4_lengths[p], 1);
+    }
+    table.Build();
+    benchmark::DoNotOptimize(table.MemoryUsage());
+  }
+}
+BENCHMARK(BM_PrefixTableBuild)->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,200 @@
+#include "prefix_table.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Entry {
+  uint8_t address[16];
+  uint8_t length;
+  uint32_t value;
+};
+
+bool PrefixMatches(const uint8_t* prefix, uint8_t length, const uint8_t* address) {
+  for (uint8_t bit = 0; bit < length; bit++) {
+    uint8_t mask = (uint8_t)(0x80 >> (bit & 7));
+    if ((prefix[bit >> 3] & mask) != (address[bit >> 3] & mask)) return false;
+  }
+  return true;
+}
+
+// Эталон: перебор всех префиксов, самый длинный (при равной длине -
+// последний добавленный) побеждает
+uint32_t BruteForce(const std::vector<Entry>& entries, const uint8_t* address) {
+  uint32_t value = PrefixTable::kNoMatch;
+  int best = -1;
+  for (const Entry& entry : entries) {
+    if (entry.length >= best && PrefixMatches(entry.address, entry.length, address)) {
+      best = entry.length;
+      value = entry.value;
+    }
+  }
+  return value;
+}
+
+uint32_t Ipv4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d;
+}
+
+void StoreIpv4(uint32_t address, uint8_t* out) {
+  out[0] = (uint8_t)(address >> 24);
+  out[1] = (uint8_t)(address >> 16);
+  out[2] = (uint8_t)(address >> 8);
+  out[3] = (uint8_t)address;
+}
+
+TEST(PrefixTableTest, LongestPrefixWins) {
+  PrefixTable table;
+  ASSERT_TRUE(table.AddCidr("10.0.0.0/8", 1));
+  ASSERT_TRUE(table.AddCidr("10.1.0.0/16", 2));
+  ASSERT_TRUE(table.AddCidr("10.1.2.0/24", 3));
+  ASSERT_TRUE(table.AddCidr("10.1.2.3", 4));
+  ASSERT_TRUE(table.AddCidr("10.1.2.128/25", 5));
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(10, 9, 9, 9)), 1u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(10, 1, 9, 9)), 2u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(10, 1, 2, 9)), 3u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(10, 1, 2, 3)), 4u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(10, 1, 2, 200)), 5u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(11, 0, 0, 0)), PrefixTable::kNoMatch);
+}
+
+TEST(PrefixTableTest, LastAddedWinsOnEqualLength) {
+  PrefixTable table;
+  table.AddCidr("192.168.0.0/16", 1);
+  table.AddCidr("192.168.0.0/16", 2);
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(192, 168, 1, 1)), 2u);
+}
+
+TEST(PrefixTableTest, DefaultRouteAndIpv6) {
+  PrefixTable table;
+  table.AddCidr("0.0.0.0/0", 9);
+  table.AddCidr("::/0", 7);
+  table.AddCidr("fc00::/7", 1);
+  table.AddCidr("2001:db8::1/128", 2);
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(8, 8, 8, 8)), 9u);
+
+  uint8_t address[16] = {0xfd, 0x12};
+  EXPECT_EQ(table.LookupIpv6(address), 1u);
+  uint8_t host[16] = {0x20, 0x01, 0x0d, 0xb8};
+  host[15] = 1;
+  EXPECT_EQ(table.LookupIpv6(host), 2u);
+  host[15] = 2;
+  EXPECT_EQ(table.LookupIpv6(host), 7u);
+}
+
+TEST(PrefixTableTest, ParsesCidrAndLists) {
+  uint8_t address[16];
+  uint8_t length;
+  uint8_t family;
+  ASSERT_TRUE(PrefixTable::ParseCidr("10.1.2.3/8", address, &length, &family));
+  EXPECT_EQ(family, 4);
+  EXPECT_EQ(length, 8);
+  EXPECT_EQ(address[0], 10);
+  EXPECT_EQ(address[1], 0);  // биты за префиксом обнулены
+  EXPECT_FALSE(PrefixTable::ParseCidr("10.0.0.0/33", address, &length, &family));
+  EXPECT_FALSE(PrefixTable::ParseCidr("fc00::/129", address, &length, &family));
+  EXPECT_FALSE(PrefixTable::ParseCidr("not an address", address, &length, &family));
+
+  PrefixTable table;
+  const char kList[] = "# geoip:private\n10.0.0.0/8\r\n\n  172.16.0.0/12\nfc00::/7\nbad\n";
+  EXPECT_EQ(table.AddCidrList(kList, sizeof(kList) - 1, 3), 3u);
+  EXPECT_EQ(table.ipv4_prefix_count(), 2u);
+  EXPECT_EQ(table.ipv6_prefix_count(), 1u);
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(172, 20, 0, 1)), 3u);
+}
+
+TEST(PrefixTableTest, RejectsInvalidValues) {
+  PrefixTable table;
+  EXPECT_FALSE(table.AddIpv4(0, 8, PrefixTable::kNoMatch));
+  EXPECT_FALSE(table.AddIpv4(0, 8, PrefixTable::kMaxValue + 1));
+  EXPECT_FALSE(table.AddIpv4(0, 33, 1));
+}
+
+// Пустая таблица и повторная сборка
+TEST(PrefixTableTest, BuildIsRepeatable) {
+  PrefixTable table;
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(1, 2, 3, 4)), PrefixTable::kNoMatch);
+  table.AddCidr("1.2.0.0/16", 1);
+  table.Build();
+  table.AddCidr("1.2.3.0/24", 2);
+  table.Build();
+  EXPECT_EQ(table.LookupIpv4(Ipv4(1, 2, 3, 4)), 2u);
+  EXPECT_EQ(table.LookupIpv4(Ipv4(1, 2, 4, 4)), 1u);
+}
+
+// Случайные наборы с вложенными префиксами сверяются с перебором, в том
+// числе на адресах у границ каждого префикса
+TEST(PrefixTableTest, MatchesBruteForceIpv4) {
+  std::mt19937 random(5);
+  PrefixTable table;
+  std::vector<Entry> entries;
+  std::vector<uint32_t> probes;
+  for (uint32_t i = 0; i < 3000; i++) {
+    // Префиксы кучкуются в нескольких /8, чтобы часто пересекаться
+    uint32_t address = ((uint32_t)(random() % 8 + 1) << 24) | (random() & 0x00FFFFFF);
+    uint8_t length = (uint8_t)(random() % 33);
+    uint32_t mask = length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+    address &= mask;
+    Entry entry;
+    memset(entry.address, 0, 16);
+    StoreIpv4(address, entry.address);
+    entry.length = length;
+    entry.value = i + 1;
+    entries.push_back(entry);
+    ASSERT_TRUE(table.AddIpv4(address, length, entry.value));
+    probes.push_back(address);
+    probes.push_back(address | ~mask);
+    probes.push_back((address | ~mask) + 1);
+    probes.push_back(address - 1);
+  }
+  table.Build();
+  for (int i = 0; i < 20000; i++) {
+    probes.push_back(((uint32_t)(random() % 9) << 24) | (random() & 0x00FFFFFF));
+  }
+  for (uint32_t address : probes) {
+    uint8_t bytes[16] = {};
+    StoreIpv4(address, bytes);
+    ASSERT_EQ(table.LookupIpv4(address), BruteForce(entries, bytes)) << std::hex << address;
+  }
+}
+
+TEST(PrefixTableTest, MatchesBruteForceIpv6) {
+  std::mt19937 random(6);
+  PrefixTable table;
+  std::vector<Entry> entries;
+  std::vector<std::vector<uint8_t>> probes;
+  for (uint32_t i = 0; i < 1000; i++) {
+    Entry entry;
+    for (uint8_t& byte : entry.address) byte = (uint8_t)random();
+    entry.address[0] = 0x20;
+    entry.address[1] = (uint8_t)(random() % 4);
+    entry.length = (uint8_t)(random() % 129);
+    for (int bit = entry.length; bit < 128; bit++) {
+      entry.address[bit >> 3] &= (uint8_t)~(0x80 >> (bit & 7));
+    }
+    entry.value = i + 1;
+    entries.push_back(entry);
+    ASSERT_TRUE(table.AddIpv6(entry.address, entry.length, entry.value));
+    probes.emplace_back(entry.address, entry.address + 16);
+    std::vector<uint8_t> last(entry.address, entry.address + 16);
+    for (int bit = entry.length; bit < 128; bit++) {
+      last[bit >> 3] |= (uint8_t)(0x80 >> (bit & 7));
+    }
+    probes.push_back(last);
+  }
+  table.Build();
+  for (const std::vector<uint8_t>& probe : probes) {
+    ASSERT_EQ(table.LookupIpv6(probe.data()), BruteForce(entries, probe.data()));
+  }
+}
+
+}  // namespace
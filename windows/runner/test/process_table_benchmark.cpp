@@ -0,0 +1,92 @@
+#include "process_table.h"
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t kTcp = 6;
+constexpr uint8_t kUdp = 17;
+// Сокетов в таблице: нагруженная машина с браузером и торрентами
+constexpr size_t kSockets = 8000;
+constexpr size_t kFlows = 4096;
+
+// Таблица: половина сокетов - исходящие соединения TCP на 192.168.1.10,
+// остальные - UDP на 0.0.0.0 и двухстековые на "::"; 200 разных программ
+ProcessTable* TestTable() {
+  static ProcessTable* table = [] {
+    ProcessTable* result = new ProcessTable();
+    std::mt19937 random(3);
+    const uint8_t local[4] = {192, 168, 1, 10};
+    const uint8_t any[16] = {};
+    for (size_t i = 0; i < kSockets; i++) {
+      std::string path =
+          "C:\\Program Files\\App" + std::to_string(random() % 200) + "\\app.exe";
+      uint16_t port = (uint16_t)(10000 + i);
+      if (i % 2 == 0) {
+        result->Update(ProcessTable::SocketKey(kTcp, 4, local, port), path, false);
+      } else {
+        result->Update(ProcessTable::SocketKey(kUdp, i % 4 == 1 ? 4 : 6, any, port), path, false);
+      }
+    }
+    return result;
+  }();
+  return table;
+}
+
+// Аргумент - вид потока: 0 - точный сокет (одна проба), 1 - сокет на
+// 0.0.0.0 (две), 2 - двухстековый на "::" (три), 3 - владельца нет
+std::vector<FlowKey> MakeFlows(int64_t kind) {
+  std::vector<FlowKey> flows(kFlows);
+  std::mt19937 random(7);
+  for (FlowKey& flow : flows) {
+    flow.family = 4;
+    const uint8_t source[4] = {192, 168, 1, 10};
+    memcpy(flow.source, source, sizeof(source));
+    flow.destination[0] = 203;
+    flow.destination[3] = (uint8_t)random();
+    flow.destination_port = 443;
+    uint32_t index = random() % (kSockets / 4);
+    switch (kind) {
+      case 0:
+        flow.protocol = kTcp;
+        flow.source_port = (uint16_t)(10000 + index * 4);
+        break;
+      case 1:
+        flow.protocol = kUdp;
+        flow.source_port = (uint16_t)(10000 + index * 4 + 1);
+        break;
+      case 2:
+        flow.protocol = kUdp;
+        flow.source_port = (uint16_t)(10000 + index * 4 + 3);
+        break;
+      default:
+        flow.protocol = kTcp;
+        flow.source_port = (uint16_t)(40000 + index);
+        break;
+    }
+  }
+  return flows;
+}
+
+// Поиск владельца нового потока, как в TrackFlow
+void BM_Lookup(benchmark::State& state) {
+  ProcessTable* table = TestTable();
+  std::vector<FlowKey> flows = MakeFlows(state.range(0));
+  size_t found = 0;
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string* path = table->Lookup(flows[i++ % kFlows]);
+    found += path != nullptr;
+    benchmark::DoNotOptimize(path);
+  }
+  state.counters["found"] = (double)found / (double)state.iterations();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Lookup)->DenseRange(0, 3);
+
+}  // namespace
@@ -0,0 +1,210 @@
+#include "process_table.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "process_monitor.h"
+
+namespace {
+
+constexpr uint8_t kTcp = IPPROTO_TCP;
+constexpr uint8_t kUdp = IPPROTO_UDP;
+
+struct Address {
+  uint8_t family;
+  uint8_t bytes[16];
+};
+
+Address Parse(const char* text) {
+  Address address = {};
+  if (inet_pton(AF_INET, text, address.bytes) == 1) {
+    address.family = 4;
+  } else {
+    EXPECT_EQ(inet_pton(AF_INET6, text, address.bytes), 1) << text;
+    address.family = 6;
+  }
+  return address;
+}
+
+// Сокет на адресе |local| ("0.0.0.0" и "::" - на всех адресах)
+FlowKey Socket(uint8_t protocol, const char* local, uint16_t port) {
+  Address address = Parse(local);
+  return ProcessTable::SocketKey(protocol, address.family, address.bytes, port);
+}
+
+// Исходящий поток с источником |source|:|port| к 203.0.113.7:443 (или
+// 2001:db8::7)
+FlowKey Flow(uint8_t protocol, const char* source, uint16_t port) {
+  Address address = Parse(source);
+  FlowKey key;
+  key.family = address.family;
+  key.protocol = protocol;
+  key.source_port = port;
+  key.destination_port = 443;
+  memcpy(key.source, address.bytes, sizeof(key.source));
+  Address destination = Parse(address.family == 4 ? "203.0.113.7" : "2001:db8::7");
+  memcpy(key.destination, destination.bytes, sizeof(key.destination));
+  return key;
+}
+
+std::string Owner(ProcessTable* table, const FlowKey& flow) {
+  const std::string* path = table->Lookup(flow);
+  return path != nullptr ? *path : "";
+}
+
+TEST(ProcessTableTest, ExactSocket) {
+  ProcessTable table;
+  table.Update(Socket(kTcp, "192.168.1.10", 50000), "C:\\Apps\\qbittorrent.exe", false);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "192.168.1.10", 50000)), "C:\\Apps\\qbittorrent.exe");
+  // Другой адрес, порт или протокол - не тот сокет
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "192.168.1.11", 50000)), "");
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "192.168.1.10", 50001)), "");
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "192.168.1.10", 50000)), "");
+}
+
+// Сокет на всех адресах находится второй пробой; точный сокет важнее
+TEST(ProcessTableTest, WildcardSocket) {
+  ProcessTable table;
+  table.Update(Socket(kUdp, "0.0.0.0", 6881), "C:\\Apps\\torrent.exe", false);
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "10.0.0.5", 6881)), "C:\\Apps\\torrent.exe");
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "192.168.1.10", 6881)), "C:\\Apps\\torrent.exe");
+  table.Update(Socket(kUdp, "10.0.0.5", 6881), "C:\\Apps\\other.exe", false);
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "10.0.0.5", 6881)), "C:\\Apps\\other.exe");
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "192.168.1.10", 6881)), "C:\\Apps\\torrent.exe");
+}
+
+// Двухстековый сокет IPv6 на "::" принимает и потоки IPv4; обратного нет
+TEST(ProcessTableTest, DualStackSocket) {
+  ProcessTable table;
+  table.Update(Socket(kUdp, "::", 51413), "/usr/bin/transmission", false);
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "192.168.1.10", 51413)), "/usr/bin/transmission");
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "2001:db8::10", 51413)), "/usr/bin/transmission");
+
+  table.Update(Socket(kTcp, "0.0.0.0", 8080), "/usr/bin/server", true);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "2001:db8::10", 8080)), "");
+  // Сокет IPv6 на конкретном адресе потоки IPv4 не принимает
+  table.Update(Socket(kTcp, "2001:db8::10", 9000), "/usr/bin/client", false);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "192.168.1.10", 9000)), "");
+}
+
+// Закрытие принятого соединения на порту слушающего сокета (тот же
+// локальный адрес и порт) не удаляет слушающий сокет
+TEST(ProcessTableTest, ListenerSurvivesConnectedRemove) {
+  ProcessTable table;
+  FlowKey listener = Socket(kTcp, "0.0.0.0", 8443);
+  table.Update(listener, "/usr/bin/server", true);
+  // Принятое соединение того же процесса не снимает признак
+  table.Update(listener, "/usr/bin/server", false);
+  table.Remove(listener, true);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "10.0.0.5", 8443)), "/usr/bin/server");
+  // Закрытие самого слушающего сокета
+  table.Remove(listener, false);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "10.0.0.5", 8443)), "");
+  EXPECT_EQ(table.size(), 0u);
+
+  // Обычный сокет удаляется и закрытием соединения
+  FlowKey client = Socket(kTcp, "10.0.0.5", 40000);
+  table.Update(client, "/usr/bin/client", false);
+  table.Remove(client, true);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "10.0.0.5", 40000)), "");
+
+  // Порт перешел к другому процессу: признак слушающего сокета не
+  // наследуется
+  table.Update(listener, "/usr/bin/server", true);
+  table.Update(listener, "/usr/bin/other", false);
+  table.Remove(listener, true);
+  EXPECT_EQ(Owner(&table, Flow(kTcp, "10.0.0.5", 8443)), "");
+}
+
+// Пути хранятся один раз и не переезжают: указатель из Lookup() остается
+// действительным
+TEST(ProcessTableTest, InternsPaths) {
+  ProcessTable table;
+  table.Update(Socket(kTcp, "10.0.0.1", 1000), "/usr/bin/a", false);
+  table.Update(Socket(kTcp, "10.0.0.1", 1001), "/usr/bin/a", false);
+  table.Update(Socket(kTcp, "10.0.0.1", 1002), "/usr/bin/b", false);
+  const std::string* first = table.Lookup(Flow(kTcp, "10.0.0.1", 1000));
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(table.Lookup(Flow(kTcp, "10.0.0.1", 1001)), first);
+  EXPECT_NE(table.Lookup(Flow(kTcp, "10.0.0.1", 1002)), first);
+
+  // Пустой путь не записывается
+  table.Update(Socket(kTcp, "10.0.0.1", 1003), "", false);
+  EXPECT_EQ(table.Lookup(Flow(kTcp, "10.0.0.1", 1003)), nullptr);
+
+  // Таблица путей заполнена: новые пути отбрасываются, прежние живы
+  for (size_t i = 0; i < ProcessTable::kMaxPaths + 10; i++) {
+    table.Update(Socket(kUdp, "10.0.0.2", (uint16_t)(2000 + i)), "/opt/p" + std::to_string(i),
+                 false);
+  }
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "10.0.0.2", 2000)), "/opt/p0");
+  EXPECT_EQ(Owner(&table, Flow(kUdp, "10.0.0.2", 2000 + ProcessTable::kMaxPaths + 5)), "");
+  EXPECT_EQ(table.Lookup(Flow(kTcp, "10.0.0.1", 1000)), first);
+  EXPECT_EQ(*first, "/usr/bin/a");
+}
+
+// Ждать, пока Lookup(|flow|) не станет |found|, не дольше нескольких
+// интервалов обновления монитора
+bool WaitForOwner(ProcessTable* table, const FlowKey& flow, bool found) {
+  for (int i = 0; i < 100; i++) {
+    if ((table->Lookup(flow) != nullptr) == found) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return false;
+}
+
+// Монитор находит сокеты своего процесса через sock_diag и /proc и
+// забывает закрытые
+TEST(ProcessMonitorTest, FindsOwnSockets) {
+  ProcessTable table;
+  ProcessMonitor monitor(&table);
+  if (!monitor.Start()) {
+    GTEST_SKIP() << "netlink sock_diag недоступен";
+  }
+  char self[4096];
+  ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  ASSERT_GT(length, 0);
+  const std::string path(self, (size_t)length);
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int udp = socket(AF_INET6, SOCK_DGRAM, 0);
+  ASSERT_GE(listener, 0);
+  ASSERT_GE(udp, 0);
+  sockaddr_in address4 = {};
+  address4.sin_family = AF_INET;
+  address4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(listener, (sockaddr*)&address4, sizeof(address4)), 0);
+  ASSERT_EQ(listen(listener, 4), 0);
+  sockaddr_in6 address6 = {};
+  address6.sin6_family = AF_INET6;
+  ASSERT_EQ(bind(udp, (sockaddr*)&address6, sizeof(address6)), 0);
+  socklen_t size4 = sizeof(address4);
+  socklen_t size6 = sizeof(address6);
+  ASSERT_EQ(getsockname(listener, (sockaddr*)&address4, &size4), 0);
+  ASSERT_EQ(getsockname(udp, (sockaddr*)&address6, &size6), 0);
+
+  FlowKey tcp_flow = Flow(kTcp, "127.0.0.1", ntohs(address4.sin_port));
+  // Двухстековый сокет на "::" - владелец и потоков IPv4
+  FlowKey udp_flow = Flow(kUdp, "192.168.1.10", ntohs(address6.sin6_port));
+  ASSERT_TRUE(WaitForOwner(&table, tcp_flow, true));
+  ASSERT_TRUE(WaitForOwner(&table, udp_flow, true));
+  EXPECT_EQ(Owner(&table, tcp_flow), path);
+  EXPECT_EQ(Owner(&table, udp_flow), path);
+
+  close(listener);
+  close(udp);
+  EXPECT_TRUE(WaitForOwner(&table, tcp_flow, false));
+  EXPECT_TRUE(WaitForOwner(&table, udp_flow, false));
+  monitor.Stop();
+  EXPECT_FALSE(monitor.IsRunning());
+}
+
+}  // namespace
@@ -0,0 +1,139 @@
+#include "proxy_server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using socket_test::ConnectTo;
+using socket_test::ReceiveAll;
+using socket_test::SendAll;
+
+// Прокси и эхо-сервер на 127.0.0.1. Аргументы бенчмарка: реактор
+// (0 - epoll, 1 - io_uring) и ретрансляция через splice() (0/1).
+class ProxyFixture {
+ public:
+  explicit ProxyFixture(const benchmark::State& state) : proxy_(&counters_) {
+    ProxyServer::Options options;
+    options.port = 0;
+    options.worker_count = 2;
+    options.reactor = state.range(0) != 0 ? ReactorKind::kIoUring : ReactorKind::kDefault;
+    options.zero_copy = state.range(1) != 0;
+    options.udp_relay = false;
+    started_ = proxy_.Start(options);
+  }
+
+  ~ProxyFixture() { proxy_.Stop(); }
+
+  // Туннель до эхо-сервера; -1 - ошибка
+  int OpenTunnel() {
+    if (!started_) {
+      return -1;
+    }
+    int client = ConnectTo(proxy_.port());
+    if (client < 0) {
+      return -1;
+    }
+    if (socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", echo_.port()) != 0x00) {
+      close(client);
+      return -1;
+    }
+    return client;
+  }
+
+ private:
+  TrafficCounters counters_;
+  ProxyServer proxy_;
+  socket_test::EchoServer echo_;
+  bool started_ = false;
+};
+
+void SetReactorLabel(benchmark::State& state) {
+  state.SetLabel(std::string(state.range(0) != 0 ? "io_uring" : "epoll") +
+                 (state.range(1) != 0 ? "/splice" : "/copy"));
+}
+
+// Пропускная способность одного туннеля: 1 МиБ туда и обратно за итерацию
+void BM_Throughput(benchmark::State& state) {
+  ProxyFixture fixture(state);
+  int client = fixture.OpenTunnel();
+  if (client < 0) {
+    state.SkipWithError("tunnel failed");
+    return;
+  }
+  std::string payload(1 << 20, 'x');
+  std::string echoed(payload.size(), '\0');
+  for (auto _ : state) {
+    std::thread writer([&] { SendAll(client, payload.data(), payload.size()); });
+    bool received = ReceiveAll(client, &echoed[0], echoed.size());
+    writer.join();
+    if (!received) {
+      state.SkipWithError("echo failed");
+      break;
+    }
+  }
+  close(client);
+  // Через прокси данные проходят дважды: к эхо-серверу и обратно
+  state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)payload.size() * 2);
+  SetReactorLabel(state);
+}
+BENCHMARK(BM_Throughput)
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// Задержка ретрансляции: обмен 64 байтами по установленному туннелю
+void BM_RoundTrip(benchmark::State& state) {
+  ProxyFixture fixture(state);
+  int client = fixture.OpenTunnel();
+  if (client < 0) {
+    state.SkipWithError("tunnel failed");
+    return;
+  }
+  char message[64] = {};
+  for (auto _ : state) {
+    if (!SendAll(client, message, sizeof(message)) ||
+        !ReceiveAll(client, message, sizeof(message))) {
+      state.SkipWithError("echo failed");
+      break;
+    }
+  }
+  close(client);
+  state.SetItemsProcessed((int64_t)state.iterations());
+  SetReactorLabel(state);
+}
+BENCHMARK(BM_RoundTrip)
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// Новое соединение целиком: connect, рукопожатие SOCKS5 с подключением к
+// назначению, первый обмен и закрытие. items/s - соединений в секунду.
+void BM_ConnectLatency(benchmark::State& state) {
+  ProxyFixture fixture(state);
+  char byte = 1;
+  for (auto _ : state) {
+    int client = fixture.OpenTunnel();
+    if (client < 0 || !SendAll(client, &byte, 1) || !ReceiveAll(client, &byte, 1)) {
+      if (client >= 0) {
+        close(client);
+      }
+      state.SkipWithError("connect failed");
+      break;
+    }
+    close(client);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  SetReactorLabel(state);
+}
+BENCHMARK(BM_ConnectLatency)
+    ->ArgsProduct({{0, 1}, {0}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,208 @@
+#include "proxy_server.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <tuple>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using socket_test::ConnectTo;
+using socket_test::ReceiveAll;
+using socket_test::SendAll;
+
+// Каждый сценарий прогоняется на всех реакторах и в обоих режимах
+// ретрансляции: epoll и io_uring, копирование и splice()
+class ProxyServerTest : public ::testing::TestWithParam<std::tuple<ReactorKind, bool>> {
+ protected:
+  void SetUp() override {
+    ProxyServer::Options options;
+    options.port = 0;
+    options.worker_count = 2;
+    options.reactor = std::get<0>(GetParam());
+    options.zero_copy = std::get<1>(GetParam());
+    options.udp_relay = false;
+    ASSERT_TRUE(proxy_.Start(options));
+  }
+
+  void TearDown() override { proxy_.Stop(); }
+
+  // Эхо через установленный туннель, включая объем больше буфера ретрансляции
+  void ExpectEcho(int client) {
+    std::string payload(256 * 1024, '\0');
+    for (size_t i = 0; i < payload.size(); i++) payload[i] = (char)(i * 131 + 7);
+    std::thread writer([&] { SendAll(client, payload.data(), payload.size()); });
+    std::string echoed(payload.size(), '\0');
+    bool received = ReceiveAll(client, &echoed[0], echoed.size());
+    writer.join();
+    ASSERT_TRUE(received);
+    EXPECT_TRUE(echoed == payload);
+  }
+
+  TrafficCounters counters_;
+  ProxyServer proxy_{&counters_};
+  socket_test::EchoServer echo_;
+};
+
+TEST_P(ProxyServerTest, Socks5Connect) {
+  int client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  ASSERT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", echo_.port()), 0x00);
+  ExpectEcho(client);
+  close(client);
+
+  TrafficSnapshot traffic = counters_.Snapshot();
+  EXPECT_GE(traffic.uploaded_bytes, 256u * 1024);
+  EXPECT_GE(traffic.downloaded_bytes, 256u * 1024);
+}
+
+TEST_P(ProxyServerTest, Socks5ConnectByName) {
+  int client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  ASSERT_EQ(socket_test::Socks5Handshake(client, 0x01, "localhost", echo_.port()), 0x00);
+  ExpectEcho(client);
+  close(client);
+}
+
+TEST_P(ProxyServerTest, HttpConnect) {
+  int client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  std::string reply =
+      socket_test::HttpConnect(client, "127.0.0.1:" + std::to_string(echo_.port()));
+  EXPECT_EQ(reply, "HTTP/1.1 200 Connection Established\r\n\r\n");
+  ExpectEcho(client);
+  close(client);
+}
+
+// Ответ 405 длиннее прежнего буфера ответа и приходил обрезанным
+TEST_P(ProxyServerTest, HttpNonConnectGetsFullReply) {
+  int client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  const char kRequest[] = "GET http://example.com/ HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  ASSERT_TRUE(SendAll(client, kRequest, sizeof(kRequest) - 1));
+  EXPECT_EQ(socket_test::ReceiveUntilClose(client),
+            "HTTP/1.1 405 Method Not Allowed\r\nAllow: CONNECT\r\nConnection: close\r\n\r\n");
+  close(client);
+}
+
+TEST_P(ProxyServerTest, Socks5Failures) {
+  // BIND не поддерживается
+  int client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  EXPECT_EQ(socket_test::Socks5Handshake(client, 0x02, "127.0.0.1", echo_.port()), 0x07);
+  close(client);
+
+  // Порт, который никто не слушает
+  int closed = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  bind(closed, (sockaddr*)&address, sizeof(address));
+  uint16_t closed_port = socket_test::LocalPort(closed);
+  close(closed);
+  client = ConnectTo(proxy_.port());
+  ASSERT_GE(client, 0);
+  EXPECT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", closed_port), 0x05);
+  close(client);
+}
+
+// Прокси перед ядром: proxy уходит в вышестоящий SOCKS5 (здесь - proxy_),
+// direct соединяется сам, block получает отказ. Смена маршрута действует
+// на следующее соединение без перезапуска.
+TEST_P(ProxyServerTest, RoutesThroughUpstreamProxy) {
+  std::atomic<RouteAction> action{RouteAction::kProxy};
+  ProxyServer front(nullptr);
+  ProxyServer::Options options;
+  options.port = 0;
+  options.worker_count = 2;
+  options.reactor = std::get<0>(GetParam());
+  options.zero_copy = std::get<1>(GetParam());
+  options.udp_relay = false;
+  options.upstream_port = proxy_.port();
+  options.route = [&action](const std::string& host, uint16_t) {
+    return host == "blocked.example" ? RouteAction::kBlock : action.load();
+  };
+  ASSERT_TRUE(front.Start(options));
+
+  int client = ConnectTo(front.port());
+  ASSERT_GE(client, 0);
+  ASSERT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", echo_.port()), 0x00);
+  ExpectEcho(client);
+  close(client);
+  EXPECT_EQ(proxy_.accepted_count(), 1u);
+
+  // Имя передается дальше и разрешается вышестоящим прокси
+  client = ConnectTo(front.port());
+  ASSERT_GE(client, 0);
+  EXPECT_EQ(socket_test::HttpConnect(client, "localhost:" + std::to_string(echo_.port())),
+            "HTTP/1.1 200 Connection Established\r\n\r\n");
+  ExpectEcho(client);
+  close(client);
+  EXPECT_EQ(proxy_.accepted_count(), 2u);
+
+  action = RouteAction::kDirect;
+  client = ConnectTo(front.port());
+  ASSERT_GE(client, 0);
+  ASSERT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", echo_.port()), 0x00);
+  ExpectEcho(client);
+  close(client);
+  EXPECT_EQ(proxy_.accepted_count(), 2u);
+
+  client = ConnectTo(front.port());
+  ASSERT_GE(client, 0);
+  EXPECT_EQ(socket_test::Socks5Handshake(client, 0x01, "blocked.example", 443), 0x02);
+  close(client);
+  EXPECT_EQ(front.blocked_count(), 1u);
+
+  // Ошибка вышестоящего прокси доходит до клиента со своим кодом
+  action = RouteAction::kProxy;
+  int closed = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  bind(closed, (sockaddr*)&address, sizeof(address));
+  uint16_t closed_port = socket_test::LocalPort(closed);
+  close(closed);
+  client = ConnectTo(front.port());
+  ASSERT_GE(client, 0);
+  EXPECT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", closed_port), 0x05);
+  close(client);
+
+  front.Stop();
+}
+
+// Параллельные соединения расходятся по потокам и закрываются без утечек
+TEST_P(ProxyServerTest, ManyConnections) {
+  constexpr int kClients = 64;
+  std::vector<int> clients;
+  for (int i = 0; i < kClients; i++) {
+    int client = ConnectTo(proxy_.port());
+    ASSERT_GE(client, 0);
+    ASSERT_EQ(socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", echo_.port()), 0x00);
+    clients.push_back(client);
+  }
+  for (int i = 0; i < kClients; i++) {
+    uint32_t value = (uint32_t)i;
+    uint32_t echoed = 0;
+    ASSERT_TRUE(SendAll(clients[i], &value, sizeof(value)));
+    ASSERT_TRUE(ReceiveAll(clients[i], &echoed, sizeof(echoed)));
+    EXPECT_EQ(echoed, value);
+  }
+  for (int client : clients) close(client);
+  EXPECT_EQ(proxy_.accepted_count(), (uint64_t)kClients);
+
+  for (int i = 0; i < 200 && proxy_.active_count() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(proxy_.active_count(), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Reactors, ProxyServerTest,
+    ::testing::Combine(::testing::Values(ReactorKind::kDefault, ReactorKind::kIoUring),
+                       ::testing::Bool()),
+    [](const ::testing::TestParamInfo<std::tuple<ReactorKind, bool>>& info) {
+      return std::string(std::get<0>(info.param) == ReactorKind::kIoUring ? "Uring" : "Epoll") +
+             (std::get<1>(info.param) ? "Splice" : "Copy");
+    });
+
+}  // namespace
@@ -0,0 +1,64 @@
+#include "rcu_pointer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+struct Profile {
+  uint64_t rules[16] = {};
+};
+
+RcuPointer<Profile>& Pointer() {
+  static RcuPointer<Profile> pointer;
+  static bool published = [] {
+    pointer.Publish(std::unique_ptr<const Profile>(new Profile()));
+    return true;
+  }();
+  (void)published;
+  return pointer;
+}
+
+// Стоимость ReadGuard на пакет (один снимок на пачку в цикле перехвата)
+void BM_Read(benchmark::State& state) {
+  RcuPointer<Profile>& pointer = Pointer();
+  for (auto _ : state) {
+    RcuPointer<Profile>::ReadGuard guard = pointer.Read();
+    benchmark::DoNotOptimize(guard->rules[0]);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_Read)->ThreadRange(1, 8)->UseRealTime();
+
+// Чтение при непрерывной смене профиля в соседнем потоке
+void BM_ReadWhilePublishing(benchmark::State& state) {
+  RcuPointer<Profile>& pointer = Pointer();
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      pointer.Publish(std::unique_ptr<const Profile>(new Profile()));
+      std::this_thread::yield();
+    }
+  });
+  for (auto _ : state) {
+    RcuPointer<Profile>::ReadGuard guard = pointer.Read();
+    benchmark::DoNotOptimize(guard->rules[0]);
+  }
+  stop = true;
+  writer.join();
+  pointer.Reclaim();
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_ReadWhilePublishing)->UseRealTime();
+
+void BM_Publish(benchmark::State& state) {
+  RcuPointer<Profile>& pointer = Pointer();
+  for (auto _ : state) {
+    pointer.Publish(std::unique_ptr<const Profile>(new Profile()));
+  }
+}
+BENCHMARK(BM_Publish);
+
+}  // namespace
@@ -0,0 +1,164 @@
+#include "rcu_pointer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> g_alive{0};
+
+// Снимок с инвариантом: все слова равны поколению. Разрушенный объект
+// затирается, поэтому чтение после освобождения тоже ломает инвариант.
+struct Snapshot {
+  static constexpr size_t kWords = 64;
+
+  explicit Snapshot(uint64_t generation) : generation(generation) {
+    for (uint64_t& word : words) word = generation;
+    g_alive++;
+  }
+  ~Snapshot() {
+    for (uint64_t& word : words) word = 0xDEADDEADDEADDEADull;
+    generation = 0;
+    g_alive--;
+  }
+
+  bool Consistent() const {
+    for (uint64_t word : words) {
+      if (word != generation) return false;
+    }
+    return generation != 0;
+  }
+
+  uint64_t generation;
+  uint64_t words[kWords];
+};
+
+TEST(RcuPointerTest, PublishAndRead) {
+  {
+    RcuPointer<Snapshot> pointer;
+    EXPECT_FALSE(pointer.Read());
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(1)));
+    {
+      RcuPointer<Snapshot>::ReadGuard guard = pointer.Read();
+      ASSERT_TRUE(guard);
+      EXPECT_EQ(guard->generation, 1u);
+    }
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(2)));
+    EXPECT_EQ(pointer.Read()->generation, 2u);
+    EXPECT_EQ(pointer.Reclaim(), 0u);
+    EXPECT_EQ(g_alive.load(), 1);
+  }
+  EXPECT_EQ(g_alive.load(), 0);
+}
+
+// Старый снимок живет, пока его держит читатель, и освобождается после
+TEST(RcuPointerTest, ReaderKeepsRetiredSnapshotAlive) {
+  RcuPointer<Snapshot> pointer;
+  pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(1)));
+  {
+    RcuPointer<Snapshot>::ReadGuard old = pointer.Read();
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(2)));
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(3)));
+    EXPECT_EQ(pointer.Reclaim(), 2u);
+    EXPECT_TRUE(old->Consistent());
+    EXPECT_EQ(old->generation, 1u);
+
+    // Вложенное чтение в том же потоке видит новый снимок
+    RcuPointer<Snapshot>::ReadGuard current = pointer.Read();
+    EXPECT_EQ(current->generation, 3u);
+  }
+  EXPECT_EQ(pointer.Reclaim(), 0u);
+  EXPECT_EQ(g_alive.load(), 1);
+}
+
+// Publish не ждет читателей: читатель держит снимок в другом потоке, а
+// писатель публикует и возвращается
+TEST(RcuPointerTest, PublishDoesNotWaitForReaders) {
+  RcuPointer<Snapshot> pointer;
+  pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(1)));
+  std::atomic<bool> holding{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    RcuPointer<Snapshot>::ReadGuard guard = pointer.Read();
+    holding = true;
+    while (!release) std::this_thread::yield();
+    EXPECT_TRUE(guard->Consistent());
+    EXPECT_EQ(guard->generation, 1u);
+  });
+  while (!holding) std::this_thread::yield();
+  for (uint64_t generation = 2; generation < 100; generation++) {
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(generation)));
+  }
+  EXPECT_EQ(pointer.Reclaim(), 98u);
+  release = true;
+  reader.join();
+  EXPECT_EQ(pointer.Reclaim(), 0u);
+}
+
+// Читатели не блокируются и видят только целые снимки, а поколения в
+// каждом потоке не идут назад. Потоков больше, чем слотов эпох, поэтому
+// слоты делятся.
+TEST(RcuPointerTest, ConcurrentReadersSeeConsistentSnapshots) {
+  constexpr size_t kReaders = EpochDomain::kSlotCount + 16;
+  RcuPointer<Snapshot> pointer;
+  pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(1)));
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> torn{0};
+  std::atomic<uint64_t> backwards{0};
+  std::atomic<uint64_t> reads{0};
+
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < kReaders; r++) {
+    readers.emplace_back([&] {
+      uint64_t last = 0;
+      uint64_t local_reads = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        RcuPointer<Snapshot>::ReadGuard guard = pointer.Read();
+        if (!guard->Consistent()) torn++;
+        if (guard->generation < last) backwards++;
+        last = guard->generation;
+        local_reads++;
+      }
+      reads += local_reads;
+    });
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  uint64_t generation = 1;
+  while (std::chrono::steady_clock::now() < deadline) {
+    pointer.Publish(std::unique_ptr<const Snapshot>(new Snapshot(++generation)));
+    if (generation % 16 == 0) std::this_thread::yield();
+  }
+  stop = true;
+  for (std::thread& reader : readers) reader.join();
+
+  EXPECT_EQ(torn.load(), 0u);
+  EXPECT_EQ(backwards.load(), 0u);
+  EXPECT_GT(reads.load(), kReaders);
+  EXPECT_GT(generation, 10u);
+  EXPECT_EQ(pointer.Reclaim(), 0u);
+  EXPECT_EQ(g_alive.load(), 1);
+}
+
+TEST(EpochDomainTest, TracksOldestActiveReader) {
+  EpochDomain domain;
+  EXPECT_EQ(domain.MinActiveEpoch(), EpochDomain::kNoReaders);
+  size_t slot = domain.Enter();
+  uint64_t entered = domain.Advance();
+  domain.Advance();
+  EXPECT_EQ(domain.MinActiveEpoch(), entered);
+
+  // Второй читатель того же слота наследует более раннюю эпоху
+  size_t nested = domain.Enter();
+  EXPECT_EQ(nested, slot);
+  domain.Exit(slot);
+  EXPECT_EQ(domain.MinActiveEpoch(), entered);
+  domain.Exit(nested);
+  EXPECT_EQ(domain.MinActiveEpoch(), EpochDomain::kNoReaders);
+}
+
+}  // namespace
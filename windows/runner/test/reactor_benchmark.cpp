@@ -0,0 +1,327 @@
+#include "reactor.h"
+
+#include <benchmark/benchmark.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Эхо-сервер на Reactor в одном потоке: ровно то, что меняется между
+// бэкендами. Клиенты работают на epoll напрямую в обоих случаях.
+class ReactorEchoServer {
+ public:
+  explicit ReactorEchoServer(ReactorKind kind) : reactor_(Reactor::Create(kind)) {
+    listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = socket_test::Loopback(0);
+    if (reactor_ == nullptr ||
+        bind(listener_, (sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener_, SOMAXCONN) != 0 || !SetSocketNonBlocking(listener_) ||
+        !reactor_->Attach(listener_)) {
+      return;
+    }
+    port_ = socket_test::LocalPort(listener_);
+    accept_.type = IoOpType::kAccept;
+    accept_.socket = listener_;
+    accept_.handler = &acceptor_;
+    acceptor_.server = this;
+    reactor_->Submit(&accept_);
+    thread_ = std::thread([this] {
+      while (!stopping_.load(std::memory_order_acquire)) {
+        reactor_->Poll(100);
+      }
+    });
+  }
+
+  ~ReactorEchoServer() {
+    if (thread_.joinable()) {
+      stopping_.store(true, std::memory_order_release);
+      reactor_->Wake();
+      thread_.join();
+    }
+    reactor_.reset();
+    for (Connection* connection : live_) {
+      if (!connection->closing) {
+        close(connection->socket);
+      }
+      delete connection;
+    }
+    close(listener_);
+  }
+
+  bool ok() const { return port_ != 0; }
+  uint16_t port() const { return port_; }
+  const char* name() const { return reactor_ != nullptr ? reactor_->name() : "none"; }
+
+ private:
+  struct Connection final : IoHandler {
+    ReactorEchoServer* server = nullptr;
+    SocketHandle socket = kInvalidSocket;
+    IoOp op;
+    char buffer[256];
+    bool closing = false;
+
+    void Read() {
+      op.type = IoOpType::kRead;
+      op.length = sizeof(buffer);
+      if (!server->reactor_->Submit(&op)) Close();
+    }
+
+    void Close() {
+      closing = true;
+      server->reactor_->Close(socket);
+    }
+
+    void OnIoComplete(IoOp* completed) override {
+      if (closing) {
+        server->Forget(this);
+        return;
+      }
+      if (completed->error != 0 || (completed->type == IoOpType::kRead && completed->transferred == 0)) {
+        Close();
+        return;
+      }
+      if (completed->type == IoOpType::kRead) {
+        op.type = IoOpType::kWrite;
+        op.length = completed->transferred;
+        if (!server->reactor_->Submit(&op)) Close();
+      } else {
+        Read();
+      }
+    }
+  };
+
+  struct Acceptor : IoHandler {
+    ReactorEchoServer* server = nullptr;
+    void OnIoComplete(IoOp* op) override { server->OnAccept(op); }
+  };
+
+  void OnAccept(IoOp* op) {
+    if (op->error == 0 && op->accepted != kInvalidSocket) {
+      SocketHandle socket = op->accepted;
+      if (!SetSocketNonBlocking(socket) || !reactor_->Attach(socket)) {
+        close(socket);
+      } else {
+        int enable = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        Connection* connection = new Connection();
+        connection->server = this;
+        connection->socket = socket;
+        connection->op.socket = socket;
+        connection->op.buffer = connection->buffer;
+        connection->op.handler = connection;
+        live_.push_back(connection);
+        connection->Read();
+      }
+    }
+    if (!stopping_.load(std::memory_order_acquire)) {
+      reactor_->Submit(&accept_);
+    }
+  }
+
+  void Forget(Connection* connection) {
+    live_.erase(std::find(live_.begin(), live_.end(), connection));
+    delete connection;
+  }
+
+  std::unique_ptr<Reactor> reactor_;
+  SocketHandle listener_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  IoOp accept_;
+  Acceptor acceptor_;
+  std::vector<Connection*> live_;
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+
+// Число потоков: 10k, если позволяет лимит дескрипторов (в процессе оба
+// конца каждого соединения)
+size_t StreamCount() {
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  getrlimit(RLIMIT_NOFILE, &limit);
+  size_t available = limit.rlim_cur > 512 ? (size_t)(limit.rlim_cur - 512) / 2 : 64;
+  return std::min<size_t>(10000, available);
+}
+
+// Неблокирующие клиенты на одном epoll
+class Clients {
+ public:
+  Clients() : epoll_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+  ~Clients() {
+    CloseAll();
+    close(epoll_);
+  }
+
+  // Открыть |count| соединений волнами по kWave: connect, байт туда и
+  // обратно. false - соединение не установилось.
+  bool Open(uint16_t port, size_t count) {
+    constexpr size_t kWave = 256;
+    while (sockets_.size() < count) {
+      size_t first = sockets_.size();
+      size_t wave = std::min(kWave, count - first);
+      for (size_t i = 0; i < wave; i++) {
+        int client = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_in address = socket_test::Loopback(port);
+        if (client < 0 ||
+            (connect(client, (sockaddr*)&address, sizeof(address)) != 0 && errno != EINPROGRESS)) {
+          if (client >= 0) close(client);
+          return false;
+        }
+        // RST при закрытии: без TIME_WAIT на 10k портов за итерацию
+        linger hard = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_LINGER, &hard, sizeof(hard));
+        int enable = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        event.data.u64 = sockets_.size();
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, client, &event);
+        sockets_.push_back(client);
+      }
+      if (!PingPong(first, sockets_.size(), 1, nullptr)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Сообщение по каждому соединению [first, last); задержки в микросекундах
+  // дописываются в |latencies|
+  bool PingPong(size_t first, size_t last, size_t length, std::vector<double>* latencies) {
+    char message[256] = {};
+    std::vector<Clock::time_point> sent(last - first);
+    std::vector<bool> done(last - first, false);
+    size_t remaining = last - first;
+    size_t next = first;
+    std::vector<epoll_event> events(1024);
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(30);
+    while (remaining > 0) {
+      // Отправка всем сразу; неготовые к записи (connect в процессе)
+      // дожидаются EPOLLOUT
+      while (next < last) {
+        ssize_t result = send(sockets_[next], message, length, MSG_NOSIGNAL);
+        if (result != (ssize_t)length) break;
+        sent[next - first] = Clock::now();
+        next++;
+      }
+      int count = epoll_wait(epoll_, events.data(), (int)events.size(), 100);
+      for (int i = 0; i < count; i++) {
+        size_t index = (size_t)events[i].data.u64;
+        if (index < first || index >= next || done[index - first]) continue;
+        char reply[256];
+        ssize_t received = recv(sockets_[index], reply, sizeof(reply), 0);
+        if (received == (ssize_t)length) {
+          done[index - first] = true;
+          remaining--;
+          if (latencies != nullptr) {
+            latencies->push_back(
+                std::chrono::duration<double, std::micro>(Clock::now() - sent[index - first])
+                    .count());
+          }
+        } else if (received == 0 || (received < 0 && errno != EAGAIN)) {
+          return false;
+        }
+      }
+      if (Clock::now() > deadline) return false;
+    }
+    return true;
+  }
+
+  void CloseAll() {
+    for (int client : sockets_) close(client);
+    sockets_.clear();
+  }
+
+  size_t size() const { return sockets_.size(); }
+
+ private:
+  int epoll_;
+  std::vector<int> sockets_;
+};
+
+double Percentile(std::vector<double>* values, double fraction) {
+  if (values->empty()) return 0;
+  size_t index = std::min(values->size() - 1, (size_t)(fraction * (double)values->size()));
+  std::nth_element(values->begin(), values->begin() + (ptrdiff_t)index, values->end());
+  return (*values)[index];
+}
+
+ReactorKind KindOf(const benchmark::State& state) {
+  return state.range(0) != 0 ? ReactorKind::kIoUring : ReactorKind::kDefault;
+}
+
+// Установление соединений: connect и первый обмен, 10k за итерацию.
+// items/s - соединений в секунду.
+void BM_ConnectionRate(benchmark::State& state) {
+  ReactorEchoServer server(KindOf(state));
+  if (!server.ok()) {
+    state.SkipWithError("server failed");
+    return;
+  }
+  size_t streams = StreamCount();
+  for (auto _ : state) {
+    Clients clients;
+    if (!clients.Open(server.port(), streams)) {
+      state.SkipWithError("connect failed");
+      break;
+    }
+    state.PauseTiming();
+    clients.CloseAll();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * streams));
+  state.counters["streams"] = (double)streams;
+  state.SetLabel(server.name());
+}
+BENCHMARK(BM_ConnectionRate)
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Задержка при 10k одновременных потоков: за итерацию каждый поток
+// отправляет 64 байта и ждет эха. p50/p99 - по всем сообщениям.
+void BM_EchoLatency(benchmark::State& state) {
+  ReactorEchoServer server(KindOf(state));
+  Clients clients;
+  size_t streams = StreamCount();
+  if (!server.ok() || !clients.Open(server.port(), streams)) {
+    state.SkipWithError("setup failed");
+    return;
+  }
+  std::vector<double> latencies;
+  latencies.reserve(streams * 20);
+  for (auto _ : state) {
+    if (!clients.PingPong(0, streams, 64, &latencies)) {
+      state.SkipWithError("echo failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * streams));
+  state.counters["streams"] = (double)streams;
+  state.counters["p50_us"] = Percentile(&latencies, 0.50);
+  state.counters["p99_us"] = Percentile(&latencies, 0.99);
+  state.SetLabel(server.name());
+}
+BENCHMARK(BM_EchoLatency)
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(20)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,72 @@
+#include "proxy_server.h"
+
+#include <benchmark/benchmark.h>
+#include <time.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "socket_test_util.h"
+
+namespace {
+
+double ProcessCpuSeconds() {
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// Ретрансляция в одну сторону: клиент -> прокси -> сервер-приемник.
+// Аргумент - режим ретрансляции (0 - копирование, 1 - splice()).
+// cpu_ms_per_GB - процессорное время всего процесса на гигабайт. Клиент и
+// приемник тратят одинаково в обоих режимах, разница - работа прокси.
+void BM_RelayCpuPerGb(benchmark::State& state) {
+  TrafficCounters counters;
+  ProxyServer proxy(&counters);
+  socket_test::EchoServer sink(true);
+  ProxyServer::Options options;
+  options.port = 0;
+  options.worker_count = 1;
+  options.zero_copy = state.range(0) != 0;
+  options.udp_relay = false;
+  if (!proxy.Start(options)) {
+    state.SkipWithError("proxy failed");
+    return;
+  }
+  int client = socket_test::ConnectTo(proxy.port());
+  if (client < 0 ||
+      socket_test::Socks5Handshake(client, 0x01, "127.0.0.1", sink.port()) != 0x00) {
+    state.SkipWithError("tunnel failed");
+    proxy.Stop();
+    return;
+  }
+
+  std::string chunk(4 << 20, 'x');
+  uint64_t expected = 0;
+  double cpu_start = ProcessCpuSeconds();
+  for (auto _ : state) {
+    if (!socket_test::SendAll(client, chunk.data(), chunk.size())) {
+      state.SkipWithError("send failed");
+      break;
+    }
+    // Итерация заканчивается, когда приемник получил весь блок
+    expected += chunk.size();
+    while (sink.received_bytes() < expected) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+  double cpu_seconds = ProcessCpuSeconds() - cpu_start;
+  close(client);
+  proxy.Stop();
+
+  double gigabytes = (double)expected / 1e9;
+  if (gigabytes > 0) {
+    state.counters["cpu_ms_per_GB"] = cpu_seconds * 1000 / gigabytes;
+  }
+  state.SetBytesProcessed((int64_t)expected);
+  state.SetLabel(options.zero_copy ? "splice" : "copy");
+}
+BENCHMARK(BM_RelayCpuPerGb)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}  // namespace
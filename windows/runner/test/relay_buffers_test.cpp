@@ -0,0 +1,116 @@
+#include "relay_buffers.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+TEST(BufferPoolTest, AllocatesWholeChunks) {
+  BufferPool pool(4096);
+  EXPECT_EQ(pool.allocated_count(), 0u);
+
+  char* first = pool.Acquire();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(pool.allocated_count(), BufferPool::kBlocksPerChunk);
+  EXPECT_EQ(pool.free_count(), BufferPool::kBlocksPerChunk - 1);
+
+  // Буферы блока идут подряд, начиная с первого
+  char* second = pool.Acquire();
+  EXPECT_EQ(second, first + 4096);
+  pool.Release(second);
+  pool.Release(first);
+}
+
+TEST(BufferPoolTest, ReusesReleasedBufferFirst) {
+  BufferPool pool(1024);
+  char* a = pool.Acquire();
+  char* b = pool.Acquire();
+  pool.Release(a);
+  EXPECT_EQ(pool.Acquire(), a);
+  pool.Release(nullptr);
+  EXPECT_EQ(pool.free_count(), BufferPool::kBlocksPerChunk - 2);
+  pool.Release(b);
+}
+
+TEST(BufferPoolTest, GrowsWithoutOverlap) {
+  constexpr size_t kSize = 512;
+  BufferPool pool(kSize);
+  std::vector<char*> buffers;
+  for (size_t i = 0; i < BufferPool::kBlocksPerChunk * 3 + 1; i++) {
+    buffers.push_back(pool.Acquire());
+  }
+  EXPECT_EQ(pool.allocated_count(), BufferPool::kBlocksPerChunk * 4);
+
+  std::set<char*> sorted(buffers.begin(), buffers.end());
+  ASSERT_EQ(sorted.size(), buffers.size());
+  // Соседние адреса отстоят хотя бы на размер буфера
+  char* previous = nullptr;
+  for (char* buffer : sorted) {
+    if (previous != nullptr) {
+      EXPECT_GE((size_t)(buffer - previous), kSize);
+    }
+    previous = buffer;
+  }
+  for (char* buffer : buffers) pool.Release(buffer);
+  EXPECT_EQ(pool.free_count(), pool.allocated_count());
+}
+
+#if defined(__linux__)
+
+TEST(PipePoolTest, LimitsPipesInUse) {
+  PipePool pool(2);
+  int a[2], b[2], c[2];
+  ASSERT_TRUE(pool.Acquire(a));
+  ASSERT_TRUE(pool.Acquire(b));
+  EXPECT_FALSE(pool.Acquire(c));
+  EXPECT_EQ(pool.in_use_count(), 2u);
+
+  pool.Release(a);
+  EXPECT_EQ(a[0], -1);
+  EXPECT_EQ(pool.in_use_count(), 1u);
+  ASSERT_TRUE(pool.Acquire(c));
+  pool.Release(b);
+  pool.Release(c);
+  EXPECT_EQ(pool.in_use_count(), 0u);
+}
+
+TEST(PipePoolTest, ReusesOnlyEmptyPipes) {
+  PipePool pool(4);
+  int empty[2];
+  ASSERT_TRUE(pool.Acquire(empty));
+  int empty_read = empty[0];
+  pool.Release(empty);
+
+  int reused[2];
+  ASSERT_TRUE(pool.Acquire(reused));
+  EXPECT_EQ(reused[0], empty_read);
+
+  // Остаток прерванного соединения не должен достаться следующему
+  ASSERT_EQ(write(reused[1], "abc", 3), 3);
+  pool.Release(reused);
+  int fresh[2];
+  ASSERT_TRUE(pool.Acquire(fresh));
+  char byte;
+  EXPECT_EQ(read(fresh[0], &byte, 1), -1);  // пустой неблокирующий канал
+  pool.Release(fresh);
+}
+
+TEST(PipePoolTest, PipeHoldsFullCapacity) {
+  PipePool pool(1);
+  int fds[2];
+  ASSERT_TRUE(pool.Acquire(fds));
+  std::vector<char> chunk(PipePool::kPipeCapacity, 'x');
+  EXPECT_EQ(write(fds[1], chunk.data(), chunk.size()), (ssize_t)chunk.size());
+  EXPECT_EQ(read(fds[0], chunk.data(), chunk.size()), (ssize_t)chunk.size());
+  pool.Release(fds);
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
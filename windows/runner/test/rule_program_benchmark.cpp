@@ -0,0 +1,139 @@
+#include "rule_program.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rule_test_util.h"
+
+namespace {
+
+// Профиль из |count| правил с уникальными значениями (как длинные списки
+// сайтов, адресов и игр) и 1024 запроса, каждый из которых совпадает с
+// правилом в случайной позиции. Линейному перебору в среднем приходится
+// пройти половину списка.
+struct Profile {
+  RuleProgram program;
+  rule_test::LinearRules linear;
+  std::vector<RouteQuery> queries;
+  std::vector<std::string> domains;
+  std::vector<std::string> processes;
+
+  explicit Profile(size_t count) {
+    RuleLists lists;
+    for (size_t i = 0; i < count; i++) {
+      std::string type;
+      std::string value;
+      switch (i % 4) {
+        case 0:
+          type = "domain";
+          value = "domain:site" + std::to_string(i) + ".example";
+          break;
+        case 1:
+          type = "ip";
+          value = "10." + std::to_string((i >> 16) & 0xFF) + "." +
+                  std::to_string((i >> 8) & 0xFF) + "." + std::to_string(i & 0xFF) + "/32";
+          break;
+        case 2:
+          type = "port";
+          value = std::to_string(1 + i % 65535);
+          break;
+        default:
+          type = "process";
+          value = "game" + std::to_string(i) + ".exe";
+          break;
+      }
+      RouteAction action = (RouteAction)(1 + i % 3);
+      program.AddRule(type, value, action, lists);
+      linear.Add(type, value, action);
+    }
+    program.AddRule("default", "", RouteAction::kProxy, lists);
+    linear.Add("default", "", RouteAction::kProxy);
+    program.Build();
+
+    std::mt19937 random(3);
+    domains.reserve(1024);
+    processes.reserve(1024);
+    for (int i = 0; i < 1024; i++) {
+      size_t target = random() % count;
+      RouteQuery query;
+      query.protocols = kRouteProtocolTcp;
+      switch (target % 4) {
+        case 0:
+          domains.push_back("www.site" + std::to_string(target) + ".example");
+          query.domain = domains.back().c_str();
+          query.domain_length = domains.back().size();
+          break;
+        case 1:
+          query.family = 4;
+          query.ipv4 = (10u << 24) | (uint32_t)(target & 0xFFFFFF);
+          break;
+        case 2:
+          query.port = (uint16_t)(1 + target % 65535);
+          break;
+        default:
+          processes.push_back("C:\\Games\\game" + std::to_string(target) + ".exe");
+          query.process = processes.back().c_str();
+          query.process_length = processes.back().size();
+          break;
+      }
+      queries.push_back(query);
+    }
+  }
+};
+
+const Profile& ProfileOf(size_t count) {
+  static std::map<size_t, std::unique_ptr<Profile>> profiles;
+  std::unique_ptr<Profile>& profile = profiles[count];
+  if (!profile) {
+    profile.reset(new Profile(count));
+  }
+  return *profile;
+}
+
+// Стоимость Evaluate() не должна зависеть от числа правил
+void BM_CompiledEvaluate(benchmark::State& state) {
+  const Profile& profile = ProfileOf((size_t)state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(profile.program.Evaluate(profile.queries[i++ & 1023]));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.counters["bytes"] = (double)profile.program.MemoryUsage();
+}
+BENCHMARK(BM_CompiledEvaluate)->Arg(10)->Arg(1000)->Arg(100000);
+
+void BM_LinearScan(benchmark::State& state) {
+  const Profile& profile = ProfileOf((size_t)state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(profile.linear.Evaluate(profile.queries[i++ & 1023]));
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_LinearScan)->Arg(10)->Arg(1000)->Arg(100000);
+
+// Компиляция случайного профиля (вне горячего пути, но при каждой смене)
+void BM_CompileProfile(benchmark::State& state) {
+  RuleLists lists;
+  rule_test::RuleGenerator generator(11);
+  std::vector<rule_test::RuleGenerator::GeneratedRule> rules;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    rules.push_back(generator.NextRule());
+  }
+  for (auto _ : state) {
+    RuleProgram program;
+    for (const auto& rule : rules) {
+      program.AddRule(rule.type, rule.value, rule.action, lists);
+    }
+    program.Build();
+    benchmark::DoNotOptimize(program.MemoryUsage());
+  }
+}
+BENCHMARK(BM_CompileProfile)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,160 @@
+#include "rule_program.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "rule_test_util.h"
+
+namespace {
+
+RouteQuery DomainQuery(const char* domain) {
+  RouteQuery query;
+  query.domain = domain;
+  query.domain_length = strlen(domain);
+  return query;
+}
+
+RouteQuery Ipv4Query(uint32_t address) {
+  RouteQuery query;
+  query.family = 4;
+  query.ipv4 = address;
+  return query;
+}
+
+TEST(RuleProgramTest, FirstMatchAcrossDimensions) {
+  RuleLists lists;
+  RuleProgram program;
+  program.AddRule("port", "27000-27050", RouteAction::kDirect, lists);
+  program.AddRule("domain", "domain:example.com", RouteAction::kBlock, lists);
+  program.AddRule("ip", "10.0.0.0/8", RouteAction::kProxy, lists);
+  program.AddRule("default", "", RouteAction::kProxy, lists);
+  program.Build();
+
+  RouteQuery query = DomainQuery("www.example.com");
+  query.family = 4;
+  query.ipv4 = 0x0A000001;
+  EXPECT_EQ(program.Evaluate(query).rule, 1u);
+  query.port = 27010;
+  EXPECT_EQ(program.Evaluate(query).action, RouteAction::kDirect);
+  query.domain = nullptr;
+  query.port = 443;
+  EXPECT_EQ(program.Evaluate(query).rule, 2u);
+  EXPECT_EQ(program.Evaluate(RouteQuery()).rule, 3u);
+}
+
+// Правило 'default' проверяется последним, перед ним - UDP напрямую при
+// выключенном udpSupport
+TEST(RuleProgramTest, DefaultIsLastAndUdpSupport) {
+  RuleLists lists;
+  RuleProgram program;
+  program.AddRule("default", "", RouteAction::kProxy, lists);
+  program.AddRule("protocol", "bittorrent", RouteAction::kBlock, lists);
+  program.set_udp_support(false);
+  program.Build();
+
+  RouteQuery query;
+  query.protocols = kRouteProtocolBittorrent | kRouteProtocolUdp;
+  EXPECT_EQ(program.Evaluate(query).action, RouteAction::kBlock);
+  query.protocols = kRouteProtocolUdp;
+  EXPECT_EQ(program.Evaluate(query).action, RouteAction::kDirect);
+  EXPECT_EQ(program.Evaluate(query).rule, kNoRule);
+  query.protocols = kRouteProtocolTcp;
+  EXPECT_EQ(program.Evaluate(query).rule, 0u);
+}
+
+// Процесс сравнивается по имени файла без учета регистра и каталога
+TEST(RuleProgramTest, ProcessRulesMatchBaseName) {
+  RuleLists lists;
+  RuleProgram program;
+  EXPECT_FALSE(program.has_process_rules());
+  program.AddRule("process", "C:\\Games\\Steam.exe", RouteAction::kDirect, lists);
+  program.AddRule("process", "qbittorrent.exe", RouteAction::kBlock, lists);
+  program.AddRule("process", "steam.exe", RouteAction::kProxy, lists);
+  program.Build();
+  EXPECT_TRUE(program.has_process_rules());
+
+  RouteQuery query;
+  const char kSteam[] = "D:/Program Files/STEAM.EXE";
+  query.process = kSteam;
+  query.process_length = sizeof(kSteam) - 1;
+  EXPECT_EQ(program.Evaluate(query).rule, 0u);
+  const char kTorrent[] = "C:\\Users\\me\\AppData\\qBittorrent.exe";
+  query.process = kTorrent;
+  query.process_length = sizeof(kTorrent) - 1;
+  EXPECT_EQ(program.Evaluate(query).action, RouteAction::kBlock);
+  query.process = "steam";
+  query.process_length = 5;
+  EXPECT_EQ(program.Evaluate(query).rule, kNoRule);
+}
+
+TEST(RuleProgramTest, UnsupportedRulesKeepTheirNumber) {
+  RuleLists lists;
+  RuleProgram program;
+  EXPECT_FALSE(program.AddRule("domain", "regexp:.*", RouteAction::kBlock, lists));
+  EXPECT_FALSE(program.AddRule("domain", "geosite:unknown", RouteAction::kBlock, lists));
+  EXPECT_FALSE(program.AddRule("port", "70000", RouteAction::kBlock, lists));
+  EXPECT_TRUE(program.AddRule("domain", "full:a.com", RouteAction::kDirect, lists));
+  program.Build();
+  EXPECT_EQ(program.unsupported_count(), 3u);
+  EXPECT_EQ(program.Evaluate(DomainQuery("A.com")).rule, 3u);
+}
+
+TEST(RuleProgramTest, CompilesProfileJson) {
+  RuleLists lists;
+  lists.SetGeosite("ads", "doubleclick.net\nfull:ads.example.com\n# comment\n");
+  const char kProfile[] = R"({
+    "name": "Test", "udpSupport": true, "extra": [1, {"x": null}],
+    "rules": [
+      {"type": "ip", "value": "geoip:private", "action": "direct", "enabled": true},
+      {"type": "domain", "value": "geosite:ads", "action": "block"},
+      {"type": "port", "value": "53, 5353", "action": "direct"},
+      {"type": "default", "value": "", "action": "proxy"}
+    ]})";
+  RuleProgram program;
+  ASSERT_TRUE(program.CompileProfile(kProfile, sizeof(kProfile) - 1, lists));
+  EXPECT_EQ(program.rule_count(), 4u);
+  EXPECT_EQ(program.Evaluate(Ipv4Query(0xC0A80101)).action, RouteAction::kDirect);
+  EXPECT_EQ(program.Evaluate(DomainQuery("x.doubleclick.net")).action, RouteAction::kBlock);
+  EXPECT_EQ(program.MatchDomain("ads.example.com", 15).rule, 1u);
+  EXPECT_EQ(program.MatchDomain("x.ads.example.com", 17).rule, kNoRule);
+  RouteQuery dns;
+  dns.port = 5353;
+  EXPECT_EQ(program.Evaluate(dns).rule, 2u);
+  EXPECT_EQ(program.Evaluate(Ipv4Query(0x08080808)).rule, 3u);
+
+  RuleProgram broken;
+  EXPECT_FALSE(broken.CompileProfile("{\"rules\": [", 11, lists));
+}
+
+// Случайные профили: скомпилированная программа и линейный перебор
+// выбирают одно и то же правило
+TEST(RuleProgramTest, MatchesLinearScan) {
+  RuleLists lists;
+  for (uint32_t seed = 1; seed <= 20; seed++) {
+    rule_test::RuleGenerator generator(seed);
+    RuleProgram program;
+    rule_test::LinearRules linear;
+    size_t rule_count = seed * 15;
+    for (size_t i = 0; i < rule_count; i++) {
+      rule_test::RuleGenerator::GeneratedRule rule = generator.NextRule();
+      program.AddRule(rule.type, rule.value, rule.action, lists);
+      linear.Add(rule.type, rule.value, rule.action);
+    }
+    program.set_udp_support(seed % 2 == 0);
+    linear.set_udp_support(seed % 2 == 0);
+    program.Build();
+
+    for (int i = 0; i < 2000; i++) {
+      RouteQuery query = generator.NextQuery();
+      RouteDecision expected = linear.Evaluate(query);
+      RouteDecision actual = program.Evaluate(query);
+      ASSERT_EQ(actual.rule, expected.rule)
+          << "seed " << seed << " domain " << (query.domain ? query.domain : "-")
+          << " port " << query.port << " protocols " << query.protocols;
+      ASSERT_EQ(actual.action, expected.action);
+    }
+  }
+}
+
+}  // namespace
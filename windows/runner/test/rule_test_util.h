@@ -0,0 +1,291 @@
+#ifndef RUNNER_TEST_RULE_TEST_UTIL_H_
+#define RUNNER_TEST_RULE_TEST_UTIL_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "prefix_table.h"
+#include "rule_program.h"
+
+// Эталон для RuleProgram: правила профиля проверяются по одному в порядке
+// списка, как их описывает RoutingProfile. Используется для сверки в тестах
+// и как линейный перебор в бенчмарке.
+namespace rule_test {
+
+inline std::string Lower(const char* text, size_t length) {
+  std::string out(text, length);
+  for (char& c : out) {
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+  }
+  return out;
+}
+
+inline std::string BaseName(const char* path, size_t length) {
+  size_t start = length;
+  while (start > 0 && path[start - 1] != '\\' && path[start - 1] != '/') start--;
+  return Lower(path + start, length - start);
+}
+
+class LinearRules {
+ public:
+  void Add(const std::string& type, const std::string& value, RouteAction action) {
+    Rule rule;
+    rule.type = type;
+    rule.action = action;
+    if (type == "domain") {
+      rule.valid = ParseDomain(value, &rule);
+    } else if (type == "ip") {
+      uint8_t family;
+      rule.valid = PrefixTable::ParseCidr(value.c_str(), rule.address, &rule.prefix_length,
+                                          &family) &&
+                   family == 4;
+    } else if (type == "port") {
+      rule.valid = ParsePorts(value, &rule);
+    } else if (type == "protocol") {
+      rule.valid = ParseProtocol(value, &rule.protocol);
+    } else if (type == "process") {
+      rule.text = BaseName(value.data(), value.size());
+      rule.valid = !rule.text.empty();
+    } else {
+      rule.valid = type == "default";
+    }
+    rule.valid = rule.valid && action != RouteAction::kNone;
+    rules_.push_back(rule);
+  }
+
+  void set_udp_support(bool enabled) { udp_support_ = enabled; }
+
+  RouteDecision Evaluate(const RouteQuery& query) const {
+    uint32_t default_rule = kNoRule;
+    for (uint32_t i = 0; i < rules_.size(); i++) {
+      const Rule& rule = rules_[i];
+      if (!rule.valid) continue;
+      if (rule.type == "default") {
+        if (default_rule == kNoRule) default_rule = i;
+      } else if (Matches(rule, query)) {
+        return Decision(i);
+      }
+    }
+    if (!udp_support_ && (query.protocols & kRouteProtocolUdp)) {
+      RouteDecision decision;
+      decision.action = RouteAction::kDirect;
+      return decision;
+    }
+    return Decision(default_rule);
+  }
+
+  size_t size() const { return rules_.size(); }
+
+ private:
+  struct Rule {
+    std::string type;
+    RouteAction action = RouteAction::kNone;
+    bool valid = false;
+    int domain_kind = 0;  // 0 - full, 1 - суффикс, 2 - подстрока
+    std::string text;
+    uint8_t address[16] = {};
+    uint8_t prefix_length = 0;
+    std::vector<std::pair<uint16_t, uint16_t>> ports;
+    uint32_t protocol = 0;
+  };
+
+  static bool ParseDomain(const std::string& value, Rule* rule) {
+    std::string text = value;
+    rule->domain_kind = 2;
+    if (text.compare(0, 5, "full:") == 0) {
+      rule->domain_kind = 0;
+      text = text.substr(5);
+    } else if (text.compare(0, 7, "domain:") == 0) {
+      rule->domain_kind = 1;
+      text = text.substr(7);
+    } else if (text.compare(0, 8, "keyword:") == 0) {
+      text = text.substr(8);
+    } else if (text.compare(0, 7, "regexp:") == 0) {
+      return false;
+    }
+    rule->text = Lower(text.data(), text.size());
+    return !rule->text.empty();
+  }
+
+  static bool ParsePorts(const std::string& value, Rule* rule) {
+    const char* cursor = value.c_str();
+    while (*cursor != '\0') {
+      char* end;
+      long first = strtol(cursor, &end, 10);
+      if (end == cursor) return false;
+      long last = first;
+      cursor = end;
+      if (*cursor == '-') {
+        last = strtol(cursor + 1, &end, 10);
+        cursor = end;
+      }
+      while (*cursor == ' ' || *cursor == ',') cursor++;
+      if (first < 0 || last > 65535 || first > last) return false;
+      rule->ports.emplace_back((uint16_t)first, (uint16_t)last);
+    }
+    return !rule->ports.empty();
+  }
+
+  static bool ParseProtocol(const std::string& value, uint32_t* protocol) {
+    static const char* const kNames[] = {"tcp", "udp", "http", "tls", "quic", "bittorrent"};
+    for (uint32_t i = 0; i < 6; i++) {
+      if (value == kNames[i]) {
+        *protocol = 1u << i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool Matches(const Rule& rule, const RouteQuery& query) {
+    if (rule.type == "domain") {
+      if (query.domain == nullptr || query.domain_length == 0) return false;
+      std::string name = Lower(query.domain, query.domain_length);
+      if (rule.domain_kind == 0) return name == rule.text;
+      if (rule.domain_kind == 1) {
+        return name == rule.text ||
+               (name.size() > rule.text.size() &&
+                name.compare(name.size() - rule.text.size(), rule.text.size(), rule.text) == 0 &&
+                name[name.size() - rule.text.size() - 1] == '.');
+      }
+      return name.find(rule.text) != std::string::npos;
+    }
+    if (rule.type == "ip") {
+      if (query.family != 4) return false;
+      uint32_t prefix = ((uint32_t)rule.address[0] << 24) | ((uint32_t)rule.address[1] << 16) |
+                        ((uint32_t)rule.address[2] << 8) | rule.address[3];
+      uint32_t mask = rule.prefix_length == 0 ? 0 : 0xFFFFFFFFu << (32 - rule.prefix_length);
+      return (query.ipv4 & mask) == prefix;
+    }
+    if (rule.type == "port") {
+      if (query.port == 0) return false;
+      for (const auto& range : rule.ports) {
+        if (query.port >= range.first && query.port <= range.second) return true;
+      }
+      return false;
+    }
+    if (rule.type == "protocol") {
+      return (query.protocols & rule.protocol) != 0;
+    }
+    if (rule.type == "process") {
+      return query.process != nullptr && query.process_length > 0 &&
+             BaseName(query.process, query.process_length) == rule.text;
+    }
+    return false;
+  }
+
+  RouteDecision Decision(uint32_t rule) const {
+    RouteDecision decision;
+    if (rule != kNoRule) {
+      decision.action = rules_[rule].action;
+      decision.rule = rule;
+    }
+    return decision;
+  }
+
+  std::vector<Rule> rules_;
+  bool udp_support_ = true;
+};
+
+// Случайные профили и запросы из небольших пулов, чтобы правила разных
+// измерений часто совпадали с одним запросом
+class RuleGenerator {
+ public:
+  explicit RuleGenerator(uint32_t seed) : random_(seed) {}
+
+  struct GeneratedRule {
+    std::string type;
+    std::string value;
+    RouteAction action;
+  };
+
+  GeneratedRule NextRule() {
+    static const char* const kTypes[] = {"domain", "domain", "ip", "port",
+                                         "protocol", "process", "default"};
+    static const char* const kDomainPrefixes[] = {"full:", "domain:", "keyword:", ""};
+    static const char* const kProtocols[] = {"tcp", "udp", "http", "tls", "quic", "bittorrent"};
+    GeneratedRule rule;
+    rule.type = kTypes[Uniform(7)];
+    rule.action = (RouteAction)(1 + Uniform(3));
+    if (rule.type == "domain") {
+      std::string name = Domain();
+      const char* prefix = kDomainPrefixes[Uniform(4)];
+      if (prefix[0] == 'k' || prefix[0] == '\0') {
+        size_t start = Uniform((uint32_t)name.size() - 2);
+        name = name.substr(start, 2 + Uniform(4));
+      } else if (prefix[0] == 'd') {
+        size_t dot = name.find('.');
+        if (dot != std::string::npos && Uniform(2) == 0) name = name.substr(dot + 1);
+      }
+      rule.value = prefix + name;
+    } else if (rule.type == "ip") {
+      uint32_t length = 8 + Uniform(25);
+      rule.value = "10." + std::to_string(Uniform(4)) + "." + std::to_string(Uniform(4)) + "." +
+                   std::to_string(Uniform(256)) + "/" + std::to_string(length);
+      // ParseCidr сам обнуляет биты за префиксом
+    } else if (rule.type == "port") {
+      uint32_t first = 1 + Uniform(2000);
+      rule.value = std::to_string(first);
+      if (Uniform(2)) rule.value += "-" + std::to_string(first + Uniform(100));
+      if (Uniform(3) == 0) rule.value += "," + std::to_string(1 + Uniform(2000));
+    } else if (rule.type == "protocol") {
+      rule.value = kProtocols[Uniform(6)];
+    } else if (rule.type == "process") {
+      rule.value = Process();
+    }
+    return rule;
+  }
+
+  // Поля запроса ссылаются на строки генератора и живут до следующего вызова
+  RouteQuery NextQuery() {
+    RouteQuery query;
+    if (Uniform(4) != 0) {
+      domain_ = Domain();
+      query.domain = domain_.c_str();
+      query.domain_length = domain_.size();
+    }
+    if (Uniform(4) != 0) {
+      query.family = 4;
+      query.ipv4 = (10u << 24) | (Uniform(4) << 16) | (Uniform(4) << 8) | Uniform(256);
+    }
+    query.port = (uint16_t)(Uniform(5) == 0 ? 0 : 1 + Uniform(2200));
+    query.protocols = Uniform(64);
+    if (Uniform(3) != 0) {
+      process_ = Process();
+      query.process = process_.c_str();
+      query.process_length = process_.size();
+    }
+    return query;
+  }
+
+ private:
+  uint32_t Uniform(uint32_t bound) { return (uint32_t)(random_() % bound); }
+
+  std::string Domain() {
+    static const char* const kNames[] = {
+        "www.google.com", "mail.google.com", "google.com",  "cdn.example.com",
+        "example.com",    "video.cdn.net",   "tracker.org", "api.github.com",
+        "GitHub.com",     "a.b.c.d.example.com"};
+    return kNames[Uniform(10)];
+  }
+
+  std::string Process() {
+    static const char* const kProcesses[] = {
+        "chrome.exe", "C:\\Program Files\\Google\\Chrome.EXE", "qbittorrent.exe",
+        "D:/Games/game.exe", "steam.exe", "Telegram.exe"};
+    return kProcesses[Uniform(6)];
+  }
+
+  std::mt19937 random_;
+  std::string domain_;
+  std::string process_;
+};
+
+}  // namespace rule_test
+
+#endif  // RUNNER_TEST_RULE_TEST_UTIL_H_
@@ -0,0 +1,177 @@
+#include "server_config.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alloc_test_util.h"
+#include "server_block.h"
+#include "subscription_parser.h"
+
+namespace {
+
+constexpr size_t kServers = 10000;
+
+// Блок разбора подписки на 10 тыс. серверов: vless с Reality, vless с
+// WebSocket и trojan; значения параметров у серверов одного вида общие
+struct Subscription {
+  SubscriptionParser parser;
+  std::vector<int32_t> block;
+  ServerBlockView view;
+
+  Subscription() {
+    std::mt19937 random(5);
+    std::string body;
+    for (size_t i = 0; i < kServers; i++) {
+      std::string host = "node" + std::to_string(i) + ".provider-" +
+                         std::to_string(random() % 40) + ".example.com";
+      std::string uuid = "b831381d-6324-4d53-ad4f-" + std::to_string(100000000000ull + i);
+      switch (random() % 3) {
+        case 0:
+          body += "vless://" + uuid + "@" + host +
+                  ":443?encryption=none&flow=xtls-rprx-vision&security=reality"
+                  "&sni=www.microsoft.com&fp=chrome&pbk=SbVKOEMjK0sIlbwg4akyBg5mL5KZwwB-ed4eEE7YnRc"
+                  "&sid=6ba85179e30d4fc2&type=tcp#Germany%20" + std::to_string(i) + "\n";
+          break;
+        case 1:
+          body += "vless://" + uuid + "@" + host + ":443?type=ws&security=tls&path=%2Fws&host=" +
+                  host + "#WS%20" + std::to_string(i) + "\n";
+          break;
+        default:
+          body += "trojan://password" + std::to_string(i) + "@" + host + ":443?security=tls&sni=" +
+                  host + "&type=tcp#Trojan%20" + std::to_string(i) + "\n";
+          break;
+      }
+    }
+    parser.Feed(body.data(), body.size());
+    parser.Finish();
+    EncodeServerBlock(parser.entries(), parser.params(), parser.text(), 0, &block);
+    DecodeServerBlock(block.data(), block.size(), &view);
+  }
+};
+
+const Subscription& Servers() {
+  static const Subscription* subscription = new Subscription();
+  return *subscription;
+}
+
+// Прежняя форма - как VpnConfig в Dart: строки и Map параметров на сервер
+struct MapConfig {
+  int protocol;
+  int port;
+  std::string id;
+  std::string address;
+  std::string tag;
+  std::map<std::string, std::string> params;
+};
+
+void ToMaps(const ServerBlockView& view, std::vector<MapConfig>* configs) {
+  configs->clear();
+  configs->reserve(view.count);
+  for (size_t i = 0; i < view.count; i++) {
+    const int32_t* record = view.records + i * SUBSCRIPTION_RECORD_FIELDS;
+    MapConfig config;
+    config.protocol = record[SUBSCRIPTION_PROTOCOL];
+    config.port = record[SUBSCRIPTION_PORT];
+    config.id.assign(view.text + record[SUBSCRIPTION_ID_OFFSET], record[SUBSCRIPTION_ID_LENGTH]);
+    config.address.assign(view.text + record[SUBSCRIPTION_ADDRESS_OFFSET],
+                          record[SUBSCRIPTION_ADDRESS_LENGTH]);
+    config.tag.assign(view.text + record[SUBSCRIPTION_TAG_OFFSET],
+                      record[SUBSCRIPTION_TAG_LENGTH]);
+    const int32_t* param = view.params + (size_t)record[SUBSCRIPTION_FIRST_PARAM] * 4;
+    for (int32_t p = 0; p < record[SUBSCRIPTION_PARAM_COUNT]; p++, param += 4) {
+      config.params[std::string(view.text + param[0], param[1])] =
+          std::string(view.text + param[2], param[3]);
+    }
+    configs->push_back(std::move(config));
+  }
+}
+
+// Параметры, которые генератор читает у каждого сервера
+const ConfigParam kReads[] = {ConfigParam::kType, ConfigParam::kSecurity, ConfigParam::kSni,
+                              ConfigParam::kHost, ConfigParam::kPath, ConfigParam::kFlow,
+                              ConfigParam::kFingerprint, ConfigParam::kPublicKey,
+                              ConfigParam::kShortId};
+
+// Перевод блока в набор. Аргумент: 0 - новый набор, 1 - повторное
+// заполнение после Clear()
+void BM_BuildConfigSet(benchmark::State& state) {
+  const ServerBlockView& view = Servers().view;
+  ServerConfigSet set;
+  size_t allocations = 0;
+  for (auto _ : state) {
+    size_t before = alloc_test::Allocations();
+    if (state.range(0) == 0) {
+      ServerConfigSet fresh;
+      fresh.Append(view);
+      benchmark::DoNotOptimize(fresh.size());
+    } else {
+      set.Clear();
+      set.Append(view);
+      benchmark::DoNotOptimize(set.size());
+    }
+    allocations = alloc_test::Allocations() - before;
+  }
+  ServerConfigSet sized;
+  sized.Append(view);
+  state.counters["allocations"] = (double)allocations;
+  state.counters["arena_kb"] = (double)sized.arena().text_size() / 1024;
+  state.counters["block_text_kb"] = (double)view.text_length / 1024;
+}
+BENCHMARK(BM_BuildConfigSet)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+void BM_BuildMaps(benchmark::State& state) {
+  const ServerBlockView& view = Servers().view;
+  size_t allocations = 0;
+  for (auto _ : state) {
+    std::vector<MapConfig> configs;
+    size_t before = alloc_test::Allocations();
+    ToMaps(view, &configs);
+    allocations = alloc_test::Allocations() - before;
+    benchmark::DoNotOptimize(configs.data());
+  }
+  state.counters["allocations"] = (double)allocations;
+}
+BENCHMARK(BM_BuildMaps)->Unit(benchmark::kMillisecond);
+
+// Чтение параметров генератором по всем серверам
+void BM_ReadParams(benchmark::State& state) {
+  ServerConfigSet set;
+  set.Append(Servers().view);
+  for (auto _ : state) {
+    size_t found = 0;
+    for (size_t i = 0; i < set.size(); i++) {
+      for (ConfigParam param : kReads) {
+        TextSpan value;
+        found += set.Find(set[i], param, &value) ? value.length : 0;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * set.size() * 9));
+}
+BENCHMARK(BM_ReadParams)->Unit(benchmark::kMillisecond);
+
+void BM_ReadMapParams(benchmark::State& state) {
+  std::vector<MapConfig> configs;
+  ToMaps(Servers().view, &configs);
+  std::vector<std::string> names;
+  for (ConfigParam param : kReads) names.push_back(ConfigParamName(param));
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const MapConfig& config : configs) {
+      for (const std::string& name : names) {
+        auto it = config.params.find(name);
+        found += it != config.params.end() ? it->second.size() : 0;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * configs.size() * 9));
+}
+BENCHMARK(BM_ReadMapParams)->Unit(benchmark::kMillisecond);
+
+}  // namespace
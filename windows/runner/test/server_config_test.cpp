@@ -0,0 +1,178 @@
+#include "server_config.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "alloc_test_util.h"
+#include "server_block.h"
+#include "subscription_parser.h"
+
+namespace {
+
+std::string Text(const ServerConfigSet& set, TextSpan span) {
+  return std::string(set.text() + span.offset, span.length);
+}
+
+// Значение параметра или "<none>", если его нет
+std::string Param(const ServerConfigSet& set, size_t index, ConfigParam param) {
+  TextSpan value;
+  return set.Find(set[index], param, &value) ? Text(set, value) : "<none>";
+}
+
+std::string Extra(const ServerConfigSet& set, size_t index, const char* name) {
+  TextSpan value;
+  return set.FindExtra(set[index], name, strlen(name), &value) ? Text(set, value) : "<none>";
+}
+
+struct Parsed {
+  SubscriptionParser parser;
+
+  explicit Parsed(const std::string& body) {
+    parser.Feed(body.data(), body.size());
+    parser.Finish();
+  }
+};
+
+const char kLines[] =
+    "vless://uuid-1@one.example:443?type=ws&security=tls&sni=&path=%2Fws&x-custom=1"
+    "&type=grpc&x-custom=2&serviceName=svc#One\n"
+    "trojan://password@two.example:8443?sni=two.example&allowInsecure=1&SNI=upper#Two\n"
+    "vless://uuid-1@three.example:443?type=ws&security=tls&path=%2Fws&x-custom=1#Three\n";
+
+TEST(ServerConfigTest, ParamNamesRoundTrip) {
+  for (size_t i = 0; i < kConfigParamCount; i++) {
+    const char* name = ConfigParamName((ConfigParam)i);
+    ConfigParam param;
+    ASSERT_TRUE(FindConfigParam(name, strlen(name), &param)) << name;
+    EXPECT_EQ((size_t)param, i) << name;
+  }
+  ConfigParam param;
+  EXPECT_FALSE(FindConfigParam("SNI", 3, &param));
+  EXPECT_FALSE(FindConfigParam("", 0, &param));
+  EXPECT_FALSE(FindConfigParam("allowInsecureX", 14, &param));
+  EXPECT_FALSE(FindConfigParam("servicename", 11, &param));
+  EXPECT_TRUE(FindConfigParam("fp", 2, &param));
+  EXPECT_EQ(param, ConfigParam::kFingerprint);
+  EXPECT_STREQ(ConfigParamName(ConfigParam::kCount), "");
+}
+
+TEST(ServerConfigTest, ArenaInternsEachStringOnce) {
+  StringArena arena;
+  TextSpan a = arena.Intern("example.com", 11);
+  TextSpan b = arena.Intern("example.org", 11);
+  EXPECT_EQ(arena.Intern("example.com", 11).offset, a.offset);
+  EXPECT_NE(a.offset, b.offset);
+  EXPECT_EQ(arena.Intern("", 0).length, 0u);
+  EXPECT_EQ(arena.unique_count(), 2u);
+  EXPECT_EQ(arena.text_size(), 22u);
+
+  // Рост таблицы далеко за начальные 1024 слота
+  std::vector<TextSpan> spans;
+  for (int i = 0; i < 50000; i++) {
+    std::string value = "server-" + std::to_string(i);
+    spans.push_back(arena.Intern(value.data(), value.size()));
+  }
+  for (int i = 0; i < 50000; i++) {
+    std::string value = "server-" + std::to_string(i);
+    TextSpan span = arena.Intern(value.data(), value.size());
+    ASSERT_EQ(span.offset, spans[i].offset) << i;
+    ASSERT_EQ(std::string(arena.text() + span.offset, span.length), value);
+  }
+  EXPECT_EQ(arena.unique_count(), 50002u);
+
+  arena.Clear();
+  EXPECT_EQ(arena.unique_count(), 0u);
+  EXPECT_EQ(arena.text_size(), 0u);
+  EXPECT_EQ(arena.Intern("example.org", 11).offset, 0u);
+}
+
+// Пустое значение отличается от отсутствия; повтор ключа - последнее
+// значение; регистр ключа важен
+TEST(ServerConfigTest, KnownAndExtraParams) {
+  Parsed parsed(kLines);
+  ServerConfigSet set;
+  set.Append(parsed.parser.entries(), parsed.parser.params(), parsed.parser.text().data());
+  ASSERT_EQ(set.size(), 3u);
+
+  EXPECT_EQ(set[0].protocol, SubscriptionProtocol::kVless);
+  EXPECT_EQ(set[0].port, 443);
+  EXPECT_EQ(Text(set, set[0].id), "uuid-1");
+  EXPECT_EQ(Text(set, set[0].address), "one.example");
+  EXPECT_EQ(Text(set, set[0].tag), "One");
+  EXPECT_EQ(Param(set, 0, ConfigParam::kType), "grpc");
+  EXPECT_EQ(Param(set, 0, ConfigParam::kSni), "");
+  EXPECT_TRUE(set[0].Has(ConfigParam::kSni));
+  EXPECT_EQ(Param(set, 0, ConfigParam::kPath), "/ws");
+  EXPECT_EQ(Param(set, 0, ConfigParam::kServiceName), "svc");
+  EXPECT_EQ(Param(set, 0, ConfigParam::kHost), "<none>");
+  EXPECT_EQ(Extra(set, 0, "x-custom"), "2");
+  EXPECT_EQ(set[0].extra_count, 1u);
+
+  EXPECT_EQ(set[1].protocol, SubscriptionProtocol::kTrojan);
+  EXPECT_EQ(Param(set, 1, ConfigParam::kSni), "two.example");
+  EXPECT_EQ(Param(set, 1, ConfigParam::kAllowInsecure), "1");
+  EXPECT_EQ(Extra(set, 1, "SNI"), "upper");
+  EXPECT_EQ(Extra(set, 1, "x-custom"), "<none>");
+
+  // Одинаковые строки разных серверов - один спан арены
+  EXPECT_EQ(set[2].id.offset, set[0].id.offset);
+  EXPECT_EQ(set[2].known[(size_t)ConfigParam::kPath].offset,
+            set[0].known[(size_t)ConfigParam::kPath].offset);
+  EXPECT_EQ(Extra(set, 2, "x-custom"), "1");
+}
+
+// Блок (результат разбора, вид хранилища) дает тот же набор, что и список
+TEST(ServerConfigTest, BlockMatchesEntries) {
+  Parsed parsed(kLines);
+  std::vector<int32_t> block;
+  EncodeServerBlock(parsed.parser.entries(), parsed.parser.params(), parsed.parser.text(), 0,
+                    &block);
+  ServerBlockView view;
+  ASSERT_TRUE(DecodeServerBlock(block.data(), block.size(), &view));
+
+  ServerConfigSet from_entries;
+  from_entries.Append(parsed.parser.entries(), parsed.parser.params(),
+                      parsed.parser.text().data());
+  ServerConfigSet from_block;
+  from_block.Append(view);
+  ASSERT_EQ(from_block.size(), from_entries.size());
+  EXPECT_EQ(std::string(from_block.text(), from_block.arena().text_size()),
+            std::string(from_entries.text(), from_entries.arena().text_size()));
+  for (size_t i = 0; i < from_block.size(); i++) {
+    const ServerConfig& a = from_block[i];
+    const ServerConfig& b = from_entries[i];
+    EXPECT_EQ(a.present, b.present);
+    EXPECT_EQ(a.extra_count, b.extra_count);
+    for (size_t p = 0; p < kConfigParamCount; p++) {
+      EXPECT_EQ(Param(from_block, i, (ConfigParam)p), Param(from_entries, i, (ConfigParam)p));
+    }
+  }
+  EXPECT_EQ(Extra(from_block, 0, "x-custom"), "2");
+}
+
+// Повторное заполнение после Clear() не выделяет память
+TEST(ServerConfigTest, RefillAfterClearDoesNotAllocate) {
+  std::string body;
+  for (int i = 0; i < 2000; i++) {
+    body += "vless://id-" + std::to_string(i) + "@host" + std::to_string(i) +
+            ".example:443?type=ws&security=tls&path=%2Fws&x-" + std::to_string(i % 7) + "=v#S" +
+            std::to_string(i) + "\n";
+  }
+  Parsed parsed(body);
+  ServerConfigSet set;
+  set.Append(parsed.parser.entries(), parsed.parser.params(), parsed.parser.text().data());
+  ASSERT_EQ(set.size(), 2000u);
+
+  size_t before = alloc_test::Allocations();
+  set.Clear();
+  set.Append(parsed.parser.entries(), parsed.parser.params(), parsed.parser.text().data());
+  EXPECT_EQ(alloc_test::Allocations() - before, 0u);
+  ASSERT_EQ(set.size(), 2000u);
+  EXPECT_EQ(Text(set, set[1999].address), "host1999.example");
+  EXPECT_EQ(Extra(set, 1999, "x-4"), "v");
+}
+
+}  // namespace
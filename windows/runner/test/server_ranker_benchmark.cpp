@@ -0,0 +1,152 @@
+#include "server_ranker.h"
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kTargets = 500;
+constexpr size_t kServers = 8;
+// Каждый десятый сервер - TLS, каждый двадцать пятый - закрытый порт
+constexpr size_t kTlsEvery = 10;
+constexpr size_t kClosedEvery = 25;
+// "Несколько секунд" на 500 серверов по 3 попытки и "не поток на сервер"
+constexpr double kMaxSeconds = 5.0;
+constexpr int kMaxExtraThreads = 32;
+
+// Сервер на 127.0.0.1: принимает соединения и закрывает их; с |tls|
+// сначала отвечает ServerHello на первую запись клиента
+class DrainServer {
+ public:
+  explicit DrainServer(bool tls) : tls_(tls) {
+    listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = socket_test::Loopback(0);
+    bind(listener_, (sockaddr*)&address, sizeof(address));
+    listen(listener_, SOMAXCONN);
+    port_ = socket_test::LocalPort(listener_);
+    thread_ = std::thread([this] { AcceptLoop(); });
+  }
+
+  ~DrainServer() {
+    shutdown(listener_, SHUT_RDWR);
+    close(listener_);
+    thread_.join();
+  }
+
+  uint16_t port() const { return port_; }
+
+ private:
+  void AcceptLoop() {
+    static const char kServerHello[] = "\x16\x03\x03\x00\x04\x02\x00\x00\x00";
+    for (;;) {
+      int client = accept(listener_, nullptr, nullptr);
+      if (client < 0) return;
+      if (tls_) {
+        socket_test::SetReceiveTimeout(client, 2000);
+        char buffer[1024];
+        if (socket_test::Receive(client, buffer, sizeof(buffer)) > 0) {
+          socket_test::SendAll(client, kServerHello, sizeof(kServerHello) - 1);
+        }
+      }
+      close(client);
+    }
+  }
+
+  bool tls_;
+  int listener_;
+  uint16_t port_;
+  std::thread thread_;
+};
+
+uint16_t ClosedPort() {
+  int probe = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  bind(probe, (sockaddr*)&address, sizeof(address));
+  uint16_t port = socket_test::LocalPort(probe);
+  close(probe);
+  return port;
+}
+
+int ThreadCount() {
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status == nullptr) return 0;
+  char line[256];
+  int threads = 0;
+  while (fgets(line, sizeof(line), status) != nullptr) {
+    if (sscanf(line, "Threads: %d", &threads) == 1) break;
+  }
+  fclose(status);
+  return threads;
+}
+
+// 500 серверов подписки на восьми портах 127.0.0.1, как после обновления
+// большой подписки: один поток оценки и пул разрешения имен вместо потока
+// на сервер
+void BM_Rank500(benchmark::State& state) {
+  std::vector<std::unique_ptr<DrainServer>> plain;
+  std::vector<std::unique_ptr<DrainServer>> tls;
+  for (size_t i = 0; i < kServers; i++) {
+    plain.emplace_back(new DrainServer(false));
+    tls.emplace_back(new DrainServer(true));
+  }
+  uint16_t closed = ClosedPort();
+  std::vector<RankTarget> targets(kTargets);
+  for (size_t i = 0; i < kTargets; i++) {
+    RankTarget& target = targets[i];
+    target.host = "127.0.0.1";
+    target.tls = i % kTlsEvery == 0;
+    target.sni = "server" + std::to_string(i) + ".example.com";
+    target.port = i % kClosedEvery == 1
+                      ? closed
+                      : (target.tls ? tls[i % kServers] : plain[i % kServers])->port();
+  }
+
+  ServerRanker ranker;
+  ServerRanker::Options options;
+  const int base_threads = ThreadCount();
+  int peak_threads = base_threads;
+  double seconds = 0;
+  size_t reachable = 0;
+  for (auto _ : state) {
+    Clock::time_point start = Clock::now();
+    if (!ranker.Start(targets, options, nullptr)) {
+      state.SkipWithError("ServerRanker::Start failed");
+      return;
+    }
+    while (ranker.IsRunning()) {
+      int threads = ThreadCount();
+      if (threads > peak_threads) peak_threads = threads;
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    reachable = 0;
+    for (const RankResult& result : ranker.Results()) {
+      reachable += result.score != RankResult::kUnreachable;
+    }
+  }
+  state.counters["servers"] = (double)kTargets;
+  state.counters["reachable"] = (double)reachable;
+  state.counters["seconds"] = seconds;
+  state.counters["extra_threads"] = (double)(peak_threads - base_threads);
+  state.SetItemsProcessed((int64_t)(state.iterations() * kTargets));
+  if (seconds > kMaxSeconds) {
+    state.SkipWithError("500 servers took longer than kMaxSeconds");
+  } else if (peak_threads - base_threads > kMaxExtraThreads) {
+    state.SkipWithError("ranking spawned a thread per server");
+  }
+}
+BENCHMARK(BM_Rank500)->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+
+}  // namespace
@@ -0,0 +1,334 @@
+#include "server_ranker.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ranking_helper.h"
+#include "socket_test_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Слушатель на 127.0.0.1: connect() завершается без accept()
+class Listener {
+ public:
+  Listener() : socket_(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in address = socket_test::Loopback(0);
+    bind(socket_, (sockaddr*)&address, sizeof(address));
+    listen(socket_, SOMAXCONN);
+  }
+  ~Listener() { close(socket_); }
+
+  uint16_t port() const { return socket_test::LocalPort(socket_); }
+
+ private:
+  int socket_;
+};
+
+// Сервер, отвечающий на первую запись TLS: |reply| - первые байты ответа
+// (ServerHello, alert или не TLS). Запоминает полученные ClientHello.
+class FakeTlsServer {
+ public:
+  explicit FakeTlsServer(std::string reply) : reply_(std::move(reply)) {
+    listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = socket_test::Loopback(0);
+    bind(listener_, (sockaddr*)&address, sizeof(address));
+    listen(listener_, SOMAXCONN);
+    port_ = socket_test::LocalPort(listener_);
+    thread_ = std::thread([this] { AcceptLoop(); });
+  }
+
+  ~FakeTlsServer() {
+    shutdown(listener_, SHUT_RDWR);
+    close(listener_);
+    thread_.join();
+  }
+
+  uint16_t port() const { return port_; }
+
+  std::vector<std::string> hellos() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hellos_;
+  }
+
+ private:
+  void AcceptLoop() {
+    for (;;) {
+      int client = accept(listener_, nullptr, nullptr);
+      if (client < 0) return;
+      socket_test::SetReceiveTimeout(client, 2000);
+      uint8_t header[5];
+      if (socket_test::ReceiveAll(client, header, sizeof(header))) {
+        std::string record((const char*)header, sizeof(header));
+        record.resize(sizeof(header) + ((size_t)header[3] << 8 | header[4]));
+        if (socket_test::ReceiveAll(client, &record[sizeof(header)],
+                                    record.size() - sizeof(header))) {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            hellos_.push_back(record);
+          }
+          socket_test::SendAll(client, reply_.data(), reply_.size());
+        }
+      }
+      close(client);
+    }
+  }
+
+  std::string reply_;
+  int listener_;
+  uint16_t port_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::vector<std::string> hellos_;
+};
+
+const std::string kServerHello("\x16\x03\x03\x00\x04\x02\x00\x00\x00", 9);
+const std::string kAlert("\x15\x03\x03\x00\x02\x02\x28", 7);
+
+// Порт, на котором никто не слушает: connect() получает RST
+uint16_t ClosedPort() {
+  int probe = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = socket_test::Loopback(0);
+  bind(probe, (sockaddr*)&address, sizeof(address));
+  uint16_t port = socket_test::LocalPort(probe);
+  close(probe);
+  return port;
+}
+
+RankTarget Target(const std::string& host, uint16_t port, bool tls = false,
+                  const std::string& sni = "") {
+  RankTarget target;
+  target.host = host;
+  target.port = port;
+  target.tls = tls;
+  target.sni = sni;
+  return target;
+}
+
+bool WaitFor(const std::function<bool()>& done, int seconds = 10) {
+  Clock::time_point deadline = Clock::now() + std::chrono::seconds(seconds);
+  while (!done()) {
+    if (Clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+const RankResult* FindResult(const std::vector<RankResult>& results, size_t index) {
+  for (const RankResult& result : results) {
+    if (result.index == index) return &result;
+  }
+  return nullptr;
+}
+
+ServerRanker::Options FastOptions() {
+  ServerRanker::Options options;
+  options.attempts = 3;
+  options.timeout_ms = 1000;
+  options.resolver_threads = 2;
+  return options;
+}
+
+// Доступный сервер: все попытки удачны, TLS не мерялся
+TEST(ServerRankerTest, PlainListener) {
+  Listener listener;
+  ServerRanker ranker;
+  std::atomic<int> callbacks{0};
+  ASSERT_TRUE(ranker.Start({Target("127.0.0.1", listener.port())}, FastOptions(),
+                           [&](const RankResult&) { callbacks++; }));
+  ASSERT_TRUE(WaitFor([&] { return !ranker.IsRunning(); }));
+  std::vector<RankResult> results = ranker.Results();
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].index, 0u);
+  EXPECT_EQ(results[0].attempts, 3u);
+  EXPECT_EQ(results[0].successes, 3u);
+  EXPECT_EQ(results[0].tls_us, 0u);
+  EXPECT_LT(results[0].score, RankResult::kUnreachable);
+  EXPECT_EQ(callbacks.load(), 1);
+  EXPECT_EQ(ranker.completed(), 1u);
+  EXPECT_EQ(ranker.total(), 1u);
+}
+
+// TLS: ClientHello с SNI (по умолчанию - имя сервера, для IP-литерала -
+// без SNI), ответом считаются и ServerHello, и alert; ответ не TLS -
+// неудача
+TEST(ServerRankerTest, FakeTlsServers) {
+  FakeTlsServer hello(kServerHello);
+  FakeTlsServer alert(kAlert);
+  FakeTlsServer http("HTTP/1.1 400 Bad Request\r\n\r\n");
+  ServerRanker ranker;
+  ServerRanker::Options options = FastOptions();
+  options.attempts = 2;
+  ASSERT_TRUE(ranker.Start({Target("127.0.0.1", hello.port(), true, "cdn.example.com"),
+                            Target("127.0.0.1", alert.port(), true),
+                            Target("localhost", http.port(), true)},
+                           options, nullptr));
+  ASSERT_TRUE(WaitFor([&] { return !ranker.IsRunning(); }));
+  std::vector<RankResult> results = ranker.Results();
+  ASSERT_EQ(results.size(), 3u);
+
+  const RankResult* with_hello = FindResult(results, 0);
+  ASSERT_NE(with_hello, nullptr);
+  EXPECT_EQ(with_hello->successes, 2u);
+  EXPECT_GT(with_hello->tls_us, 0u);
+  const RankResult* with_alert = FindResult(results, 1);
+  ASSERT_NE(with_alert, nullptr);
+  EXPECT_EQ(with_alert->successes, 2u);
+  const RankResult* with_http = FindResult(results, 2);
+  ASSERT_NE(with_http, nullptr);
+  EXPECT_EQ(with_http->successes, 0u);
+  EXPECT_EQ(with_http->score, RankResult::kUnreachable);
+
+  std::vector<std::string> hellos = hello.hellos();
+  ASSERT_EQ(hellos.size(), 2u);
+  EXPECT_EQ(hellos[0][0], 0x16);
+  EXPECT_EQ(hellos[0][5], 0x01);  // ClientHello
+  EXPECT_NE(hellos[0].find("cdn.example.com"), std::string::npos);
+  // Случайные поля не повторяются
+  EXPECT_NE(hellos[0], hellos[1]);
+  ASSERT_FALSE(alert.hellos().empty());
+  EXPECT_EQ(alert.hellos()[0].find("127.0.0.1"), std::string::npos);
+  ASSERT_FALSE(http.hellos().empty());
+  EXPECT_NE(http.hellos()[0].find("localhost"), std::string::npos);
+}
+
+// Отказ в соединении и неразрешимое имя: сервер недоступен, лишние
+// попытки не тратятся
+TEST(ServerRankerTest, UnreachableTargets) {
+  ServerRanker ranker;
+  ASSERT_TRUE(ranker.Start({Target("127.0.0.1", ClosedPort()), Target("nothing.invalid", 443)},
+                           FastOptions(), nullptr));
+  ASSERT_TRUE(WaitFor([&] { return !ranker.IsRunning(); }));
+  std::vector<RankResult> results = ranker.Results();
+  ASSERT_EQ(results.size(), 2u);
+  const RankResult* refused = FindResult(results, 0);
+  ASSERT_NE(refused, nullptr);
+  EXPECT_EQ(refused->score, RankResult::kUnreachable);
+  EXPECT_EQ(refused->attempts, 1u);
+  const RankResult* unresolved = FindResult(results, 1);
+  ASSERT_NE(unresolved, nullptr);
+  EXPECT_EQ(unresolved->score, RankResult::kUnreachable);
+  EXPECT_EQ(unresolved->attempts, 0u);
+}
+
+// Результаты отсортированы по оценке, недоступные - в конце; номера
+// соответствуют исходному списку
+TEST(ServerRankerTest, ResultsAreSorted) {
+  Listener first;
+  Listener second;
+  FakeTlsServer tls(kServerHello);
+  std::vector<RankTarget> targets = {
+      Target("127.0.0.1", ClosedPort()),        Target("127.0.0.1", first.port()),
+      Target("nothing.invalid", 443),           Target("127.0.0.1", tls.port(), true),
+      Target("127.0.0.1", second.port()),       Target("::1", ClosedPort()),
+  };
+  ServerRanker ranker;
+  ServerRanker::Options options = FastOptions();
+  options.max_in_flight = 2;
+  ASSERT_TRUE(ranker.Start(targets, options, nullptr));
+  ASSERT_TRUE(WaitFor([&] { return !ranker.IsRunning(); }));
+  std::vector<RankResult> results = ranker.Results();
+  ASSERT_EQ(results.size(), targets.size());
+  std::set<size_t> indices;
+  for (size_t i = 0; i < results.size(); i++) {
+    indices.insert(results[i].index);
+    if (i > 0) {
+      EXPECT_LE(results[i - 1].score, results[i].score);
+    }
+  }
+  EXPECT_EQ(indices.size(), targets.size());
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_LT(results[i].score, RankResult::kUnreachable);
+  }
+  for (size_t i = 3; i < results.size(); i++) {
+    EXPECT_EQ(results[i].score, RankResult::kUnreachable);
+  }
+}
+
+// Отмена посреди оценки: сервер, не отвечающий на ClientHello, держит
+// попытку до таймаута, остальные проверяются вторым замером; Cancel()
+// возвращается сразу, готовые результаты остаются, новый запуск начинает
+// оценку заново
+TEST(ServerRankerTest, CancelKeepsFinishedResults) {
+  Listener plain;
+  Listener silent;  // TLS-ответа не будет
+  ServerRanker ranker;
+  ServerRanker::Options options = FastOptions();
+  options.timeout_ms = 30000;
+  options.max_in_flight = 2;
+  std::atomic<int> callbacks{0};
+  ASSERT_TRUE(ranker.Start({Target("127.0.0.1", plain.port()),
+                            Target("127.0.0.1", silent.port(), true),
+                            Target("127.0.0.1", plain.port())},
+                           options, [&](const RankResult&) { callbacks++; }));
+  ASSERT_TRUE(WaitFor([&] { return ranker.completed() >= 2; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(ranker.IsRunning());
+
+  Clock::time_point start = Clock::now();
+  ranker.Cancel();
+  EXPECT_LT(Clock::now() - start, std::chrono::seconds(2));
+  EXPECT_FALSE(ranker.IsRunning());
+  std::vector<RankResult> results = ranker.Results();
+  ASSERT_EQ(results.size(), 2u);
+  EXPECT_NE(FindResult(results, 0), nullptr);
+  EXPECT_NE(FindResult(results, 2), nullptr);
+  EXPECT_EQ(callbacks.load(), 2);
+  ranker.Cancel();  // повторная отмена ничего не делает
+
+  ASSERT_TRUE(ranker.Start({Target("127.0.0.1", plain.port())}, FastOptions(), nullptr));
+  ASSERT_TRUE(WaitFor([&] { return !ranker.IsRunning(); }));
+  EXPECT_EQ(ranker.Results().size(), 1u);
+  EXPECT_EQ(ranker.total(), 1u);
+}
+
+std::mutex g_records_mutex;
+std::vector<std::vector<int32_t>> g_records;
+
+void OnRecord(const int32_t* record) {
+  std::lock_guard<std::mutex> lock(g_records_mutex);
+  g_records.emplace_back(record, record + RANK_RECORD_FIELDS);
+}
+
+// Экспорт для Dart: список в JSON, записи результатов, прогресс
+TEST(RankingHelperTest, ExportsRecords) {
+  Listener listener;
+  uint16_t closed = ClosedPort();
+  std::string json = "[{\"address\": \"127.0.0.1\", \"port\": " + std::to_string(closed) +
+                     "}, {\"address\": \"127.0.0.1\", \"port\": " +
+                     std::to_string(listener.port()) + ", \"tls\": false, \"extra\": [1]}]";
+  EXPECT_EQ(RankServersStart("{\"address\": 1}", 0, 0, 0, NULL), 0);
+  EXPECT_EQ(RankServersStart(NULL, 0, 0, 0, NULL), 0);
+  ASSERT_EQ(RankServersStart(json.c_str(), 4, 2, 1000, OnRecord), 1);
+  int32_t completed = 0;
+  int32_t total = 0;
+  ASSERT_TRUE(WaitFor([&] { return RankServersProgress(&completed, &total) == 0; }));
+  EXPECT_EQ(completed, 2);
+  EXPECT_EQ(total, 2);
+
+  int32_t records[4 * RANK_RECORD_FIELDS];
+  ASSERT_EQ(RankServersResults(records, 4), 2);
+  EXPECT_EQ(records[RANK_INDEX], 1);
+  EXPECT_GE(records[RANK_SCORE], 0);
+  EXPECT_EQ(records[RANK_SUCCESSES], 2);
+  EXPECT_EQ(records[RANK_ATTEMPTS], 2);
+  EXPECT_EQ(records[RANK_RECORD_FIELDS + RANK_INDEX], 0);
+  EXPECT_EQ(records[RANK_RECORD_FIELDS + RANK_SCORE], -1);
+  EXPECT_EQ(RankServersResults(records, 1), 1);
+  {
+    std::lock_guard<std::mutex> lock(g_records_mutex);
+    EXPECT_EQ(g_records.size(), 2u);
+  }
+  EXPECT_EQ(RankServersCancel(), 1);
+}
+
+}  // namespace
@@ -0,0 +1,106 @@
+#include "server_store.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+#include "file_test_util.h"
+#include "server_block.h"
+
+namespace {
+
+constexpr size_t kServers = 10000;
+
+// servers.json на 10 тыс. серверов из нескольких подписок: общие параметры
+// Reality и WebSocket повторяются, адреса и id - свои у каждого
+const std::string& ServersJson() {
+  static const std::string json = [] {
+    std::mt19937 random(11);
+    std::string out = "[";
+    for (size_t i = 0; i < kServers; i++) {
+      if (i > 0) out += ",";
+      std::string number = std::to_string(i);
+      bool reality = random() % 2 == 0;
+      out += "{\"protocol\": \"vless\", \"id\": \"b831381d-6324-4d53-ad4f-" +
+             std::to_string(100000000000ull + i) + "\", \"address\": \"node" + number +
+             ".provider-" + std::to_string(random() % 40) + ".example.com\", \"port\": " +
+             std::to_string(443 + random() % 2000) + ", \"params\": {";
+      out += reality ? "\"security\": \"reality\", \"sni\": \"www.microsoft.com\", "
+                       "\"fp\": \"chrome\", \"pbk\": \"SbVKOEMjK0sIlbwg4akyBg5mL5KZwwB-ed4eEE7YnRc\", "
+                       "\"flow\": \"xtls-rprx-vision\", \"type\": \"tcp\""
+                     : "\"security\": \"tls\", \"type\": \"ws\", \"path\": \"/ws?ed=2048\"";
+      out += "}, \"tag\": \"Germany " + number + "\"}";
+    }
+    return out + "]";
+  }();
+  return json;
+}
+
+ServerList Parse() {
+  ServerList servers;
+  ParseServerListJson(ServersJson().data(), ServersJson().size(), &servers);
+  return servers;
+}
+
+// Запуск прежним путем: чтение и разбор servers.json
+void BM_LoadJson(benchmark::State& state) {
+  file_test::TempDirectory directory;
+  file_test::WriteFile(directory.file("servers.json"), ServersJson());
+  for (auto _ : state) {
+    std::string json = file_test::ReadFile(directory.file("servers.json"));
+    ServerList servers;
+    ParseServerListJson(json.data(), json.size(), &servers);
+    benchmark::DoNotOptimize(servers.entries.data());
+  }
+  state.counters["servers"] = (double)kServers;
+}
+BENCHMARK(BM_LoadJson)->Unit(benchmark::kMillisecond);
+
+// Запуск с хранилищем: отображение снимка, проверка CRC и блок для Dart
+void BM_OpenAndView(benchmark::State& state) {
+  file_test::TempDirectory directory;
+  {
+    ServerStore store;
+    store.Open(directory.path());
+    store.Replace(Parse());
+  }
+  size_t bytes = file_test::ReadFile(directory.file("servers.db")).size();
+  for (auto _ : state) {
+    ServerStore store;
+    store.Open(directory.path());
+    size_t ints = 0;
+    benchmark::DoNotOptimize(store.View(&ints));
+  }
+  state.counters["servers"] = (double)kServers;
+  state.counters["snapshot_kb"] = (double)bytes / 1024;
+  state.counters["json_kb"] = (double)ServersJson().size() / 1024;
+}
+BENCHMARK(BM_OpenAndView)->Unit(benchmark::kMillisecond);
+
+// Одна правка из интерфейса: вставка сервера и его удаление - две записи
+// журнала и новый блок для Dart после каждой
+void BM_InsertRemove(benchmark::State& state) {
+  file_test::TempDirectory directory;
+  ServerStore store;
+  store.Open(directory.path());
+  store.Replace(Parse());
+  ServerList server;
+  const char kServer[] =
+      "[{\"protocol\": \"trojan\", \"id\": \"password\", \"address\": \"t.example.net\", "
+      "\"port\": 443, \"params\": {\"sni\": \"t.example.net\"}, \"tag\": \"Trojan\"}]";
+  ParseServerListJson(kServer, sizeof(kServer) - 1, &server);
+  size_t ints = 0;
+  store.View(&ints);
+  for (auto _ : state) {
+    if (!store.Insert(kServers / 2, server) || !store.Remove(kServers / 2, 1)) {
+      state.SkipWithError("edit failed");
+      break;
+    }
+    benchmark::DoNotOptimize(store.View(&ints));
+  }
+  state.counters["log_kb"] = (double)store.log_bytes() / 1024;
+}
+BENCHMARK(BM_InsertRemove)->Unit(benchmark::kMillisecond);
+
+}  // namespace
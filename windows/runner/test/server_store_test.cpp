@@ -0,0 +1,343 @@
+#include "server_store.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "file_test_util.h"
+#include "server_block.h"
+#include "server_store_helper.h"
+
+namespace {
+
+using file_test::ReadFile;
+using file_test::TempDirectory;
+using file_test::WriteFile;
+
+constexpr size_t kSnapshotHeaderBytes = 32;
+constexpr size_t kLogHeaderBytes = 16;
+
+// Серверы как VpnConfig.toJson(); имена - теги
+std::string Json(const std::vector<std::string>& tags, const char* protocol = "vless") {
+  std::string json = "[";
+  for (size_t i = 0; i < tags.size(); i++) {
+    if (i > 0) json += ",";
+    json += std::string("{\"protocol\": \"") + protocol + "\", \"id\": \"id-" + tags[i] +
+            "\", \"address\": \"" + tags[i] + ".example.com\", \"port\": " +
+            std::to_string(443 + i) +
+            ", \"params\": {\"type\": \"ws\", \"path\": \"/ws\"}, \"tag\": \"" + tags[i] + "\"}";
+  }
+  return json + "]";
+}
+
+ServerList Servers(const std::vector<std::string>& tags) {
+  ServerList servers;
+  std::string json = Json(tags);
+  EXPECT_TRUE(ParseServerListJson(json.data(), json.size(), &servers));
+  return servers;
+}
+
+// Сервер одной строкой: протокол|порт|id|адрес|тег|ключ=значение&...
+std::vector<std::string> Dump(const int32_t* block, size_t ints) {
+  ServerBlockView view;
+  EXPECT_TRUE(DecodeServerBlock(block, ints, &view));
+  auto text = [&](int32_t offset, int32_t length) {
+    return std::string(view.text + offset, (size_t)length);
+  };
+  std::vector<std::string> servers;
+  for (size_t i = 0; i < view.count; i++) {
+    const int32_t* record = view.records + i * SUBSCRIPTION_RECORD_FIELDS;
+    std::string server =
+        std::to_string(record[SUBSCRIPTION_PROTOCOL]) + "|" +
+        std::to_string(record[SUBSCRIPTION_PORT]) + "|" +
+        text(record[SUBSCRIPTION_ID_OFFSET], record[SUBSCRIPTION_ID_LENGTH]) + "|" +
+        text(record[SUBSCRIPTION_ADDRESS_OFFSET], record[SUBSCRIPTION_ADDRESS_LENGTH]) + "|" +
+        text(record[SUBSCRIPTION_TAG_OFFSET], record[SUBSCRIPTION_TAG_LENGTH]) + "|";
+    const int32_t* param = view.params + (size_t)record[SUBSCRIPTION_FIRST_PARAM] * 4;
+    for (int32_t p = 0; p < record[SUBSCRIPTION_PARAM_COUNT]; p++, param += 4) {
+      if (p > 0) server += "&";
+      server += text(param[0], param[1]) + "=" + text(param[2], param[3]);
+    }
+    servers.push_back(server);
+  }
+  return servers;
+}
+
+std::vector<std::string> Dump(ServerStore* store) {
+  size_t ints = 0;
+  const int32_t* block = store->View(&ints);
+  return Dump(block, ints);
+}
+
+std::vector<std::string> Tags(ServerStore* store) {
+  std::vector<std::string> tags;
+  for (const std::string& server : Dump(store)) {
+    size_t end = server.rfind('|');
+    size_t start = server.rfind('|', end - 1) + 1;
+    tags.push_back(server.substr(start, end - start));
+  }
+  return tags;
+}
+
+// Эталонный CRC32 (zlib): побитово, без таблиц
+uint32_t ReferenceCrc32(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+TEST(ServerStoreTest, OpensEmptyDirectory) {
+  TempDirectory directory;
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_TRUE(store.is_open());
+  EXPECT_EQ(store.size(), 0u);
+  EXPECT_TRUE(Dump(&store).empty());
+  EXPECT_EQ(store.log_bytes(), kLogHeaderBytes);
+}
+
+TEST(ServerStoreTest, EditsSurviveReopen) {
+  TempDirectory directory;
+  std::string snapshot;
+  {
+    ServerStore store;
+    ASSERT_TRUE(store.Open(directory.path()));
+    ASSERT_TRUE(store.Replace(Servers({"a", "b", "c"})));
+    snapshot = ReadFile(directory.file("servers.db"));
+    ASSERT_TRUE(store.Insert(1, Servers({"x", "y"})));
+    ASSERT_TRUE(store.Remove(0, 1));
+    ASSERT_TRUE(store.Insert(4, Servers({"z"})));
+    EXPECT_EQ(Tags(&store), (std::vector<std::string>{"x", "y", "b", "c", "z"}));
+    // Правки - только дозапись в журнал
+    EXPECT_GT(store.log_bytes(), kLogHeaderBytes);
+    EXPECT_EQ(ReadFile(directory.file("servers.db")), snapshot);
+  }
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(Tags(&store), (std::vector<std::string>{"x", "y", "b", "c", "z"}));
+  EXPECT_EQ(Dump(&store)[0], "0|443|id-x|x.example.com|x|type=ws&path=/ws");
+  EXPECT_EQ(Dump(&store)[2], "0|444|id-b|b.example.com|b|type=ws&path=/ws");
+
+  // Сжатие не меняет список
+  std::vector<std::string> before = Dump(&store);
+  ASSERT_TRUE(store.Compact());
+  EXPECT_EQ(store.log_bytes(), kLogHeaderBytes);
+  EXPECT_EQ(Dump(&store), before);
+  store.Close();
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(Dump(&store), before);
+}
+
+TEST(ServerStoreTest, RejectsOutOfRangeEdits) {
+  TempDirectory directory;
+  ServerStore store;
+  EXPECT_FALSE(store.Insert(0, Servers({"a"})));
+  ASSERT_TRUE(store.Open(directory.path()));
+  ASSERT_TRUE(store.Insert(0, Servers({"a", "b"})));
+  size_t log_bytes = store.log_bytes();
+  EXPECT_FALSE(store.Insert(3, Servers({"c"})));
+  EXPECT_FALSE(store.Remove(1, 2));
+  EXPECT_FALSE(store.Remove(0, 0));
+  EXPECT_FALSE(store.Remove(3, 1));
+  EXPECT_EQ(store.log_bytes(), log_bytes);
+  EXPECT_EQ(store.size(), 2u);
+}
+
+// Оборванная последняя запись журнала отбрасывается, остальное
+// применяется и сразу сохраняется новым снимком
+TEST(ServerStoreTest, DropsTornLogTail) {
+  TempDirectory directory;
+  {
+    ServerStore store;
+    ASSERT_TRUE(store.Open(directory.path()));
+    ASSERT_TRUE(store.Insert(0, Servers({"a", "b"})));
+    ASSERT_TRUE(store.Remove(0, 1));
+    ASSERT_TRUE(store.Insert(1, Servers({"c"})));
+  }
+  std::string log = ReadFile(directory.file("servers.log"));
+  for (size_t cut : {1, 7, 40}) {
+    WriteFile(directory.file("servers.log"), log.substr(0, log.size() - cut));
+    ServerStore store;
+    ASSERT_TRUE(store.Open(directory.path())) << cut;
+    EXPECT_EQ(Tags(&store), (std::vector<std::string>{"b"})) << cut;
+    EXPECT_EQ(store.log_bytes(), kLogHeaderBytes);
+    store.Close();
+    ASSERT_TRUE(store.Open(directory.path()));
+    EXPECT_EQ(Tags(&store), (std::vector<std::string>{"b"}));
+    // Следующая итерация - снова на пустом снимке
+    std::filesystem::remove(directory.file("servers.db"));
+  }
+
+  // Испорченная запись посередине обрывает журнал на ней
+  std::string corrupted = log;
+  corrupted[kLogHeaderBytes + 12] ^= 0x55;
+  WriteFile(directory.file("servers.log"), corrupted);
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(store.size(), 0u);
+}
+
+// Журнал прежнего снимка (сбой между записью снимка и очисткой журнала)
+// не применяется повторно
+TEST(ServerStoreTest, IgnoresStaleGenerationLog) {
+  TempDirectory directory;
+  std::string stale_log;
+  {
+    ServerStore store;
+    ASSERT_TRUE(store.Open(directory.path()));
+    ASSERT_TRUE(store.Replace(Servers({"a"})));
+    ASSERT_TRUE(store.Insert(1, Servers({"b"})));
+    stale_log = ReadFile(directory.file("servers.log"));
+    ASSERT_TRUE(store.Compact());
+  }
+  WriteFile(directory.file("servers.log"), stale_log);
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(Tags(&store), (std::vector<std::string>{"a", "b"}));
+  EXPECT_EQ(store.log_bytes(), kLogHeaderBytes);
+}
+
+// Поврежденный снимок или снимок новой версии: Open не удается, и файлы
+// остаются как были - их не перезаписать пустым списком
+TEST(ServerStoreTest, CorruptOrFutureSnapshotIsLeftUntouched) {
+  TempDirectory directory;
+  std::string snapshot;
+  std::string log;
+  {
+    ServerStore store;
+    ASSERT_TRUE(store.Open(directory.path()));
+    ASSERT_TRUE(store.Replace(Servers({"a", "b"})));
+    ASSERT_TRUE(store.Insert(0, Servers({"c"})));
+    snapshot = ReadFile(directory.file("servers.db"));
+    log = ReadFile(directory.file("servers.log"));
+  }
+
+  std::string flipped = snapshot;
+  flipped[flipped.size() - 5] ^= 0x01;
+  std::string future = snapshot;
+  future[8] = 2;  // SnapshotHeader::version
+  std::string truncated = snapshot.substr(0, snapshot.size() - 4);
+  std::string short_header = snapshot.substr(0, 20);
+  for (const std::string& bad : {flipped, future, truncated, short_header}) {
+    WriteFile(directory.file("servers.db"), bad);
+    ServerStore store;
+    EXPECT_FALSE(store.Open(directory.path()));
+    EXPECT_FALSE(store.is_open());
+    EXPECT_FALSE(store.Insert(0, Servers({"d"})));
+    EXPECT_EQ(ReadFile(directory.file("servers.db")), bad);
+    EXPECT_EQ(ReadFile(directory.file("servers.log")), log);
+  }
+
+  WriteFile(directory.file("servers.db"), snapshot);
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(Tags(&store), (std::vector<std::string>{"c", "a", "b"}));
+}
+
+// Журнал не растет без предела: 20 тыс. правок на коротком списке
+TEST(ServerStoreTest, LogStaysBounded) {
+  TempDirectory directory;
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  ASSERT_TRUE(store.Replace(Servers({"a", "b", "c"})));
+  ServerList server = Servers({"x"});
+  size_t largest = 0;
+  for (int i = 0; i < 20000; i++) {
+    if (i % 2 == 0) {
+      ASSERT_TRUE(store.Insert((size_t)i % 4, server));
+    } else {
+      ASSERT_TRUE(store.Remove((size_t)(i - 1) % 4, 1));
+    }
+    largest = std::max(largest, store.log_bytes());
+  }
+  EXPECT_LE(largest, ServerStore::kMinCompactBytes + 1024);
+  EXPECT_LE(ReadFile(directory.file("servers.log")).size(), ServerStore::kMinCompactBytes + 1024);
+  EXPECT_EQ(Tags(&store), (std::vector<std::string>{"a", "b", "c"}));
+  // Мусор удаленных серверов ушел при сжатии
+  EXPECT_LT(ReadFile(directory.file("servers.db")).size(), 4096u);
+
+  store.Close();
+  ASSERT_TRUE(store.Open(directory.path()));
+  EXPECT_EQ(Tags(&store), (std::vector<std::string>{"a", "b", "c"}));
+}
+
+// Снимок хранит каждую строку один раз, контрольная сумма - CRC32 zlib
+TEST(ServerStoreTest, SnapshotInternsStringsAndUsesZlibCrc) {
+  EXPECT_EQ(ReferenceCrc32("123456789", 9), 0xCBF43926u);
+
+  TempDirectory directory;
+  ServerStore store;
+  ASSERT_TRUE(store.Open(directory.path()));
+  std::vector<std::string> tags(200, "same");
+  ASSERT_TRUE(store.Replace(Servers(tags)));
+  size_t ints = 0;
+  const int32_t* block = store.View(&ints);
+  EXPECT_EQ(block[SUBSCRIPTION_ENTRIES], 200);
+  // id, адрес, тег и два параметра - один раз на весь список
+  EXPECT_LT(block[SUBSCRIPTION_TEXT], 64);
+
+  std::string file = ReadFile(directory.file("servers.db"));
+  ASSERT_GT(file.size(), kSnapshotHeaderBytes);
+  uint32_t block_ints = 0;
+  uint32_t checksum = 0;
+  memcpy(&block_ints, file.data() + 12, sizeof(block_ints));
+  memcpy(&checksum, file.data() + 24, sizeof(checksum));
+  ASSERT_EQ(file.size(), kSnapshotHeaderBytes + block_ints * sizeof(int32_t));
+  EXPECT_EQ(checksum, ReferenceCrc32(file.data() + kSnapshotHeaderBytes,
+                                     file.size() - kSnapshotHeaderBytes));
+}
+
+// Экспорт для Dart: JSON VpnConfig.toJson() туда и обратно
+TEST(ServerStoreHelperTest, JsonRoundTrip) {
+  TempDirectory directory;
+  EXPECT_EQ(ServerStoreOpen(nullptr), 0);
+  ASSERT_EQ(ServerStoreOpen(directory.path().c_str()), 1);
+  std::string tagged =
+      "[{\"protocol\": \"trojan\", \"id\": \"p@ss\", \"address\": \"t.example.net\", "
+      "\"port\": 8443, \"params\": {\"sni\": \"t.example.net\"}, "
+      "\"tag\": \"Москва \\u0031\"},"
+      "{\"protocol\": \"ss\", \"id\": \"secret\", \"address\": \"1.2.3.4\", \"port\": 8388, "
+      "\"params\": {\"method\": \"aes-256-gcm\"}, \"tag\": \"\", \"extra\": [1, {\"x\": 2}]}]";
+  ASSERT_EQ(ServerStoreReplace(tagged.c_str()), 1);
+  ASSERT_EQ(ServerStoreInsert(1, Json({"v"}, "vmess").c_str()), 1);
+  ASSERT_EQ(ServerStoreRemove(0, 0), 0);
+
+  // Неизвестный протокол, неверный JSON, позиция за концом - ничего не меняют
+  EXPECT_EQ(ServerStoreInsert(0, Json({"h"}, "hysteria2").c_str()), 0);
+  EXPECT_EQ(ServerStoreInsert(0, "[{\"protocol\": \"vless\""), 0);
+  EXPECT_EQ(ServerStoreInsert(-1, Json({"n"}).c_str()), 0);
+  EXPECT_EQ(ServerStoreInsert(4, Json({"n"}).c_str()), 0);
+  EXPECT_EQ(ServerStoreRemove(2, 2), 0);
+  EXPECT_EQ(ServerStoreReplace(nullptr), 0);
+
+  const std::vector<std::string> expected = {
+      "2|8443|p@ss|t.example.net|Москва 1|sni=t.example.net",
+      "1|443|id-v|v.example.com|v|type=ws&path=/ws",
+      "3|8388|secret|1.2.3.4||method=aes-256-gcm",
+  };
+  auto view = [] {
+    const int32_t* block = ServerStoreView();
+    EXPECT_NE(block, nullptr);
+    EXPECT_EQ(block[SUBSCRIPTION_SKIPPED], 0);
+    size_t ints = SUBSCRIPTION_HEADER_FIELDS +
+                  (size_t)block[SUBSCRIPTION_ENTRIES] * SUBSCRIPTION_RECORD_FIELDS +
+                  (size_t)block[SUBSCRIPTION_PARAMS] * 4 +
+                  ((size_t)block[SUBSCRIPTION_TEXT] + 3) / 4;
+    return Dump(block, ints);
+  };
+  EXPECT_EQ(view(), expected);
+
+  ServerStoreClose();
+  EXPECT_EQ(ServerStoreView(), nullptr);
+  ASSERT_EQ(ServerStoreOpen(directory.path().c_str()), 1);
+  EXPECT_EQ(view(), expected);
+  ServerStoreClose();
+}
+
+}  // namespace
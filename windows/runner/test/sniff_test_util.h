@@ -0,0 +1,264 @@
+#ifndef RUNNER_TEST_SNIFF_TEST_UTIL_H_
+#define RUNNER_TEST_SNIFF_TEST_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quic_crypto.h"
+
+// Первые сообщения потоков для тестов и бенчмарков FlowSniffer: ClientHello
+// с набором расширений как у Chrome (около 1800 байт с key_share
+// X25519Kyber768 или 512 байт без него), запрос HTTP/1.1 и защищенные
+// пакеты QUIC Initial.
+namespace sniff_test {
+
+constexpr uint32_t kQuicV1 = 0x00000001;
+constexpr uint32_t kQuicV2 = 0x6b3343cf;
+constexpr uint32_t kQuicDraft29 = 0xff00001d;
+
+inline void Append16(std::vector<uint8_t>* out, size_t value) {
+  out->push_back((uint8_t)(value >> 8));
+  out->push_back((uint8_t)value);
+}
+
+inline void Append24(std::vector<uint8_t>* out, size_t value) {
+  out->push_back((uint8_t)(value >> 16));
+  Append16(out, value);
+}
+
+inline void AppendVarint(std::vector<uint8_t>* out, uint64_t value) {
+  if (value < 64) {
+    out->push_back((uint8_t)value);
+  } else if (value < 16384) {
+    Append16(out, 0x4000 | (size_t)value);
+  } else {
+    out->push_back((uint8_t)(0x80 | (value >> 24)));
+    Append24(out, (size_t)(value & 0xffffff));
+  }
+}
+
+inline void AppendExtension(std::vector<uint8_t>* out, uint16_t type,
+                            const std::vector<uint8_t>& body) {
+  Append16(out, type);
+  Append16(out, body.size());
+  out->insert(out->end(), body.begin(), body.end());
+}
+
+// Сообщение ClientHello (с заголовком Handshake). Пустой |host| - без SNI;
+// |key_share| - размер ключа в key_share (32 - X25519, 1216 - с Kyber768)
+inline std::vector<uint8_t> ClientHello(const std::string& host, size_t key_share = 32) {
+  std::vector<uint8_t> body = {0x03, 0x03};
+  for (int i = 0; i < 32; i++) body.push_back((uint8_t)(0xa0 + i));
+  body.push_back(32);
+  for (int i = 0; i < 32; i++) body.push_back((uint8_t)(0x40 + i));
+  const uint16_t kSuites[] = {0x1301, 0x1302, 0x1303, 0xc02b, 0xc02f, 0xc02c, 0xc030, 0xcca9,
+                              0xcca8, 0xc013, 0xc014, 0x009c, 0x009d, 0x002f, 0x0035};
+  Append16(&body, sizeof(kSuites));
+  for (uint16_t suite : kSuites) Append16(&body, suite);
+  body.push_back(1);
+  body.push_back(0);
+
+  std::vector<uint8_t> extensions;
+  if (!host.empty()) {
+    std::vector<uint8_t> names;
+    Append16(&names, host.size() + 3);
+    names.push_back(0);
+    Append16(&names, host.size());
+    names.insert(names.end(), host.begin(), host.end());
+    AppendExtension(&extensions, 0x0000, names);
+  }
+  AppendExtension(&extensions, 0x0017, {});
+  AppendExtension(&extensions, 0xff01, {0});
+  AppendExtension(&extensions, 0x000a, {0, 8, 0x63, 0x99, 0, 0x1d, 0, 0x17, 0, 0x18});
+  AppendExtension(&extensions, 0x000b, {1, 0});
+  AppendExtension(&extensions, 0x0023, {});
+  AppendExtension(&extensions, 0x0010,
+                  {0, 12, 2, 'h', '2', 8, 'h', 't', 't', 'p', '/', '1', '.', '1'});
+  AppendExtension(&extensions, 0x0005, {1, 0, 0, 0, 0});
+  AppendExtension(&extensions, 0x000d,
+                  {0, 16, 4, 3, 8, 4, 4, 1, 5, 3, 8, 5, 5, 1, 8, 6, 6, 1});
+  AppendExtension(&extensions, 0x0012, {});
+  std::vector<uint8_t> share;
+  Append16(&share, key_share + 4);
+  Append16(&share, key_share == 32 ? 0x001d : 0x6399);
+  Append16(&share, key_share);
+  for (size_t i = 0; i < key_share; i++) share.push_back((uint8_t)(i * 7));
+  AppendExtension(&extensions, 0x0033, share);
+  AppendExtension(&extensions, 0x002d, {1, 1});
+  AppendExtension(&extensions, 0x002b, {4, 3, 4, 3, 3});
+  AppendExtension(&extensions, 0x001b, {2, 0, 2});
+  Append16(&body, extensions.size());
+  body.insert(body.end(), extensions.begin(), extensions.end());
+
+  std::vector<uint8_t> message = {0x01};
+  Append24(&message, body.size());
+  message.insert(message.end(), body.begin(), body.end());
+  return message;
+}
+
+// Сообщение Handshake в записях TLS не длиннее |record_size|
+inline std::vector<uint8_t> TlsRecords(const std::vector<uint8_t>& message,
+                                       size_t record_size = 16384) {
+  std::vector<uint8_t> records;
+  for (size_t offset = 0; offset < message.size(); offset += record_size) {
+    size_t length = std::min(record_size, message.size() - offset);
+    records.insert(records.end(), {0x16, 0x03, 0x01});
+    Append16(&records, length);
+    records.insert(records.end(), message.begin() + (ptrdiff_t)offset,
+                   message.begin() + (ptrdiff_t)(offset + length));
+  }
+  return records;
+}
+
+inline std::vector<uint8_t> HttpRequest(const std::string& host,
+                                        const std::string& method = "GET") {
+  std::string request = method + " /index.html?q=1 HTTP/1.1\r\n"
+                        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64)\r\n"
+                        "Accept: text/html,application/xhtml+xml\r\n"
+                        "Host: " + host + "\r\n"
+                        "Connection: keep-alive\r\n\r\n";
+  return std::vector<uint8_t>(request.begin(), request.end());
+}
+
+// Умножение в GF(2^128) для GHASH (NIST SP 800-38D, 6.3)
+inline void GfMultiply(uint8_t x[16], const uint8_t h[16]) {
+  uint8_t z[16] = {};
+  uint8_t v[16];
+  memcpy(v, h, 16);
+  for (int i = 0; i < 128; i++) {
+    if (x[i / 8] & (0x80 >> (i % 8))) {
+      for (int j = 0; j < 16; j++) z[j] ^= v[j];
+    }
+    bool carry = v[15] & 1;
+    for (int j = 15; j > 0; j--) v[j] = (uint8_t)((v[j] >> 1) | (v[j - 1] << 7));
+    v[0] >>= 1;
+    if (carry) v[0] ^= 0xe1;
+  }
+  memcpy(x, z, 16);
+}
+
+inline void Ghash(uint8_t y[16], const uint8_t h[16], const uint8_t* data, size_t length) {
+  for (size_t offset = 0; offset < length; offset += 16) {
+    for (size_t i = 0; i < 16 && offset + i < length; i++) y[i] ^= data[offset + i];
+    GfMultiply(y, h);
+  }
+}
+
+// Зашифровать AES-128-GCM на месте и дописать тег; в quic_crypto.h есть
+// только расшифровка, клиентская сторона нужна лишь тестам
+inline void Aes128GcmSeal(const uint8_t key[16], const uint8_t nonce[12], const uint8_t* aad,
+                          size_t aad_length, std::vector<uint8_t>* data) {
+  Aes128 aes(key);
+  uint8_t h[16] = {};
+  aes.EncryptBlock(h, h);
+  uint8_t counter[16] = {};
+  memcpy(counter, nonce, 12);
+  counter[15] = 1;
+  uint8_t tag_mask[16];
+  aes.EncryptBlock(counter, tag_mask);
+  size_t length = data->size();
+  for (size_t offset = 0; offset < length; offset += 16) {
+    for (int i = 15; i >= 12 && ++counter[i] == 0; i--) {
+    }
+    uint8_t stream[16];
+    aes.EncryptBlock(counter, stream);
+    for (size_t i = 0; i < 16 && offset + i < length; i++) (*data)[offset + i] ^= stream[i];
+  }
+  uint8_t y[16] = {};
+  Ghash(y, h, aad, aad_length);
+  Ghash(y, h, data->data(), length);
+  uint8_t lengths[16] = {};
+  for (int i = 0; i < 8; i++) {
+    lengths[7 - i] = (uint8_t)(((uint64_t)aad_length * 8) >> (8 * i));
+    lengths[15 - i] = (uint8_t)(((uint64_t)length * 8) >> (8 * i));
+  }
+  Ghash(y, h, lengths, 16);
+  for (int i = 0; i < 16; i++) data->push_back((uint8_t)(y[i] ^ tag_mask[i]));
+}
+
+// Фрагмент CRYPTO: смещение в потоке ClientHello и байты
+using CryptoFrame = std::pair<uint64_t, std::vector<uint8_t>>;
+
+// Клиентский пакет Initial (RFC 9001, 5 и A.2) с кадрами CRYPTO,
+// дополненный PADDING до |size| байт
+inline std::vector<uint8_t> QuicInitial(uint32_t version, const std::vector<uint8_t>& dcid,
+                                        const std::vector<CryptoFrame>& frames,
+                                        uint32_t packet_number = 0, size_t size = 1200) {
+  static const uint8_t kSaltV1[20] = {0x38, 0x76, 0x2c, 0xf7, 0xf5, 0x59, 0x34,
+                                      0xb3, 0x4d, 0x17, 0x9a, 0xe6, 0xa4, 0xc8,
+                                      0x0c, 0xad, 0xcc, 0xbb, 0x7f, 0x0a};
+  static const uint8_t kSaltV2[20] = {0x0d, 0xed, 0xe3, 0xde, 0xf7, 0x00, 0xa6,
+                                      0xdb, 0x81, 0x93, 0x81, 0xbe, 0x6e, 0x26,
+                                      0x9d, 0xcb, 0xf9, 0xbd, 0x2e, 0xd9};
+  static const uint8_t kSaltDraft29[20] = {0xaf, 0xbf, 0xec, 0x28, 0x99, 0x93, 0xd2,
+                                           0x4c, 0x9e, 0x97, 0x86, 0xf1, 0x9c, 0x61,
+                                           0x11, 0xe0, 0x43, 0x90, 0xa8, 0x99};
+  const bool v2 = version == kQuicV2;
+  const uint8_t* salt = v2 ? kSaltV2 : version == kQuicDraft29 ? kSaltDraft29 : kSaltV1;
+  uint8_t initial_secret[Sha256::kDigestSize];
+  uint8_t client_secret[Sha256::kDigestSize];
+  uint8_t key[16];
+  uint8_t iv[12];
+  uint8_t hp[16];
+  HkdfExtract(salt, 20, dcid.data(), dcid.size(), initial_secret);
+  HkdfExpandLabel(initial_secret, "client in", client_secret, sizeof(client_secret));
+  HkdfExpandLabel(client_secret, v2 ? "quicv2 key" : "quic key", key, sizeof(key));
+  HkdfExpandLabel(client_secret, v2 ? "quicv2 iv" : "quic iv", iv, sizeof(iv));
+  HkdfExpandLabel(client_secret, v2 ? "quicv2 hp" : "quic hp", hp, sizeof(hp));
+
+  constexpr size_t kNumberLength = 4;
+  std::vector<uint8_t> payload;
+  for (const CryptoFrame& frame : frames) {
+    payload.push_back(0x06);
+    AppendVarint(&payload, frame.first);
+    AppendVarint(&payload, frame.second.size());
+    payload.insert(payload.end(), frame.second.begin(), frame.second.end());
+  }
+
+  std::vector<uint8_t> packet = {(uint8_t)(0xc0 | ((v2 ? 1 : 0) << 4) | (kNumberLength - 1))};
+  packet.push_back((uint8_t)(version >> 24));
+  Append24(&packet, version & 0xffffff);
+  packet.push_back((uint8_t)dcid.size());
+  packet.insert(packet.end(), dcid.begin(), dcid.end());
+  packet.push_back(8);
+  for (int i = 0; i < 8; i++) packet.push_back((uint8_t)(0xc0 + i));
+  packet.push_back(0);  // без токена
+  // Длина - всегда двухбайтовый varint, чтобы размер пакета был точным
+  size_t header_length = packet.size() + 2 + kNumberLength;
+  if (size > header_length + payload.size() + 16) {
+    payload.resize(size - header_length - 16);
+  }
+  Append16(&packet, 0x4000 | (kNumberLength + payload.size() + 16));
+  size_t number_offset = packet.size();
+  packet.push_back((uint8_t)(packet_number >> 24));
+  Append24(&packet, packet_number & 0xffffff);
+
+  uint8_t nonce[12];
+  memcpy(nonce, iv, sizeof(nonce));
+  for (int i = 0; i < 4; i++) nonce[11 - i] ^= (uint8_t)(packet_number >> (8 * i));
+  Aes128GcmSeal(key, nonce, packet.data(), packet.size(), &payload);
+  packet.insert(packet.end(), payload.begin(), payload.end());
+
+  // Защита заголовка (RFC 9001, 5.4.1)
+  uint8_t mask[16];
+  Aes128(hp).EncryptBlock(packet.data() + number_offset + 4, mask);
+  packet[0] ^= mask[0] & 0x0f;
+  for (size_t i = 0; i < kNumberLength; i++) packet[number_offset + i] ^= mask[1 + i];
+  return packet;
+}
+
+inline std::vector<uint8_t> Dcid(uint8_t seed) {
+  std::vector<uint8_t> dcid(8);
+  for (size_t i = 0; i < dcid.size(); i++) dcid[i] = (uint8_t)(seed * 31 + i);
+  return dcid;
+}
+
+}  // namespace sniff_test
+
+#endif  // RUNNER_TEST_SNIFF_TEST_UTIL_H_
@@ -0,0 +1,286 @@
+#ifndef RUNNER_TEST_SOCKET_TEST_UTIL_H_
+#define RUNNER_TEST_SOCKET_TEST_UTIL_H_
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Блокирующие сокеты для тестов и бенчмарков сетевого стека (Linux):
+// эхо-серверы TCP/UDP на 127.0.0.1 и клиентские рукопожатия SOCKS5 и
+// HTTP CONNECT.
+namespace socket_test {
+
+inline sockaddr_in Loopback(uint16_t port) {
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return address;
+}
+
+inline uint16_t LocalPort(int socket) {
+  sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  getsockname(socket, (sockaddr*)&address, &length);
+  return ntohs(address.sin_port);
+}
+
+// Таймаут приема, чтобы тест падал, а не зависал
+inline void SetReceiveTimeout(int socket, int milliseconds) {
+  timeval timeout = {milliseconds / 1000, (milliseconds % 1000) * 1000};
+  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+// recv()/send() с повтором после EINTR. При заданном SO_RCVTIMEO ядро не
+// перезапускает прерванный вызов, а завершения io_uring будят поток
+// сигналом задачи даже без обработчиков.
+inline ssize_t Receive(int socket, void* data, size_t length) {
+  ssize_t received;
+  do {
+    received = recv(socket, data, length, 0);
+  } while (received < 0 && errno == EINTR);
+  return received;
+}
+
+inline ssize_t Send(int socket, const void* data, size_t length) {
+  ssize_t sent;
+  do {
+    sent = send(socket, data, length, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  return sent;
+}
+
+inline bool SendAll(int socket, const void* data, size_t length) {
+  const char* cursor = (const char*)data;
+  while (length > 0) {
+    ssize_t sent = Send(socket, cursor, length);
+    if (sent <= 0) return false;
+    cursor += sent;
+    length -= (size_t)sent;
+  }
+  return true;
+}
+
+inline bool ReceiveAll(int socket, void* data, size_t length) {
+  char* cursor = (char*)data;
+  while (length > 0) {
+    ssize_t received = Receive(socket, cursor, length);
+    if (received <= 0) return false;
+    cursor += received;
+    length -= (size_t)received;
+  }
+  return true;
+}
+
+// Все байты до закрытия соединения сервером
+inline std::string ReceiveUntilClose(int socket) {
+  std::string out;
+  char buffer[4096];
+  for (;;) {
+    ssize_t received = Receive(socket, buffer, sizeof(buffer));
+    if (received <= 0) return out;
+    out.append(buffer, (size_t)received);
+  }
+}
+
+inline int ConnectTo(uint16_t port) {
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = Loopback(port);
+  if (connect(client, (sockaddr*)&address, sizeof(address)) != 0) {
+    close(client);
+    return -1;
+  }
+  int enable = 1;
+  setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  SetReceiveTimeout(client, 5000);
+  return client;
+}
+
+// SOCKS5 без аутентификации. |host| - IPv4-литерал или имя (ATYP 3).
+// Возвращает код ответа сервера или -1, если ответ не пришел.
+inline int Socks5Handshake(int client, uint8_t command, const std::string& host,
+                           uint16_t port) {
+  const uint8_t greeting[] = {0x05, 0x01, 0x00};
+  uint8_t method[2];
+  if (!SendAll(client, greeting, sizeof(greeting)) || !ReceiveAll(client, method, 2) ||
+      method[1] != 0x00) {
+    return -1;
+  }
+  std::vector<uint8_t> request = {0x05, command, 0x00};
+  in_addr ipv4;
+  if (inet_pton(AF_INET, host.c_str(), &ipv4) == 1) {
+    request.push_back(0x01);
+    const uint8_t* bytes = (const uint8_t*)&ipv4;
+    request.insert(request.end(), bytes, bytes + 4);
+  } else {
+    request.push_back(0x03);
+    request.push_back((uint8_t)host.size());
+    request.insert(request.end(), host.begin(), host.end());
+  }
+  request.push_back((uint8_t)(port >> 8));
+  request.push_back((uint8_t)port);
+  uint8_t reply[4];
+  if (!SendAll(client, request.data(), request.size()) || !ReceiveAll(client, reply, 4)) {
+    return -1;
+  }
+  size_t address_length = reply[3] == 0x04 ? 16 : 4;
+  uint8_t rest[18];
+  if (!ReceiveAll(client, rest, address_length + 2)) {
+    return -1;
+  }
+  return reply[1];
+}
+
+// UDP ASSOCIATE: адрес ретранслятора берется из ответа сервера
+inline bool Socks5UdpAssociate(int client, sockaddr_in* relay) {
+  const uint8_t greeting[] = {0x05, 0x01, 0x00};
+  uint8_t method[2];
+  const uint8_t request[] = {0x05, 0x03, 0x00, 0x01, 0, 0, 0, 0, 0, 0};
+  uint8_t reply[10];
+  if (!SendAll(client, greeting, sizeof(greeting)) || !ReceiveAll(client, method, 2) ||
+      !SendAll(client, request, sizeof(request)) || !ReceiveAll(client, reply, 10) ||
+      reply[1] != 0x00 || reply[3] != 0x01) {
+    return false;
+  }
+  *relay = sockaddr_in();
+  relay->sin_family = AF_INET;
+  memcpy(&relay->sin_addr, reply + 4, 4);
+  memcpy(&relay->sin_port, reply + 8, 2);
+  return true;
+}
+
+// Ответ на HTTP CONNECT до пустой строки включительно
+inline std::string HttpConnect(int client, const std::string& target) {
+  std::string request = "CONNECT " + target + " HTTP/1.1\r\nHost: " + target + "\r\n\r\n";
+  if (!SendAll(client, request.data(), request.size())) return std::string();
+  std::string reply;
+  char c;
+  while (reply.size() < 4096 && Receive(client, &c, 1) == 1) {
+    reply.push_back(c);
+    if (reply.size() >= 4 && reply.compare(reply.size() - 4, 4, "\r\n\r\n") == 0) break;
+  }
+  return reply;
+}
+
+// Эхо-сервер TCP: поток на соединение, все принятое отправляется обратно.
+// С |discard| принятое только считается (нагрузка в одну сторону).
+class EchoServer {
+ public:
+  explicit EchoServer(bool discard = false) : discard_(discard) {
+    listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address = Loopback(0);
+    bind(listener_, (sockaddr*)&address, sizeof(address));
+    listen(listener_, 1024);
+    port_ = LocalPort(listener_);
+    thread_ = std::thread([this] { AcceptLoop(); });
+  }
+
+  ~EchoServer() {
+    stopping_ = true;
+    shutdown(listener_, SHUT_RDWR);
+    close(listener_);
+    thread_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int client : clients_) shutdown(client, SHUT_RDWR);
+    for (std::thread& worker : workers_) worker.join();
+    for (int client : clients_) close(client);
+  }
+
+  uint16_t port() const { return port_; }
+  size_t accepted() const { return accepted_.load(); }
+  uint64_t received_bytes() const { return received_bytes_.load(); }
+
+ private:
+  void AcceptLoop() {
+    while (!stopping_) {
+      int client = accept(listener_, nullptr, nullptr);
+      if (client < 0) {
+        if (stopping_) return;
+        continue;
+      }
+      accepted_++;
+      std::lock_guard<std::mutex> lock(mutex_);
+      clients_.push_back(client);
+      workers_.emplace_back([this, client] {
+        char buffer[64 * 1024];
+        for (;;) {
+          ssize_t received = Receive(client, buffer, sizeof(buffer));
+          if (received <= 0) break;
+          received_bytes_ += (uint64_t)received;
+          if (!discard_ && !SendAll(client, buffer, (size_t)received)) break;
+        }
+        shutdown(client, SHUT_WR);
+      });
+    }
+  }
+
+  bool discard_;
+  int listener_;
+  uint16_t port_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<size_t> accepted_{0};
+  std::atomic<uint64_t> received_bytes_{0};
+  std::thread thread_;
+  std::mutex mutex_;
+  std::vector<int> clients_;
+  std::vector<std::thread> workers_;
+};
+
+// Эхо-сервер UDP
+class UdpEchoServer {
+ public:
+  UdpEchoServer() {
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = Loopback(0);
+    bind(socket_, (sockaddr*)&address, sizeof(address));
+    port_ = LocalPort(socket_);
+    SetReceiveTimeout(socket_, 100);
+    thread_ = std::thread([this] {
+      char buffer[65536];
+      while (!stopping_) {
+        sockaddr_in from;
+        socklen_t length = sizeof(from);
+        ssize_t received =
+            recvfrom(socket_, buffer, sizeof(buffer), 0, (sockaddr*)&from, &length);
+        if (received > 0) {
+          received_++;
+          sendto(socket_, buffer, (size_t)received, 0, (sockaddr*)&from, length);
+        }
+      }
+    });
+  }
+
+  ~UdpEchoServer() {
+    stopping_ = true;
+    thread_.join();
+    close(socket_);
+  }
+
+  uint16_t port() const { return port_; }
+  size_t received() const { return received_.load(); }
+
+ private:
+  int socket_;
+  uint16_t port_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<size_t> received_{0};
+  std::thread thread_;
+};
+
+}  // namespace socket_test
+
+#endif  // RUNNER_TEST_SOCKET_TEST_UTIL_H_
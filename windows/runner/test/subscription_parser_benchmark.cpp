@@ -0,0 +1,158 @@
+#include "subscription_parser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+#include "base64.h"
+#include "subscription_helper.h"
+
+namespace {
+
+constexpr size_t kLines = 50000;
+constexpr size_t kChunk = 64 * 1024;
+
+std::string Encode(const std::string& data) {
+  const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve(data.size() / 3 * 4 + 4);
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t word = (uint8_t)data[i] << 16;
+    if (i + 1 < data.size()) word |= (uint8_t)data[i + 1] << 8;
+    if (i + 2 < data.size()) word |= (uint8_t)data[i + 2];
+    out.push_back(alphabet[(word >> 18) & 63]);
+    out.push_back(alphabet[(word >> 12) & 63]);
+    out.push_back(i + 1 < data.size() ? alphabet[(word >> 6) & 63] : '=');
+    out.push_back(i + 2 < data.size() ? alphabet[word & 63] : '=');
+  }
+  return out;
+}
+
+// SIP002: userinfo в base64url без паддинга
+std::string EncodeUrl(const std::string& data) {
+  std::string out = Encode(data);
+  while (!out.empty() && out.back() == '=') out.pop_back();
+  for (char& c : out) c = c == '+' ? '-' : c == '/' ? '_' : c;
+  return out;
+}
+
+// Подписка крупного провайдера: 50 тыс. ссылок, больше всего vless с
+// Reality и WebSocket, затем vmess, trojan и ss, около 200 байт на ссылку
+const std::string& PlainBody() {
+  static const std::string body = [] {
+    std::mt19937 random(7);
+    std::string lines;
+    for (size_t i = 0; i < kLines; i++) {
+      std::string host = "node" + std::to_string(i) + ".provider-" +
+                         std::to_string(random() % 40) + ".example.com";
+      std::string port = std::to_string(443 + random() % 2000);
+      std::string uuid = "b831381d-6324-4d53-ad4f-" + std::to_string(100000000000ull + i);
+      switch (random() % 10) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+          lines += "vless://" + uuid + "@" + host + ":" + port +
+                   "?encryption=none&flow=xtls-rprx-vision&security=reality&sni=www.microsoft.com"
+                   "&fp=chrome&pbk=SbVKOEMjK0sIlbwg4akyBg5mL5KZwwB-ed4eEE7YnRc&sid=6ba85179e30d4fc2"
+                   "&type=tcp#%F0%9F%87%A9%F0%9F%87%AA%20Germany%20" + std::to_string(i) + "\n";
+          break;
+        case 4:
+        case 5:
+          lines += "vless://" + uuid + "@" + host + ":" + port +
+                   "?type=ws&security=tls&path=%2Fws%3Fed%3D2048&host=" + host + "#WS%20" +
+                   std::to_string(i) + "\n";
+          break;
+        case 6:
+        case 7:
+          lines += "vmess://" +
+                   Encode("{\"v\": \"2\", \"ps\": \"US " + std::to_string(i) + "\", \"add\": \"" +
+                          host + "\", \"port\": \"" + port + "\", \"id\": \"" + uuid +
+                          "\", \"aid\": \"0\", \"net\": \"ws\", \"type\": \"none\", \"host\": \"" +
+                          host + "\", \"path\": \"/v\", \"tls\": \"tls\"}") +
+                   "\n";
+          break;
+        case 8:
+          lines += "trojan://password" + std::to_string(i) + "@" + host + ":" + port +
+                   "?security=tls&sni=" + host + "&type=tcp#Trojan%20" + std::to_string(i) + "\n";
+          break;
+        default:
+          lines += "ss://" + EncodeUrl("chacha20-ietf-poly1305:secret" + std::to_string(i)) + "@" +
+                   host + ":" + port + "#SS%20" + std::to_string(i) + "\n";
+          break;
+      }
+    }
+    return lines;
+  }();
+  return body;
+}
+
+const std::string& Base64Body() {
+  static const std::string body = Encode(PlainBody());
+  return body;
+}
+
+// Декодирование тела подписки. Аргумент: 0 - таблица, 1 - SSSE3, 2 - AVX2
+void BM_Base64Decode(benchmark::State& state) {
+  Base64Simd simd = (Base64Simd)state.range(0);
+  if (simd > Base64SupportedSimd()) {
+    state.SkipWithError("not supported by this CPU");
+    return;
+  }
+  SetBase64SimdLimit(simd);
+  const std::string& body = Base64Body();
+  std::string decoded;
+  decoded.reserve(body.size());
+  for (auto _ : state) {
+    decoded.clear();
+    Base64Decoder decoder;
+    for (size_t offset = 0; offset < body.size(); offset += kChunk) {
+      decoder.Update(body.data() + offset, std::min(kChunk, body.size() - offset), &decoded);
+    }
+    decoder.Finish(&decoded);
+    benchmark::DoNotOptimize(decoded.data());
+  }
+  SetBase64SimdLimit(Base64Simd::kAvx2);
+  state.SetBytesProcessed((int64_t)(state.iterations() * body.size()));
+}
+BENCHMARK(BM_Base64Decode)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
+
+// Полный разбор фрагментами по 64 КБ. Аргумент: 0 - ссылки строками,
+// 1 - тело в base64 (как отдает большинство провайдеров)
+void BM_ParseSubscription(benchmark::State& state) {
+  const std::string& body = state.range(0) != 0 ? Base64Body() : PlainBody();
+  size_t servers = 0;
+  for (auto _ : state) {
+    SubscriptionParser parser;
+    for (size_t offset = 0; offset < body.size(); offset += kChunk) {
+      parser.Feed(body.data() + offset, std::min(kChunk, body.size() - offset));
+    }
+    parser.Finish();
+    servers = parser.entries().size();
+  }
+  if (servers != kLines) {
+    state.SkipWithError("lost servers");
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * kLines));
+  state.SetBytesProcessed((int64_t)(state.iterations() * body.size()));
+}
+BENCHMARK(BM_ParseSubscription)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Как из Dart: экспорт и блок результата для FFI
+void BM_ParseToResultBlock(benchmark::State& state) {
+  const std::string& body = Base64Body();
+  for (auto _ : state) {
+    void* parser = SubscriptionParserCreate();
+    for (size_t offset = 0; offset < body.size(); offset += kChunk) {
+      SubscriptionParserFeed(parser, body.data() + offset,
+                             (int32_t)std::min(kChunk, body.size() - offset));
+    }
+    benchmark::DoNotOptimize(SubscriptionParserFinish(parser));
+    SubscriptionParserDestroy(parser);
+  }
+  state.SetItemsProcessed((int64_t)(state.iterations() * kLines));
+}
+BENCHMARK(BM_ParseToResultBlock)->Unit(benchmark::kMillisecond);
+
+}  // namespace
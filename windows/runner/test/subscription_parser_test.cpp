@@ -0,0 +1,236 @@
+#include "subscription_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "server_block.h"
+#include "subscription_helper.h"
+
+namespace {
+
+std::string Encode(const std::string& data) {
+  const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t word = (uint8_t)data[i] << 16;
+    if (i + 1 < data.size()) word |= (uint8_t)data[i + 1] << 8;
+    if (i + 2 < data.size()) word |= (uint8_t)data[i + 2];
+    out.push_back(alphabet[(word >> 18) & 63]);
+    out.push_back(alphabet[(word >> 12) & 63]);
+    out.push_back(i + 1 < data.size() ? alphabet[(word >> 6) & 63] : '=');
+    out.push_back(i + 2 < data.size() ? alphabet[word & 63] : '=');
+  }
+  return out;
+}
+
+// SIP002: userinfo в base64url без паддинга
+std::string EncodeUrl(const std::string& data) {
+  std::string out = Encode(data);
+  while (!out.empty() && out.back() == '=') out.pop_back();
+  for (char& c : out) c = c == '+' ? '-' : c == '/' ? '_' : c;
+  return out;
+}
+
+// Сервер одной строкой: протокол|порт|id|адрес|тег|ключ=значение&...
+std::vector<std::string> Dump(const SubscriptionParser& parser) {
+  const char* const kProtocols[] = {"vless", "vmess", "trojan", "ss"};
+  auto text = [&](const TextSpan& span) { return parser.text().substr(span.offset, span.length); };
+  std::vector<std::string> servers;
+  for (const SubscriptionEntry& entry : parser.entries()) {
+    std::string server = std::string(kProtocols[(int)entry.protocol]) + "|" +
+                         std::to_string(entry.port) + "|" + text(entry.id) + "|" +
+                         text(entry.address) + "|" + text(entry.tag) + "|";
+    for (uint32_t i = 0; i < entry.param_count; i++) {
+      if (i > 0) server += "&";
+      server += text(parser.params()[entry.first_param + 2 * i]) + "=" +
+                text(parser.params()[entry.first_param + 2 * i + 1]);
+    }
+    servers.push_back(server);
+  }
+  return servers;
+}
+
+std::vector<std::string> Parse(const std::string& body, size_t chunk = 0,
+                               size_t* skipped = nullptr) {
+  SubscriptionParser parser;
+  if (chunk == 0) chunk = body.size() + 1;
+  for (size_t offset = 0; offset < body.size(); offset += chunk) {
+    parser.Feed(body.data() + offset, std::min(chunk, body.size() - offset));
+  }
+  parser.Finish();
+  if (skipped != nullptr) *skipped = parser.skipped();
+  return Dump(parser);
+}
+
+const char kVmessJson[] =
+    R"({"v": "2", "ps": "Tokyo 01", "add": "JP.example.com", "port": "8443",)"
+    R"( "id": "b831381d-6324-4d53-ad4f-8cda48b30811", "aid": 0, "scy": "auto",)"
+    R"( "net": "ws", "type": "none", "host": "cdn.example.com", "path": "/ws", "tls": "tls"})";
+
+// Подписка со всеми видами ссылок и ожидаемый разбор
+std::string Lines() {
+  return "vless://b831381d-6324-4d53-ad4f-8cda48b30811@Example.COM:443"
+         "?type=ws&security=tls&path=%2Fray%3Fed%3D2048&host=a+b#Frankfurt%20%231\n"
+         "vless://uuid@[2001:db8::1]:8443?security=reality&pbk=KEY#v6\n"
+         "trojan://pass%40word@trojan.example.net:443?sni=t.example.net#Trojan\n"
+         "ss://" + EncodeUrl("aes-256-gcm:secret") + "@ss.example.org:8388#SIP002\n"
+         "ss://chacha20-ietf-poly1305:p%40ss@1.2.3.4:8389/?plugin=obfs-local#Plain\n"
+         "ss://" + Encode("aes-128-gcm:old@legacy.example.org:443") + "#Legacy\n"
+         "vmess://" + Encode(kVmessJson) + "\n";
+}
+
+const std::vector<std::string> kExpected = {
+    "vless|443|b831381d-6324-4d53-ad4f-8cda48b30811|example.com|Frankfurt #1|"
+    "type=ws&security=tls&path=/ray?ed=2048&host=a b",
+    "vless|8443|uuid|2001:db8::1|v6|security=reality&pbk=KEY",
+    "trojan|443|pass@word|trojan.example.net|Trojan|sni=t.example.net",
+    "ss|8388|secret|ss.example.org|SIP002|method=aes-256-gcm",
+    "ss|8389|p@ss|1.2.3.4|Plain|method=chacha20-ietf-poly1305&plugin=obfs-local",
+    "ss|443|old|legacy.example.org|Legacy|method=aes-128-gcm",
+    "vmess|8443|b831381d-6324-4d53-ad4f-8cda48b30811|jp.example.com|Tokyo 01|"
+    "aid=0&scy=auto&type=ws&headerType=none&host=cdn.example.com&path=/ws&security=tls",
+};
+
+TEST(SubscriptionParserTest, ParsesEveryProtocol) {
+  size_t skipped = 0;
+  EXPECT_EQ(Parse(Lines(), 0, &skipped), kExpected);
+  EXPECT_EQ(skipped, 0u);
+}
+
+TEST(SubscriptionParserTest, Base64Body) {
+  EXPECT_EQ(Parse(Encode(Lines())), kExpected);
+  // Пробельные символы до и после тела
+  EXPECT_EQ(Parse("\r\n  " + Encode(Lines()) + "\r\n\r\n"), kExpected);
+}
+
+// Разрез на фрагменты в любом месте не меняет результата
+TEST(SubscriptionParserTest, ChunkingDoesNotChangeResult) {
+  std::string plain = Lines();
+  std::string encoded = Encode(plain);
+  for (size_t chunk : {1, 2, 3, 5, 8, 13, 64, 333}) {
+    EXPECT_EQ(Parse(plain, chunk), kExpected) << chunk;
+    EXPECT_EQ(Parse(encoded, chunk), kExpected) << chunk;
+  }
+}
+
+// Строки в base64 по одной, CRLF и одиночный CR, пустые строки
+TEST(SubscriptionParserTest, PerLineBase64AndLineEndings) {
+  std::string body = "\r\n" + Encode("trojan://p@one.example:443#1") + "\r\n\r\n" +
+                     "trojan://p@two.example:443#2\rtrojan://p@three.example:443#3\n\n";
+  std::vector<std::string> servers = Parse(body);
+  ASSERT_EQ(servers.size(), 3u);
+  EXPECT_EQ(servers[0], "trojan|443|p|one.example|1|");
+  EXPECT_EQ(servers[2], "trojan|443|p|three.example|3|");
+}
+
+TEST(SubscriptionParserTest, CountsSkippedLines) {
+  std::string body =
+      "vless://id@host.example:443#ok\n"
+      "vless://id@host.example#no-port\n"
+      "vless://id@host.example:0\n"
+      "vless://id@host.example:70000\n"
+      "vless://id@[::1:443\n"
+      "ss://bm90LWJhc2U2NA@host.example:1\n"
+      "vmess://" + Encode("{\"add\": \"a.example\"}") + "\n"
+      "vmess://not-base64!\n"
+      "hysteria2://pass@host.example:443\n"
+      "just text\n";
+  size_t skipped = 0;
+  std::vector<std::string> servers = Parse(body, 0, &skipped);
+  ASSERT_EQ(servers.size(), 1u);
+  EXPECT_EQ(servers[0], "vless|443|id|host.example|ok|");
+  EXPECT_EQ(skipped, 9u);
+}
+
+// Начало похоже на base64, но дальше - нет: тело разбирается строками,
+// а разобранное из "декодированного" начала отбрасывается
+TEST(SubscriptionParserTest, FallsBackToLines) {
+  std::string body = "abcd\nvless://id@host.example:443#x\n";
+  for (size_t chunk : {0, 1, 3, 6}) {
+    size_t skipped = 0;
+    std::vector<std::string> servers = Parse(body, chunk, &skipped);
+    ASSERT_EQ(servers.size(), 1u) << chunk;
+    EXPECT_EQ(servers[0], "vless|443|id|host.example|x|");
+    EXPECT_EQ(skipped, 1u);
+  }
+
+  // Недопустимый символ внутри длинного начала
+  std::string garbage = std::string(1000, 'A') + "!\ntrojan://p@t.example:443\n";
+  EXPECT_EQ(Parse(garbage, 100).size(), 1u);
+}
+
+// Строка длиннее kMaxLine пропускается, остальные разбираются
+TEST(SubscriptionParserTest, SkipsOverlongLines) {
+  std::string overlong = "vless://id@host.example:443?x=" +
+                         std::string(SubscriptionParser::kMaxLine, 'a') + "\n";
+  std::string body = overlong + "trojan://p@t.example:443#after\n";
+  for (size_t chunk : {0, 4096}) {
+    size_t skipped = 0;
+    std::vector<std::string> servers = Parse(body, chunk, &skipped);
+    ASSERT_EQ(servers.size(), 1u);
+    EXPECT_EQ(servers[0], "trojan|443|p|t.example|after|");
+    EXPECT_EQ(skipped, 1u);
+  }
+
+  // Не base64 и начало тела длиннее kMaxLine
+  std::string long_start = std::string(SubscriptionParser::kMaxLine + 10, 'A') + "\n-!-\n" +
+                           "trojan://p@t.example:443\n";
+  size_t skipped = 0;
+  EXPECT_EQ(Parse(long_start, 1000, &skipped).size(), 1u);
+  EXPECT_EQ(skipped, 2u);
+}
+
+TEST(SubscriptionParserTest, ResetClearsResult) {
+  SubscriptionParser parser;
+  std::string body = Lines();
+  parser.Feed(body.data(), body.size());
+  parser.Finish();
+  ASSERT_FALSE(parser.entries().empty());
+  parser.Reset();
+  EXPECT_TRUE(parser.entries().empty());
+  EXPECT_TRUE(parser.text().empty());
+  std::string encoded = Encode(body);
+  parser.Feed(encoded.data(), encoded.size());
+  parser.Finish();
+  EXPECT_EQ(Dump(parser), kExpected);
+}
+
+// Экспорт для Dart: блок результата в раскладке subscription_helper.h
+TEST(SubscriptionHelperTest, ResultBlock) {
+  void* parser = SubscriptionParserCreate();
+  ASSERT_NE(parser, nullptr);
+  std::string body = Encode(Lines() + "bad line\n");
+  for (size_t offset = 0; offset < body.size(); offset += 100) {
+    ASSERT_EQ(SubscriptionParserFeed(parser, body.data() + offset,
+                                     (int32_t)std::min<size_t>(100, body.size() - offset)),
+              1);
+  }
+  const int32_t* block = SubscriptionParserFinish(parser);
+  ASSERT_NE(block, nullptr);
+  EXPECT_EQ(SubscriptionParserFinish(parser), block);
+  EXPECT_EQ(SubscriptionParserFeed(parser, "x", 1), 0);
+
+  EXPECT_EQ(block[SUBSCRIPTION_ENTRIES], (int32_t)kExpected.size());
+  EXPECT_EQ(block[SUBSCRIPTION_SKIPPED], 1);
+  size_t ints = SUBSCRIPTION_HEADER_FIELDS +
+                (size_t)block[SUBSCRIPTION_ENTRIES] * SUBSCRIPTION_RECORD_FIELDS +
+                (size_t)block[SUBSCRIPTION_PARAMS] * 4 +
+                ((size_t)block[SUBSCRIPTION_TEXT] + 3) / 4;
+  ServerBlockView view;
+  ASSERT_TRUE(DecodeServerBlock(block, ints, &view));
+  ASSERT_EQ(view.count, kExpected.size());
+  const int32_t* trojan = view.records + 2 * SUBSCRIPTION_RECORD_FIELDS;
+  EXPECT_EQ(trojan[SUBSCRIPTION_PROTOCOL], 2);
+  EXPECT_EQ(trojan[SUBSCRIPTION_PORT], 443);
+  EXPECT_EQ(std::string(view.text + trojan[SUBSCRIPTION_ADDRESS_OFFSET],
+                        (size_t)trojan[SUBSCRIPTION_ADDRESS_LENGTH]),
+            "trojan.example.net");
+  SubscriptionParserDestroy(parser);
+
+  EXPECT_EQ(SubscriptionParserFeed(nullptr, "x", 1), 0);
+  EXPECT_EQ(SubscriptionParserFinish(nullptr), nullptr);
+}
+
+}  // namespace
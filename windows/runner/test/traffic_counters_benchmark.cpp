@@ -0,0 +1,46 @@
+#include "traffic_counters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+
+namespace {
+
+// Учет пакета из пакетного тракта: каждый поток бенчмарка - отдельный
+// поток пакетного тракта
+void BM_ShardedAddPacket(benchmark::State& state) {
+  static TrafficCounters counters;
+  size_t length = 64 + (size_t)state.thread_index() * 16;
+  for (auto _ : state) {
+    counters.AddPacket(TrafficDirection::kInbound, length);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    benchmark::DoNotOptimize(counters.Snapshot());
+  }
+}
+BENCHMARK(BM_ShardedAddPacket)->ThreadRange(1, 8)->UseRealTime();
+
+// Для сравнения: один общий атомик на все потоки
+void BM_SingleAtomicAddPacket(benchmark::State& state) {
+  static std::atomic<uint64_t> bytes{0};
+  static std::atomic<uint64_t> packets{0};
+  size_t length = 64 + (size_t)state.thread_index() * 16;
+  for (auto _ : state) {
+    bytes.fetch_add(length, std::memory_order_relaxed);
+    packets.fetch_add(1, std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SingleAtomicAddPacket)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_Snapshot(benchmark::State& state) {
+  TrafficCounters counters;
+  counters.AddPacket(TrafficDirection::kOutbound, 1500);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(counters.Snapshot());
+  }
+}
+BENCHMARK(BM_Snapshot);
+
+}  // namespace
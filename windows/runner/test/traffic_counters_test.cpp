@@ -0,0 +1,122 @@
+#include "traffic_counters.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Синтетические пакеты: длина зависит от потока и номера, чтобы потерянное
+// или задвоенное слагаемое меняло сумму
+size_t PacketLength(int thread, int index) { return 40 + (size_t)((thread * 131 + index * 7) % 1460); }
+
+TEST(TrafficCountersTest, CountsBothDirections) {
+  TrafficCounters counters;
+  counters.AddPacket(TrafficDirection::kInbound, 1500);
+  counters.AddPacket(TrafficDirection::kOutbound, 60);
+  counters.AddBatch(TrafficDirection::kInbound, 3000, 2);
+
+  TrafficSnapshot snapshot = counters.Snapshot();
+  EXPECT_EQ(snapshot.downloaded_bytes, 4500u);
+  EXPECT_EQ(snapshot.downloaded_packets, 3u);
+  EXPECT_EQ(snapshot.uploaded_bytes, 60u);
+  EXPECT_EQ(snapshot.uploaded_packets, 1u);
+}
+
+TEST(TrafficCountersTest, ResetStartsFromZero) {
+  TrafficCounters counters;
+  counters.AddPacket(TrafficDirection::kInbound, 1000);
+  counters.Reset();
+  TrafficSnapshot snapshot = counters.Snapshot();
+  EXPECT_EQ(snapshot.downloaded_bytes, 0u);
+  EXPECT_EQ(snapshot.downloaded_packets, 0u);
+
+  counters.AddPacket(TrafficDirection::kOutbound, 200);
+  snapshot = counters.Snapshot();
+  EXPECT_EQ(snapshot.uploaded_bytes, 200u);
+  EXPECT_EQ(snapshot.downloaded_bytes, 0u);
+}
+
+// Потоки проигрывают пакеты одновременно; итог совпадает с суммой до байта
+TEST(TrafficCountersTest, ExactTotalsFromManyThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kPackets = 200000;
+  TrafficCounters counters;
+
+  uint64_t expected_rx = 0;
+  uint64_t expected_tx = 0;
+  for (int thread = 0; thread < kThreads; thread++) {
+    for (int i = 0; i < kPackets; i++) {
+      (i % 3 == 0 ? expected_tx : expected_rx) += PacketLength(thread, i);
+    }
+  }
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kThreads; thread++) {
+    threads.emplace_back([&counters, thread] {
+      for (int i = 0; i < kPackets; i++) {
+        counters.AddPacket(i % 3 == 0 ? TrafficDirection::kOutbound : TrafficDirection::kInbound,
+                           PacketLength(thread, i));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  TrafficSnapshot snapshot = counters.Snapshot();
+  uint64_t tx_packets = (uint64_t)kThreads * ((kPackets + 2) / 3);
+  EXPECT_EQ(snapshot.downloaded_bytes, expected_rx);
+  EXPECT_EQ(snapshot.uploaded_bytes, expected_tx);
+  EXPECT_EQ(snapshot.uploaded_packets, tx_packets);
+  EXPECT_EQ(snapshot.downloaded_packets, (uint64_t)kThreads * kPackets - tx_packets);
+}
+
+// Reset() и Snapshot() во время записи: снимок не уходит в минус (не
+// переполняется) и не превышает записанного с начала теста
+TEST(TrafficCountersTest, SnapshotConsistentWithConcurrentReset) {
+  constexpr int kWriters = 4;
+  constexpr int kPackets = 100000;
+  constexpr uint64_t kLength = 100;
+  TrafficCounters counters;
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kWriters; thread++) {
+    threads.emplace_back([&counters] {
+      for (int i = 0; i < kPackets; i++) {
+        counters.AddPacket(TrafficDirection::kInbound, kLength);
+        counters.AddPacket(TrafficDirection::kOutbound, kLength);
+      }
+    });
+  }
+  std::thread resetter([&counters, &done] {
+    while (!done.load(std::memory_order_relaxed)) {
+      counters.Reset();
+      std::this_thread::yield();
+    }
+  });
+
+  constexpr uint64_t kLimit = kWriters * kPackets * kLength;
+  bool consistent = true;
+  for (int i = 0; i < 20000 && consistent; i++) {
+    TrafficSnapshot snapshot = counters.Snapshot();
+    consistent = snapshot.downloaded_bytes <= kLimit && snapshot.uploaded_bytes <= kLimit &&
+                 snapshot.downloaded_packets <= kLimit / kLength &&
+                 snapshot.uploaded_packets <= kLimit / kLength;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  done.store(true, std::memory_order_relaxed);
+  resetter.join();
+  EXPECT_TRUE(consistent);
+
+  counters.Reset();
+  counters.AddPacket(TrafficDirection::kInbound, kLength);
+  EXPECT_EQ(counters.Snapshot().downloaded_bytes, kLength);
+}
+
+}  // namespace
@@ -0,0 +1,94 @@
+#include "traffic_sniffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "sniff_test_util.h"
+
+namespace {
+
+using sniff_test::ClientHello;
+using sniff_test::CryptoFrame;
+using sniff_test::Dcid;
+using sniff_test::QuicInitial;
+using sniff_test::TlsRecords;
+
+// Аргумент - размер key_share: 32 (X25519, ClientHello около 500 байт) или
+// 1216 (X25519Kyber768, около 1700 байт, как у Chrome 124+)
+std::vector<uint8_t> Records(int64_t key_share) {
+  return TlsRecords(ClientHello("www.example-video.com", (size_t)key_share));
+}
+
+// ClientHello в одном сегменте: разбор на месте, без копирования
+void BM_SniffTls(benchmark::State& state) {
+  std::vector<uint8_t> records = Records(state.range(0));
+  for (auto _ : state) {
+    FlowSniffer sniffer;
+    SniffResult result = sniffer.FeedStream(1, records.data(), records.size());
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.SetBytesProcessed((int64_t)(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SniffTls)->Arg(32)->Arg(1216);
+
+// ClientHello в сегментах MSS 1460 (накопление в буфере FlowSniffer)
+void BM_SniffTlsSegmented(benchmark::State& state) {
+  std::vector<uint8_t> records = Records(state.range(0));
+  constexpr size_t kMss = 1460;
+  for (auto _ : state) {
+    FlowSniffer sniffer;
+    SniffResult result;
+    for (size_t offset = 0; offset < records.size(); offset += kMss) {
+      size_t length = std::min(kMss, records.size() - offset);
+      result = sniffer.FeedStream(1 + (uint32_t)offset, records.data() + offset, length);
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.SetBytesProcessed((int64_t)(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SniffTlsSegmented)->Arg(1216);
+
+void BM_SniffHttp(benchmark::State& state) {
+  std::vector<uint8_t> request = sniff_test::HttpRequest("www.example-video.com");
+  for (auto _ : state) {
+    FlowSniffer sniffer;
+    SniffResult result = sniffer.FeedStream(1, request.data(), request.size());
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.SetBytesProcessed((int64_t)(state.iterations() * request.size()));
+}
+BENCHMARK(BM_SniffHttp);
+
+// Первая датаграмма QUIC (1200 байт): вывод ключей Initial из DCID,
+// снятие защиты заголовка и расшифровка AES-128-GCM
+void BM_SniffQuicInitial(benchmark::State& state) {
+  std::vector<uint8_t> packet = QuicInitial(
+      sniff_test::kQuicV1, Dcid(1), {CryptoFrame(0, ClientHello("www.example-video.com"))});
+  for (auto _ : state) {
+    FlowSniffer sniffer;
+    SniffResult result = sniffer.FeedDatagram(packet.data(), packet.size());
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+  state.SetBytesProcessed((int64_t)(state.iterations() * packet.size()));
+}
+BENCHMARK(BM_SniffQuicInitial);
+
+// Поток, не похожий ни на один протокол: цена разбора для остального трафика
+void BM_SniffNoMatch(benchmark::State& state) {
+  std::vector<uint8_t> data(1400, 0x5a);
+  for (auto _ : state) {
+    FlowSniffer sniffer;
+    SniffResult result = sniffer.FeedStream(1, data.data(), data.size());
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations());
+}
+BENCHMARK(BM_SniffNoMatch);
+
+}  // namespace
@@ -0,0 +1,407 @@
+#include "traffic_sniffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sniff_test_util.h"
+
+namespace {
+
+using sniff_test::ClientHello;
+using sniff_test::CryptoFrame;
+using sniff_test::Dcid;
+using sniff_test::HttpRequest;
+using sniff_test::QuicInitial;
+using sniff_test::TlsRecords;
+
+std::string Host(const SniffResult& result) {
+  return result.host != nullptr ? std::string(result.host, result.host_length) : std::string();
+}
+
+// Поток, разрезанный на сегменты по |segment| байт, начиная с |sequence|
+SniffResult FeedSegments(FlowSniffer* sniffer, const std::vector<uint8_t>& data, size_t segment,
+                         uint32_t sequence = 1000) {
+  SniffResult result;
+  for (size_t offset = 0; offset < data.size(); offset += segment) {
+    size_t length = std::min(segment, data.size() - offset);
+    result = sniffer->FeedStream(sequence + (uint32_t)offset, data.data() + offset, length);
+    if (result.status != SniffStatus::kNeedMore) break;
+  }
+  return result;
+}
+
+std::vector<uint8_t> Slice(const std::vector<uint8_t>& data, size_t begin, size_t end) {
+  return std::vector<uint8_t>(data.begin() + (ptrdiff_t)begin, data.begin() + (ptrdiff_t)end);
+}
+
+TEST(TlsSnifferTest, ClientHelloInOneSegmentIsNotCopied) {
+  std::vector<uint8_t> records = TlsRecords(ClientHello("www.example.com"));
+  FlowSniffer sniffer;
+  SniffResult result = sniffer.FeedStream(1, records.data(), records.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(result.protocol, SniffProtocol::kTls);
+  EXPECT_EQ(Host(result), "www.example.com");
+  EXPECT_GE((const uint8_t*)result.host, records.data());
+  EXPECT_LT((const uint8_t*)result.host, records.data() + records.size());
+}
+
+// ClientHello с Kyber768 не помещается в один сегмент MSS 1460
+TEST(TlsSnifferTest, ClientHelloSplitAcrossSegments) {
+  std::vector<uint8_t> records = TlsRecords(ClientHello("pq.example.com", 1216));
+  ASSERT_GT(records.size(), 1460u);
+  for (size_t segment : {1, 3, 5, 100, 536, 1460}) {
+    FlowSniffer sniffer;
+    SniffResult result = FeedSegments(&sniffer, records, segment);
+    EXPECT_EQ(result.status, SniffStatus::kFound) << segment;
+    EXPECT_EQ(Host(result), "pq.example.com") << segment;
+  }
+}
+
+TEST(TlsSnifferTest, ClientHelloSplitAcrossRecords) {
+  std::vector<uint8_t> message = ClientHello("records.example.com", 1216);
+  for (size_t record : {1, 64, 512, 1000}) {
+    std::vector<uint8_t> records = TlsRecords(message, record);
+    FlowSniffer whole;
+    SniffResult result = whole.FeedStream(1, records.data(), records.size());
+    EXPECT_EQ(Host(result), "records.example.com") << record;
+
+    FlowSniffer segmented;
+    result = FeedSegments(&segmented, records, 700);
+    EXPECT_EQ(Host(result), "records.example.com") << record;
+  }
+}
+
+// Повтор сегмента пропускается, сегмент после пропуска ждет перепосылки,
+// перекрывающийся повтор дает только новые байты
+TEST(TlsSnifferTest, RetransmissionAndGap) {
+  std::vector<uint8_t> records = TlsRecords(ClientHello("retry.example.com"));
+  FlowSniffer sniffer;
+  EXPECT_EQ(sniffer.FeedStream(100, records.data(), 50).status, SniffStatus::kNeedMore);
+  EXPECT_EQ(sniffer.FeedStream(100, records.data(), 50).status, SniffStatus::kNeedMore);
+  EXPECT_EQ(sniffer.FeedStream(200, records.data() + 100, records.size() - 100).status,
+            SniffStatus::kNeedMore);
+  SniffResult result = sniffer.FeedStream(140, records.data() + 40, 100);
+  EXPECT_EQ(result.status, SniffStatus::kNeedMore);
+  result = sniffer.FeedStream(200, records.data() + 100, records.size() - 100);
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(Host(result), "retry.example.com");
+}
+
+TEST(TlsSnifferTest, SequenceWrapsAround) {
+  std::vector<uint8_t> records = TlsRecords(ClientHello("wrap.example.com"));
+  FlowSniffer sniffer;
+  SniffResult result = FeedSegments(&sniffer, records, 64, 0xffffff00u);
+  EXPECT_EQ(Host(result), "wrap.example.com");
+}
+
+TEST(TlsSnifferTest, ClientHelloWithoutServerName) {
+  std::vector<uint8_t> records = TlsRecords(ClientHello(""));
+  FlowSniffer sniffer;
+  SniffResult result = sniffer.FeedStream(1, records.data(), records.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(result.protocol, SniffProtocol::kTls);
+  EXPECT_EQ(result.host, nullptr);
+}
+
+TEST(TlsSnifferTest, RejectsOtherHandshakesAndBadRecords) {
+  std::vector<uint8_t> message = ClientHello("x.example.com");
+  message[0] = 0x02;  // ServerHello
+  std::vector<uint8_t> records = TlsRecords(message);
+  FlowSniffer server_hello;
+  EXPECT_EQ(server_hello.FeedStream(1, records.data(), records.size()).status,
+            SniffStatus::kNoMatch);
+
+  // Вторая запись не Handshake
+  records = TlsRecords(ClientHello("x.example.com"), 100);
+  records[105] = 0x17;
+  FlowSniffer application_data;
+  EXPECT_EQ(application_data.FeedStream(1, records.data(), records.size()).status,
+            SniffStatus::kNoMatch);
+
+  // Имя с символом, недопустимым в имени хоста
+  records = TlsRecords(ClientHello("bad host"));
+  FlowSniffer bad_name;
+  SniffResult result = bad_name.FeedStream(1, records.data(), records.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(result.host, nullptr);
+}
+
+// ClientHello длиннее kMaxMessage не накапливается
+TEST(TlsSnifferTest, OversizedClientHelloStopsBuffering) {
+  std::vector<uint8_t> message = ClientHello("big.example.com", FlowSniffer::kMaxMessage);
+  std::vector<uint8_t> records = TlsRecords(message, 4096);
+  FlowSniffer sniffer;
+  EXPECT_EQ(FeedSegments(&sniffer, records, 1460).status, SniffStatus::kNoMatch);
+}
+
+TEST(HttpSnifferTest, HostHeader) {
+  std::vector<uint8_t> request = HttpRequest("www.example.com");
+  FlowSniffer sniffer;
+  SniffResult result = sniffer.FeedStream(1, request.data(), request.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(result.protocol, SniffProtocol::kHttp);
+  EXPECT_EQ(Host(result), "www.example.com");
+}
+
+TEST(HttpSnifferTest, PortsAndAddresses) {
+  struct Case {
+    const char* header;
+    const char* host;
+  } const kCases[] = {
+      {"example.com:8080", "example.com"},
+      {"[2001:db8::1]:443", "2001:db8::1"},
+      {"[2001:db8::1]", "2001:db8::1"},
+      {"192.0.2.10", "192.0.2.10"},
+      {"  spaced.example.com \t", "spaced.example.com"},
+  };
+  for (const Case& test : kCases) {
+    std::vector<uint8_t> request = HttpRequest(test.header, "POST");
+    FlowSniffer sniffer;
+    EXPECT_EQ(Host(sniffer.FeedStream(1, request.data(), request.size())), test.host)
+        << test.header;
+  }
+
+  std::string lower = "GET / HTTP/1.1\r\nhOsT: lower.example.com\r\n\r\n";
+  FlowSniffer sniffer;
+  EXPECT_EQ(Host(sniffer.FeedStream(1, (const uint8_t*)lower.data(), lower.size())),
+            "lower.example.com");
+}
+
+TEST(HttpSnifferTest, SplitRequestAndNoHost) {
+  std::vector<uint8_t> request = HttpRequest("split.example.com", "OPTIONS");
+  for (size_t segment : {1, 2, 7, 40}) {
+    FlowSniffer sniffer;
+    EXPECT_EQ(Host(FeedSegments(&sniffer, request, segment)), "split.example.com") << segment;
+  }
+
+  std::string old = "GET / HTTP/1.0\r\nAccept: */*\r\n\r\n";
+  FlowSniffer sniffer;
+  SniffResult result = sniffer.FeedStream(1, (const uint8_t*)old.data(), old.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(result.host, nullptr);
+}
+
+TEST(HttpSnifferTest, RejectsOtherProtocols) {
+  const char* const kOther[] = {"SSH-2.0-OpenSSH_9.6\r\n", "GET / SPDY/3\r\n\r\n",
+                                "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", "get / HTTP/1.1\r\n"};
+  for (const char* other : kOther) {
+    FlowSniffer sniffer;
+    EXPECT_EQ(sniffer.FeedStream(1, (const uint8_t*)other, strlen(other)).status,
+              SniffStatus::kNoMatch)
+        << other;
+  }
+}
+
+TEST(QuicSnifferTest, InitialVersions) {
+  for (uint32_t version : {sniff_test::kQuicV1, sniff_test::kQuicV2, sniff_test::kQuicDraft29}) {
+    std::vector<uint8_t> packet =
+        QuicInitial(version, Dcid(1), {CryptoFrame(0, ClientHello("quic.example.com"))});
+    FlowSniffer sniffer;
+    SniffResult result = sniffer.FeedDatagram(packet.data(), packet.size());
+    EXPECT_EQ(result.status, SniffStatus::kFound) << version;
+    EXPECT_EQ(result.protocol, SniffProtocol::kQuic);
+    EXPECT_EQ(Host(result), "quic.example.com");
+  }
+}
+
+// ClientHello с Kyber768 занимает два пакета Initial; Chrome к тому же
+// перемешивает фрагменты CRYPTO
+TEST(QuicSnifferTest, CryptoAcrossPacketsOutOfOrder) {
+  std::vector<uint8_t> hello = ClientHello("kyber.example.com", 1216);
+  std::vector<uint8_t> second =
+      QuicInitial(sniff_test::kQuicV1, Dcid(2),
+                  {CryptoFrame(900, Slice(hello, 900, hello.size())),
+                   CryptoFrame(0, Slice(hello, 0, 300))},
+                  1);
+  std::vector<uint8_t> first =
+      QuicInitial(sniff_test::kQuicV1, Dcid(2), {CryptoFrame(300, Slice(hello, 300, 900))}, 0);
+  FlowSniffer sniffer;
+  EXPECT_EQ(sniffer.FeedDatagram(second.data(), second.size()).status, SniffStatus::kNeedMore);
+  SniffResult result = sniffer.FeedDatagram(first.data(), first.size());
+  EXPECT_EQ(result.status, SniffStatus::kFound);
+  EXPECT_EQ(Host(result), "kyber.example.com");
+}
+
+// Initial и следом склеенный пакет Handshake в одной датаграмме
+TEST(QuicSnifferTest, CoalescedPackets) {
+  std::vector<uint8_t> hello = ClientHello("coalesced.example.com");
+  std::vector<uint8_t> datagram = QuicInitial(sniff_test::kQuicV1, Dcid(3),
+                                              {CryptoFrame(0, Slice(hello, 0, 200))}, 0, 600);
+  std::vector<uint8_t> rest = QuicInitial(sniff_test::kQuicV1, Dcid(3),
+                                          {CryptoFrame(200, Slice(hello, 200, hello.size()))}, 1,
+                                          600);
+  datagram.insert(datagram.end(), rest.begin(), rest.end());
+  FlowSniffer sniffer;
+  EXPECT_EQ(Host(sniffer.FeedDatagram(datagram.data(), datagram.size())),
+            "coalesced.example.com");
+}
+
+TEST(QuicSnifferTest, RejectsDamagedAndForeignPackets) {
+  std::vector<uint8_t> packet =
+      QuicInitial(sniff_test::kQuicV1, Dcid(4), {CryptoFrame(0, ClientHello("a.example.com"))});
+  std::vector<uint8_t> damaged = packet;
+  damaged[damaged.size() - 1] ^= 1;
+  FlowSniffer tag;
+  EXPECT_EQ(tag.FeedDatagram(damaged.data(), damaged.size()).status, SniffStatus::kNoMatch);
+
+  // Неизвестная версия и пакет с коротким заголовком
+  damaged = packet;
+  damaged[4] = 0x77;
+  FlowSniffer version;
+  EXPECT_EQ(version.FeedDatagram(damaged.data(), damaged.size()).status, SniffStatus::kNoMatch);
+  damaged = packet;
+  damaged[0] = 0x40;
+  FlowSniffer short_header;
+  EXPECT_EQ(short_header.FeedDatagram(damaged.data(), damaged.size()).status,
+            SniffStatus::kNoMatch);
+
+  // Датаграммы без ClientHello перестают разбираться после kMaxDatagrams
+  std::vector<uint8_t> hello = ClientHello("late.example.com");
+  std::vector<uint8_t> head =
+      QuicInitial(sniff_test::kQuicV1, Dcid(5), {CryptoFrame(0, Slice(hello, 0, 10))});
+  FlowSniffer limited;
+  for (int i = 0; i < FlowSniffer::kMaxDatagrams; i++) {
+    EXPECT_EQ(limited.FeedDatagram(head.data(), head.size()).status, SniffStatus::kNeedMore);
+  }
+  EXPECT_EQ(limited.FeedDatagram(head.data(), head.size()).status, SniffStatus::kNoMatch);
+}
+
+// Мутации корпуса: разбор не выходит за границы (проверяется под
+// -DRUNNER_SANITIZE=address), результат согласован, найденное имя - имя
+// хоста. RUNNER_SNIFFER_FUZZ_ITERATIONS задает число мутаций для долгого
+// прогона.
+class SnifferFuzzTest : public ::testing::Test {
+ protected:
+  static std::vector<std::vector<uint8_t>> StreamCorpus() {
+    return {TlsRecords(ClientHello("fuzz.example.com")),
+            TlsRecords(ClientHello("fuzz.example.com", 1216), 300),
+            TlsRecords(ClientHello("")),
+            HttpRequest("fuzz.example.com:8443"),
+            HttpRequest("[2001:db8::1]", "CONNECT")};
+  }
+
+  static std::vector<std::vector<uint8_t>> DatagramCorpus() {
+    std::vector<uint8_t> hello = ClientHello("fuzz.example.com");
+    return {QuicInitial(sniff_test::kQuicV1, Dcid(7), {CryptoFrame(0, hello)}),
+            QuicInitial(sniff_test::kQuicV2, Dcid(8), {CryptoFrame(0, hello)}, 5),
+            QuicInitial(sniff_test::kQuicV1, Dcid(9),
+                        {CryptoFrame(100, Slice(hello, 100, hello.size())),
+                         CryptoFrame(0, Slice(hello, 0, 100))},
+                        0, 0)};
+  }
+
+  static size_t Iterations() {
+    const char* value = std::getenv("RUNNER_SNIFFER_FUZZ_ITERATIONS");
+    return value != nullptr ? (size_t)std::strtoull(value, nullptr, 10) : 20000;
+  }
+
+  void Mutate(std::vector<uint8_t>* data) {
+    int mutations = 1 + (int)(random_() % 4);
+    for (int i = 0; i < mutations && !data->empty(); i++) {
+      size_t position = random_() % data->size();
+      switch (random_() % 6) {
+        case 0:
+          (*data)[position] ^= (uint8_t)(1 << (random_() % 8));
+          break;
+        case 1:
+          (*data)[position] = (uint8_t)random_();
+          break;
+        case 2:
+          // Длины: крайние значения
+          (*data)[position] = (random_() % 2) ? 0xff : 0x00;
+          break;
+        case 3:
+          data->resize(position);
+          break;
+        case 4:
+          data->insert(data->begin() + (ptrdiff_t)position, (size_t)(random_() % 32),
+                       (uint8_t)random_());
+          break;
+        default:
+          data->erase(data->begin() + (ptrdiff_t)position,
+                      data->begin() + (ptrdiff_t)std::min(data->size(),
+                                                          position + random_() % 32));
+          break;
+      }
+    }
+  }
+
+  static void Check(const SniffResult& result) {
+    ASSERT_TRUE(result.status == SniffStatus::kFound || result.status == SniffStatus::kNeedMore ||
+                result.status == SniffStatus::kNoMatch);
+    if (result.host == nullptr) {
+      EXPECT_EQ(result.host_length, 0u);
+      return;
+    }
+    ASSERT_EQ(result.status, SniffStatus::kFound);
+    ASSERT_GT(result.host_length, 0u);
+    ASSERT_LE(result.host_length, 253u);
+    for (size_t i = 0; i < result.host_length; i++) {
+      uint8_t c = (uint8_t)result.host[i];
+      ASSERT_TRUE(c > 0x20 && c < 0x7f && c != '/');
+    }
+  }
+
+  std::mt19937 random_{20240917};
+};
+
+TEST_F(SnifferFuzzTest, MutatedStreams) {
+  std::vector<std::vector<uint8_t>> corpus = StreamCorpus();
+  for (size_t i = 0; i < Iterations(); i++) {
+    std::vector<uint8_t> data = corpus[i % corpus.size()];
+    Mutate(&data);
+    if (data.empty()) continue;
+    FlowSniffer sniffer;
+    size_t segment = 1 + random_() % (i % 2 ? 1500 : 16);
+    uint32_t sequence = (uint32_t)random_();
+    for (size_t offset = 0; offset < data.size(); offset += segment) {
+      size_t length = std::min(segment, data.size() - offset);
+      // Изредка повтор предыдущего сегмента или сегмент из будущего
+      uint32_t position = (uint32_t)offset;
+      if (random_() % 16 == 0) position += (uint32_t)segment;
+      SniffResult result = sniffer.FeedStream(sequence + position, data.data() + offset, length);
+      Check(result);
+      if (HasFatalFailure()) return;
+      if (result.status != SniffStatus::kNeedMore) break;
+    }
+  }
+}
+
+TEST_F(SnifferFuzzTest, MutatedDatagrams) {
+  std::vector<std::vector<uint8_t>> corpus = DatagramCorpus();
+  for (size_t i = 0; i < Iterations() / 4; i++) {
+    FlowSniffer sniffer;
+    for (int datagram = 0; datagram < 3; datagram++) {
+      std::vector<uint8_t> data = corpus[(i + (size_t)datagram) % corpus.size()];
+      Mutate(&data);
+      SniffResult result = sniffer.FeedDatagram(data.data(), data.size());
+      Check(result);
+      if (HasFatalFailure()) return;
+      if (result.status != SniffStatus::kNeedMore) break;
+    }
+  }
+}
+
+TEST_F(SnifferFuzzTest, RandomBytes) {
+  for (size_t i = 0; i < Iterations(); i++) {
+    std::vector<uint8_t> data(1 + random_() % 2048);
+    for (uint8_t& byte : data) byte = (uint8_t)random_();
+    // Начало как у записи TLS, запроса HTTP или длинного заголовка QUIC
+    const uint8_t kStarts[][5] = {{0x16, 0x03, 0x01, 0x02, 0x00},
+                                  {'G', 'E', 'T', ' ', '/'},
+                                  {0xc3, 0x00, 0x00, 0x00, 0x01}};
+    const uint8_t* start = kStarts[i % 3];
+    memcpy(data.data(), start, std::min<size_t>(5, data.size()));
+    FlowSniffer stream;
+    Check(stream.FeedStream(0, data.data(), data.size()));
+    FlowSniffer datagram;
+    Check(datagram.FeedDatagram(data.data(), data.size()));
+    if (HasFatalFailure()) return;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,91 @@
+#include "udp_relay.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using socket_test::Loopback;
+
+sockaddr_storage Storage(const sockaddr_in& address) {
+  sockaddr_storage storage = {};
+  memcpy(&storage, &address, sizeof(address));
+  return storage;
+}
+
+// Датаграммы в секунду через ретранслятор и эхо-сервер: окно из kWindow
+// датаграмм отправляется одним sendmmsg и собирается recvmmsg. Аргумент -
+// размер полезной нагрузки: 100 байт (игровой трафик) и 1200 (QUIC).
+void BM_RelayPps(benchmark::State& state) {
+  constexpr size_t kWindow = 32;
+  const size_t payload = (size_t)state.range(0);
+
+  TrafficCounters counters;
+  UdpRelay relay(&counters, nullptr);
+  socket_test::UdpEchoServer echo;
+  if (!relay.Start(Storage(Loopback(0)), sizeof(sockaddr_in), 60000)) {
+    state.SkipWithError("relay failed");
+    return;
+  }
+  int client = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in address = Loopback(0);
+  bind(client, (sockaddr*)&address, sizeof(address));
+  socket_test::SetReceiveTimeout(client, 200);
+  relay.Associate(Storage(Loopback(socket_test::LocalPort(client))), sizeof(sockaddr_in));
+
+  // SOCKS5 UDP: RSV, FRAG, ATYP=IPv4, 127.0.0.1 и порт эхо-сервера
+  std::string datagram = {0, 0, 0, 1, 127, 0, 0, 1, (char)(echo.port() >> 8), (char)echo.port()};
+  datagram.resize(datagram.size() + payload, 'x');
+  sockaddr_in relay_address = Loopback(relay.port());
+
+  mmsghdr outgoing[kWindow] = {};
+  iovec outgoing_data[kWindow];
+  std::vector<char> incoming_buffers(kWindow * 2048);
+  mmsghdr incoming[kWindow] = {};
+  iovec incoming_data[kWindow];
+  for (size_t i = 0; i < kWindow; i++) {
+    outgoing_data[i] = {&datagram[0], datagram.size()};
+    outgoing[i].msg_hdr.msg_iov = &outgoing_data[i];
+    outgoing[i].msg_hdr.msg_iovlen = 1;
+    outgoing[i].msg_hdr.msg_name = &relay_address;
+    outgoing[i].msg_hdr.msg_namelen = sizeof(relay_address);
+    incoming_data[i] = {&incoming_buffers[i * 2048], 2048};
+    incoming[i].msg_hdr.msg_iov = &incoming_data[i];
+    incoming[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  uint64_t echoed = 0;
+  uint64_t lost = 0;
+  for (auto _ : state) {
+    int sent = sendmmsg(client, outgoing, kWindow, 0);
+    size_t expected = sent > 0 ? (size_t)sent : 0;
+    size_t received = 0;
+    while (received < expected) {
+      // Ждем первую датаграмму (не дольше таймаута сокета), остальные -
+      // сколько уже пришло
+      int count = recvmmsg(client, incoming, (unsigned)(expected - received), MSG_WAITFORONE,
+                           nullptr);
+      if (count <= 0) {
+        if (count < 0 && errno == EINTR) continue;
+        break;
+      }
+      received += (size_t)count;
+    }
+    echoed += received;
+    lost += kWindow - received;
+  }
+  close(client);
+  relay.Stop();
+
+  state.SetItemsProcessed((int64_t)echoed);
+  state.SetBytesProcessed((int64_t)(echoed * payload));
+  state.counters["lost"] = (double)lost;
+  state.SetLabel(relay.gso() || relay.gro() ? "gso/gro" : "no gso/gro");
+}
+BENCHMARK(BM_RelayPps)->Arg(100)->Arg(1200)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,215 @@
+#include "udp_relay.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_test_util.h"
+
+namespace {
+
+using socket_test::Loopback;
+
+// Заголовок SOCKS5 UDP: RSV, FRAG, ATYP и адрес назначения
+std::string Ipv4Header(uint32_t address, uint16_t port, uint8_t frag = 0) {
+  std::string header = {0, 0, (char)frag, 1};
+  for (int shift = 24; shift >= 0; shift -= 8) header.push_back((char)(address >> shift));
+  header.push_back((char)(port >> 8));
+  header.push_back((char)port);
+  return header;
+}
+
+std::string NameHeader(const std::string& host, uint16_t port) {
+  std::string header = {0, 0, 0, 3, (char)host.size()};
+  header += host;
+  header.push_back((char)(port >> 8));
+  header.push_back((char)port);
+  return header;
+}
+
+sockaddr_storage Storage(const sockaddr_in& address) {
+  sockaddr_storage storage = {};
+  memcpy(&storage, &address, sizeof(address));
+  return storage;
+}
+
+class UdpRelayTest : public ::testing::Test {
+ protected:
+  // Имена разрешаются в 127.0.0.1 (порт подставляет ретранслятор)
+  void StartRelay(UdpRelay::ResolveFunction resolve) {
+    relay_.reset(new UdpRelay(&counters_, std::move(resolve)));
+    relay_->set_fake_ips(&fake_ips_);
+    ASSERT_TRUE(relay_->Start(Storage(Loopback(0)), sizeof(sockaddr_in), 60000));
+
+    client_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = Loopback(0);
+    ASSERT_EQ(bind(client_, (sockaddr*)&address, sizeof(address)), 0);
+    socket_test::SetReceiveTimeout(client_, 2000);
+    ASSERT_NE(relay_->Associate(Storage(Loopback(socket_test::LocalPort(client_))),
+                                sizeof(sockaddr_in)),
+              0u);
+  }
+
+  void TearDown() override {
+    if (relay_) relay_->Stop();
+    if (client_ >= 0) close(client_);
+  }
+
+  void SendToRelay(const std::string& header, const std::string& payload) {
+    std::string datagram = header + payload;
+    sockaddr_in relay = Loopback(relay_->port());
+    ASSERT_EQ(sendto(client_, datagram.data(), datagram.size(), 0, (sockaddr*)&relay,
+                     sizeof(relay)),
+              (ssize_t)datagram.size());
+  }
+
+  // Датаграмма от ретранслятора или пустая строка по таймауту
+  std::string ReceiveFromRelay() {
+    char buffer[2048];
+    ssize_t received;
+    do {
+      received = recv(client_, buffer, sizeof(buffer), 0);
+    } while (received < 0 && errno == EINTR);
+    return received > 0 ? std::string(buffer, (size_t)received) : std::string();
+  }
+
+  static UdpRelay::ResolveFunction ResolveNow(std::atomic<int>* calls) {
+    return [calls](const std::string&, uint16_t, UdpRelay::ResolveCallback callback) {
+      (*calls)++;
+      sockaddr_storage address = Storage(Loopback(0));
+      callback(true, address, sizeof(sockaddr_in));
+    };
+  }
+
+  TrafficCounters counters_;
+  FakeIpTable fake_ips_;
+  std::unique_ptr<UdpRelay> relay_;
+  socket_test::UdpEchoServer echo_;
+  int client_ = -1;
+};
+
+TEST_F(UdpRelayTest, ForwardsAndWrapsReplies) {
+  std::atomic<int> calls{0};
+  StartRelay(ResolveNow(&calls));
+  std::string header = Ipv4Header(INADDR_LOOPBACK, echo_.port());
+  SendToRelay(header, "hello");
+  // Ответ приходит с заголовком, где указан отправитель
+  EXPECT_EQ(ReceiveFromRelay(), header + "hello");
+  EXPECT_EQ(calls.load(), 0);
+  EXPECT_EQ(relay_->session_count(), 1u);
+
+  TrafficSnapshot traffic = counters_.Snapshot();
+  EXPECT_EQ(traffic.uploaded_bytes, 5u);
+  EXPECT_EQ(traffic.downloaded_bytes, 5u);
+}
+
+// Ответ из DNS-кэша приходит внутри resolve: первая датаграмма к имени
+// раньше терялась, хотя адрес уже был известен
+TEST_F(UdpRelayTest, NameAnsweredFromCacheIsForwarded) {
+  std::atomic<int> calls{0};
+  StartRelay(ResolveNow(&calls));
+  SendToRelay(NameHeader("cached.test", echo_.port()), "first");
+  EXPECT_EQ(ReceiveFromRelay(), Ipv4Header(INADDR_LOOPBACK, echo_.port()) + "first");
+  SendToRelay(NameHeader("cached.test", echo_.port()), "second");
+  EXPECT_EQ(ReceiveFromRelay(), Ipv4Header(INADDR_LOOPBACK, echo_.port()) + "second");
+  EXPECT_EQ(calls.load(), 1);
+  EXPECT_EQ(relay_->dropped_count(), 0u);
+}
+
+// Медленное разрешение: датаграммы ждут ответа и уходят по порядку
+TEST_F(UdpRelayTest, DatagramsWaitForSlowResolution) {
+  std::mutex mutex;
+  std::vector<UdpRelay::ResolveCallback> waiting;
+  StartRelay([&](const std::string&, uint16_t, UdpRelay::ResolveCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    waiting.push_back(std::move(callback));
+  });
+  SendToRelay(NameHeader("slow.test", echo_.port()), "one");
+  SendToRelay(NameHeader("slow.test", echo_.port()), "two");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(waiting.size(), 1u);
+    waiting[0](true, Storage(Loopback(0)), sizeof(sockaddr_in));
+  }
+  std::string header = Ipv4Header(INADDR_LOOPBACK, echo_.port());
+  EXPECT_EQ(ReceiveFromRelay(), header + "one");
+  EXPECT_EQ(ReceiveFromRelay(), header + "two");
+  EXPECT_EQ(relay_->dropped_count(), 0u);
+}
+
+TEST_F(UdpRelayTest, FailedResolutionDropsWaitingDatagrams) {
+  std::mutex mutex;
+  std::vector<UdpRelay::ResolveCallback> waiting;
+  StartRelay([&](const std::string&, uint16_t, UdpRelay::ResolveCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    waiting.push_back(std::move(callback));
+  });
+  SendToRelay(NameHeader("missing.test", echo_.port()), "lost");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(waiting.size(), 1u);
+    waiting[0](false, sockaddr_storage(), 0);
+  }
+  for (int i = 0; i < 100 && relay_->dropped_count() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(relay_->dropped_count(), 1u);
+  EXPECT_EQ(echo_.received(), 0u);
+}
+
+// Фиктивный адрес fake-IP DNS отправляется по выданному за ним имени
+TEST_F(UdpRelayTest, FakeIpGoesByName) {
+  std::atomic<int> calls{0};
+  StartRelay(ResolveNow(&calls));
+  uint32_t fake = fake_ips_.Assign("game.test");
+  ASSERT_NE(fake, 0u);
+  SendToRelay(Ipv4Header(fake, echo_.port()), "fake");
+  EXPECT_EQ(ReceiveFromRelay(), Ipv4Header(INADDR_LOOPBACK, echo_.port()) + "fake");
+  EXPECT_EQ(calls.load(), 1);
+}
+
+TEST_F(UdpRelayTest, DropsFragmentsAndStrangers) {
+  std::atomic<int> calls{0};
+  StartRelay(ResolveNow(&calls));
+  SendToRelay(Ipv4Header(INADDR_LOOPBACK, echo_.port(), 1), "fragment");
+
+  // Отправитель без ассоциации
+  int stranger = socket(AF_INET, SOCK_DGRAM, 0);
+  std::string datagram = Ipv4Header(INADDR_LOOPBACK, echo_.port()) + "stranger";
+  sockaddr_in relay = Loopback(relay_->port());
+  sendto(stranger, datagram.data(), datagram.size(), 0, (sockaddr*)&relay, sizeof(relay));
+  close(stranger);
+
+  for (int i = 0; i < 100 && relay_->dropped_count() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(relay_->dropped_count(), 2u);
+  EXPECT_EQ(echo_.received(), 0u);
+}
+
+// Пачка мелких датаграмм (recvmmsg/sendmmsg, GSO/GRO) доходит целиком
+TEST_F(UdpRelayTest, BurstArrivesIntact) {
+  std::atomic<int> calls{0};
+  StartRelay(ResolveNow(&calls));
+  constexpr int kDatagrams = 200;
+  std::string header = Ipv4Header(INADDR_LOOPBACK, echo_.port());
+  for (int i = 0; i < kDatagrams; i++) {
+    SendToRelay(header, std::string(100, (char)i));
+  }
+  std::vector<int> seen(kDatagrams, 0);
+  for (int i = 0; i < kDatagrams; i++) {
+    std::string reply = ReceiveFromRelay();
+    ASSERT_EQ(reply.size(), header.size() + 100) << "datagram " << i;
+    seen[(uint8_t)reply[header.size()] % kDatagrams]++;
+  }
+  for (int count : seen) EXPECT_EQ(count, 1);
+}
+
+}  // namespace
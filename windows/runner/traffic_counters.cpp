@@ -0,0 +1,52 @@
+#include "traffic_counters.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+size_t TrafficCounters::CurrentShard() {
+#if defined(_WIN32)
+  DWORD cpu = ::GetCurrentProcessorNumber();
+  return static_cast<size_t>(cpu) & (kShardCount - 1);
+#else
+  int cpu = sched_getcpu();
+  if (cpu >= 0) {
+    return static_cast<size_t>(cpu) & (kShardCount - 1);
+  }
+  // sched_getcpu недоступен: закрепляем шард за потоком
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) & (kShardCount - 1);
+  return shard;
+#endif
+}
+
+TrafficSnapshot TrafficCounters::Fold() const {
+  TrafficSnapshot total;
+  for (const Shard& shard : shards_) {
+    total.downloaded_bytes += shard.rx_bytes.load(std::memory_order_relaxed);
+    total.uploaded_bytes += shard.tx_bytes.load(std::memory_order_relaxed);
+    total.downloaded_packets += shard.rx_packets.load(std::memory_order_relaxed);
+    total.uploaded_packets += shard.tx_packets.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+TrafficSnapshot TrafficCounters::Snapshot() const {
+  // Сумма берется после точки отсчета под тем же мьютексом: каждый счетчик
+  // читается не раньше, чем его прочитал Reset(), и разность не уходит в минус
+  std::lock_guard<std::mutex> lock(base_mutex_);
+  TrafficSnapshot total = Fold();
+  total.downloaded_bytes -= base_.downloaded_bytes;
+  total.uploaded_bytes -= base_.uploaded_bytes;
+  total.downloaded_packets -= base_.downloaded_packets;
+  total.uploaded_packets -= base_.uploaded_packets;
+  return total;
+}
+
+void TrafficCounters::Reset() {
+  std::lock_guard<std::mutex> lock(base_mutex_);
+  base_ = Fold();
+}
@@ -0,0 +1,85 @@
+#ifndef RUNNER_TRAFFIC_COUNTERS_H_
+#define RUNNER_TRAFFIC_COUNTERS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+// Направление пакета относительно локальной машины
+enum class TrafficDirection {
+  kInbound = 0,
+  kOutbound = 1,
+};
+
+// Свернутые значения счетчиков на момент вызова Snapshot()
+struct TrafficSnapshot {
+  uint64_t downloaded_bytes = 0;
+  uint64_t uploaded_bytes = 0;
+  uint64_t downloaded_packets = 0;
+  uint64_t uploaded_packets = 0;
+};
+
+// Счетчики трафика, разнесенные по процессорам. Каждый шард занимает
+// собственную кэш-линию, поэтому потоки пакетного тракта не конкурируют за
+// один атомик. Суммирование шардов выполняется только в Snapshot().
+class TrafficCounters {
+ public:
+  // Количество шардов (степень двойки, не меньше числа ядер у клиентов)
+  static constexpr size_t kShardCount = 64;
+  static constexpr size_t kCacheLineSize = 64;
+
+  TrafficCounters() = default;
+
+  TrafficCounters(const TrafficCounters&) = delete;
+  TrafficCounters& operator=(const TrafficCounters&) = delete;
+
+  // Учесть один пакет длиной |bytes|. Вызывается из пакетного тракта.
+  void AddPacket(TrafficDirection direction, size_t bytes) {
+    AddBatch(direction, bytes, 1);
+  }
+
+  // Учесть пачку из |packets| пакетов суммарной длиной |bytes|.
+  void AddBatch(TrafficDirection direction, size_t bytes, size_t packets) {
+    Shard& shard = shards_[CurrentShard()];
+    if (direction == TrafficDirection::kInbound) {
+      shard.rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+      shard.rx_packets.fetch_add(packets, std::memory_order_relaxed);
+    } else {
+      shard.tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+      shard.tx_packets.fetch_add(packets, std::memory_order_relaxed);
+    }
+  }
+
+  // Сложить все шарды и вычесть точку отсчета последнего Reset().
+  TrafficSnapshot Snapshot() const;
+
+  // Обнулить видимую статистику. Шарды не трогаются (это гонка с писателями),
+  // вместо этого запоминается текущая сумма как точка отсчета. Точка отсчета
+  // меняется целиком под base_mutex_, поэтому Snapshot() не видит ее
+  // наполовину обновленной и не уходит в минус.
+  void Reset();
+
+ private:
+  struct alignas(kCacheLineSize) Shard {
+    std::atomic<uint64_t> rx_bytes{0};
+    std::atomic<uint64_t> tx_bytes{0};
+    std::atomic<uint64_t> rx_packets{0};
+    std::atomic<uint64_t> tx_packets{0};
+  };
+
+  // Индекс шарда для текущего потока (номер процессора по модулю kShardCount)
+  static size_t CurrentShard();
+
+  TrafficSnapshot Fold() const;
+
+  Shard shards_[kShardCount];
+
+  // Писатели пакетного тракта мьютекс не берут: он только у Snapshot() и
+  // Reset(), которые вызываются с частотой опроса статистики
+  mutable std::mutex base_mutex_;
+  TrafficSnapshot base_;
+};
+
+#endif  // RUNNER_TRAFFIC_COUNTERS_H_
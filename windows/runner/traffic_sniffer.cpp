@@ -0,0 +1,586 @@
+#include "traffic_sniffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "quic_crypto.h"
+
+namespace {
+
+constexpr uint8_t kTlsContentHandshake = 0x16;
+constexpr uint8_t kTlsClientHello = 0x01;
+constexpr size_t kTlsRecordHeader = 5;
+constexpr size_t kTlsMaxRecord = 16384 + 256;
+constexpr size_t kHandshakeHeader = 4;
+constexpr uint16_t kTlsExtensionServerName = 0;
+constexpr size_t kMaxHost = 253;
+
+const char* const kHttpMethods[] = {"GET ",     "POST ",    "HEAD ",  "PUT ",  "DELETE ",
+                                    "OPTIONS ", "CONNECT ", "PATCH ", "TRACE "};
+
+struct QuicVersion {
+  uint32_t first;
+  uint32_t last;
+  uint8_t salt[20];
+  const char* key_label;
+  const char* iv_label;
+  const char* hp_label;
+  uint8_t initial_type;
+  uint8_t retry_type;
+};
+
+// RFC 9001 5.2, RFC 9369 3.3.1; draft-29..32 используют одну соль
+const QuicVersion kQuicVersions[] = {
+    {0x00000001, 0x00000001,
+     {0x38, 0x76, 0x2c, 0xf7, 0xf5, 0x59, 0x34, 0xb3, 0x4d, 0x17,
+      0x9a, 0xe6, 0xa4, 0xc8, 0x0c, 0xad, 0xcc, 0xbb, 0x7f, 0x0a},
+     "quic key", "quic iv", "quic hp", 0, 3},
+    {0x6b3343cf, 0x6b3343cf,
+     {0x0d, 0xed, 0xe3, 0xde, 0xf7, 0x00, 0xa6, 0xdb, 0x81, 0x93,
+      0x81, 0xbe, 0x6e, 0x26, 0x9d, 0xcb, 0xf9, 0xbd, 0x2e, 0xd9},
+     "quicv2 key", "quicv2 iv", "quicv2 hp", 1, 0},
+    {0xff00001d, 0xff000020,
+     {0xaf, 0xbf, 0xec, 0x28, 0x99, 0x93, 0xd2, 0x4c, 0x9e, 0x97,
+      0x86, 0xf1, 0x9c, 0x61, 0x11, 0xe0, 0x43, 0x90, 0xa8, 0x99},
+     "quic key", "quic iv", "quic hp", 0, 3},
+};
+
+const QuicVersion* FindQuicVersion(uint32_t version) {
+  for (const QuicVersion& known : kQuicVersions) {
+    if (version >= known.first && version <= known.last) {
+      return &known;
+    }
+  }
+  return nullptr;
+}
+
+// Чтение с проверкой границ; после первой ошибки все чтения неудачны
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t length) : data_(data), length_(length) {}
+
+  size_t offset() const { return offset_; }
+  size_t remaining() const { return length_ - offset_; }
+
+  bool Skip(size_t count) {
+    if (count > remaining()) {
+      offset_ = length_;
+      return false;
+    }
+    offset_ += count;
+    return true;
+  }
+
+  bool Bytes(size_t count, const uint8_t** out) {
+    *out = data_ + offset_;
+    return Skip(count);
+  }
+
+  bool U8(uint8_t* value) {
+    if (remaining() < 1) {
+      return false;
+    }
+    *value = data_[offset_++];
+    return true;
+  }
+
+  bool U16(uint16_t* value) {
+    if (remaining() < 2) {
+      return false;
+    }
+    *value = (uint16_t)((data_[offset_] << 8) | data_[offset_ + 1]);
+    offset_ += 2;
+    return true;
+  }
+
+  bool U32(uint32_t* value) {
+    if (remaining() < 4) {
+      return false;
+    }
+    *value = ((uint32_t)data_[offset_] << 24) | ((uint32_t)data_[offset_ + 1] << 16) |
+             ((uint32_t)data_[offset_ + 2] << 8) | data_[offset_ + 3];
+    offset_ += 4;
+    return true;
+  }
+
+  // Целое переменной длины QUIC (RFC 9000, 16)
+  bool Varint(uint64_t* value) {
+    if (remaining() < 1) {
+      return false;
+    }
+    size_t size = (size_t)1 << (data_[offset_] >> 6);
+    if (remaining() < size) {
+      offset_ = length_;
+      return false;
+    }
+    uint64_t result = data_[offset_] & 0x3f;
+    for (size_t i = 1; i < size; i++) {
+      result = (result << 8) | data_[offset_ + i];
+    }
+    offset_ += size;
+    *value = result;
+    return true;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t length_;
+  size_t offset_ = 0;
+};
+
+uint32_t ReadU24(const uint8_t* data) {
+  return ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+}
+
+bool IsHostName(const uint8_t* name, size_t length) {
+  if (length == 0 || length > kMaxHost) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] <= 0x20 || name[i] >= 0x7f || name[i] == '/') {
+      return false;
+    }
+  }
+  return true;
+}
+
+SniffResult Found(SniffProtocol protocol) {
+  SniffResult result;
+  result.status = SniffStatus::kFound;
+  result.protocol = protocol;
+  return result;
+}
+
+SniffResult NeedMore(SniffProtocol protocol) {
+  SniffResult result;
+  result.status = SniffStatus::kNeedMore;
+  result.protocol = protocol;
+  return result;
+}
+
+// Сообщение ClientHello целиком, начиная с заголовка сообщения Handshake.
+// SNI без server_name или с ошибкой внутри расширения - kFound без имени.
+SniffResult ParseClientHello(const uint8_t* message, size_t length, SniffProtocol protocol) {
+  Reader reader(message, length);
+  uint8_t type = 0;
+  const uint8_t* body_length = nullptr;
+  const uint8_t* body = nullptr;
+  if (!reader.U8(&type) || type != kTlsClientHello || !reader.Bytes(3, &body_length) ||
+      !reader.Bytes(ReadU24(body_length), &body)) {
+    return SniffResult();
+  }
+
+  Reader hello(body, ReadU24(body_length));
+  uint16_t version = 0;
+  uint8_t session_length = 0;
+  uint16_t suites_length = 0;
+  uint8_t compression_length = 0;
+  if (!hello.U16(&version) || (version >> 8) != 3 || !hello.Skip(32) ||
+      !hello.U8(&session_length) || !hello.Skip(session_length) || !hello.U16(&suites_length) ||
+      !hello.Skip(suites_length) || !hello.U8(&compression_length) ||
+      !hello.Skip(compression_length)) {
+    return SniffResult();
+  }
+
+  SniffResult result = Found(protocol);
+  uint16_t extensions_length = 0;
+  const uint8_t* extensions = nullptr;
+  if (!hello.U16(&extensions_length) || !hello.Bytes(extensions_length, &extensions)) {
+    // Без расширений (SSL 3.0) имени нет
+    return result;
+  }
+  Reader list(extensions, extensions_length);
+  uint16_t extension_type = 0;
+  uint16_t extension_length = 0;
+  const uint8_t* extension = nullptr;
+  while (list.U16(&extension_type) && list.U16(&extension_length) &&
+         list.Bytes(extension_length, &extension)) {
+    if (extension_type != kTlsExtensionServerName) {
+      continue;
+    }
+    Reader names(extension, extension_length);
+    uint16_t names_length = 0;
+    uint8_t name_type = 0;
+    uint16_t name_length = 0;
+    const uint8_t* name = nullptr;
+    if (names.U16(&names_length) && names.U8(&name_type) && name_type == 0 &&
+        names.U16(&name_length) && names.Bytes(name_length, &name) &&
+        IsHostName(name, name_length)) {
+      result.host = (const char*)name;
+      result.host_length = name_length;
+    }
+    break;
+  }
+  return result;
+}
+
+// Записи TLS с началом ClientHello. Сообщение, целиком лежащее в первой
+// записи, разбирается на месте; иначе фрагменты собираются в |scratch|.
+SniffResult SniffTls(const uint8_t* data, size_t length, std::vector<uint8_t>* scratch) {
+  if ((length > 1 && data[1] != 3) || (length > kTlsRecordHeader &&
+                                       data[kTlsRecordHeader] != kTlsClientHello)) {
+    return SniffResult();
+  }
+  if (length >= kTlsRecordHeader + kHandshakeHeader) {
+    size_t record_length = (data[3] << 8) | data[4];
+    size_t message_length = kHandshakeHeader + ReadU24(data + kTlsRecordHeader + 1);
+    if (message_length <= record_length && kTlsRecordHeader + message_length <= length) {
+      return ParseClientHello(data + kTlsRecordHeader, message_length, SniffProtocol::kTls);
+    }
+  }
+
+  scratch->clear();
+  size_t offset = 0;
+  while (length - offset >= kTlsRecordHeader) {
+    const uint8_t* record = data + offset;
+    size_t record_length = (record[3] << 8) | record[4];
+    if (record[0] != kTlsContentHandshake || record[1] != 3 || record_length == 0 ||
+        record_length > kTlsMaxRecord) {
+      return SniffResult();
+    }
+    size_t available = std::min(record_length, length - offset - kTlsRecordHeader);
+    scratch->insert(scratch->end(), record + kTlsRecordHeader,
+                    record + kTlsRecordHeader + available);
+    offset += kTlsRecordHeader + available;
+    if (available < record_length) {
+      break;
+    }
+  }
+  if (scratch->size() >= kHandshakeHeader) {
+    size_t message_length = kHandshakeHeader + ReadU24(scratch->data() + 1);
+    if (message_length > FlowSniffer::kMaxMessage) {
+      return SniffResult();
+    }
+    if (scratch->size() >= message_length) {
+      return ParseClientHello(scratch->data(), message_length, SniffProtocol::kTls);
+    }
+  }
+  return NeedMore(SniffProtocol::kTls);
+}
+
+bool StartsWithNoCase(const uint8_t* data, size_t length, const char* prefix) {
+  size_t prefix_length = strlen(prefix);
+  if (length < prefix_length) {
+    return false;
+  }
+  for (size_t i = 0; i < prefix_length; i++) {
+    uint8_t c = data[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = (uint8_t)(c - 'A' + 'a');
+    }
+    if (c != (uint8_t)prefix[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Запрос HTTP/1.x: имя из заголовка Host без порта
+SniffResult SniffHttp(const uint8_t* data, size_t length) {
+  bool method = false;
+  bool partial = false;
+  for (const char* known : kHttpMethods) {
+    size_t known_length = strlen(known);
+    size_t compared = std::min(known_length, length);
+    if (memcmp(data, known, compared) == 0) {
+      method = compared == known_length;
+      partial = !method;
+      break;
+    }
+  }
+  if (!method) {
+    return partial ? NeedMore(SniffProtocol::kHttp) : SniffResult();
+  }
+
+  const uint8_t* end = data + length;
+  const uint8_t* line = data;
+  bool request_line = true;
+  for (;;) {
+    const uint8_t* line_end = line;
+    while (line_end + 1 < end && !(line_end[0] == '\r' && line_end[1] == '\n')) {
+      line_end++;
+    }
+    if (line_end + 1 >= end) {
+      // Строка не закончилась
+      return NeedMore(SniffProtocol::kHttp);
+    }
+    size_t line_length = (size_t)(line_end - line);
+    if (request_line) {
+      if (line_length < 9 || memcmp(line_end - 9, " HTTP/1.", 8) != 0) {
+        return SniffResult();
+      }
+      request_line = false;
+    } else if (line_length == 0) {
+      // Заголовки закончились, Host не было (HTTP/1.0)
+      return Found(SniffProtocol::kHttp);
+    } else if (StartsWithNoCase(line, line_length, "host:")) {
+      const uint8_t* value = line + 5;
+      const uint8_t* value_end = line_end;
+      while (value < value_end && (*value == ' ' || *value == '\t')) {
+        value++;
+      }
+      while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+        value_end--;
+      }
+      if (value < value_end && *value == '[') {
+        // IPv6 в скобках
+        const uint8_t* close = (const uint8_t*)memchr(value, ']', (size_t)(value_end - value));
+        value_end = close != nullptr ? close : value;
+        value++;
+      } else {
+        const uint8_t* colon = (const uint8_t*)memchr(value, ':', (size_t)(value_end - value));
+        if (colon != nullptr) {
+          value_end = colon;
+        }
+      }
+      SniffResult result = Found(SniffProtocol::kHttp);
+      if (value < value_end && IsHostName(value, (size_t)(value_end - value))) {
+        result.host = (const char*)value;
+        result.host_length = (size_t)(value_end - value);
+      }
+      return result;
+    }
+    line = line_end + 2;
+  }
+}
+
+// Полный номер пакета по усеченному (RFC 9000, A.3)
+int64_t DecodePacketNumber(int64_t largest, uint32_t truncated, int bits) {
+  int64_t expected = largest + 1;
+  int64_t window = (int64_t)1 << bits;
+  int64_t half = window / 2;
+  int64_t candidate = (expected & ~(window - 1)) | truncated;
+  if (candidate <= expected - half && candidate < ((int64_t)1 << 62) - window) {
+    return candidate + window;
+  }
+  if (candidate > expected + half && candidate >= window) {
+    return candidate - window;
+  }
+  return candidate;
+}
+
+}  // namespace
+
+SniffResult FlowSniffer::FeedStream(uint32_t sequence, const uint8_t* data, size_t length) {
+  if (length == 0) {
+    return NeedMore(SniffProtocol::kNone);
+  }
+  if (!started_) {
+    started_ = true;
+    next_sequence_ = sequence + (uint32_t)length;
+    SniffResult result = SniffBuffer(data, length);
+    if (result.status == SniffStatus::kNeedMore) {
+      stream_.assign(data, data + length);
+    }
+    return result;
+  }
+
+  int32_t ahead = (int32_t)(sequence - next_sequence_);
+  if (ahead > 0 || (size_t)-(int64_t)ahead >= length) {
+    // Пропуск (ждем перепосылки) или повтор
+    return NeedMore(SniffProtocol::kNone);
+  }
+  size_t skip = (size_t)-(int64_t)ahead;
+  if (stream_.size() + length - skip > kMaxMessage) {
+    return SniffResult();
+  }
+  stream_.insert(stream_.end(), data + skip, data + length);
+  next_sequence_ += (uint32_t)(length - skip);
+  return SniffBuffer(stream_.data(), stream_.size());
+}
+
+SniffResult FlowSniffer::SniffBuffer(const uint8_t* data, size_t length) {
+  if (data[0] == kTlsContentHandshake) {
+    return SniffTls(data, length, &scratch_);
+  }
+  return SniffHttp(data, length);
+}
+
+SniffResult FlowSniffer::FeedDatagram(const uint8_t* data, size_t length) {
+  if (datagrams_ >= kMaxDatagrams) {
+    return SniffResult();
+  }
+  datagrams_++;
+
+  // Пакеты в датаграмме могут быть склеены (RFC 9000, 12.2)
+  bool initial = false;
+  size_t offset = 0;
+  while (offset < length) {
+    size_t consumed = 0;
+    SniffResult result = SniffQuicPacket(data + offset, length - offset, &consumed);
+    if (result.status == SniffStatus::kFound) {
+      return result;
+    }
+    initial = initial || result.status == SniffStatus::kNeedMore;
+    if (consumed == 0) {
+      break;
+    }
+    offset += consumed;
+  }
+  if (initial || !crypto_ranges_.empty()) {
+    return NeedMore(SniffProtocol::kQuic);
+  }
+  return SniffResult();
+}
+
+SniffResult FlowSniffer::SniffQuicPacket(const uint8_t* packet, size_t length, size_t* consumed) {
+  *consumed = 0;
+  Reader reader(packet, length);
+  uint8_t first = 0;
+  uint32_t version_number = 0;
+  uint8_t dcid_length = 0;
+  const uint8_t* dcid = nullptr;
+  uint8_t scid_length = 0;
+  if (!reader.U8(&first) || (first & 0xc0) != 0xc0 || !reader.U32(&version_number)) {
+    return SniffResult();
+  }
+  const QuicVersion* version = FindQuicVersion(version_number);
+  if (version == nullptr || !reader.U8(&dcid_length) || dcid_length > 20 ||
+      !reader.Bytes(dcid_length, &dcid) || !reader.U8(&scid_length) || scid_length > 20 ||
+      !reader.Skip(scid_length)) {
+    return SniffResult();
+  }
+  uint8_t type = (first >> 4) & 3;
+  if (type == version->retry_type) {
+    *consumed = length;
+    return SniffResult();
+  }
+  uint64_t token_length = 0;
+  if (type == version->initial_type &&
+      (!reader.Varint(&token_length) || !reader.Skip((size_t)token_length))) {
+    return SniffResult();
+  }
+  uint64_t payload_length = 0;
+  if (!reader.Varint(&payload_length) || payload_length > reader.remaining()) {
+    return SniffResult();
+  }
+  size_t number_offset = reader.offset();
+  *consumed = number_offset + (size_t)payload_length;
+  // Пакеты 0-RTT и Handshake пропускаем; маске заголовка нужна выборка
+  // через 4 байта после начала номера пакета
+  if (type != version->initial_type || payload_length < 4 + Aes128::kBlockSize) {
+    return SniffResult();
+  }
+
+  if (!have_keys_ || keys_.version != version_number || keys_.dcid_length != dcid_length ||
+      memcmp(keys_.dcid, dcid, dcid_length) != 0) {
+    uint8_t initial_secret[Sha256::kDigestSize];
+    uint8_t client_secret[Sha256::kDigestSize];
+    HkdfExtract(version->salt, sizeof(version->salt), dcid, dcid_length, initial_secret);
+    HkdfExpandLabel(initial_secret, "client in", client_secret, sizeof(client_secret));
+    HkdfExpandLabel(client_secret, version->key_label, keys_.key, sizeof(keys_.key));
+    HkdfExpandLabel(client_secret, version->iv_label, keys_.iv, sizeof(keys_.iv));
+    HkdfExpandLabel(client_secret, version->hp_label, keys_.hp, sizeof(keys_.hp));
+    keys_.version = version_number;
+    memcpy(keys_.dcid, dcid, dcid_length);
+    keys_.dcid_length = dcid_length;
+    have_keys_ = true;
+  }
+
+  // Снятие защиты заголовка (RFC 9001, 5.4) на копии пакета: открытый
+  // заголовок служит дополнительными данными AEAD
+  uint8_t mask[Aes128::kBlockSize];
+  Aes128(keys_.hp).EncryptBlock(packet + number_offset + 4, mask);
+  scratch_.assign(packet, packet + *consumed);
+  uint8_t* copy = scratch_.data();
+  copy[0] ^= mask[0] & 0x0f;
+  size_t number_length = (copy[0] & 3) + 1;
+  uint32_t truncated = 0;
+  for (size_t i = 0; i < number_length; i++) {
+    copy[number_offset + i] ^= mask[1 + i];
+    truncated = (truncated << 8) | copy[number_offset + i];
+  }
+  int64_t number = DecodePacketNumber(largest_packet_, truncated, (int)number_length * 8);
+
+  uint8_t nonce[12];
+  memcpy(nonce, keys_.iv, sizeof(nonce));
+  for (int i = 0; i < 8; i++) {
+    nonce[11 - i] ^= (uint8_t)((uint64_t)number >> (8 * i));
+  }
+  size_t header_length = number_offset + number_length;
+  uint8_t* payload = copy + header_length;
+  size_t sealed_length = *consumed - header_length;
+  if (!Aes128GcmOpen(keys_.key, nonce, copy, header_length, payload, sealed_length, payload)) {
+    return SniffResult();
+  }
+  largest_packet_ = std::max(largest_packet_, number);
+
+  // В Initial допустимы только PADDING, PING, ACK, CRYPTO и CONNECTION_CLOSE
+  Reader frames(payload, sealed_length - 16);
+  uint64_t frame = 0;
+  while (frames.Varint(&frame)) {
+    if (frame == 0x00 || frame == 0x01) {
+      continue;
+    }
+    if (frame == 0x02 || frame == 0x03) {
+      uint64_t value = 0;
+      uint64_t ranges = 0;
+      if (!frames.Varint(&value) || !frames.Varint(&value) || !frames.Varint(&ranges) ||
+          !frames.Varint(&value)) {
+        return SniffResult();
+      }
+      for (uint64_t i = 0; i < ranges * 2 + (frame == 0x03 ? 3 : 0); i++) {
+        if (!frames.Varint(&value)) {
+          return SniffResult();
+        }
+      }
+      continue;
+    }
+    if (frame == 0x06) {
+      uint64_t offset = 0;
+      uint64_t data_length = 0;
+      const uint8_t* data = nullptr;
+      if (!frames.Varint(&offset) || !frames.Varint(&data_length) ||
+          !frames.Bytes((size_t)data_length, &data) ||
+          !StoreCrypto(offset, data, (size_t)data_length)) {
+        return SniffResult();
+      }
+      continue;
+    }
+    return SniffResult();
+  }
+
+  size_t contiguous =
+      !crypto_ranges_.empty() && crypto_ranges_[0].first == 0 ? crypto_ranges_[0].second : 0;
+  if (contiguous >= kHandshakeHeader) {
+    size_t message_length = kHandshakeHeader + ReadU24(crypto_.data() + 1);
+    if (crypto_[0] != kTlsClientHello || message_length > kMaxMessage) {
+      return SniffResult();
+    }
+    if (contiguous >= message_length) {
+      return ParseClientHello(crypto_.data(), message_length, SniffProtocol::kQuic);
+    }
+  }
+  return NeedMore(SniffProtocol::kQuic);
+}
+
+bool FlowSniffer::StoreCrypto(uint64_t offset, const uint8_t* data, size_t length) {
+  if (offset > kMaxMessage || length > kMaxMessage - offset) {
+    return false;
+  }
+  if (length == 0) {
+    return true;
+  }
+  uint32_t start = (uint32_t)offset;
+  uint32_t end = (uint32_t)(offset + length);
+  if (crypto_.size() < end) {
+    crypto_.resize(end);
+  }
+  memcpy(crypto_.data() + start, data, length);
+
+  // Вставить диапазон и слить с соседними
+  auto position = std::lower_bound(crypto_ranges_.begin(), crypto_ranges_.end(),
+                                   std::make_pair(start, end));
+  position = crypto_ranges_.insert(position, std::make_pair(start, end));
+  if (position != crypto_ranges_.begin() && (position - 1)->second >= position->first) {
+    position--;
+  }
+  auto last = position + 1;
+  while (last != crypto_ranges_.end() && last->first <= position->second) {
+    position->second = std::max(position->second, last->second);
+    last++;
+  }
+  crypto_ranges_.erase(position + 1, last);
+  return true;
+}
@@ -0,0 +1,88 @@
+#ifndef RUNNER_TRAFFIC_SNIFFER_H_
+#define RUNNER_TRAFFIC_SNIFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+// Определение протокола и имени назначения по первым байтам потока, чтобы
+// доменные правила работали и без DNS: SNI из TLS ClientHello, Host из
+// запроса HTTP/1.x и SNI из QUIC Initial (v1, v2 и draft-29; для этого
+// снимается защита заголовка и расшифровывается пакет ключами Initial).
+
+enum class SniffProtocol : uint8_t {
+  kNone = 0,
+  kHttp,
+  kTls,
+  kQuic,
+};
+
+enum class SniffStatus : uint8_t {
+  kFound = 0,  // протокол определен (имени может не быть)
+  kNeedMore,   // начало похоже на протокол, но сообщение еще не целиком
+  kNoMatch,    // протокол не распознан; дальше поток не разбирается
+};
+
+struct SniffResult {
+  SniffStatus status = SniffStatus::kNoMatch;
+  SniffProtocol protocol = SniffProtocol::kNone;
+  // Имя без порта, как в сообщении. Указывает в переданные данные или в
+  // буфер FlowSniffer и действительно до их изменения.
+  const char* host = nullptr;
+  size_t host_length = 0;
+};
+
+// Разбор одного направления потока (от клиента).
+//
+// Если сообщение целиком в первом сегменте или датаграмме (обычный
+// случай), FlowSniffer ничего не копирует и не выделяет память - его можно
+// держать на стеке и сохранять только при kNeedMore. Продолжение
+// ClientHello или запроса HTTP, разбитого на сегменты (в том числе на
+// несколько записей TLS), и фрагменты CRYPTO из нескольких пакетов QUIC
+// Initial накапливаются в пределах kMaxMessage.
+class FlowSniffer {
+ public:
+  static constexpr size_t kMaxMessage = 16384;
+  // Пакетов QUIC без ClientHello, после которых разбор прекращается
+  static constexpr int kMaxDatagrams = 8;
+
+  // Полезная нагрузка сегмента TCP с порядковым номером |sequence|.
+  // Повторы отбрасываются; сегмент после пропуска ждет перепосылки.
+  SniffResult FeedStream(uint32_t sequence, const uint8_t* data, size_t length);
+
+  // Датаграмма UDP целиком
+  SniffResult FeedDatagram(const uint8_t* data, size_t length);
+
+ private:
+  struct QuicKeys {
+    uint32_t version = 0;
+    uint8_t dcid[20] = {};
+    size_t dcid_length = 0;
+    uint8_t key[16] = {};
+    uint8_t iv[12] = {};
+    uint8_t hp[16] = {};
+  };
+
+  SniffResult SniffBuffer(const uint8_t* data, size_t length);
+  SniffResult SniffQuicPacket(const uint8_t* packet, size_t length, size_t* consumed);
+  bool StoreCrypto(uint64_t offset, const uint8_t* data, size_t length);
+
+  // TCP
+  bool started_ = false;
+  uint32_t next_sequence_ = 0;
+  std::vector<uint8_t> stream_;
+
+  // QUIC
+  int datagrams_ = 0;
+  bool have_keys_ = false;
+  QuicKeys keys_;
+  int64_t largest_packet_ = -1;
+  std::vector<uint8_t> crypto_;
+  // Полученные диапазоны CRYPTO [начало, конец), упорядочены и не пересекаются
+  std::vector<std::pair<uint32_t, uint32_t>> crypto_ranges_;
+  std::vector<uint8_t> scratch_;
+};
+
+#endif  // RUNNER_TRAFFIC_SNIFFER_H_
@@ -0,0 +1,919 @@
+#include "udp_relay.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <mstcpip.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+
+// Пока датаграммы ждут разрешения имен, ответы резолвера проверяются чаще
+constexpr int kPendingPollTimeoutMs = 2;
+constexpr int64_t kSweepIntervalMs = 1000;
+
+// Пачек с одного сокета за одно пробуждение
+constexpr size_t kMaxRounds = 4;
+
+// Сколько помнить разрешенное имя и через сколько повторить неудачное
+constexpr int64_t kNameTtlMs = 60 * 1000;
+constexpr int64_t kNameRetryMs = 5 * 1000;
+constexpr size_t kMaxNames = 1024;
+
+// Буферы сокетов: всплеск мелких датаграмм не должен теряться в ядре
+constexpr int kSocketBufferSize = 4 * 1024 * 1024;
+
+#if defined(__linux__)
+// Сегментов в одном сообщении UDP_SEGMENT и его предельный размер. Сегмент
+// должен помещаться в MTU, иначе ядро отвергает сообщение целиком.
+constexpr size_t kMaxGsoSegments = 64;
+constexpr size_t kMaxGsoBytes = 60000;
+constexpr size_t kMaxGsoSegment = 1400;
+
+// Сообщений и фрагментов за один вызов sendmmsg
+constexpr size_t kSendBatch = 64;
+constexpr size_t kMaxIov = 1024;
+
+constexpr int kMaxEvents = 64;
+#endif
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int AddressLength(const sockaddr_storage& address) {
+  return address.ss_family == AF_INET6 ? (int)sizeof(sockaddr_in6) : (int)sizeof(sockaddr_in);
+}
+
+uint16_t AddressPort(const sockaddr_storage& address) {
+  return ntohs(address.ss_family == AF_INET6 ? ((const sockaddr_in6*)&address)->sin6_port
+                                             : ((const sockaddr_in*)&address)->sin_port);
+}
+
+void SetAddressPort(sockaddr_storage* address, uint16_t port) {
+  if (address->ss_family == AF_INET6) {
+    ((sockaddr_in6*)address)->sin6_port = htons(port);
+  } else {
+    ((sockaddr_in*)address)->sin_port = htons(port);
+  }
+}
+
+bool SameHost(const sockaddr_storage& a, const sockaddr_storage& b) {
+  if (a.ss_family != b.ss_family) {
+    return false;
+  }
+  if (a.ss_family == AF_INET6) {
+    return memcmp(&((const sockaddr_in6*)&a)->sin6_addr, &((const sockaddr_in6*)&b)->sin6_addr,
+                  16) == 0;
+  }
+  return memcmp(&((const sockaddr_in*)&a)->sin_addr, &((const sockaddr_in*)&b)->sin_addr, 4) == 0;
+}
+
+// Заголовок SOCKS5 UDP с адресом источника; возвращает его длину
+uint8_t WriteSocksHeader(const sockaddr_storage& from, char* header) {
+  header[0] = 0;
+  header[1] = 0;
+  header[2] = 0;
+  if (from.ss_family == AF_INET6) {
+    const sockaddr_in6* ipv6 = (const sockaddr_in6*)&from;
+    header[3] = 0x04;
+    memcpy(header + 4, &ipv6->sin6_addr, 16);
+    memcpy(header + 20, &ipv6->sin6_port, 2);
+    return 22;
+  }
+  const sockaddr_in* ipv4 = (const sockaddr_in*)&from;
+  header[3] = 0x01;
+  memcpy(header + 4, &ipv4->sin_addr, 4);
+  memcpy(header + 8, &ipv4->sin_port, 2);
+  return 10;
+}
+
+void ConfigureSocket(SocketHandle socket, bool gro) {
+  int size = kSocketBufferSize;
+  setsockopt(socket, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+  setsockopt(socket, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size));
+#if defined(_WIN32)
+  // ICMP "порт недоступен" иначе срывает recvfrom() всего сокета
+  BOOL report = FALSE;
+  DWORD returned = 0;
+  WSAIoctl(socket, SIO_UDP_CONNRESET, &report, sizeof(report), nullptr, 0, &returned, nullptr,
+           nullptr);
+  (void)gro;
+#elif defined(__linux__)
+  if (gro) {
+    int enable = 1;
+    setsockopt(socket, SOL_UDP, UDP_GRO, &enable, sizeof(enable));
+  }
+#endif
+}
+
+}  // namespace
+
+size_t UdpRelay::EndpointKeyHash::operator()(const EndpointKey& key) const {
+  uint64_t hash = key.words[0] * 0x9E3779B97F4A7C15ULL;
+  hash ^= key.words[1] * 0xC2B2AE3D27D4EB4FULL;
+  hash ^= key.words[2] * 0x165667B19E3779F9ULL;
+  return (size_t)(hash ^ (hash >> 29));
+}
+
+UdpRelay::EndpointKey UdpRelay::MakeKey(const sockaddr_storage& address) {
+  EndpointKey key = {};
+  if (address.ss_family == AF_INET6) {
+    const sockaddr_in6* ipv6 = (const sockaddr_in6*)&address;
+    key.words[0] = ((uint64_t)ipv6->sin6_port << 16) | AF_INET6;
+    memcpy(&key.words[1], &ipv6->sin6_addr, 16);
+  } else {
+    const sockaddr_in* ipv4 = (const sockaddr_in*)&address;
+    uint32_t ip;
+    memcpy(&ip, &ipv4->sin_addr, 4);
+    key.words[0] = ((uint64_t)ip << 32) | ((uint64_t)ipv4->sin_port << 16) | AF_INET;
+  }
+  return key;
+}
+
+UdpRelay::UdpRelay(TrafficCounters* counters, ResolveFunction resolve)
+    : counters_(counters), resolve_(std::move(resolve)) {}
+
+UdpRelay::~UdpRelay() { Stop(); }
+
+uint16_t UdpRelay::port() const { return AddressPort(address_); }
+
+bool UdpRelay::Start(const sockaddr_storage& address, int length, uint32_t idle_timeout_ms) {
+  if (running_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  address_ = address;
+  SetAddressPort(&address_, 0);
+  idle_timeout_ms_ = idle_timeout_ms;
+
+  socket_ = socket(address_.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket_ == kInvalidSocket) {
+    return false;
+  }
+  socklen_t bound_length = sizeof(address_);
+  bool ok = SetSocketNonBlocking(socket_) &&
+            bind(socket_, (const sockaddr*)&address_, (socklen_t)length) == 0 &&
+            getsockname(socket_, (sockaddr*)&address_, &bound_length) == 0;
+#if defined(__linux__)
+  if (ok) {
+    // Нулевой размер сегмента не меняет отправку, но проверяет поддержку
+    int segment = 0;
+    gso_ = setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment)) == 0;
+    int enable = 1;
+    gro_ = setsockopt(socket_, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    ok = epoll_ >= 0;
+  }
+#endif
+  if (ok) {
+    ConfigureSocket(socket_, gro_);
+    relay_endpoint_ = Endpoint{nullptr, socket_};
+    ok = Watch(&relay_endpoint_);
+  }
+  if (!ok) {
+#if defined(__linux__)
+    if (epoll_ >= 0) {
+      close(epoll_);
+      epoll_ = -1;
+    }
+#endif
+    CloseSocketHandle(socket_);
+    socket_ = kInvalidSocket;
+    return false;
+  }
+
+  buffers_.reset(new char[kBatchSize * kMaxMessage]);
+  now_ms_ = NowMs();
+  next_sweep_ms_ = now_ms_ + kSweepIntervalMs;
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&UdpRelay::Loop, this);
+  return true;
+}
+
+void UdpRelay::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  for (auto& entry : sessions_) {
+    CloseSession(entry.second.get());
+  }
+  sessions_.clear();
+  session_count_.store(0, std::memory_order_relaxed);
+  names_.clear();
+  pending_.clear();
+  outgoing_.clear();
+#if defined(_WIN32)
+  poll_fds_.clear();
+  poll_endpoints_.clear();
+  poll_dirty_ = true;
+#elif defined(__linux__)
+  close(epoll_);
+  epoll_ = -1;
+#endif
+  CloseSocketHandle(socket_);
+  socket_ = kInvalidSocket;
+  buffers_.reset();
+  {
+    std::lock_guard<std::mutex> lock(associations_mutex_);
+    associations_.clear();
+  }
+  std::lock_guard<std::mutex> lock(resolved_mutex_);
+  resolved_.clear();
+}
+
+uint32_t UdpRelay::Associate(const sockaddr_storage& client, int length) {
+  if (!IsRunning() || length <= 0) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(associations_mutex_);
+  uint32_t id = next_association_++;
+  associations_.push_back(Association{id, client});
+  return id;
+}
+
+void UdpRelay::Dissociate(uint32_t id) {
+  // Сессии ассоциации закроет ближайший Sweep()
+  std::lock_guard<std::mutex> lock(associations_mutex_);
+  for (size_t i = 0; i < associations_.size(); i++) {
+    if (associations_[i].id == id) {
+      associations_.erase(associations_.begin() + i);
+      return;
+    }
+  }
+}
+
+void UdpRelay::Loop() {
+  Endpoint* ready[64];
+  while (running_.load(std::memory_order_acquire)) {
+    size_t count = Wait(pending_.empty() ? kPollTimeoutMs : kPendingPollTimeoutMs, ready,
+                        sizeof(ready) / sizeof(ready[0]));
+    now_ms_ = NowMs();
+    // Сессии закрываются только в Sweep(), поэтому указатели готовых
+    // сокетов действительны до конца разбора
+    for (size_t i = 0; i < count; i++) {
+      if (ready[i]->session == nullptr) {
+        OnClientMessages();
+      } else {
+        OnRemoteMessages(ready[i]->session, ready[i]->socket);
+      }
+    }
+    ApplyResolved();
+    if (now_ms_ >= next_sweep_ms_) {
+      Sweep();
+      next_sweep_ms_ = now_ms_ + kSweepIntervalMs;
+    }
+  }
+}
+
+#if defined(_WIN32)
+
+size_t UdpRelay::Wait(int timeout_ms, Endpoint** ready, size_t capacity) {
+  if (poll_dirty_) {
+    poll_fds_.clear();
+    poll_endpoints_.clear();
+    poll_fds_.push_back(WSAPOLLFD{socket_, POLLRDNORM, 0});
+    poll_endpoints_.push_back(&relay_endpoint_);
+    for (auto& entry : sessions_) {
+      for (Endpoint& endpoint : entry.second->sockets) {
+        if (endpoint.socket != kInvalidSocket) {
+          poll_fds_.push_back(WSAPOLLFD{endpoint.socket, POLLRDNORM, 0});
+          poll_endpoints_.push_back(&endpoint);
+        }
+      }
+    }
+    poll_dirty_ = false;
+  }
+  if (WSAPoll(poll_fds_.data(), (ULONG)poll_fds_.size(), timeout_ms) <= 0) {
+    return 0;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < poll_fds_.size() && count < capacity; i++) {
+    if (poll_fds_[i].revents & (POLLRDNORM | POLLERR | POLLHUP)) {
+      ready[count++] = poll_endpoints_[i];
+    }
+  }
+  return count;
+}
+
+bool UdpRelay::Watch(Endpoint* endpoint) {
+  (void)endpoint;
+  poll_dirty_ = true;
+  return true;
+}
+
+bool UdpRelay::Receive(SocketHandle socket) {
+  size_t count = 0;
+  while (count < kBatchSize) {
+    Message& message = messages_[count];
+    int from_length = sizeof(message.from);
+    int received = recvfrom(socket, buffers_.get() + count * kMaxMessage, (int)kMaxMessage, 0,
+                            (sockaddr*)&message.from, &from_length);
+    if (received < 0) {
+      if (WSAGetLastError() == WSAECONNRESET) {
+        continue;
+      }
+      break;
+    }
+    message.length = (size_t)received;
+    message.segment = 0;
+    count++;
+  }
+  message_count_ = count;
+  return count > 0;
+}
+
+void UdpRelay::Send() {
+  for (const Outgoing& item : outgoing_) {
+    WSABUF buffers[2];
+    DWORD count = 0;
+    if (item.header_length > 0) {
+      buffers[count].buf = (CHAR*)item.header;
+      buffers[count].len = item.header_length;
+      count++;
+    }
+    buffers[count].buf = (CHAR*)item.data;
+    buffers[count].len = (ULONG)item.length;
+    count++;
+    DWORD sent = 0;
+    if (WSASendTo(item.socket, buffers, count, &sent, 0, (const sockaddr*)&item.to,
+                  item.to_length, nullptr, nullptr) != 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  outgoing_.clear();
+}
+
+#elif defined(__linux__)
+
+size_t UdpRelay::Wait(int timeout_ms, Endpoint** ready, size_t capacity) {
+  epoll_event events[kMaxEvents];
+  int limit = capacity < (size_t)kMaxEvents ? (int)capacity : kMaxEvents;
+  int count = epoll_wait(epoll_, events, limit, timeout_ms);
+  for (int i = 0; i < count; i++) {
+    ready[i] = (Endpoint*)events[i].data.ptr;
+  }
+  return count > 0 ? (size_t)count : 0;
+}
+
+bool UdpRelay::Watch(Endpoint* endpoint) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = endpoint;
+  return epoll_ctl(epoll_, EPOLL_CTL_ADD, endpoint->socket, &event) == 0;
+}
+
+bool UdpRelay::Receive(SocketHandle socket) {
+  mmsghdr headers[kBatchSize];
+  iovec vectors[kBatchSize];
+  alignas(cmsghdr) char control[kBatchSize][CMSG_SPACE(sizeof(int))];
+  memset(headers, 0, sizeof(headers));
+  for (size_t i = 0; i < kBatchSize; i++) {
+    vectors[i].iov_base = buffers_.get() + i * kMaxMessage;
+    vectors[i].iov_len = kMaxMessage;
+    msghdr& header = headers[i].msg_hdr;
+    header.msg_name = &messages_[i].from;
+    header.msg_namelen = sizeof(messages_[i].from);
+    header.msg_iov = &vectors[i];
+    header.msg_iovlen = 1;
+    header.msg_control = control[i];
+    header.msg_controllen = sizeof(control[i]);
+  }
+  int count = recvmmsg(socket, headers, kBatchSize, MSG_DONTWAIT, nullptr);
+  if (count <= 0) {
+    message_count_ = 0;
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    Message& message = messages_[i];
+    msghdr& header = headers[i].msg_hdr;
+    message.length = headers[i].msg_len;
+    message.segment = 0;
+    if (header.msg_flags & MSG_TRUNC) {
+      message.length = 0;
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&header, cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+        int segment;
+        memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+        message.segment = (size_t)segment;
+      }
+    }
+  }
+  message_count_ = (size_t)count;
+  return true;
+}
+
+void UdpRelay::Send() {
+  mmsghdr messages[kSendBatch];
+  size_t datagrams[kSendBatch];
+  iovec vectors[kMaxIov];
+  alignas(cmsghdr) char control[kSendBatch][CMSG_SPACE(sizeof(uint16_t))];
+  size_t message_count = 0;
+  size_t iov_count = 0;
+  SocketHandle batch_socket = kInvalidSocket;
+
+  auto flush = [&]() {
+    size_t sent = 0;
+    while (sent < message_count) {
+      int result = sendmmsg(batch_socket, messages + sent, (unsigned)(message_count - sent), 0);
+      if (result > 0) {
+        sent += (size_t)result;
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EIO && gso_) {
+        // Устройство не умеет сегментацию: дальше отправляем без нее
+        gso_ = false;
+      }
+      // Полный буфер сокета теряет остаток пачки, как и сеть; ошибка
+      // одного адресата - только его сообщение
+      size_t lost = errno == EAGAIN || errno == EWOULDBLOCK ? message_count - sent : 1;
+      for (size_t i = sent; i < sent + lost; i++) {
+        dropped_.fetch_add(datagrams[i], std::memory_order_relaxed);
+      }
+      sent += lost;
+    }
+    message_count = 0;
+    iov_count = 0;
+  };
+
+  size_t i = 0;
+  while (i < outgoing_.size()) {
+    const Outgoing& first = outgoing_[i];
+    size_t segment = first.header_length + first.length;
+    size_t run = 1;
+
+    // Серия одинаковых датаграмм одному адресату - одно сообщение с
+    // сегментацией в ядре; короче остальных может быть только последняя
+    if (gso_ && segment <= kMaxGsoSegment) {
+      size_t total = segment;
+      while (i + run < outgoing_.size() && run < kMaxGsoSegments) {
+        const Outgoing& next = outgoing_[i + run];
+        size_t size = next.header_length + next.length;
+        if (next.socket != first.socket || size > segment || total + size > kMaxGsoBytes ||
+            next.to_length != first.to_length ||
+            memcmp(&next.to, &first.to, (size_t)first.to_length) != 0) {
+          break;
+        }
+        total += size;
+        run++;
+        if (size < segment) {
+          break;
+        }
+      }
+    }
+
+    if (message_count > 0 && (first.socket != batch_socket || message_count == kSendBatch ||
+                              iov_count + run * 2 > kMaxIov)) {
+      flush();
+    }
+    batch_socket = first.socket;
+
+    msghdr& header = messages[message_count].msg_hdr;
+    memset(&messages[message_count], 0, sizeof(messages[message_count]));
+    header.msg_name = (void*)&first.to;
+    header.msg_namelen = (socklen_t)first.to_length;
+    header.msg_iov = vectors + iov_count;
+    for (size_t k = 0; k < run; k++) {
+      const Outgoing& item = outgoing_[i + k];
+      if (item.header_length > 0) {
+        vectors[iov_count].iov_base = (void*)item.header;
+        vectors[iov_count].iov_len = item.header_length;
+        iov_count++;
+      }
+      vectors[iov_count].iov_base = (void*)item.data;
+      vectors[iov_count].iov_len = item.length;
+      iov_count++;
+    }
+    header.msg_iovlen = (size_t)(vectors + iov_count - header.msg_iov);
+    if (run > 1) {
+      header.msg_control = control[message_count];
+      header.msg_controllen = sizeof(control[message_count]);
+      cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t size = (uint16_t)segment;
+      memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+    }
+    datagrams[message_count] = run;
+    message_count++;
+    i += run;
+  }
+  if (message_count > 0) {
+    flush();
+  }
+  outgoing_.clear();
+}
+
+#endif
+
+void UdpRelay::OnClientMessages() {
+  for (size_t round = 0; round < kMaxRounds && Receive(socket_); round++) {
+    for (size_t i = 0; i < message_count_; i++) {
+      const Message& message = messages_[i];
+      const char* data = buffers_.get() + i * kMaxMessage;
+      size_t step = message.segment != 0 ? message.segment : message.length;
+      for (size_t offset = 0; offset < message.length; offset += step) {
+        OnClientDatagram(message.from, data + offset, std::min(step, message.length - offset));
+      }
+    }
+    if (counters_ != nullptr && !outgoing_.empty()) {
+      size_t bytes = 0;
+      for (const Outgoing& item : outgoing_) {
+        bytes += item.length;
+      }
+      counters_->AddBatch(TrafficDirection::kOutbound, bytes, outgoing_.size());
+    }
+    Send();
+    if (message_count_ < kBatchSize) {
+      return;
+    }
+  }
+}
+
+void UdpRelay::OnClientDatagram(const sockaddr_storage& from, const char* data, size_t length) {
+  const uint8_t* header = (const uint8_t*)data;
+  // Фрагментация (FRAG != 0) не поддерживается
+  if (length < 4 || header[0] != 0 || header[1] != 0 || header[2] != 0) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  sockaddr_storage to = {};
+  int to_length = 0;
+  size_t header_length = 0;
+  NameStatus status = NameStatus::kResolved;
+  std::string host;
+  uint16_t port = 0;
+  switch (header[3]) {
+    case 0x01:
+      header_length = 10;
+      if (length >= header_length) {
+        sockaddr_in* ipv4 = (sockaddr_in*)&to;
+        ipv4->sin_family = AF_INET;
+        memcpy(&ipv4->sin_addr, header + 4, 4);
+        memcpy(&ipv4->sin_port, header + 8, 2);
+        to_length = sizeof(sockaddr_in);
+        uint32_t address = ntohl(ipv4->sin_addr.s_addr);
+        if (fake_ips_ != nullptr && fake_ips_->Contains(address)) {
+          // Фиктивный адрес: отправляем по имени, а забытый адрес - никуда
+          to_length = 0;
+          status = NameStatus::kFailed;
+          if (fake_ips_->Lookup(address, &host)) {
+            port = ntohs(ipv4->sin_port);
+            status = ResolveName(host, port, &to, &to_length);
+          }
+        }
+      }
+      break;
+    case 0x04:
+      header_length = 22;
+      if (length >= header_length) {
+        sockaddr_in6* ipv6 = (sockaddr_in6*)&to;
+        ipv6->sin6_family = AF_INET6;
+        memcpy(&ipv6->sin6_addr, header + 4, 16);
+        memcpy(&ipv6->sin6_port, header + 20, 2);
+        to_length = sizeof(sockaddr_in6);
+      }
+      break;
+    case 0x03:
+      header_length = length > 4 ? 7 + (size_t)header[4] : length + 1;
+      if (length >= header_length) {
+        host.assign(data + 5, header[4]);
+        port = (uint16_t)((header[5 + header[4]] << 8) | header[6 + header[4]]);
+        status = ResolveName(host, port, &to, &to_length);
+      }
+      break;
+    default:
+      break;
+  }
+  if (status == NameStatus::kPending && pending_.size() < kMaxPendingDatagrams) {
+    pending_.push_back(PendingDatagram{from, std::move(host), port,
+                                       std::string(data + header_length, length - header_length),
+                                       now_ms_ + kNameRetryMs});
+    return;
+  }
+  if (to_length == 0) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Forward(from, to, to_length, data + header_length, length - header_length);
+}
+
+void UdpRelay::Forward(const sockaddr_storage& from, const sockaddr_storage& to, int to_length,
+                       const char* data, size_t length) {
+  Session* session = FindSession(from);
+  SocketHandle socket = session != nullptr ? SessionSocket(session, to.ss_family) : kInvalidSocket;
+  if (socket == kInvalidSocket) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  session->last_active_ms = now_ms_;
+
+  outgoing_.emplace_back();
+  Outgoing& item = outgoing_.back();
+  item.socket = socket;
+  item.to = to;
+  item.to_length = to_length;
+  item.header_length = 0;
+  item.data = data;
+  item.length = length;
+}
+
+void UdpRelay::OnRemoteMessages(Session* session, SocketHandle socket) {
+  for (size_t round = 0; round < kMaxRounds && Receive(socket); round++) {
+    session->last_active_ms = now_ms_;
+    size_t bytes = 0;
+    for (size_t i = 0; i < message_count_; i++) {
+      const Message& message = messages_[i];
+      const char* data = buffers_.get() + i * kMaxMessage;
+      char header[sizeof(Outgoing::header)];
+      uint8_t header_length = WriteSocksHeader(message.from, header);
+      size_t step = message.segment != 0 ? message.segment : message.length;
+      for (size_t offset = 0; offset < message.length; offset += step) {
+        outgoing_.emplace_back();
+        Outgoing& item = outgoing_.back();
+        item.socket = socket_;
+        item.to = session->client;
+        item.to_length = session->client_length;
+        item.header_length = header_length;
+        memcpy(item.header, header, header_length);
+        item.data = data + offset;
+        item.length = std::min(step, message.length - offset);
+        bytes += item.length;
+      }
+    }
+    if (counters_ != nullptr && !outgoing_.empty()) {
+      counters_->AddBatch(TrafficDirection::kInbound, bytes, outgoing_.size());
+    }
+    Send();
+    if (message_count_ < kBatchSize) {
+      return;
+    }
+  }
+}
+
+UdpRelay::NameStatus UdpRelay::ResolveName(const std::string& host, uint16_t port,
+                                           sockaddr_storage* address, int* length) {
+  auto found = names_.find(host);
+  if (found == names_.end() || found->second.expires_ms <= now_ms_) {
+    if (!resolve_) {
+      return NameStatus::kFailed;
+    }
+    if (names_.size() >= kMaxNames) {
+      names_.clear();
+    }
+    ResolvedName& name = names_[host];
+    name.length = 0;
+    name.expires_ms = now_ms_ + kNameRetryMs;
+    name.resolving = true;
+
+    // Ответ из кэша приходит внутри resolve_(): его забираем сразу, а не
+    // через очередь следующего оборота цикла
+    struct Answer {
+      bool waiting = true;
+      bool done = false;
+      sockaddr_storage address = {};
+      int length = 0;
+    };
+    std::shared_ptr<Answer> answer = std::make_shared<Answer>();
+    resolve_(host, port,
+             [this, host, answer](bool ok, const sockaddr_storage& resolved, int resolved_length) {
+               std::lock_guard<std::mutex> lock(resolved_mutex_);
+               if (answer->waiting) {
+                 answer->done = true;
+                 answer->address = resolved;
+                 answer->length = ok ? resolved_length : 0;
+                 return;
+               }
+               resolved_.push_back(Resolved{host, resolved, ok ? resolved_length : 0});
+             });
+    {
+      std::lock_guard<std::mutex> lock(resolved_mutex_);
+      answer->waiting = false;
+    }
+    if (answer->done) {
+      StoreResolved(host, answer->address, answer->length);
+    }
+    found = names_.find(host);
+  }
+  const ResolvedName& name = found->second;
+  if (name.length == 0) {
+    return name.resolving ? NameStatus::kPending : NameStatus::kFailed;
+  }
+  *address = name.address;
+  *length = name.length;
+  SetAddressPort(address, port);
+  return NameStatus::kResolved;
+}
+
+void UdpRelay::StoreResolved(const std::string& host, const sockaddr_storage& address,
+                             int length) {
+  ResolvedName& name = names_[host];
+  name.address = address;
+  name.length = length;
+  name.expires_ms = now_ms_ + (length != 0 ? kNameTtlMs : kNameRetryMs);
+  name.resolving = false;
+}
+
+void UdpRelay::ApplyResolved() {
+  std::vector<Resolved> resolved;
+  {
+    std::lock_guard<std::mutex> lock(resolved_mutex_);
+    resolved.swap(resolved_);
+  }
+  for (const Resolved& entry : resolved) {
+    StoreResolved(entry.host, entry.address, entry.length);
+  }
+  if (!pending_.empty()) {
+    FlushPending();
+  }
+}
+
+void UdpRelay::FlushPending() {
+  // Данные отправляемых датаграмм живут в |ready| до конца Send()
+  std::vector<PendingDatagram> ready;
+  size_t kept = 0;
+  for (size_t i = 0; i < pending_.size(); i++) {
+    PendingDatagram& datagram = pending_[i];
+    auto found = names_.find(datagram.host);
+    if (found != names_.end() && found->second.length != 0) {
+      ready.push_back(std::move(datagram));
+    } else if (found != names_.end() && found->second.resolving &&
+               datagram.expires_ms > now_ms_) {
+      if (kept != i) {
+        pending_[kept] = std::move(datagram);
+      }
+      kept++;
+    } else {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  pending_.erase(pending_.begin() + (ptrdiff_t)kept, pending_.end());
+  if (ready.empty()) {
+    return;
+  }
+
+  for (const PendingDatagram& datagram : ready) {
+    const ResolvedName& name = names_[datagram.host];
+    sockaddr_storage to = name.address;
+    SetAddressPort(&to, datagram.port);
+    Forward(datagram.from, to, name.length, datagram.data.data(), datagram.data.size());
+  }
+  if (counters_ != nullptr && !outgoing_.empty()) {
+    size_t bytes = 0;
+    for (const Outgoing& item : outgoing_) {
+      bytes += item.length;
+    }
+    counters_->AddBatch(TrafficDirection::kOutbound, bytes, outgoing_.size());
+  }
+  Send();
+}
+
+UdpRelay::Session* UdpRelay::FindSession(const sockaddr_storage& from) {
+  EndpointKey key = MakeKey(from);
+  auto found = sessions_.find(key);
+  if (found != sessions_.end()) {
+    return found->second.get();
+  }
+  if (sessions_.size() >= kMaxSessions) {
+    return nullptr;
+  }
+
+  // Новая конечная точка: ищем ассоциацию ее адреса, начиная с последней
+  uint32_t association = 0;
+  {
+    std::lock_guard<std::mutex> lock(associations_mutex_);
+    for (size_t i = associations_.size(); i-- > 0;) {
+      const sockaddr_storage& client = associations_[i].client;
+      uint16_t port = AddressPort(client);
+      if (SameHost(client, from) && (port == 0 || port == AddressPort(from))) {
+        association = associations_[i].id;
+        break;
+      }
+    }
+  }
+  if (association == 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<Session> session(new Session());
+  session->association = association;
+  session->client = from;
+  session->client_length = AddressLength(from);
+  for (Endpoint& endpoint : session->sockets) {
+    endpoint.session = session.get();
+    endpoint.socket = kInvalidSocket;
+  }
+  session->last_active_ms = now_ms_;
+  Session* result = session.get();
+  sessions_.emplace(key, std::move(session));
+  session_count_.store(sessions_.size(), std::memory_order_relaxed);
+  return result;
+}
+
+SocketHandle UdpRelay::SessionSocket(Session* session, int family) {
+  Endpoint& endpoint = session->sockets[family == AF_INET6 ? 1 : 0];
+  if (endpoint.socket != kInvalidSocket) {
+    return endpoint.socket;
+  }
+  SocketHandle socket = ::socket(family, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket == kInvalidSocket) {
+    return kInvalidSocket;
+  }
+  if (family == AF_INET6) {
+    int only = 1;
+    setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&only, sizeof(only));
+  }
+  // Порт нужен до первого ожидания ответа, поэтому привязываем явно
+  sockaddr_storage any = {};
+  any.ss_family = (decltype(any.ss_family))family;
+  if (!SetSocketNonBlocking(socket) ||
+      bind(socket, (const sockaddr*)&any, (socklen_t)AddressLength(any)) != 0) {
+    CloseSocketHandle(socket);
+    return kInvalidSocket;
+  }
+  ConfigureSocket(socket, gro_);
+  endpoint.socket = socket;
+  if (!Watch(&endpoint)) {
+    CloseSocketHandle(socket);
+    endpoint.socket = kInvalidSocket;
+  }
+  return endpoint.socket;
+}
+
+void UdpRelay::CloseSession(Session* session) {
+  for (Endpoint& endpoint : session->sockets) {
+    if (endpoint.socket != kInvalidSocket) {
+      CloseSocketHandle(endpoint.socket);
+      endpoint.socket = kInvalidSocket;
+    }
+  }
+#if defined(_WIN32)
+  poll_dirty_ = true;
+#endif
+}
+
+void UdpRelay::Sweep() {
+  // Идентификаторы выдаются по возрастанию, поэтому список упорядочен
+  std::vector<uint32_t> live;
+  {
+    std::lock_guard<std::mutex> lock(associations_mutex_);
+    live.reserve(associations_.size());
+    for (const Association& association : associations_) {
+      live.push_back(association.id);
+    }
+  }
+  for (auto it = sessions_.begin(); it != sessions_.end();) {
+    Session* session = it->second.get();
+    if (now_ms_ - session->last_active_ms >= (int64_t)idle_timeout_ms_ ||
+        !std::binary_search(live.begin(), live.end(), session->association)) {
+      CloseSession(session);
+      it = sessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  session_count_.store(sessions_.size(), std::memory_order_relaxed);
+
+  for (auto it = names_.begin(); it != names_.end();) {
+    if (it->second.expires_ms <= now_ms_) {
+      it = names_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,236 @@
+#ifndef RUNNER_UDP_RELAY_H_
+#define RUNNER_UDP_RELAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "fake_ip_table.h"
+#include "reactor.h"
+#include "traffic_counters.h"
+
+// Ретранслятор UDP для SOCKS5 UDP ASSOCIATE.
+//
+// Все ассоциации обслуживает один поток и один сокет ретранслятора; его
+// адрес сообщается клиенту в ответе на UDP ASSOCIATE. Сессия - конечная
+// точка клиента (адрес и порт источника) со своими исходящими сокетами
+// (по одному на семейство адресов): ответы на них заворачиваются в
+// заголовок SOCKS5 и уходят клиенту. Сессия закрывается вместе с
+// ассоциацией (управляющим TCP-соединением) или после idle_timeout без
+// трафика.
+//
+// Датаграмма к имени, которого еще нет в кэше, ждет ответа (не дольше
+// повтора разрешения и не больше kMaxPendingDatagrams на ретранслятор) и
+// уходит, как только адрес известен. Ответ из DNS-кэша приходит сразу,
+// и такая датаграмма отправляется в той же пачке.
+//
+// В Linux датаграммы принимаются и отправляются пачками (recvmmsg,
+// sendmmsg). Где ядро умеет, входящие датаграммы одного потока склеиваются
+// (UDP_GRO), а серии одинаковых по размеру исходящих к одному адресату
+// уходят одним сообщением с сегментацией в ядре (UDP_SEGMENT). В Windows -
+// recvfrom/WSASendTo в цикле до опустошения сокета.
+class UdpRelay {
+ public:
+  // Разрешение имени; callback может быть вызван из любого потока
+  using ResolveCallback =
+      std::function<void(bool ok, const sockaddr_storage& address, int length)>;
+  using ResolveFunction =
+      std::function<void(const std::string& host, uint16_t port, ResolveCallback callback)>;
+
+  // Сообщений за один вызов recvmmsg и размер буфера сообщения (с GRO в
+  // одном сообщении приходит серия датаграмм)
+  static constexpr size_t kBatchSize = 32;
+  static constexpr size_t kMaxMessage = 65536;
+  static constexpr size_t kMaxSessions = 4096;
+  static constexpr size_t kMaxPendingDatagrams = 256;
+
+  // |counters| может быть nullptr
+  UdpRelay(TrafficCounters* counters, ResolveFunction resolve);
+  ~UdpRelay();
+
+  UdpRelay(const UdpRelay&) = delete;
+  UdpRelay& operator=(const UdpRelay&) = delete;
+
+  // Адреса fake-IP DNS заменяются выданными за ними именами (до Start)
+  void set_fake_ips(const FakeIpTable* fake_ips) { fake_ips_ = fake_ips; }
+
+  // Открыть сокет ретранслятора на адресе |address| (порт выбирает ядро)
+  bool Start(const sockaddr_storage& address, int length, uint32_t idle_timeout_ms);
+  void Stop();
+
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  // Зарегистрировать ассоциацию клиента |client|: датаграммы принимаются
+  // только с его адреса, а если порт не 0 - и только с этого порта.
+  // Возвращает идентификатор ассоциации или 0. Вызывается из любого потока.
+  uint32_t Associate(const sockaddr_storage& client, int length);
+  void Dissociate(uint32_t id);
+
+  // Адрес сокета ретранслятора (для ответа на UDP ASSOCIATE)
+  const sockaddr_storage& address() const { return address_; }
+  uint16_t port() const;
+
+  bool gso() const { return gso_; }
+  bool gro() const { return gro_; }
+  size_t session_count() const { return session_count_.load(std::memory_order_relaxed); }
+  uint64_t dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Session;
+
+  // Сокет, за готовностью которого следит поток; у сокета ретранслятора
+  // session == nullptr
+  struct Endpoint {
+    Session* session;
+    SocketHandle socket;
+  };
+
+  // Адрес и порт в виде, пригодном для ключа хеш-таблицы
+  struct EndpointKey {
+    uint64_t words[3];
+
+    bool operator==(const EndpointKey& other) const {
+      return words[0] == other.words[0] && words[1] == other.words[1] &&
+             words[2] == other.words[2];
+    }
+  };
+
+  struct EndpointKeyHash {
+    size_t operator()(const EndpointKey& key) const;
+  };
+
+  struct Session {
+    uint32_t association = 0;
+    sockaddr_storage client = {};
+    int client_length = 0;
+    Endpoint sockets[2] = {};  // IPv4, IPv6
+    int64_t last_active_ms = 0;
+  };
+
+  struct Association {
+    uint32_t id;
+    sockaddr_storage client;
+  };
+
+  // Исходящая датаграмма: необязательный заголовок SOCKS5 и данные из
+  // буфера приема
+  struct Outgoing {
+    SocketHandle socket;
+    sockaddr_storage to;
+    int to_length;
+    uint8_t header_length;
+    char header[22];
+    const char* data;
+    size_t length;
+  };
+
+  // Разобранное имя из заголовка SOCKS5 (ATYP 0x03)
+  struct ResolvedName {
+    sockaddr_storage address;
+    int length;  // 0 - не разрешено или еще разрешается
+    int64_t expires_ms;
+    bool resolving;  // ответ еще не пришел
+  };
+
+  enum class NameStatus { kResolved, kPending, kFailed };
+
+  // Датаграмма, ждущая разрешения имени назначения
+  struct PendingDatagram {
+    sockaddr_storage from;
+    std::string host;
+    uint16_t port;
+    std::string data;
+    int64_t expires_ms;
+  };
+
+  struct Resolved {
+    std::string host;
+    sockaddr_storage address;
+    int length;
+  };
+
+  static EndpointKey MakeKey(const sockaddr_storage& address);
+
+  void Loop();
+  size_t Wait(int timeout_ms, Endpoint** ready, size_t capacity);
+  bool Watch(Endpoint* endpoint);
+
+  // Принять пачку с сокета; false - сокет пуст или ошибка
+  bool Receive(SocketHandle socket);
+  void Send();
+
+  void OnClientMessages();
+  void OnRemoteMessages(Session* session, SocketHandle socket);
+  void OnClientDatagram(const sockaddr_storage& from, const char* data, size_t length);
+  void Forward(const sockaddr_storage& from, const sockaddr_storage& to, int to_length,
+               const char* data, size_t length);
+  NameStatus ResolveName(const std::string& host, uint16_t port, sockaddr_storage* address,
+                         int* length);
+  void StoreResolved(const std::string& host, const sockaddr_storage& address, int length);
+  void ApplyResolved();
+  void FlushPending();
+
+  Session* FindSession(const sockaddr_storage& from);
+  SocketHandle SessionSocket(Session* session, int family);
+  void CloseSession(Session* session);
+  void Sweep();
+
+  TrafficCounters* counters_;
+  ResolveFunction resolve_;
+  const FakeIpTable* fake_ips_ = nullptr;
+  uint32_t idle_timeout_ms_ = 0;
+
+  SocketHandle socket_ = kInvalidSocket;
+  sockaddr_storage address_ = {};
+  Endpoint relay_endpoint_ = {};
+  bool gso_ = false;
+  bool gro_ = false;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<size_t> session_count_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+  // Поток ретранслятора
+  int64_t now_ms_ = 0;
+  int64_t next_sweep_ms_ = 0;
+  std::unordered_map<EndpointKey, std::unique_ptr<Session>, EndpointKeyHash> sessions_;
+  std::unordered_map<std::string, ResolvedName> names_;
+  std::vector<PendingDatagram> pending_;
+  std::vector<Outgoing> outgoing_;
+
+  // Буферы приема и разобранные сообщения последней пачки
+  std::unique_ptr<char[]> buffers_;
+  struct Message {
+    size_t length;
+    size_t segment;  // размер склеенных датаграмм (GRO); 0 - одна датаграмма
+    sockaddr_storage from;
+  };
+  Message messages_[kBatchSize];
+  size_t message_count_ = 0;
+
+#if defined(_WIN32)
+  std::vector<WSAPOLLFD> poll_fds_;
+  std::vector<Endpoint*> poll_endpoints_;
+  bool poll_dirty_ = true;
+#elif defined(__linux__)
+  int epoll_ = -1;
+#endif
+
+  std::mutex associations_mutex_;
+  std::vector<Association> associations_;
+  uint32_t next_association_ = 1;
+
+  std::mutex resolved_mutex_;
+  std::vector<Resolved> resolved_;
+};
+
+#endif  // RUNNER_UDP_RELAY_H_
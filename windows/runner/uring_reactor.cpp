@@ -0,0 +1,776 @@
+#include "uring_reactor.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr unsigned kSqEntries = 1024;
+constexpr unsigned kCqEntries = 8192;
+constexpr uint16_t kBufferGroup = 1;
+
+// Длина цепочки отправок в один сокет за итерацию
+constexpr size_t kMaxWriteChain = 16;
+
+// Ниже этого запаса свободных буферов recv голодавших сокетов не
+// возвращается в многоразовый режим
+constexpr uint32_t kBufferReserve = UringReactor::kBufferCount / 4;
+
+// Младшие биты user_data: что за запрос завершился. Для операций это
+// указатель на IoOp (выровнен на 8), для многоразовых запросов сокета -
+// поколение, дескриптор и тег.
+enum : uint64_t {
+  kTagOp = 0,
+  kTagRecv = 1,
+  kTagAccept = 2,
+  kTagWake = 3,
+  kTagIgnore = 4,
+  kTagMask = 7,
+};
+
+uint64_t SocketTag(int socket, uint32_t generation, uint64_t tag) {
+  return ((uint64_t)generation << 32) | ((uint64_t)(uint32_t)socket << 3) | tag;
+}
+
+// Поколение сокета на момент Submit() хранится в служебной области IoOp
+void SetOpGeneration(IoOp* op, uint32_t generation) {
+  memcpy(op->platform, &generation, sizeof(generation));
+}
+
+uint32_t OpGeneration(const IoOp* op) {
+  uint32_t generation;
+  memcpy(&generation, op->platform, sizeof(generation));
+  return generation;
+}
+
+}  // namespace
+
+void UringReactor::OpQueue::Push(IoOp* op) {
+  op->next = nullptr;
+  if (tail != nullptr) {
+    tail->next = op;
+  } else {
+    head = op;
+  }
+  tail = op;
+}
+
+void UringReactor::OpQueue::Append(OpQueue* other) {
+  if (other->head == nullptr) {
+    return;
+  }
+  if (tail != nullptr) {
+    tail->next = other->head;
+  } else {
+    head = other->head;
+  }
+  tail = other->tail;
+  *other = OpQueue();
+}
+
+IoOp* UringReactor::OpQueue::Pop() {
+  IoOp* op = head;
+  if (op != nullptr) {
+    head = op->next;
+    if (head == nullptr) {
+      tail = nullptr;
+    }
+    op->next = nullptr;
+  }
+  return op;
+}
+
+UringReactor::UringReactor() = default;
+
+UringReactor::~UringReactor() {
+  if (ring_ >= 0) {
+    close(ring_);
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_map_ != nullptr && cq_map_ != sq_map_) {
+    munmap(cq_map_, cq_map_size_);
+  }
+  if (sq_map_ != nullptr) {
+    munmap(sq_map_, sq_map_size_);
+  }
+  if (buffer_ring_ != nullptr) {
+    munmap(buffer_ring_, buffer_ring_size_);
+  }
+  if (buffers_ != nullptr) {
+    munmap(buffers_, (size_t)kBufferCount * kBufferSize);
+  }
+  if (wake_ >= 0) {
+    close(wake_);
+  }
+  for (auto& state : sockets_) {
+    if (state) {
+      for (int socket : state->accepted) {
+        close(socket);
+      }
+    }
+  }
+}
+
+bool UringReactor::Open() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+  params.cq_entries = kCqEntries;
+  ring_ = (int)syscall(__NR_io_uring_setup, kSqEntries, &params);
+  if (ring_ < 0 && errno == EINVAL) {
+    // COOP_TASKRUN появился в 5.19
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCqEntries;
+    ring_ = (int)syscall(__NR_io_uring_setup, kSqEntries, &params);
+  }
+  if (ring_ < 0) {
+    return false;
+  }
+  const uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                            IORING_FEAT_EXT_ARG | IORING_FEAT_FAST_POLL;
+  if ((params.features & required) != required) {
+    return false;
+  }
+
+  sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  sq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+  cq_map_size_ = sq_map_size_;
+  void* map = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_, IORING_OFF_SQ_RING);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  sq_map_ = map;
+  cq_map_ = map;
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  map = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+             IORING_OFF_SQES);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = (io_uring_sqe*)map;
+
+  char* sq = (char*)sq_map_;
+  sq_head_ = (uint32_t*)(sq + params.sq_off.head);
+  sq_tail_ = (uint32_t*)(sq + params.sq_off.tail);
+  sq_mask_ = *(uint32_t*)(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_array_ = (uint32_t*)(sq + params.sq_off.array);
+  sq_local_tail_ = *sq_tail_;
+  char* cq = (char*)cq_map_;
+  cq_head_ = (uint32_t*)(cq + params.cq_off.head);
+  cq_tail_ = (uint32_t*)(cq + params.cq_off.tail);
+  cq_mask_ = *(uint32_t*)(cq + params.cq_off.ring_mask);
+  cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  // Кольцо буферов для recv (5.19+)
+  buffer_ring_size_ = kBufferCount * sizeof(io_uring_buf);
+  map = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  buffer_ring_ = (io_uring_buf_ring*)map;
+  map = mmap(nullptr, (size_t)kBufferCount * kBufferSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  buffers_ = (char*)map;
+
+  io_uring_buf_reg registration;
+  memset(&registration, 0, sizeof(registration));
+  registration.ring_addr = (uint64_t)(uintptr_t)buffer_ring_;
+  registration.ring_entries = kBufferCount;
+  registration.bgid = kBufferGroup;
+  if (syscall(__NR_io_uring_register, ring_, IORING_REGISTER_PBUF_RING, &registration, 1) !=
+      0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < kBufferCount; i++) {
+    RecycleBuffer((uint16_t)i);
+  }
+  PublishBuffers();
+
+  wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_ < 0) {
+    return false;
+  }
+  ArmWake();
+  return true;
+}
+
+UringReactor::SocketState* UringReactor::State(SocketHandle socket) {
+  if (socket < 0) {
+    return nullptr;
+  }
+  if ((size_t)socket >= sockets_.size()) {
+    sockets_.resize((size_t)socket + 1);
+  }
+  if (!sockets_[socket]) {
+    sockets_[socket].reset(new SocketState());
+  }
+  return sockets_[socket].get();
+}
+
+UringReactor::SocketState* UringReactor::Lookup(SocketHandle socket, uint32_t generation) {
+  if (socket < 0 || (size_t)socket >= sockets_.size() || !sockets_[socket]) {
+    return nullptr;
+  }
+  SocketState* state = sockets_[socket].get();
+  if (!state->attached || state->generation != generation) {
+    return nullptr;
+  }
+  return state;
+}
+
+io_uring_sqe* UringReactor::NextSqe() {
+  // Кольцо заполнено: отправляем накопленное, не дожидаясь завершений
+  while (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+    if (Enter(pending_submit_, 0, 0) < 0 && errno != EINTR && errno != EAGAIN &&
+        errno != EBUSY) {
+      break;
+    }
+  }
+  uint32_t index = sq_local_tail_ & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  sq_local_tail_++;
+  pending_submit_++;
+  return sqe;
+}
+
+int UringReactor::Enter(unsigned submit, unsigned wait, int timeout_ms) {
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+
+  // GETEVENTS всегда: с COOP_TASKRUN он же выполняет отложенную работу ядра
+  unsigned flags = IORING_ENTER_GETEVENTS;
+  __kernel_timespec timeout;
+  io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  void* argument = nullptr;
+  size_t argument_size = 0;
+  if (wait > 0 && timeout_ms >= 0) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+    arg.ts = (uint64_t)(uintptr_t)&timeout;
+    flags |= IORING_ENTER_EXT_ARG;
+    argument = &arg;
+    argument_size = sizeof(arg);
+  }
+  int result = (int)syscall(__NR_io_uring_enter, ring_, submit, wait, flags, argument,
+                            argument_size);
+  if (result > 0) {
+    pending_submit_ -= std::min<unsigned>((unsigned)result, pending_submit_);
+  }
+  return result;
+}
+
+void UringReactor::ArmWake() {
+  io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = wake_;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = kTagWake;
+}
+
+void UringReactor::ArmAccept(SocketHandle socket, SocketState* state) {
+  io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = socket;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = SocketTag(socket, state->generation, kTagAccept);
+  state->accept_armed = true;
+}
+
+void UringReactor::ArmRecv(SocketHandle socket, SocketState* state) {
+  io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = socket;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = SocketTag(socket, state->generation, kTagRecv);
+  state->recv_armed = true;
+  state->recv_paused = false;
+}
+
+void UringReactor::SubmitDirectRead(SocketHandle socket, SocketState* state) {
+  IoOp* op = state->reads.Pop();
+  io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = socket;
+  sqe->addr = (uint64_t)(uintptr_t)op->buffer;
+  sqe->len = (uint32_t)op->length;
+  sqe->user_data = (uint64_t)(uintptr_t)op | kTagOp;
+  state->direct_read = true;
+}
+
+bool UringReactor::Attach(SocketHandle socket) {
+  SocketState* state = State(socket);
+  if (state == nullptr) {
+    return false;
+  }
+  state->attached = true;
+  return true;
+}
+
+bool UringReactor::Submit(IoOp* op) {
+  SocketState* state = State(op->socket);
+  if (state == nullptr || !state->attached) {
+    op->error = EBADF;
+    return false;
+  }
+  op->transferred = 0;
+  op->error = 0;
+  op->accepted = kInvalidSocket;
+  SetOpGeneration(op, state->generation);
+
+  switch (op->type) {
+    case IoOpType::kAccept:
+      state->accepts.Push(op);
+      if (!state->accept_armed) {
+        ArmAccept(op->socket, state);
+      }
+      DeliverAccepts(state);
+      return true;
+
+    case IoOpType::kRead:
+      state->reads.Push(op);
+      DeliverReads(op->socket, state);
+      return true;
+
+    case IoOpType::kConnect: {
+      io_uring_sqe* sqe = NextSqe();
+      sqe->opcode = IORING_OP_CONNECT;
+      sqe->fd = op->socket;
+      sqe->addr = (uint64_t)(uintptr_t)&op->address;
+      sqe->off = (uint64_t)op->address_length;
+      sqe->user_data = (uint64_t)(uintptr_t)op | kTagOp;
+      return true;
+    }
+
+    case IoOpType::kWrite:
+      state->writes.Push(op);
+      if (!state->write_dirty) {
+        state->write_dirty = true;
+        write_dirty_.push_back(op->socket);
+      }
+      return true;
+
+    default:
+      op->error = EOPNOTSUPP;
+      return false;
+  }
+}
+
+void UringReactor::FlushWrites() {
+  std::vector<SocketHandle> dirty;
+  dirty.swap(write_dirty_);
+  for (SocketHandle socket : dirty) {
+    if (socket < 0 || (size_t)socket >= sockets_.size() || !sockets_[socket]) {
+      continue;
+    }
+    SocketState* state = sockets_[socket].get();
+    state->write_dirty = false;
+    // Следующая цепочка - только после завершения текущей
+    if (!state->attached || state->writes_in_flight > 0) {
+      continue;
+    }
+    // Недописанные и отмененные операции идут перед новыми
+    state->retry.Append(&state->writes);
+    state->writes = state->retry;
+    state->retry = OpQueue();
+
+    // Места в кольце должно хватить на всю цепочку, иначе связь порвется
+    size_t chain = 0;
+    for (IoOp* op = state->writes.head; op != nullptr && chain < kMaxWriteChain;
+         op = op->next) {
+      chain++;
+    }
+    while (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + chain >
+           sq_entries_) {
+      if (Enter(pending_submit_, 0, 0) < 0 && errno != EINTR && errno != EAGAIN &&
+          errno != EBUSY) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < chain; i++) {
+      IoOp* op = state->writes.Pop();
+      io_uring_sqe* sqe = NextSqe();
+      sqe->opcode = IORING_OP_SEND;
+      sqe->fd = socket;
+      sqe->addr = (uint64_t)(uintptr_t)(op->buffer + op->transferred);
+      sqe->len = (uint32_t)(op->length - op->transferred);
+      sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+      sqe->flags = i + 1 < chain ? IOSQE_IO_LINK : 0;
+      sqe->user_data = (uint64_t)(uintptr_t)op | kTagOp;
+      state->writes_in_flight++;
+    }
+    if (state->writes.head != nullptr) {
+      state->write_dirty = true;
+      write_dirty_.push_back(socket);
+    }
+  }
+}
+
+void UringReactor::Close(SocketHandle socket) {
+  SocketState* state = nullptr;
+  if (socket >= 0 && (size_t)socket < sockets_.size() && sockets_[socket]) {
+    state = sockets_[socket].get();
+  }
+  if (state == nullptr || !state->attached) {
+    close(socket);
+    return;
+  }
+
+  // Операции, еще не переданные ядру, отменяются сразу
+  OpQueue* queues[] = {&state->accepts, &state->reads, &state->writes, &state->retry};
+  for (OpQueue* queue : queues) {
+    for (IoOp* op = queue->Pop(); op != nullptr; op = queue->Pop()) {
+      op->error = ECANCELED;
+      Complete(op);
+    }
+  }
+  for (size_t i = state->chunk_head; i < state->chunks.size(); i++) {
+    RecycleBuffer(state->chunks[i].buffer_id);
+  }
+  for (int accepted : state->accepted) {
+    close(accepted);
+  }
+
+  // Новое поколение: поздние CQE старого сокета будут отброшены
+  uint32_t generation = state->generation + 1;
+  *state = SocketState();
+  state->generation = generation;
+
+  // Отмена запросов в ядре и закрытие одной жесткой цепочкой: отмена без
+  // запросов возвращает ENOENT, но закрытие все равно выполнится
+  while (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + 2 > sq_entries_) {
+    if (Enter(pending_submit_, 0, 0) < 0 && errno != EINTR && errno != EAGAIN &&
+        errno != EBUSY) {
+      break;
+    }
+  }
+  io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = socket;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  sqe->flags = IOSQE_IO_HARDLINK;
+  sqe->user_data = kTagIgnore;
+  sqe = NextSqe();
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->fd = socket;
+  sqe->user_data = kTagIgnore;
+}
+
+void UringReactor::HandleCqe(const io_uring_cqe* cqe) {
+  uint64_t tag = cqe->user_data & kTagMask;
+  if (tag == kTagOp) {
+    HandleOp((IoOp*)(uintptr_t)cqe->user_data, cqe->res);
+    return;
+  }
+  if (tag == kTagWake) {
+    uint64_t value;
+    while (read(wake_, &value, sizeof(value)) > 0) {
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      ArmWake();
+    }
+    return;
+  }
+  if (tag == kTagIgnore) {
+    return;
+  }
+
+  SocketHandle socket = (SocketHandle)((cqe->user_data >> 3) & 0x1FFFFFFF);
+  uint32_t generation = (uint32_t)(cqe->user_data >> 32);
+  SocketState* state = Lookup(socket, generation);
+  if (tag == kTagAccept) {
+    if (state == nullptr) {
+      if (cqe->res >= 0) {
+        close(cqe->res);
+      }
+      return;
+    }
+    HandleAccept(socket, state, cqe);
+  } else if (tag == kTagRecv) {
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+      buffers_free_--;
+    }
+    if (state == nullptr) {
+      if (cqe->flags & IORING_CQE_F_BUFFER) {
+        RecycleBuffer((uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+      }
+      return;
+    }
+    HandleRecv(socket, state, cqe);
+  }
+}
+
+void UringReactor::HandleAccept(SocketHandle socket, SocketState* state,
+                                const io_uring_cqe* cqe) {
+  bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+  if (!more) {
+    state->accept_armed = false;
+  }
+  if (cqe->res >= 0) {
+    state->accepted.push_back(cqe->res);
+    if (!more && state->accepts.head != nullptr) {
+      ArmAccept(socket, state);
+    }
+  } else if (cqe->res != -ECANCELED && state->accepts.head != nullptr) {
+    // Ошибка приема (например, EMFILE) уходит одной операции; повторная
+    // отправка операции снова поставит accept
+    IoOp* op = state->accepts.Pop();
+    op->error = -cqe->res;
+    Complete(op);
+  }
+  DeliverAccepts(state);
+}
+
+void UringReactor::HandleRecv(SocketHandle socket, SocketState* state,
+                              const io_uring_cqe* cqe) {
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    state->recv_armed = false;
+  }
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    uint16_t buffer_id = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    if (cqe->res > 0) {
+      state->chunks.push_back(Chunk{buffer_id, 0, (uint32_t)cqe->res});
+    } else {
+      RecycleBuffer(buffer_id);
+    }
+  }
+  if (cqe->res == 0) {
+    state->eof = true;
+  } else if (cqe->res == -ENOBUFS) {
+    // Кольцо пусто: ставим заново, когда вернутся буферы
+    if (!state->starved) {
+      state->starved = true;
+      starved_.push_back(std::make_pair(socket, state->generation));
+    }
+  } else if (cqe->res < 0 && cqe->res != -ECANCELED) {
+    state->read_error = -cqe->res;
+  }
+  DeliverReads(socket, state);
+}
+
+void UringReactor::HandleOp(IoOp* op, int result) {
+  SocketState* state = Lookup(op->socket, OpGeneration(op));
+  if (op->type == IoOpType::kWrite) {
+    HandleWrite(op, state, result);
+    return;
+  }
+  if (op->type == IoOpType::kRead) {
+    HandleRead(op, state, result);
+    return;
+  }
+  // kConnect
+  if (result < 0) {
+    op->error = -result;
+  }
+  Complete(op);
+}
+
+void UringReactor::HandleRead(IoOp* op, SocketState* state, int result) {
+  if (result >= 0) {
+    op->transferred = (size_t)result;
+  } else {
+    op->error = -result;
+  }
+  Complete(op);
+  if (state == nullptr) {
+    return;
+  }
+  state->direct_read = false;
+  if (result == 0) {
+    state->eof = true;
+  } else if (result < 0) {
+    state->read_error = -result;
+  }
+  DeliverReads(op->socket, state);
+}
+
+void UringReactor::HandleWrite(IoOp* op, SocketState* state, int result) {
+  if (result > 0) {
+    op->transferred += (size_t)result;
+  }
+  if (state == nullptr) {
+    // Сокет закрыт: запрос отменен вместе с ним
+    if (op->transferred < op->length) {
+      op->error = result < 0 ? -result : ECANCELED;
+    }
+    Complete(op);
+    return;
+  }
+
+  state->writes_in_flight--;
+  if (op->transferred >= op->length) {
+    Complete(op);
+  } else if (state->write_error == 0 && (result > 0 || result == -ECANCELED)) {
+    // Короткая отправка порвала цепочку: она и отмененный хвост уходят
+    // следующей цепочкой в исходном порядке
+    state->retry.Push(op);
+  } else {
+    op->error = result < 0 ? -result : EPIPE;
+    if (result != -ECANCELED) {
+      state->write_error = op->error;
+    }
+    Complete(op);
+  }
+  if (state->writes_in_flight == 0 &&
+      (state->retry.head != nullptr || state->writes.head != nullptr) && !state->write_dirty) {
+    state->write_dirty = true;
+    write_dirty_.push_back(op->socket);
+  }
+}
+
+void UringReactor::DeliverAccepts(SocketState* state) {
+  while (state->accepts.head != nullptr && !state->accepted.empty()) {
+    IoOp* op = state->accepts.Pop();
+    op->accepted = state->accepted.back();
+    state->accepted.pop_back();
+    Complete(op);
+  }
+}
+
+void UringReactor::DeliverReads(SocketHandle socket, SocketState* state) {
+  while (state->reads.head != nullptr) {
+    IoOp* op = state->reads.head;
+    if (state->chunk_head < state->chunks.size()) {
+      size_t copied = 0;
+      while (copied < op->length && state->chunk_head < state->chunks.size()) {
+        Chunk& chunk = state->chunks[state->chunk_head];
+        size_t count = std::min<size_t>(op->length - copied, chunk.length);
+        memcpy(op->buffer + copied,
+               buffers_ + (size_t)chunk.buffer_id * kBufferSize + chunk.offset, count);
+        copied += count;
+        chunk.offset += (uint32_t)count;
+        chunk.length -= (uint32_t)count;
+        if (chunk.length == 0) {
+          RecycleBuffer(chunk.buffer_id);
+          state->chunk_head++;
+        }
+      }
+      if (state->chunk_head == state->chunks.size()) {
+        state->chunks.clear();
+        state->chunk_head = 0;
+      }
+      op->transferred = copied;
+    } else if (state->eof) {
+      op->transferred = 0;
+    } else if (state->read_error != 0) {
+      op->error = state->read_error;
+    } else {
+      break;
+    }
+    Complete(state->reads.Pop());
+  }
+
+  size_t queued = state->chunks.size() - state->chunk_head;
+  if (state->recv_armed) {
+    // Получатель не успевает: снимаем recv, пока очередь не разобрана
+    if (!state->recv_paused && queued >= kMaxQueuedBuffers) {
+      io_uring_sqe* sqe = NextSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = SocketTag(socket, state->generation, kTagRecv);
+      sqe->user_data = kTagIgnore;
+      state->recv_paused = true;
+    }
+  } else if (state->reads.head != nullptr && !state->direct_read && !state->eof &&
+             state->read_error == 0 && queued < kMaxQueuedBuffers) {
+    if (state->starved) {
+      SubmitDirectRead(socket, state);
+    } else {
+      ArmRecv(socket, state);
+    }
+  }
+}
+
+void UringReactor::RecycleBuffer(uint16_t buffer_id) {
+  // Записи отсчитываются от начала кольца: в C++ пустая структура из
+  // __DECLARE_FLEX_ARRAY имеет размер 1 и сдвигает член bufs на 8 байт.
+  // Поле tail наложено на резерв первой записи, поэтому пишем поля по одному.
+  io_uring_buf* buffer =
+      (io_uring_buf*)buffer_ring_ + (buffer_tail_ & (kBufferCount - 1));
+  buffer->addr = (uint64_t)(uintptr_t)(buffers_ + (size_t)buffer_id * kBufferSize);
+  buffer->len = kBufferSize;
+  buffer->bid = buffer_id;
+  buffer_tail_++;
+  buffers_free_++;
+}
+
+void UringReactor::PublishBuffers() {
+  __atomic_store_n(&buffer_ring_->tail, buffer_tail_, __ATOMIC_RELEASE);
+}
+
+void UringReactor::Complete(IoOp* op) {
+  completed_.Push(op);
+}
+
+size_t UringReactor::Poll(int timeout_ms) {
+  FlushWrites();
+  PublishBuffers();
+  if (buffers_free_ >= kBufferReserve && !starved_.empty()) {
+    // Кольцо восстановилось: голодавшие сокеты возвращаются к многоразовому recv
+    std::vector<std::pair<SocketHandle, uint32_t>> starved;
+    starved.swap(starved_);
+    for (const auto& entry : starved) {
+      SocketState* state = Lookup(entry.first, entry.second);
+      if (state != nullptr && state->starved) {
+        state->starved = false;
+        DeliverReads(entry.first, state);
+      }
+    }
+  }
+  bool wait = completed_.head == nullptr && timeout_ms != 0;
+  int result = Enter(pending_submit_, wait ? 1 : 0, timeout_ms);
+  if (result < 0 && errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    return 0;
+  }
+
+  // Пачка CQE разбирается с одним сдвигом головы
+  uint32_t head = *cq_head_;
+  uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    HandleCqe(&cqes_[head & cq_mask_]);
+    head++;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  PublishBuffers();
+
+  OpQueue ready = completed_;
+  completed_ = OpQueue();
+  size_t delivered = 0;
+  for (IoOp* op = ready.Pop(); op != nullptr; op = ready.Pop()) {
+    op->handler->OnIoComplete(op);
+    delivered++;
+  }
+  return delivered;
+}
+
+void UringReactor::Wake() {
+  uint64_t value = 1;
+  ssize_t written = write(wake_, &value, sizeof(value));
+  (void)written;
+}
+
+#endif  // defined(__linux__)
@@ -0,0 +1,170 @@
+#ifndef RUNNER_URING_REACTOR_H_
+#define RUNNER_URING_REACTOR_H_
+
+#if defined(__linux__)
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "reactor.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+// Реактор на io_uring (без liburing, через системные вызовы напрямую).
+//
+// Число системных вызовов не зависит от числа соединений: все SQE за
+// итерацию уходят одним io_uring_enter(), который тут же ждет завершений,
+// а CQE разбираются пачкой с одним сдвигом головы кольца.
+//
+// - kAccept: на слушающий сокет ставится один многоразовый (multishot)
+//   accept, принятые сокеты раздаются ожидающим операциям.
+// - kRead: на сокет ставится многоразовый recv с буферами из общего
+//   кольца (provided buffers). Данные копируются в буфер операции, а буфер
+//   кольца сразу возвращается. Чтобы один медленный получатель не занял
+//   все кольцо, recv снимается после kMaxQueuedBuffers неразобранных
+//   буферов и ставится снова после их разбора. Сокет, которому не хватило
+//   буферов, пока кольцо не восстановится, читает одноразовым recv прямо в
+//   буфер операции: иначе при тысячах соединений он проигрывает гонку за
+//   буферы активным сокетам.
+// - kWrite: отправки в сокет выстраиваются в цепочку связанных SQE
+//   (IOSQE_IO_LINK), поэтому порядок сохраняется без ожидания каждой.
+//   Короткая отправка дописывается, а отмененный хвост цепочки
+//   переотправляется.
+// - Close(): отмена всех запросов сокета и закрытие связаны в одну
+//   цепочку. Номер дескриптора не освобождается до ее выполнения, а поздние
+//   CQE старого сокета отсекаются по поколению.
+//
+// kSpliceIn/kSpliceOut не поддерживаются: splice() сокета io_uring
+// выполняет в фоновых потоках, что противоречит цели этого реактора.
+class UringReactor : public Reactor {
+ public:
+  // Общее кольцо буферов для recv
+  static constexpr uint32_t kBufferCount = 2048;
+  static constexpr uint32_t kBufferSize = 8 * 1024;
+  static constexpr size_t kMaxQueuedBuffers = 4;
+
+  UringReactor();
+  ~UringReactor() override;
+
+  // false - ядро не поддерживает нужные возможности io_uring
+  bool Open();
+
+  bool Attach(SocketHandle socket) override;
+  bool Submit(IoOp* op) override;
+  void Close(SocketHandle socket) override;
+  size_t Poll(int timeout_ms) override;
+  void Wake() override;
+  const char* name() const override { return "io_uring"; }
+
+ private:
+  struct OpQueue {
+    IoOp* head = nullptr;
+    IoOp* tail = nullptr;
+
+    void Push(IoOp* op);
+    void Append(OpQueue* other);
+    IoOp* Pop();
+  };
+
+  // Неразобранная часть буфера кольца
+  struct Chunk {
+    uint16_t buffer_id;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  struct SocketState {
+    bool attached = false;
+    uint32_t generation = 0;
+
+    // Прием
+    bool accept_armed = false;
+    OpQueue accepts;
+    std::vector<int> accepted;
+
+    // Чтение
+    bool recv_armed = false;
+    bool recv_paused = false;  // снят из-за переполнения очереди буферов
+    bool starved = false;      // кольцо было пусто (ENOBUFS)
+    bool direct_read = false;  // одноразовый recv в буфер операции
+    bool eof = false;
+    int read_error = 0;
+    OpQueue reads;
+    std::vector<Chunk> chunks;
+    size_t chunk_head = 0;
+
+    // Запись: очередь, отправленная цепочка и отмененный хвост цепочки
+    OpQueue writes;
+    OpQueue retry;
+    size_t writes_in_flight = 0;
+    int write_error = 0;
+    bool write_dirty = false;  // в списке на отправку
+  };
+
+  SocketState* State(SocketHandle socket);
+  SocketState* Lookup(SocketHandle socket, uint32_t generation);
+
+  io_uring_sqe* NextSqe();
+  int Enter(unsigned submit, unsigned wait, int timeout_ms);
+
+  void ArmAccept(SocketHandle socket, SocketState* state);
+  void ArmRecv(SocketHandle socket, SocketState* state);
+  void SubmitDirectRead(SocketHandle socket, SocketState* state);
+  void ArmWake();
+  void FlushWrites();
+
+  void HandleCqe(const io_uring_cqe* cqe);
+  void HandleAccept(SocketHandle socket, SocketState* state, const io_uring_cqe* cqe);
+  void HandleRecv(SocketHandle socket, SocketState* state, const io_uring_cqe* cqe);
+  void HandleOp(IoOp* op, int result);
+  void HandleRead(IoOp* op, SocketState* state, int result);
+  void HandleWrite(IoOp* op, SocketState* state, int result);
+
+  void DeliverAccepts(SocketState* state);
+  void DeliverReads(SocketHandle socket, SocketState* state);
+  void RecycleBuffer(uint16_t buffer_id);
+  void PublishBuffers();
+  void Complete(IoOp* op);
+
+  int ring_ = -1;
+  int wake_ = -1;
+
+  // Отображения колец
+  void* sq_map_ = nullptr;
+  size_t sq_map_size_ = 0;
+  void* cq_map_ = nullptr;
+  size_t cq_map_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t* sq_array_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t sq_entries_ = 0;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  uint32_t sq_local_tail_ = 0;
+  unsigned pending_submit_ = 0;
+
+  // Кольцо буферов
+  io_uring_buf_ring* buffer_ring_ = nullptr;
+  size_t buffer_ring_size_ = 0;
+  char* buffers_ = nullptr;
+  uint16_t buffer_tail_ = 0;
+  uint32_t buffers_free_ = 0;  // буферов в кольце, доступных ядру
+
+  std::vector<std::unique_ptr<SocketState>> sockets_;
+  std::vector<SocketHandle> write_dirty_;
+  std::vector<std::pair<SocketHandle, uint32_t>> starved_;
+  OpQueue completed_;
+};
+
+#endif  // defined(__linux__)
+
+#endif  // RUNNER_URING_REACTOR_H_
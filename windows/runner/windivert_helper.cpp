@@ -9,6 +9,30 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "fake_dns_server.h"
+#include "fake_ip_table.h"
+#include "flow_route.h"
+#include "flow_table.h"
+#include "latency_prober.h"
+#include "native_log.h"
+#include "packet_headers.h"
+#include "packet_pump.h"
+#include "prefix_table.h"
+#include "process_monitor.h"
+#include "process_table.h"
+#include "proxy_server.h"
+#include "routing_helper.h"
+#include "rule_program.h"
+#include "traffic_counters.h"
+#include "traffic_sniffer.h"
+#include "windivert_packet_io.h"
+
 #pragma comment(lib, "wininet.lib")
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "iphlpapi.lib")
@@ -26,48 +50,142 @@ static BOOL g_enableUdp = TRUE;
 static INTERNET_PROXY_INFO g_oldProxySettings;
 static BOOL g_proxyBackupAvailable = FALSE;
 
-// Статистика трафика
-static volatile int64_t g_downloadedBytes = 0;
-static volatile int64_t g_uploadedBytes = 0;
-static volatile int32_t g_latency = 0;
+// Статистика трафика (счетчики пополняются из пакетного тракта)
+static TrafficCounters g_traffic;
 
-// Флаг инициализации Winsock
-static BOOL g_winsockInitialized = FALSE;
+// Фоновый замер пинга: все цели меряются параллельно в отдельном потоке,
+// GetTrafficStats только читает последний результат
+static LatencyProber g_latencyProber;
+static int32_t g_serverTarget = -1;
+
+// Перехват для правил профиля: пачки принимаются и отправляются через
+// WinDivertRecvEx/SendEx. Перехватываются только пакеты, по которым
+// решается судьба потока: исходящие SYN и данные TCP (по первым данным
+// разбирается имя), FIN/RST (поток удаляется из таблицы) и датаграммы UDP,
+// а из входящих - RST. Чистые ACK и туннель к серверу VPN идут мимо. Из
+// действий профиля пакеты меняет только 'block': 'proxy' и 'direct' для
+// приложений на системном прокси разводит ядро, прозрачного
+// перенаправления в локальный прокси здесь нет.
+static const char* g_divertFilter =
+    "!loopback and ((outbound and (udp or (tcp and (tcp.Syn or tcp.Fin or tcp.Rst or "
+    "tcp.PayloadLength > 0)))) or (inbound and tcp and tcp.Rst))";
+static WinDivertPacketIo g_divertIo;
+static PacketPump g_packetPump(&g_divertIo, NULL);
+
+// Учет трафика: копии пакетов туннеля к серверу VPN в режиме наблюдения,
+// без задержки самих пакетов
+static WinDivertPacketIo g_tunnelIo;
+static PacketPump g_tunnelPump(&g_tunnelIo, &g_traffic);
+
+// Встроенный SOCKS5/HTTP CONNECT прокси. Считает байты отдельно: при
+// работающем захвате туннеля те же байты уже учтены в g_traffic
+static TrafficCounters g_proxyTraffic;
+static ProxyServer g_localProxy(&g_proxyTraffic);
+
+// Режим fake-IP: DNS-сервер выдает именам, уходящим в прокси, адреса из
+// 198.18.0.0/15, а прокси и правила восстанавливают по ним имена
+static bool ShouldFakeDomain(const std::string& domain);
+static FakeIpTable g_fakeIps;
+static FakeDnsServer g_fakeDns(&g_fakeIps, ShouldFakeDomain);
+
+// Владельцы локальных сокетов для правил 'process'. Монитор обновляет
+// таблицу по событиям слоя SOCKET, поток перехвата только читает ее.
+static ProcessTable g_processTable;
+static ProcessMonitor g_processMonitor(&g_processTable);
+
+// Таблица потоков: исходное назначение каждого потока, уходящего через прокси.
+// Ответы ищутся по встречному ключу без блокировок. Ячейка занимает около
+// 90 байт, поэтому таблица начинает с 16K ячеек (~1.5 МБ) и растет по
+// шардам до 2M, которые держат заполнение ниже 50% на миллионе потоков.
+static std::unique_ptr<FlowTable> g_flowTable;
+static const size_t g_flowTableCapacity = (size_t)1 << 21;
+static const size_t g_flowTableInitialCapacity = (size_t)1 << 14;
+static const uint32_t g_tcpIdleTimeout = 300;
+static const uint32_t g_udpIdleTimeout = 60;
+static volatile LONG g_flowExpireTick = 0;
+
+// flags потока: действие профиля (RouteAction) и состояние разбора первых
+// данных. Пока имя и протокол не известны, действует оценка по адресу.
+static const uint8_t kFlowActionMask = 0x0f;
+static const uint8_t kFlowSniffPending = 0x80;   // ждем первые данные
+static const uint8_t kFlowSniffBuffered = 0x40;  // разбор в g_pendingSniffs
+static const uint8_t kFlowProcessPending = 0x20;  // владелец еще не известен
 
-// Время последнего измерения пинга
-static ULONGLONG g_lastPingTime = 0;
+// Потоки, чей ClientHello или запрос HTTP пришел по частям. Обычно
+// сообщение целиком в первом пакете и сюда не попадает.
+struct PendingSniff {
+    FlowSniffer sniffer;
+    uint32_t since;
+};
 
-// Таймер для обновления статистики
-static HANDLE g_timerQueue = NULL;
-static HANDLE g_timerQueueTimer = NULL;
+struct FlowKeyLess {
+    bool operator()(const FlowKey& left, const FlowKey& right) const {
+        return memcmp(&left, &right, sizeof(FlowKey)) < 0;
+    }
+};
+
+static std::mutex g_sniffMutex;
+static std::map<FlowKey, PendingSniff, FlowKeyLess> g_pendingSniffs;
+static const size_t g_maxPendingSniffs = 256;
+static const uint32_t g_sniffTimeout = 10;
+
+// Потоки, чей владелец еще не попал в g_processTable: событие connect слоя
+// SOCKET обрабатывается асинхронно, а на Linux сокеты выгружаются раз в
+// ProcessMonitor::kRefreshIntervalMs, так что первый пакет обычно их
+// опережает. Пока профиль с правилами 'process' не знает владельца, поток
+// не закрепляется: каждый его пакет снова смотрит в таблицу, и как только
+// владелец найден, действие пересчитывается. Срок ожидания (секунда
+// g_processTimeout) хранится в FlowValue.reserved; здесь - только имя из
+// первых данных, чтобы пересчет его не потерял.
+struct UnattributedFlow {
+    std::string host;
+    SniffProtocol protocol = SniffProtocol::kNone;
+    uint32_t since = 0;
+};
+
+static std::mutex g_attributionMutex;
+static std::map<FlowKey, UnattributedFlow, FlowKeyLess> g_unattributedFlows;
+static const size_t g_maxUnattributedFlows = 1024;
+static const uint32_t g_processTimeout = 5;
+
+// Флаг инициализации Winsock
+static BOOL g_winsockInitialized = FALSE;
 
 // Функции для внутреннего использования
 static BOOL InitializeWinsock();
 static void CleanupWinsock();
-static BOOL MeasureLatency();
+static int32_t RegisterLatencyTarget(const char* address, int port);
+static BOOL EnsureLatencyProber();
+static int32_t ToMilliseconds(uint32_t microseconds);
 static BOOL IsPrivateAddress(uint32_t addr);
+static BOOL IsPrivateIpv6Address(const uint8_t* addr);
 static BOOL IsVpnServerAddress(uint32_t addr);
-static void CALLBACK StatsTimerCallback(PVOID lpParameter, BOOLEAN TimerOrWaitFired);
+static void PurgePendingSniffs(uint32_t now, BOOL all);
+static PacketVerdict TrackFlow(const PacketHeaders& headers, uint32_t now,
+                               const RuleProgram* program);
+static void ForgetFlow(const FlowKey& key, uint8_t flags);
+static BOOL BuildServerMatch(char* match, size_t size);
+static BOOL StartDivertLoop();
+static void StopDivertLoop();
+static void ProcessDivertedBatch(PacketBatch* batch);
 
 // Инициализировать модуль
 EXPORT int32_t InitializeWinDivert() {
     // Инициализация Winsock (для измерения пинга)
     if (!InitializeWinsock()) {
-        printf("Ошибка инициализации Winsock\n");
+        LOG_ERROR("Ошибка инициализации Winsock");
         return 0;
     }
     
     // Сбрасываем статистику
-    g_downloadedBytes = 0;
-    g_uploadedBytes = 0;
-    g_latency = 0;
-    g_lastPingTime = 0;
+    g_traffic.Reset();
+    g_proxyTraffic.Reset();
     
     // Сохраняем текущие настройки прокси (для восстановления)
     DWORD size = sizeof(g_oldProxySettings);
     g_proxyBackupAvailable = InternetQueryOption(NULL, INTERNET_OPTION_PROXY, &g_oldProxySettings, &size);
     
-    printf("Модуль инициализирован\n");
+    LOG_INFO("Модуль инициализирован");
     return 1;
 }
 
@@ -77,6 +195,13 @@ EXPORT int32_t SetupSocksProxy(const char* serverAddress, const char* socksPort)
     strncpy_s(g_serverAddress, sizeof(g_serverAddress), serverAddress, _TRUNCATE);
     g_proxyPort = atoi(socksPort);
     
+    // Пинг меряется до нового сервера; прежняя цель больше не нужна
+    if (g_serverTarget >= 0) {
+        g_latencyProber.RemoveTarget(g_serverTarget);
+        g_serverTarget = -1;
+    }
+    g_serverTarget = RegisterLatencyTarget(g_serverAddress, g_proxyPort);
+    
     // Настраиваем системный прокси
     INTERNET_PROXY_INFO proxyInfo;
     char proxyServer[128];
@@ -91,27 +216,19 @@ EXPORT int32_t SetupSocksProxy(const char* serverAddress, const char* socksPort)
     BOOL result = InternetSetOption(NULL, INTERNET_OPTION_PROXY, &proxyInfo, sizeof(proxyInfo));
     
     if (!result) {
-        printf("Ошибка настройки системного прокси: %d\n", GetLastError());
+        LOG_ERROR("Ошибка настройки системного прокси: %d", GetLastError());
         return 0;
     }
     
     // Принудительное обновление настроек прокси
     InternetSetOption(NULL, INTERNET_OPTION_REFRESH, NULL, 0);
     
-    // Запускаем таймер для обновления статистики
-    g_timerQueue = CreateTimerQueue();
-    if (g_timerQueue == NULL) {
-        printf("Ошибка создания очереди таймеров: %d\n", GetLastError());
-        return 0;
-    }
-    
-    if (!CreateTimerQueueTimer(&g_timerQueueTimer, g_timerQueue,
-        (WAITORTIMERCALLBACK)StatsTimerCallback, NULL, 1000, 1000, 0)) {
-        printf("Ошибка создания таймера: %d\n", GetLastError());
-        return 0;
+    // Перезапускаем перехват: фильтры строятся по адресам нового сервера
+    if (!StartDivertLoop()) {
+        LOG_WARNING("Перехват пакетов недоступен, статистика трафика не собирается");
     }
     
-    printf("Системный прокси успешно настроен\n");
+    LOG_INFO("Системный прокси успешно настроен");
     return 1;
 }
 
@@ -119,27 +236,123 @@ EXPORT int32_t SetupSocksProxy(const char* serverAddress, const char* socksPort)
 EXPORT int32_t SetupUdpRedirection(int32_t enableUdp) {
     g_enableUdp = (enableUdp != 0);
     
+    // Новые UDP ASSOCIATE встроенного прокси разрешаются по этому флагу
+    g_localProxy.SetUdpEnabled(g_enableUdp != FALSE);
+    
     if (!g_enableUdp) {
-        printf("UDP поддержка отключена\n");
+        LOG_INFO("UDP поддержка отключена");
     } else {
-        printf("UDP поддержка включена\n");
+        LOG_INFO("UDP поддержка включена");
     }
     
     return 1;
 }
 
-// Очистить ресурсы и восстановить настройки
-EXPORT int32_t CleanupWinDivert() {
-    // Останавливаем таймер статистики
-    if (g_timerQueueTimer != NULL) {
-        DeleteTimerQueueTimer(g_timerQueue, g_timerQueueTimer, NULL);
-        g_timerQueueTimer = NULL;
+// Запустить встроенный прокси на 127.0.0.1:port (workers = 0 - по числу ядер)
+EXPORT int32_t StartLocalProxy(int32_t port, int32_t workers) {
+    if (port < 0 || port > 65535 || workers < 0) {
+        return 0;
+    }
+    if (g_localProxy.IsRunning()) {
+        return 1;
+    }
+    
+    ProxyServer::Options options;
+    options.port = (uint16_t)port;
+    options.worker_count = (size_t)workers;
+    options.dns_cache = &SharedDnsCache();
+    options.fake_ips = &g_fakeIps;
+    g_localProxy.SetUdpEnabled(g_enableUdp != FALSE);
+    return g_localProxy.Start(options) ? 1 : 0;
+}
+
+// Запустить встроенный прокси перед ядром VPN: соединения маршрутизируются
+// текущим профилем (RoutingCompileProfile), proxy уходит в SOCKS5 ядра на
+// 127.0.0.1:upstreamPort. UDP ASSOCIATE отключен: ретранслятор шлет
+// датаграммы напрямую, мимо ядра.
+EXPORT int32_t StartRoutingProxy(int32_t port, int32_t upstreamPort, int32_t workers) {
+    if (port < 0 || port > 65535 || upstreamPort <= 0 || upstreamPort > 65535 || workers < 0) {
+        return 0;
+    }
+    if (g_localProxy.IsRunning()) {
+        return 1;
+    }
+    
+    ProxyServer::Options options;
+    options.port = (uint16_t)port;
+    options.worker_count = (size_t)workers;
+    options.dns_cache = &SharedDnsCache();
+    options.fake_ips = &g_fakeIps;
+    options.udp_relay = false;
+    options.route = RouteConnection;
+    options.upstream_port = (uint16_t)upstreamPort;
+    return g_localProxy.Start(options) ? 1 : 0;
+}
+
+// Остановить встроенный прокси
+EXPORT int32_t StopLocalProxy() {
+    g_localProxy.Stop();
+    return 1;
+}
+
+// Запустить fake-IP DNS на 127.0.0.1:port. Имена, не уходящие в прокси,
+// и прочие запросы пересылаются серверу upstream (NULL - 8.8.8.8)
+EXPORT int32_t StartFakeDns(int32_t port, const char* upstream) {
+    if (port < 0 || port > 65535) {
+        return 0;
+    }
+    if (g_fakeDns.IsRunning()) {
+        return 1;
+    }
+    if (!InitializeWinsock()) {
+        return 0;
+    }
+    
+    FakeDnsServer::Options options;
+    options.port = (uint16_t)port;
+    if (upstream != NULL && upstream[0] != '\0') {
+        options.upstream = upstream;
+    }
+    if (!g_fakeDns.Start(options)) {
+        LOG_ERROR("Ошибка запуска fake-IP DNS");
+        return 0;
+    }
+    LOG_INFO("Fake-IP DNS запущен на 127.0.0.1:%d", g_fakeDns.port());
+    return 1;
+}
+
+// Остановить fake-IP DNS. Выданные адреса остаются действительными
+EXPORT int32_t StopFakeDns() {
+    g_fakeDns.Stop();
+    return 1;
+}
+
+// Имя, которому fake-IP DNS выдал адрес. Возвращает длину имени или 0
+EXPORT int32_t FakeIpToDomain(const char* address, char* domain, int32_t capacity) {
+    struct in_addr parsed;
+    if (address == NULL || domain == NULL || capacity <= 0 ||
+        inet_pton(AF_INET, address, &parsed) != 1) {
+        return 0;
     }
     
-    if (g_timerQueue != NULL) {
-        DeleteTimerQueue(g_timerQueue);
-        g_timerQueue = NULL;
+    std::string name;
+    if (!g_fakeIps.Lookup(ntohl(parsed.s_addr), &name) || (int32_t)name.size() >= capacity) {
+        return 0;
     }
+    memcpy(domain, name.c_str(), name.size() + 1);
+    return (int32_t)name.size();
+}
+
+// Очистить ресурсы и восстановить настройки
+EXPORT int32_t CleanupWinDivert() {
+    // Останавливаем цикл перехвата и встроенный прокси
+    StopDivertLoop();
+    PurgePendingSniffs(0, TRUE);
+    g_flowTable.reset();
+    g_localProxy.Stop();
+    g_fakeDns.Stop();
+    g_latencyProber.Stop();
+    g_serverTarget = -1;
     
     // Восстанавливаем предыдущие настройки прокси
     if (g_proxyBackupAvailable) {
@@ -160,33 +373,74 @@ EXPORT int32_t CleanupWinDivert() {
     // Очистка Winsock
     CleanupWinsock();
     
-    printf("Ресурсы очищены\n");
+    LOG_INFO("Ресурсы очищены");
     return 1;
 }
 
 // Получить статистику трафика
 EXPORT int32_t GetTrafficStats(int64_t* downloadedBytes, int64_t* uploadedBytes, int32_t* ping) {
-    if (downloadedBytes) *downloadedBytes = g_downloadedBytes;
-    if (uploadedBytes) *uploadedBytes = g_uploadedBytes;
-    if (ping) *ping = g_latency;
-    
-    // Обновляем пинг каждые 10 секунд
-    ULONGLONG currentTime = GetTickCount64();
-    if (currentTime - g_lastPingTime > 10000) {
-        MeasureLatency();
-        g_lastPingTime = currentTime;
+    // Шарды счетчиков сворачиваются только здесь. Без захвата туннеля
+    // трафик известен только встроенному прокси
+    const TrafficCounters& source =
+        (!g_tunnelPump.IsRunning() && g_localProxy.IsRunning()) ? g_proxyTraffic : g_traffic;
+    TrafficSnapshot snapshot = source.Snapshot();
+    if (downloadedBytes) *downloadedBytes = (int64_t)snapshot.downloaded_bytes;
+    if (uploadedBytes) *uploadedBytes = (int64_t)snapshot.uploaded_bytes;
+    
+    // Пинг меряется в фоне; 999 - сервер перестал отвечать
+    if (ping) {
+        LatencyStats stats;
+        if (!g_latencyProber.Read(g_serverTarget, &stats)) {
+            *ping = 0;
+        } else if (stats.failures > 0) {
+            *ping = 999;
+        } else {
+            *ping = ToMilliseconds(stats.smoothed_us);
+        }
     }
     
     return 1;
 }
 
+// Добавить сервер в фоновый замер пинга (например, для сравнения серверов).
+// Возвращает номер цели или -1
+EXPORT int32_t AddLatencyTarget(const char* address, int32_t port) {
+    if (!address || !InitializeWinsock()) {
+        return -1;
+    }
+    return RegisterLatencyTarget(address, port);
+}
+
+EXPORT int32_t RemoveLatencyTarget(int32_t id) {
+    if (id == g_serverTarget) {
+        return 0;
+    }
+    g_latencyProber.RemoveTarget(id);
+    return 1;
+}
+
+// Сглаженный пинг, джиттер и последний замер цели в миллисекундах.
+// Возвращает 0, если замеров еще не было
+EXPORT int32_t GetLatencyStats(int32_t id, int32_t* smoothedMs, int32_t* jitterMs,
+                               int32_t* lastMs, int32_t* failures) {
+    LatencyStats stats;
+    if (!g_latencyProber.Read(id, &stats)) {
+        return 0;
+    }
+    if (smoothedMs) *smoothedMs = stats.samples > 0 ? ToMilliseconds(stats.smoothed_us) : -1;
+    if (jitterMs) *jitterMs = stats.samples > 0 ? ToMilliseconds(stats.jitter_us) : -1;
+    if (lastMs) *lastMs = stats.samples > 0 ? ToMilliseconds(stats.last_us) : -1;
+    if (failures) *failures = (int32_t)stats.failures;
+    return 1;
+}
+
 // Инициализация Winsock
 static BOOL InitializeWinsock() {
     if (g_winsockInitialized) return TRUE;
     
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        printf("WSAStartup failed: %d\n", WSAGetLastError());
+        LOG_ERROR("WSAStartup failed: %d", WSAGetLastError());
         return FALSE;
     }
     
@@ -202,32 +456,28 @@ static void CleanupWinsock() {
     }
 }
 
+// Диапазоны geoip:private, скомпилированные в таблицу LPM при первом обращении
+static const PrefixTable& PrivateRanges() {
+    static const PrefixTable* table = [] {
+        PrefixTable* privateTable = new PrefixTable();
+        privateTable->AddCidrList(kGeoipPrivateRanges, strlen(kGeoipPrivateRanges), 1);
+        privateTable->Build();
+        return privateTable;
+    }();
+    return *table;
+}
+
 // Проверка, является ли адрес локальным
 static BOOL IsPrivateAddress(uint32_t addr) {
     // IP в формате хоста
     addr = ntohl(addr);
     
-    // 10.0.0.0/8
-    if ((addr & 0xFF000000) == 0x0A000000) {
-        return TRUE;
-    }
-    
-    // 172.16.0.0/12
-    if ((addr & 0xFFF00000) == 0xAC100000) {
-        return TRUE;
-    }
-    
-    // 192.168.0.0/16
-    if ((addr & 0xFFFF0000) == 0xC0A80000) {
-        return TRUE;
-    }
-    
-    // 127.0.0.0/8 (localhost)
-    if ((addr & 0xFF000000) == 0x7F000000) {
-        return TRUE;
-    }
-    
-    return FALSE;
+    return PrivateRanges().LookupIpv4(addr) != PrefixTable::kNoMatch;
+}
+
+// Проверка, является ли адрес IPv6 локальным
+static BOOL IsPrivateIpv6Address(const uint8_t* addr) {
+    return PrivateRanges().LookupIpv6(addr) != PrefixTable::kNoMatch;
 }
 
 // Проверка, является ли адрес VPN сервером
@@ -242,66 +492,430 @@ static BOOL IsVpnServerAddress(uint32_t addr) {
     return (addr == serverAddr.s_addr);
 }
 
-// Измеряем пинг до VPN сервера
-static BOOL MeasureLatency() {
-    if (g_serverAddress[0] == '\0') {
-        return FALSE;
+// Действие профиля для исходящего потока; |sniffed| - имя и протокол из
+// первых данных потока (NULL, пока их нет)
+static RouteAction RouteNewFlow(const PacketHeaders& headers, const RuleProgram* program,
+                                const SniffResult* sniffed, bool* unattributed) {
+    *unattributed = false;
+    if (program == NULL) {
+        return RouteAction::kProxy;
     }
     
-    struct sockaddr_in server;
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock == INVALID_SOCKET) {
-        return FALSE;
+    // Фиктивный адрес fake-IP заменяется выданным за ним именем
+    std::string domain;
+    RouteQuery query = FlowRouteQuery(headers, g_fakeIps, sniffed, &domain);
+    if (program->has_process_rules()) {
+        const std::string* process = g_processTable.Lookup(FlowKey::FromHeaders(headers));
+        if (process != NULL) {
+            query.process = process->c_str();
+            query.process_length = process->size();
+        } else {
+            *unattributed = true;
+        }
+    }
+    
+    RouteAction action = program->Evaluate(query).action;
+    return action != RouteAction::kNone ? action : RouteAction::kProxy;
+}
+
+static SniffResult FeedSniffer(FlowSniffer* sniffer, const PacketHeaders& headers) {
+    if (headers.IsTcp()) {
+        return sniffer->FeedStream(headers.tcp_sequence(), headers.payload(),
+                                   headers.payload_length());
+    }
+    return sniffer->FeedDatagram(headers.payload(), headers.payload_length());
+}
+
+// Запомнить имя из первых данных потока без владельца
+static void RememberSniffedHost(const FlowKey& key, const SniffResult& result, uint32_t now) {
+    std::lock_guard<std::mutex> lock(g_attributionMutex);
+    if (g_unattributedFlows.size() >= g_maxUnattributedFlows) {
+        return;
+    }
+    UnattributedFlow& flow = g_unattributedFlows[key];
+    flow.host.assign(result.host != NULL ? result.host : "", result.host_length);
+    flow.protocol = result.protocol;
+    flow.since = now;
+}
+
+static void ForgetSniffedHost(const FlowKey& key) {
+    std::lock_guard<std::mutex> lock(g_attributionMutex);
+    g_unattributedFlows.erase(key);
+}
+
+// Новые flags потока по результату разбора
+static uint8_t SniffedFlowFlags(const FlowKey& key, const PacketHeaders& headers,
+                                const RuleProgram* program, const SniffResult& result,
+                                uint8_t flags, uint32_t now) {
+    if (result.status == SniffStatus::kNeedMore) {
+        return flags;
+    }
+    if (result.status == SniffStatus::kNoMatch) {
+        return flags & (kFlowActionMask | kFlowProcessPending);
+    }
+    bool unattributed;
+    uint8_t action = (uint8_t)RouteNewFlow(headers, program, &result, &unattributed);
+    if (!unattributed) {
+        return action;
+    }
+    RememberSniffedHost(key, result, now);
+    return action | kFlowProcessPending;
+}
+
+// Поток без владельца: владелец нашелся - действие пересчитывается (с
+// именем из первых данных, если оно было), срок вышел - поток закрепляется
+// с текущим действием
+static uint8_t AttributeFlow(const FlowKey& key, const PacketHeaders& headers,
+                             const RuleProgram* program, const FlowValue& value, uint32_t now) {
+    uint8_t flags = value.flags & ~kFlowProcessPending;
+    if (g_processTable.Lookup(key) == NULL) {
+        if ((int32_t)(now - value.reserved) < 0) {
+            return value.flags;
+        }
+        ForgetSniffedHost(key);
+        return flags;
+    }
+    
+    UnattributedFlow flow;
+    bool sniffed = false;
+    {
+        std::lock_guard<std::mutex> lock(g_attributionMutex);
+        auto found = g_unattributedFlows.find(key);
+        if (found != g_unattributedFlows.end()) {
+            flow = std::move(found->second);
+            sniffed = true;
+            g_unattributedFlows.erase(found);
+        }
+    }
+    SniffResult result;
+    result.status = SniffStatus::kFound;
+    result.protocol = flow.protocol;
+    result.host = flow.host.empty() ? NULL : flow.host.c_str();
+    result.host_length = flow.host.size();
+    bool unattributed;
+    RouteAction action = RouteNewFlow(headers, program, sniffed ? &result : NULL, &unattributed);
+    return (uint8_t)((flags & ~kFlowActionMask) | (uint8_t)action);
+}
+
+// Забыть незаконченные разборы старше g_sniffTimeout и имена потоков, не
+// дождавшихся владельца за g_processTimeout (или все)
+static void PurgePendingSniffs(uint32_t now, BOOL all) {
+    {
+        std::lock_guard<std::mutex> lock(g_sniffMutex);
+        for (auto it = g_pendingSniffs.begin(); it != g_pendingSniffs.end();) {
+            if (all || now - it->second.since > g_sniffTimeout) {
+                it = g_pendingSniffs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(g_attributionMutex);
+    for (auto it = g_unattributedFlows.begin(); it != g_unattributedFlows.end();) {
+        if (all || now - it->second.since > g_processTimeout) {
+            it = g_unattributedFlows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Разбор первых данных потока: SNI, Host или SNI из QUIC Initial. По ним
+// профиль оценивается заново, например, чтобы заблокировать ClientHello.
+static uint8_t SniffFlow(const FlowKey& key, const PacketHeaders& headers, uint32_t now,
+                         const RuleProgram* program, uint8_t flags) {
+    if (flags & kFlowSniffBuffered) {
+        std::lock_guard<std::mutex> lock(g_sniffMutex);
+        auto found = g_pendingSniffs.find(key);
+        if (found == g_pendingSniffs.end()) {
+            return flags & (kFlowActionMask | kFlowProcessPending);
+        }
+        SniffResult result = FeedSniffer(&found->second.sniffer, headers);
+        // Имя указывает в буфер разбора: оцениваем до удаления
+        flags = SniffedFlowFlags(key, headers, program, result, flags, now);
+        if (result.status != SniffStatus::kNeedMore) {
+            g_pendingSniffs.erase(found);
+        }
+        return flags;
+    }
+    
+    // Первый пакет с данными разбирается без копирования и блокировок
+    FlowSniffer sniffer;
+    SniffResult result = FeedSniffer(&sniffer, headers);
+    if (result.status != SniffStatus::kNeedMore) {
+        return SniffedFlowFlags(key, headers, program, result, flags, now);
     }
     
-    // Устанавливаем неблокирующий режим
-    u_long mode = 1;
-    ioctlsocket(sock, FIONBIO, &mode);
+    std::lock_guard<std::mutex> lock(g_sniffMutex);
+    if (g_pendingSniffs.size() >= g_maxPendingSniffs) {
+        return flags & (kFlowActionMask | kFlowProcessPending);
+    }
+    PendingSniff& pending = g_pendingSniffs[key];
+    pending.sniffer = std::move(sniffer);
+    pending.since = now;
+    return flags | kFlowSniffBuffered;
+}
+
+// Удалить закрытый поток из таблицы вместе с незаконченным разбором
+static void ForgetFlow(const FlowKey& key, uint8_t flags) {
+    g_flowTable->Remove(key);
+    if (flags & kFlowSniffBuffered) {
+        std::lock_guard<std::mutex> lock(g_sniffMutex);
+        g_pendingSniffs.erase(key);
+    }
+    if (flags & kFlowProcessPending) {
+        ForgetSniffedHost(key);
+    }
+}
+
+// Учет потока в таблице: исходящие пакеты регистрируют исходное назначение
+// и действие профиля (в flags) и продлевают жизнь потока. Действие
+// закрепляется за потоком, поэтому замена профиля касается только новых
+// потоков; уточняется оно по имени и протоколу из первых данных и, для
+// правил 'process', когда монитор узнает владельца (не дольше
+// g_processTimeout). FIN или RST закрывают поток: запись удаляется, не
+// дожидаясь простоя.
+static PacketVerdict TrackFlow(const PacketHeaders& headers, uint32_t now,
+                               const RuleProgram* program) {
+    if (headers.IsIpv4()) {
+        uint32_t destination = htonl(headers.ipv4_destination());
+        // Пул fake-IP входит в частные диапазоны, но его потоки учитываются
+        if ((IsPrivateAddress(destination) && !g_fakeIps.Contains(headers.ipv4_destination())) ||
+            IsVpnServerAddress(destination)) {
+            return PacketVerdict::kForward;
+        }
+    } else if (IsPrivateIpv6Address(headers.ipv6_destination())) {
+        return PacketVerdict::kForward;
+    }
     
-    // Настройка адреса сервера
-    server.sin_family = AF_INET;
-    inet_pton(AF_INET, g_serverAddress, &server.sin_addr);
-    server.sin_port = htons(g_proxyPort);
+    FlowKey key = FlowKey::FromHeaders(headers);
+    FlowValue value;
+    if (headers.tcp_flags() & (kTcpFlagFin | kTcpFlagRst)) {
+        // Незнакомый поток (открыт до запуска перехвата) не заводим
+        if (!g_flowTable->Lookup(key, now, &value)) {
+            return PacketVerdict::kForward;
+        }
+        ForgetFlow(key, value.flags);
+        return (value.flags & kFlowActionMask) == (uint8_t)RouteAction::kBlock
+                   ? PacketVerdict::kDrop
+                   : PacketVerdict::kForward;
+    }
     
-    // Начинаем замер времени
-    ULONGLONG startTime = GetTickCount64();
+    uint32_t timeout = headers.IsTcp() ? g_tcpIdleTimeout : g_udpIdleTimeout;
+    if (!g_flowTable->Lookup(key, now, &value)) {
+        memcpy(value.original_destination, key.destination, sizeof(value.original_destination));
+        value.original_port = key.destination_port;
+        value.family = key.family;
+        bool unattributed;
+        value.flags = (uint8_t)RouteNewFlow(headers, program, NULL, &unattributed);
+        // Без профиля имя и протокол ни на что не влияют
+        if (program != NULL) {
+            value.flags |= kFlowSniffPending;
+        }
+        if (unattributed) {
+            value.flags |= kFlowProcessPending;
+            value.reserved = now + g_processTimeout;
+        }
+        g_flowTable->Insert(key, value, now, timeout);
+    }
     
-    // Пытаемся подключиться
-    connect(sock, (struct sockaddr*)&server, sizeof(server));
+    if ((value.flags & kFlowSniffPending) && headers.payload_length() > 0) {
+        uint8_t before = value.flags;
+        value.flags = SniffFlow(key, headers, now, program, value.flags);
+        if ((value.flags & ~before) & kFlowProcessPending) {
+            value.reserved = now + g_processTimeout;
+        }
+        g_flowTable->Insert(key, value, now, timeout);
+    }
     
-    // Ждем с таймаутом
-    fd_set writefds;
-    FD_ZERO(&writefds);
-    FD_SET(sock, &writefds);
+    // Разбор первых данных сам смотрит владельца; после него ждем монитор
+    if ((value.flags & (kFlowProcessPending | kFlowSniffPending)) == kFlowProcessPending &&
+        program != NULL) {
+        uint8_t flags = AttributeFlow(key, headers, program, value, now);
+        if (flags != value.flags) {
+            value.flags = flags;
+            g_flowTable->Insert(key, value, now, timeout);
+        }
+    }
     
-    struct timeval timeout;
-    timeout.tv_sec = 1;
-    timeout.tv_usec = 0;
+    return (value.flags & kFlowActionMask) == (uint8_t)RouteAction::kBlock
+               ? PacketVerdict::kDrop
+               : PacketVerdict::kForward;
+}
+
+// Сервер для замера пинга: IPv4, IPv6 или имя (разрешается в фоне, адреса
+// обоих семейств соревнуются по Happy Eyeballs). Возвращает номер цели или -1
+static int32_t RegisterLatencyTarget(const char* address, int port) {
+    if (address[0] == '\0' || port <= 0 || port > 65535) {
+        return -1;
+    }
+    if (!EnsureLatencyProber()) {
+        return -1;
+    }
+    return g_latencyProber.AddTarget(std::string(address), (uint16_t)port);
+}
+
+// Имя уходит в прокси по текущему профилю (без профиля - любое имя)
+static bool ShouldFakeDomain(const std::string& domain) {
+    RcuPointer<RuleProgram>::ReadGuard program = ActiveRuleProgram().Read();
+    if (!program) {
+        return true;
+    }
     
-    int result = select(0, NULL, &writefds, NULL, &timeout);
+    RouteQuery query;
+    query.domain = domain.c_str();
+    query.domain_length = domain.size();
+    RouteAction action = program->Evaluate(query).action;
+    return action == RouteAction::kProxy || action == RouteAction::kNone;
+}
+
+// Поток замеров запускается при первой цели и живет до CleanupWinDivert
+static BOOL EnsureLatencyProber() {
+    if (g_latencyProber.IsRunning()) {
+        return TRUE;
+    }
+    if (!g_latencyProber.Start(LatencyProber::Options())) {
+        LOG_ERROR("Ошибка запуска замера пинга");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Микросекунды в миллисекунды с округлением
+static int32_t ToMilliseconds(uint32_t microseconds) {
+    return (int32_t)((microseconds + 500) / 1000);
+}
+
+// Условие WinDivert на пакеты к серверу VPN и от него: адреса имени
+// сервера, не больше четырех. FALSE, если сервер не задан или не разрешился
+static BOOL BuildServerMatch(char* match, size_t size) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = NULL;
+    if (g_serverAddress[0] == '\0' || getaddrinfo(g_serverAddress, NULL, &hints, &result) != 0) {
+        return FALSE;
+    }
     
-    // Вычисляем затраченное время
-    ULONGLONG endTime = GetTickCount64();
-    ULONGLONG elapsedTime = endTime - startTime;
+    size_t length = (size_t)snprintf(match, size, "(");
+    int added = 0;
+    for (struct addrinfo* it = result; it != NULL && added < 4; it = it->ai_next) {
+        char text[INET6_ADDRSTRLEN];
+        const char* field;
+        if (it->ai_family == AF_INET) {
+            inet_ntop(AF_INET, &((struct sockaddr_in*)it->ai_addr)->sin_addr, text, sizeof(text));
+            field = "ip";
+        } else if (it->ai_family == AF_INET6) {
+            inet_ntop(AF_INET6, &((struct sockaddr_in6*)it->ai_addr)->sin6_addr, text, sizeof(text));
+            field = "ipv6";
+        } else {
+            continue;
+        }
+        int written = snprintf(match + length, size - length, "%s%s.DstAddr == %s or %s.SrcAddr == %s",
+                               added > 0 ? " or " : "", field, text, field, text);
+        if (written < 0 || (size_t)written >= size - length) {
+            break;
+        }
+        length += (size_t)written;
+        added++;
+    }
+    freeaddrinfo(result);
     
-    // Закрываем сокет
-    closesocket(sock);
+    if (added == 0 || length + 2 > size) {
+        return FALSE;
+    }
+    memcpy(match + length, ")", 2);
+    return TRUE;
+}
+
+// Запуск цикла перехвата пакетов и захвата туннеля. Уже запущенные
+// перезапускаются: сервер мог смениться
+static BOOL StartDivertLoop() {
+    StopDivertLoop();
+    
+    // Потоки переживают перезапуск: таблица создается один раз
+    if (!g_flowTable) {
+        g_flowTable.reset(new FlowTable(g_flowTableCapacity, 64, g_flowTableInitialCapacity));
+    }
     
-    if (result > 0) {
-        // Подключение было успешным или завершилось с ошибкой
-        g_latency = (int32_t)elapsedTime;
+    char serverMatch[768];
+    BOOL haveServer = BuildServerMatch(serverMatch, sizeof(serverMatch));
+    char filter[1024];
+    if (haveServer) {
+        snprintf(filter, sizeof(filter), "%s and !%s", g_divertFilter, serverMatch);
+        char tunnelFilter[1024];
+        snprintf(tunnelFilter, sizeof(tunnelFilter), "!loopback and (tcp or udp) and %s",
+                 serverMatch);
+        if (!g_tunnelIo.Open(tunnelFilter, 0, WINDIVERT_FLAG_SNIFF | WINDIVERT_FLAG_RECV_ONLY) ||
+            !g_tunnelPump.Start(1, PacketPump::BatchHandler())) {
+            g_tunnelIo.Close();
+            LOG_WARNING("Захват туннеля не запущен, трафик не учитывается");
+        }
     } else {
-        // Подключение истекло по таймауту
-        g_latency = 999;
+        snprintf(filter, sizeof(filter), "%s", g_divertFilter);
+        LOG_WARNING("Адрес сервера %s не разрешен, трафик туннеля не учитывается", g_serverAddress);
+    }
+    
+    if (!g_divertIo.Open(filter, 0, 0)) {
+        return g_tunnelPump.IsRunning();
+    }
+    
+    // Один рабочий поток на ядро, но не больше четырех
+    size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 4);
+    if (!g_packetPump.Start(workers, ProcessDivertedBatch)) {
+        g_divertIo.Close();
+        return FALSE;
+    }
+    
+    // Без монитора правила 'process' просто не совпадают
+    if (!g_processMonitor.Start()) {
+        LOG_WARNING("Монитор процессов не запущен, правила по процессам отключены");
     }
     
+    LOG_INFO("Цикл перехвата запущен (%zu потоков)", workers);
     return TRUE;
 }
 
-// Функция обратного вызова для таймера статистики
-static void CALLBACK StatsTimerCallback(PVOID lpParameter, BOOLEAN TimerOrWaitFired) {
-    // Имитируем нарастание статистики для демонстрации
-    // (в реальном приложении здесь должен быть код для получения реальной статистики)
-    g_downloadedBytes += 1024 * (10 + (rand() % 100));
-    g_uploadedBytes += 1024 * (5 + (rand() % 50));
+// Остановка цикла перехвата пакетов и захвата туннеля
+static void StopDivertLoop() {
+    g_processMonitor.Stop();
+    g_packetPump.Stop();
+    g_divertIo.Close();
+    g_tunnelPump.Stop();
+    g_tunnelIo.Close();
+}
+
+// Обработка пачки перехваченных пакетов: исходящие идут через профиль,
+// входящие RST только закрывают поток
+static void ProcessDivertedBatch(PacketBatch* batch) {
+    uint32_t now = (uint32_t)(GetTickCount64() / 1000);
+    
+    // Вся пачка пакетов обрабатывается по одному снимку профиля
+    RcuPointer<RuleProgram>::ReadGuard program = ActiveRuleProgram().Read();
+    
+    for (size_t i = 0; i < batch->count; i++) {
+        PacketHeaders headers;
+        if (!ParsePacketHeaders(batch->Packet(i), batch->length[i], &headers) || !headers.has_l4) {
+            continue;
+        }
+        if (!batch->outbound[i]) {
+            FlowKey key = FlowKey::FromHeaders(headers).Reversed();
+            FlowValue value;
+            if (headers.IsTcp() && g_flowTable->Lookup(key, now, &value)) {
+                ForgetFlow(key, value.flags);
+            }
+            continue;
+        }
+        batch->verdict[i] = TrackFlow(headers, now, program.get());
+    }
+    
+    // Колесо таймеров проворачивает только один поток раз в секунду
+    LONG lastTick = g_flowExpireTick;
+    if ((LONG)now != lastTick &&
+        InterlockedCompareExchange(&g_flowExpireTick, (LONG)now, lastTick) == lastTick) {
+        g_flowTable->Expire(now);
+        PurgePendingSniffs(now, FALSE);
+        // Заодно освобождаем замененные профили, которые уже никто не читает
+        ActiveRuleProgram().Reclaim();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "windivert_packet_io.h"
+
+#include "native_log.h"
+
+#pragma comment(lib, "WinDivert.lib")
+
+static_assert(sizeof(WINDIVERT_ADDRESS) == sizeof(PacketMeta),
+              "PacketMeta must hold WINDIVERT_ADDRESS");
+
+// Длина IP-пакета по заголовку (пакеты в пачке WinDivert идут подряд)
+static UINT IpPacketLength(const UINT8* packet, UINT available) {
+  if (available < 1) {
+    return 0;
+  }
+  UINT length = 0;
+  UINT8 version = packet[0] >> 4;
+  if (version == 4 && available >= 20) {
+    length = ((UINT)packet[2] << 8) | packet[3];
+  } else if (version == 6 && available >= 40) {
+    length = 40 + (((UINT)packet[4] << 8) | packet[5]);
+  }
+  if (length == 0 || length > available) {
+    length = available;
+  }
+  return length;
+}
+
+WinDivertPacketIo::~WinDivertPacketIo() {
+  Close();
+}
+
+bool WinDivertPacketIo::Open(const char* filter, INT16 priority, UINT64 flags) {
+  if (handle_ != NULL) {
+    return true;
+  }
+  HANDLE_WINDIVERT handle =
+      WinDivertOpen(filter, WINDIVERT_LAYER_NETWORK, priority, flags);
+  if (handle == NULL || handle == INVALID_HANDLE_VALUE) {
+    LOG_ERROR("Ошибка открытия WinDivert: %lu", GetLastError());
+    return false;
+  }
+
+  // Увеличиваем очередь драйвера, чтобы пачки успевали набираться
+  WinDivertSetParam(handle, WINDIVERT_PARAM_QUEUE_LENGTH, 8192);
+  WinDivertSetParam(handle, WINDIVERT_PARAM_QUEUE_SIZE, 8 * 1024 * 1024);
+
+  handle_ = handle;
+  flags_ = flags;
+  return true;
+}
+
+void WinDivertPacketIo::Close() {
+  if (handle_ != NULL) {
+    WinDivertClose(handle_);
+    handle_ = NULL;
+  }
+}
+
+bool WinDivertPacketIo::ReceiveBatch(PacketBatch* batch) {
+  batch->Clear();
+
+  WINDIVERT_ADDRESS* addresses = reinterpret_cast<WINDIVERT_ADDRESS*>(batch->meta);
+  UINT recv_length = 0;
+  UINT addr_length = (UINT)(kPacketBatchMax * sizeof(WINDIVERT_ADDRESS));
+  if (!WinDivertRecvEx(handle_, batch->data, (UINT)PacketBatch::kBufferCapacity,
+                       &recv_length, 0, addresses, &addr_length, NULL)) {
+    // ERROR_NO_DATA означает, что был вызван WinDivertShutdown
+    return false;
+  }
+
+  UINT packet_count = addr_length / (UINT)sizeof(WINDIVERT_ADDRESS);
+  for (UINT i = 0; i < packet_count && batch->data_size < recv_length; i++) {
+    UINT available = recv_length - (UINT)batch->data_size;
+    UINT length = IpPacketLength(batch->data + batch->data_size, available);
+    batch->Commit(length, addresses[i].Outbound != 0);
+  }
+  return true;
+}
+
+bool WinDivertPacketIo::SendBatch(PacketBatch* batch) {
+  if ((flags_ & WINDIVERT_FLAG_RECV_ONLY) != 0) {
+    return true;
+  }
+  if (CompactForwardedPackets(batch) == 0) {
+    return true;
+  }
+  const WINDIVERT_ADDRESS* addresses =
+      reinterpret_cast<const WINDIVERT_ADDRESS*>(batch->meta);
+  UINT send_length = 0;
+  return WinDivertSendEx(handle_, batch->data, (UINT)batch->data_size,
+                         &send_length, 0, addresses,
+                         (UINT)(batch->count * sizeof(WINDIVERT_ADDRESS)),
+                         NULL) != FALSE;
+}
+
+void WinDivertPacketIo::Shutdown() {
+  if (handle_ != NULL) {
+    WinDivertShutdown(handle_, WINDIVERT_SHUTDOWN_BOTH);
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef RUNNER_WINDIVERT_PACKET_IO_H_
+#define RUNNER_WINDIVERT_PACKET_IO_H_
+
+#include <windows.h>
+#include <windivert.h>
+
+#include "packet_io.h"
+
+// Бэкенд PacketIo поверх WinDivert: одна пачка - один вызов
+// WinDivertRecvEx/WinDivertSendEx.
+class WinDivertPacketIo : public PacketIo {
+ public:
+  WinDivertPacketIo() = default;
+  ~WinDivertPacketIo() override;
+
+  // Открыть перехват на сетевом уровне с фильтром |filter|. С флагами
+  // WINDIVERT_FLAG_SNIFF | WINDIVERT_FLAG_RECV_ONLY принимаются копии
+  // пакетов, а SendBatch() ничего не отправляет: оригиналы уже ушли.
+  bool Open(const char* filter, INT16 priority, UINT64 flags);
+
+  // Закрыть дескриптор. Рабочие потоки должны быть уже остановлены.
+  void Close();
+
+  bool IsOpen() const { return handle_ != NULL; }
+
+  // PacketIo:
+  bool ReceiveBatch(PacketBatch* batch) override;
+  bool SendBatch(PacketBatch* batch) override;
+  void Shutdown() override;
+
+ private:
+  HANDLE_WINDIVERT handle_ = NULL;
+  UINT64 flags_ = 0;
+};
+
+#endif  // RUNNER_WINDIVERT_PACKET_IO_H_